@@ -0,0 +1,725 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bgpdump_lib.h"
+#include "bgpstream.h"
+#include "bgpstream_elem_generator.h"
+#include "bgpstream_filter.h"
+#include "bgpstream_int.h"
+#include "utils.h"
+
+#include "mrtgen.h"
+
+#define NAME "bgpstream-bench"
+
+#define DEFAULT_REPEATS 5
+#define DEFAULT_SCALE 100
+
+/* time and length of the generated updates dump */
+#define DUMP_TIME 1427846400
+#define DUMP_DURATION 900
+
+#define BUFFER_LEN 4096
+
+/* ========== ALLOCATION COUNTING ========== */
+
+/* With glibc we can count allocations by interposing the allocator entry
+   points and forwarding to the real implementations. Elsewhere (and under
+   AddressSanitizer, which replaces the allocator itself) allocations are
+   simply not reported. */
+#if defined(__SANITIZE_ADDRESS__)
+#define WITH_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define WITH_ASAN 1
+#endif
+#endif
+
+#if defined(__GLIBC__) && !defined(WITH_ASAN)
+#define HAVE_ALLOC_CNT 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t alloc_cnt = 0;
+
+void *malloc(size_t size)
+{
+  __atomic_add_fetch(&alloc_cnt, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+  __atomic_add_fetch(&alloc_cnt, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  __atomic_add_fetch(&alloc_cnt, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+#define ALLOC_CNT() __atomic_load_n(&alloc_cnt, __ATOMIC_RELAXED)
+#else
+#define ALLOC_CNT() 0
+#endif
+
+/* ========== BENCHMARK FRAMEWORK ========== */
+
+/* state shared by all benchmarks */
+typedef struct bench_ctx {
+  mrtgen_t *gen;
+  char rib_path[BUFFER_LEN];
+  char updates_path[BUFFER_LEN];
+} bench_ctx_t;
+
+/* measurements of a single run of a benchmark */
+typedef struct bench_timer {
+  struct timespec start;
+  uint64_t start_allocs;
+  uint64_t ns;
+  uint64_t allocs;
+  uint64_t ops;
+} bench_timer_t;
+
+typedef struct bench bench_t;
+
+/* run the benchmark once, timing only the code between timer_start and
+   timer_stop */
+typedef int(bench_func_t)(bench_ctx_t *ctx, const bench_t *bench,
+                          bench_timer_t *timer);
+
+struct bench {
+  const char *name;
+  bench_func_t *func;
+
+  /* filter benchmarks only */
+  bgpstream_filter_type_t filter_type;
+  const char *filter_value;
+};
+
+static void timer_start(bench_timer_t *timer)
+{
+  timer->start_allocs = ALLOC_CNT();
+  clock_gettime(CLOCK_MONOTONIC, &timer->start);
+}
+
+static void timer_stop(bench_timer_t *timer, uint64_t ops)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  timer->allocs = ALLOC_CNT() - timer->start_allocs;
+  timer->ns = (uint64_t)(end.tv_sec - timer->start.tv_sec) * 1000000000 +
+              end.tv_nsec - timer->start.tv_nsec;
+  timer->ops = ops;
+}
+
+/* ========== FIXTURES ========== */
+
+/* a dump read into memory */
+typedef struct entries {
+  BGPDUMP *dump;
+  BGPDUMP_ENTRY **entries;
+  int cnt;
+} entries_t;
+
+static void entries_free(entries_t *e)
+{
+  int i;
+  for (i = 0; i < e->cnt; i++) {
+    bgpdump_free_mem(e->entries[i]);
+  }
+  free(e->entries);
+  if (e->dump != NULL) {
+    bgpdump_close_dump(e->dump);
+  }
+  memset(e, 0, sizeof(entries_t));
+}
+
+static int entries_load(entries_t *e, const char *path)
+{
+  BGPDUMP_ENTRY *entry, **tmp;
+  int alloc = 0;
+
+  memset(e, 0, sizeof(entries_t));
+  if ((e->dump = bgpdump_open_dump(path)) == NULL) {
+    return -1;
+  }
+  while (e->dump->eof == 0) {
+    if ((entry = bgpdump_read_next(e->dump)) == NULL) {
+      continue;
+    }
+    if (e->cnt == alloc) {
+      alloc = alloc == 0 ? 1024 : alloc * 2;
+      if ((tmp = realloc(e->entries, sizeof(BGPDUMP_ENTRY *) * alloc)) ==
+          NULL) {
+        bgpdump_free_mem(entry);
+        goto err;
+      }
+      e->entries = tmp;
+    }
+    e->entries[e->cnt++] = entry;
+  }
+  return 0;
+
+err:
+  entries_free(e);
+  return -1;
+}
+
+/* a dump read into populated records (which own the entries) */
+typedef struct records {
+  entries_t entries;
+  bgpstream_record_t **records;
+  int cnt;
+  uint64_t elem_cnt;
+} records_t;
+
+static void records_free(records_t *r)
+{
+  int i;
+  for (i = 0; i < r->cnt; i++) {
+    bgpstream_record_destroy(r->records[i]);
+  }
+  free(r->records);
+  /* the records have freed the entries */
+  r->entries.cnt = 0;
+  entries_free(&r->entries);
+  memset(r, 0, sizeof(records_t));
+}
+
+static int records_load(records_t *r, const char *path, bgpstream_t *bs)
+{
+  bgpstream_record_t *record;
+  int i;
+
+  memset(r, 0, sizeof(records_t));
+  if (entries_load(&r->entries, path) != 0 ||
+      (r->records = malloc_zero(sizeof(bgpstream_record_t *) *
+                                r->entries.cnt)) == NULL) {
+    goto err;
+  }
+  for (i = 0; i < r->entries.cnt; i++) {
+    if ((record = bgpstream_record_create()) == NULL) {
+      goto err;
+    }
+    r->records[r->cnt++] = record;
+    record->bs = bs;
+    record->status = BGPSTREAM_RECORD_STATUS_VALID_RECORD;
+    record->bd_entry = r->entries.entries[i];
+    r->entries.entries[i] = NULL;
+    if (bgpstream_elem_generator_populate(record->elem_generator, record) !=
+        0) {
+      goto err;
+    }
+    while (bgpstream_elem_generator_get_next_elem(record->elem_generator) !=
+           NULL) {
+      r->elem_cnt++;
+    }
+  }
+  return 0;
+
+err:
+  fprintf(stderr, "ERROR: Could not load records from %s\n", path);
+  records_free(r);
+  return -1;
+}
+
+/* ========== BENCHMARKS ========== */
+
+static int read_next(const char *path, bench_timer_t *timer)
+{
+  BGPDUMP *dump;
+  BGPDUMP_ENTRY *entry;
+  uint64_t ops = 0;
+
+  timer_start(timer);
+  if ((dump = bgpdump_open_dump(path)) == NULL) {
+    return -1;
+  }
+  while (dump->eof == 0) {
+    if ((entry = bgpdump_read_next(dump)) != NULL) {
+      bgpdump_free_mem(entry);
+      ops++;
+    }
+  }
+  bgpdump_close_dump(dump);
+  timer_stop(timer, ops);
+  return 0;
+}
+
+static int bench_read_next_rib(bench_ctx_t *ctx, const bench_t *bench,
+                               bench_timer_t *timer)
+{
+  return read_next(ctx->rib_path, timer);
+}
+
+static int bench_read_next_updates(bench_ctx_t *ctx, const bench_t *bench,
+                                   bench_timer_t *timer)
+{
+  return read_next(ctx->updates_path, timer);
+}
+
+static int populate(const char *path, bench_timer_t *timer)
+{
+  entries_t e;
+  bgpstream_record_t *record = NULL;
+  int i;
+  int rc = -1;
+
+  if (entries_load(&e, path) != 0 ||
+      (record = bgpstream_record_create()) == NULL) {
+    goto done;
+  }
+  record->status = BGPSTREAM_RECORD_STATUS_VALID_RECORD;
+
+  timer_start(timer);
+  for (i = 0; i < e.cnt; i++) {
+    record->bd_entry = e.entries[i];
+    if (bgpstream_elem_generator_populate(record->elem_generator, record) !=
+        0) {
+      goto done;
+    }
+    bgpstream_elem_generator_clear(record->elem_generator);
+  }
+  timer_stop(timer, e.cnt);
+  rc = 0;
+
+done:
+  if (record != NULL) {
+    /* the entries are freed with the dump */
+    record->bd_entry = NULL;
+    bgpstream_record_destroy(record);
+  }
+  entries_free(&e);
+  return rc;
+}
+
+static int bench_populate_rib(bench_ctx_t *ctx, const bench_t *bench,
+                              bench_timer_t *timer)
+{
+  return populate(ctx->rib_path, timer);
+}
+
+static int bench_populate_updates(bench_ctx_t *ctx, const bench_t *bench,
+                                  bench_timer_t *timer)
+{
+  return populate(ctx->updates_path, timer);
+}
+
+static int bench_filter(bench_ctx_t *ctx, const bench_t *bench,
+                        bench_timer_t *timer)
+{
+  bgpstream_t *bs;
+  records_t r;
+  int i;
+  int rc = -1;
+
+  if ((bs = bgpstream_create()) == NULL) {
+    return -1;
+  }
+  if (bench->filter_value != NULL) {
+    bgpstream_add_filter(bs, bench->filter_type, bench->filter_value);
+  }
+  if (bgpstream_filter_mgr_validate(bs->filter_mgr) != 0 ||
+      records_load(&r, ctx->updates_path, bs) != 0) {
+    goto done;
+  }
+
+  /* every elem is checked against the filters */
+  timer_start(timer);
+  for (i = 0; i < r.cnt; i++) {
+    bgpstream_record_rewind_elems(r.records[i]);
+    while (bgpstream_record_get_next_elem(r.records[i]) != NULL)
+      ;
+  }
+  timer_stop(timer, r.elem_cnt);
+  rc = 0;
+
+  records_free(&r);
+done:
+  bgpstream_destroy(bs);
+  return rc;
+}
+
+static int bench_patricia_insert(bench_ctx_t *ctx, const bench_t *bench,
+                                 bench_timer_t *timer)
+{
+  bgpstream_patricia_tree_t *pt;
+  bgpstream_pfx_storage_t *pfxs;
+  int cnt = mrtgen_get_pfxs(ctx->gen, &pfxs);
+  int i;
+
+  if ((pt = bgpstream_patricia_tree_create(NULL)) == NULL) {
+    return -1;
+  }
+  timer_start(timer);
+  for (i = 0; i < cnt; i++) {
+    if (bgpstream_patricia_tree_insert(pt, (bgpstream_pfx_t *)&pfxs[i]) ==
+        NULL) {
+      bgpstream_patricia_tree_destroy(pt);
+      return -1;
+    }
+  }
+  timer_stop(timer, cnt);
+  bgpstream_patricia_tree_destroy(pt);
+  return 0;
+}
+
+static int bench_patricia_lookup(bench_ctx_t *ctx, const bench_t *bench,
+                                 bench_timer_t *timer)
+{
+  bgpstream_patricia_tree_t *pt;
+  bgpstream_pfx_storage_t *pfxs;
+  int cnt = mrtgen_get_pfxs(ctx->gen, &pfxs);
+  int found = 0;
+  int i;
+
+  if ((pt = bgpstream_patricia_tree_create(NULL)) == NULL) {
+    return -1;
+  }
+  /* insert every other prefix so that half of the lookups miss */
+  for (i = 0; i < cnt; i += 2) {
+    if (bgpstream_patricia_tree_insert(pt, (bgpstream_pfx_t *)&pfxs[i]) ==
+        NULL) {
+      bgpstream_patricia_tree_destroy(pt);
+      return -1;
+    }
+  }
+  timer_start(timer);
+  for (i = 0; i < cnt; i++) {
+    if (bgpstream_patricia_tree_search_exact(
+          pt, (bgpstream_pfx_t *)&pfxs[i]) != NULL) {
+      found++;
+    }
+  }
+  timer_stop(timer, cnt);
+  bgpstream_patricia_tree_destroy(pt);
+  return found > 0 ? 0 : -1;
+}
+
+static int bench_ip_counter_add(bench_ctx_t *ctx, const bench_t *bench,
+                                bench_timer_t *timer)
+{
+  bgpstream_ip_counter_t *ipc;
+  bgpstream_pfx_storage_t *pfxs;
+  int cnt = mrtgen_get_pfxs(ctx->gen, &pfxs);
+  int i;
+
+  if ((ipc = bgpstream_ip_counter_create()) == NULL) {
+    return -1;
+  }
+  timer_start(timer);
+  for (i = 0; i < cnt; i++) {
+    if (bgpstream_ip_counter_add(ipc, (bgpstream_pfx_t *)&pfxs[i]) != 0) {
+      bgpstream_ip_counter_destroy(ipc);
+      return -1;
+    }
+  }
+  timer_stop(timer, cnt);
+  bgpstream_ip_counter_destroy(ipc);
+  return 0;
+}
+
+static int bench_ip_counter_overlap(bench_ctx_t *ctx, const bench_t *bench,
+                                    bench_timer_t *timer)
+{
+  bgpstream_ip_counter_t *ipc;
+  bgpstream_pfx_storage_t *pfxs;
+  int cnt = mrtgen_get_pfxs(ctx->gen, &pfxs);
+  uint8_t more_specific;
+  uint64_t overlap = 0;
+  int i;
+
+  if ((ipc = bgpstream_ip_counter_create()) == NULL) {
+    return -1;
+  }
+  for (i = 0; i < cnt; i += 2) {
+    if (bgpstream_ip_counter_add(ipc, (bgpstream_pfx_t *)&pfxs[i]) != 0) {
+      bgpstream_ip_counter_destroy(ipc);
+      return -1;
+    }
+  }
+  timer_start(timer);
+  for (i = 0; i < cnt; i++) {
+    overlap += bgpstream_ip_counter_is_overlapping(
+      ipc, (bgpstream_pfx_t *)&pfxs[i], &more_specific);
+  }
+  timer_stop(timer, cnt);
+  bgpstream_ip_counter_destroy(ipc);
+  return overlap > 0 ? 0 : -1;
+}
+
+static int bench_as_path_store(bench_ctx_t *ctx, const bench_t *bench,
+                               bench_timer_t *timer)
+{
+  bgpstream_as_path_store_t *store = NULL;
+  bgpstream_as_path_store_path_id_t id;
+  bgpstream_elem_t *elem;
+  records_t r;
+  int i;
+  int rc = -1;
+
+  if (records_load(&r, ctx->rib_path, NULL) != 0) {
+    return -1;
+  }
+  if ((store = bgpstream_as_path_store_create()) == NULL) {
+    goto done;
+  }
+
+  timer_start(timer);
+  for (i = 0; i < r.cnt; i++) {
+    bgpstream_elem_generator_rewind(r.records[i]->elem_generator);
+    while ((elem = bgpstream_elem_generator_get_next_elem(
+              r.records[i]->elem_generator)) != NULL) {
+      if (bgpstream_as_path_store_get_path_id(store, elem->aspath,
+                                              elem->peer_asnumber, &id) != 0) {
+        goto done;
+      }
+    }
+  }
+  timer_stop(timer, r.elem_cnt);
+  rc = 0;
+
+done:
+  bgpstream_as_path_store_destroy(store);
+  records_free(&r);
+  return rc;
+}
+
+static int bench_elem_snprintf(bench_ctx_t *ctx, const bench_t *bench,
+                               bench_timer_t *timer)
+{
+  char buf[BUFFER_LEN];
+  bgpstream_elem_t *elem;
+  records_t r;
+  int i;
+
+  if (records_load(&r, ctx->updates_path, NULL) != 0) {
+    return -1;
+  }
+
+  timer_start(timer);
+  for (i = 0; i < r.cnt; i++) {
+    bgpstream_elem_generator_rewind(r.records[i]->elem_generator);
+    while ((elem = bgpstream_elem_generator_get_next_elem(
+              r.records[i]->elem_generator)) != NULL) {
+      if (bgpstream_elem_snprintf(buf, BUFFER_LEN, elem) == NULL) {
+        records_free(&r);
+        return -1;
+      }
+    }
+  }
+  timer_stop(timer, r.elem_cnt);
+
+  records_free(&r);
+  return 0;
+}
+
+#define FILTER_BENCH(name, type, value)                                        \
+  {                                                                            \
+    "filter/" name, bench_filter, BGPSTREAM_FILTER_TYPE_##type, value          \
+  }
+
+static const bench_t benches[] = {
+  {"read_next/rib", bench_read_next_rib},
+  {"read_next/updates", bench_read_next_updates},
+  {"populate/rib", bench_populate_rib},
+  {"populate/updates", bench_populate_updates},
+  FILTER_BENCH("none", ELEM_TYPE, NULL),
+  FILTER_BENCH("peer-asn", ELEM_PEER_ASN, "174"),
+  FILTER_BENCH("prefix-more", ELEM_PREFIX_MORE, "128.0.0.0/1"),
+  FILTER_BENCH("prefix-exact", ELEM_PREFIX_EXACT, "192.0.2.0/24"),
+  FILTER_BENCH("prefix-less", ELEM_PREFIX_LESS, "192.0.2.128/25"),
+  FILTER_BENCH("prefix-any", ELEM_PREFIX_ANY, "10.0.0.0/8"),
+  FILTER_BENCH("community", ELEM_COMMUNITY, "*:100"),
+  FILTER_BENCH("aspath", ELEM_ASPATH, "_174_"),
+  FILTER_BENCH("ipversion", ELEM_IP_VERSION, "6"),
+  FILTER_BENCH("elemtype", ELEM_TYPE, "withdrawals"),
+  {"patricia/insert", bench_patricia_insert},
+  {"patricia/lookup", bench_patricia_lookup},
+  {"ip_counter/add", bench_ip_counter_add},
+  {"ip_counter/overlap", bench_ip_counter_overlap},
+  {"as_path_store/get_path_id", bench_as_path_store},
+  {"elem/snprintf", bench_elem_snprintf},
+};
+
+#define BENCH_CNT (sizeof(benches) / sizeof(bench_t))
+
+/* run a benchmark several times and report the fastest run */
+static int run_bench(bench_ctx_t *ctx, const bench_t *bench, int repeats)
+{
+  bench_timer_t timer, best;
+  int i;
+
+  memset(&best, 0, sizeof(best));
+  for (i = 0; i < repeats; i++) {
+    memset(&timer, 0, sizeof(timer));
+    if (bench->func(ctx, bench, &timer) != 0) {
+      fprintf(stderr, "ERROR: Benchmark %s failed\n", bench->name);
+      return -1;
+    }
+    if (i == 0 || timer.ns * best.ops < best.ns * timer.ops) {
+      best = timer;
+    }
+  }
+
+  if (best.ops == 0) {
+    fprintf(stderr, "ERROR: Benchmark %s did nothing\n", bench->name);
+    return -1;
+  }
+
+#ifdef HAVE_ALLOC_CNT
+  printf("%-28s %10" PRIu64 " %12.1f %12.2f\n", bench->name, best.ops,
+         (double)best.ns / best.ops, (double)best.allocs / best.ops);
+#else
+  printf("%-28s %10" PRIu64 " %12.1f %12s\n", bench->name, best.ops,
+         (double)best.ns / best.ops, "-");
+#endif
+  return 0;
+}
+
+static void usage()
+{
+  fprintf(
+    stderr,
+    "usage: " NAME " [<options>]\n"
+    "Available options are:\n"
+    "   -b <name>      only run benchmarks whose name contains <name>\n"
+    "   -s <scale>     size of the generated dumps, in thousands of prefixes\n"
+    "                  and update messages (default: %d)\n"
+    "   -p <peers>     number of peers in the generated dumps (default: %d)\n"
+    "   -r <repeats>   run each benchmark <repeats> times and report the\n"
+    "                  fastest run (default: %d)\n"
+    "   -S <seed>      seed for the dump generator (default: %d)\n"
+    "   -h             print this help menu\n",
+    DEFAULT_SCALE, 8, DEFAULT_REPEATS, 1);
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  const char *name_filter = NULL;
+  int scale = DEFAULT_SCALE;
+  int repeats = DEFAULT_REPEATS;
+  mrtgen_config_t cfg;
+  bench_ctx_t ctx;
+  char dir[] = "/tmp/" NAME ".XXXXXX";
+  unsigned int i;
+  int rc = -1;
+
+  memset(&ctx, 0, sizeof(ctx));
+  mrtgen_config_init(&cfg);
+
+  while ((opt = getopt(argc, argv, "b:s:p:r:S:h?")) >= 0) {
+    switch (opt) {
+    case 'b':
+      name_filter = optarg;
+      break;
+    case 's':
+      scale = atoi(optarg);
+      break;
+    case 'p':
+      cfg.peer_cnt = atoi(optarg);
+      break;
+    case 'r':
+      repeats = atoi(optarg);
+      break;
+    case 'S':
+      cfg.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'h':
+    case '?':
+    default:
+      usage();
+      return -1;
+    }
+  }
+
+  if (scale < 1 || repeats < 1) {
+    usage();
+    return -1;
+  }
+
+  /* 90% of the prefixes are IPv4, as in a full table */
+  cfg.v4_pfx_cnt = scale * 900;
+  cfg.v6_pfx_cnt = scale * 100;
+  cfg.update_cnt = scale * 1000;
+
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr, "ERROR: Could not create temporary directory\n");
+    return -1;
+  }
+  snprintf(ctx.rib_path, BUFFER_LEN, "%s/rib.mrt", dir);
+  snprintf(ctx.updates_path, BUFFER_LEN, "%s/updates.mrt", dir);
+
+  fprintf(stderr, "INFO: Generating dumps with %d peers, %d prefixes and %d "
+                  "update messages in %s\n",
+          cfg.peer_cnt, cfg.v4_pfx_cnt + cfg.v6_pfx_cnt, cfg.update_cnt, dir);
+  if ((ctx.gen = mrtgen_create(&cfg)) == NULL ||
+      mrtgen_write_rib(ctx.gen, ctx.rib_path, DUMP_TIME) != 0 ||
+      mrtgen_write_updates(ctx.gen, ctx.updates_path, DUMP_TIME,
+                           DUMP_DURATION) != 0) {
+    fprintf(stderr, "ERROR: Could not generate dumps\n");
+    goto done;
+  }
+
+  printf("%-28s %10s %12s %12s\n", "benchmark", "ops", "ns/op", "allocs/op");
+  for (i = 0; i < BENCH_CNT; i++) {
+    if (name_filter != NULL && strstr(benches[i].name, name_filter) == NULL) {
+      continue;
+    }
+    if (run_bench(&ctx, &benches[i], repeats) != 0) {
+      goto done;
+    }
+  }
+  rc = 0;
+
+done:
+  mrtgen_destroy(ctx.gen);
+  unlink(ctx.rib_path);
+  unlink(ctx.updates_path);
+  rmdir(dir);
+  return rc;
+}
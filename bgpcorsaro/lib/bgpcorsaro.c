@@ -28,8 +28,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bgpcorsaro_checkpoint.h"
+#include "bgpcorsaro_elems.h"
 #include "bgpcorsaro_io.h"
 #include "bgpcorsaro_log.h"
+#include "bgpcorsaro_threads.h"
 #include "utils.h"
 #include "wandio_utils.h"
 
@@ -88,6 +91,12 @@ static void bgpcorsaro_free(bgpcorsaro_t *bgpcorsaro)
     return;
   }
 
+  /* wait for the plugin threads to finish up before closing the plugins */
+  if (bgpcorsaro->threads != NULL) {
+    bgpcorsaro_threads_stop(bgpcorsaro->threads);
+    bgpcorsaro->threads = NULL;
+  }
+
   /* free up the plugins first, they may try and use some of our info before
      closing */
   if (bgpcorsaro->plugin_manager != NULL) {
@@ -110,11 +119,19 @@ static void bgpcorsaro_free(bgpcorsaro_t *bgpcorsaro)
     bgpcorsaro->template = NULL;
   }
 
+  if (bgpcorsaro->checkpoint_file != NULL) {
+    free(bgpcorsaro->checkpoint_file);
+    bgpcorsaro->checkpoint_file = NULL;
+  }
+
   if (bgpcorsaro->record != NULL) {
     bgpcorsaro_record_free(bgpcorsaro->record);
     bgpcorsaro->record = NULL;
   }
 
+  bgpcorsaro_elems_destroy(bgpcorsaro->elems);
+  bgpcorsaro->elems = NULL;
+
   /* close this as late as possible */
   bgpcorsaro_log_close(bgpcorsaro);
 
@@ -188,6 +205,12 @@ static bgpcorsaro_t *bgpcorsaro_init(char *template)
     goto err;
   }
 
+  if ((e->elems = bgpcorsaro_elems_create()) == NULL) {
+    bgpcorsaro_log(__func__, e, "could not create elem list");
+    goto err;
+  }
+  e->record->elems = e->elems;
+
   /* ask the plugin manager to get us some plugins */
   /* this will init all compiled plugins but not start them, this gives
      us a chance to wait for the user to choose a subset to enable
@@ -256,6 +279,15 @@ static int start_interval(bgpcorsaro_t *bgpcorsaro, long int_start)
 
   /* ask each plugin to start a new interval */
   /* plugins should rotate their files now too */
+  if (bgpcorsaro->threads != NULL) {
+    if (bgpcorsaro_threads_start_interval(bgpcorsaro->threads,
+                                          &bgpcorsaro->interval_start) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "failed to start interval at %ld",
+                     int_start);
+      return -1;
+    }
+    return 0;
+  }
   while ((tmp = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, tmp)) !=
          NULL) {
 #ifdef WITH_PLUGIN_TIMING
@@ -284,20 +316,30 @@ static int end_interval(bgpcorsaro_t *bgpcorsaro, long int_end)
   populate_interval(&interval_end, bgpcorsaro->interval_start.number, int_end);
 
   /* ask each plugin to end the current interval */
-  while ((tmp = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, tmp)) !=
-         NULL) {
-#ifdef WITH_PLUGIN_TIMING
-    TIMER_START(end_interval);
-#endif
-    if (tmp->end_interval(bgpcorsaro, &interval_end) != 0) {
-      bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to end interval at %ld",
-                     tmp->name, int_end);
+  if (bgpcorsaro->threads != NULL) {
+    /* this waits for all of the plugin threads to end the interval */
+    if (bgpcorsaro_threads_end_interval(bgpcorsaro->threads, &interval_end) !=
+        0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "failed to end interval at %ld",
+                     int_end);
       return -1;
     }
+  } else {
+    while ((tmp = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, tmp)) !=
+           NULL) {
+#ifdef WITH_PLUGIN_TIMING
+      TIMER_START(end_interval);
+#endif
+      if (tmp->end_interval(bgpcorsaro, &interval_end) != 0) {
+        bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to end interval at %ld",
+                       tmp->name, int_end);
+        return -1;
+      }
 #ifdef WITH_PLUGIN_TIMING
-    TIMER_END(end_interval);
-    tmp->end_interval_usec += TIMER_VAL(end_interval);
+      TIMER_END(end_interval);
+      tmp->end_interval_usec += TIMER_VAL(end_interval);
 #endif
+    }
   }
 
   /* if we are rotating, now is the time to close our output files */
@@ -314,17 +356,78 @@ static int end_interval(bgpcorsaro_t *bgpcorsaro, long int_end)
   return 0;
 }
 
+/** Checkpoint the plugin state if this is a checkpoint interval */
+static void checkpoint_interval(bgpcorsaro_t *bgpcorsaro)
+{
+  bgpcorsaro_checkpoint_pos_t pos;
+
+  if (bgpcorsaro->checkpoint_file == NULL ||
+      (bgpcorsaro->interval_start.number + 1) %
+          bgpcorsaro->checkpoint_intervals !=
+        0) {
+    return;
+  }
+
+  /* the plugins (and their threads) are all idle now that the interval has
+     ended, so their state is consistent */
+  pos.interval = bgpcorsaro->interval;
+  pos.interval_number = bgpcorsaro->interval_start.number + 1;
+  pos.resume_time = bgpcorsaro->next_report;
+
+  /* losing a checkpoint only makes the next restart slower, so carry on */
+  if (bgpcorsaro_checkpoint_save(bgpcorsaro, bgpcorsaro->checkpoint_file,
+                                 &pos) != 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not write checkpoint to %s",
+                   bgpcorsaro->checkpoint_file);
+  }
+}
+
+/** Add the plugin timing to a metrics report (run in the metrics thread) */
+static void write_plugin_metrics(bgpstream_metrics_t *metrics, void *user)
+{
+  bgpcorsaro_t *bgpcorsaro = (bgpcorsaro_t *)user;
+  bgpcorsaro_plugin_t *p = NULL;
+  uint64_t ns;
+
+  while ((p = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, p)) != NULL) {
+    ns = __atomic_load_n(&p->process_record_ns, __ATOMIC_RELAXED);
+    bgpstream_metrics_write(metrics, "plugin_seconds_total", "plugin", p->name,
+                            BGPSTREAM_METRICS_TYPE_COUNTER, ns / 1e9);
+  }
+}
+
 /** Process the given bgpcorsaro record */
 static inline int process_record(bgpcorsaro_t *bgpcorsaro,
                                  bgpcorsaro_record_t *record)
 {
   bgpcorsaro_plugin_t *tmp = NULL;
+
+  /* hand the record off to the plugin threads */
+  if (bgpcorsaro->threads != NULL) {
+    if (bgpcorsaro_threads_process_record(bgpcorsaro->threads,
+                                          BS_REC(record)) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "a plugin failed to process a "
+                                           "record");
+      return -1;
+    }
+    return 0;
+  }
+
+  /* generate the elems once, and share them between the plugins */
+  if (bgpcorsaro_elems_populate(bgpcorsaro->elems, BS_REC(record)) != 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not generate elems");
+    return -1;
+  }
+
   while ((tmp = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, tmp)) !=
          NULL) {
+    /* each plugin starts from the first elem */
+    record->elems_iter = 0;
+    bgpstream_record_rewind_elems(BS_REC(record));
 #ifdef WITH_PLUGIN_TIMING
     TIMER_START(process_record);
 #endif
-    if (tmp->process_record(bgpcorsaro, record) < 0) {
+    if (bgpcorsaro_plugin_process_record(bgpcorsaro, tmp, record) < 0) {
       bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to process record",
                      tmp->name);
       return -1;
@@ -409,6 +512,43 @@ int bgpcorsaro_start_output(bgpcorsaro_t *bgpcorsaro)
 #endif
   }
 
+  /* restore the plugin state before any records are processed */
+  if (bgpcorsaro->checkpoint_file != NULL) {
+    bgpcorsaro_checkpoint_pos_t pos;
+    int rc;
+    if ((rc = bgpcorsaro_checkpoint_load(
+           bgpcorsaro, bgpcorsaro->checkpoint_file, &pos)) < 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not restore checkpoint %s",
+                     bgpcorsaro->checkpoint_file);
+      return -1;
+    }
+    if (rc == 0) {
+      if ((int)pos.interval != bgpcorsaro->interval) {
+        bgpcorsaro_log(__func__, bgpcorsaro,
+                       "checkpoint interval (%" PRIu32 ") does not match the "
+                       "current interval (%d)",
+                       pos.interval, bgpcorsaro->interval);
+        return -1;
+      }
+      bgpcorsaro->interval_start.number = pos.interval_number;
+      bgpcorsaro->resume_time = pos.resume_time;
+      bgpcorsaro_log(__func__, bgpcorsaro,
+                     "restored checkpoint, resuming at %" PRIu32,
+                     pos.resume_time);
+    } else {
+      bgpcorsaro_log(__func__, bgpcorsaro,
+                     "no checkpoint found at %s, starting without state",
+                     bgpcorsaro->checkpoint_file);
+    }
+  }
+
+  /* the plugins are ready to go, so start their threads */
+  if (bgpcorsaro->threaded != 0 &&
+      (bgpcorsaro->threads = bgpcorsaro_threads_start(bgpcorsaro)) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not start plugin threads");
+    return -1;
+  }
+
   bgpcorsaro->started = 1;
 
   return 0;
@@ -462,6 +602,72 @@ void bgpcorsaro_set_output_rotation(bgpcorsaro_t *bgpcorsaro, int intervals)
   bgpcorsaro->output_rotate = intervals;
 }
 
+void bgpcorsaro_enable_threads(bgpcorsaro_t *bgpcorsaro)
+{
+  assert(bgpcorsaro != NULL);
+  /* you can't enable threads once bgpcorsaro has been started */
+  assert(bgpcorsaro->started == 0);
+
+  bgpcorsaro_log(__func__, bgpcorsaro, "enabling plugin threads");
+
+  bgpcorsaro->threaded = 1;
+}
+
+void bgpcorsaro_set_metrics(bgpcorsaro_t *bgpcorsaro,
+                            bgpstream_metrics_t *metrics)
+{
+  assert(bgpcorsaro != NULL);
+
+  bgpcorsaro_log(__func__, bgpcorsaro, "enabling plugin metrics");
+
+  bgpcorsaro->metrics = metrics;
+  bgpstream_metrics_set_callback(metrics, write_plugin_metrics, bgpcorsaro);
+}
+
+int bgpcorsaro_set_checkpoint(bgpcorsaro_t *bgpcorsaro, const char *path,
+                              int intervals)
+{
+  assert(bgpcorsaro != NULL);
+  /* you can't enable checkpoints once bgpcorsaro has been started */
+  assert(bgpcorsaro->started == 0);
+
+  if (intervals <= 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro,
+                   "checkpoint frequency must be at least 1 interval");
+    return -1;
+  }
+
+  bgpcorsaro_log(__func__, bgpcorsaro,
+                 "checkpointing to %s after %d interval(s)", path, intervals);
+
+  free(bgpcorsaro->checkpoint_file);
+  if ((bgpcorsaro->checkpoint_file = strdup(path)) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro,
+                   "could not duplicate checkpoint file string");
+    return -1;
+  }
+  bgpcorsaro->checkpoint_intervals = intervals;
+  return 0;
+}
+
+uint32_t bgpcorsaro_get_resume_time(bgpcorsaro_t *bgpcorsaro)
+{
+  assert(bgpcorsaro != NULL);
+  return bgpcorsaro->resume_time;
+}
+
+int bgpcorsaro_clip_window(uint32_t resume_time, uint32_t *start,
+                           uint32_t end)
+{
+  if (end != BGPSTREAM_FOREVER && end < resume_time) {
+    return 0;
+  }
+  if (*start < resume_time) {
+    *start = resume_time;
+  }
+  return 1;
+}
+
 void bgpcorsaro_set_meta_output_rotation(bgpcorsaro_t *bgpcorsaro,
                                          int intervals)
 {
@@ -605,12 +811,19 @@ int bgpcorsaro_per_record(bgpcorsaro_t *bgpcorsaro,
 {
   long ts;
   long report;
+  long first_start;
 
   assert(bgpcorsaro != NULL);
   assert(bgpcorsaro->started == 1 &&
          "bgpcorsaro_start_output must be called before records can be "
          "processed");
 
+  /* the effect of records before the resume time is already in the state
+     that the plugins restored */
+  if (bsrecord->attributes.record_time < bgpcorsaro->resume_time) {
+    return 0;
+  }
+
   /* poke this bsrecord into our bgpcorsaro record */
   bgpcorsaro->record->bsrecord = bsrecord;
 
@@ -629,16 +842,20 @@ int bgpcorsaro_per_record(bgpcorsaro_t *bgpcorsaro,
   /* if this is the first record we record, keep the timestamp */
   if (bgpcorsaro->record_cnt == 0) {
     bgpcorsaro->first_ts = ts;
-    if (start_interval(bgpcorsaro, ts) != 0) {
+    /* after a restore, carry on with the interval after the checkpoint */
+    first_start = bgpcorsaro->resume_time != 0 ? bgpcorsaro->resume_time : ts;
+    if (start_interval(bgpcorsaro, first_start) != 0) {
       bgpcorsaro_log(__func__, bgpcorsaro, "could not start interval at %ld",
-                     ts);
+                     first_start);
       return -1;
     }
 
-    bgpcorsaro->next_report = ts + bgpcorsaro->interval;
+    bgpcorsaro->next_report = first_start + bgpcorsaro->interval;
 
-    /* if we are aligning our intervals, truncate the end down */
-    if (bgpcorsaro->interval_align == BGPCORSARO_INTERVAL_ALIGN_YES) {
+    /* if we are aligning our intervals, truncate the end down (restored
+       intervals are already aligned) */
+    if (bgpcorsaro->interval_align == BGPCORSARO_INTERVAL_ALIGN_YES &&
+        bgpcorsaro->resume_time == 0) {
       bgpcorsaro->next_report =
         (bgpcorsaro->next_report / bgpcorsaro->interval) * bgpcorsaro->interval;
     }
@@ -659,6 +876,8 @@ int bgpcorsaro_per_record(bgpcorsaro_t *bgpcorsaro,
       return -1;
     }
 
+    checkpoint_interval(bgpcorsaro);
+
     bgpcorsaro->interval_start.number++;
 
     /* we now add the second back on to the time to get the start time */
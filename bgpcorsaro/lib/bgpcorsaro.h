@@ -25,6 +25,7 @@
 #define __BGPCORSARO_H
 
 #include "bgpstream.h"
+#include "bgpstream_metrics.h"
 #include "wandio.h"
 
 /** @file
@@ -151,6 +152,62 @@ void bgpcorsaro_set_interval(bgpcorsaro_t *bgpcorsaro, unsigned int interval);
  */
 void bgpcorsaro_set_output_rotation(bgpcorsaro_t *bgpcorsaro, int intervals);
 
+/** Accessor function to run each plugin in its own thread
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to enable threads for
+ *
+ * When threads are enabled, bgpcorsaro_per_record hands records off to a
+ * queue which is shared by all plugins, and returns without waiting for them
+ * to be processed. Each plugin processes records (and interval boundaries) in
+ * the same order as without threads, but plugins do not see each other's
+ * record state. This must be called before bgpcorsaro_start_output.
+ */
+void bgpcorsaro_enable_threads(bgpcorsaro_t *bgpcorsaro);
+
+/** Accessor function to report plugin metrics
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to report metrics for
+ * @param metrics       The metrics emitter to add plugin metrics to
+ *
+ * Once set, the time that each plugin spends processing records is measured,
+ * and added to every report written by the emitter (as plugin_seconds_total,
+ * labelled by plugin name). This must be called before the emitter is
+ * started, and the emitter must be destroyed before
+ * bgpcorsaro_finalize_output is called.
+ */
+void bgpcorsaro_set_metrics(bgpcorsaro_t *bgpcorsaro,
+                            bgpstream_metrics_t *metrics);
+
+/** Accessor function to enable checkpointing of plugin state
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to enable checkpoints for
+ * @param path          Path of the checkpoint file
+ * @param intervals     The number of intervals after which the state will be
+ *                      checkpointed
+ * @return 0 if checkpointing was enabled, -1 if an error occurs
+ *
+ * At the end of every n intervals, the state of each plugin is written to the
+ * given file. If the file already exists when bgpcorsaro_start_output is
+ * called, the plugins restore their state from it, and processing resumes
+ * at the start of the interval that follows the checkpoint (see
+ * bgpcorsaro_get_resume_time). This must be called before
+ * bgpcorsaro_start_output.
+ */
+int bgpcorsaro_set_checkpoint(bgpcorsaro_t *bgpcorsaro, const char *path,
+                              int intervals);
+
+/** Get the time at which processing resumes after a restore
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to get the resume time for
+ * @return the start time of the first interval after the checkpoint that the
+ * plugin state was restored from, 0 if state was not restored
+ *
+ * Records with a time before the resume time are ignored by
+ * bgpcorsaro_per_record, so the stream should be configured to start at this
+ * time. This is only valid after bgpcorsaro_start_output has been called.
+ */
+uint32_t bgpcorsaro_get_resume_time(bgpcorsaro_t *bgpcorsaro);
+
 /** Accessor function to set the rotation frequency of meta output files
  *
  * @param bgpcorsaro    The bgpcorsaro object to set the rotation for
@@ -251,9 +308,25 @@ const char *bgpcorsaro_get_monitorname(bgpcorsaro_t *bgpcorsaro);
  * current interval, if not, it will write out data for the previous interval.
  * The record is then handed to each plugin which processes it and updates
  * internal state.
+ *
+ * If threads are enabled (see bgpcorsaro_enable_threads), the data is moved out
+ * of the given record (leaving it empty) and processed asynchronously, so the
+ * stream that the record came from must not be destroyed until
+ * bgpcorsaro_finalize_output has returned.
  */
 int bgpcorsaro_per_record(bgpcorsaro_t *bgpcorsaro, bgpstream_record_t *record);
 
+/** Retrieve the next elem from the given bgpcorsaro record
+ *
+ * @param record        The bgpcorsaro record passed to the plugin
+ * @return borrowed pointer to the next elem, NULL if there are no more elems
+ *
+ * The elems of each record are generated only once and are shared by all
+ * plugins, so the returned elem must not be modified. Each plugin has its own
+ * position in the list, which starts at the first elem for every record.
+ */
+bgpstream_elem_t *bgpcorsaro_record_get_next_elem(bgpcorsaro_record_t *record);
+
 /** Write the final interval and free resources allocated by bgpcorsaro
  *
  * @param bgpcorsaro    The bgpcorsaro object to finalize
@@ -0,0 +1,547 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpcorsaro_int.h"
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "wandio_utils.h"
+
+#include "bgpcorsaro_checkpoint.h"
+#include "bgpcorsaro_log.h"
+
+/** @file
+ *
+ * @brief Code which implements bgpcorsaro checkpoint files
+ *
+ * A checkpoint file starts with a header:
+ *  - magic number (8 bytes)
+ *  - format version (4 bytes)
+ *  - interval length (4 bytes)
+ *  - next interval number (2 bytes)
+ *  - resume time (4 bytes)
+ *
+ * followed by one section per plugin:
+ *  - plugin name (1 byte length, followed by the name)
+ *  - any number of chunks of plugin state (4 byte length, followed by data)
+ *  - a zero-length chunk
+ *
+ * and finally a section with an empty name. Chunks allow the state of a
+ * plugin to be skipped without knowing its format, while still letting
+ * plugins stream their state out without first working out its size.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Magic number at the start of each checkpoint file */
+#define CHECKPOINT_MAGIC "BGPCCKPT"
+
+/** Length of the magic number */
+#define CHECKPOINT_MAGIC_LEN 8
+
+/** Version of the checkpoint format */
+#define CHECKPOINT_FORMAT_VERSION 1
+
+/** Maximum size of a chunk of plugin state */
+#define CHUNK_LEN 65536
+
+/** Suffix of the temporary file that a checkpoint is written to */
+#define TMP_SUFFIX ".tmp"
+
+struct bgpcorsaro_checkpoint {
+  /** The bgpcorsaro object being checkpointed */
+  bgpcorsaro_t *bgpcorsaro;
+
+  /** The file being written (NULL if reading) */
+  iow_t *outfile;
+
+  /** The file being read (NULL if writing) */
+  io_t *infile;
+
+  /** The current chunk */
+  uint8_t buf[CHUNK_LEN];
+
+  /** Number of bytes in the current chunk */
+  uint32_t buf_len;
+
+  /** Read position in the current chunk */
+  uint32_t buf_pos;
+
+  /** Has the end of the current section been read? */
+  int section_end;
+};
+
+/* ========== FILE I/O ========== */
+
+static int file_write(bgpcorsaro_checkpoint_t *cp, const void *buf, size_t len)
+{
+  if (wandio_wwrite(cp->outfile, buf, len) != (int64_t)len) {
+    bgpcorsaro_log(__func__, cp->bgpcorsaro, "could not write checkpoint");
+    return -1;
+  }
+  return 0;
+}
+
+static int file_read(bgpcorsaro_checkpoint_t *cp, void *buf, size_t len)
+{
+  if (wandio_read(cp->infile, buf, len) != (int64_t)len) {
+    bgpcorsaro_log(__func__, cp->bgpcorsaro, "truncated checkpoint");
+    return -1;
+  }
+  return 0;
+}
+
+static int file_write_u32(bgpcorsaro_checkpoint_t *cp, uint32_t val)
+{
+  val = htonl(val);
+  return file_write(cp, &val, sizeof(val));
+}
+
+static int file_read_u32(bgpcorsaro_checkpoint_t *cp, uint32_t *val)
+{
+  if (file_read(cp, val, sizeof(*val)) != 0) {
+    return -1;
+  }
+  *val = ntohl(*val);
+  return 0;
+}
+
+/** Write a section (or end-of-file) header */
+static int file_write_name(bgpcorsaro_checkpoint_t *cp, const char *name)
+{
+  uint8_t len = strlen(name);
+  return file_write(cp, &len, sizeof(len)) || file_write(cp, name, len) ? -1
+                                                                        : 0;
+}
+
+static int file_read_name(bgpcorsaro_checkpoint_t *cp, char *name)
+{
+  uint8_t len;
+
+  if (file_read(cp, &len, sizeof(len)) != 0 || file_read(cp, name, len) != 0) {
+    return -1;
+  }
+  name[len] = '\0';
+  return 0;
+}
+
+/* ========== CHUNKS ========== */
+
+static int chunk_flush(bgpcorsaro_checkpoint_t *cp)
+{
+  if (cp->buf_len == 0) {
+    return 0;
+  }
+  if (file_write_u32(cp, cp->buf_len) != 0 ||
+      file_write(cp, cp->buf, cp->buf_len) != 0) {
+    return -1;
+  }
+  cp->buf_len = 0;
+  return 0;
+}
+
+/** Read the next chunk of the current section */
+static int chunk_next(bgpcorsaro_checkpoint_t *cp)
+{
+  uint32_t len;
+
+  if (cp->section_end != 0 || file_read_u32(cp, &len) != 0) {
+    return -1;
+  }
+  if (len == 0) {
+    cp->section_end = 1;
+    return -1;
+  }
+  if (len > CHUNK_LEN) {
+    bgpcorsaro_log(__func__, cp->bgpcorsaro, "corrupt checkpoint chunk");
+    return -1;
+  }
+  cp->buf_len = len;
+  cp->buf_pos = 0;
+  return file_read(cp, cp->buf, len);
+}
+
+static int section_end_write(bgpcorsaro_checkpoint_t *cp)
+{
+  return chunk_flush(cp) || file_write_u32(cp, 0) ? -1 : 0;
+}
+
+/** Skip whatever is left of the current section */
+static int section_skip(bgpcorsaro_checkpoint_t *cp)
+{
+  while (cp->section_end == 0) {
+    if (chunk_next(cp) != 0 && cp->section_end == 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* ========== CHECKPOINT FILES ========== */
+
+int bgpcorsaro_checkpoint_save(bgpcorsaro_t *bgpcorsaro, const char *path,
+                               bgpcorsaro_checkpoint_pos_t *pos)
+{
+  bgpcorsaro_checkpoint_t *cp = NULL;
+  bgpcorsaro_plugin_t *p = NULL;
+  char *tmp_path = NULL;
+  uint16_t number;
+
+  if ((cp = malloc_zero(sizeof(bgpcorsaro_checkpoint_t))) == NULL ||
+      (tmp_path = malloc(strlen(path) + sizeof(TMP_SUFFIX))) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not malloc checkpoint state");
+    goto err;
+  }
+  cp->bgpcorsaro = bgpcorsaro;
+  strcpy(tmp_path, path);
+  strcat(tmp_path, TMP_SUFFIX);
+
+  if ((cp->outfile = wandio_wcreate(
+         tmp_path, wandio_detect_compression_type(path),
+         bgpcorsaro->compress_level, O_CREAT)) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not open %s for writing",
+                   tmp_path);
+    goto err;
+  }
+
+  number = htons(pos->interval_number);
+  if (file_write(cp, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) != 0 ||
+      file_write_u32(cp, CHECKPOINT_FORMAT_VERSION) != 0 ||
+      file_write_u32(cp, pos->interval) != 0 ||
+      file_write(cp, &number, sizeof(number)) != 0 ||
+      file_write_u32(cp, pos->resume_time) != 0) {
+    goto err;
+  }
+
+  while ((p = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, p)) != NULL) {
+    if (file_write_name(cp, p->name) != 0) {
+      goto err;
+    }
+    if (p->checkpoint(bgpcorsaro, cp) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to write its state",
+                     p->name);
+      goto err;
+    }
+    if (section_end_write(cp) != 0) {
+      goto err;
+    }
+  }
+  if (file_write_name(cp, "") != 0) {
+    goto err;
+  }
+
+  /* make sure the data is all out before replacing the old checkpoint */
+  wandio_wdestroy(cp->outfile);
+  cp->outfile = NULL;
+
+  if (rename(tmp_path, path) != 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not rename %s to %s: %s",
+                   tmp_path, path, strerror(errno));
+    goto err;
+  }
+
+  free(tmp_path);
+  free(cp);
+  return 0;
+
+err:
+  if (cp != NULL && cp->outfile != NULL) {
+    wandio_wdestroy(cp->outfile);
+  }
+  if (tmp_path != NULL) {
+    unlink(tmp_path);
+  }
+  free(tmp_path);
+  free(cp);
+  return -1;
+}
+
+int bgpcorsaro_checkpoint_load(bgpcorsaro_t *bgpcorsaro, const char *path,
+                               bgpcorsaro_checkpoint_pos_t *pos)
+{
+  bgpcorsaro_checkpoint_t *cp = NULL;
+  bgpcorsaro_plugin_t *p = NULL;
+  char magic[CHECKPOINT_MAGIC_LEN];
+  char name[UINT8_MAX + 1];
+  uint32_t version;
+  uint16_t number;
+  struct stat st;
+
+  if (stat(path, &st) != 0 && errno == ENOENT) {
+    return 1;
+  }
+
+  if ((cp = malloc_zero(sizeof(bgpcorsaro_checkpoint_t))) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not malloc checkpoint state");
+    goto err;
+  }
+  cp->bgpcorsaro = bgpcorsaro;
+
+  if ((cp->infile = wandio_create(path)) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not open %s for reading",
+                   path);
+    goto err;
+  }
+
+  if (file_read(cp, magic, CHECKPOINT_MAGIC_LEN) != 0 ||
+      memcmp(magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) != 0 ||
+      file_read_u32(cp, &version) != 0 ||
+      version != CHECKPOINT_FORMAT_VERSION) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "%s is not a (supported) checkpoint",
+                   path);
+    goto err;
+  }
+  if (file_read_u32(cp, &pos->interval) != 0 ||
+      file_read(cp, &number, sizeof(number)) != 0 ||
+      file_read_u32(cp, &pos->resume_time) != 0) {
+    goto err;
+  }
+  pos->interval_number = ntohs(number);
+
+  while (1) {
+    if (file_read_name(cp, name) != 0) {
+      goto err;
+    }
+    if (name[0] == '\0') {
+      break;
+    }
+    cp->buf_len = cp->buf_pos = 0;
+    cp->section_end = 0;
+
+    if ((p = bgpcorsaro_plugin_get_by_name(bgpcorsaro->plugin_manager,
+                                           name)) == NULL) {
+      bgpcorsaro_log(__func__, bgpcorsaro,
+                     "skipping checkpoint state for disabled plugin %s", name);
+    } else {
+      bgpcorsaro_log(__func__, bgpcorsaro, "restoring state for %s", name);
+      if (p->restore(bgpcorsaro, cp) != 0) {
+        bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to restore its state",
+                       name);
+        goto err;
+      }
+    }
+    if (section_skip(cp) != 0) {
+      goto err;
+    }
+  }
+
+  wandio_destroy(cp->infile);
+  free(cp);
+  return 0;
+
+err:
+  if (cp != NULL && cp->infile != NULL) {
+    wandio_destroy(cp->infile);
+  }
+  free(cp);
+  return -1;
+}
+
+/* ========== PLUGIN STATE ========== */
+
+int bgpcorsaro_checkpoint_write_bytes(bgpcorsaro_checkpoint_t *cp,
+                                      const void *buf, size_t len)
+{
+  const uint8_t *ptr = buf;
+  size_t n;
+
+  assert(cp->outfile != NULL);
+
+  while (len > 0) {
+    if (cp->buf_len == CHUNK_LEN && chunk_flush(cp) != 0) {
+      return -1;
+    }
+    n = CHUNK_LEN - cp->buf_len;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(cp->buf + cp->buf_len, ptr, n);
+    cp->buf_len += n;
+    ptr += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int bgpcorsaro_checkpoint_write_u8(bgpcorsaro_checkpoint_t *cp, uint8_t val)
+{
+  return bgpcorsaro_checkpoint_write_bytes(cp, &val, sizeof(val));
+}
+
+int bgpcorsaro_checkpoint_write_u16(bgpcorsaro_checkpoint_t *cp, uint16_t val)
+{
+  val = htons(val);
+  return bgpcorsaro_checkpoint_write_bytes(cp, &val, sizeof(val));
+}
+
+int bgpcorsaro_checkpoint_write_u32(bgpcorsaro_checkpoint_t *cp, uint32_t val)
+{
+  val = htonl(val);
+  return bgpcorsaro_checkpoint_write_bytes(cp, &val, sizeof(val));
+}
+
+int bgpcorsaro_checkpoint_write_str(bgpcorsaro_checkpoint_t *cp,
+                                    const char *str)
+{
+  size_t len = strlen(str);
+
+  if (len > UINT8_MAX) {
+    return -1;
+  }
+  return bgpcorsaro_checkpoint_write_u8(cp, len) ||
+             bgpcorsaro_checkpoint_write_bytes(cp, str, len)
+           ? -1
+           : 0;
+}
+
+int bgpcorsaro_checkpoint_write_addr(bgpcorsaro_checkpoint_t *cp,
+                                     const bgpstream_addr_storage_t *addr)
+{
+  /* the values of the version enum are platform-specific */
+  if (bgpcorsaro_checkpoint_write_u8(cp, bgpstream_ipv2idx(addr->version)) !=
+      0) {
+    return -1;
+  }
+  if (addr->version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    return bgpcorsaro_checkpoint_write_bytes(cp, &addr->ipv4,
+                                             sizeof(addr->ipv4));
+  }
+  return bgpcorsaro_checkpoint_write_bytes(cp, &addr->ipv6,
+                                           sizeof(addr->ipv6));
+}
+
+int bgpcorsaro_checkpoint_write_pfx(bgpcorsaro_checkpoint_t *cp,
+                                    const bgpstream_pfx_storage_t *pfx)
+{
+  return bgpcorsaro_checkpoint_write_u8(cp, pfx->mask_len) ||
+             bgpcorsaro_checkpoint_write_addr(cp, &pfx->address)
+           ? -1
+           : 0;
+}
+
+int bgpcorsaro_checkpoint_read_bytes(bgpcorsaro_checkpoint_t *cp, void *buf,
+                                     size_t len)
+{
+  uint8_t *ptr = buf;
+  size_t n;
+
+  assert(cp->infile != NULL);
+
+  while (len > 0) {
+    if (cp->buf_pos == cp->buf_len && chunk_next(cp) != 0) {
+      return -1;
+    }
+    n = cp->buf_len - cp->buf_pos;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(ptr, cp->buf + cp->buf_pos, n);
+    cp->buf_pos += n;
+    ptr += n;
+    len -= n;
+  }
+  return 0;
+}
+
+int bgpcorsaro_checkpoint_read_u8(bgpcorsaro_checkpoint_t *cp, uint8_t *val)
+{
+  return bgpcorsaro_checkpoint_read_bytes(cp, val, sizeof(*val));
+}
+
+int bgpcorsaro_checkpoint_read_u16(bgpcorsaro_checkpoint_t *cp, uint16_t *val)
+{
+  if (bgpcorsaro_checkpoint_read_bytes(cp, val, sizeof(*val)) != 0) {
+    return -1;
+  }
+  *val = ntohs(*val);
+  return 0;
+}
+
+int bgpcorsaro_checkpoint_read_u32(bgpcorsaro_checkpoint_t *cp, uint32_t *val)
+{
+  if (bgpcorsaro_checkpoint_read_bytes(cp, val, sizeof(*val)) != 0) {
+    return -1;
+  }
+  *val = ntohl(*val);
+  return 0;
+}
+
+int bgpcorsaro_checkpoint_read_str(bgpcorsaro_checkpoint_t *cp, char *buf,
+                                   size_t len)
+{
+  uint8_t str_len;
+
+  if (bgpcorsaro_checkpoint_read_u8(cp, &str_len) != 0 || str_len >= len ||
+      bgpcorsaro_checkpoint_read_bytes(cp, buf, str_len) != 0) {
+    return -1;
+  }
+  buf[str_len] = '\0';
+  return 0;
+}
+
+int bgpcorsaro_checkpoint_read_addr(bgpcorsaro_checkpoint_t *cp,
+                                    bgpstream_addr_storage_t *addr)
+{
+  uint8_t idx;
+
+  /* zero everything so that the address can be used as a hash key */
+  memset(addr, 0, sizeof(bgpstream_addr_storage_t));
+
+  if (bgpcorsaro_checkpoint_read_u8(cp, &idx) != 0 ||
+      idx >= BGPSTREAM_MAX_IP_VERSION_IDX) {
+    return -1;
+  }
+  addr->version = bgpstream_idx2ipv(idx);
+  if (addr->version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    return bgpcorsaro_checkpoint_read_bytes(cp, &addr->ipv4,
+                                            sizeof(addr->ipv4));
+  }
+  return bgpcorsaro_checkpoint_read_bytes(cp, &addr->ipv6, sizeof(addr->ipv6));
+}
+
+int bgpcorsaro_checkpoint_read_pfx(bgpcorsaro_checkpoint_t *cp,
+                                   bgpstream_pfx_storage_t *pfx)
+{
+  memset(pfx, 0, sizeof(bgpstream_pfx_storage_t));
+
+  if (bgpcorsaro_checkpoint_read_u8(cp, &pfx->mask_len) != 0 ||
+      bgpcorsaro_checkpoint_read_addr(cp, &pfx->address) != 0) {
+    return -1;
+  }
+  if (pfx->mask_len >
+      (pfx->address.version == BGPSTREAM_ADDR_VERSION_IPV4 ? 32 : 128)) {
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __BGPCORSARO_CHECKPOINT_H
+#define __BGPCORSARO_CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bgpcorsaro.h"
+
+#include "bgpstream_utils_addr.h"
+#include "bgpstream_utils_pfx.h"
+
+/** @file
+ *
+ * @brief Header file for saving and restoring plugin state
+ *
+ * A checkpoint is a binary file which holds the state of each plugin at the
+ * end of an interval, along with the time at which the next interval starts.
+ * When bgpcorsaro is restarted with the same checkpoint file, each plugin
+ * restores its state from the file, and processing resumes at the start of
+ * the interval after the checkpoint, rather than from a cold start.
+ *
+ * The state of each plugin is written as a separate section, so state for a
+ * plugin which is no longer enabled is skipped, and a plugin which has no
+ * state in the file starts cold. Within a section, plugins write and read
+ * values using the functions below, which store them in network byte order.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Opaque struct holding the state of a checkpoint being written or read */
+typedef struct bgpcorsaro_checkpoint bgpcorsaro_checkpoint_t;
+
+/** Position in the stream that a checkpoint was taken at */
+typedef struct bgpcorsaro_checkpoint_pos {
+  /** The length of the intervals (in seconds) */
+  uint32_t interval;
+
+  /** The number of the interval that follows the checkpoint */
+  uint16_t interval_number;
+
+  /** The start time of the interval that follows the checkpoint */
+  uint32_t resume_time;
+} bgpcorsaro_checkpoint_pos_t;
+
+/**
+ * @name Checkpoint file functions
+ *
+ * These are used by bgpcorsaro to write and read checkpoint files
+ *
+ * @{ */
+
+/** Write the state of all plugins to a checkpoint file
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to checkpoint
+ * @param path          Path of the checkpoint file
+ * @param pos           Position in the stream to record
+ * @return 0 if the checkpoint was written successfully, -1 otherwise
+ *
+ * The file is written to a temporary file which is then renamed over the
+ * given path, so an existing checkpoint is never left half-written.
+ */
+int bgpcorsaro_checkpoint_save(bgpcorsaro_t *bgpcorsaro, const char *path,
+                               bgpcorsaro_checkpoint_pos_t *pos);
+
+/** Restore the state of all plugins from a checkpoint file
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to restore
+ * @param path          Path of the checkpoint file
+ * @param[out] pos      Filled with the position in the stream of the
+ *                      checkpoint
+ * @return 0 if the state was restored, 1 if the file does not exist, -1 if an
+ * error occurred
+ *
+ * The plugins must have initialized their output before this is called.
+ */
+int bgpcorsaro_checkpoint_load(bgpcorsaro_t *bgpcorsaro, const char *path,
+                               bgpcorsaro_checkpoint_pos_t *pos);
+
+/** @} */
+
+/**
+ * @name Plugin state functions
+ *
+ * These are used by plugins to write their state in their checkpoint
+ * function, and to read it back in their restore function. All return 0 if
+ * successful, and -1 if an error occurred (when reading, this includes reading
+ * past the end of the plugin's section).
+ *
+ * @{ */
+
+/** Write an 8 bit value */
+int bgpcorsaro_checkpoint_write_u8(bgpcorsaro_checkpoint_t *cp, uint8_t val);
+
+/** Write a 16 bit value */
+int bgpcorsaro_checkpoint_write_u16(bgpcorsaro_checkpoint_t *cp, uint16_t val);
+
+/** Write a 32 bit value */
+int bgpcorsaro_checkpoint_write_u32(bgpcorsaro_checkpoint_t *cp, uint32_t val);
+
+/** Write an array of bytes */
+int bgpcorsaro_checkpoint_write_bytes(bgpcorsaro_checkpoint_t *cp,
+                                      const void *buf, size_t len);
+
+/** Write a nul-terminated string (of up to 255 characters) */
+int bgpcorsaro_checkpoint_write_str(bgpcorsaro_checkpoint_t *cp,
+                                    const char *str);
+
+/** Write an IP address */
+int bgpcorsaro_checkpoint_write_addr(bgpcorsaro_checkpoint_t *cp,
+                                     const bgpstream_addr_storage_t *addr);
+
+/** Write a prefix */
+int bgpcorsaro_checkpoint_write_pfx(bgpcorsaro_checkpoint_t *cp,
+                                    const bgpstream_pfx_storage_t *pfx);
+
+/** Read an 8 bit value */
+int bgpcorsaro_checkpoint_read_u8(bgpcorsaro_checkpoint_t *cp, uint8_t *val);
+
+/** Read a 16 bit value */
+int bgpcorsaro_checkpoint_read_u16(bgpcorsaro_checkpoint_t *cp, uint16_t *val);
+
+/** Read a 32 bit value */
+int bgpcorsaro_checkpoint_read_u32(bgpcorsaro_checkpoint_t *cp, uint32_t *val);
+
+/** Read an array of bytes */
+int bgpcorsaro_checkpoint_read_bytes(bgpcorsaro_checkpoint_t *cp, void *buf,
+                                     size_t len);
+
+/** Read a string into a buffer of the given length (which must be large
+    enough to hold the string) */
+int bgpcorsaro_checkpoint_read_str(bgpcorsaro_checkpoint_t *cp, char *buf,
+                                   size_t len);
+
+/** Read an IP address */
+int bgpcorsaro_checkpoint_read_addr(bgpcorsaro_checkpoint_t *cp,
+                                    bgpstream_addr_storage_t *addr);
+
+/** Read a prefix */
+int bgpcorsaro_checkpoint_read_pfx(bgpcorsaro_checkpoint_t *cp,
+                                   bgpstream_pfx_storage_t *pfx);
+
+/** @} */
+
+#endif /* __BGPCORSARO_CHECKPOINT_H */
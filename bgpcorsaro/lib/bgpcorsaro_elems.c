@@ -0,0 +1,114 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bgpcorsaro_int.h"
+#include "config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+#include "bgpcorsaro_elems.h"
+
+/** @file
+ *
+ * @brief Code which collects the elems of a record for the plugins
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Number of elem pointers to allocate at a time */
+#define ELEMS_ALLOC_STEP 128
+
+struct bgpcorsaro_elems {
+  /** Borrowed pointers to the elems of the current record */
+  bgpstream_elem_t **elems;
+
+  /** Number of elems in the list */
+  int elems_cnt;
+
+  /** Number of elem pointers allocated */
+  int elems_alloc_cnt;
+};
+
+/* ========== PROTECTED FUNCTIONS ========== */
+
+bgpcorsaro_elems_t *bgpcorsaro_elems_create(void)
+{
+  return malloc_zero(sizeof(bgpcorsaro_elems_t));
+}
+
+void bgpcorsaro_elems_destroy(bgpcorsaro_elems_t *elems)
+{
+  if (elems == NULL) {
+    return;
+  }
+  free(elems->elems);
+  free(elems);
+}
+
+void bgpcorsaro_elems_clear(bgpcorsaro_elems_t *elems)
+{
+  elems->elems_cnt = 0;
+}
+
+int bgpcorsaro_elems_populate(bgpcorsaro_elems_t *elems,
+                              bgpstream_record_t *record)
+{
+  bgpstream_elem_t *elem;
+  bgpstream_elem_t **tmp;
+
+  bgpcorsaro_elems_clear(elems);
+
+  while ((elem = bgpstream_record_get_next_elem(record)) != NULL) {
+    if (elems->elems_cnt == elems->elems_alloc_cnt) {
+      if ((tmp = realloc(elems->elems,
+                         sizeof(bgpstream_elem_t *) *
+                           (elems->elems_alloc_cnt + ELEMS_ALLOC_STEP))) ==
+          NULL) {
+        bgpcorsaro_elems_clear(elems);
+        return -1;
+      }
+      elems->elems = tmp;
+      elems->elems_alloc_cnt += ELEMS_ALLOC_STEP;
+    }
+    elems->elems[elems->elems_cnt++] = elem;
+  }
+
+  bgpstream_record_rewind_elems(record);
+  return 0;
+}
+
+/* ========== PUBLIC FUNCTIONS ========== */
+
+bgpstream_elem_t *bgpcorsaro_record_get_next_elem(bgpcorsaro_record_t *record)
+{
+  assert(record != NULL);
+
+  if (record->elems == NULL || record->elems_iter >= record->elems->elems_cnt) {
+    return NULL;
+  }
+
+  return record->elems->elems[record->elems_iter++];
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __BGPCORSARO_ELEMS_H
+#define __BGPCORSARO_ELEMS_H
+
+#include "config.h"
+
+#include "bgpcorsaro_int.h"
+
+/** @file
+ *
+ * @brief Header file dealing with the elems of a record that are shared by
+ * all plugins
+ *
+ * The elems of each record are generated once (by bgpcorsaro_per_record) and
+ * collected into a list that the plugins can only read. Each plugin walks the
+ * list with its own cursor (using bgpcorsaro_record_get_next_elem), so plugins
+ * neither re-generate the elems nor disturb each other's iteration.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Opaque struct holding the elems of a record */
+typedef struct bgpcorsaro_elems bgpcorsaro_elems_t;
+
+/** Create a new (empty) elem list
+ *
+ * @return pointer to the elem list if successful, NULL otherwise
+ */
+bgpcorsaro_elems_t *bgpcorsaro_elems_create(void);
+
+/** Free the given elem list
+ *
+ * @param elems         The elem list to free
+ */
+void bgpcorsaro_elems_destroy(bgpcorsaro_elems_t *elems);
+
+/** Empty the given elem list
+ *
+ * @param elems         The elem list to clear
+ */
+void bgpcorsaro_elems_clear(bgpcorsaro_elems_t *elems);
+
+/** Generate the elems of the given record and collect them into the list
+ *
+ * @param elems         The elem list to fill
+ * @param record        The bgpstream record to generate elems from
+ * @return 0 if the list was filled successfully, -1 otherwise
+ *
+ * The elems belong to the record, so the list is only valid until the record
+ * is cleared. The elem iterator of the record is rewound afterwards, so
+ * plugins that iterate over the bgpstream record directly still see every
+ * elem.
+ */
+int bgpcorsaro_elems_populate(bgpcorsaro_elems_t *elems,
+                              bgpstream_record_t *record);
+
+#endif /* __BGPCORSARO_ELEMS_H */
@@ -138,6 +138,13 @@ struct bgpcorsaro_record {
 
   /** A pointer to the underlying bgpstream record */
   bgpstream_record_t *bsrecord;
+
+  /** The elems of the record (shared, read-only) */
+  struct bgpcorsaro_elems *elems;
+
+  /** Index of the next elem to be returned by
+      bgpcorsaro_record_get_next_elem */
+  int elems_iter;
 };
 
 /** Convenience macro to get to the bgpstream recprd inside a bgpcorsaro
@@ -173,6 +180,9 @@ struct bgpcorsaro {
   /** A pointer to the wrapper record passed to the plugins */
   bgpcorsaro_record_t *record;
 
+  /** The elems of the current record (when not threaded) */
+  struct bgpcorsaro_elems *elems;
+
   /** A pointer to the bgpcorsaro plugin manager state */
   /* this is what gets passed to any function relating to plugin management */
   bgpcorsaro_plugin_manager_t *plugin_manager;
@@ -213,8 +223,49 @@ struct bgpcorsaro {
 
   /** Has this bgpcorsaro object been started yet? */
   int started;
+
+  /** Should each plugin be run in its own thread? */
+  int threaded;
+
+  /** State for the plugin threads (if threaded) */
+  struct bgpcorsaro_threads *threads;
+
+  /** Metrics emitter to report plugin timing to (NULL if disabled) */
+  bgpstream_metrics_t *metrics;
+
+  /** Path of the file to checkpoint plugin state to (NULL if disabled) */
+  char *checkpoint_file;
+
+  /** Plugin state will be checkpointed every n intervals */
+  int checkpoint_intervals;
+
+  /** If state was restored from a checkpoint, the time at which processing
+      resumes (records before this time are ignored), 0 otherwise */
+  uint32_t resume_time;
 };
 
+/**
+ * @name Bgpcorsaro internal functions
+ *
+ * These functions are used by the bgpcorsaro tool, but are not part of the
+ * public API
+ *
+ * @{ */
+
+/** Clip a time window to the part that is not before the resume time
+ *
+ * @param resume_time   The resume time (see bgpcorsaro_get_resume_time), or 0
+ * @param[in,out] start The start of the window, which is moved up to the
+ *                      resume time if it is earlier
+ * @param end           The end of the window, or BGPSTREAM_FOREVER if the
+ *                      window has no end
+ * @return 1 if any of the window is left, 0 if it ends before the resume time
+ */
+int bgpcorsaro_clip_window(uint32_t resume_time, uint32_t *start,
+                           uint32_t end);
+
+/** @} */
+
 #ifdef WITH_PLUGIN_TIMING
 /* Helper macros for doing timing */
 
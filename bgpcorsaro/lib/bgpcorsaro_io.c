@@ -73,6 +73,7 @@ static char *generate_file_name(bgpcorsaro_t *bgpcorsaro, const char *plugin,
   char *tmpl = bgpcorsaro->template;
   char secs[11]; /* length of UINT32_MAX +1 */
   struct timeval tv;
+  struct tm tm;
 
   for (; *tmpl; ++tmpl) {
     if (*tmpl == '.' && compress_type == WANDIO_COMPRESS_NONE) {
@@ -122,7 +123,8 @@ static char *generate_file_name(bgpcorsaro_t *bgpcorsaro, const char *plugin,
   /* now let strftime have a go */
   if (interval != NULL) {
     tv.tv_sec = interval->time;
-    strftime(tbuf, sizeof(tbuf), buf, gmtime(&tv.tv_sec));
+    /* plugins may be opening files from their own threads */
+    strftime(tbuf, sizeof(tbuf), buf, gmtime_r(&tv.tv_sec, &tm));
     return strdup(tbuf);
   }
 
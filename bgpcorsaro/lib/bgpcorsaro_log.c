@@ -31,6 +31,7 @@
 #include <string.h>
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -47,6 +48,9 @@
 #include "bgpcorsaro_io.h"
 #include "bgpcorsaro_log.h"
 
+/** Serializes writes to the log */
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static char *timestamp_str(char *buf, const size_t len)
 {
   struct timeval tv;
@@ -85,6 +89,9 @@ void generic_log(const char *func, iow_t *logfile, const char *format,
   else
     fs[0] = '\0';
 
+  /* plugins may log from their own threads */
+  pthread_mutex_lock(&log_mutex);
+
   if (logfile == NULL) {
     fprintf(stderr, "%s%s%s\n", ts, fs, message);
     fflush(stderr);
@@ -98,6 +105,8 @@ void generic_log(const char *func, iow_t *logfile, const char *format,
     fflush(stderr);
 #endif
   }
+
+  pthread_mutex_unlock(&log_mutex);
 }
 
 void bgpcorsaro_log_va(const char *func, bgpcorsaro_t *bgpcorsaro,
@@ -0,0 +1,800 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "config.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "khash.h"
+#include "utils.h"
+
+#include "bgpcorsaro_pfx_origins.h"
+
+/** @file
+ *
+ * @brief Code which implements the prefix origin table
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Prefix ID used to mark an empty cell */
+#define EMPTY_ID UINT32_MAX
+
+/** Initial number of cells in the table (must be a power of two) */
+#define CELLS_INIT_CNT 1024
+
+/** Number of prefix IDs to allocate at a time */
+#define PFXS_ALLOC_STEP 1024
+
+/** Is the table too full (i.e. more than 3/4 of cells are used)? */
+#define TOO_FULL(table)                                                        \
+  (((table)->cells_used + 1) * 4 > ((table)->cells_mask + 1) * 3)
+
+/** The origin of a prefix as observed by a peer */
+typedef struct cell {
+  /** ID of the prefix (EMPTY_ID if the cell is unused) */
+  uint32_t pfx_id;
+
+  /** ASN of the peer */
+  uint32_t peer_asn;
+
+  /** Origin ASN observed by the peer */
+  uint32_t origin_asn;
+} cell_t;
+
+/** Map from prefix to prefix ID */
+KHASH_INIT(pfx_id_map, bgpstream_pfx_storage_t, uint32_t, 1,
+           bgpstream_pfx_storage_hash_val, bgpstream_pfx_storage_equal_val);
+
+/** Map from a pair of 32 bit IDs to a count */
+KHASH_INIT(pair_cnt_map, uint64_t, uint32_t, 1, kh_int64_hash_func,
+           kh_int64_hash_equal);
+
+/** Index of the visibility counters that cover all IP versions */
+#define ALL_VERSIONS_IDX BGPSTREAM_MAX_IP_VERSION_IDX
+
+/** Build a key for a pair_cnt_map */
+#define PAIR(a, b) (((uint64_t)(a) << 32) | (b))
+
+struct bgpcorsaro_pfx_origins {
+  /** Prefix -> ID */
+  khash_t(pfx_id_map) * pfx_ids;
+
+  /** ID -> prefix */
+  bgpstream_pfx_storage_t *pfxs;
+
+  /** ID -> number of peers that observe the prefix (0 if the ID is free) */
+  uint32_t *peers_cnt;
+
+  /** Number of IDs that have been handed out (including freed IDs) */
+  uint32_t pfxs_cnt;
+
+  /** Number of IDs allocated */
+  uint32_t pfxs_alloc_cnt;
+
+  /** Stack of IDs that have been freed and can be re-used */
+  uint32_t *free_ids;
+
+  /** Number of IDs in the free stack */
+  uint32_t free_ids_cnt;
+
+  /** Open-addressed table of (prefix ID, peer ASN) -> origin ASN */
+  cell_t *cells;
+
+  /** Number of cells in the table minus one */
+  uint32_t cells_mask;
+
+  /** Number of cells that are in use */
+  uint32_t cells_used;
+
+  /** Scratch space used to group origins by prefix */
+  uint32_t *scratch;
+
+  /** Number of entries allocated in the scratch space */
+  uint32_t scratch_alloc_cnt;
+
+  /** Scratch space holding the start of each prefix group */
+  uint32_t *groups;
+
+  /** Number of entries allocated in the group scratch space */
+  uint32_t groups_alloc_cnt;
+
+  /* The following are only used if visibility is tracked */
+
+  /** Minimum number of peers that make an origin visible (0 if visibility is
+      not tracked) */
+  uint32_t visible_th;
+
+  /** (prefix ID, origin ASN) -> number of peers observing the origin */
+  khash_t(pair_cnt_map) * origin_peers_cnt;
+
+  /** (version index, origin ASN) -> number of prefixes the origin is visible
+      for */
+  khash_t(pair_cnt_map) * origin_pfxs_cnt;
+
+  /** ID -> number of visible origins of the prefix */
+  uint32_t *visible_origins_cnt;
+
+  /** Number of prefixes with a visible origin (per version index) */
+  uint32_t visible_pfxs[BGPSTREAM_MAX_IP_VERSION_IDX + 1];
+
+  /** Number of distinct visible origins (per version index) */
+  uint32_t visible_origins[BGPSTREAM_MAX_IP_VERSION_IDX + 1];
+};
+
+static inline uint32_t cell_hash(uint32_t pfx_id, uint32_t peer_asn)
+{
+  uint64_t k = ((uint64_t)pfx_id << 32) | peer_asn;
+
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return (uint32_t)k;
+}
+
+/** Find the cell for the given prefix ID and peer, or the empty cell where it
+    should be inserted */
+static inline uint32_t cell_find(const cell_t *cells, uint32_t mask,
+                                 uint32_t pfx_id, uint32_t peer_asn)
+{
+  uint32_t i = cell_hash(pfx_id, peer_asn) & mask;
+
+  while (cells[i].pfx_id != EMPTY_ID &&
+         (cells[i].pfx_id != pfx_id || cells[i].peer_asn != peer_asn)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/** Empty the given cell, shifting back any cells that were displaced past it
+    so that lookups do not need tombstones */
+static void cell_del(bgpcorsaro_pfx_origins_t *t, uint32_t i)
+{
+  uint32_t j = i;
+  uint32_t home;
+
+  t->cells[i].pfx_id = EMPTY_ID;
+  t->cells_used--;
+
+  while (1) {
+    j = (j + 1) & t->cells_mask;
+    if (t->cells[j].pfx_id == EMPTY_ID) {
+      return;
+    }
+    home = cell_hash(t->cells[j].pfx_id, t->cells[j].peer_asn) & t->cells_mask;
+    /* the cell at j can stay where it is if its home lies (cyclically) in
+       (i, j] */
+    if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+      continue;
+    }
+    t->cells[i] = t->cells[j];
+    t->cells[j].pfx_id = EMPTY_ID;
+    i = j;
+  }
+}
+
+static int cells_grow(bgpcorsaro_pfx_origins_t *t)
+{
+  uint32_t new_mask = (t->cells_mask << 1) | 1;
+  cell_t *new_cells;
+  uint32_t i, j;
+
+  if ((new_cells = malloc(sizeof(cell_t) * (new_mask + 1))) == NULL) {
+    return -1;
+  }
+  for (i = 0; i <= new_mask; i++) {
+    new_cells[i].pfx_id = EMPTY_ID;
+  }
+
+  for (i = 0; i <= t->cells_mask; i++) {
+    if (t->cells[i].pfx_id == EMPTY_ID) {
+      continue;
+    }
+    j = cell_find(new_cells, new_mask, t->cells[i].pfx_id,
+                  t->cells[i].peer_asn);
+    new_cells[j] = t->cells[i];
+  }
+
+  free(t->cells);
+  t->cells = new_cells;
+  t->cells_mask = new_mask;
+  return 0;
+}
+
+/** Get the ID of the given prefix, assigning a new ID if needed */
+static int pfx_id_get(bgpcorsaro_pfx_origins_t *t,
+                      const bgpstream_pfx_storage_t *pfx, uint32_t *id)
+{
+  khiter_t k;
+  int khret;
+  void *tmp;
+  uint32_t new_cnt;
+
+  if ((k = kh_get(pfx_id_map, t->pfx_ids, *pfx)) != kh_end(t->pfx_ids)) {
+    *id = kh_value(t->pfx_ids, k);
+    return 0;
+  }
+
+  if (t->free_ids_cnt > 0) {
+    *id = t->free_ids[--t->free_ids_cnt];
+  } else {
+    if (t->pfxs_cnt == t->pfxs_alloc_cnt) {
+      new_cnt = t->pfxs_alloc_cnt + PFXS_ALLOC_STEP;
+      if ((tmp = realloc(t->pfxs, sizeof(bgpstream_pfx_storage_t) * new_cnt)) ==
+          NULL) {
+        return -1;
+      }
+      t->pfxs = tmp;
+      if ((tmp = realloc(t->peers_cnt, sizeof(uint32_t) * new_cnt)) == NULL) {
+        return -1;
+      }
+      t->peers_cnt = tmp;
+      if ((tmp = realloc(t->free_ids, sizeof(uint32_t) * new_cnt)) == NULL) {
+        return -1;
+      }
+      t->free_ids = tmp;
+      if (t->visible_th != 0) {
+        if ((tmp = realloc(t->visible_origins_cnt,
+                           sizeof(uint32_t) * new_cnt)) == NULL) {
+          return -1;
+        }
+        t->visible_origins_cnt = tmp;
+      }
+      t->pfxs_alloc_cnt = new_cnt;
+    }
+    *id = t->pfxs_cnt++;
+  }
+
+  if ((k = kh_put(pfx_id_map, t->pfx_ids, *pfx, &khret)) < 0) {
+    t->free_ids[t->free_ids_cnt++] = *id;
+    return -1;
+  }
+  kh_value(t->pfx_ids, k) = *id;
+  t->pfxs[*id] = *pfx;
+  t->peers_cnt[*id] = 0;
+  if (t->visible_th != 0) {
+    t->visible_origins_cnt[*id] = 0;
+  }
+  return 0;
+}
+
+/** Release the ID of a prefix that is no longer observed by any peer */
+static void pfx_id_release(bgpcorsaro_pfx_origins_t *t, uint32_t id)
+{
+  khiter_t k;
+
+  if ((k = kh_get(pfx_id_map, t->pfx_ids, t->pfxs[id])) !=
+      kh_end(t->pfx_ids)) {
+    kh_del(pfx_id_map, t->pfx_ids, k);
+  }
+  t->peers_cnt[id] = 0;
+  t->free_ids[t->free_ids_cnt++] = id;
+}
+
+/** Add a reference to the given (version index, origin) pair, returning 1 if
+    this is the first reference, or -1 on failure */
+static int origin_pfxs_inc(bgpcorsaro_pfx_origins_t *t, int v,
+                           uint32_t origin_asn)
+{
+  khiter_t k;
+  int khret;
+
+  k = kh_put(pair_cnt_map, t->origin_pfxs_cnt, PAIR(v, origin_asn), &khret);
+  if (khret < 0) {
+    return -1;
+  }
+  if (khret != 0) {
+    kh_value(t->origin_pfxs_cnt, k) = 0;
+  }
+  return ++kh_value(t->origin_pfxs_cnt, k) == 1;
+}
+
+/** Remove a reference to the given (version index, origin) pair, returning 1
+    if this was the last reference */
+static int origin_pfxs_dec(bgpcorsaro_pfx_origins_t *t, int v,
+                           uint32_t origin_asn)
+{
+  khiter_t k;
+
+  k = kh_get(pair_cnt_map, t->origin_pfxs_cnt, PAIR(v, origin_asn));
+  assert(k != kh_end(t->origin_pfxs_cnt));
+  if (--kh_value(t->origin_pfxs_cnt, k) == 0) {
+    kh_del(pair_cnt_map, t->origin_pfxs_cnt, k);
+    return 1;
+  }
+  return 0;
+}
+
+/** The origin has just become visible for the prefix */
+static int origin_shown(bgpcorsaro_pfx_origins_t *t, uint32_t id,
+                        uint32_t origin_asn)
+{
+  int v = bgpstream_ipv2idx(t->pfxs[id].address.version);
+  int first_v, first_all;
+
+  if ((first_v = origin_pfxs_inc(t, v, origin_asn)) < 0) {
+    return -1;
+  }
+  if ((first_all = origin_pfxs_inc(t, ALL_VERSIONS_IDX, origin_asn)) < 0) {
+    origin_pfxs_dec(t, v, origin_asn);
+    return -1;
+  }
+  t->visible_origins[v] += first_v;
+  t->visible_origins[ALL_VERSIONS_IDX] += first_all;
+
+  if (t->visible_origins_cnt[id]++ == 0) {
+    t->visible_pfxs[v]++;
+    t->visible_pfxs[ALL_VERSIONS_IDX]++;
+  }
+  return 0;
+}
+
+/** The origin is no longer visible for the prefix */
+static void origin_hidden(bgpcorsaro_pfx_origins_t *t, uint32_t id,
+                          uint32_t origin_asn)
+{
+  int v = bgpstream_ipv2idx(t->pfxs[id].address.version);
+
+  t->visible_origins[v] -= origin_pfxs_dec(t, v, origin_asn);
+  t->visible_origins[ALL_VERSIONS_IDX] -=
+    origin_pfxs_dec(t, ALL_VERSIONS_IDX, origin_asn);
+
+  if (--t->visible_origins_cnt[id] == 0) {
+    t->visible_pfxs[v]--;
+    t->visible_pfxs[ALL_VERSIONS_IDX]--;
+  }
+}
+
+/** Count another peer observing the given origin for the prefix */
+static int origin_peers_inc(bgpcorsaro_pfx_origins_t *t, uint32_t id,
+                            uint32_t origin_asn)
+{
+  khiter_t k;
+  int khret;
+
+  if (t->visible_th == 0) {
+    return 0;
+  }
+
+  k = kh_put(pair_cnt_map, t->origin_peers_cnt, PAIR(id, origin_asn), &khret);
+  if (khret < 0) {
+    return -1;
+  }
+  if (khret != 0) {
+    kh_value(t->origin_peers_cnt, k) = 0;
+  }
+  if (kh_value(t->origin_peers_cnt, k) + 1 == t->visible_th &&
+      origin_shown(t, id, origin_asn) != 0) {
+    if (kh_value(t->origin_peers_cnt, k) == 0) {
+      kh_del(pair_cnt_map, t->origin_peers_cnt, k);
+    }
+    return -1;
+  }
+  kh_value(t->origin_peers_cnt, k)++;
+  return 0;
+}
+
+/** Stop counting a peer observing the given origin for the prefix */
+static void origin_peers_dec(bgpcorsaro_pfx_origins_t *t, uint32_t id,
+                             uint32_t origin_asn)
+{
+  khiter_t k;
+
+  if (t->visible_th == 0) {
+    return;
+  }
+
+  k = kh_get(pair_cnt_map, t->origin_peers_cnt, PAIR(id, origin_asn));
+  assert(k != kh_end(t->origin_peers_cnt));
+  if (kh_value(t->origin_peers_cnt, k) == t->visible_th) {
+    origin_hidden(t, id, origin_asn);
+  }
+  if (--kh_value(t->origin_peers_cnt, k) == 0) {
+    kh_del(pair_cnt_map, t->origin_peers_cnt, k);
+  }
+}
+
+static int cmp_uint32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/** Make sure the scratch spaces are large enough */
+static int scratch_reserve(bgpcorsaro_pfx_origins_t *t)
+{
+  void *tmp;
+
+  if (t->scratch_alloc_cnt < t->cells_used) {
+    if ((tmp = realloc(t->scratch, sizeof(uint32_t) * t->cells_used)) ==
+        NULL) {
+      return -1;
+    }
+    t->scratch = tmp;
+    t->scratch_alloc_cnt = t->cells_used;
+  }
+  if (t->groups_alloc_cnt < t->pfxs_cnt) {
+    if ((tmp = realloc(t->groups, sizeof(uint32_t) * t->pfxs_cnt)) == NULL) {
+      return -1;
+    }
+    t->groups = tmp;
+    t->groups_alloc_cnt = t->pfxs_cnt;
+  }
+  return 0;
+}
+
+/* ========== PROTECTED FUNCTIONS ========== */
+
+bgpcorsaro_pfx_origins_t *bgpcorsaro_pfx_origins_create(void)
+{
+  bgpcorsaro_pfx_origins_t *t;
+  uint32_t i;
+
+  if ((t = malloc_zero(sizeof(bgpcorsaro_pfx_origins_t))) == NULL) {
+    return NULL;
+  }
+
+  if ((t->pfx_ids = kh_init(pfx_id_map)) == NULL) {
+    goto err;
+  }
+
+  if ((t->cells = malloc(sizeof(cell_t) * CELLS_INIT_CNT)) == NULL) {
+    goto err;
+  }
+  t->cells_mask = CELLS_INIT_CNT - 1;
+  for (i = 0; i < CELLS_INIT_CNT; i++) {
+    t->cells[i].pfx_id = EMPTY_ID;
+  }
+
+  return t;
+
+err:
+  bgpcorsaro_pfx_origins_destroy(t);
+  return NULL;
+}
+
+void bgpcorsaro_pfx_origins_destroy(bgpcorsaro_pfx_origins_t *t)
+{
+  if (t == NULL) {
+    return;
+  }
+
+  if (t->pfx_ids != NULL) {
+    kh_destroy(pfx_id_map, t->pfx_ids);
+  }
+  free(t->pfxs);
+  free(t->peers_cnt);
+  free(t->free_ids);
+  free(t->cells);
+  free(t->scratch);
+  free(t->groups);
+  if (t->origin_peers_cnt != NULL) {
+    kh_destroy(pair_cnt_map, t->origin_peers_cnt);
+  }
+  if (t->origin_pfxs_cnt != NULL) {
+    kh_destroy(pair_cnt_map, t->origin_pfxs_cnt);
+  }
+  free(t->visible_origins_cnt);
+  free(t);
+}
+
+int bgpcorsaro_pfx_origins_set(bgpcorsaro_pfx_origins_t *t,
+                               const bgpstream_pfx_storage_t *pfx,
+                               uint32_t peer_asn, uint32_t origin_asn)
+{
+  uint32_t id;
+  uint32_t i;
+
+  if (pfx_id_get(t, pfx, &id) != 0) {
+    return -1;
+  }
+
+  i = cell_find(t->cells, t->cells_mask, id, peer_asn);
+  if (t->cells[i].pfx_id != EMPTY_ID) {
+    /* the peer already observes this prefix */
+    if (t->cells[i].origin_asn != origin_asn) {
+      if (origin_peers_inc(t, id, origin_asn) != 0) {
+        return -1;
+      }
+      origin_peers_dec(t, id, t->cells[i].origin_asn);
+      t->cells[i].origin_asn = origin_asn;
+    }
+    return 0;
+  }
+
+  if ((TOO_FULL(t) && cells_grow(t) != 0) ||
+      origin_peers_inc(t, id, origin_asn) != 0) {
+    /* don't leave an unobserved prefix behind */
+    if (t->peers_cnt[id] == 0) {
+      pfx_id_release(t, id);
+    }
+    return -1;
+  }
+
+  i = cell_find(t->cells, t->cells_mask, id, peer_asn);
+  t->cells[i].pfx_id = id;
+  t->cells[i].peer_asn = peer_asn;
+  t->cells[i].origin_asn = origin_asn;
+  t->cells_used++;
+  t->peers_cnt[id]++;
+  return 0;
+}
+
+void bgpcorsaro_pfx_origins_remove(bgpcorsaro_pfx_origins_t *t,
+                                   const bgpstream_pfx_storage_t *pfx,
+                                   uint32_t peer_asn)
+{
+  khiter_t k;
+  uint32_t id;
+  uint32_t i;
+
+  if ((k = kh_get(pfx_id_map, t->pfx_ids, *pfx)) == kh_end(t->pfx_ids)) {
+    return;
+  }
+  id = kh_value(t->pfx_ids, k);
+
+  i = cell_find(t->cells, t->cells_mask, id, peer_asn);
+  if (t->cells[i].pfx_id == EMPTY_ID) {
+    return;
+  }
+  origin_peers_dec(t, id, t->cells[i].origin_asn);
+  cell_del(t, i);
+
+  if (--t->peers_cnt[id] == 0) {
+    pfx_id_release(t, id);
+  }
+}
+
+uint32_t bgpcorsaro_pfx_origins_get_pfx_cnt(bgpcorsaro_pfx_origins_t *t)
+{
+  return kh_size(t->pfx_ids);
+}
+
+int bgpcorsaro_pfx_origins_track_visible(bgpcorsaro_pfx_origins_t *t,
+                                         uint32_t peer_asns_th)
+{
+  assert(t->cells_used == 0 && t->visible_th == 0);
+
+  if ((t->origin_peers_cnt = kh_init(pair_cnt_map)) == NULL ||
+      (t->origin_pfxs_cnt = kh_init(pair_cnt_map)) == NULL) {
+    return -1;
+  }
+  if (t->pfxs_alloc_cnt > 0 &&
+      (t->visible_origins_cnt = malloc_zero(sizeof(uint32_t) *
+                                            t->pfxs_alloc_cnt)) == NULL) {
+    return -1;
+  }
+
+  /* a threshold of 0 makes every observed origin visible, just like 1 */
+  t->visible_th = peer_asns_th == 0 ? 1 : peer_asns_th;
+  return 0;
+}
+
+static int version_idx(bgpstream_addr_version_t version)
+{
+  if (version == BGPSTREAM_ADDR_VERSION_UNKNOWN) {
+    return ALL_VERSIONS_IDX;
+  }
+  return bgpstream_ipv2idx(version);
+}
+
+uint32_t
+bgpcorsaro_pfx_origins_get_visible_pfx_cnt(bgpcorsaro_pfx_origins_t *t,
+                                           bgpstream_addr_version_t version)
+{
+  assert(t->visible_th != 0);
+  return t->visible_pfxs[version_idx(version)];
+}
+
+uint32_t
+bgpcorsaro_pfx_origins_get_visible_origin_cnt(bgpcorsaro_pfx_origins_t *t,
+                                              bgpstream_addr_version_t version)
+{
+  assert(t->visible_th != 0);
+  return t->visible_origins[version_idx(version)];
+}
+
+int bgpcorsaro_pfx_origins_walk_visible(bgpcorsaro_pfx_origins_t *t,
+                                        uint32_t peer_asns_th,
+                                        bgpcorsaro_pfx_origins_visit_t *fn,
+                                        void *user)
+{
+  uint32_t id;
+  uint32_t i;
+  uint32_t end = 0;
+  uint32_t *origins;
+  uint32_t n, run;
+  int visible_cnt;
+
+  if (scratch_reserve(t) != 0) {
+    return -1;
+  }
+
+  /* counting sort of the origins by prefix ID: first find where the group of
+     each prefix ends ... */
+  for (id = 0; id < t->pfxs_cnt; id++) {
+    end += t->peers_cnt[id];
+    t->groups[id] = end;
+  }
+  assert(end == t->cells_used);
+
+  /* ... then fill each group from the back, which leaves groups[id] pointing
+     at the start of the group */
+  for (i = 0; i <= t->cells_mask; i++) {
+    if (t->cells[i].pfx_id != EMPTY_ID) {
+      t->scratch[--t->groups[t->cells[i].pfx_id]] = t->cells[i].origin_asn;
+    }
+  }
+
+  for (id = 0; id < t->pfxs_cnt; id++) {
+    if ((n = t->peers_cnt[id]) == 0) {
+      continue;
+    }
+    origins = &t->scratch[t->groups[id]];
+    visible_cnt = 0;
+
+    if (n >= peer_asns_th) {
+      /* groups are small (one entry per peer), and usually have only one
+         origin */
+      if (n > 1) {
+        qsort(origins, n, sizeof(uint32_t), cmp_uint32);
+      }
+      /* compact the visible origins at the front of the group */
+      for (i = 0; i < n; i += run) {
+        for (run = 1; i + run < n && origins[i + run] == origins[i]; run++)
+          ;
+        if (run >= peer_asns_th) {
+          origins[visible_cnt++] = origins[i];
+        }
+      }
+    }
+
+    fn(&t->pfxs[id], origins, visible_cnt, user);
+  }
+
+  return 0;
+}
+
+void bgpcorsaro_pfx_origins_retain(bgpcorsaro_pfx_origins_t *t,
+                                   bgpcorsaro_pfx_origins_keep_t *fn,
+                                   void *user)
+{
+  uint32_t id;
+  uint32_t start, n, i;
+  int dropped = 0;
+
+  for (id = 0; id < t->pfxs_cnt; id++) {
+    if (t->peers_cnt[id] != 0 && fn(&t->pfxs[id], user) == 0) {
+      pfx_id_release(t, id);
+      dropped = 1;
+    }
+  }
+
+  if (dropped == 0) {
+    return;
+  }
+
+  /* released prefixes have no peers, so remove their cells. cell_del shifts
+     cells back towards their home, but never past an empty cell, so start
+     just after one (the table is never full) and go once around the table:
+     cells that have not been checked yet can then never be shifted behind
+     the sweep. cell_del may shift another cell into the hole though, so
+     check the same cell again */
+  for (start = 0; t->cells[start].pfx_id != EMPTY_ID; start++)
+    ;
+  for (n = 1; n <= t->cells_mask + 1; n++) {
+    i = (start + n) & t->cells_mask;
+    while (t->cells[i].pfx_id != EMPTY_ID &&
+           t->peers_cnt[t->cells[i].pfx_id] == 0) {
+      origin_peers_dec(t, t->cells[i].pfx_id, t->cells[i].origin_asn);
+      cell_del(t, i);
+    }
+  }
+}
+
+int bgpcorsaro_pfx_origins_checkpoint(bgpcorsaro_pfx_origins_t *t,
+                                      bgpcorsaro_checkpoint_t *cp)
+{
+  uint32_t id;
+  uint32_t i;
+
+  /* each prefix is written once, and the cells refer to it by ID */
+  if (bgpcorsaro_checkpoint_write_u32(cp, t->pfxs_cnt) != 0) {
+    return -1;
+  }
+  for (id = 0; id < t->pfxs_cnt; id++) {
+    if (bgpcorsaro_checkpoint_write_u8(cp, t->peers_cnt[id] != 0) != 0 ||
+        (t->peers_cnt[id] != 0 &&
+         bgpcorsaro_checkpoint_write_pfx(cp, &t->pfxs[id]) != 0)) {
+      return -1;
+    }
+  }
+
+  if (bgpcorsaro_checkpoint_write_u32(cp, t->cells_used) != 0) {
+    return -1;
+  }
+  for (i = 0; i <= t->cells_mask; i++) {
+    if (t->cells[i].pfx_id == EMPTY_ID) {
+      continue;
+    }
+    if (bgpcorsaro_checkpoint_write_u32(cp, t->cells[i].pfx_id) != 0 ||
+        bgpcorsaro_checkpoint_write_u32(cp, t->cells[i].peer_asn) != 0 ||
+        bgpcorsaro_checkpoint_write_u32(cp, t->cells[i].origin_asn) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int bgpcorsaro_pfx_origins_restore(bgpcorsaro_pfx_origins_t *t,
+                                   bgpcorsaro_checkpoint_t *cp)
+{
+  bgpstream_pfx_storage_t *pfxs = NULL;
+  uint32_t pfxs_cnt;
+  uint32_t cells_cnt;
+  uint32_t id, peer_asn, origin_asn;
+  uint32_t i;
+  uint8_t live;
+
+  assert(t->cells_used == 0);
+
+  if (bgpcorsaro_checkpoint_read_u32(cp, &pfxs_cnt) != 0) {
+    return -1;
+  }
+  if (pfxs_cnt > 0 &&
+      (pfxs = malloc_zero(sizeof(bgpstream_pfx_storage_t) * pfxs_cnt)) ==
+        NULL) {
+    return -1;
+  }
+  for (id = 0; id < pfxs_cnt; id++) {
+    if (bgpcorsaro_checkpoint_read_u8(cp, &live) != 0 ||
+        (live != 0 && bgpcorsaro_checkpoint_read_pfx(cp, &pfxs[id]) != 0)) {
+      goto err;
+    }
+  }
+
+  /* the IDs in the checkpoint are not necessarily the IDs that the prefixes
+     get now, so just set each entry again */
+  if (bgpcorsaro_checkpoint_read_u32(cp, &cells_cnt) != 0) {
+    goto err;
+  }
+  for (i = 0; i < cells_cnt; i++) {
+    if (bgpcorsaro_checkpoint_read_u32(cp, &id) != 0 || id >= pfxs_cnt ||
+        bgpcorsaro_checkpoint_read_u32(cp, &peer_asn) != 0 ||
+        bgpcorsaro_checkpoint_read_u32(cp, &origin_asn) != 0 ||
+        bgpcorsaro_pfx_origins_set(t, &pfxs[id], peer_asn, origin_asn) != 0) {
+      goto err;
+    }
+  }
+
+  free(pfxs);
+  return 0;
+
+err:
+  free(pfxs);
+  return -1;
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __BGPCORSARO_PFX_ORIGINS_H
+#define __BGPCORSARO_PFX_ORIGINS_H
+
+#include <stdint.h>
+
+#include "bgpstream_utils_pfx.h"
+
+#include "bgpcorsaro_checkpoint.h"
+
+/** @file
+ *
+ * @brief Header file for a table that holds the origin ASN of each prefix as
+ * observed by each peer ASN
+ *
+ * This is shared by the plugins (e.g. asmonitor and pfxmonitor) that need to
+ * know, at the end of each interval, which origins of a prefix are seen by
+ * enough peers. Rather than a hash of prefixes to a hash of peers for each
+ * prefix, prefixes are assigned a small integer ID, and all (prefix ID, peer
+ * ASN) -> origin ASN entries live in a single open-addressed table.
+ *
+ * Optionally, the table can also keep track of which origins are visible
+ * (i.e. observed by at least a threshold number of peers) as entries are set
+ * and removed, so that the number of visible prefixes and origins can be read
+ * at any time without walking the table.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Opaque struct holding a prefix origin table */
+typedef struct bgpcorsaro_pfx_origins bgpcorsaro_pfx_origins_t;
+
+/** Callback type for bgpcorsaro_pfx_origins_walk_visible
+ *
+ * @param pfx           The prefix
+ * @param origins       Array of origin ASNs of the prefix that are observed by
+ *                      enough peers (in ascending order, borrowed)
+ * @param origins_cnt   Number of origins in the array (may be 0)
+ * @param user          User data passed to the walk function
+ */
+typedef void(bgpcorsaro_pfx_origins_visit_t)(const bgpstream_pfx_storage_t *pfx,
+                                              const uint32_t *origins,
+                                              int origins_cnt, void *user);
+
+/** Callback type for bgpcorsaro_pfx_origins_retain
+ *
+ * @param pfx           The prefix
+ * @param user          User data passed to the retain function
+ * @return 1 if the prefix should be kept, 0 if it should be removed
+ */
+typedef int(bgpcorsaro_pfx_origins_keep_t)(const bgpstream_pfx_storage_t *pfx,
+                                           void *user);
+
+/** Create a new (empty) prefix origin table
+ *
+ * @return pointer to the table if successful, NULL otherwise
+ */
+bgpcorsaro_pfx_origins_t *bgpcorsaro_pfx_origins_create(void);
+
+/** Free the given prefix origin table
+ *
+ * @param table         The table to free
+ */
+void bgpcorsaro_pfx_origins_destroy(bgpcorsaro_pfx_origins_t *table);
+
+/** Set the origin ASN of a prefix as observed by a peer
+ *
+ * @param table         The table to update
+ * @param pfx           The prefix
+ * @param peer_asn      The ASN of the peer
+ * @param origin_asn    The origin ASN observed by the peer
+ * @return 0 if the table was updated successfully, -1 otherwise
+ */
+int bgpcorsaro_pfx_origins_set(bgpcorsaro_pfx_origins_t *table,
+                               const bgpstream_pfx_storage_t *pfx,
+                               uint32_t peer_asn, uint32_t origin_asn);
+
+/** Remove the origin of a prefix as observed by a peer
+ *
+ * @param table         The table to update
+ * @param pfx           The prefix
+ * @param peer_asn      The ASN of the peer
+ *
+ * Once no peer observes a prefix, the prefix is removed from the table.
+ */
+void bgpcorsaro_pfx_origins_remove(bgpcorsaro_pfx_origins_t *table,
+                                   const bgpstream_pfx_storage_t *pfx,
+                                   uint32_t peer_asn);
+
+/** Get the number of prefixes in the table
+ *
+ * @param table         The table
+ * @return the number of prefixes that are observed by at least one peer
+ */
+uint32_t bgpcorsaro_pfx_origins_get_pfx_cnt(bgpcorsaro_pfx_origins_t *table);
+
+/** Keep the visible prefix and origin counters up to date
+ *
+ * @param table         The table to track visibility for (must be empty)
+ * @param peer_asns_th  Minimum number of peer ASNs that must observe an origin
+ *                      for it to be visible
+ * @return 0 if tracking was enabled successfully, -1 otherwise
+ *
+ * Tracking makes set and remove slightly more expensive (they maintain a
+ * count of peers for each prefix and origin), but the counters below can then
+ * be read in constant time.
+ */
+int bgpcorsaro_pfx_origins_track_visible(bgpcorsaro_pfx_origins_t *table,
+                                         uint32_t peer_asns_th);
+
+/** Get the number of prefixes that have at least one visible origin
+ *
+ * @param table         The table (which must be tracking visibility)
+ * @param version       The IP version to count prefixes for, or
+ *                      BGPSTREAM_ADDR_VERSION_UNKNOWN to count all prefixes
+ * @return the number of visible prefixes
+ */
+uint32_t
+bgpcorsaro_pfx_origins_get_visible_pfx_cnt(bgpcorsaro_pfx_origins_t *table,
+                                           bgpstream_addr_version_t version);
+
+/** Get the number of distinct origins that are visible for at least one
+ * prefix
+ *
+ * @param table         The table (which must be tracking visibility)
+ * @param version       The IP version of the prefixes to consider, or
+ *                      BGPSTREAM_ADDR_VERSION_UNKNOWN to consider all prefixes
+ * @return the number of visible origins
+ */
+uint32_t
+bgpcorsaro_pfx_origins_get_visible_origin_cnt(bgpcorsaro_pfx_origins_t *table,
+                                              bgpstream_addr_version_t version);
+
+/** Visit every prefix in the table, along with its visible origins
+ *
+ * @param table         The table to walk
+ * @param peer_asns_th  Minimum number of peer ASNs that must observe an origin
+ *                      for it to be visible
+ * @param fn            Function to call for each prefix
+ * @param user          User data to pass to fn
+ * @return 0 if the walk completed successfully, -1 otherwise
+ *
+ * The origins of all prefixes are grouped in a single pass over the table,
+ * so this costs time linear in the number of entries.
+ */
+int bgpcorsaro_pfx_origins_walk_visible(bgpcorsaro_pfx_origins_t *table,
+                                        uint32_t peer_asns_th,
+                                        bgpcorsaro_pfx_origins_visit_t *fn,
+                                        void *user);
+
+/** Remove every prefix (and all of its entries) that fn does not keep
+ *
+ * @param table         The table to filter
+ * @param fn            Function to call for each prefix
+ * @param user          User data to pass to fn
+ */
+void bgpcorsaro_pfx_origins_retain(bgpcorsaro_pfx_origins_t *table,
+                                   bgpcorsaro_pfx_origins_keep_t *fn,
+                                   void *user);
+
+/** Write the contents of the table to a checkpoint
+ *
+ * @param table         The table to write
+ * @param cp            The checkpoint to write to
+ * @return 0 if the table was written successfully, -1 otherwise
+ */
+int bgpcorsaro_pfx_origins_checkpoint(bgpcorsaro_pfx_origins_t *table,
+                                      bgpcorsaro_checkpoint_t *cp);
+
+/** Fill the table with the contents of a checkpoint
+ *
+ * @param table         The table to fill (must be empty)
+ * @param cp            The checkpoint to read from
+ * @return 0 if the table was read successfully, -1 otherwise
+ *
+ * If the table is tracking visibility, the counters are rebuilt as the
+ * entries are added.
+ */
+int bgpcorsaro_pfx_origins_restore(bgpcorsaro_pfx_origins_t *table,
+                                   bgpcorsaro_checkpoint_t *cp);
+
+#endif /* __BGPCORSARO_PFX_ORIGINS_H */
@@ -26,6 +26,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "utils.h"
 #include "parse_cmd.h"
@@ -43,6 +44,10 @@
 #include "bgpcorsaro_asmonitor.h"
 #endif
 
+#ifdef WITH_PLUGIN_ROUTINGTABLES
+#include "bgpcorsaro_routingtables.h"
+#endif
+
 #ifdef WITH_PLUGIN_PACIFIER
 #include "bgpcorsaro_pacifier.h"
 #endif
@@ -371,6 +376,29 @@ bgpcorsaro_plugin_next(bgpcorsaro_plugin_manager_t *manager,
   return plugin->next;
 }
 
+int bgpcorsaro_plugin_process_record(struct bgpcorsaro *bgpcorsaro,
+                                     bgpcorsaro_plugin_t *plugin,
+                                     struct bgpcorsaro_record *record)
+{
+  struct timespec start, end;
+  int rc;
+
+  if (bgpcorsaro->metrics == NULL) {
+    return plugin->process_record(bgpcorsaro, record);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  rc = plugin->process_record(bgpcorsaro, record);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  /* the metrics thread reads this concurrently */
+  __atomic_add_fetch(&plugin->process_record_ns,
+                     (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000 +
+                       end.tv_nsec - start.tv_nsec,
+                     __ATOMIC_RELAXED);
+  return rc;
+}
+
 void bgpcorsaro_plugin_register_state(bgpcorsaro_plugin_manager_t *manager,
                                       bgpcorsaro_plugin_t *plugin, void *state)
 {
@@ -25,6 +25,8 @@
 
 #include "bgpcorsaro_int.h"
 
+#include "bgpcorsaro_checkpoint.h"
+
 /** @file
  *
  * @brief Header file dealing with the bgpcorsaro plugin manager
@@ -48,14 +50,19 @@
   int plugin##_end_interval(struct bgpcorsaro *bgpcorsaro,                     \
                             struct bgpcorsaro_interval *int_end);              \
   int plugin##_process_record(struct bgpcorsaro *bgpcorsaro,                   \
-                              struct bgpcorsaro_record *record);
+                              struct bgpcorsaro_record *record);               \
+  int plugin##_checkpoint(struct bgpcorsaro *bgpcorsaro,                       \
+                          struct bgpcorsaro_checkpoint *cp);                   \
+  int plugin##_restore(struct bgpcorsaro *bgpcorsaro,                          \
+                       struct bgpcorsaro_checkpoint *cp);
 
 /** Convenience macro that defines all the function pointers for the bgpcorsaro
  * plugin API
  */
 #define BGPCORSARO_PLUGIN_GENERATE_PTRS(plugin)                                \
   plugin##_init_output, plugin##_close_output, plugin##_start_interval,        \
-    plugin##_end_interval, plugin##_process_record
+    plugin##_end_interval, plugin##_process_record, plugin##_checkpoint,       \
+    plugin##_restore
 
 /** Convenience macro that defines all the 'remaining' blank fields in a
  * bgpcorsaro
@@ -102,8 +109,11 @@ typedef enum bgpcorsaro_plugin_id {
   /** AS Monitor plugin */
   BGPCORSARO_PLUGIN_ID_ASMONITOR = 3,
 
+  /** Routing Tables plugin */
+  BGPCORSARO_PLUGIN_ID_ROUTINGTABLES = 4,
+
   /** Maximum plugin ID assigned */
-  BGPCORSARO_PLUGIN_ID_MAX = BGPCORSARO_PLUGIN_ID_ASMONITOR
+  BGPCORSARO_PLUGIN_ID_MAX = BGPCORSARO_PLUGIN_ID_ROUTINGTABLES
 } bgpcorsaro_plugin_id_t;
 
 /** An bgpcorsaro packet processing plugin */
@@ -167,6 +177,31 @@ typedef struct bgpcorsaro_plugin {
   int (*process_record)(struct bgpcorsaro *bgpcorsaro,
                         struct bgpcorsaro_record *record);
 
+  /** Write the state of the plugin to a checkpoint
+   *
+   * @param bgpcorsaro  The output object to write the state of
+   * @param cp          The checkpoint to write to
+   * @return 0 if successful, -1 if an error occurs
+   *
+   * This is called just after an interval has ended, and should write
+   * whatever state the plugin would otherwise need to rebuild from the stream
+   * (e.g. routing tables), using the bgpcorsaro_checkpoint_write_* functions.
+   */
+  int (*checkpoint)(struct bgpcorsaro *bgpcorsaro,
+                    struct bgpcorsaro_checkpoint *cp);
+
+  /** Restore the state of the plugin from a checkpoint
+   *
+   * @param bgpcorsaro  The output object to restore the state of
+   * @param cp          The checkpoint to read from
+   * @return 0 if successful, -1 if an error occurs
+   *
+   * This is called after init_output, and before the first interval is
+   * started. It should read back exactly what the checkpoint function wrote.
+   */
+  int (*restore)(struct bgpcorsaro *bgpcorsaro,
+                 struct bgpcorsaro_checkpoint *cp);
+
   /** Next pointer. Used by the plugin manager. */
   struct bgpcorsaro_plugin *next;
 
@@ -179,6 +214,10 @@ typedef struct bgpcorsaro_plugin {
    */
   char **argv;
 
+  /** Number of nsec spent in the process_record function (only maintained
+      when metrics are enabled, see bgpcorsaro_set_metrics) */
+  uint64_t process_record_ns;
+
 #ifdef WITH_PLUGIN_TIMING
   /* variables that hold timing information for this plugin */
 
@@ -284,6 +323,20 @@ bgpcorsaro_plugin_t *
 bgpcorsaro_plugin_next(bgpcorsaro_plugin_manager_t *manager,
                        bgpcorsaro_plugin_t *plugin);
 
+/** Ask the given plugin to process a record
+ *
+ * @param bgpcorsaro    The bgpcorsaro object the plugin belongs to
+ * @param plugin        The plugin to run
+ * @param record        The record to process
+ * @return the return value of the plugin's process_record function
+ *
+ * If metrics are enabled, the time taken by the plugin is added to its
+ * process_record_ns counter.
+ */
+int bgpcorsaro_plugin_process_record(struct bgpcorsaro *bgpcorsaro,
+                                     bgpcorsaro_plugin_t *plugin,
+                                     struct bgpcorsaro_record *record);
+
 /** Register the state for a plugin
  *
  * @param manager   The plugin manager to register state with
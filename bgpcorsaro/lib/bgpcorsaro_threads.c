@@ -0,0 +1,421 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bgpcorsaro_int.h"
+#include "config.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+#include "bgpcorsaro_elems.h"
+#include "bgpcorsaro_log.h"
+#include "bgpcorsaro_plugin.h"
+#include "bgpcorsaro_threads.h"
+
+/** @file
+ *
+ * @brief Code which runs bgpcorsaro plugins in their own threads
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Number of events that can be queued for the plugin threads */
+#define QUEUE_LEN 256
+
+/** Types of event that can be passed to the plugin threads */
+typedef enum {
+  EVENT_RECORD,
+  EVENT_START_INTERVAL,
+  EVENT_END_INTERVAL,
+  EVENT_STOP,
+} event_type_t;
+
+/** An entry in the shared event queue */
+typedef struct event {
+  /** Type of this event */
+  event_type_t type;
+
+  /** Number of plugin threads that have yet to process this event */
+  int refcnt;
+
+  /** Interval (for start and end interval events) */
+  bgpcorsaro_interval_t interval;
+
+  /** Record (for record events). This is allocated once, and owns the MRT
+      data of the record until the entry is re-used */
+  bgpstream_record_t *record;
+
+  /** Elems of the record (for record events), generated once and shared by
+      all plugin threads */
+  bgpcorsaro_elems_t *elems;
+} event_t;
+
+/** State for a single plugin thread */
+typedef struct worker {
+  /** Shared thread state */
+  struct bgpcorsaro_threads *threads;
+
+  /** Plugin that this thread runs */
+  bgpcorsaro_plugin_t *plugin;
+
+  /** Thread handle */
+  pthread_t thread;
+
+  /** Has the thread been started? */
+  int started;
+
+  /** Index of the next event to process */
+  uint64_t read_idx;
+
+  /** Record wrapper passed to the plugin */
+  bgpcorsaro_record_t record;
+
+  /** Plugin-local view of the current record. This shares the MRT data with
+      the queued record, but has its own elem generator (which is only used by
+      plugins that iterate over the bgpstream record directly) */
+  bgpstream_record_t *bsrecord;
+} worker_t;
+
+struct bgpcorsaro_threads {
+  /** The bgpcorsaro instance that the plugins belong to */
+  bgpcorsaro_t *bgpcorsaro;
+
+  /** Plugin threads */
+  worker_t *workers;
+
+  /** Number of plugin threads */
+  int workers_cnt;
+
+  /** Ring buffer of events */
+  event_t events[QUEUE_LEN];
+
+  /** Index of the next event to write */
+  uint64_t write_idx;
+
+  /** Set if any plugin has failed */
+  int failed;
+
+  /** Protects the indexes, reference counts and failed flag */
+  pthread_mutex_t mutex;
+
+  /** Signalled when a new event is queued */
+  pthread_cond_t queued;
+
+  /** Signalled when an event has been processed by all plugins */
+  pthread_cond_t consumed;
+};
+
+/** Move the MRT data (and attributes) from src into dst, leaving src empty */
+static void record_move(bgpstream_record_t *dst, bgpstream_record_t *src)
+{
+  bgpstream_record_clear(dst);
+  /* the elems generated from dst count towards the limits of the stream */
+  bgpstream_record_attach(dst, src->bs);
+  dst->bd_entry = src->bd_entry;
+  dst->attributes = src->attributes;
+  dst->status = src->status;
+  dst->dump_pos = src->dump_pos;
+
+  src->bd_entry = NULL;
+  bgpstream_record_clear(src);
+}
+
+/** Point the given view at the MRT data (and attributes) of src */
+static void record_share(bgpstream_record_t *view, bgpstream_record_t *src)
+{
+  /* the view never owns the MRT data */
+  view->bd_entry = NULL;
+  bgpstream_record_clear(view);
+  bgpstream_record_attach(view, src->bs);
+  view->bd_entry = src->bd_entry;
+  view->attributes = src->attributes;
+  view->status = src->status;
+  view->dump_pos = src->dump_pos;
+}
+
+static int process_event(worker_t *w, event_t *ev)
+{
+  bgpcorsaro_t *bgpcorsaro = w->threads->bgpcorsaro;
+  bgpcorsaro_plugin_t *p = w->plugin;
+
+  switch (ev->type) {
+  case EVENT_RECORD:
+    record_share(w->bsrecord, ev->record);
+    /* each plugin gets a fresh record state */
+    w->record.state.flags = 0;
+    w->record.elems = ev->elems;
+    w->record.elems_iter = 0;
+    if (bgpcorsaro_plugin_process_record(bgpcorsaro, p, &w->record) < 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to process record",
+                     p->name);
+      return -1;
+    }
+    break;
+
+  case EVENT_START_INTERVAL:
+    if (p->start_interval(bgpcorsaro, &ev->interval) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to start interval at %d",
+                     p->name, ev->interval.time);
+      return -1;
+    }
+    break;
+
+  case EVENT_END_INTERVAL:
+    if (p->end_interval(bgpcorsaro, &ev->interval) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "%s failed to end interval at %d",
+                     p->name, ev->interval.time);
+      return -1;
+    }
+    break;
+
+  case EVENT_STOP:
+    break;
+  }
+
+  return 0;
+}
+
+static void *worker_thread(void *user)
+{
+  worker_t *w = (worker_t *)user;
+  bgpcorsaro_threads_t *t = w->threads;
+  event_t *ev;
+  event_type_t type;
+  int failed = 0;
+
+  do {
+    pthread_mutex_lock(&t->mutex);
+    while (w->read_idx == t->write_idx) {
+      pthread_cond_wait(&t->queued, &t->mutex);
+    }
+    pthread_mutex_unlock(&t->mutex);
+
+    /* the event cannot change until we have released our reference */
+    ev = &t->events[w->read_idx % QUEUE_LEN];
+    type = ev->type;
+
+    /* once a plugin has failed, keep draining the queue so that the
+       producer is not blocked */
+    if (failed == 0 && process_event(w, ev) != 0) {
+      failed = 1;
+    }
+
+    pthread_mutex_lock(&t->mutex);
+    if (failed != 0) {
+      t->failed = 1;
+    }
+    w->read_idx++;
+    if (--ev->refcnt == 0) {
+      pthread_cond_broadcast(&t->consumed);
+    }
+    pthread_mutex_unlock(&t->mutex);
+  } while (type != EVENT_STOP);
+
+  return NULL;
+}
+
+/** Wait for the next event in the queue to be free */
+static event_t *queue_reserve(bgpcorsaro_threads_t *t)
+{
+  event_t *ev = &t->events[t->write_idx % QUEUE_LEN];
+
+  pthread_mutex_lock(&t->mutex);
+  while (ev->refcnt != 0) {
+    pthread_cond_wait(&t->consumed, &t->mutex);
+  }
+  pthread_mutex_unlock(&t->mutex);
+
+  return ev;
+}
+
+/** Pass the reserved event to the plugin threads */
+static int queue_push(bgpcorsaro_threads_t *t, event_t *ev, int wait)
+{
+  int failed;
+
+  pthread_mutex_lock(&t->mutex);
+  ev->refcnt = t->workers_cnt;
+  t->write_idx++;
+  pthread_cond_broadcast(&t->queued);
+  while (wait != 0 && ev->refcnt != 0) {
+    pthread_cond_wait(&t->consumed, &t->mutex);
+  }
+  failed = t->failed;
+  pthread_mutex_unlock(&t->mutex);
+
+  return failed != 0 ? -1 : 0;
+}
+
+static int queue_interval(bgpcorsaro_threads_t *t, event_type_t type,
+                          bgpcorsaro_interval_t *interval, int wait)
+{
+  event_t *ev = queue_reserve(t);
+  ev->type = type;
+  ev->interval = *interval;
+  return queue_push(t, ev, wait);
+}
+
+/* ========== PROTECTED FUNCTIONS ========== */
+
+bgpcorsaro_threads_t *bgpcorsaro_threads_start(bgpcorsaro_t *bgpcorsaro)
+{
+  bgpcorsaro_threads_t *t;
+  bgpcorsaro_plugin_t *p = NULL;
+  worker_t *w;
+  int i;
+
+  if ((t = malloc_zero(sizeof(bgpcorsaro_threads_t))) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not malloc thread state");
+    return NULL;
+  }
+  t->bgpcorsaro = bgpcorsaro;
+  pthread_mutex_init(&t->mutex, NULL);
+  pthread_cond_init(&t->queued, NULL);
+  pthread_cond_init(&t->consumed, NULL);
+
+  for (i = 0; i < QUEUE_LEN; i++) {
+    if ((t->events[i].record = bgpstream_record_create()) == NULL) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not create queue record");
+      goto err;
+    }
+    if ((t->events[i].elems = bgpcorsaro_elems_create()) == NULL) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not create queue elem list");
+      goto err;
+    }
+  }
+
+  t->workers_cnt = bgpcorsaro->plugin_manager->plugins_cnt;
+  if ((t->workers = malloc_zero(sizeof(worker_t) * t->workers_cnt)) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not malloc plugin threads");
+    goto err;
+  }
+
+  i = 0;
+  while ((p = bgpcorsaro_plugin_next(bgpcorsaro->plugin_manager, p)) != NULL) {
+    assert(i < t->workers_cnt);
+    w = &t->workers[i++];
+    w->threads = t;
+    w->plugin = p;
+    if ((w->bsrecord = bgpstream_record_create()) == NULL) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not create record for %s",
+                     p->name);
+      goto err;
+    }
+    w->record.bsrecord = w->bsrecord;
+  }
+  /* in case there were fewer plugins than we expected */
+  t->workers_cnt = i;
+
+  for (i = 0; i < t->workers_cnt; i++) {
+    w = &t->workers[i];
+    if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not start thread for %s",
+                     w->plugin->name);
+      goto err;
+    }
+    w->started = 1;
+  }
+
+  bgpcorsaro_log(__func__, bgpcorsaro, "started %d plugin threads",
+                 t->workers_cnt);
+  return t;
+
+err:
+  bgpcorsaro_threads_stop(t);
+  return NULL;
+}
+
+void bgpcorsaro_threads_stop(bgpcorsaro_threads_t *t)
+{
+  event_t *ev;
+  int i;
+
+  if (t == NULL) {
+    return;
+  }
+
+  if (t->workers != NULL) {
+    /* only the threads that were started will process the stop event */
+    for (i = 0; i < t->workers_cnt && t->workers[i].started != 0; i++)
+      ;
+    t->workers_cnt = i;
+    if (t->workers_cnt > 0) {
+      ev = queue_reserve(t);
+      ev->type = EVENT_STOP;
+      queue_push(t, ev, 0);
+    }
+    for (i = 0; i < t->workers_cnt; i++) {
+      pthread_join(t->workers[i].thread, NULL);
+    }
+    for (i = 0; i < t->workers_cnt; i++) {
+      if (t->workers[i].bsrecord != NULL) {
+        t->workers[i].bsrecord->bd_entry = NULL;
+        bgpstream_record_destroy(t->workers[i].bsrecord);
+      }
+    }
+    free(t->workers);
+  }
+
+  for (i = 0; i < QUEUE_LEN; i++) {
+    bgpstream_record_destroy(t->events[i].record);
+    bgpcorsaro_elems_destroy(t->events[i].elems);
+  }
+
+  pthread_mutex_destroy(&t->mutex);
+  pthread_cond_destroy(&t->queued);
+  pthread_cond_destroy(&t->consumed);
+  free(t);
+}
+
+int bgpcorsaro_threads_start_interval(bgpcorsaro_threads_t *t,
+                                      bgpcorsaro_interval_t *int_start)
+{
+  return queue_interval(t, EVENT_START_INTERVAL, int_start, 0);
+}
+
+int bgpcorsaro_threads_end_interval(bgpcorsaro_threads_t *t,
+                                    bgpcorsaro_interval_t *int_end)
+{
+  /* this is a barrier: plugins may do (e.g.) file rotation when the interval
+     ends, so wait until they are all done */
+  return queue_interval(t, EVENT_END_INTERVAL, int_end, 1);
+}
+
+int bgpcorsaro_threads_process_record(bgpcorsaro_threads_t *t,
+                                      bgpstream_record_t *bsrecord)
+{
+  event_t *ev = queue_reserve(t);
+  ev->type = EVENT_RECORD;
+  /* this frees the MRT data from the last time this event was used */
+  record_move(ev->record, bsrecord);
+  /* generate the elems here, once, rather than in every plugin thread */
+  if (bgpcorsaro_elems_populate(ev->elems, ev->record) != 0) {
+    bgpcorsaro_log(__func__, t->bgpcorsaro, "could not generate elems");
+    return -1;
+  }
+  return queue_push(t, ev, 0);
+}
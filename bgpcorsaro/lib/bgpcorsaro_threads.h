@@ -0,0 +1,101 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __BGPCORSARO_THREADS_H
+#define __BGPCORSARO_THREADS_H
+
+#include "config.h"
+
+#include "bgpcorsaro_int.h"
+
+/** @file
+ *
+ * @brief Header file dealing with running bgpcorsaro plugins in threads
+ *
+ * In threaded mode, each plugin runs in its own thread. Records (and interval
+ * boundaries) are passed to the plugin threads using a shared queue. Each
+ * queue entry is reference counted, and is re-used once every plugin has
+ * processed it.
+ *
+ * Every plugin sees the same sequence of start_interval, process_record and
+ * end_interval calls as in the non-threaded mode, but plugins are not run in
+ * any particular order relative to each other, so plugins cannot use the
+ * record state to pass information to each other.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Opaque struct holding the state for the plugin threads */
+typedef struct bgpcorsaro_threads bgpcorsaro_threads_t;
+
+/** Start one thread for each active plugin
+ *
+ * @param bgpcorsaro    The bgpcorsaro object to start threads for
+ * @return pointer to the thread state if successful, NULL otherwise
+ *
+ * This must be called after the plugins have initialized their output.
+ */
+bgpcorsaro_threads_t *bgpcorsaro_threads_start(bgpcorsaro_t *bgpcorsaro);
+
+/** Wait for the plugin threads to process all queued events and then stop
+ *  them
+ *
+ * @param threads       The thread state to stop and free
+ */
+void bgpcorsaro_threads_stop(bgpcorsaro_threads_t *threads);
+
+/** Queue a start interval event for each plugin
+ *
+ * @param threads       The plugin thread state
+ * @param int_start     The start structure for the interval
+ * @return 0 if successful, -1 if a plugin has failed
+ */
+int bgpcorsaro_threads_start_interval(bgpcorsaro_threads_t *threads,
+                                      bgpcorsaro_interval_t *int_start);
+
+/** Queue an end interval event for each plugin and wait for them all to
+ *  process it
+ *
+ * @param threads       The plugin thread state
+ * @param int_end       The end structure for the interval
+ * @return 0 if successful, -1 if a plugin has failed
+ *
+ * When this function returns, all plugins are idle, which allows the caller to
+ * (e.g.) rotate the log file.
+ */
+int bgpcorsaro_threads_end_interval(bgpcorsaro_threads_t *threads,
+                                    bgpcorsaro_interval_t *int_end);
+
+/** Hand the given record off to the plugin threads
+ *
+ * @param threads       The plugin thread state
+ * @param bsrecord      The record to queue
+ * @return 0 if successful, -1 if a plugin has failed
+ *
+ * The data for the record is moved into the queue, leaving the given record
+ * empty, so that it may be re-used as soon as this function returns.
+ */
+int bgpcorsaro_threads_process_record(bgpcorsaro_threads_t *threads,
+                                      bgpstream_record_t *bsrecord);
+
+#endif /* __BGPCORSARO_THREADS_H */
@@ -33,6 +33,7 @@
 
 #include "bgpcorsaro_io.h"
 #include "bgpcorsaro_log.h"
+#include "bgpcorsaro_pfx_origins.h"
 #include "bgpcorsaro_plugin.h"
 
 #include "bgpcorsaro_asmonitor.h"
@@ -110,18 +111,6 @@ KHASH_INIT(path_segments, bgpstream_as_path_seg_t *, char, 0,
            bgpstream_as_path_seg_hash, bgpstream_as_path_seg_equal);
 typedef khash_t(path_segments) path_segments_t;
 
-/** A map that contains, for each origin the number of peer ASns observing it */
-KHASH_INIT(asn_count_map, uint32_t, uint32_t, 1, kh_int_hash_func,
-           kh_int_hash_equal);
-
-/** A map that contains the origin observed by a specific peer */
-KHASH_INIT(peer_asn_map, uint32_t, uint32_t, 1, kh_int_hash_func,
-           kh_int_hash_equal);
-
-/** A map that contains information for each prefix */
-KHASH_INIT(pfx_info_map, bgpstream_pfx_storage_t, khash_t(peer_asn_map) *, 1,
-           bgpstream_pfx_storage_hash_val, bgpstream_pfx_storage_equal_val);
-
 /** Holds the state for an instance of this plugin */
 struct bgpcorsaro_asmonitor_state_t {
 
@@ -147,8 +136,8 @@ struct bgpcorsaro_asmonitor_state_t {
   /** Peers' ASNs */
   bgpstream_id_set_t *peer_asns;
 
-  /** Prefix info map */
-  khash_t(pfx_info_map) * pfx_info;
+  /** Origin ASN of each prefix, as observed by each peer ASN */
+  bgpcorsaro_pfx_origins_t *pfx_info;
 
   /** origins' set to compute unique origin
    *  ASns  */
@@ -219,98 +208,111 @@ void remove_old_prefixes(bgpstream_patricia_tree_t *pt,
   }
 }
 
+/** State passed to checkpoint_prefix */
+typedef struct checkpoint_walk {
+  /** The checkpoint being written */
+  bgpcorsaro_checkpoint_t *cp;
+
+  /** Set if writing a prefix failed */
+  int err;
+} checkpoint_walk_t;
+
+static void checkpoint_prefix(bgpstream_patricia_tree_t *pt,
+                              bgpstream_patricia_node_t *node, void *data)
+{
+  checkpoint_walk_t *walk = (checkpoint_walk_t *)data;
+  perpfx_info_t *info = (perpfx_info_t *)bgpstream_patricia_tree_get_user(node);
+  bgpstream_pfx_t *tree_pfx = bgpstream_patricia_tree_get_pfx(node);
+  bgpstream_pfx_storage_t pfx;
+
+  if (info == NULL || walk->err != 0) {
+    return;
+  }
+  memset(&pfx, 0, sizeof(pfx));
+  pfx.mask_len = tree_pfx->mask_len;
+  bgpstream_addr_copy((bgpstream_ip_addr_t *)&pfx.address, &tree_pfx->address);
+  if (bgpcorsaro_checkpoint_write_u8(walk->cp, 1) != 0 ||
+      bgpcorsaro_checkpoint_write_pfx(walk->cp, &pfx) != 0 ||
+      bgpcorsaro_checkpoint_write_u32(walk->cp, info->last_observed) != 0) {
+    walk->err = 1;
+  }
+}
+
 /* ================ output stats  ================ */
 
+/** Counters accumulated while walking the prefix origin table */
+typedef struct visible_cnt {
+  /** Number of prefixes (per IP version) with at least one visible origin */
+  uint32_t overlapping_pfxs[BGPSTREAM_MAX_IP_VERSION_IDX];
+
+  /** Sets of visible origin ASns (per IP version) */
+  bgpstream_id_set_t **unique_origins;
+} visible_cnt_t;
+
+static void count_visible(const bgpstream_pfx_storage_t *pfx,
+                          const uint32_t *origins, int origins_cnt, void *user)
+{
+  visible_cnt_t *cnt = (visible_cnt_t *)user;
+  int v;
+
+  /* the prefix (and its origins) are accounted only if they are consistent
+     on at least threshold peers' ASns */
+  if (origins_cnt == 0) {
+    return;
+  }
+  v = bgpstream_ipv2idx(pfx->address.version);
+  cnt->overlapping_pfxs[v]++;
+  bgpstream_id_set_insert_bulk(cnt->unique_origins[v], origins, origins_cnt);
+}
+
+/* keep only the prefixes that still overlap with the monitored space */
+static int keep_overlapping(const bgpstream_pfx_storage_t *pfx, void *user)
+{
+  struct bgpcorsaro_asmonitor_state_t *state =
+    (struct bgpcorsaro_asmonitor_state_t *)user;
+  uint8_t overlap;
+
+  overlap = bgpstream_patricia_tree_get_pfx_overlap_info(
+    state->patricia, (bgpstream_pfx_t *)pfx);
+  if (overlap == 0 ||
+      (state->more_specific && !(overlap & (BGPSTREAM_PATRICIA_LESS_SPECIFICS |
+                                            BGPSTREAM_PATRICIA_EXACT_MATCH)))) {
+    return 0;
+  }
+  return 1;
+}
+
 static int output_stats_and_reset(bgpcorsaro_t *bgpcorsaro)
 {
   struct bgpcorsaro_asmonitor_state_t *state = STATE(bgpcorsaro);
 
-  khiter_t k;
-  khiter_t p;
-  khiter_t a;
-  int khret;
-  uint8_t pfx_visible;
   int v;
   uint32_t unique_pfxs[BGPSTREAM_MAX_IP_VERSION_IDX];
-  uint32_t overlapping_pfxs[BGPSTREAM_MAX_IP_VERSION_IDX];
-  khash_t(peer_asn_map) * pam;
-  /* origin_asn -> num peer ASns*/
-  khash_t(asn_count_map) *asn_np = NULL;
-
-  if ((asn_np = kh_init(asn_count_map)) == NULL) {
-    return -1;
-  }
+  visible_cnt_t cnt;
 
   /* init counters */
   for (v = 0; v < BGPSTREAM_MAX_IP_VERSION_IDX; v++) {
     unique_pfxs[v] =
       bgpstream_patricia_prefix_count(state->patricia, bgpstream_idx2ipv(v));
-    overlapping_pfxs[v] = 0;
+    cnt.overlapping_pfxs[v] = 0;
   }
+  cnt.unique_origins = state->unique_origins;
 
-  /* for each prefix go through all peers */
-  for (k = kh_begin(state->pfx_info); k != kh_end(state->pfx_info); ++k) {
-    if (kh_exist(state->pfx_info, k) == 0) {
-      continue;
-    }
-    /* reset counters */
-    kh_clear(asn_count_map, asn_np);
-
-    /* get prefix version index */
-    v = bgpstream_ipv2idx(kh_key(state->pfx_info, k).address.version);
-
-    /* get peer-asn map for this prefix */
-    pam = kh_value(state->pfx_info, k);
-
-    /* save the origin asn visibility (i.e. how many peers' ASns
-     * observe such information */
-
-    /* for each peer, go through all origins */
-    for (p = kh_begin(pam); p != kh_end(pam); ++p) {
-      if (kh_exist(pam, p) == 0) {
-        continue;
-      }
-      /* increment the counter for this ASN */
-      if ((a = kh_get(asn_count_map, asn_np, kh_value(pam, p))) ==
-          kh_end(asn_np)) {
-        a = kh_put(asn_count_map, asn_np, kh_value(pam, p), &khret);
-        kh_value(asn_np, a) = 1;
-      } else {
-        kh_value(asn_np, a)++;
-      }
-    }
-
-    /* now asn_np has a complete count of the number of peers' ASns that
-       observed
-       each origin ASN */
-
-    /* count the prefix and origins if their visibility
-     * is above the threshold */
-    pfx_visible = 0;
-    for (a = kh_begin(asn_np); a != kh_end(asn_np); ++a) {
-      if (kh_exist(asn_np, a) == 0) {
-        continue;
-      }
-      /* the information is accounted only if it is
-       * consistent on at least threshold peers' ASns */
-      if (kh_value(asn_np, a) >= state->peer_asns_th) {
-        pfx_visible = 1;
-
-        bgpstream_id_set_insert(state->unique_origins[v], kh_key(asn_np, a));
-      }
-    }
-
-    /* updating counters */
-    overlapping_pfxs[v] += pfx_visible;
+  /* count the prefixes and origins that are visible from at least threshold
+     peers' ASns */
+  if (bgpcorsaro_pfx_origins_walk_visible(state->pfx_info, state->peer_asns_th,
+                                          count_visible, &cnt) != 0) {
+    return -1;
   }
 
   for (v = 0; v < BGPSTREAM_MAX_IP_VERSION_IDX; v++) {
     DUMP_METRIC(unique_pfxs[v], state->interval_start, "%s.%s.%s.v%d.%s",
                 state->metric_prefix, PLUGIN_NAME, state->ip_space_name,
                 bgpstream_idx2number(v), "prefixes_cnt");
-    DUMP_METRIC(overlapping_pfxs[v], state->interval_start, "%s.%s.%s.v%d.%s",
-                state->metric_prefix, PLUGIN_NAME, state->ip_space_name,
-                bgpstream_idx2number(v), "overlapping_prefixes_cnt");
+    DUMP_METRIC(cnt.overlapping_pfxs[v], state->interval_start,
+                "%s.%s.%s.v%d.%s", state->metric_prefix, PLUGIN_NAME,
+                state->ip_space_name, bgpstream_idx2number(v),
+                "overlapping_prefixes_cnt");
     DUMP_METRIC(bgpstream_id_set_size(state->unique_origins[v]),
                 state->interval_start, "%s.%s.%s.v%d.%s", state->metric_prefix,
                 PLUGIN_NAME, state->ip_space_name, bgpstream_idx2number(v),
@@ -328,25 +330,11 @@ static int output_stats_and_reset(bgpcorsaro_t *bgpcorsaro)
 
   /* now we check again all the stored prefixes and remove those
    * that do not overlap anymore */
-  uint8_t overlap;
-
-  for (k = kh_begin(state->pfx_info); k != kh_end(state->pfx_info); ++k) {
-    if (kh_exist(state->pfx_info, k)) {
-      overlap = bgpstream_patricia_tree_get_pfx_overlap_info(
-        state->patricia, (bgpstream_pfx_t *)&kh_key(state->pfx_info, k));
-      if (overlap == 0 || (state->more_specific &&
-                           !(overlap & (BGPSTREAM_PATRICIA_LESS_SPECIFICS |
-                                        BGPSTREAM_PATRICIA_EXACT_MATCH)))) {
-        kh_destroy(peer_asn_map, kh_val(state->pfx_info, k));
-        kh_del(pfx_info_map, state->pfx_info, k);
-      }
-    }
-  }
+  bgpcorsaro_pfx_origins_retain(state->pfx_info, keep_overlapping, state);
 
   for (v = 0; v < BGPSTREAM_MAX_IP_VERSION_IDX; v++) {
     bgpstream_id_set_clear(state->unique_origins[v]);
   }
-  kh_destroy(asn_count_map, asn_np);
 
   return 0;
 }
@@ -357,10 +345,6 @@ static int set_pfx_peer_origin(struct bgpcorsaro_asmonitor_state_t *state,
                                uint32_t peer_asn,
                                bgpstream_as_path_seg_t *origin_seg)
 {
-  khiter_t k;
-  int khret;
-  khash_t(peer_asn_map) * pam;
-
   if (origin_seg == NULL || origin_seg->type != BGPSTREAM_AS_PATH_SEG_ASN) {
     fprintf(stderr, "WARN: ignoring AS sets and confederations\n");
     return 0;
@@ -368,54 +352,8 @@ static int set_pfx_peer_origin(struct bgpcorsaro_asmonitor_state_t *state,
   /* simple origin ASN */
   uint32_t origin_asn = ((bgpstream_as_path_seg_asn_t *)origin_seg)->asn;
 
-  /* does the prefix already exist, if not, create it */
-  if ((k = kh_get(pfx_info_map, state->pfx_info, *pfx)) ==
-      kh_end(state->pfx_info)) {
-    /* no, insert it */
-    k = kh_put(pfx_info_map, state->pfx_info, *pfx, &khret);
-
-    /* create a peer-asn map */
-    if ((pam = kh_init(peer_asn_map)) == NULL) {
-      return -1;
-    }
-    kh_value(state->pfx_info, k) = pam;
-  } else {
-    pam = kh_value(state->pfx_info, k);
-  }
-
-  /* does the peer exist? ({pfx}{peer}), if not, create it */
-  if ((k = kh_get(peer_asn_map, pam, peer_asn)) == kh_end(pam)) {
-    k = kh_put(peer_asn_map, pam, peer_asn, &khret);
-  }
   /* set the origin ASN for this pfx/peer combo */
-  kh_value(pam, k) = origin_asn;
-
-  return 0;
-}
-
-/* remove pfx/peer from state */
-static void rm_pfx_peer(struct bgpcorsaro_asmonitor_state_t *state,
-                        const bgpstream_pfx_storage_t *pfx, uint32_t peer_asn)
-{
-  khiter_t k;
-  khash_t(peer_asn_map) * pam;
-
-  /* does the pfx exist? */
-  if ((k = kh_get(pfx_info_map, state->pfx_info, *pfx)) ==
-      kh_end(state->pfx_info)) {
-    return;
-  }
-  pam = kh_value(state->pfx_info, k);
-
-  /* does this peer exist for this pfx */
-  if ((k = kh_get(peer_asn_map, pam, peer_asn)) == kh_end(pam)) {
-    return;
-  }
-
-  /* deallocate memory for segment */
-  kh_del(peer_asn_map, pam, k);
-
-  return;
+  return bgpcorsaro_pfx_origins_set(state->pfx_info, pfx, peer_asn, origin_asn);
 }
 
 static int process_overlapping_pfx(struct bgpcorsaro_asmonitor_state_t *state,
@@ -426,7 +364,8 @@ static int process_overlapping_pfx(struct bgpcorsaro_asmonitor_state_t *state,
 
   if (elem->type == BGPSTREAM_ELEM_TYPE_WITHDRAWAL) {
     /* remove pfx/peer from state structure */
-    rm_pfx_peer(state, &elem->prefix, elem->peer_asnumber);
+    bgpcorsaro_pfx_origins_remove(state->pfx_info, &elem->prefix,
+                                  elem->peer_asnumber);
   } else /* (announcement or rib) */
   {
     /* get the origin asn segment and update the data structure */
@@ -571,6 +510,11 @@ static int parse_args(bgpcorsaro_t *bgpcorsaro)
     return -1;
   }
 
+  /* the monitored set is checked for every announcement */
+  if (bgpstream_id_set_freeze(state->monitored_ases) != 0) {
+    return -1;
+  }
+
   return 0;
 }
 
@@ -624,7 +568,7 @@ int bgpcorsaro_asmonitor_init_output(bgpcorsaro_t *bgpcorsaro)
   /* create all the sets and maps we need */
   if ((state->patricia = bgpstream_patricia_tree_create(perpfx_info_destroy)) ==
         NULL ||
-      (state->pfx_info = kh_init(pfx_info_map)) == NULL ||
+      (state->pfx_info = bgpcorsaro_pfx_origins_create()) == NULL ||
       (state->peer_asns = bgpstream_id_set_create()) == NULL) {
     goto err;
   }
@@ -649,8 +593,6 @@ int bgpcorsaro_asmonitor_close_output(bgpcorsaro_t *bgpcorsaro)
 {
   int i;
   struct bgpcorsaro_asmonitor_state_t *state = STATE(bgpcorsaro);
-  khiter_t k;
-  khash_t(peer_asn_map) * v;
 
   if (state == NULL) {
     return 0;
@@ -677,13 +619,7 @@ int bgpcorsaro_asmonitor_close_output(bgpcorsaro_t *bgpcorsaro)
   }
 
   if (state->pfx_info != NULL) {
-    for (k = kh_begin(state->pfx_info); k != kh_end(state->pfx_info); ++k) {
-      if (kh_exist(state->pfx_info, k)) {
-        v = kh_val(state->pfx_info, k);
-        kh_destroy(peer_asn_map, v);
-      }
-    }
-    kh_destroy(pfx_info_map, state->pfx_info);
+    bgpcorsaro_pfx_origins_destroy(state->pfx_info);
     state->pfx_info = NULL;
   }
 
@@ -779,7 +715,7 @@ int bgpcorsaro_asmonitor_process_record(bgpcorsaro_t *bgpcorsaro,
   }
 
   /* process all elems in the record */
-  while ((elem = bgpstream_record_get_next_elem(bs_record)) != NULL) {
+  while ((elem = bgpcorsaro_record_get_next_elem(record)) != NULL) {
     if (elem->type == BGPSTREAM_ELEM_TYPE_PEERSTATE) {
       continue;
     }
@@ -836,3 +772,52 @@ int bgpcorsaro_asmonitor_process_record(bgpcorsaro_t *bgpcorsaro,
 
   return 0;
 }
+
+/** Implements the checkpoint function of the plugin API */
+int bgpcorsaro_asmonitor_checkpoint(bgpcorsaro_t *bgpcorsaro,
+                                    bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_asmonitor_state_t *state = STATE(bgpcorsaro);
+  checkpoint_walk_t walk = {cp, 0};
+
+  /* the prefixes originated by the monitored ASes (terminated by a 0) */
+  bgpstream_patricia_tree_walk(state->patricia, checkpoint_prefix, &walk);
+  if (walk.err != 0 || bgpcorsaro_checkpoint_write_u8(cp, 0) != 0) {
+    return -1;
+  }
+
+  return bgpcorsaro_pfx_origins_checkpoint(state->pfx_info, cp);
+}
+
+/** Implements the restore function of the plugin API */
+int bgpcorsaro_asmonitor_restore(bgpcorsaro_t *bgpcorsaro,
+                                 bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_asmonitor_state_t *state = STATE(bgpcorsaro);
+  bgpstream_pfx_storage_t pfx;
+  bgpstream_patricia_node_t *n;
+  perpfx_info_t *info;
+  uint32_t ts;
+  uint8_t more;
+
+  while (1) {
+    if (bgpcorsaro_checkpoint_read_u8(cp, &more) != 0) {
+      return -1;
+    }
+    if (more == 0) {
+      break;
+    }
+    if (bgpcorsaro_checkpoint_read_pfx(cp, &pfx) != 0 ||
+        bgpcorsaro_checkpoint_read_u32(cp, &ts) != 0) {
+      return -1;
+    }
+    if ((n = bgpstream_patricia_tree_insert(state->patricia,
+                                            (bgpstream_pfx_t *)&pfx)) == NULL ||
+        (info = perpfx_info_create(ts)) == NULL) {
+      return -1;
+    }
+    bgpstream_patricia_tree_set_user(state->patricia, n, info);
+  }
+
+  return bgpcorsaro_pfx_origins_restore(state->pfx_info, cp);
+}
@@ -304,3 +304,19 @@ int bgpcorsaro_pacifier_process_record(bgpcorsaro_t *bgpcorsaro,
 
   return 0;
 }
+
+/** Implements the checkpoint function of the plugin API */
+int bgpcorsaro_pacifier_checkpoint(bgpcorsaro_t *bgpcorsaro,
+                                   bgpcorsaro_checkpoint_t *cp)
+{
+  /* pacing is relative to the wall time the process started at, so there is
+     nothing worth carrying across a restart */
+  return 0;
+}
+
+/** Implements the restore function of the plugin API */
+int bgpcorsaro_pacifier_restore(bgpcorsaro_t *bgpcorsaro,
+                                bgpcorsaro_checkpoint_t *cp)
+{
+  return 0;
+}
@@ -33,12 +33,12 @@
 
 #include "bgpcorsaro_io.h"
 #include "bgpcorsaro_log.h"
+#include "bgpcorsaro_pfx_origins.h"
 #include "bgpcorsaro_plugin.h"
 
 #include "bgpcorsaro_pfxmonitor.h"
 
 #include "bgpstream_utils.h"
-#include "khash.h"
 
 /** @file
  *
@@ -110,18 +110,6 @@ static char *graphite_safe(char *p)
   return r;
 }
 
-/** A map that contains, for each origin the number of peer ASns observing it */
-KHASH_INIT(asn_count_map, uint32_t, uint32_t, 1, kh_int_hash_func,
-           kh_int_hash_equal);
-
-/** A map that contains the origin observed by a specific peer */
-KHASH_INIT(peer_asn_map, uint32_t, uint32_t, 1, kh_int_hash_func,
-           kh_int_hash_equal);
-
-/** A map that contains information for each prefix */
-KHASH_INIT(pfx_info_map, bgpstream_pfx_storage_t, khash_t(peer_asn_map) *, 1,
-           bgpstream_pfx_storage_hash_val, bgpstream_pfx_storage_equal_val);
-
 /** Holds the state for an instance of this plugin */
 struct bgpcorsaro_pfxmonitor_state_t {
 
@@ -145,12 +133,8 @@ struct bgpcorsaro_pfxmonitor_state_t {
   /** Peers' ASNs */
   bgpstream_id_set_t *peer_asns;
 
-  /** Prefix info map */
-  khash_t(pfx_info_map) * pfx_info;
-
-  /** utility set to compute unique origin
-   *  ASns  */
-  bgpstream_id_set_t *unique_origins;
+  /** Origin ASN of each prefix, as observed by each peer ASN */
+  bgpcorsaro_pfx_origins_t *pfx_info;
 
   /* Peer threshold - minimum number of
    * peers' ASns to declare prefix visible */
@@ -179,144 +163,22 @@ struct bgpcorsaro_pfxmonitor_state_t {
 static int output_stats_and_reset(struct bgpcorsaro_pfxmonitor_state_t *state,
                                   uint32_t interval_start)
 {
-  khiter_t k;
-  khiter_t p;
-  khiter_t a;
-  int khret;
-  uint8_t pfx_visible;
-  uint32_t unique_pfxs = 0;
-  khash_t(peer_asn_map) * pam;
-  /* origin_asn -> num peer ASns*/
-  khash_t(asn_count_map) *asn_np = NULL;
-
-  if ((asn_np = kh_init(asn_count_map)) == NULL) {
-    return -1;
-  }
-
-  /* for each prefix go through all peers */
-  for (k = kh_begin(state->pfx_info); k != kh_end(state->pfx_info); ++k) {
-    if (kh_exist(state->pfx_info, k) == 0) {
-      continue;
-    }
-    /* reset counters */
-    kh_clear(asn_count_map, asn_np);
-
-    /* get peer-asn map for this prefix */
-    pam = kh_value(state->pfx_info, k);
-
-    /* save the origin asn visibility (i.e. how many peers' ASns
-     * observe such information */
-
-    /* for each peer, go through all origins */
-    for (p = kh_begin(pam); p != kh_end(pam); ++p) {
-      if (kh_exist(pam, p) == 0) {
-        continue;
-      }
-      /* increment the counter for this ASN */
-      if ((a = kh_get(asn_count_map, asn_np, kh_value(pam, p))) ==
-          kh_end(asn_np)) {
-        a = kh_put(asn_count_map, asn_np, kh_value(pam, p), &khret);
-        kh_value(asn_np, a) = 1;
-      } else {
-        kh_value(asn_np, a)++;
-      }
-    }
-
-    /* now asn_np has a complete count of the number of peers' ASns that
-       observed
-       each origin ASN */
-
-    /* count the prefix and origins if their visibility
-     * is above the threshold */
-    pfx_visible = 0;
-    for (a = kh_begin(asn_np); a != kh_end(asn_np); ++a) {
-      if (kh_exist(asn_np, a) == 0) {
-        continue;
-      }
-      /* the information is accounted only if it is
-       * consistent on at least threshold peers' ASns */
-      if (kh_value(asn_np, a) >= state->peer_asns_th) {
-        pfx_visible = 1;
-        bgpstream_id_set_insert(state->unique_origins, kh_key(asn_np, a));
-      }
-    }
-
-    /* updating counters */
-    unique_pfxs += pfx_visible;
-  }
-
-  DUMP_METRIC(unique_pfxs, state->interval_start, "%s.%s.%s.%s",
-              state->metric_prefix, PLUGIN_NAME, state->ip_space_name,
-              "prefixes_cnt");
+  /* the prefix origin table keeps track of the prefixes (and origins) that
+     are visible from at least threshold peers' ASns as it is updated, so
+     there is nothing to recompute here */
+  DUMP_METRIC(bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+                state->pfx_info, BGPSTREAM_ADDR_VERSION_UNKNOWN),
+              state->interval_start, "%s.%s.%s.%s", state->metric_prefix,
+              PLUGIN_NAME, state->ip_space_name, "prefixes_cnt");
 
-  DUMP_METRIC(bgpstream_id_set_size(state->unique_origins),
+  DUMP_METRIC(bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+                state->pfx_info, BGPSTREAM_ADDR_VERSION_UNKNOWN),
               state->interval_start, "%s.%s.%s.%s", state->metric_prefix,
               PLUGIN_NAME, state->ip_space_name, "origin_ASns_cnt");
 
-  bgpstream_id_set_clear(state->unique_origins);
-  kh_destroy(asn_count_map, asn_np);
-
   return 0;
 }
 
-/* set the origin ASN for a given prefix as observed by a given peer */
-static int set_pfx_peer_origin(struct bgpcorsaro_pfxmonitor_state_t *state,
-                               const bgpstream_pfx_storage_t *pfx,
-                               uint32_t peer_asn, uint32_t origin_asn)
-{
-  khiter_t k;
-  int khret;
-  khash_t(peer_asn_map) * pam;
-
-  /* does the prefix already exist, if not, create it */
-  if ((k = kh_get(pfx_info_map, state->pfx_info, *pfx)) ==
-      kh_end(state->pfx_info)) {
-    /* no, insert it */
-    k = kh_put(pfx_info_map, state->pfx_info, *pfx, &khret);
-
-    /* create a peer-asn map */
-    if ((pam = kh_init(peer_asn_map)) == NULL) {
-      return -1;
-    }
-    kh_value(state->pfx_info, k) = pam;
-  } else {
-    pam = kh_value(state->pfx_info, k);
-  }
-
-  /* does the peer exist? ({pfx}{peer}), if not, create it */
-  if ((k = kh_get(peer_asn_map, pam, peer_asn)) == kh_end(pam)) {
-    k = kh_put(peer_asn_map, pam, peer_asn, &khret);
-  }
-
-  /* set the origin ASN for this pfx/peer combo */
-  kh_value(pam, k) = origin_asn;
-  return 0;
-}
-
-/* remove pfx/peer from state */
-static void rm_pfx_peer(struct bgpcorsaro_pfxmonitor_state_t *state,
-                        const bgpstream_pfx_storage_t *pfx, uint32_t peer_asn)
-{
-  khiter_t k;
-  khash_t(peer_asn_map) * pam;
-
-  /* does the pfx exist? */
-  if ((k = kh_get(pfx_info_map, state->pfx_info, *pfx)) ==
-      kh_end(state->pfx_info)) {
-    return;
-  }
-  pam = kh_value(state->pfx_info, k);
-
-  /* does this peer exist for this pfx */
-  if ((k = kh_get(peer_asn_map, pam, peer_asn)) == kh_end(pam)) {
-    return;
-  }
-
-  kh_del(peer_asn_map, pam, k);
-
-  return;
-}
-
 static int process_overlapping_pfx(struct bgpcorsaro_pfxmonitor_state_t *state,
                                    const bgpstream_record_t *bs_record,
                                    const bgpstream_elem_t *elem)
@@ -327,7 +189,8 @@ static int process_overlapping_pfx(struct bgpcorsaro_pfxmonitor_state_t *state,
 
   if (elem->type == BGPSTREAM_ELEM_TYPE_WITHDRAWAL) {
     /* remove pfx/peer from state structure */
-    rm_pfx_peer(state, &elem->prefix, elem->peer_asnumber);
+    bgpcorsaro_pfx_origins_remove(state->pfx_info, &elem->prefix,
+                                  elem->peer_asnumber);
   } else /* (announcement or rib) */
   {
     /* get the origin asn (sets and confederations are ignored) */
@@ -337,8 +200,8 @@ static int process_overlapping_pfx(struct bgpcorsaro_pfxmonitor_state_t *state,
     } else {
       /* valid origin ASN */
       origin_asn = ((bgpstream_as_path_seg_asn_t *)origin_seg)->asn;
-      if (set_pfx_peer_origin(state, &elem->prefix, elem->peer_asnumber,
-                              origin_asn) != 0) {
+      if (bgpcorsaro_pfx_origins_set(state->pfx_info, &elem->prefix,
+                                     elem->peer_asnumber, origin_asn) != 0) {
         return -1;
       }
     }
@@ -534,8 +397,9 @@ int bgpcorsaro_pfxmonitor_init_output(bgpcorsaro_t *bgpcorsaro)
         NULL ||
       (state->non_overlapping_pfx_cache = bgpstream_pfx_storage_set_create()) ==
         NULL ||
-      (state->pfx_info = kh_init(pfx_info_map)) == NULL ||
-      (state->unique_origins = bgpstream_id_set_create()) == NULL ||
+      (state->pfx_info = bgpcorsaro_pfx_origins_create()) == NULL ||
+      bgpcorsaro_pfx_origins_track_visible(state->pfx_info,
+                                           state->peer_asns_th) != 0 ||
       (state->peer_asns = bgpstream_id_set_create()) == NULL) {
     goto err;
   }
@@ -554,8 +418,6 @@ int bgpcorsaro_pfxmonitor_close_output(bgpcorsaro_t *bgpcorsaro)
 {
   int i;
   struct bgpcorsaro_pfxmonitor_state_t *state = STATE(bgpcorsaro);
-  khiter_t k;
-  khash_t(peer_asn_map) * v;
 
   if (state == NULL) {
     return 0;
@@ -591,21 +453,10 @@ int bgpcorsaro_pfxmonitor_close_output(bgpcorsaro_t *bgpcorsaro)
   }
 
   if (state->pfx_info != NULL) {
-    for (k = kh_begin(state->pfx_info); k != kh_end(state->pfx_info); ++k) {
-      if (kh_exist(state->pfx_info, k)) {
-        v = kh_val(state->pfx_info, k);
-        kh_destroy(peer_asn_map, v);
-      }
-    }
-    kh_destroy(pfx_info_map, state->pfx_info);
+    bgpcorsaro_pfx_origins_destroy(state->pfx_info);
     state->pfx_info = NULL;
   }
 
-  if (state->unique_origins != NULL) {
-    bgpstream_id_set_destroy(state->unique_origins);
-    state->unique_origins = NULL;
-  }
-
   bgpcorsaro_plugin_free_state(bgpcorsaro->plugin_manager, PLUGIN(bgpcorsaro));
   return 0;
 }
@@ -687,7 +538,7 @@ int bgpcorsaro_pfxmonitor_process_record(bgpcorsaro_t *bgpcorsaro,
   }
 
   /* process all elems in the record */
-  while ((elem = bgpstream_record_get_next_elem(bs_record)) != NULL) {
+  while ((elem = bgpcorsaro_record_get_next_elem(record)) != NULL) {
     if (elem->type != BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT &&
         elem->type != BGPSTREAM_ELEM_TYPE_WITHDRAWAL &&
         elem->type != BGPSTREAM_ELEM_TYPE_RIB) {
@@ -735,3 +586,23 @@ int bgpcorsaro_pfxmonitor_process_record(bgpcorsaro_t *bgpcorsaro,
 
   return 0;
 }
+
+/** Implements the checkpoint function of the plugin API */
+int bgpcorsaro_pfxmonitor_checkpoint(bgpcorsaro_t *bgpcorsaro,
+                                     bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_pfxmonitor_state_t *state = STATE(bgpcorsaro);
+
+  /* the prefixes of interest come from the arguments, and the caches are
+     rebuilt as prefixes are seen, so only the origins need to be saved */
+  return bgpcorsaro_pfx_origins_checkpoint(state->pfx_info, cp);
+}
+
+/** Implements the restore function of the plugin API */
+int bgpcorsaro_pfxmonitor_restore(bgpcorsaro_t *bgpcorsaro,
+                                  bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_pfxmonitor_state_t *state = STATE(bgpcorsaro);
+
+  return bgpcorsaro_pfx_origins_restore(state->pfx_info, cp);
+}
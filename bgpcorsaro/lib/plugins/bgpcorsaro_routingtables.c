@@ -0,0 +1,1186 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "bgpcorsaro_int.h"
+#include "config.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "wandio_utils.h"
+
+#include "bgpcorsaro_io.h"
+#include "bgpcorsaro_log.h"
+#include "bgpcorsaro_plugin.h"
+
+#include "bgpcorsaro_routingtables.h"
+
+#include "bgpstream_utils.h"
+#include "bgpstream_utils_as_path_store.h"
+#include "bgpstream_utils_peer_sig_map.h"
+#include "khash.h"
+
+/** @file
+ *
+ * @brief Bgpcorsaro RoutingTables plugin implementation
+ *
+ * Maintains the routing table of every peer, using RIB dumps and updates,
+ * and writes the changes to each table at the end of every interval.
+ *
+ * Output lines have the format:
+ * <time>|<collector>|<peer ASN>|<peer IP>|<type>|<prefix or state>|<path>
+ * where type is one of:
+ *  - A: the route to the prefix was added or changed
+ *  - W: the route to the prefix was withdrawn
+ *  - S: the state of the peer changed
+ *  - R: the route is part of a snapshot of all tables
+ *
+ * @author Alistair King
+ *
+ */
+
+/** The number of output file pointers to support non-blocking close at the end
+    of an interval. If the wandio buffers are large enough that it takes more
+    than 1 interval to drain the buffers, consider increasing this number */
+#define OUTFILE_POINTERS 2
+
+/** The name of this plugin */
+#define PLUGIN_NAME "routingtables"
+
+/** The version of this plugin */
+#define PLUGIN_VERSION "0.1"
+
+/** Maximum string length for an output line */
+#define MAX_LINE_LEN 4096
+
+/** Number of dirty routes to allocate at a time */
+#define DIRTY_ALLOC_STEP 1024
+
+/** Is the route currently in the table? */
+#define ROUTE_PRESENT 0x01
+
+/** Was the route in the table at the start of the interval? */
+#define ROUTE_WAS_PRESENT 0x02
+
+/** Has the route been changed in this interval? */
+#define ROUTE_DIRTY 0x04
+
+/** Are the given path IDs equal? */
+#define PATH_ID_EQUAL(a, b)                                                    \
+  ((a).path_hash == (b).path_hash && (a).path_id == (b).path_id)
+
+/** Common plugin information across all instances */
+static bgpcorsaro_plugin_t bgpcorsaro_routingtables_plugin = {
+  PLUGIN_NAME,                                               /* name */
+  PLUGIN_VERSION,                                            /* version */
+  BGPCORSARO_PLUGIN_ID_ROUTINGTABLES,                        /* id */
+  BGPCORSARO_PLUGIN_GENERATE_PTRS(bgpcorsaro_routingtables), /* func ptrs */
+  BGPCORSARO_PLUGIN_GENERATE_TAIL,
+};
+
+/** A route to a prefix, as observed by a peer */
+typedef struct route {
+  /** ID of the current AS path (if ROUTE_PRESENT) */
+  bgpstream_as_path_store_path_id_t path_id;
+
+  /** ID of the AS path at the start of the interval (if ROUTE_WAS_PRESENT) */
+  bgpstream_as_path_store_path_id_t prev_path_id;
+
+  /** Time of the last change to this route */
+  uint32_t ts;
+
+  /** ROUTE_* flags */
+  uint8_t flags;
+} route_t;
+
+/** Map from prefix to route */
+KHASH_INIT(route_map, bgpstream_pfx_storage_t, route_t, 1,
+           bgpstream_pfx_storage_hash_val, bgpstream_pfx_storage_equal_val);
+
+/** Map from prefix to path ID (for RIB dumps in progress) */
+KHASH_INIT(rib_map, bgpstream_pfx_storage_t, bgpstream_as_path_store_path_id_t,
+           1, bgpstream_pfx_storage_hash_val, bgpstream_pfx_storage_equal_val);
+
+/** State for a collector */
+typedef struct collector {
+  /** Name of the collector */
+  char name[BGPSTREAM_UTILS_STR_NAME_LEN];
+
+  /** Is a RIB dump being read for this collector? */
+  int rib_in_progress;
+
+  /** Time of the RIB dump being read */
+  uint32_t rib_time;
+
+  /** Time of the last RIB dump that could not be read completely (the rest
+      of which is ignored), or 0 */
+  uint32_t rib_broken_time;
+} collector_t;
+
+/** State for a peer */
+typedef struct peer {
+  /** Index of the collector this peer belongs to */
+  int collector_idx;
+
+  /** Current state of the BGP session */
+  bgpstream_elem_peerstate_t state;
+
+  /** State of the BGP session at the start of the interval */
+  bgpstream_elem_peerstate_t prev_state;
+
+  /** Routing table of this peer */
+  khash_t(route_map) * routes;
+
+  /** Routes from the RIB dump in progress (NULL if there is none) */
+  khash_t(rib_map) * rib;
+} peer_t;
+
+/** A route that has changed in this interval */
+typedef struct dirty_route {
+  /** Peer that observed the route */
+  bgpstream_peer_id_t peer_id;
+
+  /** Prefix of the route */
+  bgpstream_pfx_storage_t pfx;
+} dirty_route_t;
+
+/** Holds the state for an instance of this plugin */
+struct bgpcorsaro_routingtables_state_t {
+  /** The outfile for the plugin */
+  iow_t *outfile;
+  /** A set of pointers to outfiles to support non-blocking close */
+  iow_t *outfile_p[OUTFILE_POINTERS];
+  /** The current outfile */
+  int outfile_n;
+
+  /** Time at which the current interval started */
+  uint32_t interval_start;
+
+  /** Number of intervals that have ended */
+  uint32_t intervals_cnt;
+
+  /** Write a snapshot of all tables every n intervals (0 to disable) */
+  uint32_t snapshot_intervals;
+
+  /** Peer signature -> peer ID */
+  bgpstream_peer_sig_map_t *peer_sigs;
+
+  /** Store of all AS paths */
+  bgpstream_as_path_store_t *path_store;
+
+  /** Peers, indexed by peer ID */
+  peer_t **peers;
+
+  /** Number of entries allocated in the peers array */
+  int peers_alloc_cnt;
+
+  /** Collectors */
+  collector_t *collectors;
+
+  /** Number of collectors */
+  int collectors_cnt;
+
+  /** Index into collectors for each bgpstream collector ID (-1 if the ID has
+      not been seen yet) */
+  int *collector_ids;
+
+  /** Number of entries allocated in the collector_ids array */
+  int collector_ids_cnt;
+
+  /** Routes that have changed in this interval */
+  dirty_route_t *dirty;
+
+  /** Number of routes in the dirty list */
+  uint32_t dirty_cnt;
+
+  /** Number of entries allocated in the dirty list */
+  uint32_t dirty_alloc_cnt;
+};
+
+/** Extends the generic plugin state convenience macro in bgpcorsaro_plugin.h */
+#define STATE(bgpcorsaro)                                                      \
+  (BGPCORSARO_PLUGIN_STATE(bgpcorsaro, routingtables,                          \
+                           BGPCORSARO_PLUGIN_ID_ROUTINGTABLES))
+
+/** Extends the generic plugin plugin convenience macro in bgpcorsaro_plugin.h
+ */
+#define PLUGIN(bgpcorsaro)                                                     \
+  (BGPCORSARO_PLUGIN_PLUGIN(bgpcorsaro, BGPCORSARO_PLUGIN_ID_ROUTINGTABLES))
+
+/* ================ table management ================ */
+
+static int get_collector_idx(struct bgpcorsaro_routingtables_state_t *state,
+                             const char *name)
+{
+  collector_t *tmp;
+  int i;
+
+  /* there are only ever a handful of collectors */
+  for (i = 0; i < state->collectors_cnt; i++) {
+    if (strcmp(state->collectors[i].name, name) == 0) {
+      return i;
+    }
+  }
+
+  if ((tmp = realloc(state->collectors,
+                     sizeof(collector_t) * (state->collectors_cnt + 1))) ==
+      NULL) {
+    return -1;
+  }
+  state->collectors = tmp;
+  tmp = &state->collectors[state->collectors_cnt];
+  memset(tmp, 0, sizeof(collector_t));
+  strncpy(tmp->name, name, BGPSTREAM_UTILS_STR_NAME_LEN - 1);
+  return state->collectors_cnt++;
+}
+
+/* same as get_collector_idx, but avoids comparing names for every record */
+static int get_record_collector_idx(
+  struct bgpcorsaro_routingtables_state_t *state, bgpstream_record_t *record)
+{
+  bgpstream_str_id_t id = record->attributes.dump_collector_id;
+  int *tmp;
+  int i;
+
+  if (id < state->collector_ids_cnt && state->collector_ids[id] >= 0) {
+    return state->collector_ids[id];
+  }
+
+  if (id >= state->collector_ids_cnt) {
+    if ((tmp = realloc(state->collector_ids, sizeof(int) * (id + 1))) ==
+        NULL) {
+      return -1;
+    }
+    state->collector_ids = tmp;
+    for (i = state->collector_ids_cnt; i <= id; i++) {
+      state->collector_ids[i] = -1;
+    }
+    state->collector_ids_cnt = id + 1;
+  }
+
+  /* collectors restored from a checkpoint are only known by name */
+  return state->collector_ids[id] =
+           get_collector_idx(state, record->attributes.dump_collector);
+}
+
+static peer_t *get_peer(struct bgpcorsaro_routingtables_state_t *state,
+                        int collector_idx, bgpstream_addr_storage_t *peer_ip,
+                        uint32_t peer_asn, bgpstream_peer_id_t *peer_id)
+{
+  peer_t **tmp;
+  peer_t *peer;
+  int i;
+
+  if ((*peer_id = bgpstream_peer_sig_map_get_id(
+         state->peer_sigs, state->collectors[collector_idx].name,
+         (bgpstream_ip_addr_t *)peer_ip, peer_asn)) == 0) {
+    return NULL;
+  }
+
+  if (*peer_id >= state->peers_alloc_cnt) {
+    if ((tmp = realloc(state->peers, sizeof(peer_t *) * (*peer_id + 1))) ==
+        NULL) {
+      return NULL;
+    }
+    state->peers = tmp;
+    for (i = state->peers_alloc_cnt; i <= *peer_id; i++) {
+      state->peers[i] = NULL;
+    }
+    state->peers_alloc_cnt = *peer_id + 1;
+  }
+
+  if ((peer = state->peers[*peer_id]) != NULL) {
+    return peer;
+  }
+
+  if ((peer = malloc_zero(sizeof(peer_t))) == NULL) {
+    return NULL;
+  }
+  if ((peer->routes = kh_init(route_map)) == NULL) {
+    free(peer);
+    return NULL;
+  }
+  peer->collector_idx = collector_idx;
+  peer->state = peer->prev_state = BGPSTREAM_ELEM_PEERSTATE_UNKNOWN;
+  state->peers[*peer_id] = peer;
+  return peer;
+}
+
+static void peer_destroy(peer_t *peer)
+{
+  if (peer == NULL) {
+    return;
+  }
+  kh_destroy(route_map, peer->routes);
+  if (peer->rib != NULL) {
+    kh_destroy(rib_map, peer->rib);
+  }
+  free(peer);
+}
+
+/** Update (or withdraw if path_id is NULL) the route to a prefix */
+static int set_route(struct bgpcorsaro_routingtables_state_t *state,
+                     bgpstream_peer_id_t peer_id,
+                     const bgpstream_pfx_storage_t *pfx,
+                     bgpstream_as_path_store_path_id_t *path_id, uint32_t ts)
+{
+  peer_t *peer = state->peers[peer_id];
+  dirty_route_t *tmp;
+  route_t *route;
+  khiter_t k;
+  int khret;
+
+  if ((k = kh_get(route_map, peer->routes, *pfx)) == kh_end(peer->routes)) {
+    if (path_id == NULL) {
+      /* withdrawal of a route we never had */
+      return 0;
+    }
+    k = kh_put(route_map, peer->routes, *pfx, &khret);
+    if (khret < 0) {
+      return -1;
+    }
+    memset(&kh_value(peer->routes, k), 0, sizeof(route_t));
+  }
+  route = &kh_value(peer->routes, k);
+
+  if (path_id != NULL) {
+    route->path_id = *path_id;
+    route->flags |= ROUTE_PRESENT;
+  } else {
+    route->flags &= ~ROUTE_PRESENT;
+  }
+  route->ts = ts;
+
+  if ((route->flags & ROUTE_DIRTY) != 0) {
+    return 0;
+  }
+
+  /* remember that this route needs to be checked at the end of the
+     interval */
+  if (state->dirty_cnt == state->dirty_alloc_cnt) {
+    if ((tmp = realloc(state->dirty,
+                       sizeof(dirty_route_t) *
+                         (state->dirty_alloc_cnt + DIRTY_ALLOC_STEP))) ==
+        NULL) {
+      return -1;
+    }
+    state->dirty = tmp;
+    state->dirty_alloc_cnt += DIRTY_ALLOC_STEP;
+  }
+  state->dirty[state->dirty_cnt].peer_id = peer_id;
+  state->dirty[state->dirty_cnt].pfx = *pfx;
+  state->dirty_cnt++;
+  route->flags |= ROUTE_DIRTY;
+  return 0;
+}
+
+/** Withdraw all the routes of a peer (e.g. when the session goes down) */
+static int clear_routes(struct bgpcorsaro_routingtables_state_t *state,
+                        bgpstream_peer_id_t peer_id, uint32_t ts)
+{
+  peer_t *peer = state->peers[peer_id];
+  khiter_t k;
+
+  for (k = kh_begin(peer->routes); k != kh_end(peer->routes); ++k) {
+    if (kh_exist(peer->routes, k) &&
+        (kh_value(peer->routes, k).flags & ROUTE_PRESENT) != 0 &&
+        set_route(state, peer_id, &kh_key(peer->routes, k), NULL, ts) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/** Discard the routes read so far from a RIB dump of the given collector */
+static void rib_clear(struct bgpcorsaro_routingtables_state_t *state,
+                      int collector_idx)
+{
+  int i;
+
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    if (state->peers[i] != NULL &&
+        state->peers[i]->collector_idx == collector_idx &&
+        state->peers[i]->rib != NULL) {
+      kh_clear(rib_map, state->peers[i]->rib);
+    }
+  }
+}
+
+/** Start reading a RIB dump for the given collector */
+static void rib_start(struct bgpcorsaro_routingtables_state_t *state,
+                      int collector_idx, uint32_t rib_time)
+{
+  /* discard any partial dump that never finished */
+  rib_clear(state, collector_idx);
+
+  state->collectors[collector_idx].rib_in_progress = 1;
+  state->collectors[collector_idx].rib_time = rib_time;
+}
+
+/** Give up on the RIB dump being read for the given collector. The rest of
+    the dump must be ignored too: it would otherwise be taken for a new dump,
+    and applying it would withdraw every route in the part that was lost */
+static void rib_abort(struct bgpcorsaro_routingtables_state_t *state,
+                      int collector_idx, uint32_t rib_time)
+{
+  rib_clear(state, collector_idx);
+
+  state->collectors[collector_idx].rib_in_progress = 0;
+  state->collectors[collector_idx].rib_broken_time = rib_time;
+}
+
+/** Add a route from a RIB dump */
+static int rib_add(peer_t *peer, const bgpstream_pfx_storage_t *pfx,
+                   bgpstream_as_path_store_path_id_t *path_id)
+{
+  khiter_t k;
+  int khret;
+
+  if (peer->rib == NULL && (peer->rib = kh_init(rib_map)) == NULL) {
+    return -1;
+  }
+  k = kh_put(rib_map, peer->rib, *pfx, &khret);
+  if (khret < 0) {
+    return -1;
+  }
+  kh_value(peer->rib, k) = *path_id;
+  return 0;
+}
+
+/** Replace the tables of the peers of a collector with the RIB dump, keeping
+    any changes from updates that are newer than the dump */
+static int rib_end(struct bgpcorsaro_routingtables_state_t *state,
+                   int collector_idx)
+{
+  collector_t *c = &state->collectors[collector_idx];
+  peer_t *peer;
+  route_t *route;
+  khiter_t k, r;
+  int i;
+
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    if ((peer = state->peers[i]) == NULL || peer->collector_idx != collector_idx) {
+      continue;
+    }
+
+    /* routes that are in the dump */
+    if (peer->rib != NULL) {
+      for (k = kh_begin(peer->rib); k != kh_end(peer->rib); ++k) {
+        if (kh_exist(peer->rib, k) == 0) {
+          continue;
+        }
+        r = kh_get(route_map, peer->routes, kh_key(peer->rib, k));
+        if (r != kh_end(peer->routes) &&
+            kh_value(peer->routes, r).ts > c->rib_time) {
+          /* an update has changed this route since the dump */
+          continue;
+        }
+        if (r != kh_end(peer->routes) &&
+            (kh_value(peer->routes, r).flags & ROUTE_PRESENT) != 0 &&
+            PATH_ID_EQUAL(kh_value(peer->routes, r).path_id,
+                          kh_value(peer->rib, k))) {
+          /* no change */
+          kh_value(peer->routes, r).ts = c->rib_time;
+          continue;
+        }
+        if (set_route(state, i, &kh_key(peer->rib, k), &kh_value(peer->rib, k),
+                      c->rib_time) != 0) {
+          return -1;
+        }
+      }
+    }
+
+    /* routes that are not in the dump (and have not been updated since) */
+    for (r = kh_begin(peer->routes); r != kh_end(peer->routes); ++r) {
+      if (kh_exist(peer->routes, r) == 0) {
+        continue;
+      }
+      route = &kh_value(peer->routes, r);
+      if (route->ts >= c->rib_time) {
+        continue;
+      }
+      if ((route->flags & ROUTE_PRESENT) != 0) {
+        if (set_route(state, i, &kh_key(peer->routes, r), NULL, c->rib_time) !=
+            0) {
+          return -1;
+        }
+      } else if ((route->flags & ROUTE_DIRTY) == 0) {
+        /* old withdrawals are no longer needed to override the dump */
+        kh_del(route_map, peer->routes, r);
+      }
+    }
+
+    if (peer->rib != NULL) {
+      if (kh_size(peer->rib) > 0) {
+        /* the peer was up when the dump was taken */
+        peer->state = BGPSTREAM_ELEM_PEERSTATE_ESTABLISHED;
+      }
+      kh_destroy(rib_map, peer->rib);
+      peer->rib = NULL;
+    }
+  }
+
+  c->rib_in_progress = 0;
+  return 0;
+}
+
+/* ================ output ================ */
+
+static int path_snprintf(char *buf, size_t len,
+                         struct bgpcorsaro_routingtables_state_t *state,
+                         bgpstream_as_path_store_path_id_t path_id,
+                         uint32_t peer_asn)
+{
+  bgpstream_as_path_store_path_t *spath;
+  bgpstream_as_path_store_path_iter_t iter;
+  bgpstream_as_path_seg_t *seg;
+  size_t written = 0;
+  int first = 1;
+
+  buf[0] = '\0';
+  if ((spath = bgpstream_as_path_store_get_store_path(state->path_store,
+                                                      path_id)) == NULL) {
+    return -1;
+  }
+
+  bgpstream_as_path_store_path_iter_reset(spath, &iter, peer_asn);
+  while ((seg = bgpstream_as_path_store_path_get_next_seg(&iter)) != NULL) {
+    if (first == 0 && written < len - 1) {
+      buf[written++] = ' ';
+      buf[written] = '\0';
+    }
+    first = 0;
+    if (written < len) {
+      written += bgpstream_as_path_seg_snprintf(buf + written,
+                                                len - written, seg);
+    }
+  }
+
+  return written >= len ? -1 : 0;
+}
+
+/** Write a single output line for a peer */
+static void write_line(struct bgpcorsaro_routingtables_state_t *state,
+                       bgpstream_peer_id_t peer_id, char type,
+                       const char *what, const char *path)
+{
+  bgpstream_peer_sig_t *sig;
+  char ip_str[INET6_ADDRSTRLEN] = "";
+
+  sig = bgpstream_peer_sig_map_get_sig(state->peer_sigs, peer_id);
+  assert(sig != NULL);
+  bgpstream_addr_ntop(ip_str, INET6_ADDRSTRLEN, &sig->peer_ip_addr);
+
+  wandio_printf(state->outfile, "%" PRIu32 "|%s|%" PRIu32 "|%s|%c|%s|%s\n",
+                state->interval_start, sig->collector_str, sig->peer_asnumber,
+                ip_str, type, what, path);
+}
+
+/** Write the state changes of all peers */
+static void write_peer_states(struct bgpcorsaro_routingtables_state_t *state)
+{
+  char state_str[MAX_LINE_LEN];
+  peer_t *peer;
+  int i;
+
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    if ((peer = state->peers[i]) == NULL || peer->state == peer->prev_state) {
+      continue;
+    }
+    bgpstream_elem_peerstate_snprintf(state_str, MAX_LINE_LEN, peer->state);
+    write_line(state, i, 'S', state_str, "");
+    peer->prev_state = peer->state;
+  }
+}
+
+/** Write the routes that have changed in this interval, and reset the change
+    tracking */
+static void write_diffs(struct bgpcorsaro_routingtables_state_t *state)
+{
+  char pfx_str[INET6_ADDRSTRLEN + 4];
+  char path_str[MAX_LINE_LEN];
+  dirty_route_t *d;
+  peer_t *peer;
+  route_t *route;
+  khiter_t k;
+  uint32_t i;
+  int present, was_present;
+
+  for (i = 0; i < state->dirty_cnt; i++) {
+    d = &state->dirty[i];
+    peer = state->peers[d->peer_id];
+    k = kh_get(route_map, peer->routes, d->pfx);
+    assert(k != kh_end(peer->routes));
+    route = &kh_value(peer->routes, k);
+
+    present = (route->flags & ROUTE_PRESENT) != 0;
+    was_present = (route->flags & ROUTE_WAS_PRESENT) != 0;
+
+    /* only write routes that differ from the start of the interval */
+    if (present != 0 &&
+        (was_present == 0 ||
+         !PATH_ID_EQUAL(route->path_id, route->prev_path_id))) {
+      bgpstream_pfx_snprintf(pfx_str, sizeof(pfx_str),
+                             (bgpstream_pfx_t *)&d->pfx);
+      path_snprintf(path_str, MAX_LINE_LEN, state, route->path_id,
+                    bgpstream_peer_sig_map_get_sig(state->peer_sigs,
+                                                   d->peer_id)
+                      ->peer_asnumber);
+      write_line(state, d->peer_id, 'A', pfx_str, path_str);
+    } else if (present == 0 && was_present != 0) {
+      bgpstream_pfx_snprintf(pfx_str, sizeof(pfx_str),
+                             (bgpstream_pfx_t *)&d->pfx);
+      write_line(state, d->peer_id, 'W', pfx_str, "");
+    }
+
+    route->flags &= ~(ROUTE_DIRTY | ROUTE_WAS_PRESENT);
+    if (present != 0) {
+      route->flags |= ROUTE_WAS_PRESENT;
+      route->prev_path_id = route->path_id;
+    } else if (state->collectors[peer->collector_idx].rib_in_progress == 0) {
+      /* the withdrawal may still be needed to override a RIB dump that is
+         being read, otherwise it can go */
+      kh_del(route_map, peer->routes, k);
+    }
+  }
+
+  state->dirty_cnt = 0;
+}
+
+/** Write every route in every table */
+static void write_snapshot(struct bgpcorsaro_routingtables_state_t *state)
+{
+  char pfx_str[INET6_ADDRSTRLEN + 4];
+  char path_str[MAX_LINE_LEN];
+  bgpstream_peer_sig_t *sig;
+  peer_t *peer;
+  khiter_t k;
+  int i;
+
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    if ((peer = state->peers[i]) == NULL) {
+      continue;
+    }
+    sig = bgpstream_peer_sig_map_get_sig(state->peer_sigs, i);
+    for (k = kh_begin(peer->routes); k != kh_end(peer->routes); ++k) {
+      if (kh_exist(peer->routes, k) == 0 ||
+          (kh_value(peer->routes, k).flags & ROUTE_PRESENT) == 0) {
+        continue;
+      }
+      bgpstream_pfx_snprintf(pfx_str, sizeof(pfx_str),
+                             (bgpstream_pfx_t *)&kh_key(peer->routes, k));
+      path_snprintf(path_str, MAX_LINE_LEN, state,
+                    kh_value(peer->routes, k).path_id, sig->peer_asnumber);
+      write_line(state, i, 'R', pfx_str, path_str);
+    }
+  }
+}
+
+/* ================ elem processing ================ */
+
+static int process_elem(struct bgpcorsaro_routingtables_state_t *state,
+                        int collector_idx, bgpstream_elem_t *elem)
+{
+  bgpstream_as_path_store_path_id_t path_id;
+  bgpstream_peer_id_t peer_id;
+  peer_t *peer;
+
+  if ((peer = get_peer(state, collector_idx, &elem->peer_address,
+                       elem->peer_asnumber, &peer_id)) == NULL) {
+    return -1;
+  }
+
+  switch (elem->type) {
+  case BGPSTREAM_ELEM_TYPE_RIB:
+    if (bgpstream_as_path_store_get_path_id(state->path_store, elem->aspath,
+                                            elem->peer_asnumber,
+                                            &path_id) != 0) {
+      return -1;
+    }
+    return rib_add(peer, &elem->prefix, &path_id);
+
+  case BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT:
+    if (bgpstream_as_path_store_get_path_id(state->path_store, elem->aspath,
+                                            elem->peer_asnumber,
+                                            &path_id) != 0) {
+      return -1;
+    }
+    /* receiving routes means the session is up */
+    peer->state = BGPSTREAM_ELEM_PEERSTATE_ESTABLISHED;
+    return set_route(state, peer_id, &elem->prefix, &path_id, elem->timestamp);
+
+  case BGPSTREAM_ELEM_TYPE_WITHDRAWAL:
+    return set_route(state, peer_id, &elem->prefix, NULL, elem->timestamp);
+
+  case BGPSTREAM_ELEM_TYPE_PEERSTATE:
+    peer->state = elem->new_state;
+    if (elem->new_state != BGPSTREAM_ELEM_PEERSTATE_ESTABLISHED) {
+      /* the session went down, so all of its routes are gone */
+      return clear_routes(state, peer_id, elem->timestamp);
+    }
+    return 0;
+
+  default:
+    return 0;
+  }
+}
+
+/** Print usage information to stderr */
+static void usage(bgpcorsaro_plugin_t *plugin)
+{
+  fprintf(stderr,
+          "plugin usage: %s [-s <intervals>]\n"
+          "       -s <intervals>     write a snapshot of all routing tables "
+          "every n intervals (default: 0, disabled)\n",
+          plugin->argv[0]);
+}
+
+/** Parse the arguments given to the plugin */
+static int parse_args(bgpcorsaro_t *bgpcorsaro)
+{
+  bgpcorsaro_plugin_t *plugin = PLUGIN(bgpcorsaro);
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+  int opt;
+
+  if (plugin->argc <= 0) {
+    return 0;
+  }
+
+  /* NB: remember to reset optind to 1 before using getopt! */
+  optind = 1;
+
+  while ((opt = getopt(plugin->argc, plugin->argv, ":s:?")) >= 0) {
+    switch (opt) {
+    case 's':
+      state->snapshot_intervals = atoi(optarg);
+      break;
+    case '?':
+    case ':':
+    default:
+      usage(plugin);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* == PUBLIC PLUGIN FUNCS BELOW HERE == */
+
+/** Implements the alloc function of the plugin API */
+bgpcorsaro_plugin_t *bgpcorsaro_routingtables_alloc(bgpcorsaro_t *bgpcorsaro)
+{
+  return &bgpcorsaro_routingtables_plugin;
+}
+
+/** Implements the init_output function of the plugin API */
+int bgpcorsaro_routingtables_init_output(bgpcorsaro_t *bgpcorsaro)
+{
+  struct bgpcorsaro_routingtables_state_t *state;
+  bgpcorsaro_plugin_t *plugin = PLUGIN(bgpcorsaro);
+  assert(plugin != NULL);
+
+  if ((state = malloc_zero(sizeof(struct bgpcorsaro_routingtables_state_t))) ==
+      NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro,
+                   "could not malloc bgpcorsaro_routingtables_state_t");
+    goto err;
+  }
+  bgpcorsaro_plugin_register_state(bgpcorsaro->plugin_manager, plugin, state);
+
+  /* parse the arguments */
+  if (parse_args(bgpcorsaro) != 0) {
+    goto err;
+  }
+
+  if ((state->peer_sigs = bgpstream_peer_sig_map_create()) == NULL ||
+      (state->path_store = bgpstream_as_path_store_create()) == NULL) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not create peer/path maps");
+    goto err;
+  }
+
+  /* defer opening the output file until we start the first interval */
+
+  return 0;
+
+err:
+  bgpcorsaro_routingtables_close_output(bgpcorsaro);
+  return -1;
+}
+
+/** Implements the close_output function of the plugin API */
+int bgpcorsaro_routingtables_close_output(bgpcorsaro_t *bgpcorsaro)
+{
+  int i;
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+
+  if (state == NULL) {
+    return 0;
+  }
+
+  /* close all the outfile pointers */
+  for (i = 0; i < OUTFILE_POINTERS; i++) {
+    if (state->outfile_p[i] != NULL) {
+      wandio_wdestroy(state->outfile_p[i]);
+      state->outfile_p[i] = NULL;
+    }
+  }
+  state->outfile = NULL;
+
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    peer_destroy(state->peers[i]);
+  }
+  free(state->peers);
+  state->peers = NULL;
+
+  free(state->collectors);
+  state->collectors = NULL;
+
+  free(state->collector_ids);
+  state->collector_ids = NULL;
+
+  free(state->dirty);
+  state->dirty = NULL;
+
+  if (state->peer_sigs != NULL) {
+    bgpstream_peer_sig_map_destroy(state->peer_sigs);
+    state->peer_sigs = NULL;
+  }
+
+  if (state->path_store != NULL) {
+    bgpstream_as_path_store_destroy(state->path_store);
+    state->path_store = NULL;
+  }
+
+  bgpcorsaro_plugin_free_state(bgpcorsaro->plugin_manager, PLUGIN(bgpcorsaro));
+  return 0;
+}
+
+/** Implements the start_interval function of the plugin API */
+int bgpcorsaro_routingtables_start_interval(bgpcorsaro_t *bgpcorsaro,
+                                            bgpcorsaro_interval_t *int_start)
+{
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+
+  /* open an output file */
+  if (state->outfile == NULL) {
+    if ((state->outfile_p[state->outfile_n] = bgpcorsaro_io_prepare_file(
+           bgpcorsaro, PLUGIN(bgpcorsaro)->name, int_start)) == NULL) {
+      bgpcorsaro_log(__func__, bgpcorsaro, "could not open %s output file",
+                     PLUGIN(bgpcorsaro)->name);
+      return -1;
+    }
+    state->outfile = state->outfile_p[state->outfile_n];
+  }
+
+  bgpcorsaro_io_write_interval_start(bgpcorsaro, state->outfile, int_start);
+
+  state->interval_start = int_start->time;
+
+  return 0;
+}
+
+/** Implements the end_interval function of the plugin API */
+int bgpcorsaro_routingtables_end_interval(bgpcorsaro_t *bgpcorsaro,
+                                          bgpcorsaro_interval_t *int_end)
+{
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+
+  write_peer_states(state);
+  write_diffs(state);
+
+  state->intervals_cnt++;
+  if (state->snapshot_intervals > 0 &&
+      state->intervals_cnt % state->snapshot_intervals == 0) {
+    write_snapshot(state);
+  }
+
+  bgpcorsaro_io_write_interval_end(bgpcorsaro, state->outfile, int_end);
+
+  /* if we are rotating, now is when we should do it */
+  if (bgpcorsaro_is_rotate_interval(bgpcorsaro)) {
+    /* leave the current file to finish draining buffers */
+    assert(state->outfile != NULL);
+
+    /* move on to the next output pointer */
+    state->outfile_n = (state->outfile_n + 1) % OUTFILE_POINTERS;
+
+    if (state->outfile_p[state->outfile_n] != NULL) {
+      /* we're gonna have to wait for this to close */
+      wandio_wdestroy(state->outfile_p[state->outfile_n]);
+      state->outfile_p[state->outfile_n] = NULL;
+    }
+
+    state->outfile = NULL;
+  }
+
+  return 0;
+}
+
+/** Implements the process_record function of the plugin API */
+int bgpcorsaro_routingtables_process_record(bgpcorsaro_t *bgpcorsaro,
+                                            bgpcorsaro_record_t *record)
+{
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+  bgpstream_record_t *bs_record = BS_REC(record);
+  bgpstream_elem_t *elem;
+  int collector_idx;
+  int is_rib;
+
+  /* no point carrying on if a previous plugin has already decided we should
+     ignore this record */
+  if ((record->state.flags & BGPCORSARO_RECORD_STATE_FLAG_IGNORE) != 0) {
+    return 0;
+  }
+
+  if ((collector_idx = get_record_collector_idx(state, bs_record)) < 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not add collector");
+    return -1;
+  }
+
+  is_rib = bs_record->attributes.dump_type == BGPSTREAM_RIB;
+
+  /* the rest of a RIB dump that could not be read completely */
+  if (is_rib != 0 && state->collectors[collector_idx].rib_broken_time != 0 &&
+      state->collectors[collector_idx].rib_broken_time ==
+        bs_record->attributes.dump_time) {
+    return 0;
+  }
+
+  /* a new RIB dump is starting (a dump may also consist of only one record,
+     in which case we never see the start) */
+  if (is_rib != 0 &&
+      (bs_record->dump_pos == BGPSTREAM_DUMP_START ||
+       state->collectors[collector_idx].rib_in_progress == 0 ||
+       state->collectors[collector_idx].rib_time !=
+         bs_record->attributes.dump_time)) {
+    rib_start(state, collector_idx, bs_record->attributes.dump_time);
+  }
+
+  if (bs_record->status == BGPSTREAM_RECORD_STATUS_VALID_RECORD) {
+    while ((elem = bgpcorsaro_record_get_next_elem(record)) != NULL) {
+      if (process_elem(state, collector_idx, elem) != 0) {
+        bgpcorsaro_log(__func__, bgpcorsaro, "could not update routing tables");
+        return -1;
+      }
+    }
+  } else if (is_rib != 0) {
+    /* don't trust a RIB dump that we could not read completely */
+    rib_abort(state, collector_idx, bs_record->attributes.dump_time);
+    return 0;
+  }
+
+  if (is_rib != 0 && bs_record->dump_pos == BGPSTREAM_DUMP_END &&
+      state->collectors[collector_idx].rib_in_progress != 0 &&
+      rib_end(state, collector_idx) != 0) {
+    bgpcorsaro_log(__func__, bgpcorsaro, "could not apply RIB dump");
+    return -1;
+  }
+
+  return 0;
+}
+
+/** Implements the checkpoint function of the plugin API */
+int bgpcorsaro_routingtables_checkpoint(bgpcorsaro_t *bgpcorsaro,
+                                        bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+  bgpstream_as_path_store_path_t *spath;
+  bgpstream_peer_sig_t *sig;
+  uint8_t *path_data;
+  uint16_t path_len;
+  uint32_t routes_cnt;
+  peer_t *peer;
+  route_t *route;
+  khiter_t k;
+  int i;
+
+  if (bgpcorsaro_checkpoint_write_u32(cp, state->intervals_cnt) != 0) {
+    return -1;
+  }
+
+  /* path IDs are only meaningful within this store, so write the store, and
+     refer to paths by their index in it */
+  if (bgpcorsaro_checkpoint_write_u32(
+        cp, bgpstream_as_path_store_get_size(state->path_store)) != 0) {
+    return -1;
+  }
+  for (bgpstream_as_path_store_iter_first_path(state->path_store);
+       bgpstream_as_path_store_iter_has_more_path(state->path_store);
+       bgpstream_as_path_store_iter_next_path(state->path_store)) {
+    spath = bgpstream_as_path_store_iter_get_path(state->path_store);
+    path_len = bgpstream_as_path_get_data(
+      bgpstream_as_path_store_path_get_int_path(spath), &path_data);
+    if (bgpcorsaro_checkpoint_write_u32(
+          cp, bgpstream_as_path_store_path_get_idx(spath)) != 0 ||
+        bgpcorsaro_checkpoint_write_u8(
+          cp, bgpstream_as_path_store_path_is_core(spath)) != 0 ||
+        bgpcorsaro_checkpoint_write_u16(cp, path_len) != 0 ||
+        bgpcorsaro_checkpoint_write_bytes(cp, path_data, path_len) != 0) {
+      return -1;
+    }
+  }
+
+  /* the tables of each peer (terminated by a 0). the interval has just ended,
+     so the only routes that are not present are withdrawals kept for a RIB
+     dump in progress, and partial dumps are not saved */
+  for (i = 0; i < state->peers_alloc_cnt; i++) {
+    if ((peer = state->peers[i]) == NULL) {
+      continue;
+    }
+    sig = bgpstream_peer_sig_map_get_sig(state->peer_sigs, i);
+
+    routes_cnt = 0;
+    for (k = kh_begin(peer->routes); k != kh_end(peer->routes); ++k) {
+      if (kh_exist(peer->routes, k) &&
+          (kh_value(peer->routes, k).flags & ROUTE_PRESENT) != 0) {
+        routes_cnt++;
+      }
+    }
+
+    if (bgpcorsaro_checkpoint_write_u8(cp, 1) != 0 ||
+        bgpcorsaro_checkpoint_write_str(cp, sig->collector_str) != 0 ||
+        bgpcorsaro_checkpoint_write_addr(cp, &sig->peer_ip_addr) != 0 ||
+        bgpcorsaro_checkpoint_write_u32(cp, sig->peer_asnumber) != 0 ||
+        bgpcorsaro_checkpoint_write_u8(cp, peer->state) != 0 ||
+        bgpcorsaro_checkpoint_write_u32(cp, routes_cnt) != 0) {
+      return -1;
+    }
+
+    for (k = kh_begin(peer->routes); k != kh_end(peer->routes); ++k) {
+      if (kh_exist(peer->routes, k) == 0 ||
+          ((route = &kh_value(peer->routes, k))->flags & ROUTE_PRESENT) == 0) {
+        continue;
+      }
+      spath = bgpstream_as_path_store_get_store_path(state->path_store,
+                                                     route->path_id);
+      if (bgpcorsaro_checkpoint_write_pfx(cp, &kh_key(peer->routes, k)) != 0 ||
+          bgpcorsaro_checkpoint_write_u32(
+            cp, bgpstream_as_path_store_path_get_idx(spath)) != 0 ||
+          bgpcorsaro_checkpoint_write_u32(cp, route->ts) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  return bgpcorsaro_checkpoint_write_u8(cp, 0);
+}
+
+/** Implements the restore function of the plugin API */
+int bgpcorsaro_routingtables_restore(bgpcorsaro_t *bgpcorsaro,
+                                     bgpcorsaro_checkpoint_t *cp)
+{
+  struct bgpcorsaro_routingtables_state_t *state = STATE(bgpcorsaro);
+  bgpstream_as_path_store_path_id_t *path_ids = NULL;
+  uint8_t *path_data = NULL;
+  char collector[BGPSTREAM_UTILS_STR_NAME_LEN];
+  bgpstream_addr_storage_t peer_ip;
+  bgpstream_pfx_storage_t pfx;
+  bgpstream_peer_id_t peer_id;
+  uint32_t paths_cnt, routes_cnt;
+  uint32_t peer_asn, idx, ts;
+  uint16_t path_len;
+  uint8_t is_core, more, peer_state;
+  int collector_idx;
+  peer_t *peer;
+  route_t *route;
+  khiter_t k;
+  uint32_t i;
+  int khret;
+
+  if (bgpcorsaro_checkpoint_read_u32(cp, &state->intervals_cnt) != 0 ||
+      bgpcorsaro_checkpoint_read_u32(cp, &paths_cnt) != 0) {
+    goto err;
+  }
+
+  /* re-insert the paths, remembering the (new) ID of each index */
+  if ((paths_cnt > 0 &&
+       (path_ids = malloc_zero(sizeof(bgpstream_as_path_store_path_id_t) *
+                               paths_cnt)) == NULL) ||
+      (path_data = malloc(UINT16_MAX)) == NULL) {
+    goto err;
+  }
+  for (i = 0; i < paths_cnt; i++) {
+    if (bgpcorsaro_checkpoint_read_u32(cp, &idx) != 0 || idx >= paths_cnt ||
+        bgpcorsaro_checkpoint_read_u8(cp, &is_core) != 0 ||
+        bgpcorsaro_checkpoint_read_u16(cp, &path_len) != 0 ||
+        bgpcorsaro_checkpoint_read_bytes(cp, path_data, path_len) != 0 ||
+        bgpstream_as_path_store_insert_path(state->path_store, path_data,
+                                            path_len, is_core,
+                                            &path_ids[idx]) != 0) {
+      goto err;
+    }
+  }
+
+  while (1) {
+    if (bgpcorsaro_checkpoint_read_u8(cp, &more) != 0) {
+      goto err;
+    }
+    if (more == 0) {
+      break;
+    }
+    if (bgpcorsaro_checkpoint_read_str(cp, collector, sizeof(collector)) !=
+          0 ||
+        bgpcorsaro_checkpoint_read_addr(cp, &peer_ip) != 0 ||
+        bgpcorsaro_checkpoint_read_u32(cp, &peer_asn) != 0 ||
+        bgpcorsaro_checkpoint_read_u8(cp, &peer_state) != 0 ||
+        bgpcorsaro_checkpoint_read_u32(cp, &routes_cnt) != 0) {
+      goto err;
+    }
+    if ((collector_idx = get_collector_idx(state, collector)) < 0 ||
+        (peer = get_peer(state, collector_idx, &peer_ip, peer_asn,
+                         &peer_id)) == NULL) {
+      goto err;
+    }
+    /* state changes up to the checkpoint have already been written */
+    peer->state = peer->prev_state = peer_state;
+
+    for (i = 0; i < routes_cnt; i++) {
+      if (bgpcorsaro_checkpoint_read_pfx(cp, &pfx) != 0 ||
+          bgpcorsaro_checkpoint_read_u32(cp, &idx) != 0 || idx >= paths_cnt ||
+          bgpcorsaro_checkpoint_read_u32(cp, &ts) != 0) {
+        goto err;
+      }
+      k = kh_put(route_map, peer->routes, pfx, &khret);
+      if (khret < 0) {
+        goto err;
+      }
+      route = &kh_value(peer->routes, k);
+      route->path_id = route->prev_path_id = path_ids[idx];
+      route->ts = ts;
+      route->flags = ROUTE_PRESENT | ROUTE_WAS_PRESENT;
+    }
+  }
+
+  free(path_ids);
+  free(path_data);
+  return 0;
+
+err:
+  bgpcorsaro_log(__func__, bgpcorsaro, "could not restore routing tables");
+  free(path_ids);
+  free(path_data);
+  return -1;
+}
@@ -32,6 +32,7 @@
 #include "utils.h"
 
 #include "bgpcorsaro.h"
+#include "bgpcorsaro_int.h"
 #include "bgpcorsaro_log.h"
 
 /** @file
@@ -60,6 +61,9 @@ struct window {
 /* default gap limit */
 #define GAP_LIMIT_DEFAULT 0
 
+/* default number of seconds between metrics reports */
+#define METRICS_INTERVAL_DEFAULT 10
+
 /** Maximum allowed packet inter-arrival time */
 static int gap_limit = GAP_LIMIT_DEFAULT;
 
@@ -79,6 +83,9 @@ static bgpstream_record_t *record = NULL;
 /** A pointer to the instance of bgpcorsaro that we will drive */
 static bgpcorsaro_t *bgpcorsaro = NULL;
 
+/** A pointer to the metrics emitter (if enabled) */
+static bgpstream_metrics_t *metrics = NULL;
+
 /** The id associated with the bgpstream data interface  */
 static bgpstream_data_interface_id_t datasource_id_default = 0;
 static bgpstream_data_interface_id_t datasource_id = 0;
@@ -95,6 +102,9 @@ static void catch_sigint(int sig)
 
   fprintf(stderr, "caught SIGINT, shutting down at the next opportunity\n");
 
+  // don't keep waiting for new data in live mode
+  bgpstream_interrupt(stream);
+
   signal(sig, catch_sigint);
 }
 
@@ -106,6 +116,10 @@ static void clean()
     record = NULL;
   }
 
+  /* the metrics thread looks at the plugins, so stop it first */
+  bgpstream_metrics_destroy(metrics);
+  metrics = NULL;
+
   if (bgpcorsaro != NULL) {
     bgpcorsaro_finalize_output(bgpcorsaro);
   }
@@ -204,8 +218,17 @@ static void usage()
     "   -g <gap-limit> maximum allowed gap between packets (0 is no limit) "
     "(default: %d)\n"
     "   -L             disable logging to a file\n"
+    "   -T             run each plugin in its own thread\n"
+    "   -s <file>      save plugin state to <file>, and restore it (resuming\n"
+    "                   after the saved interval) if <file> exists\n"
+    "   -S <intervals> save plugin state every n intervals (default: 1)\n"
+    "   -M <dest>[,<interval>]\n"
+    "                  report metrics every <interval> seconds (default: %d)\n"
+    "                   to <dest>, which is either a file to write in the\n"
+    "                   Prometheus text format, or udp://<host>:<port> to\n"
+    "                   send them to a statsd server\n"
     "\n",
-    BGPCORSARO_INTERVAL_DEFAULT, GAP_LIMIT_DEFAULT);
+    BGPCORSARO_INTERVAL_DEFAULT, GAP_LIMIT_DEFAULT, METRICS_INTERVAL_DEFAULT);
   fprintf(stderr, "   -x <plugin>    enable the given plugin (default: all)*\n"
                   "                   available plugins:\n");
 
@@ -255,6 +278,12 @@ int main(int argc, char *argv[])
   int rotate = 0;
   int meta_rotate = -1;
   int logfile_disable = 0;
+  int threads_enable = 0;
+  char *checkpoint_file = NULL;
+  int checkpoint_intervals = 1;
+  uint32_t resume_time = 0;
+  char *metrics_dest = NULL;
+  int metrics_interval = METRICS_INTERVAL_DEFAULT;
 
   bgpstream_data_interface_option_t *option;
 
@@ -301,7 +330,7 @@ int main(int argc, char *argv[])
 
   while (prevoptind = optind,
          (opt = getopt(argc, argv,
-                       ":d:o:p:c:t:w:j:k:y:P:i:ag:lLx:n:O:r:R:hv?")) >= 0) {
+                       ":d:o:p:c:t:w:j:k:y:P:i:ag:lLTs:S:M:x:n:O:r:R:hv?")) >= 0) {
     if (optind == prevoptind + 2 && (optarg == NULL || *optarg == '-')) {
       opt = ':';
       --optind;
@@ -440,6 +469,26 @@ int main(int argc, char *argv[])
       logfile_disable = 1;
       break;
 
+    case 'T':
+      threads_enable = 1;
+      break;
+
+    case 's':
+      checkpoint_file = strdup(optarg);
+      break;
+
+    case 'S':
+      checkpoint_intervals = atoi(optarg);
+      break;
+
+    case 'M':
+      metrics_dest = strdup(optarg);
+      if ((endp = strchr(metrics_dest, ',')) != NULL) {
+        *endp = '\0';
+        metrics_interval = atoi(endp + 1);
+      }
+      break;
+
     case 'n':
       name = strdup(optarg);
       break;
@@ -585,11 +634,27 @@ int main(int argc, char *argv[])
     bgpcorsaro_disable_logfile(bgpcorsaro);
   }
 
+  if (threads_enable != 0) {
+    bgpcorsaro_enable_threads(bgpcorsaro);
+  }
+
+  if (checkpoint_file != NULL &&
+      bgpcorsaro_set_checkpoint(bgpcorsaro, checkpoint_file,
+                                checkpoint_intervals) != 0) {
+    fprintf(stderr, "ERROR: Could not enable checkpoints\n");
+    usage();
+    goto err;
+  }
+
   if (bgpcorsaro_start_output(bgpcorsaro) != 0) {
     usage();
     goto err;
   }
 
+  /* if state was restored, there is no need to process the data before the
+     checkpoint again */
+  resume_time = bgpcorsaro_get_resume_time(bgpcorsaro);
+
   /* create a record buffer */
   if (record == NULL && (record = bgpstream_record_create()) == NULL) {
     fprintf(stderr, "ERROR: Could not create BGPStream record\n");
@@ -620,13 +685,23 @@ int main(int argc, char *argv[])
   /* windows */
   int minimum_time = 0;
   int current_time = 0;
+  int windows_left = 0;
   for (i = 0; i < windows_cnt; i++) {
+    if (bgpcorsaro_clip_window(resume_time, &windows[i].start,
+                               windows[i].end) == 0) {
+      continue;
+    }
+    windows_left++;
     bgpstream_add_interval_filter(stream, windows[i].start, windows[i].end);
     current_time = windows[i].start;
     if (minimum_time == 0 || current_time < minimum_time) {
       minimum_time = current_time;
     }
   }
+  if (windows_left == 0 && resume_time != 0) {
+    fprintf(stderr, "INFO: The checkpoint is after the end of all windows\n");
+    goto err;
+  }
 
   /* peer asns */
   for (i = 0; i < peerasns_cnt; i++) {
@@ -661,11 +736,25 @@ int main(int argc, char *argv[])
 
   bgpstream_set_data_interface(stream, datasource_id);
 
+  if (metrics_dest != NULL) {
+    if ((metrics = bgpstream_metrics_create(stream, metrics_dest, "bgpcorsaro",
+                                            metrics_interval)) == NULL) {
+      fprintf(stderr, "ERROR: Could not enable metrics reporting to %s\n",
+              metrics_dest);
+      goto err;
+    }
+    bgpcorsaro_set_metrics(bgpcorsaro, metrics);
+  }
+
   if (bgpstream_start(stream) < 0) {
     fprintf(stderr, "ERROR: Could not init BGPStream\n");
     return -1;
   }
 
+  if (metrics != NULL && bgpstream_metrics_start(metrics) != 0) {
+    goto err;
+  }
+
   /* let bgpcorsaro have the trace pointer */
   bgpcorsaro_set_stream(bgpcorsaro, stream);
 
@@ -714,6 +803,16 @@ int main(int argc, char *argv[])
   if (tmpl != NULL)
     free(tmpl);
 
+  if (checkpoint_file != NULL)
+    free(checkpoint_file);
+
+  if (metrics_dest != NULL)
+    free(metrics_dest);
+
+  /* write a final report */
+  bgpstream_metrics_destroy(metrics);
+  metrics = NULL;
+
   bgpcorsaro_finalize_output(bgpcorsaro);
   bgpcorsaro = NULL;
   if (stream != NULL) {
@@ -734,6 +833,12 @@ err:
   if (tmpl != NULL)
     free(tmpl);
 
+  if (checkpoint_file != NULL)
+    free(checkpoint_file);
+
+  if (metrics_dest != NULL)
+    free(metrics_dest);
+
   clean();
 
   return -1;
@@ -214,6 +214,26 @@ size_t cfr_read_n(CFRFILE *stream, void *ptr, size_t bytes)
   return (cfr_read(ptr, bytes, 1, stream) * bytes);
 }
 
+size_t cfr_get_mem_size(CFRFILE *stream)
+{
+  /******************************************************************/
+  // Only the handle is counted, the compressor state is not known
+  return sizeof(CFRFILE);
+}
+
+size_t cfr_get_mem_estimate(CFRFILE *stream)
+{
+  /******************************************************************/
+  // Nothing is allocated behind our back
+  return 0;
+}
+
+void cfr_set_low_mem(CFRFILE *stream, int enabled)
+{
+  /******************************************************************/
+  // Nothing to trade, reading is sequential anyway
+}
+
 size_t cfr_read(void *ptr, size_t size, size_t nmemb, CFRFILE *stream)
 {
   /******************************************************************/
@@ -53,5 +53,12 @@ typedef struct _CFRFILE CFRFILE;
 CFRFILE *cfr_open(const char *path);
 int cfr_close(CFRFILE *stream);
 size_t cfr_read_n(CFRFILE *stream, void *ptr, size_t bytes);
+// (approximate) number of bytes allocated for reading the file
+size_t cfr_get_mem_size(CFRFILE *stream);
+// (fixed) estimate of the bytes allocated by libraries that do not report
+// them, not included in cfr_get_mem_size
+size_t cfr_get_mem_estimate(CFRFILE *stream);
+// trade read speed for memory, if the decompressor supports it
+void cfr_set_low_mem(CFRFILE *stream, int enabled);
 
 #endif
@@ -8,6 +8,9 @@
 
 #include "bgpdump_cfile_tools.h"
 #include "config.h"
+#ifdef WITH_PARALLEL_BZIP2
+#include "bgpdump_pbzip2.h"
+#endif
 #include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -15,6 +18,17 @@
 #include <wandio.h>
 
 #define WFILE(x) ((io_t *)(x)->data2)
+#define PBZFILE(x) ((pbzip2_t *)(x)->data2)
+
+/* bzip2 files are read using our own multi-threaded decompressor */
+#define FORMAT_PBZIP2 2
+
+/* wandio does not report how much memory it uses for read-ahead buffers and
+   decompressor state, so each open file is charged this estimate. It is not
+   a measurement: the real usage depends on the format and on whether wandio
+   reads ahead in a thread, so it is accounted separately from the memory
+   that is measured (see BGPSTREAM_MEM_WANDIO_ESTIMATE). */
+#define WANDIO_MEM_ESTIMATE (4 * 1024 * 1024)
 
 // API Functions
 
@@ -27,6 +41,13 @@ CFRFILE *cfr_open(const char *path)
   }
   memset(cfr, 0, sizeof(CFRFILE));
 
+#ifdef WITH_PARALLEL_BZIP2
+  if ((cfr->data2 = pbzip2_open(path)) != NULL) {
+    cfr->format = FORMAT_PBZIP2;
+    return cfr;
+  }
+#endif
+
   /* sweet hax */
   if ((cfr->data2 = wandio_create(path)) == NULL) {
     free(cfr);
@@ -42,7 +63,12 @@ int cfr_close(CFRFILE *stream)
     return 0;
   }
 
-  wandio_destroy(WFILE(stream));
+#ifdef WITH_PARALLEL_BZIP2
+  if (stream->format == FORMAT_PBZIP2) {
+    pbzip2_close(PBZFILE(stream));
+  } else
+#endif
+    wandio_destroy(WFILE(stream));
   stream->closed = 1;
 
   free(stream);
@@ -51,5 +77,34 @@ int cfr_close(CFRFILE *stream)
 
 size_t cfr_read_n(CFRFILE *stream, void *ptr, size_t bytes)
 {
+#ifdef WITH_PARALLEL_BZIP2
+  if (stream->format == FORMAT_PBZIP2) {
+    return pbzip2_read(PBZFILE(stream), ptr, bytes);
+  }
+#endif
   return wandio_read(WFILE(stream), ptr, bytes);
 }
+
+size_t cfr_get_mem_size(CFRFILE *stream)
+{
+#ifdef WITH_PARALLEL_BZIP2
+  if (stream->format == FORMAT_PBZIP2) {
+    return sizeof(CFRFILE) + pbzip2_get_mem_size(PBZFILE(stream));
+  }
+#endif
+  return sizeof(CFRFILE);
+}
+
+size_t cfr_get_mem_estimate(CFRFILE *stream)
+{
+  return WANDIO_MEM_ESTIMATE;
+}
+
+void cfr_set_low_mem(CFRFILE *stream, int enabled)
+{
+#ifdef WITH_PARALLEL_BZIP2
+  if (stream->format == FORMAT_PBZIP2) {
+    pbzip2_set_low_mem(PBZFILE(stream), enabled);
+  }
+#endif
+}
@@ -40,8 +40,13 @@
 #include <sys/socket.h>
 
 #include <assert.h>
+#include <inttypes.h>
+#include <time.h>
 #include <zlib.h>
 
+// size of the scratch buffer used when skipping records
+#define BGPDUMP_SKIP_BUFLEN 65536
+
 void bgpdump_free_attr(attributes_t *attr);
 static int process_mrtd_table_dump(struct mstream *s, BGPDUMP_ENTRY *entry);
 static int process_mrtd_table_dump_v2(struct mstream *s, BGPDUMP_ENTRY *entry);
@@ -100,6 +105,26 @@ static void asn32_expand_16_to_32(char *dst, char *src, int len);
 static size_t strlcat(char *dst, const char *src, size_t size);
 #endif
 
+// current time (in ns) if the dump is being timed, 0 otherwise
+static u_int64_t read_timer_start(BGPDUMP *dump)
+{
+  struct timespec ts;
+
+  if (!dump->timing) {
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u_int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// account the time since the matching read_timer_start call as read time
+static void read_timer_stop(BGPDUMP *dump, u_int64_t start)
+{
+  if (dump->timing) {
+    dump->read_ns += read_timer_start(dump) - start;
+  }
+}
+
 char *bgpdump_version(void)
 {
   return PACKAGE_VERSION;
@@ -126,6 +151,10 @@ BGPDUMP *bgpdump_open_dump(const char *filename)
   this_dump->parsed = 0;
   this_dump->parsed_ok = 0;
   this_dump->corrupted_read = false;
+  this_dump->offset = 0;
+  this_dump->last_time = 0;
+  this_dump->timing = 0;
+  this_dump->read_ns = 0;
 
   // peer index table shared among entries
   this_dump->table_dump_v2_peer_index_table = NULL;
@@ -153,6 +182,36 @@ void bgpdump_close_dump(BGPDUMP *dump)
   free(dump);
 }
 
+size_t bgpdump_get_mem_size(BGPDUMP *dump)
+{
+  return sizeof(BGPDUMP) + cfr_get_mem_size(dump->f);
+}
+
+size_t bgpdump_get_mem_estimate(BGPDUMP *dump)
+{
+  return cfr_get_mem_estimate(dump->f);
+}
+
+size_t bgpdump_get_peer_index_mem_size(BGPDUMP *dump)
+{
+  BGPDUMP_TABLE_DUMP_V2_PEER_INDEX_TABLE *t =
+    dump->table_dump_v2_peer_index_table;
+
+  if (t == NULL) {
+    return 0;
+  }
+  return sizeof(BGPDUMP_TABLE_DUMP_V2_PEER_INDEX_TABLE) +
+         (t->entries != NULL
+            ? sizeof(BGPDUMP_TABLE_DUMP_V2_PEER_INDEX_TABLE_ENTRY) *
+                t->peer_count
+            : 0);
+}
+
+void bgpdump_set_low_mem(BGPDUMP *dump, int enabled)
+{
+  cfr_set_low_mem(dump->f, enabled);
+}
+
 BGPDUMP_ENTRY *bgpdump_entry_create(BGPDUMP *dump)
 {
   BGPDUMP_ENTRY *this_entry = malloc(sizeof(BGPDUMP_ENTRY));
@@ -170,6 +229,7 @@ BGPDUMP_ENTRY *bgpdump_read_next(BGPDUMP *dump)
   u_char *buffer;
   int ok = 0;
   u_int32_t bytes_read;
+  u_int64_t start;
 
   BGPDUMP_ENTRY *this_entry = bgpdump_entry_create(dump);
 
@@ -178,10 +238,12 @@ BGPDUMP_ENTRY *bgpdump_read_next(BGPDUMP *dump)
 
   assert(this_entry);
 
+  start = read_timer_start(dump);
   bytes_read = cfr_read_n(dump->f, &(this_entry->time), 4);
   bytes_read += cfr_read_n(dump->f, &(this_entry->type), 2);
   bytes_read += cfr_read_n(dump->f, &(this_entry->subtype), 2);
   bytes_read += cfr_read_n(dump->f, &(this_entry->length), 4);
+  read_timer_stop(dump, start);
   if (bytes_read != 12) {
     if (bytes_read > 0) {
       /* Malformed record */
@@ -207,8 +269,12 @@ BGPDUMP_ENTRY *bgpdump_read_next(BGPDUMP *dump)
   this_entry->time = ntohl(this_entry->time);
   this_entry->length = ntohl(this_entry->length);
   this_entry->attr = NULL;
+  dump->offset += 12 + this_entry->length;
+  dump->last_time = this_entry->time;
   buffer = malloc(this_entry->length);
+  start = read_timer_start(dump);
   bytes_read = cfr_read_n(dump->f, buffer, this_entry->length);
+  read_timer_stop(dump, start);
   if (bytes_read != this_entry->length) {
     bgpdump_err("bgpdump_read_next: %s incomplete dump record (%d bytes read, "
                 "expecting %d)",
@@ -258,6 +324,40 @@ BGPDUMP_ENTRY *bgpdump_read_next(BGPDUMP *dump)
   return this_entry;
 }
 
+int bgpdump_skip_to(BGPDUMP *dump, u_int64_t offset)
+{
+  u_char buffer[BGPDUMP_SKIP_BUFLEN];
+  size_t len, len_read;
+  u_int64_t start;
+
+  assert(dump);
+
+  if (offset < dump->offset) {
+    return -1;
+  }
+
+  // decompress and throw away everything in between, which is still much
+  // cheaper than parsing each record
+  while (dump->offset < offset) {
+    len = offset - dump->offset;
+    if (len > BGPDUMP_SKIP_BUFLEN) {
+      len = BGPDUMP_SKIP_BUFLEN;
+    }
+    start = read_timer_start(dump);
+    len_read = cfr_read_n(dump->f, buffer, len);
+    read_timer_stop(dump, start);
+    if (len_read != len) {
+      bgpdump_err("bgpdump_skip_to: %s ended before offset %" PRIu64,
+                  dump->filename, offset);
+      dump->corrupted_read = true;
+      dump->eof = 1;
+      return -1;
+    }
+    dump->offset += len;
+  }
+  return 0;
+}
+
 static void bgpdump_free_mp_info(struct mp_info *info)
 {
   u_int16_t afi;
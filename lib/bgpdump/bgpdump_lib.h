@@ -56,6 +56,14 @@ typedef struct struct_BGPDUMP {
   // BGPDUMP so that multiple BGPDUMP objects can be used simultaneously
   // without collisions
   BGPDUMP_TABLE_DUMP_V2_PEER_INDEX_TABLE *table_dump_v2_peer_index_table;
+  // offset (in the uncompressed stream) of the next record to be read
+  u_int64_t offset;
+  // timestamp of the last record header read (even if it was not parsed)
+  u_int32_t last_time;
+  // if set, read_ns accumulates the time spent reading (i.e. doing I/O and
+  // decompressing), as opposed to parsing
+  int timing;
+  u_int64_t read_ns;
 } BGPDUMP;
 
 /* prototypes */
@@ -63,7 +71,19 @@ typedef struct struct_BGPDUMP {
 BGPDUMP *bgpdump_open_dump(const char *filename);
 void bgpdump_close_dump(BGPDUMP *dump);
 BGPDUMP_ENTRY *bgpdump_read_next(BGPDUMP *dump);
+// skip (without parsing) all records up to the given offset, which must be
+// the start of a record
+int bgpdump_skip_to(BGPDUMP *dump, u_int64_t offset);
 void bgpdump_free_mem(BGPDUMP_ENTRY *entry);
+// (approximate) number of bytes allocated for reading the dump, not including
+// the peer index table
+size_t bgpdump_get_mem_size(BGPDUMP *dump);
+// (fixed) estimate of the bytes allocated by wandio (see cfr_get_mem_estimate)
+size_t bgpdump_get_mem_estimate(BGPDUMP *dump);
+// number of bytes allocated for the TABLE_DUMP_V2 peer index table
+size_t bgpdump_get_peer_index_mem_size(BGPDUMP *dump);
+// trade read speed for memory (see cfr_set_low_mem)
+void bgpdump_set_low_mem(BGPDUMP *dump, int enabled);
 
 void process_attr_aspath_string(struct aspath *as, int buildstring);
 void process_attr_community_string(struct community *com);
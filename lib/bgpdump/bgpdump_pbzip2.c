@@ -0,0 +1,830 @@
+/**
+ * Multi-threaded bzip2 decompressor (see bgpdump_pbzip2.h).
+ *
+ * Each bzip2 block starts with a 48-bit magic number (which is not byte
+ * aligned), and carries its own CRC. The splitter thread of each file scans
+ * the compressed stream bit-by-bit for these magic numbers, and queues each
+ * block for a worker thread, which wraps it in a stream header and trailer so
+ * that it can be decompressed by libbz2 on its own.
+ *
+ * The worker threads are shared by all open files (a batch may open dozens of
+ * dumps at once), and are started when the first file is opened and stopped
+ * when the last one is closed.
+ *
+ * Since the magic number may also (very rarely) appear inside compressed
+ * data, a block that fails to decompress is joined with the block that
+ * follows it and decompressed again by the reader.
+ *
+ * Author: Alistair King <alistair@caida.org>
+ */
+
+#include "bgpdump_pbzip2.h"
+#include "bgpdump_util.h"
+#include "config.h"
+#include <bzlib.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wandio.h>
+
+/* magic numbers at the start of each block and at the end of each stream */
+#define BLOCK_MAGIC 0x314159265359ULL
+#define EOS_MAGIC 0x177245385090ULL
+#define MAGIC_MASK 0xffffffffffffULL
+#define MAGIC_BITS 48
+#define CRC_BITS 32
+
+/* a block's origPtr (which follows the CRC and the "randomised" bit) is
+   always less than the max block size */
+#define MAX_ORIG_PTR 900000
+
+/* read the compressed file in chunks of this size */
+#define READ_CHUNK (1024 * 1024)
+
+/* bytes needed beyond a magic number to check whether it is real */
+#define LOOKAHEAD 16
+
+/* max number of worker threads (shared by all files) */
+#define MAX_THREADS 16
+
+/* max number of blocks of a file that may be split but not yet read, per
+   worker thread */
+#define BLOCKS_PER_THREAD 2
+
+/* ... but never more than this many */
+#define MAX_BLOCKS 16
+
+/* give up trying to recover a broken block once it gets this big */
+#define MAX_MERGED_BYTES (16 * 1024 * 1024)
+
+/* initial size of the buffer that a block is decompressed into */
+#define OUT_INIT_LEN (1024 * 1024)
+
+/* memory used by libbz2 to decompress a block (100k + 4 x the max block
+   size, see the bzip2 manual), plus the copy of the block that is fed to it */
+#define DECODER_MEM (100000 + 4 * 900000 + 900000)
+
+enum {
+  BLOCK_QUEUED,
+  BLOCK_RUNNING,
+  BLOCK_DONE,
+  BLOCK_FAILED,
+};
+
+typedef struct block {
+  /* compressed data. the block is bits [bit_start, bit_start + range_bits) of
+     raw, but if an end-of-stream marker was found it stops at
+     bit_start + bit_len */
+  uint8_t *raw;
+  size_t raw_len;
+  int bit_start;
+  uint64_t range_bits;
+  uint64_t bit_len;
+
+  /* decompressed data */
+  char *out;
+  size_t out_len;
+  /* allocated size of out (updated atomically, since it is read by
+     pbzip2_get_mem_size while the block is being decompressed) */
+  size_t out_alloc;
+
+  int state;
+
+  /* the file the block belongs to, and the next block in the work queue */
+  struct pbzip2 *pbz;
+  struct block *next_job;
+} block_t;
+
+struct pbzip2 {
+  /* the compressed file */
+  io_t *io;
+
+  pthread_t splitter;
+  int splitter_started;
+
+  /* does this file hold a reference to the worker pool? */
+  int pool_ref;
+
+  /* number of blocks in the work queue or being decompressed (protected by
+     the pool mutex) */
+  int jobs;
+
+  /* protects everything below (except the reader state). cond is broadcast
+     whenever anything changes */
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* ring of split blocks, indexed by sequence number */
+  block_t *blocks[MAX_BLOCKS];
+  int blocks_cnt;
+
+  /* max number of blocks that may be split but not yet read (at most
+     blocks_cnt, lowered to save memory) */
+  int readahead;
+
+  /* allocated size of the splitter's read buffer */
+  size_t split_buf_alloc;
+
+  /* sequence number of the next block to be split */
+  uint64_t next_split;
+
+  /* sequence number of the next block to be read */
+  uint64_t next_read;
+
+  /* has the splitter reached the end of the file? */
+  int split_done;
+
+  /* did the splitter fail to read the file? */
+  int split_error;
+
+  /* should the threads exit? */
+  int shutdown;
+
+  /* reader state: the block being read, and how far into it we are */
+  block_t *cur;
+  size_t cur_pos;
+  int error;
+};
+
+/* the worker threads, and the queue of blocks waiting for them */
+static struct {
+  /* protects everything below. cond is broadcast whenever a block is queued,
+     a block is finished, or the workers should exit */
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  block_t *head;
+  block_t *tail;
+
+  pthread_t workers[MAX_THREADS];
+  int workers_cnt;
+
+  /* number of open files */
+  int users;
+
+  int shutdown;
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+/* serializes starting and stopping the workers */
+static pthread_mutex_t pool_life = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t get_bits(const uint8_t *buf, uint64_t bit, int n)
+{
+  uint32_t val = 0;
+  int i;
+
+  for (i = 0; i < n; i++, bit++) {
+    val = (val << 1) | ((buf[bit >> 3] >> (7 - (bit & 7))) & 1);
+  }
+  return val;
+}
+
+/* buf must be zeroed */
+static void put_bits(uint8_t *buf, uint64_t bit, uint64_t val, int n)
+{
+  int i;
+
+  for (i = n - 1; i >= 0; i--, bit++) {
+    if ((val >> i) & 1) {
+      buf[bit >> 3] |= 0x80 >> (bit & 7);
+    }
+  }
+}
+
+static void block_destroy(block_t *blk)
+{
+  if (blk == NULL) {
+    return;
+  }
+  free(blk->raw);
+  free(blk->out);
+  free(blk);
+}
+
+/* decompress bits [bit_start, bit_start + bit_len) of blk->raw */
+static int decode_bits(block_t *blk, uint64_t bit_len)
+{
+  bz_stream bzs;
+  uint8_t *stream = NULL;
+  size_t stream_len, bytes, raw_bytes, i;
+  size_t out_alloc = OUT_INIT_LEN;
+  char *tmp;
+  int bit_start = blk->bit_start;
+  int rc, ret = -1;
+
+  if (bit_len < MAGIC_BITS + CRC_BITS) {
+    return -1;
+  }
+
+  /* wrap the block in a stream header, and a trailer with the stream CRC
+     (which, for a single block, is just the block CRC) */
+  stream_len = 4 + (bit_len + MAGIC_BITS + CRC_BITS + 7) / 8;
+  if ((stream = calloc(1, stream_len)) == NULL) {
+    return -1;
+  }
+  memcpy(stream, "BZh9", 4);
+  bytes = (bit_len + 7) / 8;
+  raw_bytes = (bit_start + bit_len + 7) / 8;
+  for (i = 0; i < bytes; i++) {
+    stream[4 + i] = (uint8_t)(blk->raw[i] << bit_start);
+    if (bit_start != 0 && i + 1 < raw_bytes) {
+      stream[4 + i] |= blk->raw[i + 1] >> (8 - bit_start);
+    }
+  }
+  if ((bit_len & 7) != 0) {
+    stream[4 + bytes - 1] &= (uint8_t)(0xff << (8 - (bit_len & 7)));
+  }
+  put_bits(stream, 32 + bit_len, EOS_MAGIC, MAGIC_BITS);
+  put_bits(stream, 32 + bit_len + MAGIC_BITS,
+           get_bits(blk->raw, bit_start + MAGIC_BITS, CRC_BITS), CRC_BITS);
+
+  free(blk->out);
+  blk->out_len = 0;
+  __atomic_store_n(&blk->out_alloc, 0, __ATOMIC_RELAXED);
+  if ((blk->out = malloc(out_alloc)) == NULL) {
+    free(stream);
+    return -1;
+  }
+  __atomic_store_n(&blk->out_alloc, out_alloc, __ATOMIC_RELAXED);
+
+  memset(&bzs, 0, sizeof(bzs));
+  if (BZ2_bzDecompressInit(&bzs, 0, 0) != BZ_OK) {
+    free(stream);
+    return -1;
+  }
+  bzs.next_in = (char *)stream;
+  bzs.avail_in = stream_len;
+
+  while (1) {
+    bzs.next_out = blk->out + blk->out_len;
+    bzs.avail_out = out_alloc - blk->out_len;
+    rc = BZ2_bzDecompress(&bzs);
+    blk->out_len = out_alloc - bzs.avail_out;
+    if (rc == BZ_STREAM_END) {
+      ret = 0;
+      break;
+    }
+    if (rc != BZ_OK) {
+      break;
+    }
+    if (bzs.avail_out == 0) {
+      out_alloc *= 2;
+      if ((tmp = realloc(blk->out, out_alloc)) == NULL) {
+        break;
+      }
+      blk->out = tmp;
+      __atomic_store_n(&blk->out_alloc, out_alloc, __ATOMIC_RELAXED);
+    } else if (bzs.avail_in == 0) {
+      /* truncated */
+      break;
+    }
+  }
+
+  BZ2_bzDecompressEnd(&bzs);
+  free(stream);
+  return ret;
+}
+
+static int decode_block(block_t *blk)
+{
+  if (decode_bits(blk, blk->bit_len) == 0) {
+    return 0;
+  }
+  /* the end-of-stream marker may have been bogus */
+  if (blk->bit_len < blk->range_bits &&
+      decode_bits(blk, blk->range_bits) == 0) {
+    return 0;
+  }
+  return -1;
+}
+
+/* join two consecutive blocks into one */
+static block_t *merge_blocks(block_t *a, block_t *b)
+{
+  block_t *blk;
+  size_t a_bytes = (a->bit_start + a->range_bits) / 8;
+  size_t b_bytes = (b->bit_start + b->range_bits + 7) / 8;
+
+  if (a_bytes + b_bytes > MAX_MERGED_BYTES ||
+      (blk = calloc(1, sizeof(block_t))) == NULL) {
+    return NULL;
+  }
+  if ((blk->raw = malloc(a_bytes + b_bytes)) == NULL) {
+    free(blk);
+    return NULL;
+  }
+  /* b starts in the byte that a ends in */
+  memcpy(blk->raw, a->raw, a_bytes);
+  memcpy(blk->raw + a_bytes, b->raw, b_bytes);
+  blk->raw_len = a_bytes + b_bytes;
+  blk->bit_start = a->bit_start;
+  blk->range_bits = a->range_bits + b->range_bits;
+  blk->bit_len = a->range_bits + b->bit_len;
+  return blk;
+}
+
+/* check the bits following a block magic number that ends at bit end */
+static int valid_block(const uint8_t *buf, uint64_t avail, uint64_t end)
+{
+  if (end + CRC_BITS + 1 + 24 > avail) {
+    return 0;
+  }
+  /* not randomised, and a sane origPtr */
+  return get_bits(buf, end + CRC_BITS, 1) == 0 &&
+         get_bits(buf, end + CRC_BITS + 1, 24) < MAX_ORIG_PTR;
+}
+
+/* check the bits following an end-of-stream magic number */
+static int valid_eos(const uint8_t *buf, uint64_t avail, uint64_t end)
+{
+  uint64_t pad_start = end + CRC_BITS;
+  uint64_t pad_end = (pad_start + 7) & ~7ULL;
+
+  if (pad_end > avail) {
+    return 0;
+  }
+  /* the stream is padded to a byte boundary with zeros */
+  return pad_end == pad_start ||
+         get_bits(buf, pad_start, pad_end - pad_start) == 0;
+}
+
+/* add a block to the ring (blocking until there is space) */
+static int add_block(pbzip2_t *pbz, const uint8_t *buf, uint64_t buf_off,
+                     uint64_t start, uint64_t end, int64_t eos)
+{
+  block_t *blk;
+  uint64_t s_byte = start / 8;
+  uint64_t e_byte = (end + 7) / 8;
+
+  if ((blk = calloc(1, sizeof(block_t))) == NULL ||
+      (blk->raw = malloc(e_byte - s_byte)) == NULL) {
+    free(blk);
+    return -1;
+  }
+  memcpy(blk->raw, buf + (s_byte - buf_off), e_byte - s_byte);
+  blk->raw_len = e_byte - s_byte;
+  blk->bit_start = start & 7;
+  blk->range_bits = end - start;
+  blk->bit_len = (eos >= 0) ? (uint64_t)eos - start : end - start;
+  blk->state = BLOCK_QUEUED;
+
+  pthread_mutex_lock(&pbz->mutex);
+  while (pbz->shutdown == 0 &&
+         pbz->next_split - pbz->next_read >= pbz->readahead) {
+    pthread_cond_wait(&pbz->cond, &pbz->mutex);
+  }
+  if (pbz->shutdown != 0) {
+    pthread_mutex_unlock(&pbz->mutex);
+    block_destroy(blk);
+    return -1;
+  }
+  pbz->blocks[pbz->next_split % pbz->blocks_cnt] = blk;
+  pbz->next_split++;
+  pthread_cond_broadcast(&pbz->cond);
+  pthread_mutex_unlock(&pbz->mutex);
+
+  /* hand it to the workers */
+  blk->pbz = pbz;
+  pthread_mutex_lock(&pool.mutex);
+  if (pool.tail != NULL) {
+    pool.tail->next_job = blk;
+  } else {
+    pool.head = blk;
+  }
+  pool.tail = blk;
+  pbz->jobs++;
+  pthread_cond_broadcast(&pool.cond);
+  pthread_mutex_unlock(&pool.mutex);
+  return 0;
+}
+
+static void *thread_splitter(void *user)
+{
+  pbzip2_t *pbz = (pbzip2_t *)user;
+  uint8_t *buf = NULL, *tmp;
+  size_t buf_len = 0, buf_alloc = 0, keep;
+  /* file offset of buf[0] */
+  uint64_t buf_off = 0;
+  /* file offset of the byte being scanned */
+  uint64_t scan = 0;
+  uint64_t sr = 0, end;
+  /* bit offsets of the current block, and of the last end-of-stream marker
+     found in it */
+  int64_t blk_start = -1, blk_eos = -1;
+  int io_eof = 0, error = 0, shutdown = 0;
+  int64_t rd;
+  int b;
+
+  while (1) {
+    /* make sure we can look far enough ahead to check a magic number */
+    while (io_eof == 0 && buf_off + buf_len < scan + 1 + LOOKAHEAD) {
+      /* drop anything that is not part of the current block */
+      keep = (blk_start >= 0 ? (uint64_t)blk_start / 8 : scan) - buf_off;
+      if (keep > 0) {
+        memmove(buf, buf + keep, buf_len - keep);
+        buf_len -= keep;
+        buf_off += keep;
+      }
+      if (buf_alloc - buf_len < READ_CHUNK) {
+        if ((tmp = realloc(buf, buf_len + READ_CHUNK)) == NULL) {
+          error = 1;
+          goto done;
+        }
+        buf = tmp;
+        buf_alloc = buf_len + READ_CHUNK;
+        __atomic_store_n(&pbz->split_buf_alloc, buf_alloc, __ATOMIC_RELAXED);
+      }
+      if ((rd = wandio_read(pbz->io, buf + buf_len, READ_CHUNK)) < 0) {
+        bgpdump_err("pbzip2: could not read compressed data");
+        error = 1;
+        goto done;
+      }
+      if (rd == 0) {
+        io_eof = 1;
+      }
+      buf_len += rd;
+
+      pthread_mutex_lock(&pbz->mutex);
+      shutdown = pbz->shutdown;
+      pthread_mutex_unlock(&pbz->mutex);
+      if (shutdown != 0) {
+        goto done;
+      }
+    }
+    if (scan >= buf_off + buf_len) {
+      break;
+    }
+
+    for (b = 7; b >= 0; b--) {
+      sr = (sr << 1) | ((buf[scan - buf_off] >> b) & 1);
+      if ((sr & MAGIC_MASK) != BLOCK_MAGIC && (sr & MAGIC_MASK) != EOS_MAGIC) {
+        continue;
+      }
+      end = scan * 8 + 8 - b;
+      if ((sr & MAGIC_MASK) == BLOCK_MAGIC &&
+          valid_block(buf, buf_len * 8, end - buf_off * 8)) {
+        if (blk_start >= 0 && add_block(pbz, buf, buf_off, blk_start,
+                                        end - MAGIC_BITS, blk_eos) != 0) {
+          goto done;
+        }
+        blk_start = end - MAGIC_BITS;
+        blk_eos = -1;
+      } else if ((sr & MAGIC_MASK) == EOS_MAGIC && blk_start >= 0 &&
+                 valid_eos(buf, buf_len * 8, end - buf_off * 8)) {
+        /* a bogus marker can only come before the real one */
+        blk_eos = end - MAGIC_BITS;
+      }
+    }
+    scan++;
+  }
+
+  /* the last block runs to the end of the file */
+  if (blk_start >= 0) {
+    add_block(pbz, buf, buf_off, blk_start, (buf_off + buf_len) * 8, blk_eos);
+  }
+
+done:
+  pthread_mutex_lock(&pbz->mutex);
+  pbz->split_done = 1;
+  pbz->split_error = error;
+  pthread_cond_broadcast(&pbz->cond);
+  pthread_mutex_unlock(&pbz->mutex);
+  free(buf);
+  return NULL;
+}
+
+static void *thread_worker(void *user)
+{
+  pbzip2_t *pbz;
+  block_t *blk;
+  int rc;
+
+  pthread_mutex_lock(&pool.mutex);
+  while (1) {
+    while (pool.shutdown == 0 && pool.head == NULL) {
+      pthread_cond_wait(&pool.cond, &pool.mutex);
+    }
+    if (pool.shutdown != 0) {
+      break;
+    }
+    blk = pool.head;
+    if ((pool.head = blk->next_job) == NULL) {
+      pool.tail = NULL;
+    }
+    blk->next_job = NULL;
+    pbz = blk->pbz;
+    pthread_mutex_unlock(&pool.mutex);
+
+    /* the file cannot be closed while it has jobs */
+    pthread_mutex_lock(&pbz->mutex);
+    blk->state = BLOCK_RUNNING;
+    pthread_mutex_unlock(&pbz->mutex);
+
+    rc = decode_block(blk);
+
+    pthread_mutex_lock(&pbz->mutex);
+    blk->state = (rc == 0) ? BLOCK_DONE : BLOCK_FAILED;
+    pthread_cond_broadcast(&pbz->cond);
+    pthread_mutex_unlock(&pbz->mutex);
+
+    pthread_mutex_lock(&pool.mutex);
+    pbz->jobs--;
+    pthread_cond_broadcast(&pool.cond);
+  }
+  pthread_mutex_unlock(&pool.mutex);
+  return NULL;
+}
+
+/* register a new file with the worker pool, starting the workers if needed */
+static int pool_acquire(int threads)
+{
+  int rc = 0;
+  int i;
+
+  pthread_mutex_lock(&pool_life);
+  pthread_mutex_lock(&pool.mutex);
+  pool.users++;
+  pthread_mutex_unlock(&pool.mutex);
+  if (pool.workers_cnt == 0) {
+    for (i = 0; i < threads && i < MAX_THREADS; i++) {
+      if (pthread_create(&pool.workers[i], NULL, thread_worker, NULL) != 0) {
+        break;
+      }
+      pool.workers_cnt++;
+    }
+    if (pool.workers_cnt == 0) {
+      pthread_mutex_lock(&pool.mutex);
+      pool.users--;
+      pthread_mutex_unlock(&pool.mutex);
+      rc = -1;
+    }
+  }
+  pthread_mutex_unlock(&pool_life);
+  return rc;
+}
+
+/* unregister a file (which must have no jobs left), stopping the workers if
+   it was the last one */
+static void pool_release()
+{
+  int i;
+
+  pthread_mutex_lock(&pool_life);
+  pthread_mutex_lock(&pool.mutex);
+  if (--pool.users > 0) {
+    pthread_mutex_unlock(&pool.mutex);
+    pthread_mutex_unlock(&pool_life);
+    return;
+  }
+  pool.shutdown = 1;
+  pthread_cond_broadcast(&pool.cond);
+  pthread_mutex_unlock(&pool.mutex);
+
+  for (i = 0; i < pool.workers_cnt; i++) {
+    pthread_join(pool.workers[i], NULL);
+  }
+  pool.workers_cnt = 0;
+  pool.shutdown = 0;
+  pthread_mutex_unlock(&pool_life);
+}
+
+/* remove the blocks of the given file from the work queue, and wait for any
+   that are being decompressed */
+static void pool_cancel(pbzip2_t *pbz)
+{
+  block_t **bp = &pool.head;
+  block_t *prev = NULL;
+
+  pthread_mutex_lock(&pool.mutex);
+  while (*bp != NULL) {
+    if ((*bp)->pbz == pbz) {
+      *bp = (*bp)->next_job;
+      pbz->jobs--;
+    } else {
+      prev = *bp;
+      bp = &(*bp)->next_job;
+    }
+  }
+  pool.tail = prev;
+  while (pbz->jobs > 0) {
+    pthread_cond_wait(&pool.cond, &pool.mutex);
+  }
+  pthread_mutex_unlock(&pool.mutex);
+}
+
+/* wait for the next block to be decompressed and take it out of the ring.
+   must be called with the mutex held. returns NULL at the end of the file */
+static block_t *take_block(pbzip2_t *pbz)
+{
+  block_t *blk;
+  int slot;
+
+  while (1) {
+    slot = pbz->next_read % pbz->blocks_cnt;
+    if (pbz->next_read < pbz->next_split &&
+        pbz->blocks[slot]->state >= BLOCK_DONE) {
+      break;
+    }
+    if (pbz->split_done != 0 && pbz->next_read == pbz->next_split) {
+      return NULL;
+    }
+    pthread_cond_wait(&pbz->cond, &pbz->mutex);
+  }
+  blk = pbz->blocks[slot];
+  pbz->blocks[slot] = NULL;
+  pbz->next_read++;
+  pthread_cond_broadcast(&pbz->cond);
+  return blk;
+}
+
+/* returns 1 if a new block is ready to read, 0 at EOF, -1 on error */
+static int next_block(pbzip2_t *pbz)
+{
+  block_t *blk, *nxt, *merged;
+
+  block_destroy(pbz->cur);
+  pbz->cur = NULL;
+  pbz->cur_pos = 0;
+  if (pbz->error != 0) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pbz->mutex);
+  if ((blk = take_block(pbz)) == NULL) {
+    pbz->error = pbz->split_error;
+    pthread_mutex_unlock(&pbz->mutex);
+    return pbz->error != 0 ? -1 : 0;
+  }
+
+  /* the splitter may have found a magic number in the middle of a block, so
+     try joining it with the next one */
+  while (blk->state == BLOCK_FAILED) {
+    nxt = take_block(pbz);
+    pthread_mutex_unlock(&pbz->mutex);
+    merged = (nxt != NULL) ? merge_blocks(blk, nxt) : NULL;
+    block_destroy(blk);
+    block_destroy(nxt);
+    if (merged == NULL) {
+      bgpdump_err("pbzip2: could not decompress bzip2 block");
+      pbz->error = 1;
+      return -1;
+    }
+    blk = merged;
+    blk->state = (decode_block(blk) == 0) ? BLOCK_DONE : BLOCK_FAILED;
+    pthread_mutex_lock(&pbz->mutex);
+  }
+  pthread_mutex_unlock(&pbz->mutex);
+
+  pbz->cur = blk;
+  return 1;
+}
+
+pbzip2_t *pbzip2_open(const char *path)
+{
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t len = strlen(path);
+
+  /* only worth it if there are spare CPUs */
+  if (cpus < 2 || len < 4 || strcmp(path + len - 4, ".bz2") != 0) {
+    return NULL;
+  }
+  return pbzip2_open_threads(path, cpus);
+}
+
+pbzip2_t *pbzip2_open_threads(const char *path, int threads)
+{
+  pbzip2_t *pbz;
+  char magic[4];
+
+  if (threads < 1) {
+    return NULL;
+  }
+  if ((pbz = calloc(1, sizeof(pbzip2_t))) == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&pbz->mutex, NULL);
+  pthread_cond_init(&pbz->cond, NULL);
+
+  if ((pbz->io = wandio_create_uncompressed(path)) == NULL) {
+    goto err;
+  }
+  if (wandio_peek(pbz->io, magic, 4) != 4 || memcmp(magic, "BZh", 3) != 0 ||
+      magic[3] < '1' || magic[3] > '9') {
+    goto err;
+  }
+
+  pbz->blocks_cnt = threads * BLOCKS_PER_THREAD;
+  if (pbz->blocks_cnt > MAX_BLOCKS) {
+    pbz->blocks_cnt = MAX_BLOCKS;
+  }
+  pbz->readahead = pbz->blocks_cnt;
+
+  if (pool_acquire(threads) != 0) {
+    goto err;
+  }
+  pbz->pool_ref = 1;
+
+  if (pthread_create(&pbz->splitter, NULL, thread_splitter, pbz) != 0) {
+    goto err;
+  }
+  pbz->splitter_started = 1;
+
+  return pbz;
+
+err:
+  pbzip2_close(pbz);
+  return NULL;
+}
+
+int64_t pbzip2_read(pbzip2_t *pbz, void *buf, int64_t len)
+{
+  int64_t done = 0;
+  size_t n;
+  int rc;
+
+  while (done < len) {
+    if (pbz->cur == NULL || pbz->cur_pos == pbz->cur->out_len) {
+      if ((rc = next_block(pbz)) <= 0) {
+        if (rc < 0 && done == 0) {
+          return -1;
+        }
+        break;
+      }
+      continue;
+    }
+    n = pbz->cur->out_len - pbz->cur_pos;
+    if (n > len - done) {
+      n = len - done;
+    }
+    memcpy((char *)buf + done, pbz->cur->out + pbz->cur_pos, n);
+    pbz->cur_pos += n;
+    done += n;
+  }
+  return done;
+}
+
+static size_t block_mem_size(block_t *blk)
+{
+  if (blk == NULL) {
+    return 0;
+  }
+  return sizeof(block_t) + blk->raw_len +
+         __atomic_load_n(&blk->out_alloc, __ATOMIC_RELAXED) +
+         (blk->state == BLOCK_RUNNING ? DECODER_MEM : 0);
+}
+
+size_t pbzip2_get_mem_size(pbzip2_t *pbz)
+{
+  size_t size = sizeof(pbzip2_t) + block_mem_size(pbz->cur);
+  uint64_t seq;
+
+  pthread_mutex_lock(&pbz->mutex);
+  for (seq = pbz->next_read; seq < pbz->next_split; seq++) {
+    size += block_mem_size(pbz->blocks[seq % pbz->blocks_cnt]);
+  }
+  pthread_mutex_unlock(&pbz->mutex);
+  return size + __atomic_load_n(&pbz->split_buf_alloc, __ATOMIC_RELAXED);
+}
+
+void pbzip2_set_low_mem(pbzip2_t *pbz, int enabled)
+{
+  pthread_mutex_lock(&pbz->mutex);
+  pbz->readahead = (enabled != 0) ? 1 : pbz->blocks_cnt;
+  pthread_cond_broadcast(&pbz->cond);
+  pthread_mutex_unlock(&pbz->mutex);
+}
+
+void pbzip2_close(pbzip2_t *pbz)
+{
+  uint64_t seq;
+
+  if (pbz == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pbz->mutex);
+  pbz->shutdown = 1;
+  pthread_cond_broadcast(&pbz->cond);
+  pthread_mutex_unlock(&pbz->mutex);
+
+  if (pbz->splitter_started != 0) {
+    pthread_join(pbz->splitter, NULL);
+  }
+  if (pbz->pool_ref != 0) {
+    pool_cancel(pbz);
+    pool_release();
+  }
+
+  for (seq = pbz->next_read; seq < pbz->next_split; seq++) {
+    block_destroy(pbz->blocks[seq % pbz->blocks_cnt]);
+  }
+  block_destroy(pbz->cur);
+
+  if (pbz->io != NULL) {
+    wandio_destroy(pbz->io);
+  }
+  pthread_mutex_destroy(&pbz->mutex);
+  pthread_cond_destroy(&pbz->cond);
+  free(pbz);
+}
@@ -0,0 +1,47 @@
+/**
+ * Multi-threaded bzip2 decompressor used by the cfile_tools wrapper.
+ *
+ * bzip2 compresses its input in independent blocks (of up to 900k), each of
+ * which starts with a 48-bit magic number. One thread scans the compressed
+ * stream for block boundaries, a pool of worker threads decompresses the
+ * blocks concurrently, and the reader gets the output back in order.
+ */
+
+#ifndef _BGPDUMP_PBZIP2_H
+#define _BGPDUMP_PBZIP2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct pbzip2 pbzip2_t;
+
+/* Open the given bzip2 file for parallel decompression. Returns NULL if the
+   file is not a bzip2 file, or if parallel decompression would not help (e.g.
+   there is only one CPU), in which case the caller should fall back to
+   reading the file normally. */
+pbzip2_t *pbzip2_open(const char *path);
+
+/* Open the given bzip2 file for decompression by the given number of threads
+   (at least one), however many CPUs there are. Since the threads are shared
+   by all open files, the number is only used if no other file is open.
+   Returns NULL if the file is not a bzip2 file. */
+pbzip2_t *pbzip2_open_threads(const char *path, int threads);
+
+/* Read up to len decompressed bytes into buf. Returns the number of bytes
+   read, 0 at the end of the file, or -1 if an error occurred. */
+int64_t pbzip2_read(pbzip2_t *pbz, void *buf, int64_t len);
+
+/* Get the number of bytes currently allocated for buffering the file
+   (compressed blocks waiting to be decompressed, and decompressed blocks
+   waiting to be read). Must be called by the thread that reads the file. */
+size_t pbzip2_get_mem_size(pbzip2_t *pbz);
+
+/* If enabled, only decompress one block ahead of the reader (instead of one
+   or two per thread), which bounds the memory used at the cost of
+   parallelism */
+void pbzip2_set_low_mem(pbzip2_t *pbz, int enabled);
+
+/* Close the file and stop all threads */
+void pbzip2_close(pbzip2_t *pbz);
+
+#endif
@@ -22,6 +22,7 @@
  */
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -38,6 +39,19 @@ static bgpstream_data_interface_id_t bgpstream_data_interfaces[] = {
   BGPSTREAM_DATA_INTERFACE_CSVFILE, BGPSTREAM_DATA_INTERFACE_SQLITE,
 };
 
+/* names of the processing stages (indexed by bgpstream_stage_t) */
+static const char *stage_names[] = {
+  "datasource", "download", "open", "wait", "read", "parse", "elem", "filter",
+};
+
+static const char *lag_names[] = {
+  "record", "discovery", "open",
+};
+
+static const char *mem_subsystem_names[] = {
+  "readers", "peer_index", "elems", "filters", "wandio_estimate",
+};
+
 #ifdef WITH_DATA_INTERFACE_SINGLEFILE
 static bgpstream_data_interface_info_t bgpstream_singlefile_info = {
   BGPSTREAM_DATA_INTERFACE_SINGLEFILE, "singlefile",
@@ -154,9 +168,23 @@ bgpstream_t *bgpstream_create()
 {
   bgpstream_debug("BS: create start");
   bgpstream_t *bs = (bgpstream_t *)malloc(sizeof(bgpstream_t));
+  int i;
   if (bs == NULL) {
     return NULL; // can't allocate memory
   }
+  // the download cache is optional
+  bs->cache = NULL;
+  bs->stats = NULL;
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {
+    bs->lag[i] = NULL;
+  }
+  // memory is always accounted
+  bs->filters_mem = 0;
+  bs->mem_backpressure = 0;
+  if ((bs->mem = bgpstream_mem_create()) == NULL) {
+    free(bs);
+    return NULL; // can't allocate memory
+  }
   bs->filter_mgr = bgpstream_filter_mgr_create();
   if (bs->filter_mgr == NULL) {
     bgpstream_destroy(bs);
@@ -183,6 +211,7 @@ bgpstream_t *bgpstream_create()
     bs = NULL;
     return NULL;
   }
+  bgpstream_reader_mgr_set_mem(bs->reader_mgr, bs->mem);
   /* memory for the bgpstream interface has been
    * allocated correctly */
   bs->status = BGPSTREAM_STATUS_ALLOCATED;
@@ -404,6 +433,137 @@ void bgpstream_set_live_mode(bgpstream_t *bs)
   bgpstream_debug("BS: set_blocking stop");
 }
 
+/* configure the interface to read remote dumps through a local cache
+ */
+int bgpstream_set_download_cache(bgpstream_t *bs, const char *dir,
+                                 uint64_t max_size, int prefetch_cnt)
+{
+  bgpstream_debug("BS: set_download_cache start");
+  if (bs == NULL || (bs != NULL && bs->status != BGPSTREAM_STATUS_ALLOCATED)) {
+    return -1; // nothing to customize
+  }
+  if (bs->cache != NULL) {
+    bgpstream_cache_destroy(bs->cache);
+    bs->cache = NULL;
+  }
+  if ((bs->cache = bgpstream_cache_create(dir, max_size, prefetch_cnt)) ==
+      NULL) {
+    bgpstream_log_err("Could not create download cache in %s", dir);
+    bgpstream_reader_mgr_set_cache(bs->reader_mgr, NULL);
+    return -1;
+  }
+  bgpstream_reader_mgr_set_cache(bs->reader_mgr, bs->cache);
+  bgpstream_debug("BS: set_download_cache stop");
+  return 0;
+}
+
+/* configure the interface to use (and build) sidecar seek indexes
+ */
+void bgpstream_enable_seek_index(bgpstream_t *bs)
+{
+  bgpstream_debug("BS: enable_seek_index start");
+  if (bs == NULL || (bs != NULL && bs->status != BGPSTREAM_STATUS_ALLOCATED)) {
+    return; // nothing to customize
+  }
+  bgpstream_reader_mgr_set_seek_index(bs->reader_mgr, 1);
+  bgpstream_debug("BS: enable_seek_index stop");
+}
+
+/* configure the interface to collect processing stats
+ */
+void bgpstream_enable_stats(bgpstream_t *bs)
+{
+  bgpstream_debug("BS: enable_stats start");
+  if (bs == NULL || (bs != NULL && bs->status != BGPSTREAM_STATUS_ALLOCATED)) {
+    return; // nothing to customize
+  }
+  if (bs->stats == NULL &&
+      (bs->stats = malloc_zero(sizeof(bgpstream_stats_t))) == NULL) {
+    bgpstream_log_err("Could not allocate stats");
+    return;
+  }
+  bgpstream_reader_mgr_set_stats(bs->reader_mgr, bs->stats);
+  bgpstream_debug("BS: enable_stats stop");
+}
+
+/* configure the interface to record lag histograms
+ */
+void bgpstream_enable_lag_tracking(bgpstream_t *bs)
+{
+  int i;
+  bgpstream_debug("BS: enable_lag_tracking start");
+  if (bs == NULL || (bs != NULL && bs->status != BGPSTREAM_STATUS_ALLOCATED)) {
+    return; // nothing to customize
+  }
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {
+    if (bs->lag[i] == NULL &&
+        (bs->lag[i] = bgpstream_histogram_create()) == NULL) {
+      bgpstream_log_err("Could not allocate lag histogram");
+      return;
+    }
+  }
+  bgpstream_reader_mgr_set_open_lag(bs->reader_mgr,
+                                    bs->lag[BGPSTREAM_LAG_OPEN]);
+  bgpstream_debug("BS: enable_lag_tracking stop");
+}
+
+/* configure the max memory a subsystem may use
+ */
+void bgpstream_set_mem_limit(bgpstream_t *bs,
+                             bgpstream_mem_subsystem_t subsystem,
+                             uint64_t limit)
+{
+  bgpstream_debug("BS: set_mem_limit start");
+  if (bs == NULL || (bs != NULL && bs->status != BGPSTREAM_STATUS_ALLOCATED)) {
+    return; // nothing to customize
+  }
+  if (subsystem < 0 || subsystem >= BGPSTREAM_MEM_CNT) {
+    return;
+  }
+  bgpstream_mem_set_limit(bs->mem, subsystem, limit);
+  bgpstream_debug("BS: set_mem_limit stop");
+}
+
+/* check the memory limits between records. the open dumps give their memory
+   back as they are read, so while the readers are over their limit we only
+   apply backpressure: they are already decompressing as little as they can,
+   and nothing more is prefetched. the other subsystems cannot recover:
+   filters never shrink, and records keep their elems (for re-use) until the
+   application destroys them */
+static int check_mem_limits(bgpstream_t *bs)
+{
+  bgpstream_mem_usage_t usage;
+  int over = 0;
+  int sub;
+
+  for (sub = 0; sub < BGPSTREAM_MEM_CNT; sub++) {
+    if (bgpstream_mem_is_over(bs->mem, sub) == 0) {
+      continue;
+    }
+    if (sub == BGPSTREAM_MEM_READERS || sub == BGPSTREAM_MEM_PEER_INDEX ||
+        sub == BGPSTREAM_MEM_WANDIO_ESTIMATE) {
+      over = 1;
+      continue;
+    }
+    bgpstream_mem_snapshot(bs->mem, &usage);
+    bgpstream_log_err("Memory limit exceeded for %s (%" PRIu64
+                      " bytes in use)",
+                      mem_subsystem_names[sub], usage.bytes[sub]);
+    return -1;
+  }
+
+  if (over != bs->mem_backpressure) {
+    if (over != 0) {
+      bgpstream_log_warn("Readers are over their memory limit, not "
+                         "prefetching until they are back under it");
+    } else {
+      bgpstream_log_warn("Readers are back under their memory limit");
+    }
+    bs->mem_backpressure = over;
+  }
+  return 0;
+}
+
 /* turn on the bgpstream interface, i.e.:
  * it makes the interface ready
  * for a new get next call
@@ -421,6 +581,13 @@ int bgpstream_start(bgpstream_t *bs)
     return rc;
   }
 
+  // the filters no longer change, so account for them once
+  bgpstream_mem_account(bs->mem, BGPSTREAM_MEM_FILTERS, &bs->filters_mem,
+                        bgpstream_filter_mgr_get_mem_size(bs->filter_mgr));
+  if (check_mem_limits(bs) != 0) {
+    return -1;
+  }
+
   // turn on datasource interface
   bgpstream_datasource_mgr_init(bs->datasource_mgr, bs->filter_mgr);
   if (bs->datasource_mgr->status == BGPSTREAM_DATASOURCE_STATUS_ON) {
@@ -436,6 +603,42 @@ int bgpstream_start(bgpstream_t *bs)
   }
 }
 
+/* count the inputs that are waiting for a reader */
+static uint64_t input_queue_len(bgpstream_t *bs)
+{
+  const bgpstream_input_t *in;
+  uint64_t len = 0;
+
+  for (in = bs->input_mgr->head; in != NULL; in = in->next) {
+    len++;
+  }
+  return len;
+}
+
+/* record how long after they were complete the given inputs were found */
+static void record_discovery_lag(bgpstream_t *bs, const bgpstream_input_t *in)
+{
+  uint64_t complete;
+
+  for (; in != NULL; in = in->next) {
+    complete = ((uint64_t)in->epoch_filetime + in->time_span) * 1000;
+    bgpstream_histogram_add(bs->lag[BGPSTREAM_LAG_DISCOVERY],
+                            in->discovered_time > complete
+                              ? in->discovered_time - complete
+                              : 0);
+  }
+}
+
+/* record how far behind real time the given record is */
+static void record_record_lag(bgpstream_t *bs, const bgpstream_record_t *record)
+{
+  uint64_t now_ms = bgpstream_stats_wall_ms();
+  uint64_t record_ms = (uint64_t)record->attributes.record_time * 1000;
+
+  bgpstream_histogram_add(bs->lag[BGPSTREAM_LAG_RECORD],
+                          now_ms > record_ms ? now_ms - record_ms : 0);
+}
+
 /* this function returns the next available record read
  * if the input_queue (i.e. list of files connected from
  * an external source) or the reader_cqueue (i.e. list
@@ -452,6 +655,8 @@ int bgpstream_get_next_record(bgpstream_t *bs, bgpstream_record_t *record)
 
   int num_query_results = 0;
   bgpstream_input_t *bs_in = NULL;
+  uint64_t start;
+  int rc;
 
   // if bs_record contains an initialized bgpdump entry we destroy it
   bgpstream_record_clear(record);
@@ -463,8 +668,11 @@ int bgpstream_get_next_record(bgpstream_t *bs, bgpstream_record_t *record)
       bgpstream_debug("BS: input mgr is empty");
       /* query the external source and append new
        * input objects to the input_mgr queue */
+      start = bgpstream_stats_start(bs->stats);
       num_query_results = bgpstream_datasource_mgr_update_input_queue(
         bs->datasource_mgr, bs->input_mgr);
+      bgpstream_stats_stop(bs->stats, BGPSTREAM_STAGE_DATASOURCE, start);
+      BGPSTREAM_STATS_ADD(bs->stats, datasource_queries, 1);
       if (num_query_results == 0) {
         bgpstream_debug("BS: no (more) data are available");
         return 0; // no (more) data are available
@@ -477,15 +685,155 @@ int bgpstream_get_next_record(bgpstream_t *bs, bgpstream_record_t *record)
     }
     bgpstream_debug("BS: input mgr not empty");
     bs_in = bgpstream_input_mgr_get_queue_to_process(bs->input_mgr);
+    if (bs->lag[BGPSTREAM_LAG_DISCOVERY] != NULL) {
+      record_discovery_lag(bs, bs_in);
+    }
     bgpstream_reader_mgr_add(bs->reader_mgr, bs_in, bs->filter_mgr);
     bgpstream_input_mgr_destroy_queue(bs_in);
     bs_in = NULL;
+    if (bs->stats != NULL) {
+      BGPSTREAM_STATS_SET(bs->stats, inputs_queued, input_queue_len(bs));
+    }
+    /* while these readers are busy, start downloading the next inputs (unless
+       the readers are already close to their memory limit) */
+    if (bs->cache != NULL &&
+        bgpstream_mem_is_high(bs->mem, BGPSTREAM_MEM_READERS) == 0 &&
+        bgpstream_mem_is_high(bs->mem, BGPSTREAM_MEM_WANDIO_ESTIMATE) == 0) {
+      bgpstream_cache_prefetch(bs->cache, bs->input_mgr->head);
+    }
   }
   bgpstream_debug("BS: reader mgr not empty");
   /* init the record with a pointer to bgpstream */
-  record->bs = bs;
-  return bgpstream_reader_mgr_get_next_record(bs->reader_mgr, record,
-                                              bs->filter_mgr);
+  bgpstream_record_attach(record, bs);
+  /* the elems of the previous record, and any dumps that were just opened,
+     may have pushed us over a limit */
+  if (check_mem_limits(bs) != 0) {
+    return -1;
+  }
+  rc = bgpstream_reader_mgr_get_next_record(bs->reader_mgr, record,
+                                            bs->filter_mgr);
+  if (rc > 0) {
+    BGPSTREAM_STATS_SET(bs->stats, last_record_time,
+                        record->attributes.record_time);
+    if (bs->lag[BGPSTREAM_LAG_RECORD] != NULL &&
+        record->status == BGPSTREAM_RECORD_STATUS_VALID_RECORD) {
+      record_record_lag(bs, record);
+    }
+  }
+  return rc;
+}
+
+const char *bgpstream_get_project_name(bgpstream_t *bs,
+                                       bgpstream_str_id_t project_id)
+{
+  return bgpstream_str_id_map_get_str(bs->reader_mgr->projects, project_id);
+}
+
+const char *bgpstream_get_collector_name(bgpstream_t *bs,
+                                         bgpstream_str_id_t collector_id)
+{
+  return bgpstream_str_id_map_get_str(bs->reader_mgr->collectors,
+                                      collector_id);
+}
+
+int bgpstream_get_stats(bgpstream_t *bs, bgpstream_stats_t *stats)
+{
+  if (bs == NULL || bs->stats == NULL) {
+    return -1;
+  }
+  bgpstream_stats_snapshot(bs->stats, stats);
+  return 0;
+}
+
+const char *bgpstream_get_stage_name(bgpstream_stage_t stage)
+{
+  if (stage < 0 || stage >= BGPSTREAM_STAGE_CNT) {
+    return NULL;
+  }
+  return stage_names[stage];
+}
+
+int bgpstream_get_lag_summary(bgpstream_t *bs, bgpstream_lag_type_t type,
+                              bgpstream_lag_summary_t *summary)
+{
+  bgpstream_histogram_t *hist;
+
+  if (bs == NULL || type < 0 || type >= BGPSTREAM_LAG_CNT ||
+      (hist = bs->lag[type]) == NULL) {
+    return -1;
+  }
+  summary->count = bgpstream_histogram_get_count(hist);
+  summary->min = bgpstream_histogram_get_min(hist);
+  summary->max = bgpstream_histogram_get_max(hist);
+  summary->mean = bgpstream_histogram_get_mean(hist);
+  summary->p50 = bgpstream_histogram_get_percentile(hist, 50);
+  summary->p90 = bgpstream_histogram_get_percentile(hist, 90);
+  summary->p99 = bgpstream_histogram_get_percentile(hist, 99);
+  summary->p999 = bgpstream_histogram_get_percentile(hist, 99.9);
+  return 0;
+}
+
+int bgpstream_get_lag_percentile(bgpstream_t *bs, bgpstream_lag_type_t type,
+                                 double percentile, uint64_t *lag_ms)
+{
+  if (bs == NULL || type < 0 || type >= BGPSTREAM_LAG_CNT ||
+      bs->lag[type] == NULL) {
+    return -1;
+  }
+  *lag_ms = bgpstream_histogram_get_percentile(bs->lag[type], percentile);
+  return 0;
+}
+
+const char *bgpstream_get_lag_name(bgpstream_lag_type_t type)
+{
+  if (type < 0 || type >= BGPSTREAM_LAG_CNT) {
+    return NULL;
+  }
+  return lag_names[type];
+}
+
+int bgpstream_get_mem_usage(bgpstream_t *bs, bgpstream_mem_usage_t *usage)
+{
+  if (bs == NULL) {
+    return -1;
+  }
+  bgpstream_mem_snapshot(bs->mem, usage);
+  return 0;
+}
+
+const char *
+bgpstream_get_mem_subsystem_name(bgpstream_mem_subsystem_t subsystem)
+{
+  if (subsystem < 0 || subsystem >= BGPSTREAM_MEM_CNT) {
+    return NULL;
+  }
+  return mem_subsystem_names[subsystem];
+}
+
+int bgpstream_get_mem_subsystem_by_name(const char *name)
+{
+  int i;
+
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    if (strcmp(mem_subsystem_names[i], name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int bgpstream_get_collector_cnt(bgpstream_t *bs)
+{
+  return bgpstream_str_id_map_size(bs->reader_mgr->collectors);
+}
+
+/* stop a live bgpstream interface from waiting for new data */
+void bgpstream_interrupt(bgpstream_t *bs)
+{
+  if (bs == NULL) {
+    return;
+  }
+  bgpstream_datasource_mgr_interrupt(bs->datasource_mgr);
 }
 
 /* turn off the bgpstream interface */
@@ -504,6 +852,7 @@ void bgpstream_stop(bgpstream_t *bs)
  */
 void bgpstream_destroy(bgpstream_t *bs)
 {
+  int i;
   bgpstream_debug("BS: destroy start");
   if (bs == NULL) {
     return; // nothing to destroy
@@ -512,10 +861,22 @@ void bgpstream_destroy(bgpstream_t *bs)
   bs->input_mgr = NULL;
   bgpstream_reader_mgr_destroy(bs->reader_mgr);
   bs->reader_mgr = NULL;
+  // readers are gone, so nobody is waiting on the cache
+  bgpstream_cache_destroy(bs->cache);
+  bs->cache = NULL;
   bgpstream_filter_mgr_destroy(bs->filter_mgr);
   bs->filter_mgr = NULL;
   bgpstream_datasource_mgr_destroy(bs->datasource_mgr);
   bs->datasource_mgr = NULL;
+  free(bs->stats);
+  bs->stats = NULL;
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {
+    bgpstream_histogram_destroy(bs->lag[i]);
+    bs->lag[i] = NULL;
+  }
+  // records that are still alive hold their own reference
+  bgpstream_mem_unref(bs->mem);
+  bs->mem = NULL;
   free(bs);
   bgpstream_debug("BS: destroy end");
 }
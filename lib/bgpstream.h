@@ -128,6 +128,93 @@ typedef enum {
 
 } bgpstream_data_interface_id_t;
 
+/** Processing stages that are timed when statistics are enabled (see
+    bgpstream_enable_stats) */
+typedef enum {
+
+  /** Querying the data interface for new dump files (in live mode this
+      includes the time spent waiting for new data to be published) */
+  BGPSTREAM_STAGE_DATASOURCE = 0,
+
+  /** Fetching remote dump files into the download cache */
+  BGPSTREAM_STAGE_DOWNLOAD = 1,
+
+  /** Opening dump files, including the waits between retries */
+  BGPSTREAM_STAGE_OPEN = 2,
+
+  /** Waiting for a dump file to be opened before it can be read */
+  BGPSTREAM_STAGE_WAIT = 3,
+
+  /** Reading (and decompressing) MRT data from dump files */
+  BGPSTREAM_STAGE_READ = 4,
+
+  /** Parsing MRT records */
+  BGPSTREAM_STAGE_PARSE = 5,
+
+  /** Generating elems from records */
+  BGPSTREAM_STAGE_ELEM = 6,
+
+  /** Applying elem filters */
+  BGPSTREAM_STAGE_FILTER = 7,
+
+  /** Number of stages (not a valid stage) */
+  BGPSTREAM_STAGE_CNT = 8,
+
+} bgpstream_stage_t;
+
+/** Latencies that are tracked when lag tracking is enabled (see
+    bgpstream_enable_lag_tracking) */
+typedef enum {
+
+  /** Wall-clock time when a record is returned by bgpstream_get_next_record
+      minus the time of the record (i.e. how far behind real time the stream
+      is) */
+  BGPSTREAM_LAG_RECORD = 0,
+
+  /** Wall-clock time when a dump file was found by the data interface minus
+      the time that the dump file was complete (i.e. its file time plus its
+      time span). This combines the delay of the collector in publishing the
+      dump and the delay of the data interface in discovering it. */
+  BGPSTREAM_LAG_DISCOVERY = 1,
+
+  /** Wall-clock time when a dump file was opened minus the time that it was
+      found by the data interface (i.e. the time spent queued and
+      downloading) */
+  BGPSTREAM_LAG_OPEN = 2,
+
+  /** Number of lag types (not a valid lag type) */
+  BGPSTREAM_LAG_CNT = 3,
+
+} bgpstream_lag_type_t;
+
+/** Subsystems that memory usage is accounted to (see
+    bgpstream_get_mem_usage) */
+typedef enum {
+
+  /** Open readers: the reader state, and the buffers that bgpstream uses to
+      read and decompress the dump files (see BGPSTREAM_MEM_WANDIO_ESTIMATE
+      for the buffers internal to wandio) */
+  BGPSTREAM_MEM_READERS = 0,
+
+  /** TABLE_DUMP_V2 peer index tables of open RIB dumps */
+  BGPSTREAM_MEM_PEER_INDEX = 1,
+
+  /** Elems (and their AS paths and communities) generated from records */
+  BGPSTREAM_MEM_ELEMS = 2,
+
+  /** Filters (including the prefix filter's patricia tree) */
+  BGPSTREAM_MEM_FILTERS = 3,
+
+  /** Buffers internal to wandio. These are not visible to bgpstream, so this
+      is not a measurement: each file that is opened with wandio is charged a
+      fixed 4 MB. */
+  BGPSTREAM_MEM_WANDIO_ESTIMATE = 4,
+
+  /** Number of subsystems (not a valid subsystem) */
+  BGPSTREAM_MEM_CNT = 5,
+
+} bgpstream_mem_subsystem_t;
+
 /** @} */
 
 /**
@@ -166,6 +253,105 @@ typedef struct struct_bgpstream_data_interface_option {
 
 } bgpstream_data_interface_option_t;
 
+/** Processing statistics of a BGP Stream instance
+ *
+ * All times are in nanoseconds. The download and open stages run in the
+ * reader threads, so they may overlap with each other and with the other
+ * stages.
+ */
+typedef struct struct_bgpstream_stats {
+
+  /** Total time spent in each stage (indexed by bgpstream_stage_t) */
+  uint64_t stage_ns[BGPSTREAM_STAGE_CNT];
+
+  /** Number of queries made to the data interface */
+  uint64_t datasource_queries;
+
+  /** Number of dump files opened */
+  uint64_t dumps_opened;
+
+  /** Number of dump files that could not be opened */
+  uint64_t dumps_failed;
+
+  /** Number of failed attempts to open a dump file that were retried */
+  uint64_t dump_open_retries;
+
+  /** Number of (uncompressed) MRT bytes read */
+  uint64_t bytes_read;
+
+  /** Number of MRT records parsed */
+  uint64_t records_parsed;
+
+  /** Number of parsed records discarded by the time filters */
+  uint64_t records_filtered;
+
+  /** Number of corrupted records */
+  uint64_t records_corrupted;
+
+  /** Number of elems generated */
+  uint64_t elems_generated;
+
+  /** Number of generated elems discarded by the elem filters */
+  uint64_t elems_filtered;
+
+  /** Number of readers (i.e. dump files) currently open */
+  uint64_t readers_open;
+
+  /** Number of dump files queued, but not yet open */
+  uint64_t inputs_queued;
+
+  /** Time of the last record returned by bgpstream_get_next_record (0 if no
+      record has been returned yet) */
+  uint64_t last_record_time;
+
+} bgpstream_stats_t;
+
+/** Summary of the distribution of a lag
+ *
+ * All values are in milliseconds. Percentiles are accurate to within ~3%.
+ */
+typedef struct struct_bgpstream_lag_summary {
+
+  /** Number of lag samples recorded */
+  uint64_t count;
+
+  /** Smallest lag recorded */
+  uint64_t min;
+
+  /** Largest lag recorded */
+  uint64_t max;
+
+  /** Mean lag */
+  double mean;
+
+  /** Median lag */
+  uint64_t p50;
+
+  /** 90th percentile lag */
+  uint64_t p90;
+
+  /** 99th percentile lag */
+  uint64_t p99;
+
+  /** 99.9th percentile lag */
+  uint64_t p999;
+
+} bgpstream_lag_summary_t;
+
+/** Memory usage of a BGP Stream instance
+ *
+ * All values are in bytes, and are indexed by bgpstream_mem_subsystem_t.
+ */
+typedef struct struct_bgpstream_mem_usage {
+
+  /** Number of bytes currently used by each subsystem */
+  uint64_t bytes[BGPSTREAM_MEM_CNT];
+
+  /** Largest number of bytes used by each subsystem */
+  uint64_t peak_bytes[BGPSTREAM_MEM_CNT];
+
+} bgpstream_mem_usage_t;
+
 /** @} */
 
 /**
@@ -339,6 +525,90 @@ void bgpstream_set_data_interface(bgpstream_t *bs,
  */
 void bgpstream_set_live_mode(bgpstream_t *bs);
 
+/** Read remote dump files through a local download cache
+ *
+ * @param bs            pointer to a BGP Stream instance to configure
+ * @param dir           directory to store downloaded files in (created if it
+ *                      does not exist)
+ * @param max_size      maximum size (in bytes) of the cache directory, 0 for
+ *                      no limit
+ * @param prefetch_cnt  number of upcoming dump files to download in the
+ *                      background while the current ones are being read, 0
+ *                      to disable prefetching
+ * @return 0 if the cache was configured successfully, -1 otherwise
+ *
+ * Dump files with a remote URL (e.g. http://...) are downloaded once into the
+ * cache directory and read from there, so re-running the same query (or
+ * running several queries that use the same files) does not fetch them
+ * again. When the cache grows beyond max_size, the least-recently used files
+ * are removed. The cache directory may be shared between processes.
+ */
+int bgpstream_set_download_cache(bgpstream_t *bs, const char *dir,
+                                 uint64_t max_size, int prefetch_cnt);
+
+/** Use sidecar timestamp indexes to seek into update dumps
+ *
+ * @param bs            pointer to a BGP Stream instance to configure
+ *
+ * The first time a local (or cached) update dump is read from start to end, a
+ * small index file (with a ".bsidx" suffix) is written next to it. When the
+ * same dump is read again, the index is used to skip over the records that
+ * come before the start of the earliest interval filter without parsing
+ * them, which makes narrow queries into large dumps much faster.
+ */
+void bgpstream_enable_seek_index(bgpstream_t *bs);
+
+/** Collect processing statistics
+ *
+ * @param bs            pointer to a BGP Stream instance to configure
+ *
+ * Once enabled, the time spent in each processing stage is measured, and
+ * counters of the data read are maintained. The statistics can be retrieved
+ * (even from another thread) using bgpstream_get_stats. Timing adds a small
+ * overhead to every record and elem, so it is disabled by default.
+ */
+void bgpstream_enable_stats(bgpstream_t *bs);
+
+/** Track how far behind real time the stream is
+ *
+ * @param bs            pointer to a BGP Stream instance to configure
+ *
+ * Once enabled, the lag of every valid record, and the discovery and open
+ * lags of every dump file, are recorded in histograms (see
+ * bgpstream_lag_type_t), which can be queried (even from another thread)
+ * using bgpstream_get_lag_summary. This is mostly useful in live mode: when
+ * processing historical data the lags are simply the age of the data.
+ */
+void bgpstream_enable_lag_tracking(bgpstream_t *bs);
+
+/** Limit the memory used by a subsystem
+ *
+ * @param bs            pointer to a BGP Stream instance to configure
+ * @param subsystem     subsystem to limit
+ * @param limit         max number of bytes accounted to the subsystem, 0 for
+ *                      no limit (the default)
+ *
+ * Usage is only checked between records, and is an estimate (see
+ * bgpstream_get_mem_usage); in particular, BGPSTREAM_MEM_WANDIO_ESTIMATE is a
+ * fixed 4 MB per open file, so the process may use more (or less) than the
+ * limits. What happens when a subsystem is over its limit depends on whether
+ * the stream can get back under it:
+ *  - the readers, their wandio buffers and the peer index tables give their
+ *    memory back as the open dumps are read, so the stream applies
+ *    backpressure instead of failing.
+ *    Once the readers use more than 3/4 of their limit, bzip2 files are only
+ *    decompressed one block ahead of the reader (rather than one or two
+ *    blocks per thread), and no more dumps are prefetched into the download
+ *    cache.
+ *  - filters never shrink, and records keep the memory of their elems (for
+ *    re-use) until the application destroys them, so when these are over
+ *    their limit bgpstream_start or bgpstream_get_next_record returns an
+ *    error.
+ */
+void bgpstream_set_mem_limit(bgpstream_t *bs,
+                             bgpstream_mem_subsystem_t subsystem,
+                             uint64_t limit);
+
 /** Start the given BGP Stream instance.
  *
  * @param bs            pointer to a BGP Stream instance to start
@@ -364,6 +634,136 @@ int bgpstream_start(bgpstream_t *bs);
  */
 int bgpstream_get_next_record(bgpstream_t *bs, bgpstream_record_t *record);
 
+/** Get the name of the project with the given ID
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param project_id    project ID (from the dump_project_id record attribute)
+ * @return borrowed pointer to the project name, NULL if the ID is unknown
+ */
+const char *bgpstream_get_project_name(bgpstream_t *bs,
+                                       bgpstream_str_id_t project_id);
+
+/** Get the name of the collector with the given ID
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param collector_id  collector ID (from the dump_collector_id record
+ *                      attribute)
+ * @return borrowed pointer to the collector name, NULL if the ID is unknown
+ */
+const char *bgpstream_get_collector_name(bgpstream_t *bs,
+                                         bgpstream_str_id_t collector_id);
+
+/** Get the number of collectors seen so far by the given BGP Stream instance
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @return the number of collectors, which is also the largest collector ID
+ * that has been handed out
+ *
+ * Collector IDs are allocated (starting from 1) as dumps from new collectors
+ * are opened, so consumers that keep per-collector state in an array indexed
+ * by ID must be prepared to grow it.
+ */
+int bgpstream_get_collector_cnt(bgpstream_t *bs);
+
+/** Get the processing statistics of the given BGP Stream instance
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param stats         pointer to a structure to fill with a snapshot of the
+ *                      statistics
+ * @return 0 if the statistics were retrieved successfully, -1 if statistics
+ * are not enabled
+ *
+ * This function may be called from a thread other than the one reading from
+ * the stream.
+ */
+int bgpstream_get_stats(bgpstream_t *bs, bgpstream_stats_t *stats);
+
+/** Get the name of the given processing stage
+ *
+ * @param stage         processing stage to get the name of
+ * @return borrowed pointer to the (lowercase) name of the stage, NULL if the
+ * stage is not valid
+ */
+const char *bgpstream_get_stage_name(bgpstream_stage_t stage);
+
+/** Get a summary of the distribution of the given lag
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param type          type of lag to summarize
+ * @param summary       pointer to a structure to fill with the summary
+ * @return 0 if the summary was retrieved successfully, -1 if lag tracking is
+ * not enabled
+ *
+ * This function may be called from a thread other than the one reading from
+ * the stream.
+ */
+int bgpstream_get_lag_summary(bgpstream_t *bs, bgpstream_lag_type_t type,
+                              bgpstream_lag_summary_t *summary);
+
+/** Get a percentile of the given lag
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param type          type of lag to get the percentile of
+ * @param percentile    percentile to get (0-100)
+ * @param lag_ms        set to the lag (in milliseconds) at the given
+ *                      percentile (0 if no lags have been recorded)
+ * @return 0 if the percentile was retrieved successfully, -1 if lag tracking
+ * is not enabled
+ */
+int bgpstream_get_lag_percentile(bgpstream_t *bs, bgpstream_lag_type_t type,
+                                 double percentile, uint64_t *lag_ms);
+
+/** Get the name of the given lag type
+ *
+ * @param type          lag type to get the name of
+ * @return borrowed pointer to the (lowercase) name of the lag type, NULL if
+ * the type is not valid
+ */
+const char *bgpstream_get_lag_name(bgpstream_lag_type_t type);
+
+/** Get the memory usage of the given BGP Stream instance
+ *
+ * @param bs            pointer to a BGP Stream instance
+ * @param usage         pointer to a structure to fill with a snapshot of the
+ *                      memory usage
+ * @return 0 if the usage was retrieved successfully, -1 otherwise
+ *
+ * Memory usage is always accounted, and this function may be called from a
+ * thread other than the one reading from the stream. Usage is updated as
+ * allocations grow and shrink, so it is approximate, and does not include
+ * memory used directly by the application.
+ */
+int bgpstream_get_mem_usage(bgpstream_t *bs, bgpstream_mem_usage_t *usage);
+
+/** Get the name of the given memory subsystem
+ *
+ * @param subsystem     subsystem to get the name of
+ * @return borrowed pointer to the (lowercase) name of the subsystem, NULL if
+ * the subsystem is not valid
+ */
+const char *
+bgpstream_get_mem_subsystem_name(bgpstream_mem_subsystem_t subsystem);
+
+/** Get the memory subsystem with the given name
+ *
+ * @param name          name of the subsystem
+ * @return the subsystem with the given name, -1 if there is no such subsystem
+ */
+int bgpstream_get_mem_subsystem_by_name(const char *name);
+
+/** Interrupt a live BGP Stream instance that is waiting for new data
+ *
+ * @param bs            pointer to a BGP Stream instance to interrupt
+ *
+ * A bgpstream_get_next_record call that is blocked waiting for the data
+ * interface to publish new data returns end-of-stream as soon as possible
+ * (rather than after the next poll interval), and the stream no longer waits
+ * for new data after that. This function may be called from another thread
+ * (or a signal handler) while the stream is running, e.g. to shut down a live
+ * stream cleanly before calling bgpstream_stop.
+ */
+void bgpstream_interrupt(bgpstream_t *bs);
+
 /** Stop the given BGP Stream instance
  *
  * @param bs            pointer to a BGP Stream instance to stop
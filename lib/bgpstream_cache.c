@@ -0,0 +1,817 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <wandio.h>
+
+#include "khash.h"
+#include "utils.h"
+
+#include "bgpstream_cache.h"
+#include "bgpstream_constants.h"
+#include "bgpstream_debug.h"
+#include "bgpstream_seek_index.h"
+
+/* size of the buffer used when copying a download to disk */
+#define CACHE_BUFLEN (1024 * 1024)
+
+/* max number of characters of the original file name to keep */
+#define CACHE_NAME_MAX_LEN 64
+
+/* suffix used for partially downloaded files */
+#define CACHE_TMP_SUFFIX ".part"
+
+/* the state of a url that the cache is working on */
+enum {
+  /* queued for prefetch, but no worker has started on it */
+  JOB_QUEUED = 0,
+  /* being downloaded (either by a worker or a reader) */
+  JOB_RUNNING = 1,
+};
+
+/* url -> job state. the key is owned by the map */
+KHASH_INIT(bsc_jobs, char *, int, 1, kh_str_hash_func, kh_str_hash_equal);
+
+/* a url whose cached copy must not be evicted */
+typedef struct cache_pin {
+  /* number of readers (and prefetches) that are about to read the file */
+  int refs;
+  /* set if one of the references is held by a prefetch that no reader has
+     taken over yet */
+  int prefetched;
+} cache_pin_t;
+
+/* url -> pin. the key is owned by the map */
+KHASH_INIT(bsc_pins, char *, cache_pin_t, 1, kh_str_hash_func,
+           kh_str_hash_equal);
+
+struct bgpstream_cache {
+
+  /* directory that cached files are stored in */
+  char *dir;
+
+  /* max total size of the cache directory (0 = unlimited) */
+  uint64_t max_size;
+
+  /* urls that are queued or being downloaded */
+  khash_t(bsc_jobs) * jobs;
+
+  /* urls that are about to be read (prefetched, or handed to a reader that
+     has not opened them yet) */
+  khash_t(bsc_pins) * pins;
+
+  /* circular queue of urls waiting to be prefetched. pointers are borrowed
+     from the jobs map. slots may be NULL if a reader took the job first */
+  char **queue;
+  int queue_len;
+  int queue_head;
+  int queue_cnt;
+
+  /* prefetch worker threads */
+  pthread_t *workers;
+  int workers_cnt;
+
+  /* protects jobs, pins and queue */
+  pthread_mutex_t mutex;
+
+  /* signalled when a url is added to the queue (or we are shutting down) */
+  pthread_cond_t job_cond;
+
+  /* signalled when a download finishes */
+  pthread_cond_t done_cond;
+
+  /* only one thread may be evicting files at a time */
+  pthread_mutex_t evict_mutex;
+
+  int shutdown;
+};
+
+/* an entry in the cache directory (used during eviction) */
+typedef struct cache_file {
+  char *name;
+  uint64_t size;
+  time_t atime;
+} cache_file_t;
+
+static int is_remote(const char *url)
+{
+  /* anything that has a scheme (http://, ftp://, etc.) is worth caching */
+  return strstr(url, "://") != NULL;
+}
+
+/* 64-bit FNV-1a */
+static uint64_t url_hash(const char *url)
+{
+  uint64_t h = 14695981039346656037ULL;
+  const unsigned char *p;
+
+  for (p = (const unsigned char *)url; *p != '\0'; p++) {
+    h ^= *p;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/* build the name of the cached copy of url: <dir>/<hash>-<basename> */
+static int cache_path(bgpstream_cache_t *cache, const char *url, char *path,
+                      size_t len)
+{
+  const char *base = url;
+  const char *p;
+  char name[CACHE_NAME_MAX_LEN + 1];
+  int i = 0;
+
+  /* keep the last path component (without any query string) so that a human
+     can tell what is in the cache */
+  for (p = url; *p != '\0' && *p != '?' && *p != '#'; p++) {
+    if (*p == '/') {
+      base = p + 1;
+    }
+  }
+  for (p = base; *p != '\0' && *p != '?' && *p != '#' && i < CACHE_NAME_MAX_LEN;
+       p++) {
+    if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+        (*p >= '0' && *p <= '9') || *p == '.' || *p == '-' || *p == '_') {
+      name[i++] = *p;
+    } else {
+      name[i++] = '_';
+    }
+  }
+  name[i] = '\0';
+
+  if (snprintf(path, len, "%s/%016" PRIx64 "-%s", cache->dir, url_hash(url),
+               name) >= len) {
+    return -1;
+  }
+  return 0;
+}
+
+/* download url into path (via a temporary file so that a partial download is
+   never visible in the cache) */
+static int cache_download(const char *url, const char *path)
+{
+  io_t *in = NULL;
+  int fd = -1;
+  char tmp[BGPSTREAM_DUMP_MAX_LEN];
+  char *buf = NULL;
+  int64_t rlen;
+  ssize_t wlen;
+  int64_t off;
+
+  if (snprintf(tmp, sizeof(tmp), "%s.%d.%lx" CACHE_TMP_SUFFIX, path, getpid(),
+               (unsigned long)pthread_self()) >= sizeof(tmp)) {
+    goto err;
+  }
+
+  if ((buf = malloc(CACHE_BUFLEN)) == NULL) {
+    goto err;
+  }
+
+  /* we want the file exactly as it is on the server, bgpdump will take care
+     of decompressing it */
+  if ((in = wandio_create_uncompressed(url)) == NULL) {
+    fprintf(stderr, "WARN: Could not open %s for download\n", url);
+    goto err;
+  }
+
+  if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    fprintf(stderr, "WARN: Could not create cache file %s: %s\n", tmp,
+            strerror(errno));
+    goto err;
+  }
+
+  while ((rlen = wandio_read(in, buf, CACHE_BUFLEN)) > 0) {
+    off = 0;
+    while (off < rlen) {
+      if ((wlen = write(fd, buf + off, rlen - off)) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fprintf(stderr, "WARN: Could not write to cache file %s: %s\n", tmp,
+                strerror(errno));
+        goto err;
+      }
+      off += wlen;
+    }
+  }
+  if (rlen < 0) {
+    fprintf(stderr, "WARN: Download of %s failed\n", url);
+    goto err;
+  }
+
+  wandio_destroy(in);
+  in = NULL;
+
+  if (close(fd) != 0) {
+    fd = -1;
+    goto err;
+  }
+  fd = -1;
+
+  if (rename(tmp, path) != 0) {
+    goto err;
+  }
+
+  free(buf);
+  return 0;
+
+err:
+  if (in != NULL) {
+    wandio_destroy(in);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  unlink(tmp);
+  free(buf);
+  return -1;
+}
+
+/* take a reference to the pin of url, creating it if needed. must be called
+   with the mutex held */
+static cache_pin_t *pin(bgpstream_cache_t *cache, const char *url)
+{
+  khiter_t k;
+  char *key;
+  int khret;
+
+  if ((k = kh_get(bsc_pins, cache->pins, (char *)url)) == kh_end(cache->pins)) {
+    if ((key = strdup(url)) == NULL) {
+      return NULL;
+    }
+    k = kh_put(bsc_pins, cache->pins, key, &khret);
+    if (khret < 0) {
+      free(key);
+      return NULL;
+    }
+    kh_value(cache->pins, k).refs = 0;
+    kh_value(cache->pins, k).prefetched = 0;
+  }
+  kh_value(cache->pins, k).refs++;
+  return &kh_value(cache->pins, k);
+}
+
+/* drop a reference to the pin of url. must be called with the mutex held */
+static void unpin(bgpstream_cache_t *cache, const char *url)
+{
+  khiter_t k;
+
+  if ((k = kh_get(bsc_pins, cache->pins, (char *)url)) == kh_end(cache->pins)) {
+    return;
+  }
+  if (--kh_value(cache->pins, k).refs == 0) {
+    free(kh_key(cache->pins, k));
+    kh_del(bsc_pins, cache->pins, k);
+  }
+}
+
+/* get the (sorted) names of the files that must not be evicted. must be
+   called with the mutex held */
+static char **pinned_names(bgpstream_cache_t *cache, int *cnt)
+{
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  size_t dir_len = strlen(cache->dir) + 1;
+  char **names;
+  khiter_t k;
+  int i = 0;
+
+  if ((names = malloc(sizeof(char *) * (kh_size(cache->pins) + 1))) == NULL) {
+    return NULL;
+  }
+  for (k = kh_begin(cache->pins); k != kh_end(cache->pins); ++k) {
+    if (kh_exist(cache->pins, k) &&
+        cache_path(cache, kh_key(cache->pins, k), path, sizeof(path)) == 0 &&
+        (names[i] = strdup(path + dir_len)) != NULL) {
+      i++;
+    }
+  }
+  *cnt = i;
+  return names;
+}
+
+static int name_cmp(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int cache_file_cmp(const void *a, const void *b)
+{
+  const cache_file_t *fa = (const cache_file_t *)a;
+  const cache_file_t *fb = (const cache_file_t *)b;
+  return (fa->atime > fb->atime) - (fa->atime < fb->atime);
+}
+
+/* remove least-recently used files until the cache fits within max_size */
+static void cache_evict(bgpstream_cache_t *cache)
+{
+  DIR *dirp = NULL;
+  struct dirent *de;
+  struct stat st;
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  cache_file_t *files = NULL;
+  cache_file_t *tmp;
+  int files_cnt = 0;
+  int files_alloc = 0;
+  uint64_t total = 0;
+  size_t suffix_len = strlen(CACHE_TMP_SUFFIX);
+  size_t name_len;
+  char *name_end;
+  char **pinned = NULL;
+  int pinned_cnt = 0;
+  char *name;
+  int i;
+
+  if (cache->max_size == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache->evict_mutex);
+
+  /* files that are about to be read are kept, even if that means that the
+     cache stays over its limit for a while */
+  pthread_mutex_lock(&cache->mutex);
+  pinned = pinned_names(cache, &pinned_cnt);
+  pthread_mutex_unlock(&cache->mutex);
+  if (pinned == NULL) {
+    goto done;
+  }
+  qsort(pinned, pinned_cnt, sizeof(char *), name_cmp);
+
+  if ((dirp = opendir(cache->dir)) == NULL) {
+    goto done;
+  }
+
+  while ((de = readdir(dirp)) != NULL) {
+    name_len = strlen(de->d_name);
+    name_end = de->d_name + name_len;
+    if (de->d_name[0] == '.' ||
+        (name_len > suffix_len &&
+         strcmp(name_end - suffix_len, CACHE_TMP_SUFFIX) == 0) ||
+        strstr(de->d_name, BGPSTREAM_SEEK_INDEX_SUFFIX) != NULL) {
+      /* skip hidden files, in-progress downloads, and seek indexes (and
+         their temporary files), which go along with their dump */
+      continue;
+    }
+    if (snprintf(path, sizeof(path), "%s/%s", cache->dir, de->d_name) >=
+          sizeof(path) ||
+        stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    if (files_cnt == files_alloc) {
+      files_alloc = (files_alloc == 0) ? 128 : files_alloc * 2;
+      if ((tmp = realloc(files, sizeof(cache_file_t) * files_alloc)) == NULL) {
+        goto done;
+      }
+      files = tmp;
+    }
+    if ((files[files_cnt].name = strdup(de->d_name)) == NULL) {
+      goto done;
+    }
+    files[files_cnt].size = st.st_size;
+    files[files_cnt].atime = st.st_atime;
+    files_cnt++;
+    total += st.st_size;
+  }
+
+  if (total <= cache->max_size) {
+    goto done;
+  }
+
+  /* oldest first */
+  qsort(files, files_cnt, sizeof(cache_file_t), cache_file_cmp);
+
+  for (i = 0; i < files_cnt && total > cache->max_size; i++) {
+    name = files[i].name;
+    if (bsearch(&name, pinned, pinned_cnt, sizeof(char *), name_cmp) !=
+        NULL) {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", cache->dir, files[i].name);
+    if (unlink(path) == 0) {
+      bgpstream_debug("\t\tBSC: evicted %s", path);
+      total -= files[i].size;
+      bgpstream_seek_index_remove(path);
+    }
+  }
+
+done:
+  if (dirp != NULL) {
+    closedir(dirp);
+  }
+  for (i = 0; i < files_cnt; i++) {
+    free(files[i].name);
+  }
+  free(files);
+  for (i = 0; i < pinned_cnt; i++) {
+    free(pinned[i]);
+  }
+  free(pinned);
+  pthread_mutex_unlock(&cache->evict_mutex);
+}
+
+/* check if the file is already cached, and if so, mark it as recently used */
+static int cache_hit(const char *path)
+{
+  struct timespec times[2] = {{0, UTIME_NOW}, {0, UTIME_OMIT}};
+
+  if (access(path, R_OK) != 0) {
+    return 0;
+  }
+  /* bump the access time so that LRU eviction keeps this file around. the
+     modification time is left alone since seek indexes are keyed on it */
+  utimensat(AT_FDCWD, path, times, 0);
+  return 1;
+}
+
+/* must be called with the mutex held */
+static void job_done(bgpstream_cache_t *cache, khiter_t k)
+{
+  free(kh_key(cache->jobs, k));
+  kh_del(bsc_jobs, cache->jobs, k);
+  pthread_cond_broadcast(&cache->done_cond);
+}
+
+static void *thread_worker(void *user)
+{
+  bgpstream_cache_t *cache = (bgpstream_cache_t *)user;
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  char *url;
+  khiter_t k;
+  int rc;
+
+  pthread_mutex_lock(&cache->mutex);
+  while (1) {
+    while (cache->queue_cnt == 0 && cache->shutdown == 0) {
+      pthread_cond_wait(&cache->job_cond, &cache->mutex);
+    }
+    if (cache->shutdown != 0) {
+      break;
+    }
+
+    url = cache->queue[cache->queue_head];
+    cache->queue[cache->queue_head] = NULL;
+    cache->queue_head = (cache->queue_head + 1) % cache->queue_len;
+    cache->queue_cnt--;
+
+    if (url == NULL) {
+      /* a reader got to this one first */
+      continue;
+    }
+
+    k = kh_get(bsc_jobs, cache->jobs, (char *)url);
+    assert(k != kh_end(cache->jobs));
+    kh_value(cache->jobs, k) = JOB_RUNNING;
+    pthread_mutex_unlock(&cache->mutex);
+
+    rc = 0;
+    if (cache_path(cache, url, path, sizeof(path)) == 0 &&
+        cache_hit(path) == 0) {
+      bgpstream_debug("\t\tBSC: prefetching %s", url);
+      rc = cache_download(url, path);
+      if (rc == 0) {
+        cache_evict(cache);
+      }
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    /* the map may have been resized while we were unlocked */
+    k = kh_get(bsc_jobs, cache->jobs, (char *)url);
+    assert(k != kh_end(cache->jobs));
+    job_done(cache, k);
+  }
+  pthread_mutex_unlock(&cache->mutex);
+
+  return NULL;
+}
+
+/* ========== PROTECTED FUNCTIONS ========== */
+
+bgpstream_cache_t *bgpstream_cache_create(const char *dir, uint64_t max_size,
+                                          int prefetch_cnt)
+{
+  bgpstream_cache_t *cache;
+  int i;
+
+  bgpstream_debug("\tBSC: create cache start");
+
+  if ((cache = malloc_zero(sizeof(bgpstream_cache_t))) == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_init(&cache->mutex, NULL);
+  pthread_mutex_init(&cache->evict_mutex, NULL);
+  pthread_cond_init(&cache->job_cond, NULL);
+  pthread_cond_init(&cache->done_cond, NULL);
+
+  if ((cache->dir = strdup(dir)) == NULL) {
+    goto err;
+  }
+  cache->max_size = max_size;
+
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    bgpstream_log_err("Could not create cache directory %s", dir);
+    goto err;
+  }
+  if (access(dir, R_OK | W_OK | X_OK) != 0) {
+    bgpstream_log_err("Cache directory %s is not writable", dir);
+    goto err;
+  }
+
+  if ((cache->jobs = kh_init(bsc_jobs)) == NULL ||
+      (cache->pins = kh_init(bsc_pins)) == NULL) {
+    goto err;
+  }
+
+  if (prefetch_cnt > 0) {
+    /* the queue can hold at most one full batch of prefetches, plus any
+       slots left behind by jobs that readers took over */
+    cache->queue_len = prefetch_cnt * 2;
+    if ((cache->queue = malloc_zero(sizeof(char *) * cache->queue_len)) ==
+        NULL) {
+      goto err;
+    }
+    if ((cache->workers = malloc_zero(sizeof(pthread_t) * prefetch_cnt)) ==
+        NULL) {
+      goto err;
+    }
+    for (i = 0; i < prefetch_cnt; i++) {
+      if (pthread_create(&cache->workers[i], NULL, thread_worker, cache) !=
+          0) {
+        goto err;
+      }
+      cache->workers_cnt++;
+    }
+  }
+
+  /* make sure that we start within our limits */
+  cache_evict(cache);
+
+  bgpstream_debug("\tBSC: create cache end");
+  return cache;
+
+err:
+  bgpstream_cache_destroy(cache);
+  return NULL;
+}
+
+void bgpstream_cache_destroy(bgpstream_cache_t *cache)
+{
+  khiter_t k;
+  int i;
+
+  if (cache == NULL) {
+    return;
+  }
+
+  /* stop the workers (any in-progress download will finish first) */
+  pthread_mutex_lock(&cache->mutex);
+  cache->shutdown = 1;
+  pthread_cond_broadcast(&cache->job_cond);
+  pthread_mutex_unlock(&cache->mutex);
+
+  for (i = 0; i < cache->workers_cnt; i++) {
+    pthread_join(cache->workers[i], NULL);
+  }
+  free(cache->workers);
+  cache->workers = NULL;
+  cache->workers_cnt = 0;
+
+  /* only abandoned queued jobs remain */
+  if (cache->jobs != NULL) {
+    for (k = kh_begin(cache->jobs); k != kh_end(cache->jobs); ++k) {
+      if (kh_exist(cache->jobs, k)) {
+        assert(kh_value(cache->jobs, k) == JOB_QUEUED);
+        free(kh_key(cache->jobs, k));
+      }
+    }
+    kh_destroy(bsc_jobs, cache->jobs);
+    cache->jobs = NULL;
+  }
+
+  if (cache->pins != NULL) {
+    for (k = kh_begin(cache->pins); k != kh_end(cache->pins); ++k) {
+      if (kh_exist(cache->pins, k)) {
+        free(kh_key(cache->pins, k));
+      }
+    }
+    kh_destroy(bsc_pins, cache->pins);
+    cache->pins = NULL;
+  }
+
+  free(cache->queue);
+  cache->queue = NULL;
+
+  free(cache->dir);
+  cache->dir = NULL;
+
+  pthread_cond_destroy(&cache->done_cond);
+  pthread_cond_destroy(&cache->job_cond);
+  pthread_mutex_destroy(&cache->evict_mutex);
+  pthread_mutex_destroy(&cache->mutex);
+
+  free(cache);
+}
+
+/* remove a job that no worker has started on from the prefetch queue. must be
+   called with the mutex held */
+static void unqueue(bgpstream_cache_t *cache, khiter_t k)
+{
+  char *key = kh_key(cache->jobs, k);
+  int i;
+
+  for (i = 0; i < cache->queue_len; i++) {
+    if (cache->queue[i] == key) {
+      cache->queue[i] = NULL;
+    }
+  }
+}
+
+int bgpstream_cache_get(bgpstream_cache_t *cache, const char *url, char *path,
+                        size_t len)
+{
+  khiter_t k;
+  int khret;
+  char *key;
+  int rc;
+
+  if (is_remote(url) == 0 || cache_path(cache, url, path, len) != 0) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&cache->mutex);
+  /* keep the file until the reader has opened it. if it was prefetched, the
+     reader takes over the reference that the prefetch holds */
+  if ((k = kh_get(bsc_pins, cache->pins, (char *)url)) != kh_end(cache->pins) &&
+      kh_value(cache->pins, k).prefetched != 0) {
+    kh_value(cache->pins, k).prefetched = 0;
+  } else if (pin(cache, url) == NULL) {
+    pthread_mutex_unlock(&cache->mutex);
+    return -1;
+  }
+  while ((k = kh_get(bsc_jobs, cache->jobs, (char *)url)) !=
+           kh_end(cache->jobs) &&
+         kh_value(cache->jobs, k) == JOB_RUNNING) {
+    /* someone else is downloading this, wait for them */
+    pthread_cond_wait(&cache->done_cond, &cache->mutex);
+  }
+
+  if (cache_hit(path) != 0) {
+    pthread_mutex_unlock(&cache->mutex);
+    return 0;
+  }
+
+  if (k != kh_end(cache->jobs)) {
+    /* queued for prefetch but not started yet, take it over */
+    unqueue(cache, k);
+  } else {
+    if ((key = strdup(url)) == NULL) {
+      goto err;
+    }
+    k = kh_put(bsc_jobs, cache->jobs, key, &khret);
+    if (khret < 0) {
+      free(key);
+      goto err;
+    }
+  }
+  kh_value(cache->jobs, k) = JOB_RUNNING;
+  pthread_mutex_unlock(&cache->mutex);
+
+  bgpstream_debug("\t\tBSC: downloading %s", url);
+  rc = cache_download(url, path);
+
+  pthread_mutex_lock(&cache->mutex);
+  job_done(cache, kh_get(bsc_jobs, cache->jobs, (char *)url));
+  if (rc != 0) {
+    goto err;
+  }
+  pthread_mutex_unlock(&cache->mutex);
+
+  cache_evict(cache);
+  return 0;
+
+err:
+  /* the caller only releases files that it got */
+  unpin(cache, url);
+  pthread_mutex_unlock(&cache->mutex);
+  return -1;
+}
+
+void bgpstream_cache_prefetch(bgpstream_cache_t *cache,
+                              const bgpstream_input_t *queue)
+{
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  const bgpstream_input_t *in;
+  cache_pin_t *p;
+  char *key;
+  khiter_t k;
+  int khret;
+  int cnt = 0;
+
+  if (cache->workers_cnt == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache->mutex);
+  for (in = queue;
+       in != NULL && cnt < cache->workers_cnt &&
+       cache->queue_cnt < cache->queue_len;
+       in = in->next, cnt++) {
+    if (is_remote(in->filename) == 0 ||
+        cache_path(cache, in->filename, path, sizeof(path)) != 0) {
+      continue;
+    }
+    /* inputs stay in the queue until they are handed to readers, so they
+       may already have been prefetched by an earlier call */
+    if ((k = kh_get(bsc_pins, cache->pins, in->filename)) !=
+          kh_end(cache->pins) &&
+        kh_value(cache->pins, k).prefetched != 0) {
+      continue;
+    }
+    /* this file will be read soon, so keep it even if it is already cached.
+       the reference is handed over to the reader that gets the file, or
+       dropped by bgpstream_cache_drop */
+    if ((p = pin(cache, in->filename)) == NULL) {
+      break;
+    }
+    p->prefetched = 1;
+    if (kh_get(bsc_jobs, cache->jobs, in->filename) != kh_end(cache->jobs) ||
+        access(path, R_OK) == 0) {
+      continue;
+    }
+    if ((key = strdup(in->filename)) == NULL) {
+      break;
+    }
+    k = kh_put(bsc_jobs, cache->jobs, key, &khret);
+    if (khret < 0) {
+      free(key);
+      break;
+    }
+    kh_value(cache->jobs, k) = JOB_QUEUED;
+    cache->queue[(cache->queue_head + cache->queue_cnt) % cache->queue_len] =
+      key;
+    cache->queue_cnt++;
+    pthread_cond_signal(&cache->job_cond);
+  }
+  pthread_mutex_unlock(&cache->mutex);
+}
+
+void bgpstream_cache_release(bgpstream_cache_t *cache, const char *url)
+{
+  pthread_mutex_lock(&cache->mutex);
+  unpin(cache, url);
+  pthread_mutex_unlock(&cache->mutex);
+}
+
+void bgpstream_cache_drop(bgpstream_cache_t *cache, const char *url)
+{
+  khiter_t k;
+
+  pthread_mutex_lock(&cache->mutex);
+  /* a download that has started is left to finish */
+  if ((k = kh_get(bsc_jobs, cache->jobs, (char *)url)) != kh_end(cache->jobs) &&
+      kh_value(cache->jobs, k) == JOB_QUEUED) {
+    bgpstream_debug("\t\tBSC: cancelled prefetch of %s", url);
+    unqueue(cache, k);
+    job_done(cache, k);
+  }
+  if ((k = kh_get(bsc_pins, cache->pins, (char *)url)) != kh_end(cache->pins) &&
+      kh_value(cache->pins, k).prefetched != 0) {
+    kh_value(cache->pins, k).prefetched = 0;
+    unpin(cache, url);
+  }
+  pthread_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,148 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_CACHE_H
+#define __BGPSTREAM_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bgpstream_input.h"
+
+/** @file
+ *
+ * @brief Header file that exposes the protected interface of the bgpstream
+ * download cache.
+ *
+ * The cache keeps a local copy of remote (i.e. http://, ftp://, etc.) dump
+ * files in a directory so that they only need to be fetched once. Files are
+ * stored exactly as they were downloaded (i.e. still compressed) and are named
+ * using a hash of their URL. When the total size of the directory exceeds the
+ * configured limit, the least-recently used files (by access time) are
+ * removed.
+ *
+ * The cache can also prefetch files in the background using a small pool of
+ * worker threads.
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+typedef struct bgpstream_cache bgpstream_cache_t;
+
+/** @} */
+
+/**
+ * @name Protected API Functions
+ *
+ * @{ */
+
+/** Create a new download cache
+ *
+ * @param dir           path to the directory to store files in (will be
+ *                      created if it does not exist)
+ * @param max_size      maximum total size (in bytes) of the cache directory,
+ *                      0 for no limit
+ * @param prefetch_cnt  number of files to prefetch in the background (also
+ *                      the number of download threads), 0 to disable
+ * @return pointer to a new cache instance if successful, NULL otherwise
+ */
+bgpstream_cache_t *bgpstream_cache_create(const char *dir, uint64_t max_size,
+                                          int prefetch_cnt);
+
+/** Destroy the given cache
+ *
+ * @param cache         pointer to the cache to destroy
+ *
+ * Any downloads that are in progress will be completed before this function
+ * returns, but queued prefetches will be abandoned. Files already in the
+ * cache directory are kept.
+ */
+void bgpstream_cache_destroy(bgpstream_cache_t *cache);
+
+/** Get the path to a local copy of the given dump file
+ *
+ * @param cache         pointer to the cache
+ * @param url           URL of the dump file
+ * @param path          buffer to write the local path into
+ * @param len           length of the path buffer
+ * @return 0 if path has been filled with the name of a local copy of the file,
+ * -1 if the file cannot be cached (e.g. it is already a local file, or the
+ * download failed), in which case url should be used directly.
+ *
+ * If the file is not in the cache it is downloaded by the calling thread. If it
+ * is currently being prefetched, this function blocks until the prefetch
+ * completes. If successful, the file will not be evicted until
+ * bgpstream_cache_release is called (once for each successful call to this
+ * function).
+ */
+int bgpstream_cache_get(bgpstream_cache_t *cache, const char *url, char *path,
+                        size_t len);
+
+/** Release a reference to the cached copy of the given dump file
+ *
+ * @param cache         pointer to the cache
+ * @param url           URL of the dump file
+ *
+ * Files returned by bgpstream_cache_get, or queued by bgpstream_cache_prefetch,
+ * are never evicted while any reader (or prefetch) still holds a reference to
+ * them. This should be called once the file has been opened (or could not be
+ * opened).
+ */
+void bgpstream_cache_release(bgpstream_cache_t *cache, const char *url);
+
+/** Tell the cache that an input will not be read after all
+ *
+ * @param cache         pointer to the cache
+ * @param url           URL of the dump file
+ *
+ * If the file was queued by bgpstream_cache_prefetch, the prefetch is
+ * cancelled (unless the download has already started), and the reference it
+ * holds is released.
+ */
+void bgpstream_cache_drop(bgpstream_cache_t *cache, const char *url);
+
+/** Queue the first few remote files in the given input queue for background
+ * download
+ *
+ * @param cache         pointer to the cache
+ * @param queue         pointer to the head of a list of inputs
+ *
+ * Only the first prefetch_cnt (as given to bgpstream_cache_create) inputs
+ * are considered. Files that are already cached, or queued, are not
+ * downloaded again. Each input is pinned once, however many times it is
+ * passed to this function, until a reader gets it with bgpstream_cache_get
+ * (which takes over the reference) or it is dropped with
+ * bgpstream_cache_drop.
+ */
+void bgpstream_cache_prefetch(bgpstream_cache_t *cache,
+                              const bgpstream_input_t *queue);
+
+/** @} */
+
+#endif /* __BGPSTREAM_CACHE_H */
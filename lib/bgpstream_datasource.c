@@ -72,6 +72,7 @@ bgpstream_datasource_mgr_t *bgpstream_datasource_mgr_create()
     BGPSTREAM_DATA_INTERFACE_BROKER; // default data source
   datasource_mgr->blocking = 0;
   datasource_mgr->backoff_time = DATASOURCE_BLOCKING_MIN_WAIT;
+  datasource_mgr->interrupted = 0;
 // datasources (none of them is active at the beginning)
 
 #ifdef WITH_DATA_INTERFACE_SINGLEFILE
@@ -270,6 +271,42 @@ void bgpstream_datasource_mgr_set_blocking(
   bgpstream_debug("\tBSDS_MGR: set blocking end");
 }
 
+/* wait (at most timeout seconds) for the active datasource to have new data,
+   returns 1 if it signalled that data has arrived, 0 otherwise */
+static int datasource_mgr_wait(bgpstream_datasource_mgr_t *datasource_mgr,
+                               int timeout)
+{
+  switch (datasource_mgr->datasource) {
+#ifdef WITH_DATA_INTERFACE_SINGLEFILE
+  case BGPSTREAM_DATA_INTERFACE_SINGLEFILE:
+    return bgpstream_singlefile_datasource_wait(datasource_mgr->singlefile_ds,
+                                                timeout);
+#endif
+
+#ifdef WITH_DATA_INTERFACE_CSVFILE
+  case BGPSTREAM_DATA_INTERFACE_CSVFILE:
+    return bgpstream_csvfile_datasource_wait(datasource_mgr->csvfile_ds,
+                                             timeout);
+#endif
+
+#ifdef WITH_DATA_INTERFACE_SQLITE
+  case BGPSTREAM_DATA_INTERFACE_SQLITE:
+    return bgpstream_sqlite_datasource_wait(datasource_mgr->sqlite_ds,
+                                            timeout);
+#endif
+
+#ifdef WITH_DATA_INTERFACE_BROKER
+  case BGPSTREAM_DATA_INTERFACE_BROKER:
+    return bgpstream_broker_datasource_wait(datasource_mgr->broker_ds,
+                                            timeout);
+#endif
+
+  default:
+    sleep(timeout);
+    return 0;
+  }
+}
+
 int bgpstream_datasource_mgr_update_input_queue(
   bgpstream_datasource_mgr_t *datasource_mgr, bgpstream_input_mgr_t *input_mgr)
 {
@@ -313,12 +350,22 @@ int bgpstream_datasource_mgr_update_input_queue(
       fprintf(stderr, "Invalid data interface\n");
       break;
     }
+    if (__atomic_load_n(&datasource_mgr->interrupted, __ATOMIC_RELAXED)) {
+      // the stream is being shut down, so don't wait for more data
+      break;
+    }
     if (results == 0 && datasource_mgr->blocking) {
       // results = 0 => 2+ time and database did not give any error
-      sleep(datasource_mgr->backoff_time);
-      datasource_mgr->backoff_time = datasource_mgr->backoff_time * 2;
-      if (datasource_mgr->backoff_time > DATASOURCE_BLOCKING_MAX_WAIT) {
-        datasource_mgr->backoff_time = DATASOURCE_BLOCKING_MAX_WAIT;
+      // the backoff time is only an upper bound, datasources that can be
+      // notified of new data will return as soon as it arrives
+      if (datasource_mgr_wait(datasource_mgr, datasource_mgr->backoff_time) ==
+          1) {
+        datasource_mgr->backoff_time = DATASOURCE_BLOCKING_MIN_WAIT;
+      } else {
+        datasource_mgr->backoff_time = datasource_mgr->backoff_time * 2;
+        if (datasource_mgr->backoff_time > DATASOURCE_BLOCKING_MAX_WAIT) {
+          datasource_mgr->backoff_time = DATASOURCE_BLOCKING_MAX_WAIT;
+        }
       }
     }
     bgpstream_debug("\tBSDS_MGR: got %d (blocking: %d)", results,
@@ -331,6 +378,53 @@ int bgpstream_datasource_mgr_update_input_queue(
   return results;
 }
 
+void bgpstream_datasource_mgr_interrupt(
+  bgpstream_datasource_mgr_t *datasource_mgr)
+{
+  if (datasource_mgr == NULL) {
+    return;
+  }
+  __atomic_store_n(&datasource_mgr->interrupted, 1, __ATOMIC_RELAXED);
+
+  // wake the datasource up if it is waiting
+  switch (datasource_mgr->datasource) {
+#ifdef WITH_DATA_INTERFACE_SINGLEFILE
+  case BGPSTREAM_DATA_INTERFACE_SINGLEFILE:
+    if (datasource_mgr->singlefile_ds != NULL) {
+      bgpstream_singlefile_datasource_interrupt(datasource_mgr->singlefile_ds);
+    }
+    break;
+#endif
+
+#ifdef WITH_DATA_INTERFACE_CSVFILE
+  case BGPSTREAM_DATA_INTERFACE_CSVFILE:
+    if (datasource_mgr->csvfile_ds != NULL) {
+      bgpstream_csvfile_datasource_interrupt(datasource_mgr->csvfile_ds);
+    }
+    break;
+#endif
+
+#ifdef WITH_DATA_INTERFACE_SQLITE
+  case BGPSTREAM_DATA_INTERFACE_SQLITE:
+    if (datasource_mgr->sqlite_ds != NULL) {
+      bgpstream_sqlite_datasource_interrupt(datasource_mgr->sqlite_ds);
+    }
+    break;
+#endif
+
+#ifdef WITH_DATA_INTERFACE_BROKER
+  case BGPSTREAM_DATA_INTERFACE_BROKER:
+    if (datasource_mgr->broker_ds != NULL) {
+      bgpstream_broker_datasource_interrupt(datasource_mgr->broker_ds);
+    }
+    break;
+#endif
+
+  default:
+    break;
+  }
+}
+
 void bgpstream_datasource_mgr_close(bgpstream_datasource_mgr_t *datasource_mgr)
 {
   bgpstream_debug("\tBSDS_MGR: close start");
@@ -83,6 +83,7 @@ typedef struct struct_bgpstream_datasource_mgr_t {
   // blocking options
   int blocking;
   int backoff_time;
+  int interrupted; // set (atomically) to stop waiting for new data
   bgpstream_datasource_status_t status;
 } bgpstream_datasource_mgr_t;
 
@@ -108,6 +109,12 @@ void bgpstream_datasource_mgr_set_blocking(
 int bgpstream_datasource_mgr_update_input_queue(
   bgpstream_datasource_mgr_t *datasource_mgr, bgpstream_input_mgr_t *input_mgr);
 
+/* stop waiting for new data: a blocking update that is waiting returns 0 (no
+   more data) as soon as possible, and later updates no longer block. safe to
+   call from another thread or a signal handler */
+void bgpstream_datasource_mgr_interrupt(
+  bgpstream_datasource_mgr_t *datasource_mgr);
+
 /* stop the active data source */
 void bgpstream_datasource_mgr_close(bgpstream_datasource_mgr_t *datasource_mgr);
 
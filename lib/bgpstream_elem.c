@@ -410,3 +410,16 @@ char *bgpstream_elem_snprintf(char *buf, size_t len,
 {
   return bgpstream_elem_custom_snprintf(buf, len, elem, 1);
 }
+
+size_t bgpstream_elem_get_mem_size(const bgpstream_elem_t *elem)
+{
+  size_t size = sizeof(bgpstream_elem_t);
+
+  if (elem->aspath != NULL) {
+    size += bgpstream_as_path_get_mem_size(elem->aspath);
+  }
+  if (elem->communities != NULL) {
+    size += bgpstream_community_set_get_mem_size(elem->communities);
+  }
+  return size;
+}
@@ -770,6 +770,23 @@ int bgpstream_elem_generator_populate(bgpstream_elem_generator_t *self,
   return -1;
 }
 
+int bgpstream_elem_generator_get_elem_cnt(bgpstream_elem_generator_t *self)
+{
+  return self->elems_cnt;
+}
+
+size_t bgpstream_elem_generator_get_mem_size(bgpstream_elem_generator_t *self)
+{
+  size_t size = sizeof(bgpstream_elem_generator_t) +
+                self->elems_alloc_cnt * sizeof(bgpstream_elem_t *);
+  int i;
+
+  for (i = 0; i < self->elems_alloc_cnt; i++) {
+    size += bgpstream_elem_get_mem_size(self->elems[i]);
+  }
+  return size;
+}
+
 bgpstream_elem_t *
 bgpstream_elem_generator_get_next_elem(bgpstream_elem_generator_t *self)
 {
@@ -782,3 +799,8 @@ bgpstream_elem_generator_get_next_elem(bgpstream_elem_generator_t *self)
 
   return elem;
 }
+
+void bgpstream_elem_generator_rewind(bgpstream_elem_generator_t *self)
+{
+  self->iter = 0;
+}
@@ -92,6 +92,25 @@ int bgpstream_elem_generator_is_populated(
 int bgpstream_elem_generator_populate(bgpstream_elem_generator_t *generator,
                                       struct struct_bgpstream_record_t *record);
 
+/** Get the number of elems in a populated generator
+ *
+ * @param generator     pointer to the generator
+ * @return the number of elems generated from the record, -1 if the generator
+ * has not been populated
+ */
+int bgpstream_elem_generator_get_elem_cnt(
+  bgpstream_elem_generator_t *generator);
+
+/** Get the number of bytes allocated for the generator
+ *
+ * @param generator     pointer to the generator
+ * @return the number of bytes used by the generator and all of the elems it
+ * has allocated (elems are reused, so this is the high-water mark of the
+ * records it has been populated from)
+ */
+size_t
+bgpstream_elem_generator_get_mem_size(bgpstream_elem_generator_t *generator);
+
 /** Get the next elem from the generator
  *
  * @param generator     pointer to the generator to retrieve an elem from
@@ -102,6 +121,16 @@ int bgpstream_elem_generator_populate(bgpstream_elem_generator_t *generator,
 bgpstream_elem_t *
 bgpstream_elem_generator_get_next_elem(bgpstream_elem_generator_t *generator);
 
+/** Rewind the generator so that the next call to get_next_elem returns the
+ * first elem again
+ *
+ * @param generator     pointer to the generator to rewind
+ *
+ * The elems are not re-generated, so this is cheap, and the pointers returned
+ * before the rewind remain valid.
+ */
+void bgpstream_elem_generator_rewind(bgpstream_elem_generator_t *generator);
+
 /** @} */
 
 #endif /* __BGPSTREAM_ELEM_GENERATOR_H */
@@ -52,6 +52,14 @@ char *bgpstream_elem_custom_snprintf(char *buf, size_t len,
                                      const bgpstream_elem_t *elem,
                                      int print_type);
 
+/** Get the number of bytes allocated for the given elem
+ *
+ * @param elem          pointer to the elem to get the memory usage of
+ * @return the number of bytes used by the elem, including its AS path and
+ * communities
+ */
+size_t bgpstream_elem_get_mem_size(const bgpstream_elem_t *elem);
+
 /** @} */
 
 #endif /* __BGPSTREAM_ELEM_INT_H */
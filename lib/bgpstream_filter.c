@@ -265,9 +265,61 @@ int bgpstream_filter_mgr_validate(bgpstream_filter_mgr_t *filter_mgr)
     }
   }
 
+  /* the peer ASN filter is checked for every elem, and no longer changes */
+  if (filter_mgr->peer_asns != NULL &&
+      bgpstream_id_set_freeze(filter_mgr->peer_asns) != 0) {
+    return -1;
+  }
+
   return 0;
 }
 
+size_t bgpstream_filter_mgr_get_mem_size(bgpstream_filter_mgr_t *mgr)
+{
+  size_t size = sizeof(bgpstream_filter_mgr_t);
+  bgpstream_str_set_t *sets[] = {
+    mgr->projects, mgr->collectors, mgr->bgp_types, mgr->aspath_exprs,
+  };
+  bgpstream_interval_filter_t *tif;
+  khiter_t k;
+  int i;
+
+  for (i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+    if (sets[i] != NULL) {
+      size += bgpstream_str_set_get_mem_size(sets[i]);
+    }
+  }
+  if (mgr->peer_asns != NULL) {
+    size += bgpstream_id_set_get_mem_size(mgr->peer_asns);
+  }
+  if (mgr->prefixes != NULL) {
+    size += bgpstream_patricia_tree_get_mem_size(mgr->prefixes);
+  }
+  if (mgr->communities != NULL) {
+    size += sizeof(*mgr->communities) +
+            kh_n_buckets(mgr->communities) *
+              (sizeof(bgpstream_community_t) + sizeof(uint8_t)) +
+            __ac_fsize(kh_n_buckets(mgr->communities)) * sizeof(khint32_t);
+  }
+  for (tif = mgr->time_intervals; tif != NULL; tif = tif->next) {
+    size += sizeof(bgpstream_interval_filter_t);
+  }
+  if (mgr->last_processed_ts != NULL) {
+    size += sizeof(*mgr->last_processed_ts) +
+            kh_n_buckets(mgr->last_processed_ts) *
+              (sizeof(char *) + sizeof(uint32_t)) +
+            __ac_fsize(kh_n_buckets(mgr->last_processed_ts)) *
+              sizeof(khint32_t);
+    for (k = kh_begin(mgr->last_processed_ts);
+         k != kh_end(mgr->last_processed_ts); ++k) {
+      if (kh_exist(mgr->last_processed_ts, k)) {
+        size += strlen(kh_key(mgr->last_processed_ts, k)) + 1;
+      }
+    }
+  }
+  return size;
+}
+
 /* destroy the memory allocated for bgpstream filter */
 void bgpstream_filter_mgr_destroy(bgpstream_filter_mgr_t *bs_filter_mgr)
 {
@@ -83,6 +83,9 @@ void bgpstream_filter_mgr_interval_filter_add(
 /* validate the current filters */
 int bgpstream_filter_mgr_validate(bgpstream_filter_mgr_t *mgr);
 
+/* get the number of bytes allocated for the filters */
+size_t bgpstream_filter_mgr_get_mem_size(bgpstream_filter_mgr_t *mgr);
+
 /* destroy the memory allocated for bgpstream filter */
 void bgpstream_filter_mgr_destroy(bgpstream_filter_mgr_t *bs_filter_mgr);
 
@@ -0,0 +1,175 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+#include "bgpstream_histogram.h"
+
+/* each power of two is split into 2^SUB_BITS linear buckets */
+#define SUB_BITS 5
+#define SUB_CNT (1 << SUB_BITS)
+
+/* largest value that can be recorded is 2^VALUE_BITS-1 */
+#define VALUE_BITS 48
+#define VALUE_MAX ((UINT64_C(1) << VALUE_BITS) - 1)
+
+#define BUCKET_CNT ((VALUE_BITS - SUB_BITS + 1) * SUB_CNT)
+
+struct bgpstream_histogram {
+  uint64_t buckets[BUCKET_CNT];
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+};
+
+static int bucket_idx(uint64_t value)
+{
+  int shift;
+
+  if (value < SUB_CNT) {
+    return value;
+  }
+  /* the top SUB_BITS+1 bits of the value pick the bucket */
+  shift = (63 - __builtin_clzll(value)) - SUB_BITS;
+  return (shift + 1) * SUB_CNT + (int)((value >> shift) - SUB_CNT);
+}
+
+/* largest value that falls in the given bucket */
+static uint64_t bucket_max(int idx)
+{
+  int shift;
+  uint64_t sub;
+
+  if (idx < SUB_CNT) {
+    return idx;
+  }
+  shift = idx / SUB_CNT - 1;
+  sub = idx % SUB_CNT + SUB_CNT;
+  return ((sub + 1) << shift) - 1;
+}
+
+bgpstream_histogram_t *bgpstream_histogram_create(void)
+{
+  bgpstream_histogram_t *hist;
+
+  if ((hist = malloc_zero(sizeof(bgpstream_histogram_t))) == NULL) {
+    return NULL;
+  }
+  hist->min = UINT64_MAX;
+  return hist;
+}
+
+void bgpstream_histogram_destroy(bgpstream_histogram_t *hist)
+{
+  free(hist);
+}
+
+void bgpstream_histogram_add(bgpstream_histogram_t *hist, uint64_t value)
+{
+  uint64_t cur;
+
+  if (value > VALUE_MAX) {
+    value = VALUE_MAX;
+  }
+
+  __atomic_add_fetch(&hist->buckets[bucket_idx(value)], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&hist->count, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&hist->sum, value, __ATOMIC_RELAXED);
+
+  cur = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+  while (value < cur &&
+         !__atomic_compare_exchange_n(&hist->min, &cur, value, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+  cur = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  while (value > cur &&
+         !__atomic_compare_exchange_n(&hist->max, &cur, value, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+uint64_t bgpstream_histogram_get_count(bgpstream_histogram_t *hist)
+{
+  return __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+}
+
+uint64_t bgpstream_histogram_get_min(bgpstream_histogram_t *hist)
+{
+  uint64_t min = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+
+  return min == UINT64_MAX ? 0 : min;
+}
+
+uint64_t bgpstream_histogram_get_max(bgpstream_histogram_t *hist)
+{
+  return __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+}
+
+double bgpstream_histogram_get_mean(bgpstream_histogram_t *hist)
+{
+  uint64_t count = bgpstream_histogram_get_count(hist);
+
+  if (count == 0) {
+    return 0;
+  }
+  return (double)__atomic_load_n(&hist->sum, __ATOMIC_RELAXED) / count;
+}
+
+uint64_t bgpstream_histogram_get_percentile(bgpstream_histogram_t *hist,
+                                            double percentile)
+{
+  uint64_t count = bgpstream_histogram_get_count(hist);
+  uint64_t max = bgpstream_histogram_get_max(hist);
+  uint64_t target;
+  uint64_t seen = 0;
+  uint64_t val;
+  int i;
+
+  if (count == 0) {
+    return 0;
+  }
+  if (percentile < 0) {
+    percentile = 0;
+  } else if (percentile > 100) {
+    percentile = 100;
+  }
+  if ((target = (uint64_t)ceil(percentile / 100 * count)) == 0) {
+    target = 1;
+  }
+
+  for (i = 0; i < BUCKET_CNT; i++) {
+    seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    if (seen >= target) {
+      val = bucket_max(i);
+      /* don't report more than was actually seen */
+      return val < max ? val : max;
+    }
+  }
+  return max;
+}
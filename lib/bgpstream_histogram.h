@@ -0,0 +1,123 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_HISTOGRAM_H
+#define __BGPSTREAM_HISTOGRAM_H
+
+#include <stdint.h>
+
+/** @file
+ *
+ * @brief Header file that exposes the protected interface of the bgpstream
+ * latency histogram.
+ *
+ * The histogram uses the same log-linear bucketing as HdrHistogram: values
+ * below 32 are counted exactly, and larger values are counted in buckets
+ * whose width is 1/32 of their magnitude, so every value is recorded with
+ * a relative error of at most ~3% using a fixed amount of memory (about
+ * 11KB for values up to 2^48).
+ *
+ * Values may be added from any thread, and queries may run concurrently
+ * with additions (in which case they see a recent, but not necessarily
+ * consistent, view of the histogram).
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+typedef struct bgpstream_histogram bgpstream_histogram_t;
+
+/** @} */
+
+/**
+ * @name Protected API Functions
+ *
+ * @{ */
+
+/** Create a new, empty histogram
+ *
+ * @return pointer to the histogram if successful, NULL otherwise
+ */
+bgpstream_histogram_t *bgpstream_histogram_create(void);
+
+/** Destroy the given histogram
+ *
+ * @param hist          pointer to the histogram to destroy
+ */
+void bgpstream_histogram_destroy(bgpstream_histogram_t *hist);
+
+/** Record a value in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @param value         value to record (values of 2^48 or more are recorded
+ *                      as 2^48-1)
+ */
+void bgpstream_histogram_add(bgpstream_histogram_t *hist, uint64_t value);
+
+/** Get the number of values recorded in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @return the number of values recorded
+ */
+uint64_t bgpstream_histogram_get_count(bgpstream_histogram_t *hist);
+
+/** Get the smallest value recorded in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @return the smallest value recorded, 0 if the histogram is empty
+ */
+uint64_t bgpstream_histogram_get_min(bgpstream_histogram_t *hist);
+
+/** Get the largest value recorded in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @return the largest value recorded, 0 if the histogram is empty
+ */
+uint64_t bgpstream_histogram_get_max(bgpstream_histogram_t *hist);
+
+/** Get the mean of the values recorded in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @return the (exact) mean of the values recorded, 0 if the histogram is
+ * empty
+ */
+double bgpstream_histogram_get_mean(bgpstream_histogram_t *hist);
+
+/** Get a percentile of the values recorded in the histogram
+ *
+ * @param hist          pointer to the histogram
+ * @param percentile    percentile to get (0-100)
+ * @return the largest value that falls in the same bucket as the value at
+ * the given percentile, 0 if the histogram is empty
+ */
+uint64_t bgpstream_histogram_get_percentile(bgpstream_histogram_t *hist,
+                                            double percentile);
+
+/** @} */
+
+#endif /* __BGPSTREAM_HISTOGRAM_H */
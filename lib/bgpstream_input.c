@@ -23,6 +23,7 @@
 
 #include "bgpstream_input.h"
 #include "bgpstream_debug.h"
+#include "bgpstream_stats.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -84,6 +85,8 @@ bool bgpstream_input_mgr_is_empty(
 /* Add a new input object to the sorted queue
  * managed by the bgpstream input manager
  * (bgpstream objects are sorted by filetime)
+ * Takes ownership of the name buffers, and returns 1 if the input was
+ * queued, 0 if it already was, or -1 if memory could not be allocated
  */
 int bgpstream_input_mgr_push_sorted_input(
   bgpstream_input_mgr_t *const bs_input_mgr, char *filename, char *fileproject,
@@ -95,11 +98,18 @@ int bgpstream_input_mgr_push_sorted_input(
     return 0; // if the bs_input_mgr is not initialized, then we cannot insert
               // any new input
   }
-  // create a new bgpstream_input object
+  // create a new bgpstream_input object (the callers strdup the names, so
+  // any of them may also be missing)
   bgpstream_input_t *bs_input =
     (bgpstream_input_t *)malloc(sizeof(bgpstream_input_t));
-  if (bs_input == NULL) {
-    return 0; // can't allocate memory
+  if (bs_input == NULL || filename == NULL || fileproject == NULL ||
+      filecollector == NULL || filetype == NULL) {
+    free(filename);
+    free(fileproject);
+    free(filecollector);
+    free(filetype);
+    free(bs_input);
+    return -1; // can't allocate memory
   }
   // initialize bgpstream_input fields
   bs_input->next = NULL;
@@ -113,6 +123,7 @@ int bgpstream_input_mgr_push_sorted_input(
 
   bs_input->epoch_filetime = epoch_filetime;
   bs_input->time_span = time_span;
+  bs_input->discovered_time = bgpstream_stats_wall_ms();
 
   // update the bs_input_mgr
   if (bs_input_mgr->status == BGPSTREAM_INPUT_MGR_STATUS_EMPTY_INPUT_QUEUE) {
@@ -134,6 +145,11 @@ int bgpstream_input_mgr_push_sorted_input(
           strcmp(current->filecollector, filecollector) == 0 &&
           strcmp(current->fileproject, fileproject) == 0 &&
           strcmp(current->filetype, filetype) == 0) {
+        free(filename);
+        free(fileproject);
+        free(filecollector);
+        free(filetype);
+        free(bs_input);
         return 0;
       }
       // ribs have higher priority (ribs and updates are grouped
@@ -26,6 +26,7 @@
 
 #include "bgpstream_constants.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct struct_bgpstream_input_t {
   struct struct_bgpstream_input_t *next;
@@ -36,6 +37,8 @@ typedef struct struct_bgpstream_input_t {
   int epoch_filetime;  // timestamp associated to the time the bgp data was
                        // generated
   int time_span;
+  uint64_t discovered_time; // wall time (ms) the input was found by the
+                            // data interface
 } bgpstream_input_t;
 
 typedef enum {
@@ -26,10 +26,14 @@
 
 #include "bgpstream.h"
 
+#include "bgpstream_cache.h"
 #include "bgpstream_datasource.h"
 #include "bgpstream_filter.h"
+#include "bgpstream_histogram.h"
 #include "bgpstream_input.h"
+#include "bgpstream_mem.h"
 #include "bgpstream_reader.h"
+#include "bgpstream_stats.h"
 
 typedef enum {
   BGPSTREAM_STATUS_ALLOCATED,
@@ -42,6 +46,13 @@ struct struct_bgpstream_t {
   bgpstream_reader_mgr_t *reader_mgr;
   bgpstream_filter_mgr_t *filter_mgr;
   bgpstream_datasource_mgr_t *datasource_mgr;
+  bgpstream_cache_t *cache;
+  bgpstream_stats_t *stats; // NULL unless stats are enabled
+  /* lag histograms (all NULL unless lag tracking is enabled) */
+  bgpstream_histogram_t *lag[BGPSTREAM_LAG_CNT];
+  bgpstream_mem_t *mem; // memory accounting (always enabled)
+  size_t filters_mem;   // bytes of filter memory accounted to mem
+  int mem_backpressure; // are the readers over their memory limit?
   bgpstream_status status;
 };
 
@@ -0,0 +1,145 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "utils.h"
+
+#include "bgpstream_mem.h"
+
+struct bgpstream_mem {
+  uint64_t bytes[BGPSTREAM_MEM_CNT];
+  uint64_t peak_bytes[BGPSTREAM_MEM_CNT];
+  uint64_t limit[BGPSTREAM_MEM_CNT];
+  int refs;
+};
+
+bgpstream_mem_t *bgpstream_mem_create(void)
+{
+  bgpstream_mem_t *mem;
+
+  if ((mem = malloc_zero(sizeof(bgpstream_mem_t))) == NULL) {
+    return NULL;
+  }
+  mem->refs = 1;
+  return mem;
+}
+
+bgpstream_mem_t *bgpstream_mem_ref(bgpstream_mem_t *mem)
+{
+  if (mem != NULL) {
+    __atomic_add_fetch(&mem->refs, 1, __ATOMIC_RELAXED);
+  }
+  return mem;
+}
+
+void bgpstream_mem_unref(bgpstream_mem_t *mem)
+{
+  if (mem != NULL && __atomic_sub_fetch(&mem->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    free(mem);
+  }
+}
+
+void bgpstream_mem_account(bgpstream_mem_t *mem,
+                           bgpstream_mem_subsystem_t subsystem,
+                           size_t *accounted, size_t size)
+{
+  uint64_t bytes, peak;
+
+  if (mem == NULL || *accounted == size) {
+    return;
+  }
+  if (size > *accounted) {
+    bytes = __atomic_add_fetch(&mem->bytes[subsystem], size - *accounted,
+                               __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&mem->peak_bytes[subsystem], __ATOMIC_RELAXED);
+    while (bytes > peak &&
+           !__atomic_compare_exchange_n(&mem->peak_bytes[subsystem], &peak,
+                                        bytes, 1, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+    }
+  } else {
+    __atomic_sub_fetch(&mem->bytes[subsystem], *accounted - size,
+                       __ATOMIC_RELAXED);
+  }
+  *accounted = size;
+}
+
+void bgpstream_mem_set_limit(bgpstream_mem_t *mem,
+                             bgpstream_mem_subsystem_t subsystem,
+                             uint64_t limit)
+{
+  __atomic_store_n(&mem->limit[subsystem], limit, __ATOMIC_RELAXED);
+}
+
+int bgpstream_mem_is_high(bgpstream_mem_t *mem,
+                          bgpstream_mem_subsystem_t subsystem)
+{
+  uint64_t limit;
+
+  if (mem == NULL ||
+      (limit = __atomic_load_n(&mem->limit[subsystem], __ATOMIC_RELAXED)) ==
+        0) {
+    return 0;
+  }
+  return __atomic_load_n(&mem->bytes[subsystem], __ATOMIC_RELAXED) >
+         limit / 4 * 3;
+}
+
+int bgpstream_mem_is_over(bgpstream_mem_t *mem,
+                          bgpstream_mem_subsystem_t subsystem)
+{
+  uint64_t limit;
+
+  if (mem == NULL ||
+      (limit = __atomic_load_n(&mem->limit[subsystem], __ATOMIC_RELAXED)) ==
+        0) {
+    return 0;
+  }
+  return __atomic_load_n(&mem->bytes[subsystem], __ATOMIC_RELAXED) > limit;
+}
+
+int bgpstream_mem_check_limits(bgpstream_mem_t *mem)
+{
+  int i;
+
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    if (bgpstream_mem_is_over(mem, i)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void bgpstream_mem_snapshot(bgpstream_mem_t *mem, bgpstream_mem_usage_t *usage)
+{
+  int i;
+
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    usage->bytes[i] = __atomic_load_n(&mem->bytes[i], __ATOMIC_RELAXED);
+    usage->peak_bytes[i] =
+      __atomic_load_n(&mem->peak_bytes[i], __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_MEM_H
+#define __BGPSTREAM_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bgpstream.h"
+
+/** @file
+ *
+ * @brief Header file that exposes the protected interface for accounting the
+ * memory used by a bgpstream instance.
+ *
+ * Each subsystem owner (a reader, a record, the filter manager) keeps track of
+ * the number of bytes it has accounted, and updates the shared counters
+ * whenever its usage changes. The counters are updated by both the main thread
+ * and the reader threads, and may be read by any thread, so all updates are
+ * made using (relaxed) atomic operations. Every helper is a no-op when given a
+ * NULL pointer.
+ *
+ * The accounting structure is reference counted so that records (which may
+ * outlive the stream they were read from) can safely release their share.
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+typedef struct bgpstream_mem bgpstream_mem_t;
+
+/** @} */
+
+/**
+ * @name Protected API Functions
+ *
+ * @{ */
+
+/** Create a new memory accounting structure (with a single reference)
+ *
+ * @return pointer to the structure if successful, NULL otherwise
+ */
+bgpstream_mem_t *bgpstream_mem_create(void);
+
+/** Take a new reference to the given accounting structure
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ * @return mem
+ */
+bgpstream_mem_t *bgpstream_mem_ref(bgpstream_mem_t *mem);
+
+/** Release a reference to the given accounting structure, destroying it if
+ * it was the last one
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ */
+void bgpstream_mem_unref(bgpstream_mem_t *mem);
+
+/** Update the number of bytes accounted by an owner
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ * @param subsystem     subsystem that the bytes belong to
+ * @param accounted     pointer to the number of bytes the owner has already
+ *                      accounted (updated to size)
+ * @param size          number of bytes the owner is now using
+ */
+void bgpstream_mem_account(bgpstream_mem_t *mem,
+                           bgpstream_mem_subsystem_t subsystem,
+                           size_t *accounted, size_t size);
+
+/** Set the limit of the given subsystem
+ *
+ * @param mem           pointer to the structure
+ * @param subsystem     subsystem to limit
+ * @param limit         max number of bytes, 0 for no limit
+ */
+void bgpstream_mem_set_limit(bgpstream_mem_t *mem,
+                             bgpstream_mem_subsystem_t subsystem,
+                             uint64_t limit);
+
+/** Check whether the usage of the given subsystem is close enough to its
+ * limit that it should try to use less memory
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ * @param subsystem     subsystem to check
+ * @return 1 if the subsystem is using more than 3/4 of its limit, 0 otherwise
+ */
+int bgpstream_mem_is_high(bgpstream_mem_t *mem,
+                          bgpstream_mem_subsystem_t subsystem);
+
+/** Check whether the given subsystem is using more than its limit
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ * @param subsystem     subsystem to check
+ * @return 1 if the subsystem is over its limit, 0 otherwise
+ */
+int bgpstream_mem_is_over(bgpstream_mem_t *mem,
+                          bgpstream_mem_subsystem_t subsystem);
+
+/** Find a subsystem that is using more than its limit
+ *
+ * @param mem           pointer to the structure (may be NULL)
+ * @return the first subsystem that is over its limit, -1 if there are none
+ */
+int bgpstream_mem_check_limits(bgpstream_mem_t *mem);
+
+/** Take a (per-field) snapshot of the usage
+ *
+ * @param mem           pointer to the structure
+ * @param usage         pointer to the structure to copy the usage into
+ */
+void bgpstream_mem_snapshot(bgpstream_mem_t *mem,
+                            bgpstream_mem_usage_t *usage);
+
+/** @} */
+
+#endif /* __BGPSTREAM_MEM_H */
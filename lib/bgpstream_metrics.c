@@ -0,0 +1,522 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#include "bgpstream_debug.h"
+#include "bgpstream_metrics.h"
+
+/* statsd packets are kept below a typical MTU */
+#define STATSD_PACKET_MAX 1400
+
+#define STATSD_URL "udp://"
+
+#define TMP_SUFFIX ".tmp"
+
+struct bgpstream_metrics {
+  /* stream being reported on (borrowed) */
+  bgpstream_t *bs;
+
+  /* prefix for metric names */
+  char *prefix;
+
+  /* seconds between reports */
+  int interval;
+
+  /* file to write (NULL if sending to statsd) */
+  char *path;
+
+  /* temporary file that reports are written to before being renamed */
+  char *tmp_path;
+
+  /* socket and address of the statsd server (if not writing a file) */
+  int sock;
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+
+  /* application callback */
+  bgpstream_metrics_cb_t *cb;
+  void *cb_user;
+
+  /* emitter thread */
+  pthread_t thread;
+  int started;
+  int shutdown;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* report being built */
+  char *buf;
+  size_t buf_len;
+  size_t buf_alloc;
+
+  /* name of the last metric written (so that type info is only written once
+     for each labelled metric) */
+  char last_name[256];
+
+  /* statsd packet being built */
+  char pkt[STATSD_PACKET_MAX];
+  size_t pkt_len;
+
+  /* wall time that the emitter was created */
+  time_t start_time;
+
+  /* values from the previous report, used to compute rates */
+  uint64_t last_records;
+  uint64_t last_report_ns;
+};
+
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int buf_printf(bgpstream_metrics_t *m, const char *fmt, ...)
+{
+  va_list ap;
+  int len;
+  char *tmp;
+
+  while (1) {
+    va_start(ap, fmt);
+    len = vsnprintf(m->buf + m->buf_len, m->buf_alloc - m->buf_len, fmt, ap);
+    va_end(ap);
+    if (len < 0) {
+      return -1;
+    }
+    if (m->buf_len + len < m->buf_alloc) {
+      m->buf_len += len;
+      return 0;
+    }
+    if ((tmp = realloc(m->buf, m->buf_alloc * 2)) == NULL) {
+      return -1;
+    }
+    m->buf = tmp;
+    m->buf_alloc *= 2;
+  }
+}
+
+static void statsd_flush(bgpstream_metrics_t *m)
+{
+  if (m->pkt_len == 0) {
+    return;
+  }
+  if (sendto(m->sock, m->pkt, m->pkt_len, 0, (struct sockaddr *)&m->addr,
+             m->addr_len) < 0) {
+    bgpstream_log_warn("Could not send metrics: %s", strerror(errno));
+  }
+  m->pkt_len = 0;
+}
+
+/* add a line to the statsd packet, sending the packet first if it is full */
+static void statsd_add_line(bgpstream_metrics_t *m)
+{
+  if (m->pkt_len + m->buf_len > sizeof(m->pkt)) {
+    statsd_flush(m);
+  }
+  if (m->buf_len > sizeof(m->pkt)) {
+    /* too long to ever send */
+    return;
+  }
+  memcpy(m->pkt + m->pkt_len, m->buf, m->buf_len);
+  m->pkt_len += m->buf_len;
+}
+
+void bgpstream_metrics_write(bgpstream_metrics_t *m, const char *name,
+                             const char *label, const char *label_value,
+                             bgpstream_metrics_type_t type, double value)
+{
+  if (m->path == NULL) {
+    /* statsd has no labels, so they become part of the name, and counters
+       are reported as gauges since statsd counters are per-interval */
+    m->buf_len = 0;
+    if (label != NULL) {
+      buf_printf(m, "%s.%s.%s:%.15g|g\n", m->prefix, name, label_value, value);
+    } else {
+      buf_printf(m, "%s.%s:%.15g|g\n", m->prefix, name, value);
+    }
+    statsd_add_line(m);
+    return;
+  }
+
+  if (strcmp(name, m->last_name) != 0) {
+    buf_printf(m, "# TYPE %s_%s %s\n", m->prefix, name,
+               type == BGPSTREAM_METRICS_TYPE_COUNTER ? "counter" : "gauge");
+    snprintf(m->last_name, sizeof(m->last_name), "%s", name);
+  }
+  if (label != NULL) {
+    buf_printf(m, "%s_%s{%s=\"%s\"} %.15g\n", m->prefix, name, label,
+               label_value, value);
+  } else {
+    buf_printf(m, "%s_%s %.15g\n", m->prefix, name, value);
+  }
+}
+
+static void write_stream_metrics(bgpstream_metrics_t *m)
+{
+  bgpstream_stats_t st;
+  uint64_t now_ns = monotonic_ns();
+  time_t now = time(NULL);
+  double rate = 0;
+  int i;
+
+#define COUNTER(name, val)                                                     \
+  bgpstream_metrics_write(m, name, NULL, NULL, BGPSTREAM_METRICS_TYPE_COUNTER, \
+                          (val))
+#define GAUGE(name, val)                                                       \
+  bgpstream_metrics_write(m, name, NULL, NULL, BGPSTREAM_METRICS_TYPE_GAUGE,   \
+                          (val))
+
+  GAUGE("uptime_seconds", now - m->start_time);
+
+  if (bgpstream_get_stats(m->bs, &st) != 0) {
+    return;
+  }
+
+  for (i = 0; i < BGPSTREAM_STAGE_CNT; i++) {
+    bgpstream_metrics_write(m, "stage_seconds_total", "stage",
+                            bgpstream_get_stage_name(i),
+                            BGPSTREAM_METRICS_TYPE_COUNTER,
+                            st.stage_ns[i] / 1e9);
+  }
+  COUNTER("datasource_queries_total", st.datasource_queries);
+  COUNTER("dumps_opened_total", st.dumps_opened);
+  COUNTER("dumps_failed_total", st.dumps_failed);
+  COUNTER("dump_open_retries_total", st.dump_open_retries);
+  COUNTER("bytes_read_total", st.bytes_read);
+  COUNTER("records_parsed_total", st.records_parsed);
+  COUNTER("records_filtered_total", st.records_filtered);
+  COUNTER("records_corrupted_total", st.records_corrupted);
+  COUNTER("elems_generated_total", st.elems_generated);
+  COUNTER("elems_filtered_total", st.elems_filtered);
+  GAUGE("readers_open", st.readers_open);
+  GAUGE("inputs_queued", st.inputs_queued);
+
+  /* rate over the last reporting period */
+  if (m->last_report_ns != 0 && now_ns > m->last_report_ns) {
+    rate = (st.records_parsed - m->last_records) /
+           ((now_ns - m->last_report_ns) / 1e9);
+  }
+  m->last_records = st.records_parsed;
+  m->last_report_ns = now_ns;
+  GAUGE("records_per_second", rate);
+
+  /* how far behind the wall clock the stream is (only meaningful in live
+     mode, and only once a record has been read) */
+  if (st.last_record_time != 0) {
+    GAUGE("last_record_timestamp_seconds", st.last_record_time);
+    GAUGE("lag_seconds", (double)now - (double)st.last_record_time);
+  }
+
+#undef COUNTER
+#undef GAUGE
+}
+
+/* distribution of each lag (if lag tracking is enabled) */
+static void write_lag_metrics(bgpstream_metrics_t *m)
+{
+  bgpstream_lag_summary_t sum[BGPSTREAM_LAG_CNT];
+  int i;
+
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {
+    if (bgpstream_get_lag_summary(m->bs, i, &sum[i]) != 0) {
+      return;
+    }
+  }
+
+  /* all series of a metric must be written together */
+#define LAG_METRIC(name, type, val)                                            \
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {                                    \
+    bgpstream_metrics_write(m, name, "lag", bgpstream_get_lag_name(i), type,   \
+                            (val));                                            \
+  }
+  LAG_METRIC("lag_samples_total", BGPSTREAM_METRICS_TYPE_COUNTER, sum[i].count);
+  LAG_METRIC("lag_p50_seconds", BGPSTREAM_METRICS_TYPE_GAUGE,
+             sum[i].p50 / 1e3);
+  LAG_METRIC("lag_p90_seconds", BGPSTREAM_METRICS_TYPE_GAUGE,
+             sum[i].p90 / 1e3);
+  LAG_METRIC("lag_p99_seconds", BGPSTREAM_METRICS_TYPE_GAUGE,
+             sum[i].p99 / 1e3);
+  LAG_METRIC("lag_max_seconds", BGPSTREAM_METRICS_TYPE_GAUGE,
+             sum[i].max / 1e3);
+#undef LAG_METRIC
+}
+
+/* memory used by each subsystem */
+static void write_mem_metrics(bgpstream_metrics_t *m)
+{
+  bgpstream_mem_usage_t usage;
+  int i;
+
+  if (bgpstream_get_mem_usage(m->bs, &usage) != 0) {
+    return;
+  }
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    bgpstream_metrics_write(m, "mem_bytes", "subsystem",
+                            bgpstream_get_mem_subsystem_name(i),
+                            BGPSTREAM_METRICS_TYPE_GAUGE, usage.bytes[i]);
+  }
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    bgpstream_metrics_write(m, "mem_peak_bytes", "subsystem",
+                            bgpstream_get_mem_subsystem_name(i),
+                            BGPSTREAM_METRICS_TYPE_GAUGE, usage.peak_bytes[i]);
+  }
+}
+
+static int write_file(bgpstream_metrics_t *m)
+{
+  FILE *fh;
+
+  if ((fh = fopen(m->tmp_path, "w")) == NULL) {
+    bgpstream_log_warn("Could not open %s: %s", m->tmp_path, strerror(errno));
+    return -1;
+  }
+  if (fwrite(m->buf, 1, m->buf_len, fh) != m->buf_len) {
+    bgpstream_log_warn("Could not write %s: %s", m->tmp_path, strerror(errno));
+    fclose(fh);
+    return -1;
+  }
+  if (fclose(fh) != 0 || rename(m->tmp_path, m->path) != 0) {
+    bgpstream_log_warn("Could not replace %s: %s", m->path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+static void report(bgpstream_metrics_t *m)
+{
+  m->buf_len = 0;
+  m->pkt_len = 0;
+  m->last_name[0] = '\0';
+
+  write_stream_metrics(m);
+  write_lag_metrics(m);
+  write_mem_metrics(m);
+  if (m->cb != NULL) {
+    m->cb(m, m->cb_user);
+  }
+
+  if (m->path != NULL) {
+    write_file(m);
+  } else {
+    statsd_flush(m);
+  }
+}
+
+static void *emitter_thread(void *user)
+{
+  bgpstream_metrics_t *m = (bgpstream_metrics_t *)user;
+  struct timespec deadline;
+  int shutdown = 0;
+
+  while (shutdown == 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += m->interval;
+
+    pthread_mutex_lock(&m->mutex);
+    while (m->shutdown == 0 &&
+           pthread_cond_timedwait(&m->cond, &m->mutex, &deadline) !=
+             ETIMEDOUT) {
+      /* spurious wakeup */
+    }
+    shutdown = m->shutdown;
+    pthread_mutex_unlock(&m->mutex);
+
+    /* the final report is written on shutdown */
+    report(m);
+  }
+
+  return NULL;
+}
+
+static int open_statsd(bgpstream_metrics_t *m, const char *dest)
+{
+  struct addrinfo hints, *res = NULL;
+  char *host = NULL;
+  char *addr;
+  char *port;
+  int rc;
+
+  /* udp://host:port, where host may be a bracketed IPv6 address */
+  if ((host = strdup(dest + strlen(STATSD_URL))) == NULL) {
+    goto err;
+  }
+  addr = host;
+  if (host[0] == '[') {
+    /* the port follows the closing bracket */
+    if ((port = strchr(host, ']')) == NULL || port[1] != ':') {
+      port = NULL;
+    } else {
+      *(port++) = '\0';
+      addr++;
+    }
+  } else {
+    port = strrchr(host, ':');
+  }
+  if (port == NULL) {
+    bgpstream_log_err("Metrics destination %s has no port", dest);
+    goto err;
+  }
+  *(port++) = '\0';
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  if ((rc = getaddrinfo(addr, port, &hints, &res)) != 0) {
+    bgpstream_log_err("Could not resolve %s: %s", dest, gai_strerror(rc));
+    goto err;
+  }
+  if ((m->sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol)) <
+      0) {
+    bgpstream_log_err("Could not create socket: %s", strerror(errno));
+    goto err;
+  }
+  memcpy(&m->addr, res->ai_addr, res->ai_addrlen);
+  m->addr_len = res->ai_addrlen;
+
+  freeaddrinfo(res);
+  free(host);
+  return 0;
+
+err:
+  if (res != NULL) {
+    freeaddrinfo(res);
+  }
+  free(host);
+  return -1;
+}
+
+bgpstream_metrics_t *bgpstream_metrics_create(bgpstream_t *bs,
+                                              const char *dest,
+                                              const char *prefix,
+                                              int interval)
+{
+  bgpstream_metrics_t *m;
+
+  if (interval <= 0) {
+    bgpstream_log_err("Metrics interval must be positive");
+    return NULL;
+  }
+
+  if ((m = malloc_zero(sizeof(bgpstream_metrics_t))) == NULL) {
+    return NULL;
+  }
+  m->bs = bs;
+  m->interval = interval;
+  m->sock = -1;
+  m->start_time = time(NULL);
+  pthread_mutex_init(&m->mutex, NULL);
+  pthread_cond_init(&m->cond, NULL);
+
+  if ((m->prefix = strdup(prefix)) == NULL) {
+    goto err;
+  }
+  m->buf_alloc = 4096;
+  if ((m->buf = malloc(m->buf_alloc)) == NULL) {
+    goto err;
+  }
+
+  if (strncmp(dest, STATSD_URL, strlen(STATSD_URL)) == 0) {
+    if (open_statsd(m, dest) != 0) {
+      goto err;
+    }
+  } else {
+    if ((m->path = strdup(dest)) == NULL ||
+        (m->tmp_path = malloc(strlen(dest) + sizeof(TMP_SUFFIX))) == NULL) {
+      goto err;
+    }
+    strcpy(m->tmp_path, dest);
+    strcat(m->tmp_path, TMP_SUFFIX);
+  }
+
+  bgpstream_enable_stats(bs);
+  return m;
+
+err:
+  bgpstream_metrics_destroy(m);
+  return NULL;
+}
+
+void bgpstream_metrics_set_callback(bgpstream_metrics_t *metrics,
+                                    bgpstream_metrics_cb_t *cb, void *user)
+{
+  metrics->cb = cb;
+  metrics->cb_user = user;
+}
+
+int bgpstream_metrics_start(bgpstream_metrics_t *metrics)
+{
+  if (metrics->started != 0) {
+    return 0;
+  }
+  if (pthread_create(&metrics->thread, NULL, emitter_thread, metrics) != 0) {
+    bgpstream_log_err("Could not start metrics thread");
+    return -1;
+  }
+  metrics->started = 1;
+  return 0;
+}
+
+void bgpstream_metrics_destroy(bgpstream_metrics_t *metrics)
+{
+  if (metrics == NULL) {
+    return;
+  }
+
+  if (metrics->started != 0) {
+    pthread_mutex_lock(&metrics->mutex);
+    metrics->shutdown = 1;
+    pthread_cond_signal(&metrics->cond);
+    pthread_mutex_unlock(&metrics->mutex);
+    pthread_join(metrics->thread, NULL);
+  }
+
+  if (metrics->sock >= 0) {
+    close(metrics->sock);
+  }
+  free(metrics->prefix);
+  free(metrics->path);
+  free(metrics->tmp_path);
+  free(metrics->buf);
+  pthread_mutex_destroy(&metrics->mutex);
+  pthread_cond_destroy(&metrics->cond);
+  free(metrics);
+}
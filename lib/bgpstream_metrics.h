@@ -0,0 +1,170 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_METRICS_H
+#define __BGPSTREAM_METRICS_H
+
+#include "bgpstream.h"
+
+/** @file
+ *
+ * @brief Header file that exposes the public interface of the bgpstream
+ * metrics emitter.
+ *
+ * The metrics emitter is a background thread that periodically reports the
+ * health of a long-running stream (record rate, lag behind the wall clock,
+ * number of open readers, memory used by each subsystem, time spent in each
+ * processing stage, etc.) so that it can be monitored and alerted on. If lag
+ * tracking is enabled on the stream (see bgpstream_enable_lag_tracking),
+ * percentiles of each lag are reported too.
+ *
+ * Metrics can be written either to a file, using the Prometheus text
+ * exposition format (e.g. for the node_exporter textfile collector), or sent
+ * to a statsd (or compatible) server over UDP. Files are replaced atomically,
+ * so a reader never sees a partially written file.
+ *
+ * Applications can add their own metrics to each report by registering a
+ * callback (see bgpstream_metrics_set_callback).
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+/** Opaque handle that represents a metrics emitter */
+typedef struct bgpstream_metrics bgpstream_metrics_t;
+
+/** @} */
+
+/**
+ * @name Public Enums
+ *
+ * @{ */
+
+/** Type of a metric */
+typedef enum {
+
+  /** A value that only ever increases (e.g. number of records processed) */
+  BGPSTREAM_METRICS_TYPE_COUNTER = 0,
+
+  /** A value that can go up and down (e.g. number of open readers) */
+  BGPSTREAM_METRICS_TYPE_GAUGE = 1,
+
+} bgpstream_metrics_type_t;
+
+/** @} */
+
+/**
+ * @name Public Data Structures
+ *
+ * @{ */
+
+/** Callback used to add application metrics to a report
+ *
+ * @param metrics       pointer to the metrics emitter
+ * @param user          user pointer given to bgpstream_metrics_set_callback
+ *
+ * The callback is run in the emitter thread, and should call
+ * bgpstream_metrics_write for each metric it wants to report.
+ */
+typedef void(bgpstream_metrics_cb_t)(bgpstream_metrics_t *metrics,
+                                     void *user);
+
+/** @} */
+
+/**
+ * @name Public API Functions
+ *
+ * @{ */
+
+/** Create a metrics emitter for the given stream
+ *
+ * @param bs            pointer to the BGP Stream instance to report on
+ * @param dest          destination of the metrics, either "udp://host:port"
+ *                      for statsd, or the path of a file to write
+ * @param prefix        prefix for all metric names (e.g. "bgpreader")
+ * @param interval      number of seconds between reports
+ * @return pointer to a metrics emitter if successful, NULL otherwise
+ *
+ * This enables statistics on the stream (see bgpstream_enable_stats), so it
+ * must be called before bgpstream_start. The emitter must be destroyed before
+ * the stream is.
+ */
+bgpstream_metrics_t *bgpstream_metrics_create(bgpstream_t *bs,
+                                              const char *dest,
+                                              const char *prefix,
+                                              int interval);
+
+/** Register a callback to add application metrics to each report
+ *
+ * @param metrics       pointer to the metrics emitter
+ * @param cb            callback to run for each report
+ * @param user          user pointer to pass to the callback
+ *
+ * This must be called before bgpstream_metrics_start.
+ */
+void bgpstream_metrics_set_callback(bgpstream_metrics_t *metrics,
+                                    bgpstream_metrics_cb_t *cb, void *user);
+
+/** Start the emitter thread
+ *
+ * @param metrics       pointer to the metrics emitter
+ * @return 0 if the thread was started successfully, -1 otherwise
+ */
+int bgpstream_metrics_start(bgpstream_metrics_t *metrics);
+
+/** Add a metric to the report that is being written
+ *
+ * @param metrics       pointer to the metrics emitter
+ * @param name          name of the metric (without the prefix), which should
+ *                      only contain [a-z0-9_]
+ * @param label         name of the label that distinguishes instances of the
+ *                      metric (e.g. "plugin"), or NULL if there is only one
+ * @param label_value   value of the label (e.g. "pfxmonitor")
+ * @param type          type of the metric
+ * @param value         current value of the metric
+ *
+ * This may only be called from a callback registered using
+ * bgpstream_metrics_set_callback. All instances of a labelled metric should
+ * be written one after the other.
+ */
+void bgpstream_metrics_write(bgpstream_metrics_t *metrics, const char *name,
+                             const char *label, const char *label_value,
+                             bgpstream_metrics_type_t type, double value);
+
+/** Stop and destroy the given metrics emitter
+ *
+ * @param metrics       pointer to the metrics emitter to destroy
+ *
+ * If the emitter thread is running, a final report is written before it
+ * stops.
+ */
+void bgpstream_metrics_destroy(bgpstream_metrics_t *metrics);
+
+/** @} */
+
+#endif /* __BGPSTREAM_METRICS_H */
@@ -22,14 +22,17 @@
  */
 
 #include <assert.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "bgpstream_debug.h"
 #include "bgpstream_input.h"
 #include "bgpstream_reader.h"
+#include "bgpstream_seek_index.h"
 
 #include "utils.h"
 
@@ -38,12 +41,20 @@
 #define DUMP_OPEN_MAX_RETRIES 5
 #define DUMP_OPEN_MIN_RETRY_WAIT 10
 
+/* add a checkpoint to the seek index every ~1MB of (uncompressed) MRT */
+#define SEEK_INDEX_CHECKPOINT_BYTES (1024 * 1024)
+
+/* update the memory accounting every ~64KB of (uncompressed) MRT */
+#define MEM_UPDATE_BYTES (64 * 1024)
+
 struct struct_bgpstream_reader_t {
   struct struct_bgpstream_reader_t *next;
   char dump_name[BGPSTREAM_DUMP_MAX_LEN];     // name of bgp dump
-  char dump_project[BGPSTREAM_PAR_MAX_LEN];   // name of bgp project
-  char dump_collector[BGPSTREAM_PAR_MAX_LEN]; // name of bgp collector
-  char dump_type[BGPSTREAM_PAR_MAX_LEN]; // type of bgp dump (rib or update)
+  const char *dump_project;   // name of bgp project (interned)
+  const char *dump_collector; // name of bgp collector (interned)
+  bgpstream_str_id_t dump_project_id;
+  bgpstream_str_id_t dump_collector_id;
+  bgpstream_record_dump_type_t dump_type; // type of bgp dump (rib or update)
   long
     dump_time; // timestamp associated with the time the bgp data was aggregated
   long record_time; // timestamp associated with the current bd_entry
@@ -53,6 +64,26 @@ struct struct_bgpstream_reader_t {
   bgpstream_reader_status_t status;
 
   BGPDUMP *bd_mgr;
+  /** Download cache to fetch the dump through (may be NULL) */
+  bgpstream_cache_t *cache;
+  /** Processing stats to update (may be NULL) */
+  bgpstream_stats_t *stats;
+  /** Histogram to record the open lag in (may be NULL) */
+  bgpstream_histogram_t *open_lag;
+  /** Wall time (ms) that the dump was found by the data interface */
+  uint64_t discovered_time;
+  /** Memory accounting to update (may be NULL) */
+  bgpstream_mem_t *mem;
+  /** Bytes accounted for the reader and its bgpdump */
+  size_t mem_reader;
+  /** Bytes accounted for the peer index table of the dump */
+  size_t mem_peer_index;
+  /** Bytes accounted for the (estimated) wandio buffers of the dump */
+  size_t mem_wandio;
+  /** Has the dump been asked to use less memory? */
+  int low_mem;
+  /** Offset at which the memory accounting was last updated */
+  uint64_t mem_offset;
   /** The thread that opens the bgpdump */
   pthread_t producer;
   /* has the thread opened the dump? */
@@ -61,28 +92,205 @@ struct struct_bgpstream_reader_t {
   pthread_mutex_t mutex;
   /* have we already checked that the dump is ready? */
   int skip_dump_check;
+
+  /** Path of the (possibly cached) file that was actually opened */
+  char dump_path[BGPSTREAM_DUMP_MAX_LEN];
+  /** Should we use (and build) a sidecar seek index for this dump? */
+  int seek_index;
+  /** Time of the earliest record that the filters can accept */
+  uint32_t seek_time;
+  /** Index being built while the dump is read (NULL if not building) */
+  bgpstream_seek_index_t *index_builder;
+  /** Largest record time read so far */
+  uint32_t index_max_time;
+  /** Offset of the last checkpoint added to the index */
+  uint64_t index_last_offset;
 };
 
+/* skip to the start of the interesting part of the dump if there is an index,
+   or start building one if there is not */
+static void seek_dump(bgpstream_reader_t *bsr)
+{
+  bgpstream_seek_index_t *idx;
+  uint64_t offset;
+
+  /* only update dumps are indexed: all the records in a RIB have (roughly)
+     the same time, and TABLE_DUMP_V2 records depend on the peer index table
+     at the start of the file */
+  if (bsr->seek_index == 0 || bsr->dump_type != BGPSTREAM_UPDATE ||
+      strstr(bsr->dump_path, "://") != NULL) {
+    return;
+  }
+
+  if ((idx = bgpstream_seek_index_load(bsr->dump_path)) != NULL) {
+    offset = bgpstream_seek_index_lookup(idx, bsr->seek_time);
+    bgpstream_seek_index_destroy(idx);
+    if (offset == 0) {
+      return;
+    }
+    bgpstream_debug("\t\tBSR: skipping to offset %" PRIu64 " of %s", offset,
+                    bsr->dump_path);
+    if (bgpdump_skip_to(bsr->bd_mgr, offset) == 0) {
+      return;
+    }
+    /* the index does not match the dump after all, so get rid of it and
+       start again from the beginning (building a new index) */
+    bgpstream_log_warn("Could not seek into %s, reading it from the start",
+                       bsr->dump_path);
+    bgpstream_seek_index_remove(bsr->dump_path);
+    bgpdump_close_dump(bsr->bd_mgr);
+    if ((bsr->bd_mgr = bgpdump_open_dump(bsr->dump_path)) == NULL) {
+      return;
+    }
+    bsr->bd_mgr->timing = (bsr->stats != NULL);
+  }
+
+  /* no index yet, so build one while we read the dump */
+  bsr->index_builder = bgpstream_seek_index_create();
+  bsr->index_max_time = 0;
+  bsr->index_last_offset = 0;
+}
+
+/* update the index being built with the record that was just read */
+static void update_index(bgpstream_reader_t *bsr)
+{
+  BGPDUMP *bd = bsr->bd_mgr;
+
+  if (bd->corrupted_read) {
+    /* don't trust anything we learned about this file */
+    goto done;
+  }
+  if (bd->eof != 0) {
+    /* we have seen the whole dump, so the index is complete */
+    bgpstream_seek_index_write(bsr->index_builder, bsr->dump_path);
+    goto done;
+  }
+
+  if (bd->last_time > bsr->index_max_time) {
+    bsr->index_max_time = bd->last_time;
+  }
+  if (bd->offset - bsr->index_last_offset >= SEEK_INDEX_CHECKPOINT_BYTES) {
+    if (bgpstream_seek_index_add(bsr->index_builder, bsr->index_max_time,
+                                 bd->offset) != 0) {
+      goto done;
+    }
+    bsr->index_last_offset = bd->offset;
+  }
+  return;
+
+done:
+  bgpstream_seek_index_destroy(bsr->index_builder);
+  bsr->index_builder = NULL;
+}
+
+/* update the memory accounted for the reader, and ask the dump to use less
+   memory if the readers are getting close to their limit */
+static void update_mem(bgpstream_reader_t *bsr)
+{
+  int high;
+
+  if (bsr->mem == NULL) {
+    return;
+  }
+  if (bsr->bd_mgr == NULL) {
+    bgpstream_mem_account(bsr->mem, BGPSTREAM_MEM_READERS, &bsr->mem_reader,
+                          sizeof(*bsr));
+    return;
+  }
+  bgpstream_mem_account(bsr->mem, BGPSTREAM_MEM_READERS, &bsr->mem_reader,
+                        sizeof(*bsr) + bgpdump_get_mem_size(bsr->bd_mgr));
+  bgpstream_mem_account(bsr->mem, BGPSTREAM_MEM_PEER_INDEX,
+                        &bsr->mem_peer_index,
+                        bgpdump_get_peer_index_mem_size(bsr->bd_mgr));
+  bgpstream_mem_account(bsr->mem, BGPSTREAM_MEM_WANDIO_ESTIMATE,
+                        &bsr->mem_wandio,
+                        bgpdump_get_mem_estimate(bsr->bd_mgr));
+  high = bgpstream_mem_is_high(bsr->mem, BGPSTREAM_MEM_READERS);
+  if (high != bsr->low_mem) {
+    bgpdump_set_low_mem(bsr->bd_mgr, high);
+    bsr->low_mem = high;
+  }
+  bsr->mem_offset = bsr->bd_mgr->offset;
+}
+
 static void *thread_producer(void *user)
 {
   bgpstream_reader_t *bsr = (bgpstream_reader_t *)user;
   int retries = 0;
   int delay = DUMP_OPEN_MIN_RETRY_WAIT;
+  char cache_path[BGPSTREAM_DUMP_MAX_LEN];
+  const char *dump_path = NULL;
+  uint64_t start = bgpstream_stats_start(bsr->stats);
+  uint64_t download_start;
+  uint64_t download_ns = 0;
+  uint64_t now_ms;
 
   /* all we do is open the dump */
   /* but try a few times in case there is a transient failure */
   while (retries < DUMP_OPEN_MAX_RETRIES && bsr->bd_mgr == NULL) {
-    if ((bsr->bd_mgr = bgpdump_open_dump(bsr->dump_name)) == NULL) {
+    /* if there is a cache, make sure we have a local copy of the dump first */
+    dump_path = bsr->dump_name;
+    if (bsr->cache != NULL) {
+      download_start = bgpstream_stats_start(bsr->stats);
+      if (bgpstream_cache_get(bsr->cache, bsr->dump_name, cache_path,
+                              sizeof(cache_path)) == 0) {
+        dump_path = cache_path;
+      }
+      download_ns += bgpstream_stats_start(bsr->stats) - download_start;
+    }
+    if ((bsr->bd_mgr = bgpdump_open_dump(dump_path)) == NULL) {
+      /* each successful get holds its own reference */
+      if (dump_path == cache_path) {
+        bgpstream_cache_release(bsr->cache, bsr->dump_name);
+      }
       fprintf(stderr, "WARN: Could not open dumpfile (%s). Attempt %d of %d\n",
               bsr->dump_name, retries + 1, DUMP_OPEN_MAX_RETRIES);
       retries++;
       if (retries < DUMP_OPEN_MAX_RETRIES) {
+        BGPSTREAM_STATS_ADD(bsr->stats, dump_open_retries, 1);
         sleep(delay);
         delay *= 2;
       }
     }
   }
 
+  if (bsr->stats != NULL) {
+    BGPSTREAM_STATS_ADD(bsr->stats, stage_ns[BGPSTREAM_STAGE_DOWNLOAD],
+                        download_ns);
+    BGPSTREAM_STATS_ADD(bsr->stats, stage_ns[BGPSTREAM_STAGE_OPEN],
+                        bgpstream_stats_now() - start - download_ns);
+  }
+
+  if (bsr->bd_mgr != NULL) {
+    if (bsr->open_lag != NULL) {
+      now_ms = bgpstream_stats_wall_ms();
+      bgpstream_histogram_add(bsr->open_lag,
+                              now_ms > bsr->discovered_time
+                                ? now_ms - bsr->discovered_time
+                                : 0);
+    }
+    BGPSTREAM_STATS_ADD(bsr->stats, dumps_opened, 1);
+    bsr->bd_mgr->timing = (bsr->stats != NULL);
+    strcpy(bsr->dump_path, dump_path);
+    seek_dump(bsr);
+  }
+
+  if (bsr->bd_mgr != NULL) {
+    /* anything skipped over was still read (and decompressed) */
+    BGPSTREAM_STATS_ADD(bsr->stats, stage_ns[BGPSTREAM_STAGE_READ],
+                        bsr->bd_mgr->read_ns);
+    BGPSTREAM_STATS_ADD(bsr->stats, bytes_read, bsr->bd_mgr->offset);
+    update_mem(bsr);
+  } else {
+    BGPSTREAM_STATS_ADD(bsr->stats, dumps_failed, 1);
+  }
+
+  /* once the dump (and its seek index) is open, the cached copy may be
+     evicted */
+  if (bsr->bd_mgr != NULL && dump_path == cache_path) {
+    bgpstream_cache_release(bsr->cache, bsr->dump_name);
+  }
+
   pthread_mutex_lock(&bsr->mutex);
   if (bsr->bd_mgr == NULL) {
     fprintf(
@@ -98,14 +306,41 @@ static void *thread_producer(void *user)
   return NULL;
 }
 
+/* read the next entry from bgpdump, splitting the time taken between reading
+   and parsing */
+static BGPDUMP_ENTRY *read_next_timed(bgpstream_reader_t *bsr)
+{
+  BGPDUMP *bd = bsr->bd_mgr;
+  uint64_t read_ns = bd->read_ns;
+  uint64_t offset = bd->offset;
+  uint64_t start = bgpstream_stats_now();
+  BGPDUMP_ENTRY *entry;
+  uint64_t elapsed;
+
+  entry = bgpdump_read_next(bd);
+  elapsed = bgpstream_stats_now() - start;
+  read_ns = bd->read_ns - read_ns;
+
+  BGPSTREAM_STATS_ADD(bsr->stats, stage_ns[BGPSTREAM_STAGE_READ], read_ns);
+  BGPSTREAM_STATS_ADD(bsr->stats, stage_ns[BGPSTREAM_STAGE_PARSE],
+                      elapsed - read_ns);
+  BGPSTREAM_STATS_ADD(bsr->stats, bytes_read, bd->offset - offset);
+  return entry;
+}
+
 static BGPDUMP_ENTRY *get_next_entry(bgpstream_reader_t *bsr)
 {
+  BGPDUMP_ENTRY *entry;
+  uint64_t start;
+
   if (bsr->skip_dump_check == 0) {
+    start = bgpstream_stats_start(bsr->stats);
     pthread_mutex_lock(&bsr->mutex);
     while (bsr->dump_ready == 0) {
       pthread_cond_wait(&bsr->dump_ready_cond, &bsr->mutex);
     }
     pthread_mutex_unlock(&bsr->mutex);
+    bgpstream_stats_stop(bsr->stats, BGPSTREAM_STAGE_WAIT, start);
 
     if (bsr->status == BGPSTREAM_READER_STATUS_CANT_OPEN_DUMP) {
       return NULL;
@@ -115,7 +350,19 @@ static BGPDUMP_ENTRY *get_next_entry(bgpstream_reader_t *bsr)
   }
 
   /* now, grab an entry from bgpdump */
-  return bgpdump_read_next(bsr->bd_mgr);
+  if (bsr->stats != NULL) {
+    entry = read_next_timed(bsr);
+  } else {
+    entry = bgpdump_read_next(bsr->bd_mgr);
+  }
+  if (bsr->index_builder != NULL) {
+    update_index(bsr);
+  }
+  if (bsr->mem != NULL &&
+      bsr->bd_mgr->offset - bsr->mem_offset >= MEM_UPDATE_BYTES) {
+    update_mem(bsr);
+  }
+  return entry;
 }
 
 /* -------------- Reader functions -------------- */
@@ -177,7 +424,7 @@ bgpstream_reader_read_new_data(bgpstream_reader_t *const bs_reader,
   //  bs_reader->status = BGPSTREAM_READER_STATUS_END_OF_DUMP;
   //  return;
   //}
-  bgpstream_debug("\t\tBSR: read new data (previous): %ld\t%ld\t%s\t%s\t%d",
+  bgpstream_debug("\t\tBSR: read new data (previous): %ld\t%ld\t%d\t%s\t%d",
                   bs_reader->record_time, bs_reader->dump_time,
                   bs_reader->dump_type, bs_reader->dump_collector,
                   bs_reader->status);
@@ -196,6 +443,7 @@ bgpstream_reader_read_new_data(bgpstream_reader_t *const bs_reader,
     // check if an entry has been read
     if (bs_reader->bd_entry != NULL) {
       bs_reader->successful_read++;
+      BGPSTREAM_STATS_ADD(bs_reader->stats, records_parsed, 1);
       // check if entry is compatible with filters
       if (bgpstream_reader_filter_bd_entry(bs_reader->bd_entry, filter_mgr)) {
         // update reader fields
@@ -206,6 +454,7 @@ bgpstream_reader_read_new_data(bgpstream_reader_t *const bs_reader,
       }
       // if not compatible, destroy bgpdump entry
       else {
+        BGPSTREAM_STATS_ADD(bs_reader->stats, records_filtered, 1);
         bgpdump_free_mem(bs_reader->bd_entry);
         bs_reader->bd_entry = NULL;
         // significant_entry = false;
@@ -216,6 +465,7 @@ bgpstream_reader_read_new_data(bgpstream_reader_t *const bs_reader,
       // if the corrupted entry flag is
       // active, then dump is corrupted
       if (bs_reader->bd_mgr->corrupted_read) {
+        BGPSTREAM_STATS_ADD(bs_reader->stats, records_corrupted, 1);
         bs_reader->status = BGPSTREAM_READER_STATUS_CORRUPTED_DUMP;
         significant_entry = true;
       }
@@ -275,6 +525,16 @@ static void bgpstream_reader_destroy(bgpstream_reader_t *const bs_reader)
   // close bgpdump
   bgpdump_close_dump(bs_reader->bd_mgr);
   bs_reader->bd_mgr = NULL;
+  bgpstream_mem_account(bs_reader->mem, BGPSTREAM_MEM_READERS,
+                        &bs_reader->mem_reader, 0);
+  bgpstream_mem_account(bs_reader->mem, BGPSTREAM_MEM_PEER_INDEX,
+                        &bs_reader->mem_peer_index, 0);
+  bgpstream_mem_account(bs_reader->mem, BGPSTREAM_MEM_WANDIO_ESTIMATE,
+                        &bs_reader->mem_wandio, 0);
+  // an index that was not finished is no use to anyone
+  bgpstream_seek_index_destroy(bs_reader->index_builder);
+  bs_reader->index_builder = NULL;
+  BGPSTREAM_STATS_SUB(bs_reader->stats, readers_open, 1);
   // deallocate all memory for reader
   free(bs_reader);
   bgpstream_debug("\t\tBSR: destroy reader end");
@@ -282,8 +542,10 @@ static void bgpstream_reader_destroy(bgpstream_reader_t *const bs_reader)
 
 static bgpstream_reader_t *
 bgpstream_reader_create(const bgpstream_input_t *const bs_input,
-                        const bgpstream_filter_mgr_t *const filter_mgr)
+                        const bgpstream_filter_mgr_t *const filter_mgr,
+                        bgpstream_reader_mgr_t *const bs_reader_mgr)
 {
+  bgpstream_interval_filter_t *tif;
   bgpstream_debug("\t\tBSR: create reader start");
   if (bs_input == NULL) {
     bgpstream_debug("\t\tBSR: create reader: empty bs_input provided");
@@ -303,15 +565,38 @@ bgpstream_reader_create(const bgpstream_input_t *const bs_input,
   bs_reader->next = NULL;
   bs_reader->bd_mgr = NULL;
   bs_reader->bd_entry = NULL;
+  bs_reader->cache = bs_reader_mgr->cache;
+  bs_reader->stats = bs_reader_mgr->stats;
+  bs_reader->open_lag = bs_reader_mgr->open_lag;
+  bs_reader->discovered_time = bs_input->discovered_time;
+  bs_reader->mem = bs_reader_mgr->mem;
+  bs_reader->mem_reader = 0;
+  bs_reader->mem_peer_index = 0;
+  bs_reader->mem_wandio = 0;
+  bs_reader->low_mem = 0;
+  bs_reader->mem_offset = 0;
   // memset(bs_reader->dump_name, 0, BGPSTREAM_DUMP_MAX_LEN);
-  // memset(bs_reader->dump_project, 0, BGPSTREAM_PAR_MAX_LEN);
-  // memset(bs_reader->dump_collector, 0, BGPSTREAM_PAR_MAX_LEN);
-  // memset(bs_reader->dump_type, 0, BGPSTREAM_PAR_MAX_LEN);
   // init done
   strcpy(bs_reader->dump_name, bs_input->filename);
-  strcpy(bs_reader->dump_project, bs_input->fileproject);
-  strcpy(bs_reader->dump_collector, bs_input->filecollector);
-  strcpy(bs_reader->dump_type, bs_input->filetype);
+  // project and collector names are interned once per dump so that records
+  // can carry (and consumers can index by) small integer IDs
+  if ((bs_reader->dump_project_id = bgpstream_str_id_map_get_id(
+         bs_reader_mgr->projects, bs_input->fileproject)) == 0 ||
+      (bs_reader->dump_collector_id = bgpstream_str_id_map_get_id(
+         bs_reader_mgr->collectors, bs_input->filecollector)) == 0) {
+    bgpstream_debug("\t\tBSR: create reader: can't intern names");
+    free(bs_reader);
+    return NULL;
+  }
+  bs_reader->dump_project = bgpstream_str_id_map_get_str(
+    bs_reader_mgr->projects, bs_reader->dump_project_id);
+  bs_reader->dump_collector = bgpstream_str_id_map_get_str(
+    bs_reader_mgr->collectors, bs_reader->dump_collector_id);
+  if (strcmp(bs_input->filetype, "ribs") == 0) {
+    bs_reader->dump_type = BGPSTREAM_RIB;
+  } else {
+    bs_reader->dump_type = BGPSTREAM_UPDATE;
+  }
   bs_reader->dump_time = bs_input->epoch_filetime;
   bs_reader->record_time = bs_input->epoch_filetime;
   bs_reader->status =
@@ -324,8 +609,26 @@ bgpstream_reader_create(const bgpstream_input_t *const bs_input,
   bs_reader->dump_ready = 0;
   bs_reader->skip_dump_check = 0;
 
+  bs_reader->dump_path[0] = '\0';
+  bs_reader->seek_index = bs_reader_mgr->seek_index;
+  bs_reader->index_builder = NULL;
+  // we can skip anything before the earliest interval starts
+  bs_reader->seek_time = 0;
+  if (filter_mgr != NULL && (tif = filter_mgr->time_intervals) != NULL) {
+    bs_reader->seek_time = tif->begin_time;
+    for (; tif != NULL; tif = tif->next) {
+      if (tif->begin_time < bs_reader->seek_time) {
+        bs_reader->seek_time = tif->begin_time;
+      }
+    }
+  }
+
+  // account for the reader itself until the dump is open
+  update_mem(bs_reader);
+
   // bgpdump is created in the thread
   pthread_create(&bs_reader->producer, NULL, thread_producer, bs_reader);
+  BGPSTREAM_STATS_ADD(bs_reader->stats, readers_open, 1);
 
   /* // call bgpstream_reader_read_new_data */
   /* bgpstream_debug("\t\tBSR: create reader: read new data"); */
@@ -366,12 +669,9 @@ bgpstream_reader_export_record(bgpstream_reader_t *const bs_reader,
   bgpstream_debug("\t\tBSR: export record: copying attributes");
   strcpy(bs_record->attributes.dump_project, bs_reader->dump_project);
   strcpy(bs_record->attributes.dump_collector, bs_reader->dump_collector);
-  //   strcpy(bs_record->attributes.dump_type, bs_reader->dump_type);
-  if (strcmp(bs_reader->dump_type, "ribs") == 0) {
-    bs_record->attributes.dump_type = BGPSTREAM_RIB;
-  } else {
-    bs_record->attributes.dump_type = BGPSTREAM_UPDATE;
-  }
+  bs_record->attributes.dump_project_id = bs_reader->dump_project_id;
+  bs_record->attributes.dump_collector_id = bs_reader->dump_collector_id;
+  bs_record->attributes.dump_type = bs_reader->dump_type;
   bs_record->attributes.dump_time = bs_reader->dump_time;
   bs_record->attributes.record_time = bs_reader->record_time;
   // if this is the first significant record and no previous
@@ -434,7 +734,7 @@ static void print_reader_queue(const bgpstream_reader_t *const reader_queue)
   bgpstream_debug("READER QUEUE: start");
   int i = 1;
   while (iterator != NULL) {
-    bgpstream_debug("\t%d %s %s %ld %ld %d", i, iterator->dump_collector,
+    bgpstream_debug("\t%d %s %d %ld %ld %d", i, iterator->dump_collector,
                     iterator->dump_type, iterator->dump_time,
                     iterator->record_time, iterator->status);
     iterator = iterator->next;
@@ -464,11 +764,53 @@ bgpstream_reader_mgr_create(const bgpstream_filter_mgr_t *const filter_mgr)
   bgpstream_debug("\tBSR_MGR: create reader mgr: initialization");
   bs_reader_mgr->reader_queue = NULL;
   bs_reader_mgr->filter_mgr = filter_mgr;
+  bs_reader_mgr->cache = NULL;
+  bs_reader_mgr->seek_index = 0;
+  bs_reader_mgr->stats = NULL;
+  bs_reader_mgr->open_lag = NULL;
+  bs_reader_mgr->mem = NULL;
   bs_reader_mgr->status = BGPSTREAM_READER_MGR_STATUS_EMPTY_READER_MGR;
+  if ((bs_reader_mgr->projects = bgpstream_str_id_map_create()) == NULL ||
+      (bs_reader_mgr->collectors = bgpstream_str_id_map_create()) == NULL) {
+    bgpstream_debug("\tBSR_MGR: create reader mgr: can't create id maps");
+    bgpstream_str_id_map_destroy(bs_reader_mgr->projects);
+    free(bs_reader_mgr);
+    return NULL;
+  }
   bgpstream_debug("\tBSR_MGR: create reader mgr: end");
   return bs_reader_mgr;
 }
 
+void bgpstream_reader_mgr_set_cache(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                    bgpstream_cache_t *cache)
+{
+  bs_reader_mgr->cache = cache;
+}
+
+void bgpstream_reader_mgr_set_seek_index(
+  bgpstream_reader_mgr_t *const bs_reader_mgr, int enabled)
+{
+  bs_reader_mgr->seek_index = enabled;
+}
+
+void bgpstream_reader_mgr_set_stats(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                    bgpstream_stats_t *stats)
+{
+  bs_reader_mgr->stats = stats;
+}
+
+void bgpstream_reader_mgr_set_open_lag(
+  bgpstream_reader_mgr_t *const bs_reader_mgr, bgpstream_histogram_t *hist)
+{
+  bs_reader_mgr->open_lag = hist;
+}
+
+void bgpstream_reader_mgr_set_mem(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                  bgpstream_mem_t *mem)
+{
+  bs_reader_mgr->mem = mem;
+}
+
 bool bgpstream_reader_mgr_is_empty(
   const bgpstream_reader_mgr_t *const bs_reader_mgr)
 {
@@ -527,23 +869,23 @@ bgpstream_reader_mgr_sorted_insert(bgpstream_reader_mgr_t *const bs_reader_mgr,
         // if time is the same
         if (bs_reader->record_time == iterator->record_time) {
           // if type is the same -> continue
-          if (strcmp(iterator->dump_type, bs_reader->dump_type) == 0) {
+          if (iterator->dump_type == bs_reader->dump_type) {
             previous_iterator = iterator;
             iterator = previous_iterator->next;
             continue;
           }
           // if the queue contains ribs, and the current reader
           // is an update -> continue
-          if (strcmp(iterator->dump_type, "ribs") == 0 &&
-              strcmp(bs_reader->dump_type, "updates") == 0) {
+          if (iterator->dump_type == BGPSTREAM_RIB &&
+              bs_reader->dump_type == BGPSTREAM_UPDATE) {
             previous_iterator = iterator;
             iterator = previous_iterator->next;
             continue;
           }
           // if the queue contains updates, and the current reader
           // is a rib -> insert
-          if (strcmp(iterator->dump_type, "updates") == 0 &&
-              strcmp(bs_reader->dump_type, "ribs") == 0) {
+          if (iterator->dump_type == BGPSTREAM_UPDATE &&
+              bs_reader->dump_type == BGPSTREAM_RIB) {
             // insertion at the beginning of the queue
             if (previous_iterator == bs_reader_mgr->reader_queue &&
                 iterator == bs_reader_mgr->reader_queue) {
@@ -647,7 +989,7 @@ void bgpstream_reader_mgr_add(bgpstream_reader_mgr_t *const bs_reader_mgr,
     if (bgpstream_reader_period_check(iterator, filter_mgr)) {
       bgpstream_debug("\tBSR_MGR: add input: i");
       // a) create a new reader (create includes the first read)
-      bs_reader = bgpstream_reader_create(iterator, filter_mgr);
+      bs_reader = bgpstream_reader_create(iterator, filter_mgr, bs_reader_mgr);
       // if it creates correctly then add it to the temporary queue
       if (bs_reader != NULL) {
         tmp_reader_queue[i] = bs_reader;
@@ -656,6 +998,9 @@ void bgpstream_reader_mgr_add(bgpstream_reader_mgr_t *const bs_reader_mgr,
         bgpstream_log_err("ERROR: could not create reader\n");
         return;
       }
+    } else if (bs_reader_mgr->cache != NULL) {
+      /* this input may have been prefetched */
+      bgpstream_cache_drop(bs_reader_mgr->cache, iterator->filename);
     }
     // go to the next input
     iterator = iterator->next;
@@ -774,6 +1119,8 @@ void bgpstream_reader_mgr_destroy(bgpstream_reader_mgr_t *const bs_reader_mgr)
     bgpstream_reader_destroy(iterator);
   }
   bs_reader_mgr->status = BGPSTREAM_READER_MGR_STATUS_EMPTY_READER_MGR;
+  bgpstream_str_id_map_destroy(bs_reader_mgr->projects);
+  bgpstream_str_id_map_destroy(bs_reader_mgr->collectors);
   free(bs_reader_mgr);
   bgpstream_debug("\tBSR_MGR: destroy reader mgr: end");
 }
@@ -27,10 +27,14 @@
 #include <pthread.h>
 #include <stdbool.h>
 
+#include "bgpstream_cache.h"
 #include "bgpstream_constants.h"
 #include "bgpstream_filter.h"
 #include "bgpstream_input.h"
 #include "bgpstream_record.h"
+#include "bgpstream_histogram.h"
+#include "bgpstream_mem.h"
+#include "bgpstream_stats.h"
 
 #include <bgpdump_lib.h>
 
@@ -53,12 +57,34 @@ typedef enum {
 typedef struct struct_bgpstream_reader_mgr_t {
   bgpstream_reader_t *reader_queue;
   const bgpstream_filter_mgr_t *filter_mgr;
+  bgpstream_cache_t *cache; // download cache (may be NULL)
+  int seek_index;           // use sidecar indexes to seek into dumps?
+  bgpstream_str_id_map_t *projects;   // interned project names
+  bgpstream_str_id_map_t *collectors; // interned collector names
+  bgpstream_stats_t *stats;           // processing stats (may be NULL)
+  bgpstream_histogram_t *open_lag;    // dump open lags (may be NULL)
+  bgpstream_mem_t *mem;               // memory accounting (may be NULL)
   bgpstream_reader_mgr_status_t status;
 } bgpstream_reader_mgr_t;
 
 /* create a new reader mgr */
 bgpstream_reader_mgr_t *
 bgpstream_reader_mgr_create(const bgpstream_filter_mgr_t *const filter_mgr);
+/* set the download cache to be used when opening dumps */
+void bgpstream_reader_mgr_set_cache(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                    bgpstream_cache_t *cache);
+/* enable/disable the use of sidecar seek indexes when reading dumps */
+void bgpstream_reader_mgr_set_seek_index(
+  bgpstream_reader_mgr_t *const bs_reader_mgr, int enabled);
+/* set the structure to maintain processing stats in (NULL to disable) */
+void bgpstream_reader_mgr_set_stats(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                    bgpstream_stats_t *stats);
+/* set the histogram to record dump open lags in (NULL to disable) */
+void bgpstream_reader_mgr_set_open_lag(
+  bgpstream_reader_mgr_t *const bs_reader_mgr, bgpstream_histogram_t *hist);
+/* set the structure to account reader memory in (NULL to disable) */
+void bgpstream_reader_mgr_set_mem(bgpstream_reader_mgr_t *const bs_reader_mgr,
+                                  bgpstream_mem_t *mem);
 /* check if the readers' queue is empty  */
 bool bgpstream_reader_mgr_is_empty(
   const bgpstream_reader_mgr_t *const bs_reader_mgr);
@@ -48,6 +48,8 @@ bgpstream_record_t *bgpstream_record_create()
 
   bs_record->bs = NULL;
   bs_record->bd_entry = NULL;
+  bs_record->mem = NULL;
+  bs_record->elems_mem = 0;
 
   if ((bs_record->elem_generator = bgpstream_elem_generator_create()) == NULL) {
     bgpstream_record_destroy(bs_record);
@@ -78,6 +80,10 @@ void bgpstream_record_destroy(bgpstream_record_t *const bs_record)
     bgpstream_elem_generator_destroy(bs_record->elem_generator);
     bs_record->elem_generator = NULL;
   }
+  bgpstream_mem_account(bs_record->mem, BGPSTREAM_MEM_ELEMS,
+                        &bs_record->elems_mem, 0);
+  bgpstream_mem_unref(bs_record->mem);
+  bs_record->mem = NULL;
 
   bgpstream_debug("BS - free bs_record");
   free(bs_record);
@@ -90,6 +96,8 @@ void bgpstream_record_clear(bgpstream_record_t *record)
   record->dump_pos = BGPSTREAM_DUMP_START;
   record->attributes.dump_project[0] = '\0';
   record->attributes.dump_collector[0] = '\0';
+  record->attributes.dump_project_id = 0;
+  record->attributes.dump_collector_id = 0;
   record->attributes.dump_type = BGPSTREAM_UPDATE;
   record->attributes.dump_time = 0;
   record->attributes.record_time = 0;
@@ -103,6 +111,26 @@ void bgpstream_record_clear(bgpstream_record_t *record)
   bgpstream_elem_generator_clear(record->elem_generator);
 }
 
+void bgpstream_record_attach(bgpstream_record_t *record, bgpstream_t *bs)
+{
+  bgpstream_mem_t *mem = (bs != NULL) ? bs->mem : NULL;
+
+  record->bs = bs;
+  if (record->mem == mem) {
+    return;
+  }
+  // the elems of the record were accounted to another stream
+  bgpstream_mem_account(record->mem, BGPSTREAM_MEM_ELEMS, &record->elems_mem,
+                        0);
+  bgpstream_mem_unref(record->mem);
+  record->mem = bgpstream_mem_ref(mem);
+  if (record->elem_generator != NULL) {
+    bgpstream_mem_account(
+      record->mem, BGPSTREAM_MEM_ELEMS, &record->elems_mem,
+      bgpstream_elem_generator_get_mem_size(record->elem_generator));
+  }
+}
+
 void bgpstream_record_print_mrt_data(bgpstream_record_t *const bs_record)
 {
   bgpdump_print_entry(bs_record->bd_entry);
@@ -314,10 +342,56 @@ static int bgpstream_elem_check_filters(bgpstream_filter_mgr_t *filter_mgr,
   return 1;
 }
 
+/* populate the elem generator, timing it if stats are enabled, and account
+   for any memory it allocated */
+static int populate_elems(bgpstream_record_t *record)
+{
+  /* (records that have not been filled by a stream have no stats) */
+  bgpstream_stats_t *stats = record->bs != NULL ? record->bs->stats : NULL;
+  uint64_t start = bgpstream_stats_start(stats);
+  int rc;
+
+  rc = bgpstream_elem_generator_populate(record->elem_generator, record);
+  if (record->mem != NULL) {
+    bgpstream_mem_account(
+      record->mem, BGPSTREAM_MEM_ELEMS, &record->elems_mem,
+      bgpstream_elem_generator_get_mem_size(record->elem_generator));
+  }
+  if (stats != NULL) {
+    bgpstream_stats_stop(stats, BGPSTREAM_STAGE_ELEM, start);
+    if (rc == 0) {
+      BGPSTREAM_STATS_ADD(
+        stats, elems_generated,
+        bgpstream_elem_generator_get_elem_cnt(record->elem_generator));
+    }
+  }
+  return rc;
+}
+
+/* check the elem against the filters, timing it if stats are enabled */
+static int check_filters_timed(bgpstream_record_t *record,
+                               bgpstream_elem_t *elem)
+{
+  bgpstream_stats_t *stats = record->bs->stats;
+  uint64_t start;
+  int rc;
+
+  if (stats == NULL) {
+    return bgpstream_elem_check_filters(record->bs->filter_mgr, elem);
+  }
+  start = bgpstream_stats_now();
+  rc = bgpstream_elem_check_filters(record->bs->filter_mgr, elem);
+  bgpstream_stats_stop(stats, BGPSTREAM_STAGE_FILTER, start);
+  if (rc != 1) {
+    BGPSTREAM_STATS_ADD(stats, elems_filtered, 1);
+  }
+  return rc;
+}
+
 bgpstream_elem_t *bgpstream_record_get_next_elem(bgpstream_record_t *record)
 {
   if (bgpstream_elem_generator_is_populated(record->elem_generator) == 0 &&
-      bgpstream_elem_generator_populate(record->elem_generator, record) != 0) {
+      populate_elems(record) != 0) {
     return NULL;
   }
   bgpstream_elem_t *elem =
@@ -326,14 +400,18 @@ bgpstream_elem_t *bgpstream_record_get_next_elem(bgpstream_record_t *record)
   /* if the elem is compatible with the current filters
    * then return elem, otherwise run again
    * bgpstream_record_get_next_elem(record) */
-  if (elem == NULL ||
-      bgpstream_elem_check_filters(record->bs->filter_mgr, elem) == 1) {
+  if (elem == NULL || check_filters_timed(record, elem) == 1) {
     return elem;
   }
 
   return bgpstream_record_get_next_elem(record);
 }
 
+void bgpstream_record_rewind_elems(bgpstream_record_t *record)
+{
+  bgpstream_elem_generator_rewind(record->elem_generator);
+}
+
 int bgpstream_record_dump_type_snprintf(char *buf, size_t len,
                                         bgpstream_record_dump_type_t dump_type)
 {
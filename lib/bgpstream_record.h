@@ -124,6 +124,13 @@ typedef struct struct_bgpstream_record_attributes_t {
   /** Collector name */
   char dump_collector[BGPSTREAM_UTILS_STR_NAME_LEN];
 
+  /** Project ID (see bgpstream_get_project_name) */
+  bgpstream_str_id_t dump_project_id;
+
+  /** Collector ID (see bgpstream_get_collector_name). Unlike the name, this
+      may be used directly as an array index. */
+  bgpstream_str_id_t dump_collector_id;
+
   /** Dump type */
   bgpstream_record_dump_type_t dump_type;
 
@@ -148,6 +155,13 @@ typedef struct struct_bgpstream_record_t {
   /** INTERNAL: state used to generate elems for get_next_elem */
   struct bgpstream_elem_generator *elem_generator;
 
+  /** INTERNAL: memory accounting of the originating bgpstream instance
+      (referenced, since the record may outlive the instance) */
+  struct bgpstream_mem *mem;
+
+  /** INTERNAL: bytes of elem memory accounted to mem */
+  size_t elems_mem;
+
   /** Collection of attributes pertaining to this record */
   bgpstream_record_attributes_t attributes;
 
@@ -191,6 +205,21 @@ void bgpstream_record_destroy(bgpstream_record_t *record);
  */
 void bgpstream_record_clear(bgpstream_record_t *record);
 
+/** Attach the given BGP Stream Record instance to a BGP Stream instance
+ *
+ * @param record        pointer to a BGP Stream Record instance to attach
+ * @param bs            pointer to the BGP Stream instance to attach it to (may
+ *                      be NULL to detach the record)
+ *
+ * The elems generated from an attached record count towards the memory usage
+ * (and limits) of the stream. Records passed to bgpstream_get_next_record are
+ * attached automatically; applications that move the MRT data of a record
+ * into another record (e.g. to hand it to a worker thread) should attach the
+ * destination to the stream that the data came from.
+ */
+void bgpstream_record_attach(bgpstream_record_t *record,
+                             struct struct_bgpstream_t *bs);
+
 /** Retrieve the next elem from the record
  *
  * @param record        pointer to the BGP Stream Record to retrieve the elem
@@ -204,6 +233,16 @@ void bgpstream_record_clear(bgpstream_record_t *record);
  */
 bgpstream_elem_t *bgpstream_record_get_next_elem(bgpstream_record_t *record);
 
+/** Rewind the elem iterator of the record
+ *
+ * @param record        pointer to the BGP Stream Record to rewind
+ *
+ * After a rewind, bgpstream_record_get_next_elem starts again from the first
+ * elem in the record. Elems that have already been generated are re-used
+ * rather than re-generated, and previously returned pointers remain valid.
+ */
+void bgpstream_record_rewind_elems(bgpstream_record_t *record);
+
 /** Dump the given record to stdout in bgpdump format
  *
  * @param record        pointer to a BGP Stream Record instance to dump
@@ -0,0 +1,315 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+#include "bgpstream_constants.h"
+#include "bgpstream_debug.h"
+#include "bgpstream_seek_index.h"
+
+/* magic bytes at the start of an index file (the last byte is the version) */
+#define INDEX_MAGIC "BSIDX\0\0\1"
+#define INDEX_MAGIC_LEN 8
+
+/* initial number of checkpoints to allocate space for */
+#define INDEX_INIT_CNT 1024
+
+/* sanity limit on the number of checkpoints in an index file */
+#define INDEX_MAX_CNT (1 << 24)
+
+typedef struct index_checkpoint {
+  /* largest record timestamp before offset */
+  uint32_t max_time;
+
+  /* offset of an MRT record in the uncompressed dump */
+  uint64_t offset;
+} index_checkpoint_t;
+
+struct bgpstream_seek_index {
+
+  /* array of checkpoints, sorted by offset (and therefore max_time) */
+  index_checkpoint_t *checkpoints;
+
+  /* number of checkpoints used */
+  int checkpoints_cnt;
+
+  /* number of checkpoints allocated */
+  int checkpoints_alloc;
+};
+
+static int index_path(const char *dump_path, char *path, size_t len)
+{
+  /* only local files can have an index */
+  if (strstr(dump_path, "://") != NULL) {
+    return -1;
+  }
+  if (snprintf(path, len, "%s%s", dump_path, BGPSTREAM_SEEK_INDEX_SUFFIX) >=
+      len) {
+    return -1;
+  }
+  return 0;
+}
+
+static int write_u32(FILE *fh, uint32_t val)
+{
+  val = htonl(val);
+  return fwrite(&val, sizeof(val), 1, fh) == 1 ? 0 : -1;
+}
+
+static int write_u64(FILE *fh, uint64_t val)
+{
+  if (write_u32(fh, (uint32_t)(val >> 32)) != 0 ||
+      write_u32(fh, (uint32_t)val) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+static int read_u32(FILE *fh, uint32_t *val)
+{
+  if (fread(val, sizeof(*val), 1, fh) != 1) {
+    return -1;
+  }
+  *val = ntohl(*val);
+  return 0;
+}
+
+static int read_u64(FILE *fh, uint64_t *val)
+{
+  uint32_t hi, lo;
+  if (read_u32(fh, &hi) != 0 || read_u32(fh, &lo) != 0) {
+    return -1;
+  }
+  *val = ((uint64_t)hi << 32) | lo;
+  return 0;
+}
+
+/* ========== PROTECTED FUNCTIONS ========== */
+
+bgpstream_seek_index_t *bgpstream_seek_index_create()
+{
+  bgpstream_seek_index_t *idx;
+
+  if ((idx = malloc_zero(sizeof(bgpstream_seek_index_t))) == NULL) {
+    return NULL;
+  }
+  return idx;
+}
+
+bgpstream_seek_index_t *bgpstream_seek_index_load(const char *dump_path)
+{
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  struct stat st;
+  FILE *fh = NULL;
+  char magic[INDEX_MAGIC_LEN];
+  uint64_t size, mtime, offset;
+  uint32_t cnt, max_time;
+  bgpstream_seek_index_t *idx = NULL;
+  int i;
+
+  if (index_path(dump_path, path, sizeof(path)) != 0 ||
+      stat(dump_path, &st) != 0 || (fh = fopen(path, "rb")) == NULL) {
+    return NULL;
+  }
+
+  /* make sure the index is for this version of the dump */
+  if (fread(magic, INDEX_MAGIC_LEN, 1, fh) != 1 ||
+      memcmp(magic, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0 ||
+      read_u64(fh, &size) != 0 || read_u64(fh, &mtime) != 0 ||
+      size != (uint64_t)st.st_size || mtime != (uint64_t)st.st_mtime) {
+    bgpstream_debug("\t\tBSI: ignoring stale index %s", path);
+    goto err;
+  }
+
+  if (read_u32(fh, &cnt) != 0 || cnt > INDEX_MAX_CNT) {
+    goto corrupt;
+  }
+  if ((idx = bgpstream_seek_index_create()) == NULL) {
+    goto err;
+  }
+  if (cnt > 0 &&
+      (idx->checkpoints = malloc(sizeof(index_checkpoint_t) * cnt)) == NULL) {
+    goto err;
+  }
+  idx->checkpoints_alloc = cnt;
+
+  for (i = 0; i < cnt; i++) {
+    if (read_u32(fh, &max_time) != 0 || read_u64(fh, &offset) != 0 ||
+        bgpstream_seek_index_add(idx, max_time, offset) != 0) {
+      goto corrupt;
+    }
+  }
+
+  fclose(fh);
+  bgpstream_debug("\t\tBSI: loaded %d checkpoints from %s", cnt, path);
+  return idx;
+
+corrupt:
+  bgpstream_log_warn("Ignoring corrupt seek index %s", path);
+err:
+  fclose(fh);
+  bgpstream_seek_index_destroy(idx);
+  return NULL;
+}
+
+void bgpstream_seek_index_destroy(bgpstream_seek_index_t *idx)
+{
+  if (idx == NULL) {
+    return;
+  }
+  free(idx->checkpoints);
+  free(idx);
+}
+
+int bgpstream_seek_index_add(bgpstream_seek_index_t *idx, uint32_t max_time,
+                             uint64_t offset)
+{
+  index_checkpoint_t *tmp;
+  int new_alloc;
+
+  /* checkpoints must be in offset order, and since max_time covers all
+     earlier records, it cannot decrease */
+  if (idx->checkpoints_cnt > 0 &&
+      (offset <= idx->checkpoints[idx->checkpoints_cnt - 1].offset ||
+       max_time < idx->checkpoints[idx->checkpoints_cnt - 1].max_time)) {
+    return -1;
+  }
+
+  if (idx->checkpoints_cnt == idx->checkpoints_alloc) {
+    new_alloc = idx->checkpoints_alloc == 0 ? INDEX_INIT_CNT
+                                            : idx->checkpoints_alloc * 2;
+    if (new_alloc > INDEX_MAX_CNT ||
+        (tmp = realloc(idx->checkpoints,
+                       sizeof(index_checkpoint_t) * new_alloc)) == NULL) {
+      return -1;
+    }
+    idx->checkpoints = tmp;
+    idx->checkpoints_alloc = new_alloc;
+  }
+
+  idx->checkpoints[idx->checkpoints_cnt].max_time = max_time;
+  idx->checkpoints[idx->checkpoints_cnt].offset = offset;
+  idx->checkpoints_cnt++;
+  return 0;
+}
+
+int bgpstream_seek_index_write(bgpstream_seek_index_t *idx,
+                               const char *dump_path)
+{
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+  char tmp_path[BGPSTREAM_DUMP_MAX_LEN];
+  struct stat st;
+  FILE *fh = NULL;
+  int i;
+
+  if (index_path(dump_path, path, sizeof(path)) != 0 ||
+      stat(dump_path, &st) != 0) {
+    return -1;
+  }
+  /* write to a temporary file so that concurrent readers never see a partial
+     index */
+  if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, getpid()) >=
+      sizeof(tmp_path)) {
+    return -1;
+  }
+  if ((fh = fopen(tmp_path, "wb")) == NULL) {
+    /* probably not allowed to write next to the dump, that's fine */
+    bgpstream_debug("\t\tBSI: could not create index %s", tmp_path);
+    return -1;
+  }
+
+  if (fwrite(INDEX_MAGIC, INDEX_MAGIC_LEN, 1, fh) != 1 ||
+      write_u64(fh, st.st_size) != 0 || write_u64(fh, st.st_mtime) != 0 ||
+      write_u32(fh, idx->checkpoints_cnt) != 0) {
+    goto err;
+  }
+  for (i = 0; i < idx->checkpoints_cnt; i++) {
+    if (write_u32(fh, idx->checkpoints[i].max_time) != 0 ||
+        write_u64(fh, idx->checkpoints[i].offset) != 0) {
+      goto err;
+    }
+  }
+  if (fclose(fh) != 0) {
+    fh = NULL;
+    goto err;
+  }
+  fh = NULL;
+
+  if (rename(tmp_path, path) != 0) {
+    goto err;
+  }
+
+  bgpstream_debug("\t\tBSI: wrote %d checkpoints to %s", idx->checkpoints_cnt,
+                  path);
+  return 0;
+
+err:
+  bgpstream_log_warn("Could not write seek index %s", path);
+  if (fh != NULL) {
+    fclose(fh);
+  }
+  unlink(tmp_path);
+  return -1;
+}
+
+void bgpstream_seek_index_remove(const char *dump_path)
+{
+  char path[BGPSTREAM_DUMP_MAX_LEN];
+
+  if (index_path(dump_path, path, sizeof(path)) == 0) {
+    unlink(path);
+  }
+}
+
+uint64_t bgpstream_seek_index_lookup(bgpstream_seek_index_t *idx,
+                                     uint32_t time)
+{
+  int lo = 0;
+  int hi = idx->checkpoints_cnt;
+  int mid;
+
+  /* find the first checkpoint that may have a record >= time before it */
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (idx->checkpoints[mid].max_time < time) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  /* and start from the one before that */
+  return lo == 0 ? 0 : idx->checkpoints[lo - 1].offset;
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_SEEK_INDEX_H
+#define __BGPSTREAM_SEEK_INDEX_H
+
+#include <stdint.h>
+
+/** @file
+ *
+ * @brief Header file that exposes the protected interface of the bgpstream
+ * seek index.
+ *
+ * A seek index is a small sidecar file stored alongside a (local) dump file
+ * that maps record timestamps to byte offsets in the (uncompressed) MRT
+ * stream. It is built the first time a dump is read from start to end, and
+ * lets later readers that are only interested in records after a given time
+ * skip over the beginning of the file without parsing it.
+ *
+ * Each checkpoint in the index records the offset of an MRT record, along
+ * with the largest timestamp of any record before that offset. Since update
+ * dumps are not strictly sorted by time, this guarantees that no record at or
+ * after the requested time is skipped.
+ *
+ * @author Alistair King
+ *
+ */
+
+/** Suffix appended to the name of a dump file to give the name of its index
+ * (temporary files used while writing an index also start with it) */
+#define BGPSTREAM_SEEK_INDEX_SUFFIX ".bsidx"
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+typedef struct bgpstream_seek_index bgpstream_seek_index_t;
+
+/** @} */
+
+/**
+ * @name Protected API Functions
+ *
+ * @{ */
+
+/** Create a new, empty, seek index
+ *
+ * @return pointer to a new seek index if successful, NULL otherwise
+ */
+bgpstream_seek_index_t *bgpstream_seek_index_create();
+
+/** Load the seek index for the given dump file
+ *
+ * @param dump_path     path to the dump file
+ * @return pointer to the index if one exists and is up to date with the dump
+ * file, NULL otherwise
+ */
+bgpstream_seek_index_t *bgpstream_seek_index_load(const char *dump_path);
+
+/** Destroy the given seek index
+ *
+ * @param idx           pointer to the index to destroy
+ */
+void bgpstream_seek_index_destroy(bgpstream_seek_index_t *idx);
+
+/** Add a checkpoint to the given index
+ *
+ * @param idx           pointer to the index to add to
+ * @param max_time      largest timestamp of all records before offset
+ * @param offset        offset of the start of an MRT record
+ * @return 0 if the checkpoint was added successfully, -1 otherwise
+ *
+ * Checkpoints must be added in order of increasing offset.
+ */
+int bgpstream_seek_index_add(bgpstream_seek_index_t *idx, uint32_t max_time,
+                             uint64_t offset);
+
+/** Write the given index to the sidecar file of the given dump file
+ *
+ * @param idx           pointer to the index to write
+ * @param dump_path     path to the (fully read) dump file
+ * @return 0 if the index was written successfully, -1 otherwise
+ */
+int bgpstream_seek_index_write(bgpstream_seek_index_t *idx,
+                               const char *dump_path);
+
+/** Remove the sidecar index file of the given dump file (e.g. because it
+ * turned out not to match the dump)
+ *
+ * @param dump_path     path to the dump file
+ */
+void bgpstream_seek_index_remove(const char *dump_path);
+
+/** Find the offset to start reading from to find all records at or after the
+ * given time
+ *
+ * @param idx           pointer to the index to search
+ * @param time          time of the first record of interest
+ * @return offset of the last checkpoint that only has earlier records before
+ * it, or 0 if the dump must be read from the start
+ */
+uint64_t bgpstream_seek_index_lookup(bgpstream_seek_index_t *idx,
+                                     uint32_t time);
+
+/** @} */
+
+#endif /* __BGPSTREAM_SEEK_INDEX_H */
@@ -0,0 +1,68 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stddef.h>
+#include <time.h>
+
+#include "bgpstream_stats.h"
+
+uint64_t bgpstream_stats_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t bgpstream_stats_wall_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void bgpstream_stats_stop(bgpstream_stats_t *stats, bgpstream_stage_t stage,
+                          uint64_t start)
+{
+  if (stats == NULL) {
+    return;
+  }
+  __atomic_add_fetch(&stats->stage_ns[stage], bgpstream_stats_now() - start,
+                     __ATOMIC_RELAXED);
+}
+
+void bgpstream_stats_snapshot(bgpstream_stats_t *stats,
+                              bgpstream_stats_t *snap)
+{
+  uint64_t *src = (uint64_t *)stats;
+  uint64_t *dst = (uint64_t *)snap;
+  size_t i;
+
+  /* the structure is nothing but 64 bit counters */
+  for (i = 0; i < sizeof(bgpstream_stats_t) / sizeof(uint64_t); i++) {
+    dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+  }
+}
@@ -0,0 +1,124 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_STATS_H
+#define __BGPSTREAM_STATS_H
+
+#include <stdint.h>
+
+#include "bgpstream.h"
+
+/** @file
+ *
+ * @brief Header file that exposes the protected interface for maintaining
+ * bgpstream processing statistics.
+ *
+ * Statistics are updated by both the main thread and the reader threads, and
+ * may be read at any time by another thread, so all updates are made using
+ * (relaxed) atomic operations. Every helper is a no-op when given a NULL
+ * statistics pointer, which is how disabled statistics are represented.
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Protected Macros
+ *
+ * @{ */
+
+/** Add the given value to a counter of a (possibly NULL) stats structure */
+#define BGPSTREAM_STATS_ADD(stats, field, val)                                 \
+  do {                                                                         \
+    if ((stats) != NULL) {                                                     \
+      __atomic_add_fetch(&(stats)->field, (val), __ATOMIC_RELAXED);            \
+    }                                                                          \
+  } while (0)
+
+/** Subtract the given value from a counter of a (possibly NULL) stats
+    structure */
+#define BGPSTREAM_STATS_SUB(stats, field, val)                                 \
+  do {                                                                         \
+    if ((stats) != NULL) {                                                     \
+      __atomic_sub_fetch(&(stats)->field, (val), __ATOMIC_RELAXED);            \
+    }                                                                          \
+  } while (0)
+
+/** Set a gauge of a (possibly NULL) stats structure to the given value */
+#define BGPSTREAM_STATS_SET(stats, field, val)                                 \
+  do {                                                                         \
+    if ((stats) != NULL) {                                                     \
+      __atomic_store_n(&(stats)->field, (val), __ATOMIC_RELAXED);              \
+    }                                                                          \
+  } while (0)
+
+/** @} */
+
+/**
+ * @name Protected API Functions
+ *
+ * @{ */
+
+/** Get the current time of the monotonic clock
+ *
+ * @return the current time in nanoseconds
+ */
+uint64_t bgpstream_stats_now(void);
+
+/** Get the current (wall-clock) time
+ *
+ * @return the current time in milliseconds since the epoch
+ */
+uint64_t bgpstream_stats_wall_ms(void);
+
+/** Start timing a stage
+ *
+ * @param stats         pointer to the stats structure (may be NULL)
+ * @return the current time if stats is non-NULL, 0 otherwise
+ */
+static inline uint64_t bgpstream_stats_start(bgpstream_stats_t *stats)
+{
+  return stats != NULL ? bgpstream_stats_now() : 0;
+}
+
+/** Finish timing a stage
+ *
+ * @param stats         pointer to the stats structure (may be NULL)
+ * @param stage         stage to add the elapsed time to
+ * @param start         time that the stage started (as returned by
+ *                      bgpstream_stats_start)
+ */
+void bgpstream_stats_stop(bgpstream_stats_t *stats, bgpstream_stage_t stage,
+                          uint64_t start);
+
+/** Take a consistent (per-field) snapshot of the given stats
+ *
+ * @param stats         pointer to the stats structure to read
+ * @param snap          pointer to the structure to copy the stats into
+ */
+void bgpstream_stats_snapshot(bgpstream_stats_t *stats,
+                              bgpstream_stats_t *snap);
+
+/** @} */
+
+#endif /* __BGPSTREAM_STATS_H */
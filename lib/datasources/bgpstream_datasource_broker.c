@@ -24,9 +24,9 @@
 #include "config.h"
 
 #include "bgpstream_datasource_broker.h"
+#include "bgpstream_datasource_watch.h"
 #include "bgpstream_debug.h"
 #include "utils.h"
-#include "libjsmn/jsmn.h"
 
 #include <assert.h>
 #include <inttypes.h>
@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -79,6 +80,17 @@ struct struct_bgpstream_broker_datasource_t {
 
   // the max (file_time + duration) that we have seen
   uint32_t current_window_end;
+
+  // the duration of the file that set current_window_end
+  uint32_t current_window_duration;
+
+  // number of inputs queued by the current update (across retries, since a
+  // response that is cut off may already have queued some of its files)
+  int queued;
+
+  // the broker cannot notify us of new data, so this watches no files, but
+  // waiting on it (rather than sleeping) lets the stream be interrupted
+  bgpstream_datasource_watch_t *wake;
 };
 
 #define AMPORQ                                                                 \
@@ -91,113 +103,287 @@ struct struct_bgpstream_broker_datasource_t {
     }                                                                          \
   } while (0)
 
-static int json_isnull(const char *json, jsmntok_t *tok)
+/* state learned from a response, only committed to the data source once the
+   whole response has been parsed */
+typedef struct broker_response {
+  uint32_t time;
+  uint32_t window_end;
+  uint32_t window_duration;
+
+  // number of new inputs queued (even if the response turns out to be
+  // invalid, these stay in the queue)
+  int queued;
+} broker_response_t;
+
+/* -------------------- streaming JSON parser -------------------- */
+
+/* The broker response is consumed directly from the wandio stream, one token
+ * at a time, and each dumpFiles entry is pushed onto the input queue as soon as
+ * its closing brace is read. Memory use is bounded by the read buffer and the
+ * largest single string value, regardless of the size of the response. */
+
+// size of the buffer used to read from the broker
+#define JSON_BUFLEN 4096
+
+// max length of a single string/primitive value (urls are the longest)
+#define JSON_STRLEN URL_BUFLEN
+
+typedef enum {
+  JSON_TOK_ERR = -2,
+  JSON_TOK_EOF = -1,
+  JSON_TOK_OBJ_START = 0,
+  JSON_TOK_OBJ_END,
+  JSON_TOK_ARR_START,
+  JSON_TOK_ARR_END,
+  JSON_TOK_COLON,
+  JSON_TOK_COMMA,
+  JSON_TOK_STRING,
+  JSON_TOK_PRIMITIVE,
+} json_tok_t;
+
+typedef struct json_reader {
+  io_t *io;
+
+  // raw bytes from the broker
+  char buf[JSON_BUFLEN];
+  int64_t buf_len;
+  int64_t buf_pos;
+
+  // set if the underlying read failed (as opposed to malformed JSON)
+  int io_error;
+
+  // value of the most recent string or primitive token
+  char val[JSON_STRLEN];
+  size_t val_len;
+} json_reader_t;
+
+// get the next byte from the stream, or -1 on EOF/error
+static int json_getc(json_reader_t *jr)
 {
-  if (tok->type == JSMN_PRIMITIVE &&
-      strncmp("null", json + tok->start, tok->end - tok->start) == 0) {
-    return 1;
+  if (jr->buf_pos == jr->buf_len) {
+    jr->buf_pos = 0;
+    if ((jr->buf_len = wandio_read(jr->io, jr->buf, JSON_BUFLEN)) <= 0) {
+      if (jr->buf_len < 0) {
+        fprintf(stderr, "ERROR: Reading from broker failed\n");
+        jr->io_error = 1;
+      }
+      jr->buf_len = 0;
+      return -1;
+    }
   }
-  return 0;
+  return (unsigned char)jr->buf[jr->buf_pos++];
 }
 
-static int json_strcmp(const char *json, jsmntok_t *tok, const char *s)
+// push back the byte most recently returned by json_getc
+static void json_ungetc(json_reader_t *jr)
 {
-  if (tok->type == JSMN_STRING && (int)strlen(s) == tok->end - tok->start &&
-      strncmp(json + tok->start, s, tok->end - tok->start) == 0) {
-    return 0;
+  assert(jr->buf_pos > 0);
+  jr->buf_pos--;
+}
+
+static int json_val_append(json_reader_t *jr, char c)
+{
+  if (jr->val_len + 1 >= JSON_STRLEN) {
+    fprintf(stderr, "ERROR: JSON value too long\n");
+    return -1;
   }
-  return -1;
+  jr->val[jr->val_len++] = c;
+  return 0;
 }
 
-// NB: this ONLY replaces \/ with /
-static void unescape_url(char *url)
+static json_tok_t json_read_string(json_reader_t *jr)
 {
-  char *p = url;
+  int c;
 
-  while (*p != '\0') {
-    if (*p == '\\' && *(p + 1) == '/') {
-      // copy the remainder of the string backward (ugh)
-      memmove(p, p + 1, strlen(p + 1) + 1);
+  jr->val_len = 0;
+  while ((c = json_getc(jr)) != '"') {
+    if (c < 0) {
+      return JSON_TOK_ERR;
+    }
+    if (c == '\\') {
+      // only unescape the simple sequences, \uXXXX is kept verbatim
+      switch ((c = json_getc(jr))) {
+      case '"':
+      case '\\':
+      case '/':
+        break;
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case 'u':
+        if (json_val_append(jr, '\\') != 0) {
+          return JSON_TOK_ERR;
+        }
+        break;
+      default:
+        return JSON_TOK_ERR;
+      }
+    }
+    if (json_val_append(jr, c) != 0) {
+      return JSON_TOK_ERR;
     }
-    p++;
   }
+  jr->val[jr->val_len] = '\0';
+  return JSON_TOK_STRING;
 }
 
-static jsmntok_t *json_skip(jsmntok_t *t)
+static json_tok_t json_read_primitive(json_reader_t *jr, int c)
 {
-  int i;
-  jsmntok_t *s;
-  switch (t->type) {
-  case JSMN_PRIMITIVE:
-  case JSMN_STRING:
-    t++;
-    break;
-  case JSMN_OBJECT:
-  case JSMN_ARRAY:
-    s = t;
-    t++; // move onto first key
-    for (i = 0; i < s->size; i++) {
-      t = json_skip(t);
-      if (s->type == JSMN_OBJECT) {
-        t = json_skip(t);
-      }
+  jr->val_len = 0;
+  while (c >= 0 && c != ',' && c != ':' && c != '}' && c != ']' && c != ' ' &&
+         c != '\t' && c != '\n' && c != '\r') {
+    if (json_val_append(jr, c) != 0) {
+      return JSON_TOK_ERR;
     }
+    c = json_getc(jr);
+  }
+  if (c >= 0) {
+    json_ungetc(jr);
+  } else if (jr->io_error != 0) {
+    return JSON_TOK_ERR;
   }
+  jr->val[jr->val_len] = '\0';
+  return JSON_TOK_PRIMITIVE;
+}
+
+static json_tok_t json_next(json_reader_t *jr)
+{
+  int c;
 
-  return t;
+  do {
+    c = json_getc(jr);
+  } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+  switch (c) {
+  case -1:
+    return (jr->io_error != 0) ? JSON_TOK_ERR : JSON_TOK_EOF;
+  case '{':
+    return JSON_TOK_OBJ_START;
+  case '}':
+    return JSON_TOK_OBJ_END;
+  case '[':
+    return JSON_TOK_ARR_START;
+  case ']':
+    return JSON_TOK_ARR_END;
+  case ':':
+    return JSON_TOK_COLON;
+  case ',':
+    return JSON_TOK_COMMA;
+  case '"':
+    return json_read_string(jr);
+  default:
+    return json_read_primitive(jr, c);
+  }
 }
 
-#define json_str_assert(js, t, str)                                            \
+// consume the remainder of a value whose first token is tok
+static int json_skip(json_reader_t *jr, json_tok_t tok)
+{
+  int depth = 0;
+
+  do {
+    switch (tok) {
+    case JSON_TOK_OBJ_START:
+    case JSON_TOK_ARR_START:
+      depth++;
+      break;
+    case JSON_TOK_OBJ_END:
+    case JSON_TOK_ARR_END:
+      depth--;
+      break;
+    case JSON_TOK_ERR:
+    case JSON_TOK_EOF:
+      return -1;
+    default:
+      break;
+    }
+    if (depth == 0) {
+      return 0;
+    }
+    tok = json_next(jr);
+  } while (1);
+}
+
+/* Read the next key of an object. Returns 1 if a key was read (and the
+ * following colon consumed), 0 if the object is closed, -1 on error. first
+ * should be set for the first key of the object. */
+static int json_next_key(json_reader_t *jr, int first)
+{
+  json_tok_t tok = json_next(jr);
+
+  if (first == 0) {
+    if (tok == JSON_TOK_OBJ_END) {
+      return 0;
+    }
+    if (tok != JSON_TOK_COMMA) {
+      return -1;
+    }
+    tok = json_next(jr);
+  } else if (tok == JSON_TOK_OBJ_END) {
+    return 0;
+  }
+
+  // all keys must be strings
+  if (tok != JSON_TOK_STRING) {
+    fprintf(stderr, "ERROR: Encountered non-string key: '%s'\n",
+            (tok == JSON_TOK_PRIMITIVE) ? jr->val : "");
+    return -1;
+  }
+  if (json_next(jr) != JSON_TOK_COLON) {
+    return -1;
+  }
+  return 1;
+}
+
+#define json_key_is(jr, s) (strcmp((jr)->val, s) == 0)
+
+#define json_expect(jr, type)                                                  \
   do {                                                                         \
-    if (json_strcmp(js, t, str) != 0) {                                        \
+    if (json_next(jr) != type) {                                               \
       goto err;                                                                \
     }                                                                          \
   } while (0)
 
-#define json_type_assert(t, asstype)                                           \
+#define json_strcpy(dest, jr)                                                  \
   do {                                                                         \
-    if (t->type != asstype) {                                                  \
+    if ((jr)->val_len >= sizeof(dest)) {                                       \
       goto err;                                                                \
     }                                                                          \
+    memcpy(dest, (jr)->val, (jr)->val_len + 1);                                \
   } while (0)
 
-#define NEXT_TOK t++
-
-#define json_strcpy(dest, t, js)                                               \
+#define json_strtoul(dest, jr)                                                 \
   do {                                                                         \
-    memcpy(dest, js + t->start, t->end - t->start);                            \
-    dest[t->end - t->start] = '\0';                                            \
-  } while (0)
-
-#define json_strtoul(dest, t)                                                  \
-  do {                                                                         \
-    char intbuf[20];                                                           \
     char *endptr = NULL;                                                       \
-    assert(t->end - t->start < 20);                                            \
-    strncpy(intbuf, js + t->start, t->end - t->start);                         \
-    intbuf[t->end - t->start] = '\0';                                          \
-    dest = strtoul(intbuf, &endptr, 10);                                       \
-    if (*endptr != '\0') {                                                     \
+    dest = strtoul((jr)->val, &endptr, 10);                                    \
+    if ((jr)->val_len == 0 || *endptr != '\0') {                               \
       goto err;                                                                \
     }                                                                          \
   } while (0)
 
-static int process_json(bgpstream_broker_datasource_t *broker_ds,
-                        bgpstream_input_mgr_t *input_mgr, const char *js,
-                        jsmntok_t *root_tok, size_t count)
+/* parse one dumpFiles object (the opening brace has been consumed) and queue
+   the file it describes. returns 0 if successful */
+static int process_dump_file(broker_response_t *resp,
+                             bgpstream_input_mgr_t *input_mgr,
+                             json_reader_t *jr)
 {
-  int i, j, k;
-  jsmntok_t *t = root_tok + 1;
-
-  int arr_len, obj_len;
-
-  int time_set = 0;
+  int first = 1;
+  int rc;
+  int queued;
 
-  int num_results = 0;
-
-  // per-file info
-  char *url = NULL;
-  size_t url_len = 0;
+  char url[JSON_STRLEN] = "";
   int url_set = 0;
   char collector[BGPSTREAM_UTILS_STR_NAME_LEN] = "";
   int collector_set = 0;
@@ -210,250 +396,231 @@ static int process_json(bgpstream_broker_datasource_t *broker_ds,
   uint32_t duration = 0;
   int duration_set = 0;
 
-  if (count == 0) {
-    fprintf(stderr, "ERROR: Empty JSON response from broker\n");
-    goto retry;
+  while ((rc = json_next_key(jr, first)) == 1) {
+    first = 0;
+    if (json_key_is(jr, "urlType")) {
+      json_expect(jr, JSON_TOK_STRING);
+      if (json_key_is(jr, "simple") == 0) {
+        // not yet supported?
+        fprintf(stderr, "ERROR: Unsupported URL type '%s'\n", jr->val);
+        goto err;
+      }
+    } else if (json_key_is(jr, "url")) {
+      json_expect(jr, JSON_TOK_STRING);
+      json_strcpy(url, jr);
+      url_set = 1;
+    } else if (json_key_is(jr, "project")) {
+      json_expect(jr, JSON_TOK_STRING);
+      json_strcpy(project, jr);
+      project_set = 1;
+    } else if (json_key_is(jr, "collector")) {
+      json_expect(jr, JSON_TOK_STRING);
+      json_strcpy(collector, jr);
+      collector_set = 1;
+    } else if (json_key_is(jr, "type")) {
+      json_expect(jr, JSON_TOK_STRING);
+      json_strcpy(type, jr);
+      type_set = 1;
+    } else if (json_key_is(jr, "initialTime")) {
+      json_expect(jr, JSON_TOK_PRIMITIVE);
+      json_strtoul(initial_time, jr);
+      initial_time_set = 1;
+    } else if (json_key_is(jr, "duration")) {
+      json_expect(jr, JSON_TOK_PRIMITIVE);
+      json_strtoul(duration, jr);
+      duration_set = 1;
+    } else {
+      // skip fields that newer brokers may add
+      if (json_skip(jr, json_next(jr)) != 0) {
+        goto err;
+      }
+    }
   }
-
-  if (root_tok->type != JSMN_OBJECT) {
-    fprintf(stderr, "ERROR: Root object is not JSON\n");
-    fprintf(stderr, "INFO: JSON: %s\n", js);
+  if (rc != 0) {
     goto err;
   }
 
-  // iterate over the children of the root object
-  for (i = 0; i < root_tok->size; i++) {
-    // all keys must be strings
-    if (t->type != JSMN_STRING) {
-      fprintf(stderr, "ERROR: Encountered non-string key: '%.*s'\n",
-              t->end - t->start, js + t->start);
-      goto err;
-    }
-    if (json_strcmp(js, t, "time") == 0) {
-      NEXT_TOK;
-      json_type_assert(t, JSMN_PRIMITIVE);
-      json_strtoul(broker_ds->last_response_time, t);
-      time_set = 1;
-      NEXT_TOK;
-    } else if (json_strcmp(js, t, "type") == 0) {
-      NEXT_TOK;
-      json_str_assert(js, t, "data");
-      NEXT_TOK;
-    } else if (json_strcmp(js, t, "error") == 0) {
-      NEXT_TOK;
-      if (json_isnull(js, t) == 0) { // i.e. there is an error set
-        fprintf(stderr, "ERROR: Broker reported an error: %.*s\n",
-                t->end - t->start, js + t->start);
-        goto err;
-      }
-      NEXT_TOK;
-    } else if (json_strcmp(js, t, "queryParameters") == 0) {
-      NEXT_TOK;
-      json_type_assert(t, JSMN_OBJECT);
-      // skip over this object
-      t = json_skip(t);
-    } else if (json_strcmp(js, t, "data") == 0) {
-      NEXT_TOK;
-      json_type_assert(t, JSMN_OBJECT);
-      NEXT_TOK;
-      json_str_assert(js, t, "dumpFiles");
-      NEXT_TOK;
-      json_type_assert(t, JSMN_ARRAY);
-      arr_len = t->size; // number of dump files
-      NEXT_TOK;          // first elem in array
-      for (j = 0; j < arr_len; j++) {
-        json_type_assert(t, JSMN_OBJECT);
-        obj_len = t->size;
-        NEXT_TOK;
-
-        url_set = 0;
-        project_set = 0;
-        collector_set = 0;
-        type_set = 0;
-        initial_time_set = 0;
-        duration_set = 0;
-
-        for (k = 0; k < obj_len; k++) {
-          if (json_strcmp(js, t, "urlType") == 0) {
-            NEXT_TOK;
-            if (json_strcmp(js, t, "simple") != 0) {
-              // not yet supported?
-              fprintf(stderr, "ERROR: Unsupported URL type '%.*s'\n",
-                      t->end - t->start, js + t->start);
-              goto err;
-            }
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "url") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_STRING);
-            if (url_len < (t->end - t->start + 1)) {
-              url_len = t->end - t->start + 1;
-              if ((url = realloc(url, url_len)) == NULL) {
-                fprintf(stderr, "ERROR: Could not realloc URL string\n");
-                goto err;
-              }
-            }
-            json_strcpy(url, t, js);
-            unescape_url(url);
-            url_set = 1;
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "project") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_STRING);
-            json_strcpy(project, t, js);
-            project_set = 1;
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "collector") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_STRING);
-            json_strcpy(collector, t, js);
-            collector_set = 1;
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "type") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_STRING);
-            json_strcpy(type, t, js);
-            type_set = 1;
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "initialTime") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_PRIMITIVE);
-            json_strtoul(initial_time, t);
-            initial_time_set = 1;
-            NEXT_TOK;
-          } else if (json_strcmp(js, t, "duration") == 0) {
-            NEXT_TOK;
-            json_type_assert(t, JSMN_PRIMITIVE);
-            json_strtoul(duration, t);
-            duration_set = 1;
-            NEXT_TOK;
-          } else {
-            fprintf(stderr, "ERROR: Unknown field '%.*s'\n", t->end - t->start,
-                    js + t->start);
-            goto err;
-          }
-        }
-        // file obj has been completely read
-        if (url_set == 0 || project_set == 0 || collector_set == 0 ||
-            type_set == 0 || initial_time_set == 0 || duration_set == 0) {
-          fprintf(stderr, "ERROR: Invalid dumpFile record\n");
-          goto retry;
-        }
+  // file obj has been completely read
+  if (url_set == 0 || project_set == 0 || collector_set == 0 ||
+      type_set == 0 || initial_time_set == 0 || duration_set == 0) {
+    fprintf(stderr, "ERROR: Invalid dumpFile record\n");
+    goto err;
+  }
 #ifdef WITH_BROKER_DEBUG
-        fprintf(stderr, "----------\n");
-        fprintf(stderr, "URL: %s\n", url);
-        fprintf(stderr, "Project: %s\n", project);
-        fprintf(stderr, "Collector: %s\n", collector);
-        fprintf(stderr, "Type: %s\n", type);
-        fprintf(stderr, "InitialTime: %" PRIu32 "\n", initial_time);
-        fprintf(stderr, "Duration: %" PRIu32 "\n", duration);
+  fprintf(stderr, "----------\n");
+  fprintf(stderr, "URL: %s\n", url);
+  fprintf(stderr, "Project: %s\n", project);
+  fprintf(stderr, "Collector: %s\n", collector);
+  fprintf(stderr, "Type: %s\n", type);
+  fprintf(stderr, "InitialTime: %" PRIu32 "\n", initial_time);
+  fprintf(stderr, "Duration: %" PRIu32 "\n", duration);
 #endif
 
-        // do we need to update our current_window_end?
-        if (initial_time + duration > broker_ds->current_window_end) {
-          broker_ds->current_window_end = (initial_time + duration);
-        }
+  // do we need to update our current_window_end?
+  if (initial_time + duration > resp->window_end) {
+    resp->window_end = (initial_time + duration);
+    resp->window_duration = duration;
+  }
+
+  // a file that is already queued (e.g. because a retried or overlapping
+  // query returned it again) is not added twice
+  if ((queued = bgpstream_input_mgr_push_sorted_input(
+         input_mgr, strdup(url), strdup(project), strdup(collector),
+         strdup(type), initial_time, duration)) < 0) {
+    fprintf(stderr, "ERROR: Could not queue dump file\n");
+    return ERR_FATAL;
+  }
+  resp->queued += queued;
+  return 0;
+
+err:
+  return ERR_RETRY;
+}
 
-        if (bgpstream_input_mgr_push_sorted_input(
-              input_mgr, strdup(url), strdup(project), strdup(collector),
-              strdup(type), initial_time, duration) <= 0) {
+// parse the "data" object (the opening brace has been consumed)
+static int process_data(broker_response_t *resp,
+                        bgpstream_input_mgr_t *input_mgr, json_reader_t *jr)
+{
+  int first = 1;
+  int rc;
+  json_tok_t tok;
+  int cnt;
+
+  while ((rc = json_next_key(jr, first)) == 1) {
+    first = 0;
+    if (json_key_is(jr, "dumpFiles") == 0) {
+      // skip anything we don't know about
+      if (json_skip(jr, json_next(jr)) != 0) {
+        goto err;
+      }
+      continue;
+    }
+    json_expect(jr, JSON_TOK_ARR_START);
+    tok = json_next(jr);
+    cnt = 0;
+    while (tok != JSON_TOK_ARR_END) {
+      if (cnt > 0) {
+        if (tok != JSON_TOK_COMMA) {
           goto err;
         }
-
-        num_results++;
+        tok = json_next(jr);
+      }
+      if (tok != JSON_TOK_OBJ_START) {
+        goto err;
       }
+      if ((rc = process_dump_file(resp, input_mgr, jr)) < 0) {
+        return rc;
+      }
+      cnt++;
+      tok = json_next(jr);
     }
-    // TODO: handle unknown tokens
   }
-
-  if (time_set == 0) {
+  if (rc != 0) {
     goto err;
   }
 
-  free(url);
-  return num_results;
-
-retry:
-  free(url);
-  return ERR_RETRY;
+  return 0;
 
 err:
-  fprintf(stderr, "ERROR: Invalid JSON response received from broker\n");
-  free(url);
   return ERR_RETRY;
 }
 
-static int read_json(bgpstream_broker_datasource_t *broker_ds,
-                     bgpstream_input_mgr_t *input_mgr, io_t *jsonfile)
+int bgpstream_broker_datasource_read_response(
+  bgpstream_broker_datasource_t *broker_ds, bgpstream_input_mgr_t *input_mgr,
+  io_t *jsonfile)
 {
-  jsmn_parser p;
-  jsmntok_t *tok = NULL;
-  size_t tokcount = 128;
-
+  json_reader_t *jr = NULL;
+  json_tok_t tok;
+  int first = 1;
+  int rc;
   int ret;
-  char *js = NULL;
-  size_t jslen = 0;
-#define BUFSIZE 1024
-  char buf[BUFSIZE];
 
-  // prepare parser
-  jsmn_init(&p);
+  int time_set = 0;
+  broker_response_t resp;
 
-  // allocate some tokens to start
-  if ((tok = malloc(sizeof(jsmntok_t) * tokcount)) == NULL) {
-    fprintf(stderr, "ERROR: Could not malloc initial tokens\n");
-    goto err;
+  resp.time = 0;
+  resp.window_end = broker_ds->current_window_end;
+  resp.window_duration = broker_ds->current_window_duration;
+  resp.queued = 0;
+
+  if ((jr = malloc_zero(sizeof(json_reader_t))) == NULL) {
+    fprintf(stderr, "ERROR: Could not malloc JSON reader\n");
+    goto fatal;
   }
+  jr->io = jsonfile;
 
-  // slurp the whole file into a buffer
-  while (1) {
-    /* do a read */
-    ret = wandio_read(jsonfile, buf, BUFSIZE);
-    if (ret < 0) {
-      fprintf(stderr, "ERROR: Reading from broker failed\n");
-      goto err;
-    }
-    if (ret == 0) {
-      // we're done
-      break;
-    }
-    if ((js = realloc(js, jslen + ret + 1)) == NULL) {
-      fprintf(stderr, "ERROR: Could not realloc json string\n");
-      goto err;
-    }
-    strncpy(js + jslen, buf, ret);
-    jslen += ret;
+  if ((tok = json_next(jr)) == JSON_TOK_EOF) {
+    fprintf(stderr, "ERROR: Empty JSON response from broker\n");
+    goto retry;
+  }
+  if (tok != JSON_TOK_OBJ_START) {
+    fprintf(stderr, "ERROR: Root object is not JSON\n");
+    goto err;
   }
 
-again:
-  if ((ret = jsmn_parse(&p, js, jslen, tok, tokcount)) < 0) {
-    if (ret == JSMN_ERROR_NOMEM) {
-      tokcount *= 2;
-      if ((tok = realloc(tok, sizeof(jsmntok_t) * tokcount)) == NULL) {
-        fprintf(stderr, "ERROR: Could not realloc tokens\n");
+  // iterate over the children of the root object
+  while ((rc = json_next_key(jr, first)) == 1) {
+    first = 0;
+    if (json_key_is(jr, "time")) {
+      json_expect(jr, JSON_TOK_PRIMITIVE);
+      json_strtoul(resp.time, jr);
+      time_set = 1;
+    } else if (json_key_is(jr, "type")) {
+      json_expect(jr, JSON_TOK_STRING);
+      if (json_key_is(jr, "data") == 0) {
+        goto err;
+      }
+    } else if (json_key_is(jr, "error")) {
+      tok = json_next(jr);
+      if (tok != JSON_TOK_PRIMITIVE || json_key_is(jr, "null") == 0) {
+        // i.e. there is an error set
+        fprintf(stderr, "ERROR: Broker reported an error: %s\n",
+                (tok == JSON_TOK_STRING || tok == JSON_TOK_PRIMITIVE) ? jr->val
+                                                                      : "");
+        goto err;
+      }
+    } else if (json_key_is(jr, "data")) {
+      json_expect(jr, JSON_TOK_OBJ_START);
+      if ((ret = process_data(&resp, input_mgr, jr)) < 0) {
+        if (ret == ERR_FATAL) {
+          fprintf(stderr, "ERROR: Received fatal error from process_data\n");
+          goto fatal;
+        }
+        goto err;
+      }
+    } else {
+      // queryParameters, and anything else we don't care about
+      if (json_skip(jr, json_next(jr)) != 0) {
         goto err;
       }
-      goto again;
-    }
-    if (ret == JSMN_ERROR_INVAL) {
-      fprintf(stderr, "ERROR: Invalid character in JSON string\n");
-      goto err;
     }
-    fprintf(stderr, "ERROR: JSON parser returned %d\n", ret);
+  }
+  if (rc != 0 || time_set == 0) {
     goto err;
   }
-  ret = process_json(broker_ds, input_mgr, js, tok, p.toknext);
 
-  free(js);
-  free(tok);
-  if (ret == ERR_FATAL) {
-    fprintf(stderr, "ERROR: Received fatal error from process_json\n");
-  }
-  return ret;
+  // the response is complete, so the next query can continue from it
+  broker_ds->last_response_time = resp.time;
+  broker_ds->current_window_end = resp.window_end;
+  broker_ds->current_window_duration = resp.window_duration;
+  broker_ds->queued += resp.queued;
+
+  free(jr);
+  return resp.queued;
 
 err:
-  free(js);
-  free(tok);
+  fprintf(stderr, "ERROR: Invalid JSON response received from broker\n");
+retry:
+  if (jr != NULL && jr->io_error != 0) {
+    goto fatal;
+  }
+  broker_ds->queued += resp.queued;
+  free(jr);
+  return ERR_RETRY;
+
+fatal:
+  broker_ds->queued += resp.queued;
+  free(jr);
   fprintf(stderr, "%s: Returning fatal error code\n", __func__);
   return ERR_FATAL;
 }
@@ -479,6 +646,11 @@ bgpstream_broker_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
   }
   broker_ds->filter_mgr = filter_mgr;
   broker_ds->first_param = 1;
+  if ((broker_ds->wake = bgpstream_datasource_watch_create()) == NULL) {
+    bgpstream_log_err(
+      "\t\tBSDS_BROKER: create broker_ds can't allocate memory");
+    goto err;
+  }
   broker_ds->query_url_remaining = URL_BUFLEN;
   broker_ds->query_url_buf[0] = '\0';
 
@@ -590,6 +762,8 @@ int bgpstream_broker_datasource_update_input_queue(
 
   int success = 0;
 
+  broker_ds->queued = 0;
+
   if (broker_ds->last_response_time > 0) {
     // need to add dataAddedSince
     if (snprintf(buf, BUFLEN, "%" PRIu32, broker_ds->last_response_time) >=
@@ -618,7 +792,11 @@ int bgpstream_broker_datasource_update_input_queue(
     if (attempts > 0) {
       fprintf(stderr, "WARN: Broker request failed, waiting %ds before retry\n",
               wait_time);
-      sleep(wait_time);
+      bgpstream_datasource_watch_wait(broker_ds->wake, wait_time);
+      if (bgpstream_datasource_watch_interrupted(broker_ds->wake)) {
+        // stop retrying, the stream is being shut down
+        break;
+      }
       if (wait_time < MAX_WAIT_TIME) {
         wait_time *= 2;
       }
@@ -635,9 +813,9 @@ int bgpstream_broker_datasource_update_input_queue(
       goto retry;
     }
 
-    if ((num_results = read_json(broker_ds, input_mgr, jsonfile)) ==
-        ERR_FATAL) {
-      fprintf(stderr, "ERROR: Received fatal error code from read_json\n");
+    if ((num_results = bgpstream_broker_datasource_read_response(
+           broker_ds, input_mgr, jsonfile)) == ERR_FATAL) {
+      fprintf(stderr, "ERROR: Received fatal error code from broker\n");
       goto err;
     } else if (num_results == ERR_RETRY) {
       goto retry;
@@ -657,7 +835,9 @@ int bgpstream_broker_datasource_update_input_queue(
   *broker_ds->query_url_end = '\0';
   broker_ds->query_url_remaining =
     URL_BUFLEN - strlen(broker_ds->query_url_end);
-  return num_results;
+  // files queued by an earlier, cut off, response are counted too, otherwise
+  // a retry that only finds duplicates would look like the end of the data
+  return broker_ds->queued;
 
 err:
   fprintf(stderr, "ERROR: Fatal error in broker data source\n");
@@ -667,6 +847,36 @@ err:
   return -1;
 }
 
+int bgpstream_broker_datasource_wait(bgpstream_broker_datasource_t *broker_ds,
+                                     int timeout)
+{
+  struct timeval tv;
+  uint32_t next_end;
+  int wait = timeout;
+
+  // the broker cannot tell us when new data arrives, but we know that the
+  // next file cannot be published before the interval it covers has ended,
+  // so if that is going to happen before the timeout, ask again right then
+  gettimeofday(&tv, NULL);
+  next_end = broker_ds->current_window_end + broker_ds->current_window_duration;
+  if (broker_ds->current_window_end > 0 && next_end > tv.tv_sec &&
+      next_end - tv.tv_sec < (uint32_t)timeout) {
+    wait = next_end - tv.tv_sec;
+  }
+
+  bgpstream_debug("\t\tBSDS_BROKER: waiting %d seconds for new data", wait);
+  if (bgpstream_datasource_watch_wait(broker_ds->wake, wait) < 0) {
+    return -1;
+  }
+  return 0;
+}
+
+void bgpstream_broker_datasource_interrupt(
+  bgpstream_broker_datasource_t *broker_ds)
+{
+  bgpstream_datasource_watch_interrupt(broker_ds->wake);
+}
+
 void bgpstream_broker_datasource_destroy(
   bgpstream_broker_datasource_t *broker_ds)
 {
@@ -674,5 +884,6 @@ void bgpstream_broker_datasource_destroy(
     return;
   }
 
+  bgpstream_datasource_watch_destroy(broker_ds->wake);
   free(broker_ds);
 }
@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <wandio.h>
+
 /** Opaque handle that represents the broker data source */
 typedef struct struct_bgpstream_broker_datasource_t
   bgpstream_broker_datasource_t;
@@ -43,6 +45,25 @@ bgpstream_broker_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
 int bgpstream_broker_datasource_update_input_queue(
   bgpstream_broker_datasource_t *broker_ds, bgpstream_input_mgr_t *input_mgr);
 
+/* parse a broker response from the given stream and queue the dump files it
+   lists. returns the number of dump files that were queued (files that are
+   already in the queue are not counted), -1 on a fatal error, or -2 if the
+   response is malformed (and the query should be retried). files read before
+   the malformed part stay queued, and are included in the count returned by
+   bgpstream_broker_datasource_update_input_queue. the state used to build the
+   next query is only updated if the whole response is valid */
+int bgpstream_broker_datasource_read_response(
+  bgpstream_broker_datasource_t *broker_ds, bgpstream_input_mgr_t *input_mgr,
+  io_t *jsonfile);
+
+/* block until new data may be available (or timeout seconds elapse) */
+int bgpstream_broker_datasource_wait(bgpstream_broker_datasource_t *broker_ds,
+                                     int timeout);
+
+/* make a pending (and all later) wait, or retry, return immediately */
+void bgpstream_broker_datasource_interrupt(
+  bgpstream_broker_datasource_t *broker_ds);
+
 void bgpstream_broker_datasource_destroy(
   bgpstream_broker_datasource_t *broker_ds);
 
@@ -22,6 +22,7 @@
  */
 
 #include "bgpstream_datasource_csvfile.h"
+#include "bgpstream_datasource_watch.h"
 #include "bgpstream_debug.h"
 #include "config.h"
 #include "utils.h"
@@ -56,6 +57,8 @@ struct struct_bgpstream_csvfile_datasource_t {
   struct csv_parser parser;
   int current_field;
   int num_results;
+  /* set if an input could not be queued */
+  int push_error;
   bgpstream_filter_mgr_t *filter_mgr;
   bgpstream_input_mgr_t *input_mgr;
 
@@ -74,6 +77,9 @@ struct struct_bgpstream_csvfile_datasource_t {
   uint32_t last_processed_ts;
   /* maximum timestamp accepted in the current round */
   uint32_t max_accepted_ts;
+
+  /* notifications for changes to the csv file (may be NULL) */
+  bgpstream_datasource_watch_t *watch;
 };
 
 bgpstream_csvfile_datasource_t *
@@ -118,6 +124,12 @@ bgpstream_csvfile_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
   csvfile_ds->last_processed_ts = 0;
   csvfile_ds->max_accepted_ts = 0;
 
+  /* even if the file cannot be watched (e.g. it is remote), waiting on the
+     watch can still be interrupted */
+  if ((csvfile_ds->watch = bgpstream_datasource_watch_create()) != NULL) {
+    bgpstream_datasource_watch_add(csvfile_ds->watch, csvfile_ds->csvfile_file);
+  }
+
   bgpstream_debug("\t\tBSDS_CSVFILE: create csvfile_ds end");
   return csvfile_ds;
 
@@ -270,11 +282,16 @@ static void parse_csvfile_rowend(int c, void *user_data)
         csvfile_ds->max_ts_infile = csvfile_ds->timestamp;
       }
       if (bgpstream_csvfile_datasource_filter_ok(csvfile_ds)) {
-        csvfile_ds->num_results += bgpstream_input_mgr_push_sorted_input(
+        int rc = bgpstream_input_mgr_push_sorted_input(
           csvfile_ds->input_mgr, strdup(csvfile_ds->filename),
           strdup(csvfile_ds->project), strdup(csvfile_ds->collector),
           strdup(csvfile_ds->bgp_type), csvfile_ds->filetime,
           csvfile_ds->time_span);
+        if (rc < 0) {
+          csvfile_ds->push_error = 1;
+        } else {
+          csvfile_ds->num_results += rc;
+        }
       }
     }
   }
@@ -297,6 +314,7 @@ int bgpstream_csvfile_datasource_update_input_queue(
   csvfile_ds->max_accepted_ts = tv.tv_sec - 1;
 
   csvfile_ds->num_results = 0;
+  csvfile_ds->push_error = 0;
   csvfile_ds->max_ts_infile = 0;
   csvfile_ds->input_mgr = input_mgr;
 
@@ -324,12 +342,34 @@ int bgpstream_csvfile_datasource_update_input_queue(
 
   wandio_destroy(file_io);
   csvfile_ds->input_mgr = NULL;
+  if (csvfile_ds->push_error != 0) {
+    bgpstream_log_err("\t\tBSDS_CSVFILE: can't allocate memory for input");
+    return -1;
+  }
   csvfile_ds->last_processed_ts = csvfile_ds->max_ts_infile;
 
   bgpstream_debug("\t\tBSDS_CSVFILE: csvfile_ds update input queue end");
   return csvfile_ds->num_results;
 }
 
+int bgpstream_csvfile_datasource_wait(
+  bgpstream_csvfile_datasource_t *csvfile_ds, int timeout)
+{
+  if (csvfile_ds->watch == NULL) {
+    sleep(timeout);
+    return 0;
+  }
+  return bgpstream_datasource_watch_wait(csvfile_ds->watch, timeout);
+}
+
+void bgpstream_csvfile_datasource_interrupt(
+  bgpstream_csvfile_datasource_t *csvfile_ds)
+{
+  if (csvfile_ds->watch != NULL) {
+    bgpstream_datasource_watch_interrupt(csvfile_ds->watch);
+  }
+}
+
 void bgpstream_csvfile_datasource_destroy(
   bgpstream_csvfile_datasource_t *csvfile_ds)
 {
@@ -344,6 +384,7 @@ void bgpstream_csvfile_datasource_destroy(
   if (&(csvfile_ds->parser) != NULL) {
     csv_free(&(csvfile_ds->parser));
   }
+  bgpstream_datasource_watch_destroy(csvfile_ds->watch);
   free(csvfile_ds);
   bgpstream_debug("\t\tBSDS_CSVFILE: destroy csvfile_ds end");
 }
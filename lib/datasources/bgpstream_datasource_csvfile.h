@@ -42,6 +42,14 @@ bgpstream_csvfile_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
 int bgpstream_csvfile_datasource_update_input_queue(
   bgpstream_csvfile_datasource_t *csvfile_ds, bgpstream_input_mgr_t *input_mgr);
 
+/* block until new data may be available (or timeout seconds elapse) */
+int bgpstream_csvfile_datasource_wait(
+  bgpstream_csvfile_datasource_t *csvfile_ds, int timeout);
+
+/* make a pending (and all later) wait return immediately */
+void bgpstream_csvfile_datasource_interrupt(
+  bgpstream_csvfile_datasource_t *csvfile_ds);
+
 void bgpstream_csvfile_datasource_destroy(
   bgpstream_csvfile_datasource_t *csvfile_ds);
 
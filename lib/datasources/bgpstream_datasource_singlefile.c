@@ -22,6 +22,7 @@
  */
 
 #include "bgpstream_datasource_singlefile.h"
+#include "bgpstream_datasource_watch.h"
 #include "bgpstream_debug.h"
 #include "config.h"
 #include <inttypes.h>
@@ -37,9 +38,9 @@
 #define RIB_FREQUENCY_CHECK 1800
 /* check for new updates once every 2 minutes */
 #define UPDATE_FREQUENCY_CHECK 120
+/* (unless the file can be watched, in which case we check when it changes) */
 
 #define MAX_HEADER_READ_BYTES 1024
-static unsigned char buffer[MAX_HEADER_READ_BYTES];
 
 struct struct_bgpstream_singlefile_datasource_t {
   bgpstream_filter_mgr_t *filter_mgr;
@@ -49,6 +50,10 @@ struct struct_bgpstream_singlefile_datasource_t {
   char update_filename[BGPSTREAM_DUMP_MAX_LEN];
   unsigned char update_header[MAX_HEADER_READ_BYTES];
   uint32_t last_update_filetime;
+  /* notifications for changes to the files (ids are -1 if not watched) */
+  bgpstream_datasource_watch_t *watch;
+  int rib_watch_id;
+  int update_watch_id;
 };
 
 bgpstream_singlefile_datasource_t *
@@ -78,12 +83,25 @@ bgpstream_singlefile_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
   if (singlefile_upd_mrtfile != NULL) {
     strcpy(singlefile_ds->update_filename, singlefile_upd_mrtfile);
   }
+  singlefile_ds->rib_watch_id = -1;
+  singlefile_ds->update_watch_id = -1;
+  if ((singlefile_ds->watch = bgpstream_datasource_watch_create()) != NULL) {
+    if (singlefile_ds->rib_filename[0] != '\0') {
+      singlefile_ds->rib_watch_id = bgpstream_datasource_watch_add(
+        singlefile_ds->watch, singlefile_ds->rib_filename);
+    }
+    if (singlefile_ds->update_filename[0] != '\0') {
+      singlefile_ds->update_watch_id = bgpstream_datasource_watch_add(
+        singlefile_ds->watch, singlefile_ds->update_filename);
+    }
+  }
   bgpstream_debug("\t\tBSDS_CLIST: create customlist_ds end");
   return singlefile_ds;
 }
 
 static int same_header(char *mrt_filename, unsigned char *previous_header)
 {
+  unsigned char buffer[MAX_HEADER_READ_BYTES];
   off_t read_bytes;
   io_t *io_h = wandio_create(mrt_filename);
   if (io_h == NULL) {
@@ -109,6 +127,20 @@ static int same_header(char *mrt_filename, unsigned char *previous_header)
   return 0;
 }
 
+/* should we look at the given file again? */
+static int check_due(bgpstream_singlefile_datasource_t *singlefile_ds,
+                     int watch_id, uint32_t last_filetime, uint32_t frequency,
+                     uint32_t now)
+{
+  if (watch_id >= 0) {
+    /* the file is watched, so only re-read it when it has been re-written */
+    return bgpstream_datasource_watch_changed(singlefile_ds->watch,
+                                              watch_id) != 0 ||
+           last_filetime == 0;
+  }
+  return now - last_filetime > frequency;
+}
+
 int bgpstream_singlefile_datasource_update_input_queue(
   bgpstream_singlefile_datasource_t *singlefile_ds,
   bgpstream_input_mgr_t *input_mgr)
@@ -118,36 +150,64 @@ int bgpstream_singlefile_datasource_update_input_queue(
   gettimeofday(&tv, NULL);
   uint32_t now = tv.tv_sec;
   int num_results = 0;
+  int rc;
 
   /* check digest, if different (or first) then add files to input queue) */
   if (singlefile_ds->rib_filename[0] != '\0' &&
-      now - singlefile_ds->last_rib_filetime > RIB_FREQUENCY_CHECK &&
+      check_due(singlefile_ds, singlefile_ds->rib_watch_id,
+                singlefile_ds->last_rib_filetime, RIB_FREQUENCY_CHECK, now) &&
       same_header(singlefile_ds->rib_filename, singlefile_ds->rib_header) ==
         0) {
     /* fprintf(stderr, "new RIB at: %"PRIu32"\n", now); */
     singlefile_ds->last_rib_filetime = now;
-    num_results += bgpstream_input_mgr_push_sorted_input(
-      input_mgr, strdup(singlefile_ds->rib_filename), strdup("singlefile_ds"),
-      strdup("singlefile_ds"), strdup("ribs"), singlefile_ds->last_rib_filetime,
-      RIB_FREQUENCY_CHECK);
+    if ((rc = bgpstream_input_mgr_push_sorted_input(
+           input_mgr, strdup(singlefile_ds->rib_filename),
+           strdup("singlefile_ds"), strdup("singlefile_ds"), strdup("ribs"),
+           singlefile_ds->last_rib_filetime, RIB_FREQUENCY_CHECK)) < 0) {
+      return -1;
+    }
+    num_results += rc;
   }
 
   if (singlefile_ds->update_filename[0] != '\0' &&
-      now - singlefile_ds->last_update_filetime > UPDATE_FREQUENCY_CHECK &&
+      check_due(singlefile_ds, singlefile_ds->update_watch_id,
+                singlefile_ds->last_update_filetime, UPDATE_FREQUENCY_CHECK,
+                now) &&
       same_header(singlefile_ds->update_filename,
                   singlefile_ds->update_header) == 0) {
     /* fprintf(stderr, "new updates at: %"PRIu32"\n", now); */
     singlefile_ds->last_update_filetime = now;
-    num_results += bgpstream_input_mgr_push_sorted_input(
-      input_mgr, strdup(singlefile_ds->update_filename),
-      strdup("singlefile_ds"), strdup("singlefile_ds"), strdup("updates"),
-      singlefile_ds->last_update_filetime, UPDATE_FREQUENCY_CHECK);
+    if ((rc = bgpstream_input_mgr_push_sorted_input(
+           input_mgr, strdup(singlefile_ds->update_filename),
+           strdup("singlefile_ds"), strdup("singlefile_ds"), strdup("updates"),
+           singlefile_ds->last_update_filetime, UPDATE_FREQUENCY_CHECK)) < 0) {
+      return -1;
+    }
+    num_results += rc;
   }
 
   bgpstream_debug("\t\tBSDS_CLIST: singlefile_ds update input queue end");
   return num_results;
 }
 
+int bgpstream_singlefile_datasource_wait(
+  bgpstream_singlefile_datasource_t *singlefile_ds, int timeout)
+{
+  if (singlefile_ds->watch == NULL) {
+    sleep(timeout);
+    return 0;
+  }
+  return bgpstream_datasource_watch_wait(singlefile_ds->watch, timeout);
+}
+
+void bgpstream_singlefile_datasource_interrupt(
+  bgpstream_singlefile_datasource_t *singlefile_ds)
+{
+  if (singlefile_ds->watch != NULL) {
+    bgpstream_datasource_watch_interrupt(singlefile_ds->watch);
+  }
+}
+
 void bgpstream_singlefile_datasource_destroy(
   bgpstream_singlefile_datasource_t *singlefile_ds)
 {
@@ -156,6 +216,8 @@ void bgpstream_singlefile_datasource_destroy(
     return; // nothing to destroy
   }
   singlefile_ds->filter_mgr = NULL;
+  bgpstream_datasource_watch_destroy(singlefile_ds->watch);
+  singlefile_ds->watch = NULL;
   free(singlefile_ds);
   bgpstream_debug("\t\tBSDS_CLIST: destroy singlefile_ds end");
 }
@@ -44,6 +44,14 @@ int bgpstream_singlefile_datasource_update_input_queue(
   bgpstream_singlefile_datasource_t *singlefile_ds,
   bgpstream_input_mgr_t *input_mgr);
 
+/* block until new data may be available (or timeout seconds elapse) */
+int bgpstream_singlefile_datasource_wait(
+  bgpstream_singlefile_datasource_t *singlefile_ds, int timeout);
+
+/* make a pending (and all later) wait return immediately */
+void bgpstream_singlefile_datasource_interrupt(
+  bgpstream_singlefile_datasource_t *singlefile_ds);
+
 void bgpstream_singlefile_datasource_destroy(
   bgpstream_singlefile_datasource_t *singlefile_ds);
 
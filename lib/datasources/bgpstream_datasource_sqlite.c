@@ -22,6 +22,7 @@
  */
 
 #include "bgpstream_datasource_sqlite.h"
+#include "bgpstream_datasource_watch.h"
 #include "bgpstream_debug.h"
 #include "utils.h"
 
@@ -57,6 +58,8 @@ struct struct_bgpstream_sqlite_datasource_t {
   char *sqlite_file;
   uint32_t current_ts;
   uint32_t last_ts;
+  /* notifications for changes to the db (may be NULL) */
+  bgpstream_datasource_watch_t *watch;
 };
 
 static int prepare_db(bgpstream_sqlite_datasource_t *sqlite_ds)
@@ -233,6 +236,17 @@ bgpstream_sqlite_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
     goto err;
   }
 
+  /* writers in WAL mode only touch the main db file at checkpoint time, so
+     watch the log too */
+  if ((sqlite_ds->watch = bgpstream_datasource_watch_create()) != NULL) {
+    char wal_file[BGPSTREAM_DUMP_MAX_LEN];
+    bgpstream_datasource_watch_add(sqlite_ds->watch, sqlite_ds->sqlite_file);
+    if (snprintf(wal_file, BGPSTREAM_DUMP_MAX_LEN, "%s-wal",
+                 sqlite_ds->sqlite_file) < BGPSTREAM_DUMP_MAX_LEN) {
+      bgpstream_datasource_watch_add(sqlite_ds->watch, wal_file);
+    }
+  }
+
   // printf("%s\n", sqlite_ds->sql_query);
 
   bgpstream_debug("\t\tBSDS_SQLITE: create sqlite_ds end");
@@ -262,7 +276,7 @@ int bgpstream_sqlite_datasource_update_input_queue(
     if (rc == SQLITE_ROW) {
       /* printf("%s: %d\n", sqlite3_column_text(sqlite_ds->stmt, 0),
        * sqlite3_column_int(sqlite_ds->stmt, 6)); */
-      num_results += bgpstream_input_mgr_push_sorted_input(
+      rc = bgpstream_input_mgr_push_sorted_input(
         input_mgr, strdup((const char *)sqlite3_column_text(sqlite_ds->stmt,
                                                             0)) /* path */,
         strdup(
@@ -273,7 +287,12 @@ int bgpstream_sqlite_datasource_update_input_queue(
           (const char *)sqlite3_column_text(sqlite_ds->stmt, 3)) /* type */,
         sqlite3_column_int(sqlite_ds->stmt, 5) /* file time */,
         sqlite3_column_int(sqlite_ds->stmt, 4) /* time span */);
-
+      if (rc < 0) {
+        bgpstream_log_err("\t\tBSDS_SQLITE: can't allocate memory for input");
+        sqlite3_reset(sqlite_ds->stmt);
+        return -1;
+      }
+      num_results += rc;
     } else {
       bgpstream_log_err(
         "\t\tBSDS_SQLITE: error while stepping through results");
@@ -284,6 +303,24 @@ int bgpstream_sqlite_datasource_update_input_queue(
   return num_results;
 }
 
+int bgpstream_sqlite_datasource_wait(bgpstream_sqlite_datasource_t *sqlite_ds,
+                                     int timeout)
+{
+  if (sqlite_ds->watch == NULL) {
+    sleep(timeout);
+    return 0;
+  }
+  return bgpstream_datasource_watch_wait(sqlite_ds->watch, timeout);
+}
+
+void bgpstream_sqlite_datasource_interrupt(
+  bgpstream_sqlite_datasource_t *sqlite_ds)
+{
+  if (sqlite_ds->watch != NULL) {
+    bgpstream_datasource_watch_interrupt(sqlite_ds->watch);
+  }
+}
+
 void bgpstream_sqlite_datasource_destroy(
   bgpstream_sqlite_datasource_t *sqlite_ds)
 {
@@ -295,6 +332,7 @@ void bgpstream_sqlite_datasource_destroy(
 
     sqlite3_finalize(sqlite_ds->stmt);
     sqlite3_close(sqlite_ds->db);
+    bgpstream_datasource_watch_destroy(sqlite_ds->watch);
     free(sqlite_ds);
   }
 }
@@ -43,6 +43,14 @@ bgpstream_sqlite_datasource_create(bgpstream_filter_mgr_t *filter_mgr,
 int bgpstream_sqlite_datasource_update_input_queue(
   bgpstream_sqlite_datasource_t *sqlite_ds, bgpstream_input_mgr_t *input_mgr);
 
+/* block until new data may be available (or timeout seconds elapse) */
+int bgpstream_sqlite_datasource_wait(bgpstream_sqlite_datasource_t *sqlite_ds,
+                                     int timeout);
+
+/* make a pending (and all later) wait return immediately */
+void bgpstream_sqlite_datasource_interrupt(
+  bgpstream_sqlite_datasource_t *sqlite_ds);
+
 void bgpstream_sqlite_datasource_destroy(
   bgpstream_sqlite_datasource_t *sqlite_ds);
 
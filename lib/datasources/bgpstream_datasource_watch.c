@@ -0,0 +1,257 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_datasource_watch.h"
+#include "bgpstream_debug.h"
+#include "config.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <limits.h>
+#include <sys/inotify.h>
+#endif
+
+/* a data source only ever reads a couple of files */
+#define WATCH_MAX_FILES 8
+
+/* we only care about files that have been completely written (or atomically
+   moved into place), not every individual write */
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+typedef struct watched_file {
+  int wd;     // watch descriptor of the parent directory
+  char *name; // name of the file within the directory
+  int changed;
+} watched_file_t;
+
+struct struct_bgpstream_datasource_watch_t {
+  int fd; // inotify instance (-1 if not available)
+  /* written to (once) to wake up waiters when the watch is interrupted. it
+     is never drained, so all later waits return immediately too */
+  int intr_fds[2];
+  int interrupted;
+  watched_file_t files[WATCH_MAX_FILES];
+  int files_cnt;
+};
+
+bgpstream_datasource_watch_t *bgpstream_datasource_watch_create()
+{
+  bgpstream_datasource_watch_t *watch;
+
+  if ((watch = malloc_zero(sizeof(bgpstream_datasource_watch_t))) == NULL) {
+    return NULL;
+  }
+  watch->fd = -1;
+
+  if (pipe(watch->intr_fds) != 0) {
+    free(watch);
+    return NULL;
+  }
+
+#ifdef HAVE_SYS_INOTIFY_H
+  if ((watch->fd = inotify_init()) < 0) {
+    bgpstream_log_warn("\t\tBSDS_WATCH: inotify unavailable, falling back to "
+                       "polling");
+    watch->fd = -1;
+  }
+#endif
+
+  return watch;
+}
+
+int bgpstream_datasource_watch_add(bgpstream_datasource_watch_t *watch,
+                                   const char *path)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  char dir[PATH_MAX];
+  const char *name;
+  watched_file_t *f;
+
+  if (watch->fd < 0 || watch->files_cnt == WATCH_MAX_FILES ||
+      strstr(path, "://") != NULL) {
+    // remote files cannot be watched
+    return -1;
+  }
+
+  /* watch the parent directory so that we notice the file being replaced
+     (e.g. by rename), not just modified in place */
+  if ((name = strrchr(path, '/')) == NULL) {
+    strcpy(dir, ".");
+    name = path;
+  } else {
+    if (name - path >= PATH_MAX) {
+      return -1;
+    }
+    memcpy(dir, path, name - path);
+    dir[name - path] = '\0';
+    if (dir[0] == '\0') {
+      strcpy(dir, "/");
+    }
+    name++;
+  }
+
+  f = &watch->files[watch->files_cnt];
+  if ((f->wd = inotify_add_watch(watch->fd, dir, WATCH_MASK)) < 0) {
+    bgpstream_log_warn("\t\tBSDS_WATCH: could not watch %s", dir);
+    return -1;
+  }
+  if ((f->name = strdup(name)) == NULL) {
+    return -1;
+  }
+  f->changed = 0;
+
+  return watch->files_cnt++;
+#else
+  return -1;
+#endif
+}
+
+int bgpstream_datasource_watch_wait(bgpstream_datasource_watch_t *watch,
+                                    int timeout)
+{
+  struct pollfd pfds[2];
+  struct timeval now;
+  uint64_t deadline;
+  uint64_t now_ms;
+  int pfds_cnt = 1;
+  int seen = 0;
+  int rc;
+#ifdef HAVE_SYS_INOTIFY_H
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *ev;
+  ssize_t len;
+  char *p;
+  int i;
+#endif
+
+  pfds[0].fd = watch->intr_fds[0];
+  pfds[0].events = POLLIN;
+#ifdef HAVE_SYS_INOTIFY_H
+  if (watch->fd >= 0 && watch->files_cnt > 0) {
+    pfds[1].fd = watch->fd;
+    pfds[1].events = POLLIN;
+    pfds_cnt = 2;
+  }
+#endif
+
+  gettimeofday(&now, NULL);
+  deadline = (now.tv_sec * 1000 + now.tv_usec / 1000) + timeout * 1000;
+
+  /* with nothing to watch, all we can do is wait (for an interrupt) */
+  while (seen == 0) {
+    gettimeofday(&now, NULL);
+    now_ms = now.tv_sec * 1000 + now.tv_usec / 1000;
+    if (now_ms >= deadline) {
+      return 0;
+    }
+    if ((rc = poll(pfds, pfds_cnt, deadline - now_ms)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (rc == 0 || (pfds[0].revents & POLLIN) != 0) {
+      return 0;
+    }
+#ifdef HAVE_SYS_INOTIFY_H
+    if ((len = read(watch->fd, buf, sizeof(buf))) <= 0) {
+      if (len < 0 && errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ev->len) {
+      ev = (const struct inotify_event *)p;
+      if (ev->len == 0) {
+        continue;
+      }
+      for (i = 0; i < watch->files_cnt; i++) {
+        if (watch->files[i].wd == ev->wd &&
+            strcmp(watch->files[i].name, ev->name) == 0) {
+          bgpstream_debug("\t\tBSDS_WATCH: %s changed", ev->name);
+          watch->files[i].changed = 1;
+          seen = 1;
+        }
+      }
+    }
+#endif
+  }
+  return 1;
+}
+
+void bgpstream_datasource_watch_interrupt(bgpstream_datasource_watch_t *watch)
+{
+  char c = 0;
+
+  /* only write once, so that the pipe can never fill up */
+  if (__atomic_exchange_n(&watch->interrupted, 1, __ATOMIC_RELAXED) == 0) {
+    if (write(watch->intr_fds[1], &c, 1) != 1) {
+      // nothing more we can do (the flag is still set)
+    }
+  }
+}
+
+int bgpstream_datasource_watch_interrupted(bgpstream_datasource_watch_t *watch)
+{
+  return __atomic_load_n(&watch->interrupted, __ATOMIC_RELAXED);
+}
+
+int bgpstream_datasource_watch_changed(bgpstream_datasource_watch_t *watch,
+                                       int id)
+{
+  int changed;
+
+  if (id < 0 || id >= watch->files_cnt) {
+    return 0;
+  }
+  changed = watch->files[id].changed;
+  watch->files[id].changed = 0;
+  return changed;
+}
+
+void bgpstream_datasource_watch_destroy(bgpstream_datasource_watch_t *watch)
+{
+  int i;
+
+  if (watch == NULL) {
+    return;
+  }
+  for (i = 0; i < watch->files_cnt; i++) {
+    free(watch->files[i].name);
+  }
+  if (watch->fd >= 0) {
+    close(watch->fd); // removes all watches
+  }
+  close(watch->intr_fds[0]);
+  close(watch->intr_fds[1]);
+  free(watch);
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BGPSTREAM_DATASOURCE_WATCH_H
+#define _BGPSTREAM_DATASOURCE_WATCH_H
+
+/** Opaque handle that represents a set of watched local files
+ *
+ * Used by data sources in live mode to sleep until one of the files they read
+ * is (re-)written, rather than polling on a fixed schedule. Where file
+ * notifications are not available (e.g. non-Linux systems, or remote paths)
+ * waiting simply times out.
+ *
+ * A wait can be cut short with bgpstream_datasource_watch_interrupt, so that a
+ * live stream can be shut down without waiting for the timeout.
+ */
+typedef struct struct_bgpstream_datasource_watch_t
+  bgpstream_datasource_watch_t;
+
+bgpstream_datasource_watch_t *bgpstream_datasource_watch_create();
+
+/* start watching the given file. returns an id to be passed to
+   bgpstream_datasource_watch_changed, or -1 if the file cannot be watched */
+int bgpstream_datasource_watch_add(bgpstream_datasource_watch_t *watch,
+                                   const char *path);
+
+/* block until a watched file changes, or timeout seconds elapse. returns 1 if
+   a change was seen, 0 on timeout (or if the watch has been interrupted) and
+   -1 on error. a watch with no files can be used as an interruptible sleep */
+int bgpstream_datasource_watch_wait(bgpstream_datasource_watch_t *watch,
+                                    int timeout);
+
+/* wake up the current (and make all future) calls to
+   bgpstream_datasource_watch_wait return immediately. may be called from
+   another thread or a signal handler */
+void bgpstream_datasource_watch_interrupt(bgpstream_datasource_watch_t *watch);
+
+/* check whether the watch has been interrupted */
+int bgpstream_datasource_watch_interrupted(bgpstream_datasource_watch_t *watch);
+
+/* check (and reset) whether the file with the given id has changed since the
+   last call */
+int bgpstream_datasource_watch_changed(bgpstream_datasource_watch_t *watch,
+                                       int id);
+
+void bgpstream_datasource_watch_destroy(bgpstream_datasource_watch_t *watch);
+
+#endif /* _BGPSTREAM_DATASOURCE_WATCH_H */
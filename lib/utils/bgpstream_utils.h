@@ -54,6 +54,7 @@
 #include "bgpstream_utils_peer_sig_map.h"  /*< Peer Signature utilities */
 #include "bgpstream_utils_pfx.h"           /*< Prefix utilities */
 #include "bgpstream_utils_pfx_set.h"       /*< Prefix Set utilities */
+#include "bgpstream_utils_str_id_map.h"    /*< String ID Map utilities */
 #include "bgpstream_utils_str_set.h"       /*< String Set utilities */
 #include "bgpstream_utils_time.h"          /*< Time management utilities */
 
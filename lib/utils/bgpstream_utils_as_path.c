@@ -482,6 +482,11 @@ uint16_t bgpstream_as_path_get_data(bgpstream_as_path_t *path, uint8_t **data)
   }
 }
 
+size_t bgpstream_as_path_get_mem_size(bgpstream_as_path_t *path)
+{
+  return sizeof(bgpstream_as_path_t) + path->data_alloc_len;
+}
+
 int bgpstream_as_path_populate_from_data(bgpstream_as_path_t *path,
                                          uint8_t *data, uint16_t data_len)
 {
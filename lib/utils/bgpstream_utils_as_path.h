@@ -339,6 +339,13 @@ int bgpstream_as_path_get_len(bgpstream_as_path_t *path);
  */
 uint16_t bgpstream_as_path_get_data(bgpstream_as_path_t *path, uint8_t **data);
 
+/** Get the number of bytes allocated for the AS Path
+ *
+ * @param path          pointer to the path to get the memory usage of
+ * @return the number of bytes used by the path
+ */
+size_t bgpstream_as_path_get_mem_size(bgpstream_as_path_t *path);
+
 /** Populate the given AS Path from the given byte array
  *
  * @param path          pointer to the path to populate
@@ -255,6 +255,12 @@ int bgpstream_community_set_size(bgpstream_community_set_t *set)
   return set->communities_cnt;
 }
 
+size_t bgpstream_community_set_get_mem_size(bgpstream_community_set_t *set)
+{
+  return sizeof(bgpstream_community_set_t) +
+         set->communities_alloc_cnt * sizeof(bgpstream_community_t);
+}
+
 int bgpstream_community_set_insert(bgpstream_community_set_t *set,
                                    bgpstream_community_t *comm)
 {
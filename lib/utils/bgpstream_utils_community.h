@@ -237,6 +237,13 @@ bgpstream_community_set_get(bgpstream_community_set_t *set, int i);
  */
 int bgpstream_community_set_size(bgpstream_community_set_t *set);
 
+/** Get the number of bytes allocated for the set
+ *
+ * @param set           pointer to the set to get the memory usage of
+ * @return the number of bytes used by the set
+ */
+size_t bgpstream_community_set_get_mem_size(bgpstream_community_set_t *set);
+
 /** Insert the given community into the community set
  *
  * @param set           pointer to the set to populate
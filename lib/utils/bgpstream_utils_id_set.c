@@ -23,6 +23,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "khash.h"
 #include "utils.h"
@@ -40,18 +41,83 @@ KHASH_INIT(bgpstream_id_set /* name */, uint32_t /* khkey_t */,
            kh_int_hash_func /*__hash_func */,
            kh_int_hash_equal /* __hash_equal */);
 
+/** Frozen sets at most this large are searched linearly (the loop has no
+    data-dependent branches, so the compiler can vectorize it) */
+#define SORTED_SCAN_MAX 32
+
 struct bgpstream_id_set {
   khiter_t k;
   khash_t(bgpstream_id_set) * hash;
+
+  /** Sorted copy of the ids in the hash, only valid if the set is frozen */
+  uint32_t *sorted;
+
+  /** Number of ids the sorted array has space for */
+  int sorted_alloc;
+
+  /** Is the sorted array up to date? */
+  int frozen;
 };
 
+/* PRIVATE FUNCTIONS */
+
+static int id_cmp(const void *a, const void *b)
+{
+  uint32_t ia = *(const uint32_t *)a;
+  uint32_t ib = *(const uint32_t *)b;
+  return (ia > ib) - (ia < ib);
+}
+
+static int sorted_exists(const uint32_t *ids, int cnt, uint32_t id)
+{
+  const uint32_t *base = ids;
+  int found = 0;
+  int half;
+  int i;
+
+  if (cnt <= SORTED_SCAN_MAX) {
+    for (i = 0; i < cnt; i++) {
+      found |= (ids[i] == id);
+    }
+    return found;
+  }
+
+  /* branch-free binary search */
+  while (cnt > 1) {
+    half = cnt / 2;
+    base = (base[half] <= id) ? base + half : base;
+    cnt -= half;
+  }
+  return *base == id;
+}
+
+static int sorted_intersection_size(const uint32_t *ids1, int cnt1,
+                                    const uint32_t *ids2, int cnt2)
+{
+  int i = 0, j = 0;
+  int cnt = 0;
+
+  while (i < cnt1 && j < cnt2) {
+    if (ids1[i] < ids2[j]) {
+      i++;
+    } else if (ids1[i] > ids2[j]) {
+      j++;
+    } else {
+      cnt++;
+      i++;
+      j++;
+    }
+  }
+  return cnt;
+}
+
 /* PUBLIC FUNCTIONS */
 
 bgpstream_id_set_t *bgpstream_id_set_create()
 {
   bgpstream_id_set_t *set;
 
-  if ((set = (bgpstream_id_set_t *)malloc(sizeof(bgpstream_id_set_t))) ==
+  if ((set = (bgpstream_id_set_t *)malloc_zero(sizeof(bgpstream_id_set_t))) ==
       NULL) {
     return NULL;
   }
@@ -69,16 +135,38 @@ int bgpstream_id_set_insert(bgpstream_id_set_t *set, uint32_t id)
   int khret;
   khiter_t k;
   if ((k = kh_get(bgpstream_id_set, set->hash, id)) == kh_end(set->hash)) {
-    /** @todo we should always check the return value from khash funcs */
     k = kh_put(bgpstream_id_set, set->hash, id, &khret);
+    if (khret < 0) {
+      return -1;
+    }
+    set->frozen = 0;
     return 1;
   }
   return 0;
 }
 
+int bgpstream_id_set_insert_bulk(bgpstream_id_set_t *set, const uint32_t *ids,
+                                 int ids_cnt)
+{
+  int inserted = 0;
+  int ret;
+  int i;
+
+  for (i = 0; i < ids_cnt; i++) {
+    if ((ret = bgpstream_id_set_insert(set, ids[i])) < 0) {
+      return -1;
+    }
+    inserted += ret;
+  }
+  return inserted;
+}
+
 int bgpstream_id_set_exists(bgpstream_id_set_t *set, uint32_t id)
 {
   khiter_t k;
+  if (set->frozen) {
+    return sorted_exists(set->sorted, kh_size(set->hash), id);
+  }
   if ((k = kh_get(bgpstream_id_set, set->hash, id)) == kh_end(set->hash)) {
     return 0;
   }
@@ -101,6 +189,87 @@ int bgpstream_id_set_merge(bgpstream_id_set_t *dst_set,
   return 0;
 }
 
+int bgpstream_id_set_intersect(bgpstream_id_set_t *dst_set,
+                               bgpstream_id_set_t *src_set)
+{
+  khiter_t k;
+  for (k = kh_begin(dst_set->hash); k != kh_end(dst_set->hash); ++k) {
+    if (kh_exist(dst_set->hash, k) &&
+        bgpstream_id_set_exists(src_set, kh_key(dst_set->hash, k)) == 0) {
+      kh_del(bgpstream_id_set, dst_set->hash, k);
+      dst_set->frozen = 0;
+    }
+  }
+  bgpstream_id_set_rewind(dst_set);
+  return 0;
+}
+
+int bgpstream_id_set_intersection_size(bgpstream_id_set_t *set1,
+                                       bgpstream_id_set_t *set2)
+{
+  bgpstream_id_set_t *tmp;
+  khiter_t k;
+  int cnt = 0;
+
+  if (set1->frozen && set2->frozen) {
+    return sorted_intersection_size(set1->sorted, kh_size(set1->hash),
+                                    set2->sorted, kh_size(set2->hash));
+  }
+
+  /* probe the larger set with the ids of the smaller one */
+  if (kh_size(set1->hash) > kh_size(set2->hash)) {
+    tmp = set1;
+    set1 = set2;
+    set2 = tmp;
+  }
+  for (k = kh_begin(set1->hash); k != kh_end(set1->hash); ++k) {
+    if (kh_exist(set1->hash, k)) {
+      cnt += bgpstream_id_set_exists(set2, kh_key(set1->hash, k));
+    }
+  }
+  return cnt;
+}
+
+int bgpstream_id_set_union_size(bgpstream_id_set_t *set1,
+                                bgpstream_id_set_t *set2)
+{
+  return kh_size(set1->hash) + kh_size(set2->hash) -
+         bgpstream_id_set_intersection_size(set1, set2);
+}
+
+int bgpstream_id_set_freeze(bgpstream_id_set_t *set)
+{
+  uint32_t *tmp;
+  khiter_t k;
+  int i = 0;
+
+  if (set->frozen) {
+    return 0;
+  }
+
+  if (set->sorted_alloc < (int)kh_size(set->hash)) {
+    if ((tmp = realloc(set->sorted, sizeof(uint32_t) * kh_size(set->hash))) ==
+        NULL) {
+      return -1;
+    }
+    set->sorted = tmp;
+    set->sorted_alloc = kh_size(set->hash);
+  }
+
+  for (k = kh_begin(set->hash); k != kh_end(set->hash); ++k) {
+    if (kh_exist(set->hash, k)) {
+      set->sorted[i++] = kh_key(set->hash, k);
+    }
+  }
+  assert(i == (int)kh_size(set->hash));
+  if (i > 0) {
+    qsort(set->sorted, i, sizeof(uint32_t), id_cmp);
+  }
+
+  set->frozen = 1;
+  return 0;
+}
+
 void bgpstream_id_set_rewind(bgpstream_id_set_t *set)
 {
   set->k = kh_begin(set->hash);
@@ -124,9 +293,18 @@ int bgpstream_id_set_size(bgpstream_id_set_t *set)
   return kh_size(set->hash);
 }
 
+size_t bgpstream_id_set_get_mem_size(bgpstream_id_set_t *set)
+{
+  return sizeof(bgpstream_id_set_t) + sizeof(*set->hash) +
+         kh_n_buckets(set->hash) * sizeof(uint32_t) +
+         __ac_fsize(kh_n_buckets(set->hash)) * sizeof(khint32_t) +
+         set->sorted_alloc * sizeof(uint32_t);
+}
+
 void bgpstream_id_set_destroy(bgpstream_id_set_t *set)
 {
   kh_destroy(bgpstream_id_set, set->hash);
+  free(set->sorted);
   free(set);
 }
 
@@ -134,4 +312,5 @@ void bgpstream_id_set_clear(bgpstream_id_set_t *set)
 {
   bgpstream_id_set_rewind(set);
   kh_clear(bgpstream_id_set, set->hash);
+  set->frozen = 0;
 }
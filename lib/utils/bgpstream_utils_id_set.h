@@ -24,6 +24,8 @@
 #ifndef __BGPSTREAM_UTILS_ID_SET_H
 #define __BGPSTREAM_UTILS_ID_SET_H
 
+#include <stddef.h>
+
 /** @file
  *
  * @brief Header file that exposes the public interface of the BGP Stream ID
@@ -63,6 +65,17 @@ bgpstream_id_set_t *bgpstream_id_set_create();
  */
 int bgpstream_id_set_insert(bgpstream_id_set_t *set, uint32_t id);
 
+/** Insert an array of IDs into the given set
+ *
+ * @param set           pointer to the id set
+ * @param ids           array of ids to insert in the set
+ * @param ids_cnt       number of ids in the array
+ * @return the number of ids that were not already in the set, -1 if an error
+ * occurred
+ */
+int bgpstream_id_set_insert_bulk(bgpstream_id_set_t *set, const uint32_t *ids,
+                                 int ids_cnt);
+
 /** Check whether an ID exists in the set
  *
  * @param set           pointer to the ID set
@@ -78,6 +91,13 @@ int bgpstream_id_set_exists(bgpstream_id_set_t *set, uint32_t id);
  */
 int bgpstream_id_set_size(bgpstream_id_set_t *set);
 
+/** Returns the number of bytes allocated for the set
+ *
+ * @param set           pointer to the id set
+ * @return the number of bytes used by the set
+ */
+size_t bgpstream_id_set_get_mem_size(bgpstream_id_set_t *set);
+
 /** Merge two ID sets
  *
  * @param dst_set      pointer to the set to merge src into
@@ -87,6 +107,50 @@ int bgpstream_id_set_size(bgpstream_id_set_t *set);
 int bgpstream_id_set_merge(bgpstream_id_set_t *dst_set,
                            bgpstream_id_set_t *src_set);
 
+/** Intersect two ID sets
+ *
+ * @param dst_set      pointer to the set to intersect with src (modified)
+ * @param src_set      pointer to the set to intersect with dst
+ * @return 0 if the sets were intersected succsessfully, -1 otherwise
+ *
+ * Only the IDs that are in both sets are kept in dst_set.
+ */
+int bgpstream_id_set_intersect(bgpstream_id_set_t *dst_set,
+                               bgpstream_id_set_t *src_set);
+
+/** Get the number of IDs that are in both of the given sets
+ *
+ * @param set1          pointer to the first id set
+ * @param set2          pointer to the second id set
+ * @return the size of the intersection of the two sets
+ *
+ * Neither set is modified. If both sets are frozen, the intersection is
+ * computed by merging their sorted arrays.
+ */
+int bgpstream_id_set_intersection_size(bgpstream_id_set_t *set1,
+                                       bgpstream_id_set_t *set2);
+
+/** Get the number of IDs that are in either of the given sets
+ *
+ * @param set1          pointer to the first id set
+ * @param set2          pointer to the second id set
+ * @return the size of the union of the two sets
+ */
+int bgpstream_id_set_union_size(bgpstream_id_set_t *set1,
+                                bgpstream_id_set_t *set2);
+
+/** Freeze the given ID set
+ *
+ * @param set           pointer to the id set
+ * @return 0 if the set was frozen successfully, -1 otherwise
+ *
+ * A frozen set keeps a sorted array of its IDs, which makes
+ * bgpstream_id_set_exists cheaper (and the bulk operations above merge-based)
+ * for sets that are built once and then queried many times. Any operation that
+ * changes the set thaws it; it may be frozen again afterwards.
+ */
+int bgpstream_id_set_freeze(bgpstream_id_set_t *set);
+
 /** Reset the internal iterator
  *
  * @param set           pointer to the id set
@@ -967,6 +967,24 @@ uint64_t bgpstream_patricia_prefix_count(bgpstream_patricia_tree_t *pt,
   return 0;
 }
 
+static size_t
+bgpstream_patricia_tree_count_nodes(bgpstream_patricia_node_t *node)
+{
+  if (node == NULL) {
+    return 0;
+  }
+  return 1 + bgpstream_patricia_tree_count_nodes(node->l) +
+         bgpstream_patricia_tree_count_nodes(node->r);
+}
+
+size_t bgpstream_patricia_tree_get_mem_size(bgpstream_patricia_tree_t *pt)
+{
+  return sizeof(bgpstream_patricia_tree_t) +
+         sizeof(bgpstream_patricia_node_t) *
+           (bgpstream_patricia_tree_count_nodes(pt->head4) +
+            bgpstream_patricia_tree_count_nodes(pt->head6));
+}
+
 uint64_t bgpstream_patricia_tree_count_24subnets(bgpstream_patricia_tree_t *pt)
 {
   return bgpstream_patricia_tree_count_subnets(pt->head4, 24);
@@ -234,6 +234,14 @@ bgpstream_patricia_tree_search_exact(bgpstream_patricia_tree_t *pt,
 uint64_t bgpstream_patricia_prefix_count(bgpstream_patricia_tree_t *pt,
                                          bgpstream_addr_version_t v);
 
+/** Get the number of bytes allocated for the Patricia Tree
+ *
+ * @param pt         pointer to the patricia tree
+ * @return the number of bytes used by the tree's nodes (including the glue
+ * nodes, but not including any user data)
+ */
+size_t bgpstream_patricia_tree_get_mem_size(bgpstream_patricia_tree_t *pt);
+
 /** Count the number of unique /24 IPv4 prefixes in the Patricia Tree
  *
  * @param pt           pointer to the patricia tree
@@ -22,7 +22,10 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "khash.h"
 #include "utils.h"
@@ -32,6 +35,15 @@
 #define IPV4_ID_OFFSET 1
 #define IPV6_ID_OFFSET 1
 
+/** Number of bits of a peer ID used to index into a page of the concurrent
+    map's ID index */
+#define CMAP_PAGE_BITS 8
+#define CMAP_PAGE_SIZE (1 << CMAP_PAGE_BITS)
+#define CMAP_PAGE_CNT ((UINT16_MAX >> CMAP_PAGE_BITS) + 1)
+
+/** Initial number of slots in the concurrent map's hash table */
+#define CMAP_INIT_SLOTS 256
+
 /** Hash a peer signature into a 64bit number
  *
  * @param               the peer signature to hash
@@ -82,6 +94,43 @@ struct bgpstream_peer_sig_map {
   bgpstream_peer_id_t v6_next_id;
 };
 
+/** Open-addressed hash table used by the concurrent map
+ *
+ * Each slot holds (tag << 16) | peer_id, where the tag is the top 16 bits of
+ * the peer signature hash, or 0 if the slot is empty (peer IDs are never 0).
+ * Slots are only ever written under the map lock, and go from empty to full
+ * exactly once, so readers can probe without locking.
+ */
+typedef struct cmap_table {
+
+  /** Number of slots - 1 (the number of slots is a power of two) */
+  uint32_t mask;
+
+  /** Table that this table replaced. Readers may still be probing it, so it is
+      kept until the map is destroyed. */
+  struct cmap_table *prev;
+
+  /** Slots */
+  uint32_t slots[];
+
+} cmap_table_t;
+
+/** Structure representing an instance of a Concurrent Peer Signature Map */
+struct bgpstream_peer_sig_cmap {
+
+  /** Current hash table (replaced, never modified in place, when it grows) */
+  cmap_table_t *table;
+
+  /** Two-level index from peer ID to signature */
+  bgpstream_peer_sig_t **pages[CMAP_PAGE_CNT];
+
+  /** Number of signatures in the map (i.e. the last ID allocated) */
+  uint32_t size;
+
+  /** Serializes insertions */
+  pthread_mutex_t lock;
+};
+
 /* PRIVATE FUNCTIONS (static) */
 
 static void sig_free(bgpstream_peer_sig_t *sig)
@@ -89,6 +138,126 @@ static void sig_free(bgpstream_peer_sig_t *sig)
   free(sig);
 }
 
+static uint64_t mix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* hash a collector name and peer address so that the same address seen by
+   different collectors (and v6 peers that share a /64) do not collide */
+static uint64_t peer_sig_hash_parts(const char *collector_str,
+                                    bgpstream_ip_addr_t *addr)
+{
+  const unsigned char *c;
+  uint64_t h = 0xcbf29ce484222325ULL; /* FNV-1a */
+  uint64_t v6[2];
+
+  for (c = (const unsigned char *)collector_str; *c != '\0'; c++) {
+    h ^= *c;
+    h *= 0x100000001b3ULL;
+  }
+
+  switch (addr->version) {
+  case BGPSTREAM_ADDR_VERSION_IPV4:
+    h = mix64(h ^ ((bgpstream_ipv4_addr_t *)addr)->ipv4.s_addr);
+    break;
+  case BGPSTREAM_ADDR_VERSION_IPV6:
+    memcpy(v6, ((bgpstream_ipv6_addr_t *)addr)->ipv6.s6_addr, sizeof(v6));
+    h = mix64(mix64(h ^ v6[0]) ^ v6[1]);
+    break;
+  default:
+    h = mix64(h);
+    break;
+  }
+  return h;
+}
+
+static int peer_sig_match(bgpstream_peer_sig_t *ps, const char *collector_str,
+                          bgpstream_ip_addr_t *addr)
+{
+  return ps != NULL &&
+         bgpstream_addr_equal((bgpstream_ip_addr_t *)&ps->peer_ip_addr, addr) &&
+         strcmp(ps->collector_str, collector_str) == 0;
+}
+
+static bgpstream_peer_sig_t *cmap_sig(bgpstream_peer_sig_cmap_t *map,
+                                      bgpstream_peer_id_t id)
+{
+  bgpstream_peer_sig_t **page =
+    __atomic_load_n(&map->pages[id >> CMAP_PAGE_BITS], __ATOMIC_ACQUIRE);
+  if (page == NULL) {
+    return NULL;
+  }
+  return __atomic_load_n(&page[id & (CMAP_PAGE_SIZE - 1)], __ATOMIC_ACQUIRE);
+}
+
+static bgpstream_peer_id_t cmap_lookup(bgpstream_peer_sig_cmap_t *map,
+                                       cmap_table_t *t, uint64_t h,
+                                       const char *collector_str,
+                                       bgpstream_ip_addr_t *addr)
+{
+  uint32_t tag = h >> 48;
+  uint32_t i = h & t->mask;
+  uint32_t s;
+
+  /* the table is never more than half full, so there is always an empty slot
+     to stop at */
+  while ((s = __atomic_load_n(&t->slots[i], __ATOMIC_ACQUIRE)) != 0) {
+    if ((s >> 16) == tag &&
+        peer_sig_match(cmap_sig(map, s & 0xffff), collector_str, addr)) {
+      return s & 0xffff;
+    }
+    i = (i + 1) & t->mask;
+  }
+  return 0;
+}
+
+/* must be called with the lock held */
+static void cmap_table_add(cmap_table_t *t, uint64_t h, bgpstream_peer_id_t id)
+{
+  uint32_t i = h & t->mask;
+  while (t->slots[i] != 0) {
+    i = (i + 1) & t->mask;
+  }
+  __atomic_store_n(&t->slots[i], (uint32_t)((h >> 48) << 16) | id,
+                   __ATOMIC_RELEASE);
+}
+
+/* must be called with the lock held */
+static int cmap_grow(bgpstream_peer_sig_cmap_t *map)
+{
+  cmap_table_t *old = map->table;
+  cmap_table_t *t;
+  uint32_t slot_cnt = (old == NULL) ? CMAP_INIT_SLOTS : (old->mask + 1) * 2;
+  bgpstream_peer_sig_t *ps;
+  uint64_t h;
+  uint32_t id;
+
+  if ((t = malloc_zero(sizeof(cmap_table_t) + sizeof(uint32_t) * slot_cnt)) ==
+      NULL) {
+    return -1;
+  }
+  t->mask = slot_cnt - 1;
+  t->prev = old;
+
+  for (id = 1; id <= map->size; id++) {
+    ps = cmap_sig(map, id);
+    h = peer_sig_hash_parts(ps->collector_str,
+                            (bgpstream_ip_addr_t *)&ps->peer_ip_addr);
+    cmap_table_add(t, h, id);
+  }
+
+  /* readers that already hold the old table will miss peers added from now
+     on, but they will find them when they retry under the lock */
+  __atomic_store_n(&map->table, t, __ATOMIC_RELEASE);
+  return 0;
+}
+
 static bgpstream_peer_id_t
 bgpstream_peer_sig_map_set_and_get_ps(bgpstream_peer_sig_map_t *map,
                                       bgpstream_peer_sig_t *ps)
@@ -131,10 +300,9 @@ bgpstream_peer_sig_map_set_and_get_ps(bgpstream_peer_sig_map_t *map,
 
 khint64_t bgpstream_peer_sig_hash(bgpstream_peer_sig_t *ps)
 {
-  /* assuming that the number of peers that have the same ip and belong to two
-   * different collectors is low (in this specific case there will be a
-   * collision in terms of hash). */
-  return bgpstream_addr_storage_hash(&ps->peer_ip_addr);
+  /* khash only uses the low 32 bits, so the hash must be well mixed */
+  return peer_sig_hash_parts(ps->collector_str,
+                             (bgpstream_ip_addr_t *)&ps->peer_ip_addr);
 }
 
 /** @note we do not need to take into account the peer AS number
@@ -250,3 +418,134 @@ void bgpstream_peer_sig_map_clear(bgpstream_peer_sig_map_t *map)
   kh_clear(bgpstream_peer_id_sig_map, map->id_ps);
   kh_clear(bgpstream_peer_sig_id_map, map->ps_id);
 }
+
+bgpstream_peer_sig_cmap_t *bgpstream_peer_sig_cmap_create()
+{
+  bgpstream_peer_sig_cmap_t *map = NULL;
+  if ((map = (bgpstream_peer_sig_cmap_t *)malloc_zero(
+         sizeof(bgpstream_peer_sig_cmap_t))) == NULL) {
+    return NULL;
+  }
+
+  if (pthread_mutex_init(&map->lock, NULL) != 0) {
+    free(map);
+    return NULL;
+  }
+
+  if (cmap_grow(map) != 0) {
+    goto err;
+  }
+
+  return map;
+
+err:
+  bgpstream_peer_sig_cmap_destroy(map);
+  return NULL;
+}
+
+bgpstream_peer_id_t bgpstream_peer_sig_cmap_get_id(
+  bgpstream_peer_sig_cmap_t *map, const char *collector_str,
+  bgpstream_ip_addr_t *peer_ip_addr, uint32_t peer_asnumber)
+{
+  uint64_t h = peer_sig_hash_parts(collector_str, peer_ip_addr);
+  bgpstream_peer_id_t id;
+  bgpstream_peer_sig_t *ps;
+  bgpstream_peer_sig_t **page;
+
+  /* fast path: lock-free lookup */
+  if ((id = cmap_lookup(map, __atomic_load_n(&map->table, __ATOMIC_ACQUIRE),
+                        h, collector_str, peer_ip_addr)) != 0) {
+    return id;
+  }
+
+  /* slow path: another thread may have added this peer since we looked, or
+     the table may have grown under us, so look again with the lock held */
+  pthread_mutex_lock(&map->lock);
+
+  if ((id = cmap_lookup(map, map->table, h, collector_str, peer_ip_addr)) !=
+      0) {
+    goto done;
+  }
+
+  if (map->size == UINT16_MAX ||
+      strlen(collector_str) >= BGPSTREAM_UTILS_STR_NAME_LEN ||
+      (peer_ip_addr->version != BGPSTREAM_ADDR_VERSION_IPV4 &&
+       peer_ip_addr->version != BGPSTREAM_ADDR_VERSION_IPV6)) {
+    goto done;
+  }
+
+  if ((map->size + 1) * 2 > map->table->mask + 1 && cmap_grow(map) != 0) {
+    goto done;
+  }
+
+  if ((ps = malloc_zero(sizeof(bgpstream_peer_sig_t))) == NULL) {
+    goto done;
+  }
+  strcpy(ps->collector_str, collector_str);
+  bgpstream_addr_copy((bgpstream_ip_addr_t *)&ps->peer_ip_addr, peer_ip_addr);
+  ps->peer_asnumber = peer_asnumber;
+
+  id = map->size + 1;
+  if ((page = map->pages[id >> CMAP_PAGE_BITS]) == NULL) {
+    if ((page = malloc_zero(sizeof(bgpstream_peer_sig_t *) * CMAP_PAGE_SIZE)) ==
+        NULL) {
+      free(ps);
+      id = 0;
+      goto done;
+    }
+    __atomic_store_n(&map->pages[id >> CMAP_PAGE_BITS], page,
+                     __ATOMIC_RELEASE);
+  }
+
+  /* publish the signature before the slot that refers to it */
+  __atomic_store_n(&page[id & (CMAP_PAGE_SIZE - 1)], ps, __ATOMIC_RELEASE);
+  __atomic_store_n(&map->size, (uint32_t)id, __ATOMIC_RELEASE);
+  cmap_table_add(map->table, h, id);
+
+done:
+  pthread_mutex_unlock(&map->lock);
+  return id;
+}
+
+bgpstream_peer_sig_t *
+bgpstream_peer_sig_cmap_get_sig(bgpstream_peer_sig_cmap_t *map,
+                                bgpstream_peer_id_t peer_id)
+{
+  if (peer_id == 0) {
+    return NULL;
+  }
+  return cmap_sig(map, peer_id);
+}
+
+int bgpstream_peer_sig_cmap_get_size(bgpstream_peer_sig_cmap_t *map)
+{
+  return __atomic_load_n(&map->size, __ATOMIC_ACQUIRE);
+}
+
+void bgpstream_peer_sig_cmap_destroy(bgpstream_peer_sig_cmap_t *map)
+{
+  cmap_table_t *t;
+  int i, j;
+
+  if (map == NULL) {
+    return;
+  }
+
+  while ((t = map->table) != NULL) {
+    map->table = t->prev;
+    free(t);
+  }
+
+  for (i = 0; i < CMAP_PAGE_CNT; i++) {
+    if (map->pages[i] == NULL) {
+      continue;
+    }
+    for (j = 0; j < CMAP_PAGE_SIZE; j++) {
+      sig_free(map->pages[i][j]);
+    }
+    free(map->pages[i]);
+  }
+
+  pthread_mutex_destroy(&map->lock);
+  free(map);
+}
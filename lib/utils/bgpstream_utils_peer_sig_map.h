@@ -47,6 +47,9 @@ typedef uint16_t bgpstream_peer_id_t;
 /** Opaque structure containing a peer signature map instance */
 typedef struct bgpstream_peer_sig_map bgpstream_peer_sig_map_t;
 
+/** Opaque structure containing a concurrent peer signature map instance */
+typedef struct bgpstream_peer_sig_cmap bgpstream_peer_sig_cmap_t;
+
 /** @} */
 
 /**
@@ -126,4 +129,67 @@ void bgpstream_peer_sig_map_clear(bgpstream_peer_sig_map_t *map);
 
 /** @} */
 
+/**
+ * @name Concurrent Peer Signature Map API Functions
+ *
+ * The concurrent map hands out the same peer IDs to any number of threads
+ * sharing it. Lookups of peers that are already in the map are lock-free, only
+ * the first sighting of a peer takes a lock. IDs are allocated sequentially
+ * starting from 1, and signatures are never moved or freed until the map is
+ * destroyed, so the pointers returned by bgpstream_peer_sig_cmap_get_sig remain
+ * valid for the lifetime of the map.
+ *
+ * @{ */
+
+/** Create a new concurrent peer signature map
+ *
+ * @return a pointer to the created map if successful, NULL otherwise.
+ */
+bgpstream_peer_sig_cmap_t *bgpstream_peer_sig_cmap_create();
+
+/** Get (or set and get) the peer ID for the given peer signature
+ *
+ * @param map            pointer to the concurrent peer sig map to query
+ * @param collector_str  string name of the collector
+ * @param peer_ip_addr   pointer to the IP address of the peer
+ * @param peer_asnumber  AS number of the peer
+ * @return the peer ID for this peer signature, 0 if an error occurred (or if
+ * all peer IDs are in use)
+ *
+ * This function may be called concurrently from multiple threads.
+ */
+bgpstream_peer_id_t bgpstream_peer_sig_cmap_get_id(
+  bgpstream_peer_sig_cmap_t *map, const char *collector_str,
+  bgpstream_ip_addr_t *peer_ip_addr, uint32_t peer_asnumber);
+
+/** Get the peer signature for the given peer ID
+ *
+ * @param map           pointer to the concurrent peer sig map to query
+ * @param peer_id       peer ID to retrieve signature for
+ * @return pointer to the peer signature for the given peer ID, NULL if it was
+ * not found
+ *
+ * This function may be called concurrently from multiple threads.
+ */
+bgpstream_peer_sig_t *
+bgpstream_peer_sig_cmap_get_sig(bgpstream_peer_sig_cmap_t *map,
+                                bgpstream_peer_id_t peer_id);
+
+/** Get the number of peer signatures in the given concurrent map
+ *
+ * @param map           pointer to the concurrent peer sig map
+ * @return the number of peer signatures in the given map
+ */
+int bgpstream_peer_sig_cmap_get_size(bgpstream_peer_sig_cmap_t *map);
+
+/** Destroy the given concurrent peer signature map
+ *
+ * @param map           pointer to the concurrent peer sig map to destroy
+ *
+ * @note no other thread may be using the map when it is destroyed
+ */
+void bgpstream_peer_sig_cmap_destroy(bgpstream_peer_sig_cmap_t *map);
+
+/** @} */
+
 #endif /* __BGPSTREAM_UTILS_PEER_SIG_MAP_H */
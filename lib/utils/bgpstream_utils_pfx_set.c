@@ -23,35 +23,68 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "khash.h"
 #include "utils.h"
 
 #include "bgpstream_utils_pfx_set.h"
 
-/** set of unique IP prefixes
- *  this structure maintains a set of unique
- *  prefixes (ipv4 and ipv6 prefixes, both hashed
- *  using a int64 type)
- */
-KHASH_INIT(bgpstream_pfx_storage_set /* name */,
-           bgpstream_pfx_storage_t /* khkey_t */, char /* khval_t */,
-           0 /* kh_is_set */, bgpstream_pfx_storage_hash_val /*__hash_func */,
-           bgpstream_pfx_storage_equal_val /* __hash_equal */);
+/* Prefixes are stored as packed, fixed-width keys (rather than as
+   bgpstream_pfx_storage_t structures) so that hashing and comparing them does
+   not need to look at the address version. The storage set is simply a pair of
+   version-specific sets. */
 
-struct bgpstream_pfx_storage_set {
-  khash_t(bgpstream_pfx_storage_set) * hash;
-  uint64_t ipv4_size;
-  uint64_t ipv6_size;
-};
+/** IPv4 prefix packed into 64 bits: (address << 8) | mask length */
+typedef uint64_t packed_ipv4_pfx_t;
+
+/** IPv6 prefix packed into two 64 bit words and a mask length */
+typedef struct packed_ipv6_pfx {
+  uint64_t addr[2];
+  uint8_t mask_len;
+} packed_ipv6_pfx_t;
+
+static inline uint64_t mix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static inline packed_ipv4_pfx_t pack_ipv4_pfx(bgpstream_ipv4_pfx_t *pfx)
+{
+  return ((uint64_t)pfx->address.ipv4.s_addr << 8) | pfx->mask_len;
+}
+
+static inline packed_ipv6_pfx_t pack_ipv6_pfx(bgpstream_ipv6_pfx_t *pfx)
+{
+  packed_ipv6_pfx_t k;
+  memcpy(k.addr, pfx->address.ipv6.s6_addr, sizeof(k.addr));
+  k.mask_len = pfx->mask_len;
+  return k;
+}
+
+#define packed_ipv4_pfx_hash(k) ((khint32_t)mix64(k))
+
+#define packed_ipv4_pfx_equal(a, b) ((a) == (b))
+
+#define packed_ipv6_pfx_hash(k)                                                \
+  ((khint32_t)mix64((k).addr[0] ^ mix64((k).addr[1] ^ (k).mask_len)))
+
+/* branch-free: compiles to a pair of wide compares */
+#define packed_ipv6_pfx_equal(a, b)                                            \
+  ((((a).addr[0] ^ (b).addr[0]) | ((a).addr[1] ^ (b).addr[1]) |                \
+    (uint64_t)((a).mask_len ^ (b).mask_len)) == 0)
 
 /* ipv4 specific set */
 
-KHASH_INIT(bgpstream_ipv4_pfx_set /* name */,
-           bgpstream_ipv4_pfx_t /* khkey_t */, char /* khval_t */,
-           0 /* kh_is_set */,
-           bgpstream_ipv4_pfx_storage_hash_val /*__hash_func */,
-           bgpstream_ipv4_pfx_storage_equal_val /* __hash_equal */);
+KHASH_INIT(bgpstream_ipv4_pfx_set /* name */, packed_ipv4_pfx_t /* khkey_t */,
+           char /* khval_t */, 0 /* kh_is_set */,
+           packed_ipv4_pfx_hash /*__hash_func */,
+           packed_ipv4_pfx_equal /* __hash_equal */);
 
 struct bgpstream_ipv4_pfx_set {
   khash_t(bgpstream_ipv4_pfx_set) * hash;
@@ -59,68 +92,71 @@ struct bgpstream_ipv4_pfx_set {
 
 /* ipv6 specific set */
 
-KHASH_INIT(bgpstream_ipv6_pfx_set /* name */,
-           bgpstream_ipv6_pfx_t /* khkey_t */, char /* khval_t */,
-           0 /* kh_is_set */,
-           bgpstream_ipv6_pfx_storage_hash_val /*__hash_func */,
-           bgpstream_ipv6_pfx_storage_equal_val /* __hash_equal */);
+KHASH_INIT(bgpstream_ipv6_pfx_set /* name */, packed_ipv6_pfx_t /* khkey_t */,
+           char /* khval_t */, 0 /* kh_is_set */,
+           packed_ipv6_pfx_hash /*__hash_func */,
+           packed_ipv6_pfx_equal /* __hash_equal */);
 
 struct bgpstream_ipv6_pfx_set {
   khash_t(bgpstream_ipv6_pfx_set) * hash;
 };
 
+/* storage set */
+
+struct bgpstream_pfx_storage_set {
+  bgpstream_ipv4_pfx_set_t *v4;
+  bgpstream_ipv6_pfx_set_t *v6;
+};
+
 /* STORAGE */
 
 bgpstream_pfx_storage_set_t *bgpstream_pfx_storage_set_create()
 {
   bgpstream_pfx_storage_set_t *set;
 
-  if ((set = (bgpstream_pfx_storage_set_t *)malloc(
+  if ((set = (bgpstream_pfx_storage_set_t *)malloc_zero(
          sizeof(bgpstream_pfx_storage_set_t))) == NULL) {
     return NULL;
   }
 
-  if ((set->hash = kh_init(bgpstream_pfx_storage_set)) == NULL) {
+  if ((set->v4 = bgpstream_ipv4_pfx_set_create()) == NULL ||
+      (set->v6 = bgpstream_ipv6_pfx_set_create()) == NULL) {
     bgpstream_pfx_storage_set_destroy(set);
     return NULL;
   }
-  set->ipv4_size = 0;
-  set->ipv6_size = 0;
   return set;
 }
 
 int bgpstream_pfx_storage_set_insert(bgpstream_pfx_storage_set_t *set,
                                      bgpstream_pfx_storage_t *pfx)
 {
-  int khret;
-  khiter_t k;
-  if ((k = kh_get(bgpstream_pfx_storage_set, set->hash, *pfx)) ==
-      kh_end(set->hash)) {
-    k = kh_put(bgpstream_pfx_storage_set, set->hash, *pfx, &khret);
-    if (pfx->address.version == BGPSTREAM_ADDR_VERSION_IPV4) {
-      set->ipv4_size++;
-    } else {
-      set->ipv6_size++;
-    }
-    return 1;
+  switch (pfx->address.version) {
+  case BGPSTREAM_ADDR_VERSION_IPV4:
+    return bgpstream_ipv4_pfx_set_insert(set->v4, (bgpstream_ipv4_pfx_t *)pfx);
+  case BGPSTREAM_ADDR_VERSION_IPV6:
+    return bgpstream_ipv6_pfx_set_insert(set->v6, (bgpstream_ipv6_pfx_t *)pfx);
+  default:
+    return -1;
   }
-  return 0;
 }
 
 int bgpstream_pfx_storage_set_exists(bgpstream_pfx_storage_set_t *set,
                                      bgpstream_pfx_storage_t *pfx)
 {
-  khiter_t k;
-  if ((k = kh_get(bgpstream_pfx_storage_set, set->hash, *pfx)) ==
-      kh_end(set->hash)) {
+  switch (pfx->address.version) {
+  case BGPSTREAM_ADDR_VERSION_IPV4:
+    return bgpstream_ipv4_pfx_set_exists(set->v4, (bgpstream_ipv4_pfx_t *)pfx);
+  case BGPSTREAM_ADDR_VERSION_IPV6:
+    return bgpstream_ipv6_pfx_set_exists(set->v6, (bgpstream_ipv6_pfx_t *)pfx);
+  default:
     return 0;
   }
-  return 1;
 }
 
 int bgpstream_pfx_storage_set_size(bgpstream_pfx_storage_set_t *set)
 {
-  return kh_size(set->hash);
+  return bgpstream_ipv4_pfx_set_size(set->v4) +
+         bgpstream_ipv6_pfx_set_size(set->v6);
 }
 
 int bgpstream_pfx_storage_set_version_size(bgpstream_pfx_storage_set_t *set,
@@ -128,9 +164,9 @@ int bgpstream_pfx_storage_set_version_size(bgpstream_pfx_storage_set_t *set,
 {
   switch (v) {
   case BGPSTREAM_ADDR_VERSION_IPV4:
-    return set->ipv4_size;
+    return bgpstream_ipv4_pfx_set_size(set->v4);
   case BGPSTREAM_ADDR_VERSION_IPV6:
-    return set->ipv6_size;
+    return bgpstream_ipv6_pfx_set_size(set->v6);
   default:
     return -1;
   }
@@ -139,29 +175,28 @@ int bgpstream_pfx_storage_set_version_size(bgpstream_pfx_storage_set_t *set,
 int bgpstream_pfx_storage_set_merge(bgpstream_pfx_storage_set_t *dst_set,
                                     bgpstream_pfx_storage_set_t *src_set)
 {
-  khiter_t k;
-  for (k = kh_begin(src_set->hash); k != kh_end(src_set->hash); ++k) {
-    if (kh_exist(src_set->hash, k)) {
-      if (bgpstream_pfx_storage_set_insert(dst_set,
-                                           &(kh_key(src_set->hash, k))) < 0) {
-        return -1;
-      }
-    }
+  if (bgpstream_ipv4_pfx_set_merge(dst_set->v4, src_set->v4) != 0 ||
+      bgpstream_ipv6_pfx_set_merge(dst_set->v6, src_set->v6) != 0) {
+    return -1;
   }
   return 0;
 }
 
 void bgpstream_pfx_storage_set_destroy(bgpstream_pfx_storage_set_t *set)
 {
-  kh_destroy(bgpstream_pfx_storage_set, set->hash);
+  if (set->v4 != NULL) {
+    bgpstream_ipv4_pfx_set_destroy(set->v4);
+  }
+  if (set->v6 != NULL) {
+    bgpstream_ipv6_pfx_set_destroy(set->v6);
+  }
   free(set);
 }
 
 void bgpstream_pfx_storage_set_clear(bgpstream_pfx_storage_set_t *set)
 {
-  kh_clear(bgpstream_pfx_storage_set, set->hash);
-  set->ipv4_size = 0;
-  set->ipv6_size = 0;
+  bgpstream_ipv4_pfx_set_clear(set->v4);
+  bgpstream_ipv6_pfx_set_clear(set->v6);
 }
 
 /* IPv4 */
@@ -188,9 +223,13 @@ int bgpstream_ipv4_pfx_set_insert(bgpstream_ipv4_pfx_set_t *set,
 {
   int khret;
   khiter_t k;
-  if ((k = kh_get(bgpstream_ipv4_pfx_set, set->hash, *pfx)) ==
+  packed_ipv4_pfx_t key = pack_ipv4_pfx(pfx);
+  if ((k = kh_get(bgpstream_ipv4_pfx_set, set->hash, key)) ==
       kh_end(set->hash)) {
-    k = kh_put(bgpstream_ipv4_pfx_set, set->hash, *pfx, &khret);
+    k = kh_put(bgpstream_ipv4_pfx_set, set->hash, key, &khret);
+    if (khret < 0) {
+      return -1;
+    }
     return 1;
   }
   return 0;
@@ -200,7 +239,7 @@ int bgpstream_ipv4_pfx_set_exists(bgpstream_ipv4_pfx_set_t *set,
                                   bgpstream_ipv4_pfx_t *pfx)
 {
   khiter_t k;
-  if ((k = kh_get(bgpstream_ipv4_pfx_set, set->hash, *pfx)) ==
+  if ((k = kh_get(bgpstream_ipv4_pfx_set, set->hash, pack_ipv4_pfx(pfx))) ==
       kh_end(set->hash)) {
     return 0;
   }
@@ -215,11 +254,13 @@ int bgpstream_ipv4_pfx_set_size(bgpstream_ipv4_pfx_set_t *set)
 int bgpstream_ipv4_pfx_set_merge(bgpstream_ipv4_pfx_set_t *dst_set,
                                  bgpstream_ipv4_pfx_set_t *src_set)
 {
+  int khret;
   khiter_t k;
   for (k = kh_begin(src_set->hash); k != kh_end(src_set->hash); ++k) {
     if (kh_exist(src_set->hash, k)) {
-      if (bgpstream_ipv4_pfx_set_insert(dst_set, &(kh_key(src_set->hash, k))) <
-          0) {
+      kh_put(bgpstream_ipv4_pfx_set, dst_set->hash, kh_key(src_set->hash, k),
+             &khret);
+      if (khret < 0) {
         return -1;
       }
     }
@@ -262,9 +303,13 @@ int bgpstream_ipv6_pfx_set_insert(bgpstream_ipv6_pfx_set_t *set,
 {
   int khret;
   khiter_t k;
-  if ((k = kh_get(bgpstream_ipv6_pfx_set, set->hash, *pfx)) ==
+  packed_ipv6_pfx_t key = pack_ipv6_pfx(pfx);
+  if ((k = kh_get(bgpstream_ipv6_pfx_set, set->hash, key)) ==
       kh_end(set->hash)) {
-    k = kh_put(bgpstream_ipv6_pfx_set, set->hash, *pfx, &khret);
+    k = kh_put(bgpstream_ipv6_pfx_set, set->hash, key, &khret);
+    if (khret < 0) {
+      return -1;
+    }
     return 1;
   }
   return 0;
@@ -274,7 +319,7 @@ int bgpstream_ipv6_pfx_set_exists(bgpstream_ipv6_pfx_set_t *set,
                                   bgpstream_ipv6_pfx_t *pfx)
 {
   khiter_t k;
-  if ((k = kh_get(bgpstream_ipv6_pfx_set, set->hash, *pfx)) ==
+  if ((k = kh_get(bgpstream_ipv6_pfx_set, set->hash, pack_ipv6_pfx(pfx))) ==
       kh_end(set->hash)) {
     return 0;
   }
@@ -289,11 +334,13 @@ int bgpstream_ipv6_pfx_set_size(bgpstream_ipv6_pfx_set_t *set)
 int bgpstream_ipv6_pfx_set_merge(bgpstream_ipv6_pfx_set_t *dst_set,
                                  bgpstream_ipv6_pfx_set_t *src_set)
 {
+  int khret;
   khiter_t k;
   for (k = kh_begin(src_set->hash); k != kh_end(src_set->hash); ++k) {
     if (kh_exist(src_set->hash, k)) {
-      if (bgpstream_ipv6_pfx_set_insert(dst_set, &(kh_key(src_set->hash, k))) <
-          0) {
+      kh_put(bgpstream_ipv6_pfx_set, dst_set->hash, kh_key(src_set->hash, k),
+             &khret);
+      if (khret < 0) {
         return -1;
       }
     }
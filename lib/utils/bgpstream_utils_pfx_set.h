@@ -71,6 +71,9 @@ bgpstream_pfx_storage_set_t *bgpstream_pfx_storage_set_create();
  * @param pfx          prefix to insert in the set
  * @return 1 if the prefix was inserted, 0 if it already existed, -1 if an
  * error occurred
+ *
+ * Only IPv4 and IPv6 prefixes can be stored, inserting a prefix with any other
+ * address version (e.g. an unset prefix) is an error.
  */
 int bgpstream_pfx_storage_set_insert(bgpstream_pfx_storage_set_t *set,
                                      bgpstream_pfx_storage_t *pfx);
@@ -0,0 +1,142 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "khash.h"
+#include "utils.h"
+
+#include "bgpstream_utils_str_id_map.h"
+
+/* PRIVATE */
+
+KHASH_INIT(bgpstream_str_id_map, char *, bgpstream_str_id_t, 1,
+           kh_str_hash_func, kh_str_hash_equal);
+
+struct bgpstream_str_id_map {
+  /** Map from string to ID (owns the strings) */
+  khash_t(bgpstream_str_id_map) * hash;
+
+  /** Strings indexed by ID (borrowed from the hash) */
+  char **strs;
+
+  /** Number of strings (i.e. the last ID allocated) */
+  int strs_cnt;
+
+  /** Number of elements allocated in strs */
+  int strs_alloc;
+};
+
+/* PUBLIC FUNCTIONS */
+
+bgpstream_str_id_map_t *bgpstream_str_id_map_create()
+{
+  bgpstream_str_id_map_t *map;
+
+  if ((map = (bgpstream_str_id_map_t *)malloc_zero(
+         sizeof(bgpstream_str_id_map_t))) == NULL) {
+    return NULL;
+  }
+
+  if ((map->hash = kh_init(bgpstream_str_id_map)) == NULL) {
+    bgpstream_str_id_map_destroy(map);
+    return NULL;
+  }
+
+  return map;
+}
+
+bgpstream_str_id_t bgpstream_str_id_map_get_id(bgpstream_str_id_map_t *map,
+                                               const char *str)
+{
+  int khret;
+  khiter_t k;
+  char *cpy;
+  char **tmp;
+
+  if ((k = kh_get(bgpstream_str_id_map, map->hash, (char *)str)) !=
+      kh_end(map->hash)) {
+    return kh_value(map->hash, k);
+  }
+
+  if (map->strs_cnt == UINT16_MAX) {
+    return 0;
+  }
+
+  /* slot 0 is never used */
+  if (map->strs_cnt + 2 > map->strs_alloc) {
+    if ((tmp = realloc(map->strs, sizeof(char *) * (map->strs_alloc + 16))) ==
+        NULL) {
+      return 0;
+    }
+    map->strs = tmp;
+    map->strs_alloc += 16;
+  }
+
+  if ((cpy = strdup(str)) == NULL) {
+    return 0;
+  }
+  k = kh_put(bgpstream_str_id_map, map->hash, cpy, &khret);
+  if (khret < 0) {
+    free(cpy);
+    return 0;
+  }
+
+  map->strs_cnt++;
+  map->strs[0] = NULL;
+  map->strs[map->strs_cnt] = cpy;
+  kh_value(map->hash, k) = map->strs_cnt;
+  return map->strs_cnt;
+}
+
+const char *bgpstream_str_id_map_get_str(bgpstream_str_id_map_t *map,
+                                         bgpstream_str_id_t id)
+{
+  if (id == 0 || id > map->strs_cnt) {
+    return NULL;
+  }
+  return map->strs[id];
+}
+
+int bgpstream_str_id_map_size(bgpstream_str_id_map_t *map)
+{
+  return map->strs_cnt;
+}
+
+void bgpstream_str_id_map_destroy(bgpstream_str_id_map_t *map)
+{
+  int i;
+
+  if (map == NULL) {
+    return;
+  }
+  for (i = 1; i <= map->strs_cnt; i++) {
+    free(map->strs[i]);
+  }
+  free(map->strs);
+  kh_destroy(bgpstream_str_id_map, map->hash);
+  free(map);
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPSTREAM_UTILS_STR_ID_MAP_H
+#define __BGPSTREAM_UTILS_STR_ID_MAP_H
+
+#include <stdint.h>
+
+/** @file
+ *
+ * @brief Header file that exposes the public interface of the BGP Stream String
+ * ID Map.
+ *
+ * A string ID map interns strings (e.g. project or collector names), giving
+ * each distinct string a small integer ID. IDs are allocated sequentially
+ * starting from 1 (0 is never a valid ID), so they can be used to index into
+ * arrays.
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Opaque Data Structures
+ *
+ * @{ */
+
+/** Type of a string ID */
+typedef uint16_t bgpstream_str_id_t;
+
+/** Opaque structure containing a string ID map instance */
+typedef struct bgpstream_str_id_map bgpstream_str_id_map_t;
+
+/** @} */
+
+/**
+ * @name Public API Functions
+ *
+ * @{ */
+
+/** Create a new string ID map instance
+ *
+ * @return a pointer to the structure, or NULL if an error occurred
+ */
+bgpstream_str_id_map_t *bgpstream_str_id_map_create();
+
+/** Get (or allocate and get) the ID of the given string
+ *
+ * @param map           pointer to the string ID map
+ * @param str           the string to look up
+ * @return the ID of the string, 0 if an error occurred (or if all IDs are in
+ * use)
+ *
+ * The map takes a copy of the string if it is not already in the map.
+ */
+bgpstream_str_id_t bgpstream_str_id_map_get_id(bgpstream_str_id_map_t *map,
+                                               const char *str);
+
+/** Get the string with the given ID
+ *
+ * @param map           pointer to the string ID map
+ * @param id            the ID to look up
+ * @return borrowed pointer to the string, NULL if there is no such ID
+ *
+ * The returned pointer remains valid until the map is destroyed.
+ */
+const char *bgpstream_str_id_map_get_str(bgpstream_str_id_map_t *map,
+                                         bgpstream_str_id_t id);
+
+/** Get the number of strings in the given map
+ *
+ * @param map           pointer to the string ID map
+ * @return the number of strings in the map (which is also the largest ID)
+ */
+int bgpstream_str_id_map_size(bgpstream_str_id_map_t *map);
+
+/** Destroy the given string ID map
+ *
+ * @param map           pointer to the string ID map to destroy
+ */
+void bgpstream_str_id_map_destroy(bgpstream_str_id_map_t *map);
+
+/** @} */
+
+#endif /* __BGPSTREAM_UTILS_STR_ID_MAP_H */
@@ -23,6 +23,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "khash.h"
 #include "utils.h"
@@ -105,6 +106,21 @@ int bgpstream_str_set_size(bgpstream_str_set_t *set)
   return kh_size(set->hash);
 }
 
+size_t bgpstream_str_set_get_mem_size(bgpstream_str_set_t *set)
+{
+  size_t size = sizeof(bgpstream_str_set_t) + sizeof(*set->hash) +
+                kh_n_buckets(set->hash) * sizeof(char *) +
+                __ac_fsize(kh_n_buckets(set->hash)) * sizeof(khint32_t);
+  khiter_t k;
+
+  for (k = kh_begin(set->hash); k != kh_end(set->hash); k++) {
+    if (kh_exist(set->hash, k)) {
+      size += strlen(kh_key(set->hash, k)) + 1;
+    }
+  }
+  return size;
+}
+
 int bgpstream_str_set_merge(bgpstream_str_set_t *dst_set,
                             bgpstream_str_set_t *src_set)
 {
@@ -24,6 +24,8 @@
 #ifndef __BGPSTREAM_UTILS_STR_SET_H
 #define __BGPSTREAM_UTILS_STR_SET_H
 
+#include <stddef.h>
+
 /** @file
  *
  * @brief Header file that exposes the public interface of the BGP Stream String
@@ -88,6 +90,13 @@ int bgpstream_str_set_exists(bgpstream_str_set_t *set, char *val);
  */
 int bgpstream_str_set_size(bgpstream_str_set_t *set);
 
+/** Returns the number of bytes allocated for the set
+ *
+ * @param set           pointer to the string set
+ * @return the number of bytes used by the set, including the strings
+ */
+size_t bgpstream_str_set_get_mem_size(bgpstream_str_set_t *set);
+
 /** Merge two string sets
  *
  * @param dst_set      pointer to the set to merge src into
@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Counts the elems and records seen from each collector, using a pool of worker
+# processes on the local machine (see spark-recordcount.py for a version of this
+# that uses Spark).
+#
+# E.g.:
+# parallel-recordcount.py -s 1451606400 -e 1451779200 -t updates -c route-views.sg
+#
+
+import argparse
+import collections
+
+from _pybgpstream import BGPRecord
+from pybgpstream.parallel import ShardPool, partition
+
+
+# runs in a worker process: counts the records and elems in one shard
+def count_shard(stream, shard):
+    rec = BGPRecord()
+    rec_cnt = 0
+    elem_cnt = 0
+    while stream.get_next_record(rec):
+        rec_cnt += 1
+        elem = rec.get_next_elem()
+        while elem:
+            elem_cnt += 1
+            elem = rec.get_next_elem()
+    return elem_cnt, rec_cnt
+
+
+def main():
+    parser = argparse.ArgumentParser(description="""
+    Script that uses PyBGPStream to count the records and elems from each
+    collector, processing shards of the query in parallel.
+    """)
+    parser.add_argument('-s', '--start-time', required=True, type=int,
+                        help='Start time')
+    parser.add_argument('-e', '--end-time', required=True, type=int,
+                        help='End time')
+    parser.add_argument('-c', '--collector', required=True, action='append',
+                        help='Collector to process (may be repeated)')
+    parser.add_argument('-t', '--data-type', required=True,
+                        choices=['ribs', 'updates'],
+                        help="One of 'ribs' or 'updates'")
+    parser.add_argument('-w', '--workers', type=int,
+                        help='Number of worker processes (default: #CPUs)')
+    opts = parser.parse_args()
+
+    shards = partition(opts.start_time, opts.end_time, opts.collector,
+                       opts.data_type)
+
+    counts = collections.defaultdict(lambda: [0, 0])
+    with ShardPool(workers=opts.workers) as pool:
+        for shard, (elem_cnt, rec_cnt) in pool.map(count_shard, shards):
+            counts[shard.collector][0] += elem_cnt
+            counts[shard.collector][1] += rec_cnt
+
+    print("Collector,#Elems,#Records")
+    for collector in sorted(counts):
+        print("%s,%d,%d" % (collector, counts[collector][0],
+                            counts[collector][1]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,365 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Run a BGPStream query as a set of independent shards in parallel.
+
+A query (an interval and a set of collectors) is partitioned into shards, each
+covering one collector for one time window. Each shard is processed by its own
+BGPStream instance, on a pool of worker processes (or threads), so that a
+single query can make use of all the cores of a machine.
+
+Results can be consumed per-shard (ShardPool.map), or as a single stream of
+elems, merged into time order (ShardPool.elems).
+
+Example:
+
+    def count_elems(stream, shard):
+        rec = BGPRecord()
+        cnt = 0
+        while stream.get_next_record(rec):
+            elem = rec.get_next_elem()
+            while elem:
+                cnt += 1
+                elem = rec.get_next_elem()
+        return cnt
+
+    shards = partition(1451606400, 1451692800,
+                       ['route-views.sg', 'rrc00'], 'updates')
+    with ShardPool(workers=16) as pool:
+        for shard, cnt in pool.map(count_elems, shards):
+            print(shard, cnt)
+
+Functions passed to ShardPool.map must be defined at the top level of a module
+so that they can be sent to the worker processes.
+"""
+
+import collections
+import heapq
+import multiprocessing
+import multiprocessing.pool
+import threading
+
+try:
+    import queue
+except ImportError:
+    import Queue as queue
+
+from _pybgpstream import BGPStream, BGPRecord
+
+# When processing RIBs, split into 4hr chunks for RV, 8hrs for RIS
+RV_RIB_SHARD_DURATION = 3600 * 4
+RIS_RIB_SHARD_DURATION = 3600 * 8
+# When processing updates, split into 2hr chunks
+UPD_SHARD_DURATION = 3600 * 2
+
+# ShardPool.elems receives elems from the workers in chunks of this many, with
+# at most ELEM_QUEUE_CHUNKS chunks waiting per shard
+ELEM_CHUNK_SIZE = 1000
+ELEM_QUEUE_CHUNKS = 4
+
+# A single collector over a single time window. The interval is
+# inclusive/exclusive. record_type is one of 'ribs', 'updates', or None for
+# both.
+Shard = collections.namedtuple('Shard',
+                               ['collector', 'start', 'end', 'record_type'])
+
+# An elem (along with the attributes of the record it came from) as returned by
+# ShardPool.elems. fields is the BGPElem.fields dictionary.
+Elem = collections.namedtuple('Elem',
+                              ['time', 'project', 'collector', 'record_type',
+                               'type', 'peer_address', 'peer_asn', 'fields'])
+
+
+def default_duration(collector, record_type):
+    """Get the default shard duration for the given collector and record
+    type"""
+    if record_type == 'ribs':
+        if 'rrc' in collector:
+            return RIS_RIB_SHARD_DURATION
+        return RV_RIB_SHARD_DURATION
+    return UPD_SHARD_DURATION
+
+
+def partition(start, end, collectors, record_type=None, duration=None):
+    """Split the (inclusive/exclusive) interval [start, end) and the given
+    collectors into a list of shards, sorted by time and then collector.
+
+    If duration is not given, a default is chosen for each collector based on
+    the record type (see default_duration)."""
+    shards = []
+    for collector in collectors:
+        dur = duration or default_duration(collector, record_type)
+        t = start
+        while t < end:
+            shards.append(Shard(collector, t, min(t + dur, end), record_type))
+            t += dur
+    shards.sort(key=lambda s: (s.start, s.collector))
+    return shards
+
+
+def create_stream(shard, data_interface=None, interface_options=None,
+                  filters=None):
+    """Create and start a BGPStream instance for the given shard.
+
+    interface_options is a dictionary of option names to values for the data
+    interface, and filters is a list of (type, value) tuples as for
+    BGPStream.add_filter."""
+    stream = BGPStream()
+    if data_interface is not None:
+        stream.set_data_interface(data_interface)
+        for name, value in (interface_options or {}).items():
+            stream.set_data_interface_option(data_interface, name, value)
+    stream.add_filter('collector', shard.collector)
+    if shard.record_type is not None:
+        stream.add_filter('record-type', shard.record_type)
+    for ftype, fvalue in (filters or []):
+        stream.add_filter(ftype, fvalue)
+    # BGPStream uses inclusive/inclusive intervals
+    stream.add_interval_filter(shard.start, shard.end - 1)
+    stream.start()
+    return stream
+
+
+def iter_shard_elems(stream, shard):
+    """Generate the elems from the given stream as Elem tuples"""
+    rec = BGPRecord()
+    while stream.get_next_record(rec):
+        if rec.status != 'valid':
+            continue
+        elem = rec.get_next_elem()
+        while elem:
+            yield Elem(elem.time, rec.project, rec.collector, rec.type,
+                       elem.type, elem.peer_address, elem.peer_asn,
+                       elem.fields)
+            elem = rec.get_next_elem()
+
+
+def shard_elems(stream, shard):
+    """Read all the elems from the given stream into a list of Elem tuples"""
+    return list(iter_shard_elems(stream, shard))
+
+
+# runs in the worker (used by ShardPool.elems): (elem_queue, cancel, shard,
+# stream_args) => shard. sends the elems of the shard to elem_queue in chunks,
+# followed by None (even if the stream cannot be created, so that the reader
+# gets to see the error). stops early if cancel is set
+def _queue_shard_elems(args):
+    (elem_queue, cancel, shard, stream_args) = args
+    chunk = []
+    try:
+        stream = create_stream(shard, **stream_args)
+        for elem in iter_shard_elems(stream, shard):
+            chunk.append(elem)
+            if len(chunk) >= ELEM_CHUNK_SIZE:
+                if cancel.is_set():
+                    return shard
+                elem_queue.put(chunk)
+                chunk = []
+        if chunk and not cancel.is_set():
+            elem_queue.put(chunk)
+    finally:
+        elem_queue.put(None)
+    return shard
+
+
+class _ShardReader(object):
+    """Iterates over the elems of a shard as they are queued by its worker"""
+
+    def __init__(self, result, elem_queue):
+        self.result = result
+        self.queue = elem_queue
+        self.elems = collections.deque()
+        self.done = False
+
+    def __iter__(self):
+        return self
+
+    def __next__(self):
+        while not self.elems:
+            if not self._read():
+                raise StopIteration
+        return self.elems.popleft()
+
+    next = __next__
+
+    def spill(self):
+        """Read all the remaining elems into memory, so that the worker can
+        move on to another shard"""
+        while self._read():
+            pass
+
+    def discard(self):
+        """Drop all the remaining elems (the worker must have been
+        cancelled)"""
+        self.elems.clear()
+        while not self.done:
+            if self.queue.get() is None:
+                self.done = True
+
+    # read the next chunk, returning False once the worker is done
+    def _read(self):
+        if self.done:
+            return False
+        chunk = self.queue.get()
+        if chunk is None:
+            self.done = True
+            # raise any error from the worker
+            self.result.get()
+            return False
+        self.elems.extend(chunk)
+        return True
+
+
+# runs in the worker: (func, shard, stream_args) => (shard, result)
+def _run_shard(args):
+    (func, shard, stream_args) = args
+    return shard, func(create_stream(shard, **stream_args), shard)
+
+
+class ShardPool(object):
+    """A pool of workers that process shards.
+
+    workers is the number of worker processes (or threads) to use (by default,
+    the number of CPUs). If threads is True, threads are used instead of
+    processes. This avoids the cost of sending results between processes, and
+    still allows shards to be processed in parallel since _pybgpstream
+    releases the GIL while it reads and parses data, but any Python processing
+    done on the results is serialized.
+
+    data_interface, interface_options and filters are used to configure the
+    stream for each shard (see create_stream).
+    """
+
+    def __init__(self, workers=None, threads=False, data_interface=None,
+                 interface_options=None, filters=None):
+        self.workers = workers or multiprocessing.cpu_count()
+        self.threads = threads
+        self.manager = None
+        if threads:
+            self.pool = multiprocessing.pool.ThreadPool(self.workers)
+        else:
+            self.pool = multiprocessing.Pool(self.workers)
+        self.stream_args = {
+            'data_interface': data_interface,
+            'interface_options': interface_options,
+            'filters': filters,
+        }
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        """Stop the workers"""
+        self.pool.terminate()
+        self.pool.join()
+        if self.manager is not None:
+            self.manager.shutdown()
+            self.manager = None
+
+    def map(self, func, shards, ordered=False):
+        """Call func(stream, shard) for each shard, and generate (shard,
+        result) tuples.
+
+        If ordered is True, results are generated in the order of the given
+        shards, otherwise they are generated as soon as they are
+        available."""
+        tasks = ((func, shard, self.stream_args) for shard in shards)
+        if ordered:
+            return self._imap_bounded(tasks)
+        return self.pool.imap_unordered(_run_shard, tasks)
+
+    def elems(self, shards):
+        """Generate the elems from all shards as Elem tuples, in time order.
+
+        Shards are processed in order of their start time, and elems are
+        generated as soon as no shard that has yet to be processed could
+        contain an earlier elem.
+
+        Workers send elems in small chunks through bounded queues, so a shard
+        in progress uses little memory. A worker cannot move on to another
+        shard until its elems have been consumed though, so if more shards
+        overlap in time than there are workers, some of them have to be read
+        into memory."""
+        shards = sorted(shards, key=lambda s: (s.start, s.collector))
+        if self.threads:
+            cancel = threading.Event()
+            new_queue = queue.Queue
+        else:
+            if self.manager is None:
+                self.manager = multiprocessing.Manager()
+            cancel = self.manager.Event()
+            new_queue = self.manager.Queue
+        heap = []
+        # readers of shards whose worker may still be busy
+        readers = []
+        try:
+            for idx, shard in enumerate(shards):
+                # this (and every later) shard only has elems from shard.start
+                while heap and heap[0][0] < shard.start:
+                    yield self._pop(heap)
+                # each shard in progress needs a worker of its own
+                readers = [r for r in readers if not r.done]
+                if len(readers) >= self.workers:
+                    readers.pop(0).spill()
+                elem_queue = new_queue(ELEM_QUEUE_CHUNKS)
+                result = self.pool.apply_async(
+                    _queue_shard_elems,
+                    ((elem_queue, cancel, shard, self.stream_args),))
+                reader = _ShardReader(result, elem_queue)
+                readers.append(reader)
+                self._push(heap, idx, reader)
+            while heap:
+                yield self._pop(heap)
+        finally:
+            # stop (and unblock) any workers that are still running
+            cancel.set()
+            for reader in readers:
+                reader.discard()
+
+    # heap entries are (time, shard index, elem, iterator), with one entry for
+    # each shard that still has elems
+    @staticmethod
+    def _push(heap, idx, elems):
+        elem = next(elems, None)
+        if elem is not None:
+            heapq.heappush(heap, (elem.time, idx, elem, elems))
+
+    @classmethod
+    def _pop(cls, heap):
+        (_, idx, elem, elems) = heapq.heappop(heap)
+        cls._push(heap, idx, elems)
+        return elem
+
+    # like imap, but with at most 2x workers shards in progress (or waiting to
+    # be consumed) at a time, so that results do not pile up in memory
+    def _imap_bounded(self, tasks):
+        pending = collections.deque()
+        for task in tasks:
+            pending.append(self.pool.apply_async(_run_shard, (task,)))
+            if len(pending) >= self.workers * 2:
+                yield pending.popleft().get()
+        while pending:
+            yield pending.popleft().get()
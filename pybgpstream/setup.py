@@ -5,7 +5,8 @@ _pybgpstream_module = Extension("_pybgpstream",
                                 sources = ["src/_pybgpstream_module.c",
                                            "src/_pybgpstream_bgpstream.c",
                                            "src/_pybgpstream_bgprecord.c",
-                                           "src/_pybgpstream_bgpelem.c"])
+                                           "src/_pybgpstream_bgpelem.c",
+                                           "src/_pybgpstream_bgpelembatch.c"])
 
 setup(name = "pybgpstream",
       description = "A Python interface to BGPStream",
@@ -26,4 +27,5 @@ setup(name = "pybgpstream",
           'Operating System :: POSIX',
           ],
       keywords='_pybgpstream pybgpstream bgpstream bgp mrt routeviews route-views ris routing',
+      packages = ["pybgpstream"],
       ext_modules = [_pybgpstream_module,])
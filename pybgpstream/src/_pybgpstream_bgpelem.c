@@ -97,6 +97,78 @@ static PyObject *get_communities_pylist(bgpstream_community_set_t *communities)
   return list;
 }
 
+/* path as a tuple of ints, with AS sets etc. as nested tuples */
+static PyObject *get_aspath_pytuple(bgpstream_as_path_t *aspath)
+{
+  PyObject *tuple;
+  PyObject *set;
+  bgpstream_as_path_iter_t iter;
+  bgpstream_as_path_seg_t *seg;
+  bgpstream_as_path_seg_set_t *segset;
+  Py_ssize_t i = 0;
+  int j;
+
+  if ((tuple = PyTuple_New(bgpstream_as_path_get_len(aspath))) == NULL)
+    return NULL;
+
+  bgpstream_as_path_iter_reset(&iter);
+  while ((seg = bgpstream_as_path_get_next_seg(aspath, &iter)) != NULL) {
+    if (seg->type == BGPSTREAM_AS_PATH_SEG_ASN) {
+      PyTuple_SET_ITEM(
+        tuple, i, Py_BuildValue("k", ((bgpstream_as_path_seg_asn_t *)seg)->asn));
+    } else {
+      segset = (bgpstream_as_path_seg_set_t *)seg;
+      if ((set = PyTuple_New(segset->asn_cnt)) == NULL) {
+        Py_DECREF(tuple);
+        return NULL;
+      }
+      for (j = 0; j < segset->asn_cnt; j++) {
+        PyTuple_SET_ITEM(set, j, Py_BuildValue("k", segset->asn[j]));
+      }
+      PyTuple_SET_ITEM(tuple, i, set);
+    }
+    if (PyTuple_GET_ITEM(tuple, i) == NULL) {
+      Py_DECREF(tuple);
+      return NULL;
+    }
+    i++;
+  }
+  return tuple;
+}
+
+/* communities as a tuple of (asn, value) tuples */
+static PyObject *get_communities_pytuple(bgpstream_community_set_t *communities)
+{
+  PyObject *tuple;
+  PyObject *comm;
+  bgpstream_community_t *c;
+  Py_ssize_t len = bgpstream_community_set_size(communities);
+  int i;
+
+  if ((tuple = PyTuple_New(len)) == NULL)
+    return NULL;
+
+  for (i = 0; i < len; i++) {
+    c = bgpstream_community_set_get(communities, i);
+    if ((comm = Py_BuildValue("(kk)", c->asn, c->value)) == NULL) {
+      Py_DECREF(tuple);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(tuple, i, comm);
+  }
+  return tuple;
+}
+
+static PyObject *get_origin_pynum(bgpstream_as_path_t *aspath)
+{
+  uint32_t asn;
+  if (bgpstream_as_path_get_origin_val(aspath, &asn) != 0) {
+    /* empty path, or the origin is an AS set */
+    Py_RETURN_NONE;
+  }
+  return Py_BuildValue("k", asn);
+}
+
 static PyObject *get_peerstate_pystr(bgpstream_elem_peerstate_t state)
 {
   char buf[128] = "";
@@ -107,6 +179,12 @@ static PyObject *get_peerstate_pystr(bgpstream_elem_peerstate_t state)
 
 static void BGPElem_dealloc(BGPElemObject *self)
 {
+  Py_XDECREF(self->prefix);
+  Py_XDECREF(self->next_hop);
+  Py_XDECREF(self->as_path);
+  Py_XDECREF(self->as_path_asns);
+  Py_XDECREF(self->origin_asn);
+  Py_XDECREF(self->communities);
   bgpstream_elem_destroy(self->elem);
   Py_TYPE(self)->tp_free((PyObject *)self);
 }
@@ -145,6 +223,73 @@ static PyObject *BGPElem_get_peer_asn(BGPElemObject *self, void *closure)
   return Py_BuildValue("k", self->elem->peer_asnumber);
 }
 
+/* Elem fields are only formatted the first time they are accessed. Fields that
+   do not apply to the elem type are None */
+#define CACHED_FIELD(self, field, types_match, expr)                           \
+  do {                                                                         \
+    if ((self)->field == NULL) {                                               \
+      if (!(types_match)) {                                                    \
+        Py_INCREF(Py_None);                                                    \
+        (self)->field = Py_None;                                               \
+      } else if (((self)->field = (expr)) == NULL) {                           \
+        return NULL;                                                           \
+      }                                                                        \
+    }                                                                          \
+    Py_INCREF((self)->field);                                                  \
+    return (self)->field;                                                      \
+  } while (0)
+
+#define HAS_PREFIX(elem)                                                       \
+  ((elem)->type == BGPSTREAM_ELEM_TYPE_RIB ||                                  \
+   (elem)->type == BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT ||                         \
+   (elem)->type == BGPSTREAM_ELEM_TYPE_WITHDRAWAL)
+
+#define HAS_ATTRIBUTES(elem)                                                   \
+  ((elem)->type == BGPSTREAM_ELEM_TYPE_RIB ||                                  \
+   (elem)->type == BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT)
+
+/* prefix */
+static PyObject *BGPElem_get_prefix(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, prefix, HAS_PREFIX(self->elem),
+               get_pfx_pystr((bgpstream_pfx_t *)&self->elem->prefix));
+}
+
+/* next hop */
+static PyObject *BGPElem_get_next_hop(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, next_hop, HAS_ATTRIBUTES(self->elem),
+               get_ip_pystr((bgpstream_ip_addr_t *)&self->elem->nexthop));
+}
+
+/* AS path (string) */
+static PyObject *BGPElem_get_as_path(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, as_path, HAS_ATTRIBUTES(self->elem),
+               get_aspath_pystr(self->elem->aspath));
+}
+
+/* AS path (tuple) */
+static PyObject *BGPElem_get_as_path_asns(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, as_path_asns, HAS_ATTRIBUTES(self->elem),
+               get_aspath_pytuple(self->elem->aspath));
+}
+
+/* origin ASN */
+static PyObject *BGPElem_get_origin_asn(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, origin_asn, HAS_ATTRIBUTES(self->elem),
+               get_origin_pynum(self->elem->aspath));
+}
+
+/* communities */
+static PyObject *BGPElem_get_communities(BGPElemObject *self, void *closure)
+{
+  CACHED_FIELD(self, communities, HAS_ATTRIBUTES(self->elem),
+               get_communities_pytuple(self->elem->communities));
+}
+
 /** Type-dependent field dict */
 static PyObject *BGPElem_get_fields(BGPElemObject *self, void *closure)
 {
@@ -157,10 +302,10 @@ static PyObject *BGPElem_get_fields(BGPElemObject *self, void *closure)
   switch (self->elem->type) {
   case BGPSTREAM_ELEM_TYPE_RIB:
   case BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT:
-    if (add_to_dict(
-          dict, "next-hop",
-          get_ip_pystr((bgpstream_ip_addr_t *)&self->elem->nexthop)) ||
-        add_to_dict(dict, "as-path", get_aspath_pystr(self->elem->aspath)) ||
+    /* (the dict is mutable, so only the immutable values are shared with the
+       field properties) */
+    if (add_to_dict(dict, "next-hop", BGPElem_get_next_hop(self, NULL)) ||
+        add_to_dict(dict, "as-path", BGPElem_get_as_path(self, NULL)) ||
         add_to_dict(dict, "communities",
                     get_communities_pylist(self->elem->communities))) {
       return NULL;
@@ -169,8 +314,7 @@ static PyObject *BGPElem_get_fields(BGPElemObject *self, void *closure)
   /* FALLTHROUGH */
 
   case BGPSTREAM_ELEM_TYPE_WITHDRAWAL:
-    if (add_to_dict(dict, "prefix",
-                    get_pfx_pystr((bgpstream_pfx_t *)&self->elem->prefix))) {
+    if (add_to_dict(dict, "prefix", BGPElem_get_prefix(self, NULL))) {
       return NULL;
     }
     break;
@@ -214,6 +358,27 @@ static PyGetSetDef BGPElem_getsetters[] = {
   /* Type-Specific Fields */
   {"fields", (getter)BGPElem_get_fields, NULL, "Type-Specific Fields", NULL},
 
+  /* prefix */
+  {"prefix", (getter)BGPElem_get_prefix, NULL, "Prefix", NULL},
+
+  /* next hop */
+  {"next_hop", (getter)BGPElem_get_next_hop, NULL, "Next Hop IP Address",
+   NULL},
+
+  /* AS path */
+  {"as_path", (getter)BGPElem_get_as_path, NULL, "AS Path", NULL},
+
+  /* AS path (ASNs) */
+  {"as_path_asns", (getter)BGPElem_get_as_path_asns, NULL,
+   "AS Path as a tuple of ASNs", NULL},
+
+  /* origin ASN */
+  {"origin_asn", (getter)BGPElem_get_origin_asn, NULL, "Origin ASN", NULL},
+
+  /* communities */
+  {"communities", (getter)BGPElem_get_communities, NULL,
+   "Communities as a tuple of (asn, value) tuples", NULL},
+
   {NULL} /* Sentinel */
 };
 
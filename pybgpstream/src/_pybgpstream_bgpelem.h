@@ -32,6 +32,14 @@ typedef struct {
 
     bgpstream_elem_t *elem;
 
+  /* Field values, created the first time they are accessed */
+  PyObject *prefix;
+  PyObject *next_hop;
+  PyObject *as_path;
+  PyObject *as_path_asns;
+  PyObject *origin_asn;
+  PyObject *communities;
+
 } BGPElemObject;
 
 /** Expose the BGPElemType structure */
@@ -0,0 +1,732 @@
+/*
+ * This file is part of pybgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "_pybgpstream_bgpelembatch.h"
+#include "pyutils.h"
+#include <Python.h>
+#include <bgpstream.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BGPElemBatchDocstring "BGPElemBatch object"
+
+#define BGPElemColumnDocstring "BGPElemColumn object"
+
+/* IP addresses are stored as 16 bytes, with IPv4 addresses in the first 4 */
+#define ADDR_LEN 16
+
+/* path flag that indicates that the path contains AS sets or confederations */
+#define PATH_FLAG_HAS_SETS 0x01
+
+/* the columns that make up a batch */
+enum {
+  /* one entry per elem */
+  COL_TYPE,
+  COL_TIME,
+  COL_PEER_ASN,
+  COL_PEER_VERSION,
+  COL_PEER_ADDRESS,
+  COL_PREFIX_VERSION,
+  COL_PREFIX_LEN,
+  COL_PREFIX,
+  COL_NEXT_HOP_VERSION,
+  COL_NEXT_HOP,
+  COL_ORIGIN_ASN,
+  COL_PATH_ID,
+  COL_OLD_STATE,
+  COL_NEW_STATE,
+
+  /* one entry per elem, plus one */
+  COL_COMMUNITY_OFFSETS,
+
+  /* one entry per community */
+  COL_COMMUNITIES,
+
+  /* one entry per distinct path, plus one */
+  COL_PATH_OFFSETS,
+
+  /* one entry per distinct path */
+  COL_PATH_FLAGS,
+
+  /* one entry per path hop */
+  COL_PATH_HOPS,
+
+  COL_EXPORTED_CNT,
+
+  /* the following are only used to de-duplicate paths while building the
+     batch, and are not exposed to python */
+  COL_PATH_HASH = COL_EXPORTED_CNT,
+  COL_PATH_DATA_OFFSETS,
+  COL_PATH_DATA,
+
+  COL_CNT
+};
+
+#define COL_ELEM_FIRST COL_TYPE
+#define COL_ELEM_LAST COL_NEW_STATE
+
+/* buffer format of each column. if width is non-zero, then the column is two
+   dimensional, with width items per entry */
+static const struct {
+  const char *format;
+  int itemsize;
+  int width;
+} col_info[COL_CNT] = {
+  {"B", sizeof(uint8_t), 0},         /* COL_TYPE */
+  {"I", sizeof(uint32_t), 0},        /* COL_TIME */
+  {"I", sizeof(uint32_t), 0},        /* COL_PEER_ASN */
+  {"B", sizeof(uint8_t), 0},         /* COL_PEER_VERSION */
+  {"B", sizeof(uint8_t), ADDR_LEN},  /* COL_PEER_ADDRESS */
+  {"B", sizeof(uint8_t), 0},         /* COL_PREFIX_VERSION */
+  {"B", sizeof(uint8_t), 0},         /* COL_PREFIX_LEN */
+  {"B", sizeof(uint8_t), ADDR_LEN},  /* COL_PREFIX */
+  {"B", sizeof(uint8_t), 0},         /* COL_NEXT_HOP_VERSION */
+  {"B", sizeof(uint8_t), ADDR_LEN},  /* COL_NEXT_HOP */
+  {"I", sizeof(uint32_t), 0},        /* COL_ORIGIN_ASN */
+  {"i", sizeof(int32_t), 0},         /* COL_PATH_ID */
+  {"B", sizeof(uint8_t), 0},         /* COL_OLD_STATE */
+  {"B", sizeof(uint8_t), 0},         /* COL_NEW_STATE */
+  {"I", sizeof(uint32_t), 0},        /* COL_COMMUNITY_OFFSETS */
+  {"I", sizeof(uint32_t), 0},        /* COL_COMMUNITIES */
+  {"I", sizeof(uint32_t), 0},        /* COL_PATH_OFFSETS */
+  {"B", sizeof(uint8_t), 0},         /* COL_PATH_FLAGS */
+  {"I", sizeof(uint32_t), 0},        /* COL_PATH_HOPS */
+  {"I", sizeof(uint32_t), 0},        /* COL_PATH_HASH */
+  {"I", sizeof(uint32_t), 0},        /* COL_PATH_DATA_OFFSETS */
+  {"B", sizeof(uint8_t), 0},         /* COL_PATH_DATA */
+};
+
+#define COL(batch, col, type) ((type *)(batch)->data[(col)])
+
+struct elembatch {
+
+  /* column data */
+  void *data[COL_CNT];
+
+  /* number of entries in each column */
+  uint32_t cnt[COL_CNT];
+
+  /* number of entries allocated for each column */
+  uint32_t alloc[COL_CNT];
+
+  /* open-addressing hash table of path indexes (plus one, so that zero
+     indicates an empty slot) */
+  uint32_t *paths_tbl;
+
+  /* number of slots in the path table (always a power of two) */
+  uint32_t paths_tbl_size;
+};
+
+static size_t col_entry_size(int col)
+{
+  return col_info[col].itemsize *
+         (col_info[col].width != 0 ? col_info[col].width : 1);
+}
+
+/* make room for n more entries in the given column */
+static int col_reserve(elembatch_t *batch, int col, uint32_t n)
+{
+  uint32_t alloc;
+  void *data;
+
+  if (batch->cnt[col] + n <= batch->alloc[col]) {
+    return 0;
+  }
+
+  alloc = batch->alloc[col] != 0 ? batch->alloc[col] * 2 : 64;
+  while (alloc < batch->cnt[col] + n) {
+    alloc *= 2;
+  }
+  if ((data = realloc(batch->data[col], alloc * col_entry_size(col))) ==
+      NULL) {
+    return -1;
+  }
+  batch->data[col] = data;
+  batch->alloc[col] = alloc;
+  return 0;
+}
+
+static int col_append_u32(elembatch_t *batch, int col, uint32_t val)
+{
+  if (col_reserve(batch, col, 1) != 0) {
+    return -1;
+  }
+  COL(batch, col, uint32_t)[batch->cnt[col]++] = val;
+  return 0;
+}
+
+static void copy_addr(uint8_t *dst, uint8_t *version,
+                      bgpstream_addr_storage_t *addr)
+{
+  memset(dst, 0, ADDR_LEN);
+  switch (addr->version) {
+  case BGPSTREAM_ADDR_VERSION_IPV4:
+    memcpy(dst, &addr->ipv4, sizeof(addr->ipv4));
+    *version = 4;
+    break;
+
+  case BGPSTREAM_ADDR_VERSION_IPV6:
+    memcpy(dst, &addr->ipv6, sizeof(addr->ipv6));
+    *version = 6;
+    break;
+
+  default:
+    *version = 0;
+    break;
+  }
+}
+
+static int paths_tbl_grow(elembatch_t *batch)
+{
+  uint32_t size = batch->paths_tbl_size != 0 ? batch->paths_tbl_size * 2 : 256;
+  uint32_t *tbl;
+  uint32_t i, slot;
+
+  if ((tbl = calloc(size, sizeof(uint32_t))) == NULL) {
+    return -1;
+  }
+
+  /* re-insert the paths we already have */
+  for (i = 0; i < batch->cnt[COL_PATH_FLAGS]; i++) {
+    slot = COL(batch, COL_PATH_HASH, uint32_t)[i] & (size - 1);
+    while (tbl[slot] != 0) {
+      slot = (slot + 1) & (size - 1);
+    }
+    tbl[slot] = i + 1;
+  }
+
+  free(batch->paths_tbl);
+  batch->paths_tbl = tbl;
+  batch->paths_tbl_size = size;
+  return 0;
+}
+
+/* add the given path to the pool (if it is not already there), and return its
+   index */
+static int add_path(elembatch_t *batch, bgpstream_as_path_t *path)
+{
+  uint8_t *data;
+  uint16_t data_len = bgpstream_as_path_get_data(path, &data);
+  uint32_t hash = bgpstream_as_path_hash(path);
+  uint32_t *offsets;
+  uint32_t slot, idx;
+  bgpstream_as_path_iter_t iter;
+  bgpstream_as_path_seg_t *seg;
+  bgpstream_as_path_seg_set_t *set;
+  uint8_t flags = 0;
+
+  /* keep the table at most half full */
+  if ((batch->cnt[COL_PATH_FLAGS] + 1) * 2 > batch->paths_tbl_size &&
+      paths_tbl_grow(batch) != 0) {
+    return -1;
+  }
+
+  /* look for an existing copy of this path */
+  offsets = COL(batch, COL_PATH_DATA_OFFSETS, uint32_t);
+  for (slot = hash & (batch->paths_tbl_size - 1);
+       (idx = batch->paths_tbl[slot]) != 0;
+       slot = (slot + 1) & (batch->paths_tbl_size - 1)) {
+    idx--;
+    if (COL(batch, COL_PATH_HASH, uint32_t)[idx] == hash &&
+        offsets[idx + 1] - offsets[idx] == data_len &&
+        memcmp(COL(batch, COL_PATH_DATA, uint8_t) + offsets[idx], data,
+               data_len) == 0) {
+      return idx;
+    }
+  }
+
+  /* new path, flatten the segments into the hop pool */
+  idx = batch->cnt[COL_PATH_FLAGS];
+  bgpstream_as_path_iter_reset(&iter);
+  while ((seg = bgpstream_as_path_get_next_seg(path, &iter)) != NULL) {
+    if (seg->type == BGPSTREAM_AS_PATH_SEG_ASN) {
+      if (col_append_u32(batch, COL_PATH_HOPS,
+                         ((bgpstream_as_path_seg_asn_t *)seg)->asn) != 0) {
+        return -1;
+      }
+    } else {
+      set = (bgpstream_as_path_seg_set_t *)seg;
+      flags |= PATH_FLAG_HAS_SETS;
+      if (col_reserve(batch, COL_PATH_HOPS, set->asn_cnt) != 0) {
+        return -1;
+      }
+      memcpy(COL(batch, COL_PATH_HOPS, uint32_t) + batch->cnt[COL_PATH_HOPS],
+             set->asn, set->asn_cnt * sizeof(uint32_t));
+      batch->cnt[COL_PATH_HOPS] += set->asn_cnt;
+    }
+  }
+
+  if (col_reserve(batch, COL_PATH_FLAGS, 1) != 0 ||
+      col_reserve(batch, COL_PATH_DATA, data_len) != 0 ||
+      col_append_u32(batch, COL_PATH_OFFSETS, batch->cnt[COL_PATH_HOPS]) != 0 ||
+      col_append_u32(batch, COL_PATH_HASH, hash) != 0 ||
+      col_append_u32(batch, COL_PATH_DATA_OFFSETS,
+                     batch->cnt[COL_PATH_DATA] + data_len) != 0) {
+    return -1;
+  }
+  COL(batch, COL_PATH_FLAGS, uint8_t)[batch->cnt[COL_PATH_FLAGS]++] = flags;
+  memcpy(COL(batch, COL_PATH_DATA, uint8_t) + batch->cnt[COL_PATH_DATA], data,
+         data_len);
+  batch->cnt[COL_PATH_DATA] += data_len;
+
+  batch->paths_tbl[slot] = idx + 1;
+  return idx;
+}
+
+static int add_elem(elembatch_t *batch, bgpstream_elem_t *elem)
+{
+  uint32_t i = batch->cnt[COL_TYPE];
+  bgpstream_community_t *c;
+  int col;
+  int path_id = -1;
+  uint32_t origin_asn = 0;
+  int comms_cnt, j;
+
+  for (col = COL_ELEM_FIRST; col <= COL_ELEM_LAST; col++) {
+    if (col_reserve(batch, col, 1) != 0) {
+      return -1;
+    }
+    batch->cnt[col]++;
+  }
+
+  COL(batch, COL_TYPE, uint8_t)[i] = elem->type;
+  COL(batch, COL_TIME, uint32_t)[i] = elem->timestamp;
+  COL(batch, COL_PEER_ASN, uint32_t)[i] = elem->peer_asnumber;
+  copy_addr(COL(batch, COL_PEER_ADDRESS, uint8_t) + i * ADDR_LEN,
+            COL(batch, COL_PEER_VERSION, uint8_t) + i, &elem->peer_address);
+
+  switch (elem->type) {
+  case BGPSTREAM_ELEM_TYPE_RIB:
+  case BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT:
+  case BGPSTREAM_ELEM_TYPE_WITHDRAWAL:
+    copy_addr(COL(batch, COL_PREFIX, uint8_t) + i * ADDR_LEN,
+              COL(batch, COL_PREFIX_VERSION, uint8_t) + i,
+              &elem->prefix.address);
+    COL(batch, COL_PREFIX_LEN, uint8_t)[i] = elem->prefix.mask_len;
+    break;
+
+  default:
+    memset(COL(batch, COL_PREFIX, uint8_t) + i * ADDR_LEN, 0, ADDR_LEN);
+    COL(batch, COL_PREFIX_VERSION, uint8_t)[i] = 0;
+    COL(batch, COL_PREFIX_LEN, uint8_t)[i] = 0;
+    break;
+  }
+
+  if (elem->type == BGPSTREAM_ELEM_TYPE_RIB ||
+      elem->type == BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT) {
+    copy_addr(COL(batch, COL_NEXT_HOP, uint8_t) + i * ADDR_LEN,
+              COL(batch, COL_NEXT_HOP_VERSION, uint8_t) + i, &elem->nexthop);
+    if ((path_id = add_path(batch, elem->aspath)) < 0) {
+      return -1;
+    }
+    if (bgpstream_as_path_get_origin_val(elem->aspath, &origin_asn) != 0) {
+      origin_asn = 0;
+    }
+    /* communities are stored as their 32-bit wire value */
+    comms_cnt = bgpstream_community_set_size(elem->communities);
+    if (col_reserve(batch, COL_COMMUNITIES, comms_cnt) != 0) {
+      return -1;
+    }
+    for (j = 0; j < comms_cnt; j++) {
+      c = bgpstream_community_set_get(elem->communities, j);
+      COL(batch, COL_COMMUNITIES, uint32_t)[batch->cnt[COL_COMMUNITIES]++] =
+        ((uint32_t)c->asn << 16) | c->value;
+    }
+  } else {
+    memset(COL(batch, COL_NEXT_HOP, uint8_t) + i * ADDR_LEN, 0, ADDR_LEN);
+    COL(batch, COL_NEXT_HOP_VERSION, uint8_t)[i] = 0;
+  }
+  COL(batch, COL_ORIGIN_ASN, uint32_t)[i] = origin_asn;
+  COL(batch, COL_PATH_ID, int32_t)[i] = path_id;
+
+  if (col_append_u32(batch, COL_COMMUNITY_OFFSETS,
+                     batch->cnt[COL_COMMUNITIES]) != 0) {
+    return -1;
+  }
+
+  if (elem->type == BGPSTREAM_ELEM_TYPE_PEERSTATE) {
+    COL(batch, COL_OLD_STATE, uint8_t)[i] = elem->old_state;
+    COL(batch, COL_NEW_STATE, uint8_t)[i] = elem->new_state;
+  } else {
+    COL(batch, COL_OLD_STATE, uint8_t)[i] = 0;
+    COL(batch, COL_NEW_STATE, uint8_t)[i] = 0;
+  }
+
+  return 0;
+}
+
+elembatch_t *elembatch_create(void)
+{
+  elembatch_t *batch;
+
+  if ((batch = calloc(1, sizeof(elembatch_t))) == NULL) {
+    return NULL;
+  }
+
+  /* the offset columns start with a zero */
+  if (col_append_u32(batch, COL_COMMUNITY_OFFSETS, 0) != 0 ||
+      col_append_u32(batch, COL_PATH_OFFSETS, 0) != 0 ||
+      col_append_u32(batch, COL_PATH_DATA_OFFSETS, 0) != 0) {
+    elembatch_destroy(batch);
+    return NULL;
+  }
+
+  return batch;
+}
+
+void elembatch_destroy(elembatch_t *batch)
+{
+  int col;
+
+  if (batch == NULL) {
+    return;
+  }
+
+  for (col = 0; col < COL_CNT; col++) {
+    free(batch->data[col]);
+  }
+  free(batch->paths_tbl);
+  free(batch);
+}
+
+int elembatch_get_cnt(elembatch_t *batch)
+{
+  return batch->cnt[COL_TYPE];
+}
+
+int elembatch_fill(elembatch_t *batch, bgpstream_record_t *record, int max_cnt)
+{
+  bgpstream_elem_t *elem;
+
+  while (max_cnt == 0 || elembatch_get_cnt(batch) < max_cnt) {
+    if ((elem = bgpstream_record_get_next_elem(record)) == NULL) {
+      return 1;
+    }
+    if (add_elem(batch, elem) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* ========== BGPElemColumn ========== */
+
+typedef struct {
+  PyObject_HEAD
+
+    /* column data (owned by this object) */
+    void *data;
+
+  /* buffer layout */
+  const char *format;
+  int ndim;
+  Py_ssize_t itemsize;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+
+} BGPElemColumnObject;
+
+static PyTypeObject BGPElemColumnType;
+
+/* used as the buffer address of empty columns */
+static uint8_t empty_column[1];
+
+static void BGPElemColumn_dealloc(BGPElemColumnObject *self)
+{
+  free(self->data);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t BGPElemColumn_length(BGPElemColumnObject *self)
+{
+  return self->shape[0];
+}
+
+static int BGPElemColumn_getbuffer(BGPElemColumnObject *self, Py_buffer *view,
+                                   int flags)
+{
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "BGPElemColumn is read-only");
+    view->obj = NULL;
+    return -1;
+  }
+  /* multi-dimensional columns can only be exported with a shape */
+  if (self->ndim > 1 && (flags & PyBUF_ND) != PyBUF_ND) {
+    PyErr_SetString(PyExc_BufferError, "BGPElemColumn is not contiguous");
+    view->obj = NULL;
+    return -1;
+  }
+
+  view->obj = (PyObject *)self;
+  Py_INCREF(self);
+  view->buf = self->data != NULL ? self->data : empty_column;
+  view->len = self->shape[0] * self->strides[0];
+  view->readonly = 1;
+  view->itemsize = self->itemsize;
+  view->format =
+    (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? (char *)self->format : NULL;
+  view->ndim = self->ndim;
+  view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->shape : NULL;
+  view->strides =
+    (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
+}
+
+static PySequenceMethods BGPElemColumn_as_sequence = {
+  (lenfunc)BGPElemColumn_length, /* sq_length */
+};
+
+static PyBufferProcs BGPElemColumn_as_buffer = {
+#if PY_MAJOR_VERSION < 3
+  0, /* bf_getreadbuffer */
+  0, /* bf_getwritebuffer */
+  0, /* bf_getsegcount */
+  0, /* bf_getcharbuffer */
+#endif
+  (getbufferproc)BGPElemColumn_getbuffer, /* bf_getbuffer */
+  0,                                      /* bf_releasebuffer */
+};
+
+#if PY_MAJOR_VERSION < 3
+#define BGPELEMCOLUMN_TPFLAGS (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER)
+#else
+#define BGPELEMCOLUMN_TPFLAGS Py_TPFLAGS_DEFAULT
+#endif
+
+static PyTypeObject BGPElemColumnType = {
+  PyVarObject_HEAD_INIT(NULL, 0) "_pybgpstream.BGPElemColumn", /* tp_name */
+  sizeof(BGPElemColumnObject),         /* tp_basicsize */
+  0,                                   /* tp_itemsize */
+  (destructor)BGPElemColumn_dealloc,   /* tp_dealloc */
+  0,                                   /* tp_print */
+  0,                                   /* tp_getattr */
+  0,                                   /* tp_setattr */
+  0,                                   /* tp_compare */
+  0,                                   /* tp_repr */
+  0,                                   /* tp_as_number */
+  &BGPElemColumn_as_sequence,          /* tp_as_sequence */
+  0,                                   /* tp_as_mapping */
+  0,                                   /* tp_hash */
+  0,                                   /* tp_call */
+  0,                                   /* tp_str */
+  0,                                   /* tp_getattro */
+  0,                                   /* tp_setattro */
+  &BGPElemColumn_as_buffer,            /* tp_as_buffer */
+  BGPELEMCOLUMN_TPFLAGS,               /* tp_flags */
+  BGPElemColumnDocstring,              /* tp_doc */
+};
+
+/* create a column object that takes ownership of the given column data */
+static PyObject *BGPElemColumn_new(elembatch_t *batch, int col)
+{
+  BGPElemColumnObject *self;
+
+  self = (BGPElemColumnObject *)BGPElemColumnType.tp_alloc(&BGPElemColumnType,
+                                                           0);
+  if (self == NULL) {
+    return NULL;
+  }
+
+  self->data = batch->data[col];
+  batch->data[col] = NULL;
+
+  self->format = col_info[col].format;
+  self->itemsize = col_info[col].itemsize;
+  self->shape[0] = batch->cnt[col];
+  self->strides[0] = col_entry_size(col);
+  if (col_info[col].width != 0) {
+    self->ndim = 2;
+    self->shape[1] = col_info[col].width;
+    self->strides[1] = self->itemsize;
+  } else {
+    self->ndim = 1;
+  }
+
+  return (PyObject *)self;
+}
+
+/* ========== BGPElemBatch ========== */
+
+typedef struct {
+  PyObject_HEAD
+
+    /* number of elems in the batch */
+    Py_ssize_t cnt;
+
+  /* BGPElemColumn objects */
+  PyObject *columns[COL_EXPORTED_CNT];
+
+} BGPElemBatchObject;
+
+static PyTypeObject BGPElemBatchType;
+
+static void BGPElemBatch_dealloc(BGPElemBatchObject *self)
+{
+  int col;
+  for (col = 0; col < COL_EXPORTED_CNT; col++) {
+    Py_XDECREF(self->columns[col]);
+  }
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static Py_ssize_t BGPElemBatch_length(BGPElemBatchObject *self)
+{
+  return self->cnt;
+}
+
+static PyObject *BGPElemBatch_get_column(BGPElemBatchObject *self,
+                                         void *closure)
+{
+  PyObject *column = self->columns[(intptr_t)closure];
+  Py_INCREF(column);
+  return column;
+}
+
+#define COLUMN_GETTER(name, col, doc)                                          \
+  {                                                                            \
+    name, (getter)BGPElemBatch_get_column, NULL, doc, (void *)(intptr_t)col    \
+  }
+
+static PyGetSetDef BGPElemBatch_getsetters[] = {
+
+  COLUMN_GETTER("type", COL_TYPE, "Elem Types (uint8)"),
+
+  COLUMN_GETTER("time", COL_TIME, "Elem Times (uint32)"),
+
+  COLUMN_GETTER("peer_asn", COL_PEER_ASN, "Peer ASNs (uint32)"),
+
+  COLUMN_GETTER("peer_version", COL_PEER_VERSION,
+                "Peer Address Versions (uint8)"),
+
+  COLUMN_GETTER("peer_address", COL_PEER_ADDRESS,
+                "Peer Addresses (16 x uint8)"),
+
+  COLUMN_GETTER("prefix_version", COL_PREFIX_VERSION,
+                "Prefix Versions (uint8)"),
+
+  COLUMN_GETTER("prefix_len", COL_PREFIX_LEN, "Prefix Lengths (uint8)"),
+
+  COLUMN_GETTER("prefix", COL_PREFIX, "Prefix Addresses (16 x uint8)"),
+
+  COLUMN_GETTER("next_hop_version", COL_NEXT_HOP_VERSION,
+                "Next Hop Versions (uint8)"),
+
+  COLUMN_GETTER("next_hop", COL_NEXT_HOP, "Next Hops (16 x uint8)"),
+
+  COLUMN_GETTER("origin_asn", COL_ORIGIN_ASN, "Origin ASNs (uint32)"),
+
+  COLUMN_GETTER("path_id", COL_PATH_ID, "AS Path IDs (int32)"),
+
+  COLUMN_GETTER("old_state", COL_OLD_STATE, "Old Peer States (uint8)"),
+
+  COLUMN_GETTER("new_state", COL_NEW_STATE, "New Peer States (uint8)"),
+
+  COLUMN_GETTER("community_offsets", COL_COMMUNITY_OFFSETS,
+                "Community Offsets (uint32)"),
+
+  COLUMN_GETTER("communities", COL_COMMUNITIES, "Communities (uint32)"),
+
+  COLUMN_GETTER("path_offsets", COL_PATH_OFFSETS, "AS Path Offsets (uint32)"),
+
+  COLUMN_GETTER("path_flags", COL_PATH_FLAGS, "AS Path Flags (uint8)"),
+
+  COLUMN_GETTER("path_hops", COL_PATH_HOPS, "AS Path Hops (uint32)"),
+
+  {NULL} /* Sentinel */
+};
+
+static PySequenceMethods BGPElemBatch_as_sequence = {
+  (lenfunc)BGPElemBatch_length, /* sq_length */
+};
+
+static PyTypeObject BGPElemBatchType = {
+  PyVarObject_HEAD_INIT(NULL, 0) "_pybgpstream.BGPElemBatch", /* tp_name */
+  sizeof(BGPElemBatchObject),        /* tp_basicsize */
+  0,                                 /* tp_itemsize */
+  (destructor)BGPElemBatch_dealloc,  /* tp_dealloc */
+  0,                                 /* tp_print */
+  0,                                 /* tp_getattr */
+  0,                                 /* tp_setattr */
+  0,                                 /* tp_compare */
+  0,                                 /* tp_repr */
+  0,                                 /* tp_as_number */
+  &BGPElemBatch_as_sequence,         /* tp_as_sequence */
+  0,                                 /* tp_as_mapping */
+  0,                                 /* tp_hash */
+  0,                                 /* tp_call */
+  0,                                 /* tp_str */
+  0,                                 /* tp_getattro */
+  0,                                 /* tp_setattro */
+  0,                                 /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT,                /* tp_flags */
+  BGPElemBatchDocstring,             /* tp_doc */
+  0,                                 /* tp_traverse */
+  0,                                 /* tp_clear */
+  0,                                 /* tp_richcompare */
+  0,                                 /* tp_weaklistoffset */
+  0,                                 /* tp_iter */
+  0,                                 /* tp_iternext */
+  0,                                 /* tp_methods */
+  0,                                 /* tp_members */
+  BGPElemBatch_getsetters,           /* tp_getset */
+};
+
+PyObject *BGPElemBatch_new(elembatch_t *batch)
+{
+  BGPElemBatchObject *self;
+  int col;
+
+  self =
+    (BGPElemBatchObject *)BGPElemBatchType.tp_alloc(&BGPElemBatchType, 0);
+  if (self == NULL) {
+    elembatch_destroy(batch);
+    return NULL;
+  }
+
+  self->cnt = elembatch_get_cnt(batch);
+  for (col = 0; col < COL_EXPORTED_CNT; col++) {
+    if ((self->columns[col] = BGPElemColumn_new(batch, col)) == NULL) {
+      elembatch_destroy(batch);
+      Py_DECREF(self);
+      return NULL;
+    }
+  }
+
+  /* the columns now own the exported data */
+  elembatch_destroy(batch);
+  return (PyObject *)self;
+}
+
+PyTypeObject *_pybgpstream_bgpstream_get_BGPElemBatchType()
+{
+  return &BGPElemBatchType;
+}
+
+PyTypeObject *_pybgpstream_bgpstream_get_BGPElemColumnType()
+{
+  return &BGPElemColumnType;
+}
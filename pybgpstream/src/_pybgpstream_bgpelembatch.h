@@ -0,0 +1,63 @@
+/*
+ * This file is part of pybgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ___PYBGPSTREAM_BGPELEMBATCH_H
+#define ___PYBGPSTREAM_BGPELEMBATCH_H
+
+#include "bgpstream.h"
+#include <Python.h>
+
+/* A batch of elems stored column-wise. Filled without holding the GIL, and
+   then handed over to a BGPElemBatch object which exposes each column to
+   Python using the buffer protocol */
+typedef struct elembatch elembatch_t;
+
+/** Expose the BGPElemBatchType structure */
+PyTypeObject *_pybgpstream_bgpstream_get_BGPElemBatchType(void);
+
+/** Expose the BGPElemColumnType structure */
+PyTypeObject *_pybgpstream_bgpstream_get_BGPElemColumnType(void);
+
+/** Create an empty batch (does not need the GIL) */
+elembatch_t *elembatch_create(void);
+
+/** Destroy a batch that was not passed to BGPElemBatch_new */
+void elembatch_destroy(elembatch_t *batch);
+
+/** Get the number of elems in the given batch */
+int elembatch_get_cnt(elembatch_t *batch);
+
+/** Move elems from the given record into the batch (does not need the GIL)
+ *
+ * Adds elems until either the record has no more elems, or the batch holds
+ * max_cnt elems (0 for no limit). Returns 1 if the record ran out of elems, 0
+ * if the batch is full, or -1 if memory could not be allocated.
+ */
+int elembatch_fill(elembatch_t *batch, bgpstream_record_t *record,
+                   int max_cnt);
+
+/** Create a new BGPElemBatch object from the given batch. The object takes
+    ownership of the batch (even if this fails) */
+PyObject *BGPElemBatch_new(elembatch_t *batch);
+
+#endif /* ___PYBGPSTREAM_BGPELEMBATCH_H */
@@ -23,6 +23,7 @@
 
 #include "_pybgpstream_bgprecord.h"
 #include "_pybgpstream_bgpelem.h"
+#include "_pybgpstream_bgpelembatch.h"
 #include "pyutils.h"
 #include <Python.h>
 #include <bgpstream.h>
@@ -34,6 +35,9 @@ static void BGPRecord_dealloc(BGPRecordObject *self)
   if (self->rec != NULL) {
     bgpstream_record_destroy(self->rec);
   }
+  if (self->lock != NULL) {
+    PyThread_free_lock(self->lock);
+  }
   Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -52,6 +56,11 @@ static PyObject *BGPRecord_new(PyTypeObject *type, PyObject *args,
     return NULL;
   }
 
+  if ((self->lock = PyThread_allocate_lock()) == NULL) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+
   return (PyObject *)self;
 }
 
@@ -60,24 +69,43 @@ static int BGPRecord_init(BGPRecordObject *self, PyObject *args, PyObject *kwds)
   return 0;
 }
 
-/* attributes */
+/* attributes
+
+   the getters take the record's lock, since another thread may be filling
+   the record (without the GIL) at the same time */
 
 /* project */
 static PyObject *BGPRecord_get_project(BGPRecordObject *self, void *closure)
 {
-  return Py_BuildValue("s", self->rec->attributes.dump_project);
+  PyObject *ret;
+
+  PYLOCK_ACQUIRE(self->lock);
+  ret = Py_BuildValue("s", self->rec->attributes.dump_project);
+  PYLOCK_RELEASE(self->lock);
+  return ret;
 }
 
 /* collector */
 static PyObject *BGPRecord_get_collector(BGPRecordObject *self, void *closure)
 {
-  return Py_BuildValue("s", self->rec->attributes.dump_collector);
+  PyObject *ret;
+
+  PYLOCK_ACQUIRE(self->lock);
+  ret = Py_BuildValue("s", self->rec->attributes.dump_collector);
+  PYLOCK_RELEASE(self->lock);
+  return ret;
 }
 
 /* type */
 static PyObject *BGPRecord_get_type(BGPRecordObject *self, void *closure)
 {
-  switch (self->rec->attributes.dump_type) {
+  bgpstream_record_dump_type_t type;
+
+  PYLOCK_ACQUIRE(self->lock);
+  type = self->rec->attributes.dump_type;
+  PYLOCK_RELEASE(self->lock);
+
+  switch (type) {
   case BGPSTREAM_UPDATE:
     return Py_BuildValue("s", "update");
     break;
@@ -96,19 +124,35 @@ static PyObject *BGPRecord_get_type(BGPRecordObject *self, void *closure)
 /* dump_time */
 static PyObject *BGPRecord_get_dump_time(BGPRecordObject *self, void *closure)
 {
-  return Py_BuildValue("l", self->rec->attributes.dump_time);
+  PyObject *ret;
+
+  PYLOCK_ACQUIRE(self->lock);
+  ret = Py_BuildValue("l", self->rec->attributes.dump_time);
+  PYLOCK_RELEASE(self->lock);
+  return ret;
 }
 
 /* record_time */
 static PyObject *BGPRecord_get_record_time(BGPRecordObject *self, void *closure)
 {
-  return Py_BuildValue("l", self->rec->attributes.record_time);
+  PyObject *ret;
+
+  PYLOCK_ACQUIRE(self->lock);
+  ret = Py_BuildValue("l", self->rec->attributes.record_time);
+  PYLOCK_RELEASE(self->lock);
+  return ret;
 }
 
 /* get status */
 static PyObject *BGPRecord_get_status(BGPRecordObject *self, void *closure)
 {
-  switch (self->rec->status) {
+  bgpstream_record_status_t status;
+
+  PYLOCK_ACQUIRE(self->lock);
+  status = self->rec->status;
+  PYLOCK_RELEASE(self->lock);
+
+  switch (status) {
   case BGPSTREAM_RECORD_STATUS_VALID_RECORD:
     return Py_BuildValue("s", "valid");
     break;
@@ -140,7 +184,13 @@ static PyObject *BGPRecord_get_status(BGPRecordObject *self, void *closure)
 static PyObject *BGPRecord_get_dump_position(BGPRecordObject *self,
                                              void *closure)
 {
-  switch (self->rec->dump_pos) {
+  bgpstream_dump_position_t pos;
+
+  PYLOCK_ACQUIRE(self->lock);
+  pos = self->rec->dump_pos;
+  PYLOCK_RELEASE(self->lock);
+
+  switch (pos) {
   case BGPSTREAM_DUMP_START:
     return Py_BuildValue("s", "start");
     break;
@@ -167,10 +217,23 @@ static PyObject *BGPRecord_get_next_elem(BGPRecordObject *self)
 
   PyObject *pyelem;
 
-  if ((elem = bgpstream_record_get_next_elem(self->rec)) == NULL)
+  PYLOCK_ACQUIRE(self->lock);
+
+  /* elem generation may need to parse the record, so let other threads run */
+  Py_BEGIN_ALLOW_THREADS
+  elem = bgpstream_record_get_next_elem(self->rec);
+  Py_END_ALLOW_THREADS
+
+  if (elem == NULL) {
+    PYLOCK_RELEASE(self->lock);
     Py_RETURN_NONE;
+  }
 
-  if ((pyelem = BGPElem_new(elem)) == NULL) {
+  /* the elem belongs to the record, so copy it before unlocking */
+  pyelem = BGPElem_new(elem);
+  PYLOCK_RELEASE(self->lock);
+
+  if (pyelem == NULL) {
     PyErr_SetString(PyExc_RuntimeError, "Could not create BGPElem object");
     return NULL;
   }
@@ -178,11 +241,49 @@ static PyObject *BGPRecord_get_next_elem(BGPRecordObject *self)
   return pyelem;
 }
 
+/* get a batch of elems */
+static PyObject *BGPRecord_get_elem_batch(BGPRecordObject *self,
+                                          PyObject *args)
+{
+  elembatch_t *batch;
+  int max_elems = 0;
+  int ret;
+
+  if (!PyArg_ParseTuple(args, "|i", &max_elems)) {
+    return NULL;
+  }
+
+  if (max_elems < 0) {
+    PyErr_SetString(PyExc_ValueError, "max_elems must not be negative");
+    return NULL;
+  }
+
+  if ((batch = elembatch_create()) == NULL) {
+    return PyErr_NoMemory();
+  }
+
+  PYLOCK_ACQUIRE(self->lock);
+  Py_BEGIN_ALLOW_THREADS
+  ret = elembatch_fill(batch, self->rec, max_elems);
+  Py_END_ALLOW_THREADS
+  PYLOCK_RELEASE(self->lock);
+
+  if (ret < 0) {
+    elembatch_destroy(batch);
+    return PyErr_NoMemory();
+  }
+
+  return BGPElemBatch_new(batch);
+}
+
 static PyMethodDef BGPRecord_methods[] = {
 
   {"get_next_elem", (PyCFunction)BGPRecord_get_next_elem, METH_NOARGS,
    "Get next BGP Elem from the Record"},
 
+  {"get_elem_batch", (PyCFunction)BGPRecord_get_elem_batch, METH_VARARGS,
+   "Get a columnar batch of the remaining BGP Elems in the Record"},
+
   {NULL} /* Sentinel */
 };
 
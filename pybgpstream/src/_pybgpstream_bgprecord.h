@@ -26,6 +26,7 @@
 
 #include "bgpstream.h"
 #include <Python.h>
+#include <pythread.h>
 
 typedef struct {
   PyObject_HEAD
@@ -33,6 +34,10 @@ typedef struct {
     /* BGP Stream Record instance Handle */
     bgpstream_record_t *rec;
 
+  /* Held while the record is being filled, or elems are being generated
+     (both of which happen without the GIL) */
+  PyThread_type_lock lock;
+
 } BGPRecordObject;
 
 /** Expose the BGPRecordType structure */
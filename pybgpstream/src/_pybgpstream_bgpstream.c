@@ -20,6 +20,7 @@
  * You should have received a copy of the GNU General Public License along with
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include "_pybgpstream_bgpelembatch.h"
 #include "_pybgpstream_bgprecord.h"
 #include "pyutils.h"
 #include <Python.h>
@@ -30,6 +31,9 @@ typedef struct {
 
     /* BGP Stream Instance Handle */
     bgpstream_t *bs;
+
+  /* Held while a record is being fetched (without the GIL) */
+  PyThread_type_lock lock;
 } BGPStreamObject;
 
 #define BGPStreamDocstring "BGPStream object"
@@ -40,6 +44,9 @@ static void BGPStream_dealloc(BGPStreamObject *self)
     bgpstream_stop(self->bs);
     bgpstream_destroy(self->bs);
   }
+  if (self->lock != NULL) {
+    PyThread_free_lock(self->lock);
+  }
   Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
@@ -58,6 +65,11 @@ static PyObject *BGPStream_new(PyTypeObject *type, PyObject *args,
     return NULL;
   }
 
+  if ((self->lock = PyThread_allocate_lock()) == NULL) {
+    Py_DECREF(self);
+    return PyErr_NoMemory();
+  }
+
   return (PyObject *)self;
 }
 
@@ -356,7 +368,16 @@ static PyObject *BGPStream_get_next_record(BGPStreamObject *self,
     return NULL;
   }
 
+  /* this may need to download, decompress and parse data, so let other
+     threads run while we wait. the stream is always locked before the
+     record */
+  PYLOCK_ACQUIRE(self->lock);
+  PYLOCK_ACQUIRE(pyrec->lock);
+  Py_BEGIN_ALLOW_THREADS
   ret = bgpstream_get_next_record(self->bs, pyrec->rec);
+  Py_END_ALLOW_THREADS
+  PYLOCK_RELEASE(pyrec->lock);
+  PYLOCK_RELEASE(self->lock);
 
   if (ret < 0) {
     PyErr_SetString(PyExc_RuntimeError,
@@ -370,6 +391,64 @@ static PyObject *BGPStream_get_next_record(BGPStreamObject *self,
   Py_RETURN_TRUE;
 }
 
+/** Fills a batch of elems using bgpstream_get_next_record and
+    bgpstream_record_get_next_elem */
+static PyObject *BGPStream_get_next_elem_batch(BGPStreamObject *self,
+                                               PyObject *args)
+{
+  BGPRecordObject *pyrec = NULL;
+  elembatch_t *batch;
+  int max_elems;
+  int filled;
+  int ret = 1;
+
+  /* get the BGPRecord argument, and the batch size */
+  if (!PyArg_ParseTuple(args, "O!i", _pybgpstream_bgpstream_get_BGPRecordType(),
+                        &pyrec, &max_elems)) {
+    return NULL;
+  }
+
+  if (!pyrec->rec) {
+    PyErr_SetString(PyExc_RuntimeError, "Invalid BGPRecord object");
+    return NULL;
+  }
+
+  if (max_elems <= 0) {
+    PyErr_SetString(PyExc_ValueError, "max_elems must be positive");
+    return NULL;
+  }
+
+  if ((batch = elembatch_create()) == NULL) {
+    return PyErr_NoMemory();
+  }
+
+  /* the record holds our position in the stream between calls, so first use
+     up whatever elems it has left, and then move on to the next records */
+  PYLOCK_ACQUIRE(self->lock);
+  PYLOCK_ACQUIRE(pyrec->lock);
+  Py_BEGIN_ALLOW_THREADS
+  while ((filled = elembatch_fill(batch, pyrec->rec, max_elems)) == 1 &&
+         (ret = bgpstream_get_next_record(self->bs, pyrec->rec)) > 0)
+    ;
+  Py_END_ALLOW_THREADS
+  PYLOCK_RELEASE(pyrec->lock);
+  PYLOCK_RELEASE(self->lock);
+
+  if (filled < 0) {
+    elembatch_destroy(batch);
+    return PyErr_NoMemory();
+  }
+  if (ret < 0) {
+    elembatch_destroy(batch);
+    PyErr_SetString(PyExc_RuntimeError,
+                    "Could not get next elem batch (is the stream started?)");
+    return NULL;
+  }
+
+  /* an empty batch indicates the end of the stream */
+  return BGPElemBatch_new(batch);
+}
+
 static PyMethodDef BGPStream_methods[] = {
   {"parse_filter_string", (PyCFunction)BGPStream_parse_filter_string,
    METH_VARARGS, "Parse a string to add filters to an un-started stream."},
@@ -405,6 +484,10 @@ static PyMethodDef BGPStream_methods[] = {
    "Get the next BGPStreamRecord from the stream, or None if end-of-stream "
    "has been reached"},
 
+  {"get_next_elem_batch", (PyCFunction)BGPStream_get_next_elem_batch,
+   METH_VARARGS,
+   "Get a columnar batch of up to max_elems BGP Elems from the stream"},
+
   {NULL} /* Sentinel */
 };
 
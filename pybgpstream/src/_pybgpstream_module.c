@@ -22,6 +22,7 @@
  */
 
 #include "_pybgpstream_bgpelem.h"
+#include "_pybgpstream_bgpelembatch.h"
 #include "_pybgpstream_bgprecord.h"
 #include "_pybgpstream_bgpstream.h"
 #include <Python.h>
@@ -84,6 +85,12 @@ static PyObject *moduleinit(void)
   /* BGPRecord object */
   ADD_OBJECT(BGPElem);
 
+  /* BGPElemBatch object */
+  ADD_OBJECT(BGPElemBatch);
+
+  /* BGPElemColumn object */
+  ADD_OBJECT(BGPElemColumn);
+
   return m;
 }
 
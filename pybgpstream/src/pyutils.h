@@ -25,6 +25,7 @@
 #define ___PYUTILS_H
 
 #include <Python.h>
+#include <pythread.h>
 
 #ifndef PyVarObject_HEAD_INIT
 #define PyVarObject_HEAD_INIT(type, size) PyObject_HEAD_INIT(type) size,
@@ -48,6 +49,19 @@
 #define PYNUM_FROMLONG(num) PyInt_FromLong(num)
 #endif
 
+/* Acquire a per-object lock. If another thread holds it (probably with the
+   GIL released), release the GIL while we wait so that it can finish */
+#define PYLOCK_ACQUIRE(lock)                                                   \
+  do {                                                                         \
+    if (!PyThread_acquire_lock((lock), NOWAIT_LOCK)) {                         \
+      Py_BEGIN_ALLOW_THREADS                                                   \
+      PyThread_acquire_lock((lock), WAIT_LOCK);                                \
+      Py_END_ALLOW_THREADS                                                     \
+    }                                                                          \
+  } while (0)
+
+#define PYLOCK_RELEASE(lock) PyThread_release_lock(lock)
+
 static inline int add_to_dict(PyObject *dict, const char *key_str,
                               PyObject *value)
 {
@@ -0,0 +1,104 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""A stand-in for the _pybgpstream extension, so that the pure-Python parts of
+pybgpstream can be tested without libBGPStream or any data.
+
+A stream generates one record with a single announcement every RECORD_STEP
+seconds of its interval, for the collector it is filtered on."""
+
+RECORD_STEP = 300
+
+FILTER_TYPES = ['project', 'collector', 'record-type', 'peer-asn', 'prefix',
+                'community', 'prefix-exact', 'prefix-more', 'prefix-less',
+                'prefix-any', 'aspath', 'ipversion', 'elemtype']
+
+
+class BGPElem(object):
+
+    def __init__(self, time):
+        self.time = time
+        self.type = 'A'
+        self.peer_address = '192.0.2.1'
+        self.peer_asn = 65000
+        self.fields = {'prefix': '198.51.100.0/24'}
+
+
+class BGPRecord(object):
+
+    def __init__(self):
+        self.status = 'not-set'
+        self.project = None
+        self.collector = None
+        self.type = None
+        self.time = 0
+        self._elems = []
+
+    def get_next_elem(self):
+        if not self._elems:
+            return None
+        return self._elems.pop(0)
+
+
+class BGPStream(object):
+
+    def __init__(self):
+        self.collector = None
+        self.interval = None
+        self.started = False
+        self.next_time = None
+
+    def set_data_interface(self, name):
+        pass
+
+    def set_data_interface_option(self, interface, name, value):
+        pass
+
+    def add_filter(self, ftype, value):
+        if ftype not in FILTER_TYPES:
+            raise ValueError('Invalid filter type: %s' % ftype)
+        if ftype == 'collector':
+            self.collector = value
+
+    def add_interval_filter(self, start, end):
+        self.interval = (start, end)
+
+    def start(self):
+        if self.interval is None:
+            raise RuntimeError('Could not start stream')
+        self.started = True
+        self.next_time = self.interval[0]
+
+    def get_next_record(self, rec):
+        if not self.started:
+            raise RuntimeError('Stream has not been started')
+        if self.next_time > self.interval[1]:
+            return False
+        rec.status = 'valid'
+        rec.project = 'test'
+        rec.collector = self.collector
+        rec.type = 'update'
+        rec.time = self.next_time
+        rec._elems = [BGPElem(self.next_time)]
+        self.next_time += RECORD_STEP
+        return True
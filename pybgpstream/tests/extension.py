@@ -0,0 +1,91 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Helpers for the tests of the _pybgpstream extension itself. These are run
+against the real extension (built in place, or installed) and the test dumps
+of the libBGPStream source tree:
+
+    python setup.py build_ext --inplace
+    python -m unittest discover -s tests
+
+and are skipped if either cannot be found."""
+
+import importlib
+import os
+import sys
+import unittest
+
+TESTS_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# test dumps shipped with libBGPStream
+DATA_DIR = os.path.join(os.path.dirname(os.path.dirname(TESTS_DIR)), 'test')
+UPDATES_FILE = os.path.join(DATA_DIR, 'ris.rrc06.updates.1427846400.gz')
+OTHER_UPDATES_FILE = os.path.join(
+    DATA_DIR, 'routeviews.route-views.jinx.updates.1427846400.bz2')
+
+
+def load():
+    """Import the real extension, rather than the stand-in in this directory
+    (which test_parallel uses), and without replacing the stand-in for the
+    tests that use it. Returns None if the extension is not available."""
+    path = sys.path[:]
+    stand_in = sys.modules.pop('_pybgpstream', None)
+    sys.path[:] = [p for p in path
+                   if os.path.abspath(p or os.curdir) != TESTS_DIR]
+    try:
+        return importlib.import_module('_pybgpstream')
+    except ImportError:
+        return None
+    finally:
+        sys.path[:] = path
+        sys.modules.pop('_pybgpstream', None)
+        if stand_in is not None:
+            sys.modules['_pybgpstream'] = stand_in
+
+
+_pybgpstream = load()
+
+requires_extension = unittest.skipIf(
+    _pybgpstream is None or not os.path.exists(UPDATES_FILE),
+    'needs the _pybgpstream extension and the libBGPStream test dumps')
+
+
+def create_stream(path=UPDATES_FILE, live=False):
+    """Create and start a stream of the given dump"""
+    stream = _pybgpstream.BGPStream()
+    stream.set_data_interface('singlefile')
+    stream.set_data_interface_option('singlefile', 'upd-file', path)
+    if live:
+        stream.set_live_mode()
+    stream.start()
+    return stream
+
+
+def elems(stream):
+    """Generate the elems of a stream, one BGPElem at a time"""
+    rec = _pybgpstream.BGPRecord()
+    while stream.get_next_record(rec):
+        elem = rec.get_next_elem()
+        while elem is not None:
+            yield elem
+            elem = rec.get_next_elem()
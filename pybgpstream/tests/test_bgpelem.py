@@ -0,0 +1,109 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the field properties of BGPElem, which are checked against its
+fields dict (see extension.py for how to run them)"""
+
+import os
+import re
+import sys
+import unittest
+
+# the helpers in this directory
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from extension import (requires_extension, create_stream, elems, UPDATES_FILE,
+                       OTHER_UPDATES_FILE)
+
+PROPERTIES = ['prefix', 'next_hop', 'as_path', 'as_path_asns', 'origin_asn',
+              'communities']
+
+# an ASN, or an AS set, confederation set or confederation sequence
+SEGMENT = re.compile(r'\{[^}]*\}|\[[^\]]*\]|\([^)]*\)|[0-9]+')
+
+
+def path_asns(as_path):
+    """Parse an 'as-path' field into the tuple that as_path_asns should be"""
+    return tuple(int(seg) if seg.isdigit()
+                 else tuple(int(asn) for asn in re.findall('[0-9]+', seg))
+                 for seg in SEGMENT.findall(as_path))
+
+
+@requires_extension
+class TestBGPElem(unittest.TestCase):
+
+    def check_elem(self, elem):
+        fields = elem.fields
+        self.assertEqual(elem.prefix, fields.get('prefix'))
+        self.assertEqual(elem.next_hop, fields.get('next-hop'))
+        self.assertEqual(elem.as_path, fields.get('as-path'))
+
+        if 'as-path' not in fields:
+            self.assertIsNone(elem.as_path_asns)
+            self.assertIsNone(elem.origin_asn)
+            self.assertIsNone(elem.communities)
+            return
+
+        asns = path_asns(fields['as-path'])
+        self.assertEqual(elem.as_path_asns, asns)
+        if asns and isinstance(asns[-1], int):
+            self.assertEqual(elem.origin_asn, asns[-1])
+        else:
+            self.assertIsNone(elem.origin_asn)
+        self.assertEqual(elem.communities,
+                         tuple((c['asn'], c['value'])
+                               for c in fields['communities']))
+
+    # both dumps are read, as only one of them has an AS set
+    def test_fields(self):
+        types = set()
+        sets = 0
+        for path in (UPDATES_FILE, OTHER_UPDATES_FILE):
+            for elem in elems(create_stream(path)):
+                self.check_elem(elem)
+                types.add(elem.type)
+                if elem.type == 'A':
+                    sets += not isinstance(elem.as_path_asns[-1], int)
+        self.assertEqual(types, set(['A', 'W', 'S']))
+        self.assertGreater(sets, 0)
+
+    def test_cached(self):
+        for elem in elems(create_stream()):
+            if elem.type != 'A' or not elem.communities:
+                continue
+            for name in PROPERTIES:
+                self.assertIs(getattr(elem, name), getattr(elem, name))
+            # the fields dict shares the cached strings
+            self.assertIs(elem.fields['as-path'], elem.as_path)
+            return
+        self.fail('no announcement with communities')
+
+    def test_readonly(self):
+        elem = next(elems(create_stream()))
+        for name in PROPERTIES:
+            with self.assertRaises(AttributeError):
+                setattr(elem, name, None)
+
+
+if __name__ == '__main__':
+    unittest.main()
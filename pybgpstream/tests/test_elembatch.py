@@ -0,0 +1,210 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of BGPElemBatch, which are checked against the BGPElem objects of the
+same elems (see extension.py for how to run them)"""
+
+import os
+import re
+import socket
+import sys
+import unittest
+
+# the helpers in this directory
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from extension import _pybgpstream, requires_extension, create_stream, elems
+
+# not a divisor of the number of elems in the test dump, so that the last
+# batch is only partly filled
+BATCH_SIZE = 100
+
+TYPES = {'R': 1, 'A': 2, 'W': 3, 'S': 4}
+
+# values of bgpstream_elem_peerstate_t
+PEERSTATES = ['UNKNOWN', 'IDLE', 'CONNECT', 'ACTIVE', 'OPENSENT',
+              'OPENCONFIRM', 'ESTABLISHED', 'CLEARING', 'DELETED']
+
+COLUMNS = ['type', 'time', 'peer_asn', 'peer_version', 'peer_address',
+           'prefix_version', 'prefix_len', 'prefix', 'next_hop_version',
+           'next_hop', 'origin_asn', 'path_id', 'old_state', 'new_state',
+           'community_offsets', 'communities', 'path_offsets', 'path_flags',
+           'path_hops']
+
+
+def columns(batch):
+    """Copy the columns of a batch into lists"""
+    return dict((name, memoryview(getattr(batch, name)).tolist())
+                for name in COLUMNS)
+
+
+def packed(address):
+    """Pack an address into 16 bytes, as batches store them"""
+    family = socket.AF_INET6 if ':' in address else socket.AF_INET
+    return list(socket.inet_pton(family, address).ljust(16, b'\0'))
+
+
+def version(address):
+    return 6 if ':' in address else 4
+
+
+@requires_extension
+class TestElemBatch(unittest.TestCase):
+
+    def check_elem(self, cols, i, elem):
+        """Check elem i of a batch against the BGPElem of the same elem"""
+        self.assertEqual(cols['type'][i], TYPES[elem.type])
+        self.assertEqual(cols['time'][i], elem.time)
+        self.assertEqual(cols['peer_asn'][i], elem.peer_asn)
+        self.assertEqual(cols['peer_version'][i], version(elem.peer_address))
+        self.assertEqual(cols['peer_address'][i], packed(elem.peer_address))
+        fields = elem.fields
+
+        if 'prefix' in fields:
+            address, length = fields['prefix'].split('/')
+            self.assertEqual(cols['prefix_version'][i], version(address))
+            self.assertEqual(cols['prefix'][i], packed(address))
+            self.assertEqual(cols['prefix_len'][i], int(length))
+        else:
+            self.assertEqual(cols['prefix_version'][i], 0)
+
+        communities = cols['communities'][cols['community_offsets'][i]:
+                                          cols['community_offsets'][i + 1]]
+        path_id = cols['path_id'][i]
+        if 'as-path' in fields:
+            self.assertEqual(cols['next_hop_version'][i],
+                             version(fields['next-hop']))
+            self.assertEqual(cols['next_hop'][i], packed(fields['next-hop']))
+            self.assertEqual(communities,
+                             [c['asn'] << 16 | c['value']
+                              for c in fields['communities']])
+
+            # sets and confederations are flattened into the hops
+            self.assertGreaterEqual(path_id, 0)
+            hops = cols['path_hops'][cols['path_offsets'][path_id]:
+                                     cols['path_offsets'][path_id + 1]]
+            tokens = fields['as-path'].split()
+            self.assertEqual(hops,
+                             [int(asn)
+                              for asn in re.findall('[0-9]+',
+                                                    fields['as-path'])])
+            self.assertEqual(cols['path_flags'][path_id],
+                             0 if all(t.isdigit() for t in tokens) else 1)
+            origin = tokens[-1] if tokens else ''
+            self.assertEqual(cols['origin_asn'][i],
+                             int(origin) if origin.isdigit() else 0)
+        else:
+            self.assertEqual(path_id, -1)
+            self.assertEqual(cols['next_hop_version'][i], 0)
+            self.assertEqual(communities, [])
+            self.assertEqual(cols['origin_asn'][i], 0)
+
+        if elem.type == 'S':
+            self.assertEqual(PEERSTATES[cols['old_state'][i]],
+                             fields['old-state'])
+            self.assertEqual(PEERSTATES[cols['new_state'][i]],
+                             fields['new-state'])
+
+    def test_stream_batches(self):
+        expected = elems(create_stream())
+        stream = create_stream()
+        rec = _pybgpstream.BGPRecord()
+        sizes = []
+        paths = set()
+        while True:
+            batch = stream.get_next_elem_batch(rec, BATCH_SIZE)
+            if len(batch) == 0:
+                break
+            sizes.append(len(batch))
+            cols = columns(batch)
+            self.assertEqual(len(cols['community_offsets']), len(batch) + 1)
+            for i in range(len(batch)):
+                self.check_elem(cols, i, next(expected))
+
+            # each distinct path is only stored once
+            pool = [tuple(cols['path_hops'][cols['path_offsets'][j]:
+                                            cols['path_offsets'][j + 1]])
+                    for j in range(len(cols['path_offsets']) - 1)]
+            self.assertEqual(len(pool), len(set(pool)))
+            paths.update(pool)
+
+        self.assertIsNone(next(expected, None), 'elems are missing')
+        self.assertEqual(sizes[:-1], [BATCH_SIZE] * (len(sizes) - 1))
+        self.assertLess(sizes[-1], BATCH_SIZE)
+        self.assertGreater(len(paths), 1)
+
+    # the rest of a record's elems can be read as a batch
+    def test_record_batch(self):
+        expected = elems(create_stream())
+        stream = create_stream()
+        rec = _pybgpstream.BGPRecord()
+        read = 0
+        while stream.get_next_record(rec):
+            elem = rec.get_next_elem()
+            if elem is None:
+                continue
+            self.assertEqual(elem.time, next(expected).time)
+            one = rec.get_elem_batch(1)
+            rest = rec.get_elem_batch()
+            self.assertEqual(len(rec.get_elem_batch()), 0)
+            self.assertIsNone(rec.get_next_elem())
+            for batch in (one, rest):
+                cols = columns(batch)
+                for i in range(len(batch)):
+                    self.check_elem(cols, i, next(expected))
+            read += 1 + len(one) + len(rest)
+        self.assertIsNone(next(expected, None), 'elems are missing')
+        self.assertGreater(read, 0)
+
+    def test_bad_sizes(self):
+        stream = create_stream()
+        rec = _pybgpstream.BGPRecord()
+        with self.assertRaises(ValueError):
+            stream.get_next_elem_batch(rec, 0)
+        with self.assertRaises(ValueError):
+            rec.get_elem_batch(-1)
+
+    # columns can be wrapped without copying, and stay valid after the batch
+    # has gone
+    def test_columns(self):
+        stream = create_stream()
+        rec = _pybgpstream.BGPRecord()
+        batch = stream.get_next_elem_batch(rec, BATCH_SIZE)
+        times = memoryview(batch.time)
+        prefixes = memoryview(batch.prefix)
+        self.assertTrue(times.readonly)
+        self.assertEqual((times.format, times.itemsize), ('I', 4))
+        self.assertEqual(times.shape, (BATCH_SIZE,))
+        self.assertEqual(prefixes.shape, (BATCH_SIZE, 16))
+        self.assertEqual(memoryview(batch.path_id).format, 'i')
+        with self.assertRaises(TypeError):
+            times[0] = 0
+
+        copied = times.tolist()
+        del batch
+        stream.get_next_elem_batch(rec, BATCH_SIZE)
+        self.assertEqual(times.tolist(), copied)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,135 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests for pybgpstream.parallel, run against the _pybgpstream stand-in in
+this directory:
+
+    python -m unittest discover -s tests
+"""
+
+import os
+import sys
+import threading
+import unittest
+
+# use the stand-in (this also makes it visible to the worker processes), and
+# the pybgpstream package from this source tree
+TESTS_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.dirname(TESTS_DIR))
+sys.path.insert(0, TESTS_DIR)
+
+import _pybgpstream
+from pybgpstream import parallel
+
+START = 1427846400
+DURATION = 3600
+COLLECTORS = ['rrc00', 'route-views2']
+
+# how long to wait for the pool before deciding that it hangs
+TIMEOUT = 30
+
+
+def count_records(stream, shard):
+    rec = _pybgpstream.BGPRecord()
+    cnt = 0
+    while stream.get_next_record(rec):
+        cnt += 1
+    return cnt
+
+
+class TestShardPool(unittest.TestCase):
+
+    def run_pool(self, func, threads, filters=None):
+        """Run func(pool, shards) in a thread, failing the test if it has not
+        returned after TIMEOUT seconds. Returns what func returned, or raises
+        what it raised"""
+        shards = parallel.partition(START, START + 2 * DURATION, COLLECTORS,
+                                    'updates', duration=DURATION)
+        outcome = {}
+
+        def run():
+            try:
+                with parallel.ShardPool(workers=2, threads=threads,
+                                        filters=filters) as pool:
+                    outcome['result'] = func(pool, shards)
+            except Exception as e:
+                outcome['error'] = e
+
+        thread = threading.Thread(target=run)
+        thread.daemon = True
+        thread.start()
+        thread.join(TIMEOUT)
+        self.assertFalse(thread.is_alive(), 'the shard pool hangs')
+        if 'error' in outcome:
+            raise outcome['error']
+        return outcome['result']
+
+    def check_elems(self, threads):
+        elems = self.run_pool(lambda pool, shards: list(pool.elems(shards)),
+                              threads)
+        per_collector = DURATION // _pybgpstream.RECORD_STEP * 2
+        self.assertEqual(len(elems), per_collector * len(COLLECTORS))
+        times = [e.time for e in elems]
+        self.assertEqual(times, sorted(times))
+        for collector in COLLECTORS:
+            self.assertEqual(
+                len([e for e in elems if e.collector == collector]),
+                per_collector)
+
+    def test_elems_threads(self):
+        self.check_elems(True)
+
+    def test_elems_processes(self):
+        self.check_elems(False)
+
+    def test_map(self):
+        results = self.run_pool(
+            lambda pool, shards: list(pool.map(count_records, shards,
+                                               ordered=True)),
+            True)
+        self.assertEqual(len(results), 2 * len(COLLECTORS))
+        for shard, cnt in results:
+            self.assertEqual(cnt, DURATION // _pybgpstream.RECORD_STEP)
+
+    # a shard whose stream cannot be created must make elems raise, rather
+    # than leave the reader waiting for elems that will never come
+    def check_bad_filter(self, threads):
+        with self.assertRaises(ValueError):
+            self.run_pool(lambda pool, shards: list(pool.elems(shards)),
+                          threads, filters=[('bogus', 'value')])
+
+    def test_bad_filter_threads(self):
+        self.check_bad_filter(True)
+
+    def test_bad_filter_processes(self):
+        self.check_bad_filter(False)
+
+    def test_bad_filter_map(self):
+        with self.assertRaises(ValueError):
+            self.run_pool(
+                lambda pool, shards: list(pool.map(count_records, shards)),
+                True, filters=[('bogus', 'value')])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,151 @@
+#
+# This file is part of pybgpstream
+#
+# CAIDA, UC San Diego
+# bgpstream-info@caida.org
+#
+# Copyright (C) 2015 The Regents of the University of California.
+# Authors: Alistair King
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests that the _pybgpstream extension can be used from several threads at
+once (see extension.py for how to run them)"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import unittest
+
+# the helpers in this directory
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from extension import _pybgpstream, requires_extension, create_stream, \
+    UPDATES_FILE, OTHER_UPDATES_FILE
+
+THREADS = 4
+
+# how long to wait for a thread before deciding that it hangs
+TIMEOUT = 30
+
+# how long to give a reader to block waiting for live data
+BLOCK_SECS = 0.5
+
+# if the GIL is not released, nothing in this process can write the live data
+# that a blocked reader is waiting for, so it is written by another process
+# after this long
+WATCHDOG_SECS = 10
+
+WATCHDOG_SCRIPT = ('import shutil, sys, time\n'
+                   'time.sleep(float(sys.argv[1]))\n'
+                   'shutil.copy(sys.argv[2], sys.argv[3])\n')
+
+
+def count(stream):
+    """Count the records and elems left in a stream"""
+    rec = _pybgpstream.BGPRecord()
+    records = elems = 0
+    while stream.get_next_record(rec):
+        records += 1
+        while rec.get_next_elem() is not None:
+            elems += 1
+    return records, elems
+
+
+@requires_extension
+class TestThreads(unittest.TestCase):
+
+    def run_threads(self, target):
+        """Run target(i) in THREADS threads, returning what each returned"""
+        results = [None] * THREADS
+
+        def run(i):
+            results[i] = target(i)
+
+        threads = [threading.Thread(target=run, args=(i,))
+                   for i in range(THREADS)]
+        for thread in threads:
+            thread.daemon = True
+            thread.start()
+        for thread in threads:
+            thread.join(TIMEOUT)
+            self.assertFalse(thread.is_alive(), 'a reader hangs')
+        return results
+
+    def test_separate_streams(self):
+        expected = count(create_stream())
+        self.assertGreater(expected[1], 0)
+        results = self.run_threads(lambda i: count(create_stream()))
+        self.assertEqual(results, [expected] * THREADS)
+
+    # each record is read by exactly one of the threads
+    def test_shared_stream(self):
+        expected = count(create_stream())
+        stream = create_stream()
+        results = self.run_threads(lambda i: count(stream))
+        self.assertEqual(sum(r[0] for r in results), expected[0])
+        self.assertEqual(sum(r[1] for r in results), expected[1])
+
+    def test_blocked_read_releases_gil(self):
+        tmp_dir = tempfile.mkdtemp()
+        path = os.path.join(tmp_dir, 'updates')
+        shutil.copy(UPDATES_FILE, path)
+        records = count(create_stream(path))[0]
+        watchdog = None
+        outcome = {}
+
+        # read everything that is there, so that the next read blocks until
+        # the file is re-written
+        stream = create_stream(path, live=True)
+        rec = _pybgpstream.BGPRecord()
+        for i in range(records):
+            self.assertTrue(stream.get_next_record(rec))
+
+        def read():
+            entered.set()
+            outcome['read'] = stream.get_next_record(rec)
+            outcome['returned'] = time.time()
+
+        entered = threading.Event()
+        reader = threading.Thread(target=read)
+        reader.daemon = True
+        try:
+            watchdog = subprocess.Popen(
+                [sys.executable, '-c', WATCHDOG_SCRIPT, str(WATCHDOG_SECS),
+                 OTHER_UPDATES_FILE, path])
+            reader.start()
+            entered.wait()
+            time.sleep(BLOCK_SECS)
+            written = time.time()
+            shutil.copy(OTHER_UPDATES_FILE, path)
+            reader.join(TIMEOUT)
+            self.assertFalse(reader.is_alive(), 'the reader hangs')
+        finally:
+            if watchdog is not None:
+                watchdog.kill()
+                watchdog.wait()
+            shutil.rmtree(tmp_dir)
+
+        self.assertTrue(outcome['read'])
+        # this thread ran while the reader was waiting
+        self.assertLess(written, outcome['returned'])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,309 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro_checkpoint.h"
+#include "bgpcorsaro_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NAME "bgpcorsaro-test-checkpoint"
+
+#define CHECKPOINT_FILE NAME ".ckpt"
+
+/* scratch copy of the checkpoint file that is corrupted by the tests */
+#define CORRUPT_FILE NAME ".corrupt.ckpt"
+
+/* output of the run without checkpoints */
+#define FULL_OUTPUT NAME ".full.routingtables"
+
+/* output of the run that resumes from the checkpoint */
+#define RESUMED_OUTPUT NAME ".resumed.routingtables"
+
+/* output template of a bgpcorsaro that runs a different plugin */
+#define OTHER_TEMPLATE NAME ".other.%X"
+
+/* the checkpointed run is stopped part of the way through interval 2, so
+   the last checkpoint is taken at the end of interval 1 */
+#define STOP_TIME (BGPCORSARO_TEST_START + 1500)
+#define RESUME_INTERVAL 2
+#define RESUME_TIME (BGPCORSARO_TEST_START + 1200)
+
+/* offset of the format version, and of the length of the first chunk of the
+   routingtables section, in a checkpoint file */
+#define VERSION_OFFSET 8
+#define CHUNK_LEN_OFFSET (22 + 1 + sizeof("routingtables") - 1)
+
+/* truncations that are tested */
+#define TRUNCATE_ALL_LEN 40
+#define TRUNCATE_STEP 499
+
+static bgpcorsaro_t *create(const char *output, const char *checkpoint,
+                            int interval)
+{
+  char template[1024];
+  bgpcorsaro_t *bc;
+
+  snprintf(template, sizeof(template), "%s.%%X", output);
+  if ((bc = bgpcorsaro_alloc_output(template)) == NULL) {
+    return NULL;
+  }
+  bgpcorsaro_disable_logfile(bc);
+  bgpcorsaro_set_interval(bc, interval);
+  if (bgpcorsaro_enable_plugin(bc, "routingtables", "-s 2") != 0 ||
+      (checkpoint != NULL &&
+       bgpcorsaro_set_checkpoint(bc, checkpoint, 1) != 0)) {
+    bgpcorsaro_finalize_output(bc);
+    return NULL;
+  }
+  return bc;
+}
+
+static int copy_file(const char *src, const char *dst, long len)
+{
+  FILE *in, *out;
+  int c;
+  long i;
+  int rc = 0;
+
+  if ((in = fopen(src, "r")) == NULL) {
+    return -1;
+  }
+  if ((out = fopen(dst, "w")) == NULL) {
+    fclose(in);
+    return -1;
+  }
+  for (i = 0; len < 0 || i < len; i++) {
+    if ((c = fgetc(in)) == EOF) {
+      rc = len < 0 ? 0 : -1;
+      break;
+    }
+    fputc(c, out);
+  }
+  fclose(in);
+  fclose(out);
+  return rc;
+}
+
+static long file_len(const char *path)
+{
+  FILE *fh;
+  long len;
+
+  if ((fh = fopen(path, "r")) == NULL) {
+    return -1;
+  }
+  len = fseek(fh, 0, SEEK_END) == 0 ? ftell(fh) : -1;
+  fclose(fh);
+  return len;
+}
+
+/* overwrite len bytes of the file at the given offset */
+static int patch_file(const char *path, long offset, const void *buf,
+                      size_t len)
+{
+  FILE *fh;
+  int rc;
+
+  if ((fh = fopen(path, "r+")) == NULL) {
+    return -1;
+  }
+  rc = fseek(fh, offset, SEEK_SET) == 0 && fwrite(buf, 1, len, fh) == len
+         ? 0
+         : -1;
+  fclose(fh);
+  return rc;
+}
+
+/* load the checkpoint into a fresh bgpcorsaro */
+static int load(const char *path, bgpcorsaro_checkpoint_pos_t *pos)
+{
+  bgpcorsaro_t *bc;
+  int rc = -100;
+
+  if ((bc = create(NAME ".load", NULL, BGPCORSARO_TEST_INTERVAL)) == NULL) {
+    return -100;
+  }
+  if (bgpcorsaro_start_output(bc) == 0) {
+    rc = bgpcorsaro_checkpoint_load(bc, path, pos);
+  }
+  bgpcorsaro_finalize_output(bc);
+  return rc;
+}
+
+static int test_save_load()
+{
+  bgpcorsaro_t *bc;
+  bgpcorsaro_checkpoint_pos_t pos = {BGPCORSARO_TEST_INTERVAL, 7,
+                                     BGPCORSARO_TEST_START + 4200};
+  bgpcorsaro_checkpoint_pos_t loaded;
+
+  unlink(CHECKPOINT_FILE);
+  CHECK("missing checkpoint is reported",
+        load(CHECKPOINT_FILE, &loaded) == 1);
+
+  CHECK("create bgpcorsaro",
+        (bc = create(NAME ".save", NULL, BGPCORSARO_TEST_INTERVAL)) != NULL);
+  CHECK("start bgpcorsaro", bgpcorsaro_start_output(bc) == 0);
+  CHECK("process records",
+        bgpcorsaro_test_run(bc, NAME, BGPCORSARO_TEST_START + 900) == 0);
+  CHECK("save checkpoint",
+        bgpcorsaro_checkpoint_save(bc, CHECKPOINT_FILE, &pos) == 0);
+  CHECK("temporary file is renamed",
+        access(CHECKPOINT_FILE ".tmp", F_OK) != 0);
+  bgpcorsaro_test_finalize(bc);
+
+  memset(&loaded, 0, sizeof(loaded));
+  CHECK("load checkpoint", load(CHECKPOINT_FILE, &loaded) == 0);
+  CHECK("position is restored",
+        loaded.interval == pos.interval &&
+          loaded.interval_number == pos.interval_number &&
+          loaded.resume_time == pos.resume_time);
+
+  return 0;
+}
+
+static int test_resume()
+{
+  bgpcorsaro_t *bc;
+  char *full = NULL, *resumed = NULL;
+  const char *full_resumed;
+  int ok;
+
+  CHECK("create bgpcorsaro without checkpoints",
+        (bc = create(NAME ".full", NULL, BGPCORSARO_TEST_INTERVAL)) != NULL);
+  CHECK("start bgpcorsaro", bgpcorsaro_start_output(bc) == 0);
+  CHECK("process all records", bgpcorsaro_test_run(bc, NAME, 0) == 0);
+  CHECK("finalize bgpcorsaro", bgpcorsaro_test_finalize(bc) == 0);
+
+  unlink(CHECKPOINT_FILE);
+  CHECK("create bgpcorsaro with checkpoints",
+        (bc = create(NAME ".stopped", CHECKPOINT_FILE,
+                     BGPCORSARO_TEST_INTERVAL)) != NULL);
+  CHECK("start bgpcorsaro without a checkpoint",
+        bgpcorsaro_start_output(bc) == 0 &&
+          bgpcorsaro_get_resume_time(bc) == 0);
+  CHECK("process the first records",
+        bgpcorsaro_test_run(bc, NAME, STOP_TIME) == 0);
+  CHECK("finalize bgpcorsaro", bgpcorsaro_test_finalize(bc) == 0);
+  CHECK("checkpoint was written", access(CHECKPOINT_FILE, F_OK) == 0);
+
+  CHECK("create resumed bgpcorsaro",
+        (bc = create(NAME ".resumed", CHECKPOINT_FILE,
+                     BGPCORSARO_TEST_INTERVAL)) != NULL);
+  CHECK("start bgpcorsaro from the checkpoint",
+        bgpcorsaro_start_output(bc) == 0);
+  CHECK("resume at the interval after the checkpoint",
+        bgpcorsaro_get_resume_time(bc) == RESUME_TIME);
+  CHECK("process the remaining records", bgpcorsaro_test_run(bc, NAME, 0) == 0);
+  CHECK("finalize bgpcorsaro", bgpcorsaro_test_finalize(bc) == 0);
+
+  CHECK("read outputs",
+        (full = bgpcorsaro_test_read_output(FULL_OUTPUT)) != NULL &&
+          (resumed = bgpcorsaro_test_read_output(RESUMED_OUTPUT)) != NULL);
+  full_resumed = bgpcorsaro_test_find_interval(full, RESUME_INTERVAL);
+  ok = full_resumed != NULL && strstr(full, "|A|") != NULL &&
+       strstr(full_resumed, "|R|") != NULL;
+  ok &= resumed == bgpcorsaro_test_find_interval(resumed, RESUME_INTERVAL);
+  ok &= full_resumed != NULL && strcmp(full_resumed, resumed) == 0;
+  free(full);
+  free(resumed);
+  CHECK("resumed output matches the output without checkpoints", ok);
+
+  return 0;
+}
+
+static int test_corrupt()
+{
+  bgpcorsaro_t *bc;
+  bgpcorsaro_checkpoint_pos_t pos;
+  uint8_t bad_version[] = {0, 0, 0, 2};
+  uint8_t bad_chunk_len[] = {0, 1, 0, 1};
+  long len, i;
+  int ok = 1;
+
+  CHECK("checkpoint exists", (len = file_len(CHECKPOINT_FILE)) > 0);
+
+  /* every length at the start and end of the file, and a sample of the
+     rest */
+  for (i = 0; i < len; i++) {
+    if (i >= TRUNCATE_ALL_LEN && i < len - TRUNCATE_ALL_LEN &&
+        i % TRUNCATE_STEP != 0) {
+      continue;
+    }
+    ok &= copy_file(CHECKPOINT_FILE, CORRUPT_FILE, i) == 0 &&
+          load(CORRUPT_FILE, &pos) == -1;
+  }
+  CHECK("truncated checkpoints are rejected", ok);
+
+  CHECK("copy checkpoint", copy_file(CHECKPOINT_FILE, CORRUPT_FILE, -1) == 0);
+  CHECK("intact copy is accepted", load(CORRUPT_FILE, &pos) == 0);
+
+  CHECK("checkpoint with a bad magic number is rejected",
+        patch_file(CORRUPT_FILE, 0, "X", 1) == 0 &&
+          load(CORRUPT_FILE, &pos) == -1);
+
+  CHECK("copy checkpoint", copy_file(CHECKPOINT_FILE, CORRUPT_FILE, -1) == 0);
+  CHECK("checkpoint with an unknown version is rejected",
+        patch_file(CORRUPT_FILE, VERSION_OFFSET, bad_version,
+                   sizeof(bad_version)) == 0 &&
+          load(CORRUPT_FILE, &pos) == -1);
+
+  CHECK("copy checkpoint", copy_file(CHECKPOINT_FILE, CORRUPT_FILE, -1) == 0);
+  CHECK("checkpoint with an oversized chunk is rejected",
+        patch_file(CORRUPT_FILE, CHUNK_LEN_OFFSET, bad_chunk_len,
+                   sizeof(bad_chunk_len)) == 0 &&
+          load(CORRUPT_FILE, &pos) == -1);
+
+  CHECK("create bgpcorsaro with a different interval",
+        (bc = create(NAME ".interval", CHECKPOINT_FILE,
+                     BGPCORSARO_TEST_INTERVAL * 2)) != NULL);
+  CHECK("checkpoint with a different interval is rejected",
+        bgpcorsaro_start_output(bc) != 0);
+  bgpcorsaro_finalize_output(bc);
+
+  CHECK("create bgpcorsaro with another plugin",
+        (bc = bgpcorsaro_alloc_output(OTHER_TEMPLATE)) != NULL);
+  bgpcorsaro_disable_logfile(bc);
+  bgpcorsaro_set_interval(bc, BGPCORSARO_TEST_INTERVAL);
+  ok = bgpcorsaro_enable_plugin(bc, "pfxmonitor", "-l 10.0.0.0/8") == 0 &&
+       bgpcorsaro_start_output(bc) == 0 &&
+       bgpcorsaro_checkpoint_load(bc, CHECKPOINT_FILE, &pos) == 0;
+  bgpcorsaro_finalize_output(bc);
+  CHECK("state of plugins that are not enabled is skipped", ok);
+
+  unlink(CORRUPT_FILE);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("write dumps", bgpcorsaro_test_write_dumps(NAME, 0) == 0);
+  CHECK_SECTION("checkpoint save and load", test_save_load() == 0);
+  CHECK_SECTION("resume from checkpoint", test_resume() == 0);
+  CHECK_SECTION("corrupt checkpoints", test_corrupt() == 0);
+  return 0;
+}
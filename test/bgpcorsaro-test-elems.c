@@ -0,0 +1,166 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro_test.h"
+#include "bgpcorsaro_elems.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NAME "bgpcorsaro-test-elems"
+
+/* most elems that a record of the test dumps can have */
+#define MAX_ELEMS 256
+
+#define ELEM_LEN 1024
+
+/* elems of the current record, as returned by bgpstream */
+static char expected[MAX_ELEMS][ELEM_LEN];
+static int expected_cnt;
+
+/* check that the next elem matches the given expected elem */
+static int elem_matches(bgpstream_elem_t *elem, int idx)
+{
+  char buf[ELEM_LEN];
+
+  if (idx >= expected_cnt) {
+    return elem == NULL;
+  }
+  return elem != NULL &&
+         bgpstream_elem_snprintf(buf, sizeof(buf), elem) != NULL &&
+         strcmp(buf, expected[idx]) == 0;
+}
+
+/* collect the elems of the record straight from bgpstream */
+static int collect_expected(bgpstream_record_t *record)
+{
+  bgpstream_elem_t *elem;
+
+  expected_cnt = 0;
+  while ((elem = bgpstream_record_get_next_elem(record)) != NULL) {
+    if (expected_cnt == MAX_ELEMS ||
+        bgpstream_elem_snprintf(expected[expected_cnt], ELEM_LEN, elem) ==
+          NULL) {
+      return -1;
+    }
+    expected_cnt++;
+  }
+  return 0;
+}
+
+/* check that bgpstream returns the same elems again */
+static int check_bgpstream_elems(bgpstream_record_t *record)
+{
+  int i;
+
+  for (i = 0; i <= expected_cnt; i++) {
+    if (!elem_matches(bgpstream_record_get_next_elem(record), i)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* check that two plugins walking the shared elems in turn both see the same
+   elems as bgpstream returned */
+static int check_shared_elems(bgpstream_record_t *record,
+                              bgpcorsaro_elems_t *elems)
+{
+  bgpcorsaro_record_t a, b;
+  int i;
+
+  memset(&a, 0, sizeof(a));
+  a.bsrecord = record;
+  a.elems = elems;
+  b = a;
+
+  for (i = 0; i <= expected_cnt; i++) {
+    if (!elem_matches(bgpcorsaro_record_get_next_elem(&a), i)) {
+      return -1;
+    }
+    /* the second plugin lags behind the first one */
+    if (i > 0 && !elem_matches(bgpcorsaro_record_get_next_elem(&b), i - 1)) {
+      return -1;
+    }
+  }
+  return elem_matches(bgpcorsaro_record_get_next_elem(&b), expected_cnt) ? 0
+                                                                         : -1;
+}
+
+static int test_elems()
+{
+  bgpstream_t *bs;
+  bgpstream_record_t *record;
+  bgpcorsaro_elems_t *elems;
+  int records = 0, populated = 0, shared = 0, rewound = 0, partial = 0;
+  int elems_total = 0;
+  int rc;
+
+  CHECK("write dumps", bgpcorsaro_test_write_dumps(NAME, 0) == 0);
+  CHECK("create stream",
+        (bs = bgpcorsaro_test_stream_create(NAME, BGPCORSARO_TEST_START)) !=
+          NULL);
+  CHECK("create record", (record = bgpstream_record_create()) != NULL);
+  CHECK("create elem list", (elems = bgpcorsaro_elems_create()) != NULL);
+
+  while ((rc = bgpstream_get_next_record(bs, record)) > 0) {
+    records++;
+    if (collect_expected(record) != 0) {
+      break;
+    }
+    elems_total += expected_cnt;
+
+    /* rewinding after a partial walk starts again from the first elem */
+    bgpstream_record_rewind_elems(record);
+    bgpstream_record_get_next_elem(record);
+    bgpstream_record_rewind_elems(record);
+    partial += check_bgpstream_elems(record) == 0;
+
+    bgpstream_record_rewind_elems(record);
+    populated += bgpcorsaro_elems_populate(elems, record) == 0;
+    shared += check_shared_elems(record, elems) == 0;
+
+    /* populating leaves the record rewound for plugins that use bgpstream
+       directly */
+    rewound += check_bgpstream_elems(record) == 0;
+  }
+
+  CHECK("read all records", rc == 0 && records > 0);
+  CHECK("records have elems", elems_total > records);
+  CHECK("rewind after a partial walk", partial == records);
+  CHECK("populate elems", populated == records);
+  CHECK("shared elems match bgpstream elems", shared == records);
+  CHECK("populate rewinds the record", rewound == records);
+
+  bgpcorsaro_elems_destroy(elems);
+  bgpstream_record_destroy(record);
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("shared elems", test_elems() == 0);
+  return 0;
+}
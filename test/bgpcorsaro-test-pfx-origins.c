@@ -0,0 +1,328 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro_pfx_origins.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+
+/* number of cells in a new table, and the hash used to place cells (both must
+   match bgpcorsaro_pfx_origins.c) */
+#define CELLS_CNT 1024
+
+static uint32_t cell_home(uint32_t pfx_id, uint32_t peer_asn)
+{
+  uint64_t k = ((uint64_t)pfx_id << 32) | peer_asn;
+
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return (uint32_t)k & (CELLS_CNT - 1);
+}
+
+/* the IPv4 prefix 10.0.<n>.0/24 */
+static bgpstream_pfx_storage_t *pfx(int n)
+{
+  static bgpstream_pfx_storage_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.address.version = BGPSTREAM_ADDR_VERSION_IPV4;
+  p.address.ipv4.s_addr = htonl(0x0a000000 | (n << 8));
+  p.mask_len = 24;
+  return &p;
+}
+
+/* the IPv6 prefix 2001:db8:<n>::/48 */
+static bgpstream_pfx_storage_t *pfx6(int n)
+{
+  static bgpstream_pfx_storage_t p;
+
+  memset(&p, 0, sizeof(p));
+  p.address.version = BGPSTREAM_ADDR_VERSION_IPV6;
+  p.address.ipv6.s6_addr[0] = 0x20;
+  p.address.ipv6.s6_addr[1] = 0x01;
+  p.address.ipv6.s6_addr[2] = 0x0d;
+  p.address.ipv6.s6_addr[3] = 0xb8;
+  p.address.ipv6.s6_addr[4] = n >> 8;
+  p.address.ipv6.s6_addr[5] = n & 0xff;
+  p.mask_len = 48;
+  return &p;
+}
+
+static int pfx_num(const bgpstream_pfx_storage_t *p)
+{
+  if (p->address.version == BGPSTREAM_ADDR_VERSION_IPV6) {
+    return (p->address.ipv6.s6_addr[4] << 8) | p->address.ipv6.s6_addr[5];
+  }
+  return (ntohl(p->address.ipv4.s_addr) >> 8) & 0xffff;
+}
+
+/* what walk_visible reported for each prefix */
+#define PFXS_MAX 64
+
+typedef struct walk {
+  int visits[PFXS_MAX];
+  int origins_cnt[PFXS_MAX];
+  uint32_t origin[PFXS_MAX];
+} walk_t;
+
+static void walk_visit(const bgpstream_pfx_storage_t *p,
+                       const uint32_t *origins, int origins_cnt, void *user)
+{
+  walk_t *w = (walk_t *)user;
+  int n = pfx_num(p);
+
+  w->visits[n]++;
+  w->origins_cnt[n] = origins_cnt;
+  w->origin[n] = origins_cnt > 0 ? origins[0] : 0;
+}
+
+static int walk(bgpcorsaro_pfx_origins_t *t, uint32_t th, walk_t *w)
+{
+  memset(w, 0, sizeof(walk_t));
+  return bgpcorsaro_pfx_origins_walk_visible(t, th, walk_visit, w);
+}
+
+/* visible prefixes and distinct visible origins, as found by walking the
+   table (with the same origins for IPv4 and IPv6) */
+typedef struct visible {
+  uint32_t pfxs[2];
+  uint32_t origins[2];
+  uint8_t seen[2][16];
+} visible_t;
+
+static void visible_visit(const bgpstream_pfx_storage_t *p,
+                          const uint32_t *origins, int origins_cnt, void *user)
+{
+  visible_t *v = (visible_t *)user;
+  int idx = p->address.version == BGPSTREAM_ADDR_VERSION_IPV6;
+  int i;
+
+  if (origins_cnt > 0) {
+    v->pfxs[idx]++;
+  }
+  for (i = 0; i < origins_cnt; i++) {
+    if (v->seen[idx][origins[i]]++ == 0) {
+      v->origins[idx]++;
+    }
+  }
+}
+
+static int counters_match(bgpcorsaro_pfx_origins_t *t, uint32_t th)
+{
+  visible_t v;
+  uint32_t all_origins = 0;
+  int i;
+
+  memset(&v, 0, sizeof(v));
+  if (bgpcorsaro_pfx_origins_walk_visible(t, th, visible_visit, &v) != 0) {
+    return 0;
+  }
+  for (i = 0; i < 16; i++) {
+    all_origins += (v.seen[0][i] != 0 || v.seen[1][i] != 0);
+  }
+
+  return bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+           t, BGPSTREAM_ADDR_VERSION_IPV4) == v.pfxs[0] &&
+         bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+           t, BGPSTREAM_ADDR_VERSION_IPV6) == v.pfxs[1] &&
+         bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+           t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == v.pfxs[0] + v.pfxs[1] &&
+         bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+           t, BGPSTREAM_ADDR_VERSION_IPV4) == v.origins[0] &&
+         bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+           t, BGPSTREAM_ADDR_VERSION_IPV6) == v.origins[1] &&
+         bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+           t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == all_origins;
+}
+
+static int keep_odd(const bgpstream_pfx_storage_t *p, void *user)
+{
+  return pfx_num(p) % 2;
+}
+
+static int test_set_remove()
+{
+  bgpcorsaro_pfx_origins_t *t;
+  walk_t w;
+
+  CHECK("create table", (t = bgpcorsaro_pfx_origins_create()) != NULL);
+
+  CHECK("set origins", bgpcorsaro_pfx_origins_set(t, pfx(1), 100, 1) == 0 &&
+                         bgpcorsaro_pfx_origins_set(t, pfx(1), 200, 1) == 0 &&
+                         bgpcorsaro_pfx_origins_set(t, pfx(2), 100, 2) == 0);
+  CHECK("prefix count", bgpcorsaro_pfx_origins_get_pfx_cnt(t) == 2);
+
+  CHECK("walk", walk(t, 2, &w) == 0);
+  CHECK("origin seen by two peers is visible",
+        w.visits[1] == 1 && w.origins_cnt[1] == 1 && w.origin[1] == 1);
+  CHECK("origin seen by one peer is not visible",
+        w.visits[2] == 1 && w.origins_cnt[2] == 0);
+
+  CHECK("change origin", bgpcorsaro_pfx_origins_set(t, pfx(1), 200, 3) == 0);
+  CHECK("walk", walk(t, 1, &w) == 0);
+  CHECK("both origins are visible", w.origins_cnt[1] == 2);
+  CHECK("walk", walk(t, 2, &w) == 0);
+  CHECK("no origin is visible", w.origins_cnt[1] == 0);
+
+  bgpcorsaro_pfx_origins_remove(t, pfx(1), 100);
+  bgpcorsaro_pfx_origins_remove(t, pfx(1), 300);
+  bgpcorsaro_pfx_origins_remove(t, pfx(3), 100);
+  CHECK("remove", bgpcorsaro_pfx_origins_get_pfx_cnt(t) == 2);
+  bgpcorsaro_pfx_origins_remove(t, pfx(1), 200);
+  CHECK("remove last peer", bgpcorsaro_pfx_origins_get_pfx_cnt(t) == 1);
+  CHECK("walk", walk(t, 1, &w) == 0);
+  CHECK("removed prefix is gone", w.visits[1] == 0 && w.visits[2] == 1);
+
+  bgpcorsaro_pfx_origins_destroy(t);
+  return 0;
+}
+
+/* cells for all prefixes are placed at the same home near the end of the
+   table, so that the cluster wraps around to the start */
+static int test_retain_wrap()
+{
+  bgpcorsaro_pfx_origins_t *t;
+  walk_t w;
+  uint32_t peer;
+  int n;
+  int ok;
+
+  CHECK("create table", (t = bgpcorsaro_pfx_origins_create()) != NULL);
+
+  /* prefix IDs are assigned in order, starting at 0 */
+  ok = 1;
+  for (n = 0; n < 32; n++) {
+    for (peer = 1; cell_home(n, peer) != CELLS_CNT - 3; peer++)
+      ;
+    ok &= bgpcorsaro_pfx_origins_set(t, pfx(n), peer, 1000 + n) == 0;
+  }
+  CHECK("fill wrapped cluster", ok);
+
+  bgpcorsaro_pfx_origins_retain(t, keep_odd, NULL);
+  CHECK("retain odd prefixes", bgpcorsaro_pfx_origins_get_pfx_cnt(t) == 16);
+
+  CHECK("walk", walk(t, 1, &w) == 0);
+  ok = 1;
+  for (n = 0; n < 32; n++) {
+    ok &= (n % 2) ? (w.visits[n] == 1 && w.origins_cnt[n] == 1 &&
+                     w.origin[n] == 1000 + n)
+                  : (w.visits[n] == 0);
+  }
+  CHECK("only retained prefixes remain", ok);
+
+  /* dropped prefixes get their old IDs back, so any of their cells that were
+     left behind would show up again */
+  ok = 1;
+  for (n = 0; n < 32; n += 2) {
+    ok &= bgpcorsaro_pfx_origins_set(t, pfx(n), 1, 2000 + n) == 0;
+  }
+  CHECK("add dropped prefixes again", ok);
+  CHECK("walk", walk(t, 1, &w) == 0);
+  ok = 1;
+  for (n = 0; n < 32; n += 2) {
+    ok &= w.visits[n] == 1 && w.origins_cnt[n] == 1 && w.origin[n] == 2000 + n;
+  }
+  CHECK("no cells of dropped prefixes are left", ok);
+
+  bgpcorsaro_pfx_origins_destroy(t);
+  return 0;
+}
+
+static int test_visible()
+{
+  bgpcorsaro_pfx_origins_t *t;
+  bgpstream_pfx_storage_t *p;
+  uint32_t seed = 1;
+  int i, n;
+  int ok;
+
+  CHECK("create table", (t = bgpcorsaro_pfx_origins_create()) != NULL);
+  CHECK("track visibility", bgpcorsaro_pfx_origins_track_visible(t, 2) == 0);
+
+  CHECK("set origins", bgpcorsaro_pfx_origins_set(t, pfx(1), 100, 1) == 0 &&
+                         bgpcorsaro_pfx_origins_set(t, pfx(2), 100, 1) == 0 &&
+                         bgpcorsaro_pfx_origins_set(t, pfx6(1), 100, 1) == 0);
+  CHECK("origin seen by one peer is not visible",
+        bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+          t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == 0 &&
+          bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+            t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == 0);
+
+  CHECK("set origins", bgpcorsaro_pfx_origins_set(t, pfx(1), 200, 1) == 0 &&
+                         bgpcorsaro_pfx_origins_set(t, pfx6(1), 200, 1) == 0);
+  CHECK("origin seen by two peers is visible",
+        bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+          t, BGPSTREAM_ADDR_VERSION_IPV4) == 1 &&
+          bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+            t, BGPSTREAM_ADDR_VERSION_IPV6) == 1 &&
+          bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+            t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == 2);
+  CHECK("origin visible for both versions is counted once in total",
+        bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+          t, BGPSTREAM_ADDR_VERSION_IPV4) == 1 &&
+          bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+            t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == 1);
+
+  CHECK("change origin", bgpcorsaro_pfx_origins_set(t, pfx(1), 200, 2) == 0);
+  CHECK("origin seen by one peer again is hidden",
+        bgpcorsaro_pfx_origins_get_visible_pfx_cnt(
+          t, BGPSTREAM_ADDR_VERSION_IPV4) == 0 &&
+          bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+            t, BGPSTREAM_ADDR_VERSION_IPV4) == 0 &&
+          bgpcorsaro_pfx_origins_get_visible_origin_cnt(
+            t, BGPSTREAM_ADDR_VERSION_UNKNOWN) == 1);
+
+  /* random updates, checked against a walk of the table */
+  ok = 1;
+  for (i = 0; i < 20000 && ok; i++) {
+    seed = seed * 1103515245 + 12345;
+    n = (seed >> 8) % 32;
+    p = (seed & 0x10000) ? pfx6(n) : pfx(n);
+    if ((seed >> 20) % 4 == 0) {
+      bgpcorsaro_pfx_origins_remove(t, p, (seed >> 24) % 4);
+    } else {
+      ok &= bgpcorsaro_pfx_origins_set(t, p, (seed >> 24) % 4,
+                                       (seed >> 28) % 8) == 0;
+    }
+    if (i % 1000 == 0) {
+      bgpcorsaro_pfx_origins_retain(t, keep_odd, NULL);
+    }
+    ok &= counters_match(t, 2);
+  }
+  CHECK("counters match the table after random updates", ok);
+
+  bgpcorsaro_pfx_origins_destroy(t);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("prefix origins set/remove", test_set_remove() == 0);
+  CHECK_SECTION("prefix origins retain", test_retain_wrap() == 0);
+  CHECK_SECTION("prefix origins visibility", test_visible() == 0);
+
+  return 0;
+}
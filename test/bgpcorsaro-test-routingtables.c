@@ -0,0 +1,390 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro_test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME "bgpcorsaro-test-routingtables"
+
+/* dumps with the second RIB dump cut off part of the way through */
+#define BROKEN_NAME NAME "-broken"
+
+/* a snapshot of all tables is written every SNAPSHOT intervals */
+#define SNAPSHOT 2
+#define PLUGIN_ARGS "-s 2"
+
+#define PEER_LEN 128
+#define PFX_LEN 64
+#define PATH_LEN 1024
+#define ROUTES_MAX 1024
+#define PEERS_MAX 16
+
+/* The routing tables are modelled independently of the plugin, as a list of
+   the routes of all peers, and the expected output is written from the model.
+   All of the updates in the dumps are newer than the RIB dump before them,
+   so each RIB dump simply replaces the tables. */
+
+typedef struct route {
+  char peer[PEER_LEN];
+  char pfx[PFX_LEN];
+  char path[PATH_LEN];
+} route_t;
+
+typedef struct table {
+  route_t routes[ROUTES_MAX];
+  int cnt;
+} table_t;
+
+typedef struct model {
+  /* the tables now, and at the start of the interval */
+  table_t cur;
+  table_t prev;
+
+  /* the RIB dump being read */
+  table_t rib;
+  uint32_t rib_time;
+  int rib_broken;
+
+  /* number of RIB records that could not be read */
+  int rib_broken_cnt;
+
+  /* peers whose sessions are up, of which the first peers_written have been
+     written out */
+  char peers[PEERS_MAX][PEER_LEN];
+  int peers_cnt;
+  int peers_written;
+
+  /* the current interval */
+  int number;
+  uint32_t start;
+  uint32_t next_report;
+  uint32_t last_ts;
+
+  /* the expected output */
+  FILE *out;
+} model_t;
+
+static model_t model;
+
+static int table_find(table_t *t, const char *peer, const char *pfx)
+{
+  int i;
+
+  for (i = 0; i < t->cnt; i++) {
+    if (strcmp(t->routes[i].peer, peer) == 0 &&
+        strcmp(t->routes[i].pfx, pfx) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* set the route to a prefix, or remove it if path is NULL */
+static int table_set(table_t *t, const char *peer, const char *pfx,
+                     const char *path)
+{
+  int i = table_find(t, peer, pfx);
+
+  if (path == NULL) {
+    if (i >= 0) {
+      t->routes[i] = t->routes[--t->cnt];
+    }
+    return 0;
+  }
+  if (i < 0) {
+    if (t->cnt == ROUTES_MAX) {
+      return -1;
+    }
+    i = t->cnt++;
+    strcpy(t->routes[i].peer, peer);
+    strcpy(t->routes[i].pfx, pfx);
+  }
+  strcpy(t->routes[i].path, path);
+  return 0;
+}
+
+static void peer_up(const char *peer)
+{
+  int i;
+
+  for (i = 0; i < model.peers_cnt; i++) {
+    if (strcmp(model.peers[i], peer) == 0) {
+      return;
+    }
+  }
+  strcpy(model.peers[model.peers_cnt++], peer);
+}
+
+static void start_interval(uint32_t time)
+{
+  model.start = time;
+  model.next_report = time + BGPCORSARO_TEST_INTERVAL;
+  fprintf(model.out, "# BGPCORSARO_INTERVAL_START %d %u\n", model.number,
+          time);
+}
+
+static void end_interval(uint32_t time)
+{
+  route_t *r;
+  int i, j;
+
+  for (i = model.peers_written; i < model.peers_cnt; i++) {
+    fprintf(model.out, "%u|%s|S|ESTABLISHED|\n", model.start, model.peers[i]);
+  }
+  model.peers_written = model.peers_cnt;
+
+  for (i = 0; i < model.cur.cnt; i++) {
+    r = &model.cur.routes[i];
+    j = table_find(&model.prev, r->peer, r->pfx);
+    if (j < 0 || strcmp(model.prev.routes[j].path, r->path) != 0) {
+      fprintf(model.out, "%u|%s|A|%s|%s\n", model.start, r->peer, r->pfx,
+              r->path);
+    }
+  }
+  for (i = 0; i < model.prev.cnt; i++) {
+    r = &model.prev.routes[i];
+    if (table_find(&model.cur, r->peer, r->pfx) < 0) {
+      fprintf(model.out, "%u|%s|W|%s|\n", model.start, r->peer, r->pfx);
+    }
+  }
+
+  if ((model.number + 1) % SNAPSHOT == 0) {
+    for (i = 0; i < model.cur.cnt; i++) {
+      r = &model.cur.routes[i];
+      fprintf(model.out, "%u|%s|R|%s|%s\n", model.start, r->peer, r->pfx,
+              r->path);
+    }
+  }
+
+  fprintf(model.out, "# BGPCORSARO_INTERVAL_END %d %u\n", model.number, time);
+  model.prev = model.cur;
+  model.number++;
+}
+
+static int process_record(bgpstream_record_t *record)
+{
+  bgpstream_elem_t *elem;
+  uint32_t ts = record->attributes.record_time;
+  char peer[PEER_LEN];
+  char ip[INET6_ADDRSTRLEN];
+  char pfx[PFX_LEN];
+  char path[PATH_LEN];
+  int is_rib = record->attributes.dump_type == BGPSTREAM_RIB;
+  int i;
+
+  if (model.number == 0 && model.start == 0) {
+    start_interval(ts);
+  }
+  while (ts >= model.next_report) {
+    end_interval(model.next_report - 1);
+    start_interval(model.next_report);
+  }
+  model.last_ts = ts;
+
+  if (is_rib != 0 && record->attributes.dump_time != model.rib_time) {
+    model.rib.cnt = 0;
+    model.rib_time = record->attributes.dump_time;
+    model.rib_broken = 0;
+  }
+
+  if (record->status != BGPSTREAM_RECORD_STATUS_VALID_RECORD) {
+    if (is_rib != 0) {
+      model.rib_broken = 1;
+      model.rib_broken_cnt++;
+    }
+    return 0;
+  }
+
+  while ((elem = bgpstream_record_get_next_elem(record)) != NULL) {
+    bgpstream_addr_ntop(ip, sizeof(ip), &elem->peer_address);
+    snprintf(peer, sizeof(peer), "%s|%u|%s", BGPCORSARO_TEST_COLLECTOR,
+             elem->peer_asnumber, ip);
+    bgpstream_pfx_snprintf(pfx, sizeof(pfx), (bgpstream_pfx_t *)&elem->prefix);
+    path[0] = '\0';
+    if (elem->aspath != NULL) {
+      bgpstream_as_path_snprintf(path, sizeof(path), elem->aspath);
+    }
+
+    switch (elem->type) {
+    case BGPSTREAM_ELEM_TYPE_RIB:
+      if (table_set(&model.rib, peer, pfx, path) != 0) {
+        return -1;
+      }
+      break;
+    case BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT:
+      peer_up(peer);
+      if (table_set(&model.cur, peer, pfx, path) != 0) {
+        return -1;
+      }
+      break;
+    case BGPSTREAM_ELEM_TYPE_WITHDRAWAL:
+      table_set(&model.cur, peer, pfx, NULL);
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (is_rib != 0 && record->dump_pos == BGPSTREAM_DUMP_END &&
+      model.rib_broken == 0) {
+    for (i = 0; i < model.rib.cnt; i++) {
+      peer_up(model.rib.routes[i].peer);
+    }
+    model.cur = model.rib;
+  }
+  return 0;
+}
+
+/* write the output that the plugin should produce for the given dumps */
+static int write_expected(const char *name)
+{
+  bgpstream_t *bs;
+  bgpstream_record_t *record = NULL;
+  char path[1024];
+  int rc = -1;
+
+  memset(&model, 0, sizeof(model));
+  snprintf(path, sizeof(path), "%s.expected", name);
+  if ((model.out = fopen(path, "w")) == NULL) {
+    return -1;
+  }
+  if ((bs = bgpcorsaro_test_stream_create(name, BGPCORSARO_TEST_START)) ==
+        NULL ||
+      (record = bgpstream_record_create()) == NULL) {
+    goto done;
+  }
+  while ((rc = bgpstream_get_next_record(bs, record)) > 0) {
+    if (process_record(record) != 0) {
+      rc = -1;
+      break;
+    }
+  }
+  if (rc == 0) {
+    end_interval(model.last_ts);
+  }
+
+done:
+  if (record != NULL) {
+    bgpstream_record_destroy(record);
+  }
+  bgpstream_destroy(bs);
+  fclose(model.out);
+  return rc;
+}
+
+/* run the plugin over the given dumps */
+static int run_plugin(const char *name)
+{
+  bgpcorsaro_t *bc;
+  char template[1024];
+  int rc = -1;
+
+  snprintf(template, sizeof(template), "%s.%%X", name);
+  if ((bc = bgpcorsaro_alloc_output(template)) == NULL) {
+    return -1;
+  }
+  bgpcorsaro_disable_logfile(bc);
+  bgpcorsaro_set_interval(bc, BGPCORSARO_TEST_INTERVAL);
+  if (bgpcorsaro_enable_plugin(bc, "routingtables", PLUGIN_ARGS) == 0 &&
+      bgpcorsaro_start_output(bc) == 0 &&
+      bgpcorsaro_test_run(bc, name, 0) == 0) {
+    rc = 0;
+  }
+  if (bgpcorsaro_test_finalize(bc) != 0) {
+    rc = -1;
+  }
+  return rc;
+}
+
+/* compare the output of the plugin with the output expected by the model */
+static int compare(const char *name)
+{
+  char path[1024];
+  char *expected = NULL, *output = NULL;
+  int ok;
+
+  snprintf(path, sizeof(path), "%s.expected", name);
+  if ((expected = bgpcorsaro_test_read_output(path)) == NULL) {
+    return -1;
+  }
+  snprintf(path, sizeof(path), "%s.routingtables", name);
+  if ((output = bgpcorsaro_test_read_output(path)) == NULL) {
+    free(expected);
+    return -1;
+  }
+  ok = strcmp(expected, output) == 0;
+  free(expected);
+  free(output);
+  return ok ? 0 : -1;
+}
+
+static int test_tables()
+{
+  const char *rib_interval;
+  char *output;
+  int ok;
+
+  CHECK("write dumps", bgpcorsaro_test_write_dumps(NAME, 0) == 0);
+  CHECK("model routing tables", write_expected(NAME) == 0);
+  CHECK("run plugin", run_plugin(NAME) == 0);
+  CHECK("output matches the model", compare(NAME) == 0);
+  CHECK("all RIB records were read", model.rib_broken_cnt == 0);
+
+  /* make sure that the output covers what it should */
+  CHECK("read output",
+        (output = bgpcorsaro_test_read_output(NAME ".routingtables")) != NULL);
+  rib_interval = bgpcorsaro_test_find_interval(
+    output, (BGPCORSARO_TEST_RIB_TIME - BGPCORSARO_TEST_START) /
+              BGPCORSARO_TEST_INTERVAL);
+  ok = strstr(output, "|S|ESTABLISHED|") != NULL &&
+       strstr(output, "|A|") != NULL && strstr(output, "|W|") != NULL &&
+       strstr(output, "|R|") != NULL && rib_interval != NULL &&
+       strstr(rib_interval, "|A|") != NULL;
+  free(output);
+  CHECK("output has peer states, diffs and snapshots", ok);
+  CHECK("peers were seen", model.peers_cnt > 1);
+
+  return 0;
+}
+
+static int test_broken_rib()
+{
+  CHECK("write dumps", bgpcorsaro_test_write_dumps(BROKEN_NAME, 1) == 0);
+  CHECK("model routing tables", write_expected(BROKEN_NAME) == 0);
+  CHECK("RIB dump is broken", model.rib_broken_cnt > 0);
+  CHECK("run plugin", run_plugin(BROKEN_NAME) == 0);
+  CHECK("broken RIB dump is ignored", compare(BROKEN_NAME) == 0);
+
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("routing tables", test_tables() == 0);
+  CHECK_SECTION("broken RIB dump", test_broken_rib() == 0);
+  return 0;
+}
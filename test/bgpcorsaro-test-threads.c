@@ -0,0 +1,128 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NAME "bgpcorsaro-test-threads"
+
+/* outputs of the runs with and without threads */
+#define UNTHREADED NAME ".unthreaded"
+#define THREADED NAME ".threaded"
+
+/* pfxmonitor logs every elem that overlaps these prefixes (all of them) */
+#define PFXMONITOR_ARGS                                                        \
+  "-l 0.0.0.0/1 -l 128.0.0.0/1 -l ::/1 -l 8000::/1"
+
+/* the header of the last interval */
+#define LAST_INTERVAL "# BGPCORSARO_INTERVAL_END 5 "
+
+static int run(const char *output, int threaded)
+{
+  bgpcorsaro_t *bc;
+  char template[1024];
+  int rc = -1;
+
+  snprintf(template, sizeof(template), "%s.%%X", output);
+  if ((bc = bgpcorsaro_alloc_output(template)) == NULL) {
+    return -1;
+  }
+  bgpcorsaro_disable_logfile(bc);
+  bgpcorsaro_set_interval(bc, BGPCORSARO_TEST_INTERVAL);
+  if (threaded != 0) {
+    bgpcorsaro_enable_threads(bc);
+  }
+  if (bgpcorsaro_enable_plugin(bc, "routingtables", "-s 2") == 0 &&
+      bgpcorsaro_enable_plugin(bc, "pfxmonitor", PFXMONITOR_ARGS) == 0 &&
+      bgpcorsaro_start_output(bc) == 0 &&
+      bgpcorsaro_test_run(bc, NAME, 0) == 0) {
+    rc = 0;
+  }
+  if (bgpcorsaro_test_finalize(bc) != 0) {
+    rc = -1;
+  }
+  return rc;
+}
+
+/* check that the outputs of a plugin are identical, and cover every
+   interval */
+static int outputs_equal(const char *plugin)
+{
+  char a_path[1024], b_path[1024];
+  char line[1024];
+  FILE *a = NULL, *b = NULL;
+  int a_c, b_c;
+  int last = 0;
+  int rc = -1;
+
+  snprintf(a_path, sizeof(a_path), "%s.%s", UNTHREADED, plugin);
+  snprintf(b_path, sizeof(b_path), "%s.%s", THREADED, plugin);
+  if ((a = fopen(a_path, "r")) == NULL || (b = fopen(b_path, "r")) == NULL) {
+    goto done;
+  }
+  do {
+    a_c = fgetc(a);
+    b_c = fgetc(b);
+  } while (a_c == b_c && a_c != EOF);
+  if (a_c != b_c) {
+    goto done;
+  }
+
+  rewind(a);
+  while (fgets(line, sizeof(line), a) != NULL) {
+    if (strncmp(line, LAST_INTERVAL, strlen(LAST_INTERVAL)) == 0) {
+      last = 1;
+    }
+  }
+  rc = last != 0 ? 0 : -1;
+
+done:
+  if (a != NULL) {
+    fclose(a);
+  }
+  if (b != NULL) {
+    fclose(b);
+  }
+  return rc;
+}
+
+static int test_threads()
+{
+  CHECK("write dumps", bgpcorsaro_test_write_dumps(NAME, 0) == 0);
+  CHECK("run plugins without threads", run(UNTHREADED, 0) == 0);
+  CHECK("run plugins in threads", run(THREADED, 1) == 0);
+  CHECK("routingtables output is the same",
+        outputs_equal("routingtables") == 0);
+  CHECK("pfxmonitor output is the same", outputs_equal("pfxmonitor") == 0);
+
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("threaded plugins", test_threads() == 0);
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpcorsaro.h"
+#include "bgpcorsaro_int.h"
+
+#include <stdio.h>
+
+static int test_clip_window()
+{
+  uint32_t start;
+
+  start = 100;
+  CHECK("window without resume time is kept",
+        bgpcorsaro_clip_window(0, &start, 200) == 1 && start == 100);
+
+  start = 100;
+  CHECK("window after resume time is kept",
+        bgpcorsaro_clip_window(50, &start, 200) == 1 && start == 100);
+
+  start = 100;
+  CHECK("window containing resume time is clipped",
+        bgpcorsaro_clip_window(150, &start, 200) == 1 && start == 150);
+
+  start = 100;
+  CHECK("window before resume time is skipped",
+        bgpcorsaro_clip_window(250, &start, 200) == 0);
+
+  start = 100;
+  CHECK("resuming into an open-ended window clips it",
+        bgpcorsaro_clip_window(250, &start, BGPSTREAM_FOREVER) == 1 &&
+          start == 250);
+
+  start = 300;
+  CHECK("open-ended window after resume time is kept",
+        bgpcorsaro_clip_window(250, &start, BGPSTREAM_FOREVER) == 1 &&
+          start == 300);
+
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("bgpcorsaro resume windows", test_clip_window() == 0);
+
+  return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "bgpcorsaro_test.h"
+#include "mrtgen.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PATH_LEN 1024
+
+/* path, project, type, collector, file time, duration, time published */
+#define ROW_FMT "%s,ris,%s,%s,%u,%u,%u\n"
+
+/* the updates are split into dumps of 15 minutes, as the csvfile data
+   interface expects */
+#define UPDATES_DURATION 900
+#define UPDATES_CNT                                                            \
+  ((BGPCORSARO_TEST_END - BGPCORSARO_TEST_START) / UPDATES_DURATION)
+
+/* the stream being fed to bgpcorsaro by bgpcorsaro_test_run */
+static bgpstream_t *stream = NULL;
+
+static void dump_path(char *buf, const char *name, const char *type, int n)
+{
+  snprintf(buf, PATH_LEN, "%s.%s.%d", name, type, n);
+}
+
+/* cut the file off half way through (which is almost certainly not on a
+   record boundary) */
+static int truncate_half(const char *path)
+{
+  FILE *fh;
+  long len;
+
+  if ((fh = fopen(path, "r")) == NULL || fseek(fh, 0, SEEK_END) != 0 ||
+      (len = ftell(fh)) < 0) {
+    if (fh != NULL) {
+      fclose(fh);
+    }
+    return -1;
+  }
+  fclose(fh);
+  return truncate(path, len / 2);
+}
+
+int bgpcorsaro_test_write_dumps(const char *name, int broken_rib)
+{
+  mrtgen_config_t cfg;
+  mrtgen_t *gen;
+  char path[PATH_LEN];
+  FILE *csv;
+  uint32_t time;
+  int i;
+  int rc = -1;
+
+  mrtgen_config_init(&cfg);
+  cfg.seed = 42;
+  cfg.peer_cnt = 4;
+  cfg.v4_pfx_cnt = 40;
+  cfg.v6_pfx_cnt = 10;
+  cfg.update_cnt = 50;
+  cfg.update_pfx_max = 4;
+  cfg.withdraw_pct = 20;
+
+  snprintf(path, PATH_LEN, "%s.csv", name);
+  if ((gen = mrtgen_create(&cfg)) == NULL) {
+    return -1;
+  }
+  if ((csv = fopen(path, "w")) == NULL) {
+    goto done;
+  }
+
+  for (i = 0; i < 2; i++) {
+    time = BGPCORSARO_TEST_START + i * (BGPCORSARO_TEST_RIB_TIME -
+                                        BGPCORSARO_TEST_START);
+    dump_path(path, name, "rib", i);
+    if (mrtgen_write_rib(gen, path, time) != 0 ||
+        (i == 1 && broken_rib != 0 && truncate_half(path) != 0)) {
+      goto done;
+    }
+    fprintf(csv, ROW_FMT, path, "ribs", BGPCORSARO_TEST_COLLECTOR, time, 120,
+            time);
+  }
+
+  /* the updates of each dump start just after its file time, so that every
+     update is newer than a RIB dump with the same time */
+  for (i = 0; i < UPDATES_CNT; i++) {
+    time = BGPCORSARO_TEST_START + i * UPDATES_DURATION;
+    dump_path(path, name, "upd", i);
+    if (mrtgen_write_updates(gen, path, time + 1, UPDATES_DURATION - 1) != 0) {
+      goto done;
+    }
+    fprintf(csv, ROW_FMT, path, "updates", BGPCORSARO_TEST_COLLECTOR, time,
+            UPDATES_DURATION, time);
+  }
+  rc = 0;
+
+done:
+  if (csv != NULL) {
+    fclose(csv);
+  }
+  mrtgen_destroy(gen);
+  return rc;
+}
+
+bgpstream_t *bgpcorsaro_test_stream_create(const char *name, uint32_t start)
+{
+  bgpstream_t *bs;
+  bgpstream_data_interface_id_t di;
+  bgpstream_data_interface_option_t *option;
+  char path[PATH_LEN];
+
+  if ((bs = bgpstream_create()) == NULL) {
+    return NULL;
+  }
+  di = bgpstream_get_data_interface_id_by_name(bs, "csvfile");
+  bgpstream_set_data_interface(bs, di);
+  if ((option = bgpstream_get_data_interface_option_by_name(
+         bs, di, "csv-file")) == NULL) {
+    goto err;
+  }
+  snprintf(path, PATH_LEN, "%s.csv", name);
+  bgpstream_set_data_interface_option(bs, option, path);
+  bgpstream_add_interval_filter(bs, start, BGPCORSARO_TEST_END);
+  if (bgpstream_start(bs) != 0) {
+    goto err;
+  }
+  return bs;
+
+err:
+  bgpstream_destroy(bs);
+  return NULL;
+}
+
+int bgpcorsaro_test_run(bgpcorsaro_t *bgpcorsaro, const char *name,
+                        uint32_t stop)
+{
+  bgpstream_record_t *record;
+  uint32_t start = bgpcorsaro_get_resume_time(bgpcorsaro);
+  int rc;
+
+  if (start == 0) {
+    start = BGPCORSARO_TEST_START;
+  }
+  assert(stream == NULL);
+  if ((stream = bgpcorsaro_test_stream_create(name, start)) == NULL ||
+      (record = bgpstream_record_create()) == NULL) {
+    return -1;
+  }
+  while ((rc = bgpstream_get_next_record(stream, record)) > 0) {
+    if (stop != 0 && record->attributes.record_time >= stop) {
+      rc = 0;
+      break;
+    }
+    if (bgpcorsaro_per_record(bgpcorsaro, record) != 0) {
+      rc = -1;
+      break;
+    }
+  }
+  bgpstream_record_destroy(record);
+  return rc;
+}
+
+int bgpcorsaro_test_finalize(bgpcorsaro_t *bgpcorsaro)
+{
+  int rc = bgpcorsaro_finalize_output(bgpcorsaro);
+
+  /* plugin threads may still be using records from the stream until
+     bgpcorsaro has been finalized */
+  if (stream != NULL) {
+    bgpstream_destroy(stream);
+    stream = NULL;
+  }
+  return rc;
+}
+
+static int line_cmp(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* append the given lines to out, sorted */
+static char *flush_lines(char *out, char **lines, int cnt)
+{
+  int i;
+
+  qsort(lines, cnt, sizeof(char *), line_cmp);
+  for (i = 0; i < cnt; i++) {
+    out = stpcpy(out, lines[i]);
+    *out++ = '\n';
+  }
+  return out;
+}
+
+char *bgpcorsaro_test_read_output(const char *path)
+{
+  FILE *fh;
+  long len;
+  char *buf = NULL;
+  char *out = NULL;
+  char *p, *line, *end;
+  char **lines = NULL;
+  int lines_cnt = 0;
+
+  if ((fh = fopen(path, "r")) == NULL) {
+    return NULL;
+  }
+  if (fseek(fh, 0, SEEK_END) != 0 || (len = ftell(fh)) < 0 ||
+      fseek(fh, 0, SEEK_SET) != 0 || (buf = malloc(len + 1)) == NULL ||
+      (out = malloc(len + 2)) == NULL ||
+      (lines = malloc(sizeof(char *) * (len + 1))) == NULL ||
+      fread(buf, 1, len, fh) != (size_t)len) {
+    free(out);
+    out = NULL;
+    goto done;
+  }
+  buf[len] = '\0';
+
+  /* header lines (the interval boundaries) stay where they are */
+  p = out;
+  for (line = strtok_r(buf, "\n", &end); line != NULL;
+       line = strtok_r(NULL, "\n", &end)) {
+    if (line[0] == '#') {
+      p = flush_lines(p, lines, lines_cnt);
+      lines_cnt = 0;
+      p = stpcpy(p, line);
+      *p++ = '\n';
+    } else {
+      lines[lines_cnt++] = line;
+    }
+  }
+  p = flush_lines(p, lines, lines_cnt);
+  *p = '\0';
+
+done:
+  fclose(fh);
+  free(buf);
+  free(lines);
+  return out;
+}
+
+const char *bgpcorsaro_test_find_interval(const char *output, int number)
+{
+  char header[PATH_LEN];
+
+  snprintf(header, PATH_LEN, "# BGPCORSARO_INTERVAL_START %d ", number);
+  return strstr(output, header);
+}
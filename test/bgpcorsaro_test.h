@@ -0,0 +1,76 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BGPCORSARO_TEST_H
+#define __BGPCORSARO_TEST_H
+
+#include "bgpcorsaro.h"
+#include "bgpstream.h"
+
+/* Helpers shared by the bgpcorsaro tests, which run plugins over a small set
+   of synthetic dumps (written with mrtgen) and compare their output */
+
+/* time of the first RIB dump */
+#define BGPCORSARO_TEST_START 1427846400
+
+/* time of the second RIB dump, half way through the dumps */
+#define BGPCORSARO_TEST_RIB_TIME (BGPCORSARO_TEST_START + 1800)
+
+/* time of the last update */
+#define BGPCORSARO_TEST_END (BGPCORSARO_TEST_START + 3600)
+
+/* length of the bgpcorsaro intervals */
+#define BGPCORSARO_TEST_INTERVAL 600
+
+/* collector that the dumps are from */
+#define BGPCORSARO_TEST_COLLECTOR "rrc00"
+
+/* Write two RIB dumps, and update dumps covering an hour, along with a
+   <name>.csv index of them. If broken_rib is set, the second RIB dump is cut
+   off part of the way through a record. Returns 0 if successful. */
+int bgpcorsaro_test_write_dumps(const char *name, int broken_rib);
+
+/* Create and start a stream of the dumps written by
+   bgpcorsaro_test_write_dumps, from the given time to the end */
+bgpstream_t *bgpcorsaro_test_stream_create(const char *name, uint32_t start);
+
+/* Feed the records of the dumps that are before stop (0 for all of them) to
+   bgpcorsaro, starting from its resume time. The stream is kept until
+   bgpcorsaro_test_finalize is called. Returns 0 if successful. */
+int bgpcorsaro_test_run(bgpcorsaro_t *bgpcorsaro, const char *name,
+                        uint32_t stop);
+
+/* Finalize bgpcorsaro, and then destroy the stream that was fed to it by
+   bgpcorsaro_test_run. Returns the result of bgpcorsaro_finalize_output. */
+int bgpcorsaro_test_finalize(bgpcorsaro_t *bgpcorsaro);
+
+/* Read the output file of a plugin, sorting the lines within each interval,
+   since plugins do not always write them in a fixed order. The returned
+   string must be freed by the caller. */
+char *bgpcorsaro_test_read_output(const char *path);
+
+/* Find the start of the given interval in output read by
+   bgpcorsaro_test_read_output, NULL if it is not there */
+const char *bgpcorsaro_test_find_interval(const char *output, int number);
+
+#endif /* __BGPCORSARO_TEST_H */
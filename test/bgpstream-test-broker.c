@@ -0,0 +1,294 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_datasource_broker.h"
+#include "bgpstream_input.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wandio.h>
+
+#define RESPONSE_FILE "bgpstream-test-broker.json"
+
+#define PATH_LEN 1024
+
+#define DUMP_FILE(url, time)                                                   \
+  "{\"urlType\":\"simple\",\"url\":\"" url "\",\"project\":\"routeviews\","   \
+  "\"collector\":\"route-views2\",\"type\":\"updates\","                       \
+  "\"initialTime\":" #time ",\"duration\":900}"
+
+#define RESPONSE(files)                                                        \
+  "{\"time\":1427847000,\"type\":\"data\",\"error\":null,"                     \
+  "\"queryParameters\":{\"projects\":[\"routeviews\"],\"minInitialTime\":0},"  \
+  "\"data\":{\"dumpFiles\":[" files "]}}"
+
+static bgpstream_filter_mgr_t *filter_mgr = NULL;
+static bgpstream_broker_datasource_t *broker_ds = NULL;
+static bgpstream_input_mgr_t *input_mgr = NULL;
+
+/* parse the given response with a fresh input queue */
+static int parse(const char *json)
+{
+  FILE *fh;
+  io_t *io;
+  int rc;
+
+  if ((fh = fopen(RESPONSE_FILE, "w")) == NULL) {
+    return -100;
+  }
+  fputs(json, fh);
+  fclose(fh);
+
+  bgpstream_input_mgr_destroy(input_mgr);
+  if ((input_mgr = bgpstream_input_mgr_create()) == NULL ||
+      (io = wandio_create(RESPONSE_FILE)) == NULL) {
+    return -100;
+  }
+  rc = bgpstream_broker_datasource_read_response(broker_ds, input_mgr, io);
+  wandio_destroy(io);
+  unlink(RESPONSE_FILE);
+  return rc;
+}
+
+static int queue_len()
+{
+  bgpstream_input_t *i;
+  int cnt = 0;
+
+  for (i = input_mgr->head; i != NULL; i = i->next) {
+    cnt++;
+  }
+  return cnt;
+}
+
+static int test_valid()
+{
+  CHECK("valid response",
+        parse(RESPONSE(DUMP_FILE("a.bz2", 1427846400) "," DUMP_FILE(
+          "b.bz2", 1427847300))) == 2 &&
+          queue_len() == 2);
+
+  CHECK("files are queued in time order",
+        strcmp(input_mgr->head->filename, "a.bz2") == 0 &&
+          input_mgr->head->epoch_filetime == 1427846400 &&
+          input_mgr->head->time_span == 900);
+
+  CHECK("empty dumpFiles", parse(RESPONSE("")) == 0 && queue_len() == 0);
+
+  CHECK("whitespace and escapes",
+        parse(" {\"time\" : 1427847000, \"type\": \"data\",\n"
+              "  \"error\": null, \"data\": {\"dumpFiles\": [\n"
+              "   {\"urlType\": \"simple\", \"url\": \"http:\\/\\/x\\/a.bz2\","
+              "    \"project\": \"ris\", \"collector\": \"rrc00\","
+              "    \"type\": \"ribs\", \"initialTime\": 1427846400,"
+              "    \"duration\": 120}]}}\n") == 1 &&
+          strcmp(input_mgr->head->filename, "http://x/a.bz2") == 0);
+
+  return 0;
+}
+
+static int test_unknown_keys()
+{
+  CHECK("unknown root, data and dumpFile keys are skipped",
+        parse("{\"time\":1427847000,\"type\":\"data\",\"error\":null,"
+              "\"extra\":{\"a\":[1,{\"b\":\"}\"}],\"c\":true},"
+              "\"data\":{\"other\":[[]],\"dumpFiles\":["
+              "{\"urlType\":\"simple\",\"url\":\"a.bz2\",\"size\":[1,2],"
+              "\"project\":\"routeviews\",\"collector\":\"route-views2\","
+              "\"type\":\"updates\",\"initialTime\":1427846400,"
+              "\"duration\":900,\"md5\":\"x\"}]}}") == 1 &&
+          queue_len() == 1);
+
+  return 0;
+}
+
+static int test_duplicates()
+{
+  CHECK("duplicate files are not an error",
+        parse(RESPONSE(DUMP_FILE("a.bz2", 1427846400) "," DUMP_FILE(
+          "b.bz2", 1427847300) "," DUMP_FILE("a.bz2", 1427846400))) == 2 &&
+          queue_len() == 2);
+
+  return 0;
+}
+
+/* serve a response that is cut off after its first file through the fifo
+   that the data source reads, and then replace the fifo with a complete
+   response (that only lists the same file) for the retry */
+static void *serve_cut_off(void *user)
+{
+  const char *dir = user;
+  char path[PATH_LEN];
+  char tmp[PATH_LEN];
+  FILE *fh;
+
+  snprintf(path, PATH_LEN, "%s/data", dir);
+  snprintf(tmp, PATH_LEN, "%s/data.tmp", dir);
+  if ((fh = fopen(path, "w")) == NULL) {
+    return NULL;
+  }
+  fputs("{\"time\":1427847000,\"type\":\"data\",\"error\":null,"
+        "\"data\":{\"dumpFiles\":[" DUMP_FILE("a.bz2", 1427846400) ",",
+        fh);
+  fclose(fh);
+
+  if ((fh = fopen(tmp, "w")) == NULL) {
+    return NULL;
+  }
+  fputs(RESPONSE(DUMP_FILE("a.bz2", 1427846400)), fh);
+  fclose(fh);
+  rename(tmp, path);
+  return NULL;
+}
+
+static int test_cut_off()
+{
+  char dir[] = "bgpstream-test-broker.XXXXXX";
+  char path[PATH_LEN];
+  bgpstream_broker_datasource_t *ds;
+  pthread_t thread;
+  int rc;
+
+  CHECK("create temp dir", mkdtemp(dir) != NULL);
+  snprintf(path, PATH_LEN, "%s/data", dir);
+  CHECK("create fifo", mkfifo(path, 0600) == 0);
+
+  /* with no filters, the query is simply <broker>/data */
+  CHECK("create data source",
+        (ds = bgpstream_broker_datasource_create(filter_mgr, dir, NULL, 0)) !=
+          NULL);
+  bgpstream_input_mgr_destroy(input_mgr);
+  CHECK("create input queue", (input_mgr = bgpstream_input_mgr_create()) !=
+                                NULL);
+
+  CHECK("start server",
+        pthread_create(&thread, NULL, serve_cut_off, dir) == 0);
+  rc = bgpstream_broker_datasource_update_input_queue(ds, input_mgr);
+  pthread_join(thread, NULL);
+
+  /* the retry only finds the file the cut off response already queued, which
+     must still count as a result */
+  CHECK("files queued before the cut are counted",
+        rc == 1 && queue_len() == 1 &&
+          strcmp(input_mgr->head->filename, "a.bz2") == 0);
+
+  bgpstream_broker_datasource_destroy(ds);
+  unlink(path);
+  rmdir(dir);
+  return 0;
+}
+
+static void *interrupt(void *user)
+{
+  usleep(200000);
+  bgpstream_broker_datasource_interrupt(user);
+  return NULL;
+}
+
+static int test_interrupt()
+{
+  bgpstream_broker_datasource_t *ds;
+  pthread_t thread;
+  time_t start;
+  int rc;
+
+  /* requests to a broker that does not exist are retried forever */
+  CHECK("create data source",
+        (ds = bgpstream_broker_datasource_create(
+           filter_mgr, "bgpstream-test-broker.missing", NULL, 0)) != NULL);
+  bgpstream_input_mgr_destroy(input_mgr);
+  CHECK("create input queue", (input_mgr = bgpstream_input_mgr_create()) !=
+                                NULL);
+
+  CHECK("start interrupter", pthread_create(&thread, NULL, interrupt, ds) == 0);
+  start = time(NULL);
+  rc = bgpstream_broker_datasource_update_input_queue(ds, input_mgr);
+  pthread_join(thread, NULL);
+  CHECK("interrupt stops retries",
+        rc == 0 && queue_len() == 0 && time(NULL) - start < 5);
+
+  start = time(NULL);
+  CHECK("interrupted wait returns immediately",
+        bgpstream_broker_datasource_wait(ds, 30) == 0 &&
+          time(NULL) - start < 5);
+
+  bgpstream_broker_datasource_destroy(ds);
+  return 0;
+}
+
+static int test_malformed()
+{
+  CHECK("truncated response is retried",
+        parse("{\"time\":1427847000,\"type\":\"data\",\"error\":null,"
+              "\"data\":{\"dumpFiles\":[" DUMP_FILE("a.bz2", 1427846400)) ==
+          -2);
+
+  CHECK("truncated string is retried",
+        parse("{\"time\":1427847000,\"type\":\"da") == -2);
+
+  CHECK("empty response is retried", parse("") == -2);
+
+  CHECK("missing time is retried",
+        parse("{\"type\":\"data\",\"error\":null,"
+              "\"data\":{\"dumpFiles\":[]}}") == -2);
+
+  CHECK("incomplete dumpFile is retried",
+        parse(RESPONSE("{\"url\":\"a.bz2\",\"initialTime\":1}")) == -2);
+
+  CHECK("broker error is retried",
+        parse("{\"time\":1427847000,\"type\":\"data\",\"error\":\"oops\","
+              "\"data\":{\"dumpFiles\":[]}}") == -2);
+
+  CHECK("non-string key is retried",
+        parse("{\"time\":1427847000,1:2}") == -2);
+
+  return 0;
+}
+
+int main()
+{
+  if ((filter_mgr = bgpstream_filter_mgr_create()) == NULL ||
+      (broker_ds = bgpstream_broker_datasource_create(
+         filter_mgr, "http://localhost/broker", NULL, 0)) == NULL) {
+    fprintf(stderr, "Could not create broker data source\n");
+    return -1;
+  }
+
+  CHECK_SECTION("valid responses", test_valid() == 0);
+  CHECK_SECTION("unknown keys", test_unknown_keys() == 0);
+  CHECK_SECTION("duplicate files", test_duplicates() == 0);
+  CHECK_SECTION("malformed responses", test_malformed() == 0);
+  CHECK_SECTION("cut off responses", test_cut_off() == 0);
+  CHECK_SECTION("interrupts", test_interrupt() == 0);
+
+  bgpstream_input_mgr_destroy(input_mgr);
+  bgpstream_broker_datasource_destroy(broker_ds);
+  bgpstream_filter_mgr_destroy(filter_mgr);
+  return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_cache.h"
+#include "bgpstream_input.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BUFFER_LEN 1024
+
+/* the cache only handles urls with a scheme, so the "remote" files live in a
+   directory called 'src:', which makes 'src://<name>' a valid local path */
+#define SRC_DIR "src:"
+#define CACHE_DIR "bgpstream-test-cache.d"
+
+#define FILE_SIZE 4096
+
+static char path[BUFFER_LEN];
+
+static int make_file(const char *name)
+{
+  char buf[FILE_SIZE];
+  FILE *fh;
+
+  if ((fh = fopen(name, "w")) == NULL) {
+    return -1;
+  }
+  memset(buf, 'x', sizeof(buf));
+  fwrite(buf, 1, sizeof(buf), fh);
+  fclose(fh);
+  return 0;
+}
+
+static int make_src(const char *name)
+{
+  snprintf(path, sizeof(path), SRC_DIR "/%s", name);
+  return make_file(path);
+}
+
+/* count the files in dir whose names contain the given string */
+static int count_files(const char *dir, const char *match)
+{
+  DIR *dirp;
+  struct dirent *de;
+  int cnt = 0;
+
+  if ((dirp = opendir(dir)) == NULL) {
+    return -1;
+  }
+  while ((de = readdir(dirp)) != NULL) {
+    if (de->d_name[0] != '.' && strstr(de->d_name, match) != NULL) {
+      cnt++;
+    }
+  }
+  closedir(dirp);
+  return cnt;
+}
+
+/* get url from the cache, and check that it was not evicted by its own get */
+static int is_cached(bgpstream_cache_t *cache, const char *url)
+{
+  char p[BUFFER_LEN];
+
+  if (bgpstream_cache_get(cache, url, p, sizeof(p)) != 0) {
+    return 0;
+  }
+  bgpstream_cache_release(cache, url);
+  return access(p, R_OK) == 0;
+}
+
+static int test_small_cache()
+{
+  bgpstream_cache_t *cache;
+  char a_path[BUFFER_LEN];
+  char b_path[BUFFER_LEN];
+
+  /* a cache that is smaller than any one file */
+  CHECK("create cache", (cache = bgpstream_cache_create(CACHE_DIR, 1, 0)) !=
+                          NULL);
+
+  CHECK("get file larger than the cache",
+        bgpstream_cache_get(cache, "src://a", a_path, sizeof(a_path)) == 0 &&
+          access(a_path, R_OK) == 0);
+
+  CHECK("pinned file survives eviction",
+        bgpstream_cache_get(cache, "src://b", b_path, sizeof(b_path)) == 0 &&
+          access(a_path, R_OK) == 0 && access(b_path, R_OK) == 0);
+
+  /* once a has been opened it may be evicted, but b may not */
+  bgpstream_cache_release(cache, "src://a");
+  CHECK("released file is evicted",
+        bgpstream_cache_get(cache, "src://c", path, sizeof(path)) == 0 &&
+          access(a_path, R_OK) != 0 && access(b_path, R_OK) == 0 &&
+          access(path, R_OK) == 0);
+
+  bgpstream_cache_release(cache, "src://b");
+  bgpstream_cache_release(cache, "src://c");
+  bgpstream_cache_destroy(cache);
+  return 0;
+}
+
+static int test_prefetch()
+{
+  bgpstream_cache_t *cache;
+  bgpstream_input_t in[2];
+
+  CHECK("create prefetching cache",
+        (cache = bgpstream_cache_create(CACHE_DIR, 1, 2)) != NULL);
+
+  memset(in, 0, sizeof(in));
+  in[0].filename = "src://a";
+  in[0].next = &in[1];
+  in[1].filename = "src://b";
+  bgpstream_cache_prefetch(cache, in);
+
+  /* a download by a reader must not evict a prefetched file that has not
+     been read yet */
+  CHECK("prefetched files are kept",
+        bgpstream_cache_get(cache, "src://c", path, sizeof(path)) == 0 &&
+          is_cached(cache, "src://a") && is_cached(cache, "src://b"));
+
+  bgpstream_cache_release(cache, "src://c");
+  bgpstream_cache_destroy(cache);
+  return 0;
+}
+
+static int test_refcount()
+{
+  bgpstream_cache_t *cache;
+  char a_path[BUFFER_LEN];
+
+  CHECK("create cache", (cache = bgpstream_cache_create(CACHE_DIR, 1, 0)) !=
+                          NULL);
+
+  /* two readers of the same file */
+  CHECK("get file twice",
+        bgpstream_cache_get(cache, "src://a", a_path, sizeof(a_path)) == 0 &&
+          bgpstream_cache_get(cache, "src://a", path, sizeof(path)) == 0);
+
+  bgpstream_cache_release(cache, "src://a");
+  CHECK("file is kept until the last reader releases it",
+        is_cached(cache, "src://b") && access(a_path, R_OK) == 0);
+
+  bgpstream_cache_release(cache, "src://a");
+  CHECK("file is evicted once released by all readers",
+        is_cached(cache, "src://c") && access(a_path, R_OK) != 0);
+
+  /* a failed get holds no reference */
+  CHECK("failed get", bgpstream_cache_get(cache, "src://missing", path,
+                                          sizeof(path)) != 0);
+
+  bgpstream_cache_destroy(cache);
+  return 0;
+}
+
+static int test_prefetch_drop()
+{
+  bgpstream_cache_t *cache;
+  bgpstream_input_t in[2];
+  char a_path[BUFFER_LEN];
+
+  CHECK("create prefetching cache",
+        (cache = bgpstream_cache_create(CACHE_DIR, 1, 2)) != NULL);
+
+  /* inputs stay in the queue until they get a reader, so they are usually
+     prefetched more than once */
+  memset(in, 0, sizeof(in));
+  in[0].filename = "src://a";
+  in[0].next = &in[1];
+  in[1].filename = "src://b";
+  bgpstream_cache_prefetch(cache, in);
+  bgpstream_cache_prefetch(cache, in);
+
+  /* a is read, b is rejected (e.g. by the RIB period filter) */
+  CHECK("read prefetched file",
+        bgpstream_cache_get(cache, "src://a", a_path, sizeof(a_path)) == 0);
+  bgpstream_cache_release(cache, "src://a");
+  bgpstream_cache_drop(cache, "src://b");
+
+  /* neither file is pinned any more, so the next download evicts both (as
+     does a prefetch of b that was already running when it was dropped, once
+     it completes) */
+  CHECK("get another file", is_cached(cache, "src://c"));
+  bgpstream_cache_destroy(cache);
+
+  CHECK("prefetched files are released",
+        access(a_path, R_OK) != 0 && count_files(CACHE_DIR, "-b") == 0);
+  return 0;
+}
+
+static int test_sidecars()
+{
+  bgpstream_cache_t *cache;
+  char a_path[BUFFER_LEN];
+  char idx_path[BUFFER_LEN];
+  char tmp_path[BUFFER_LEN];
+  struct timeval times[2] = {{0, 0}, {0, 0}};
+
+  /* room for two dumps, starting from an empty cache */
+  CHECK("clear cache", system("rm -rf " CACHE_DIR) == 0);
+  CHECK("create cache", (cache = bgpstream_cache_create(
+                           CACHE_DIR, FILE_SIZE * 2, 0)) != NULL);
+
+  CHECK("get file",
+        bgpstream_cache_get(cache, "src://a", a_path, sizeof(a_path)) == 0);
+  bgpstream_cache_release(cache, "src://a");
+  /* make it the least recently used file */
+  times[0].tv_sec = time(NULL) - 3600;
+  times[1].tv_sec = times[0].tv_sec;
+  CHECK("age file", utimes(a_path, times) == 0);
+
+  /* a seek index, and one that is being written, next to the cached dump */
+  snprintf(idx_path, sizeof(idx_path), "%s.bsidx", a_path);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.bsidx.1234", a_path);
+  CHECK("create seek indexes",
+        make_file(idx_path) == 0 && make_file(tmp_path) == 0);
+
+  CHECK("seek indexes do not count towards the limit",
+        is_cached(cache, "src://b") && access(a_path, R_OK) == 0 &&
+          access(idx_path, R_OK) == 0 && access(tmp_path, R_OK) == 0);
+
+  CHECK("seek index is evicted along with its dump",
+        is_cached(cache, "src://c") && access(a_path, R_OK) != 0 &&
+          access(idx_path, R_OK) != 0);
+
+  unlink(tmp_path);
+  bgpstream_cache_destroy(cache);
+  return 0;
+}
+
+int main()
+{
+  int rc;
+
+  mkdir(SRC_DIR, 0755);
+  if (make_src("a") != 0 || make_src("b") != 0 || make_src("c") != 0) {
+    fprintf(stderr, "Could not create source files\n");
+    return -1;
+  }
+
+  rc = 0;
+  CHECK_SECTION("cache smaller than a file", test_small_cache() == 0);
+  CHECK_SECTION("prefetch", test_prefetch() == 0);
+  CHECK_SECTION("shared files", test_refcount() == 0);
+  CHECK_SECTION("dropped prefetches", test_prefetch_drop() == 0);
+  CHECK_SECTION("seek indexes", test_sidecars() == 0);
+
+  if (system("rm -rf " SRC_DIR " " CACHE_DIR) != 0) {
+    rc = -1;
+  }
+  return rc;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_histogram.h"
+#include "bgpstream_test.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define VALUE_MAX ((UINT64_C(1) << 48) - 1)
+
+/* a bucket may not be wider than 1/32 of the values it holds */
+static int within_bucket(uint64_t got, uint64_t want)
+{
+  return got >= want && got - want <= want / 32;
+}
+
+/* the percentile of a histogram holding only the given values */
+static uint64_t bucket_of(uint64_t *values, int cnt, double percentile)
+{
+  bgpstream_histogram_t *hist;
+  uint64_t val;
+  int i;
+
+  if ((hist = bgpstream_histogram_create()) == NULL) {
+    return UINT64_MAX;
+  }
+  for (i = 0; i < cnt; i++) {
+    bgpstream_histogram_add(hist, values[i]);
+  }
+  val = bgpstream_histogram_get_percentile(hist, percentile);
+  bgpstream_histogram_destroy(hist);
+  return val;
+}
+
+static int test_empty()
+{
+  bgpstream_histogram_t *hist;
+
+  CHECK("create histogram", (hist = bgpstream_histogram_create()) != NULL);
+  CHECK("empty histogram", bgpstream_histogram_get_count(hist) == 0 &&
+                             bgpstream_histogram_get_min(hist) == 0 &&
+                             bgpstream_histogram_get_max(hist) == 0 &&
+                             bgpstream_histogram_get_mean(hist) == 0 &&
+                             bgpstream_histogram_get_percentile(hist, 50) == 0);
+
+  bgpstream_histogram_destroy(hist);
+  return 0;
+}
+
+static int test_small_values()
+{
+  bgpstream_histogram_t *hist;
+  uint64_t v;
+
+  CHECK("create histogram", (hist = bgpstream_histogram_create()) != NULL);
+
+  for (v = 0; v < 32; v++) {
+    bgpstream_histogram_add(hist, v);
+  }
+  CHECK("count/min/max/mean", bgpstream_histogram_get_count(hist) == 32 &&
+                                bgpstream_histogram_get_min(hist) == 0 &&
+                                bgpstream_histogram_get_max(hist) == 31 &&
+                                bgpstream_histogram_get_mean(hist) == 15.5);
+
+  /* values below 32 have a bucket each */
+  CHECK("exact percentiles",
+        bgpstream_histogram_get_percentile(hist, 0) == 0 &&
+          bgpstream_histogram_get_percentile(hist, 25) == 7 &&
+          bgpstream_histogram_get_percentile(hist, 50) == 15 &&
+          bgpstream_histogram_get_percentile(hist, 100) == 31);
+
+  CHECK("out of range percentiles",
+        bgpstream_histogram_get_percentile(hist, -10) == 0 &&
+          bgpstream_histogram_get_percentile(hist, 1000) == 31);
+
+  bgpstream_histogram_destroy(hist);
+  return 0;
+}
+
+static int test_buckets()
+{
+  uint64_t values[3];
+  uint64_t v;
+  int ok = 1;
+
+  /* each value is reported as the top of its bucket, which must not be
+     below the value nor more than ~3% above it */
+  for (v = 1; v < VALUE_MAX; v += v / 7 + 1) {
+    values[0] = v;
+    values[1] = VALUE_MAX;
+    ok &= within_bucket(bucket_of(values, 2, 50), v);
+  }
+  CHECK("bucket bounds", ok);
+
+  /* the last value of a bucket and the first of the next one */
+  for (v = 64; v < VALUE_MAX; v <<= 1) {
+    values[0] = v - 1;
+    values[1] = v;
+    values[2] = VALUE_MAX;
+    ok &= bucket_of(values, 3, 33) == v - 1;
+    ok &= within_bucket(bucket_of(values, 3, 66), v);
+  }
+  CHECK("bucket edges", ok);
+
+  return 0;
+}
+
+static int test_percentiles()
+{
+  bgpstream_histogram_t *hist;
+  uint64_t v;
+
+  CHECK("create histogram", (hist = bgpstream_histogram_create()) != NULL);
+
+  for (v = 1; v <= 100000; v++) {
+    bgpstream_histogram_add(hist, v);
+  }
+  CHECK("count/min/max/mean", bgpstream_histogram_get_count(hist) == 100000 &&
+                                bgpstream_histogram_get_min(hist) == 1 &&
+                                bgpstream_histogram_get_max(hist) == 100000 &&
+                                bgpstream_histogram_get_mean(hist) == 50000.5);
+
+  CHECK("percentiles",
+        within_bucket(bgpstream_histogram_get_percentile(hist, 1), 1000) &&
+          within_bucket(bgpstream_histogram_get_percentile(hist, 50), 50000) &&
+          within_bucket(bgpstream_histogram_get_percentile(hist, 90), 90000) &&
+          within_bucket(bgpstream_histogram_get_percentile(hist, 99), 99000));
+
+  /* the top bucket is capped at the largest value seen */
+  CHECK("max percentile",
+        bgpstream_histogram_get_percentile(hist, 100) == 100000);
+
+  bgpstream_histogram_destroy(hist);
+  return 0;
+}
+
+static int test_clamp()
+{
+  bgpstream_histogram_t *hist;
+
+  CHECK("create histogram", (hist = bgpstream_histogram_create()) != NULL);
+
+  bgpstream_histogram_add(hist, UINT64_MAX);
+  bgpstream_histogram_add(hist, VALUE_MAX + 1);
+  CHECK("large values are clamped",
+        bgpstream_histogram_get_count(hist) == 2 &&
+          bgpstream_histogram_get_min(hist) == VALUE_MAX &&
+          bgpstream_histogram_get_max(hist) == VALUE_MAX &&
+          bgpstream_histogram_get_percentile(hist, 50) == VALUE_MAX);
+
+  bgpstream_histogram_destroy(hist);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("empty histogram", test_empty() == 0);
+  CHECK_SECTION("small values", test_small_values() == 0);
+  CHECK_SECTION("bucket bounds", test_buckets() == 0);
+  CHECK_SECTION("percentiles", test_percentiles() == 0);
+  CHECK_SECTION("clamping", test_clamp() == 0);
+
+  return 0;
+}
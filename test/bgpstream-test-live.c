@@ -0,0 +1,226 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_datasource_csvfile.h"
+#include "bgpstream_datasource_watch.h"
+#include "bgpstream_filter.h"
+#include "bgpstream_input.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CSV_FILE "bgpstream-test-live.csv"
+
+/* path, project, type, collector, file time, duration, time published */
+#define ROW(name, time)                                                        \
+  name ",routeviews,updates,route-views2," #time ",900," #time "\n"
+
+/* how long a wait may take when it should return (almost) immediately, this
+   is much shorter than the timeouts used for the waits */
+#define PROMPT 5
+
+#define TIMEOUT 30
+
+/* give the main thread time to start waiting before acting */
+#define DELAY_USEC 200000
+
+static void *append_row(void *user)
+{
+  FILE *fh;
+
+  usleep(DELAY_USEC);
+  if ((fh = fopen(CSV_FILE, "a")) == NULL) {
+    return NULL;
+  }
+  fputs(ROW("b.bz2", 1427847300), fh);
+  fclose(fh);
+  return NULL;
+}
+
+static void *interrupt_watch(void *user)
+{
+  usleep(DELAY_USEC);
+  bgpstream_datasource_watch_interrupt(user);
+  return NULL;
+}
+
+static void *interrupt_csvfile(void *user)
+{
+  usleep(DELAY_USEC);
+  bgpstream_csvfile_datasource_interrupt(user);
+  return NULL;
+}
+
+static int write_csv(const char *rows)
+{
+  FILE *fh;
+
+  if ((fh = fopen(CSV_FILE, "w")) == NULL) {
+    return -1;
+  }
+  fputs(rows, fh);
+  fclose(fh);
+  return 0;
+}
+
+static int queue_len(bgpstream_input_mgr_t *input_mgr)
+{
+  bgpstream_input_t *i;
+  int cnt = 0;
+
+  for (i = input_mgr->head; i != NULL; i = i->next) {
+    cnt++;
+  }
+  return cnt;
+}
+
+static int test_watch()
+{
+  bgpstream_datasource_watch_t *watch;
+  pthread_t thread;
+  int id;
+
+  CHECK("write csv file", write_csv(ROW("a.bz2", 1427846400)) == 0);
+  CHECK("create watch", (watch = bgpstream_datasource_watch_create()) != NULL);
+  CHECK("watch local file",
+        (id = bgpstream_datasource_watch_add(watch, CSV_FILE)) >= 0);
+  CHECK("remote files are not watched",
+        bgpstream_datasource_watch_add(watch, "http://localhost/a.csv") < 0);
+
+  CHECK("wait times out without changes",
+        bgpstream_datasource_watch_wait(watch, 1) == 0 &&
+          bgpstream_datasource_watch_changed(watch, id) == 0);
+
+  CHECK("start writer", pthread_create(&thread, NULL, append_row, NULL) == 0);
+  CHECK("wait returns when the file is written",
+        bgpstream_datasource_watch_wait(watch, TIMEOUT) == 1);
+  pthread_join(thread, NULL);
+
+  CHECK("change is reported once",
+        bgpstream_datasource_watch_changed(watch, id) == 1 &&
+          bgpstream_datasource_watch_changed(watch, id) == 0);
+
+  bgpstream_datasource_watch_destroy(watch);
+  unlink(CSV_FILE);
+  return 0;
+}
+
+static int test_interrupt()
+{
+  bgpstream_datasource_watch_t *watch;
+  pthread_t thread;
+  time_t start;
+
+  /* a watch without files is just an interruptible sleep */
+  CHECK("create watch", (watch = bgpstream_datasource_watch_create()) != NULL);
+  CHECK("not interrupted",
+        bgpstream_datasource_watch_interrupted(watch) == 0);
+
+  CHECK("start interrupter",
+        pthread_create(&thread, NULL, interrupt_watch, watch) == 0);
+  start = time(NULL);
+  CHECK("interrupt ends a pending wait",
+        bgpstream_datasource_watch_wait(watch, TIMEOUT) == 0 &&
+          time(NULL) - start < PROMPT);
+  pthread_join(thread, NULL);
+
+  start = time(NULL);
+  CHECK("later waits return immediately",
+        bgpstream_datasource_watch_interrupted(watch) == 1 &&
+          bgpstream_datasource_watch_wait(watch, TIMEOUT) == 0 &&
+          time(NULL) - start < PROMPT);
+
+  /* interrupting again must not block */
+  bgpstream_datasource_watch_interrupt(watch);
+  bgpstream_datasource_watch_destroy(watch);
+  return 0;
+}
+
+static int test_csvfile()
+{
+  bgpstream_filter_mgr_t *filter_mgr;
+  bgpstream_csvfile_datasource_t *ds;
+  bgpstream_input_mgr_t *input_mgr;
+  pthread_t thread;
+  time_t start;
+
+  CHECK("write csv file", write_csv(ROW("a.bz2", 1427846400)) == 0);
+  CHECK("create filter manager",
+        (filter_mgr = bgpstream_filter_mgr_create()) != NULL);
+  CHECK("create input queue",
+        (input_mgr = bgpstream_input_mgr_create()) != NULL);
+  CHECK("create data source",
+        (ds = bgpstream_csvfile_datasource_create(filter_mgr, CSV_FILE)) !=
+          NULL);
+
+  CHECK("initial inputs",
+        bgpstream_csvfile_datasource_update_input_queue(ds, input_mgr) == 1 &&
+          queue_len(input_mgr) == 1);
+  CHECK("no new inputs",
+        bgpstream_csvfile_datasource_update_input_queue(ds, input_mgr) == 0);
+
+  CHECK("start writer", pthread_create(&thread, NULL, append_row, NULL) == 0);
+  CHECK("wait returns when a row is appended",
+        bgpstream_csvfile_datasource_wait(ds, TIMEOUT) == 1);
+  pthread_join(thread, NULL);
+
+  CHECK("appended input is queued",
+        bgpstream_csvfile_datasource_update_input_queue(ds, input_mgr) == 1 &&
+          queue_len(input_mgr) == 2 &&
+          strcmp(input_mgr->head->next->filename, "b.bz2") == 0);
+
+  CHECK("start interrupter",
+        pthread_create(&thread, NULL, interrupt_csvfile, ds) == 0);
+  start = time(NULL);
+  CHECK("interrupt ends a pending wait",
+        bgpstream_csvfile_datasource_wait(ds, TIMEOUT) == 0 &&
+          time(NULL) - start < PROMPT);
+  pthread_join(thread, NULL);
+
+  bgpstream_csvfile_datasource_destroy(ds);
+  bgpstream_input_mgr_destroy(input_mgr);
+  bgpstream_filter_mgr_destroy(filter_mgr);
+  unlink(CSV_FILE);
+  return 0;
+}
+
+int main()
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  CHECK_SECTION("file notifications", test_watch() == 0);
+#else
+  SKIPPED_SECTION("file notifications");
+#endif
+  CHECK_SECTION("interrupts", test_interrupt() == 0);
+#ifdef HAVE_SYS_INOTIFY_H
+  CHECK_SECTION("csvfile data source", test_csvfile() == 0);
+#else
+  SKIPPED_SECTION("csvfile data source");
+#endif
+  return 0;
+}
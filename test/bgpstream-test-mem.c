@@ -0,0 +1,319 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_mem.h"
+#include "bgpstream_test.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS_CNT 8
+#define ROUNDS_CNT 10000
+
+#define UPDATES_FILE "ris.rrc06.updates.1427846400.gz"
+
+static int test_account()
+{
+  bgpstream_mem_t *mem;
+  bgpstream_mem_usage_t usage;
+  size_t a = 0, b = 0, c = 0;
+
+  CHECK("create accounting", (mem = bgpstream_mem_create()) != NULL);
+
+  bgpstream_mem_snapshot(mem, &usage);
+  CHECK("nothing accounted", usage.bytes[BGPSTREAM_MEM_READERS] == 0 &&
+                               usage.peak_bytes[BGPSTREAM_MEM_READERS] == 0);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &a, 1000);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &b, 500);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_ELEMS, &c, 300);
+  bgpstream_mem_snapshot(mem, &usage);
+  CHECK("grow", a == 1000 && b == 500 && c == 300 &&
+                  usage.bytes[BGPSTREAM_MEM_READERS] == 1500 &&
+                  usage.bytes[BGPSTREAM_MEM_ELEMS] == 300 &&
+                  usage.bytes[BGPSTREAM_MEM_PEER_INDEX] == 0 &&
+                  usage.peak_bytes[BGPSTREAM_MEM_READERS] == 1500);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &a, 200);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &b, 500);
+  bgpstream_mem_snapshot(mem, &usage);
+  CHECK("shrink keeps the peak",
+        a == 200 && usage.bytes[BGPSTREAM_MEM_READERS] == 700 &&
+          usage.peak_bytes[BGPSTREAM_MEM_READERS] == 1500);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &a, 1200);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &b, 0);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_ELEMS, &c, 0);
+  bgpstream_mem_snapshot(mem, &usage);
+  CHECK("new peak", b == 0 && usage.bytes[BGPSTREAM_MEM_READERS] == 1200 &&
+                      usage.peak_bytes[BGPSTREAM_MEM_READERS] == 1700 &&
+                      usage.bytes[BGPSTREAM_MEM_ELEMS] == 0 &&
+                      usage.peak_bytes[BGPSTREAM_MEM_ELEMS] == 300);
+
+  /* helpers are no-ops without an accounting structure */
+  bgpstream_mem_account(NULL, BGPSTREAM_MEM_READERS, &a, 5000);
+  CHECK("NULL accounting", a == 1200 &&
+                             bgpstream_mem_check_limits(NULL) == -1 &&
+                             bgpstream_mem_is_high(NULL, 0) == 0);
+
+  bgpstream_mem_unref(mem);
+  return 0;
+}
+
+static int test_limits()
+{
+  bgpstream_mem_t *mem;
+  size_t readers = 0, elems = 0, filters = 0;
+
+  CHECK("create accounting", (mem = bgpstream_mem_create()) != NULL);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 1 << 20);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_ELEMS, &elems, 1 << 20);
+  CHECK("no limits", bgpstream_mem_check_limits(mem) == -1 &&
+                       bgpstream_mem_is_high(mem, BGPSTREAM_MEM_READERS) == 0);
+
+  /* high above 3/4 of the limit, over the limit above the limit itself */
+  bgpstream_mem_set_limit(mem, BGPSTREAM_MEM_READERS, 4000);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 3000);
+  CHECK("at 3/4 of the limit",
+        bgpstream_mem_is_high(mem, BGPSTREAM_MEM_READERS) == 0 &&
+          bgpstream_mem_check_limits(mem) == -1);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 3001);
+  CHECK("above 3/4 of the limit",
+        bgpstream_mem_is_high(mem, BGPSTREAM_MEM_READERS) == 1 &&
+          bgpstream_mem_is_high(mem, BGPSTREAM_MEM_ELEMS) == 0 &&
+          bgpstream_mem_check_limits(mem) == -1);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 4000);
+  CHECK("at the limit",
+        bgpstream_mem_check_limits(mem) == -1 &&
+          bgpstream_mem_is_over(mem, BGPSTREAM_MEM_READERS) == 0);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 4001);
+  CHECK("over the limit",
+        bgpstream_mem_check_limits(mem) == BGPSTREAM_MEM_READERS &&
+          bgpstream_mem_is_over(mem, BGPSTREAM_MEM_READERS) == 1 &&
+          bgpstream_mem_is_over(mem, BGPSTREAM_MEM_ELEMS) == 0);
+
+  /* the first subsystem that is over its limit is reported */
+  bgpstream_mem_set_limit(mem, BGPSTREAM_MEM_FILTERS, 100);
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_FILTERS, &filters, 200);
+  CHECK("several subsystems over their limit",
+        bgpstream_mem_check_limits(mem) == BGPSTREAM_MEM_READERS);
+
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_READERS, &readers, 0);
+  CHECK("back under the limit",
+        bgpstream_mem_check_limits(mem) == BGPSTREAM_MEM_FILTERS &&
+          bgpstream_mem_is_high(mem, BGPSTREAM_MEM_READERS) == 0);
+
+  bgpstream_mem_set_limit(mem, BGPSTREAM_MEM_FILTERS, 0);
+  CHECK("limit removed",
+        bgpstream_mem_check_limits(mem) == -1 &&
+          bgpstream_mem_is_high(mem, BGPSTREAM_MEM_FILTERS) == 0);
+
+  bgpstream_mem_unref(mem);
+  return 0;
+}
+
+static void *account_thread(void *user)
+{
+  bgpstream_mem_t *mem = user;
+  size_t accounted = 0;
+  int i;
+
+  for (i = 0; i < ROUNDS_CNT; i++) {
+    bgpstream_mem_account(mem, BGPSTREAM_MEM_ELEMS, &accounted, i % 100 + 1);
+  }
+  bgpstream_mem_account(mem, BGPSTREAM_MEM_ELEMS, &accounted, 10);
+  bgpstream_mem_unref(mem);
+  return NULL;
+}
+
+static int test_threads()
+{
+  bgpstream_mem_t *mem;
+  bgpstream_mem_usage_t usage;
+  pthread_t threads[THREADS_CNT];
+  int started = 0;
+  int i;
+
+  CHECK("create accounting", (mem = bgpstream_mem_create()) != NULL);
+
+  /* each thread holds its own reference, as records do */
+  for (i = 0; i < THREADS_CNT; i++) {
+    started += pthread_create(&threads[i], NULL, account_thread,
+                              bgpstream_mem_ref(mem)) == 0;
+  }
+  for (i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  CHECK("start threads", started == THREADS_CNT);
+
+  bgpstream_mem_snapshot(mem, &usage);
+  CHECK("concurrent accounting",
+        usage.bytes[BGPSTREAM_MEM_ELEMS] == THREADS_CNT * 10 &&
+          usage.peak_bytes[BGPSTREAM_MEM_ELEMS] >= 100 &&
+          usage.peak_bytes[BGPSTREAM_MEM_ELEMS] <= THREADS_CNT * 100);
+
+  bgpstream_mem_unref(mem);
+  return 0;
+}
+
+static int test_records()
+{
+  bgpstream_t *bs;
+  bgpstream_t *bs2;
+  bgpstream_record_t *record;
+  bgpstream_mem_usage_t usage;
+  bgpstream_mem_usage_t usage2;
+
+  CHECK("create streams", (bs = bgpstream_create()) != NULL &&
+                            (bs2 = bgpstream_create()) != NULL);
+  CHECK("create record", (record = bgpstream_record_create()) != NULL);
+
+  /* even an empty record has an elem generator */
+  bgpstream_record_attach(record, bs);
+  bgpstream_get_mem_usage(bs, &usage);
+  CHECK("attached record is accounted",
+        record->bs == bs && usage.bytes[BGPSTREAM_MEM_ELEMS] > 0);
+
+  /* e.g. a record that the data of another stream is moved into */
+  bgpstream_record_attach(record, bs2);
+  bgpstream_get_mem_usage(bs, &usage);
+  bgpstream_get_mem_usage(bs2, &usage2);
+  CHECK("re-attached record moves its accounting",
+        usage.bytes[BGPSTREAM_MEM_ELEMS] == 0 &&
+          usage2.bytes[BGPSTREAM_MEM_ELEMS] > 0);
+
+  bgpstream_record_attach(record, NULL);
+  bgpstream_get_mem_usage(bs2, &usage2);
+  CHECK("detached record is not accounted",
+        record->bs == NULL && usage2.bytes[BGPSTREAM_MEM_ELEMS] == 0);
+
+  /* the record may outlive the stream */
+  bgpstream_record_attach(record, bs);
+  bgpstream_destroy(bs);
+  bgpstream_destroy(bs2);
+  bgpstream_record_destroy(record);
+  return 0;
+}
+
+/* read the updates file with a limit on one subsystem, returning the result of
+   the last bgpstream_get_next_record call (or -100 if the stream could not be
+   set up) */
+static int read_limited(bgpstream_mem_subsystem_t subsystem, uint64_t limit,
+                        int *records_cnt)
+{
+  bgpstream_t *bs;
+  bgpstream_record_t *record;
+  bgpstream_data_interface_id_t di;
+  bgpstream_data_interface_option_t *option;
+  int rc = -100;
+
+  *records_cnt = 0;
+  if ((bs = bgpstream_create()) == NULL ||
+      (record = bgpstream_record_create()) == NULL) {
+    return -100;
+  }
+  di = bgpstream_get_data_interface_id_by_name(bs, "singlefile");
+  bgpstream_set_data_interface(bs, di);
+  if ((option = bgpstream_get_data_interface_option_by_name(
+         bs, di, "upd-file")) == NULL) {
+    goto done;
+  }
+  bgpstream_set_data_interface_option(bs, option, UPDATES_FILE);
+  bgpstream_set_mem_limit(bs, subsystem, limit);
+  if (bgpstream_start(bs) != 0) {
+    goto done;
+  }
+  while ((rc = bgpstream_get_next_record(bs, record)) > 0) {
+    (*records_cnt)++;
+    while (bgpstream_record_get_next_elem(record) != NULL) {
+    }
+  }
+
+done:
+  bgpstream_record_destroy(record);
+  bgpstream_destroy(bs);
+  return rc;
+}
+
+static int test_stream_limits()
+{
+  int unlimited_cnt;
+  int cnt;
+
+  CHECK("read without limits",
+        read_limited(BGPSTREAM_MEM_READERS, 0, &unlimited_cnt) == 0 &&
+          unlimited_cnt > 0);
+
+  /* readers recover as they are read, so they only slow down */
+  CHECK("readers over their limit",
+        read_limited(BGPSTREAM_MEM_READERS, 1, &cnt) == 0 &&
+          cnt == unlimited_cnt);
+
+  /* the elems of the record cannot be given back */
+  CHECK("elems over their limit",
+        read_limited(BGPSTREAM_MEM_ELEMS, 1, &cnt) == -1 &&
+          cnt < unlimited_cnt);
+
+  CHECK("filters over their limit",
+        read_limited(BGPSTREAM_MEM_FILTERS, 1, &cnt) == -100 && cnt == 0);
+
+  /* the wandio estimate is given back when the file is closed */
+  CHECK("wandio estimate over its limit",
+        read_limited(BGPSTREAM_MEM_WANDIO_ESTIMATE, 1, &cnt) == 0 &&
+          cnt == unlimited_cnt);
+  return 0;
+}
+
+static int test_names()
+{
+  int sub;
+  int ok = 1;
+
+  for (sub = 0; sub < BGPSTREAM_MEM_CNT; sub++) {
+    ok &= bgpstream_get_mem_subsystem_by_name(
+            bgpstream_get_mem_subsystem_name(sub)) == (int)sub;
+  }
+  CHECK("subsystem names round-trip", ok);
+  CHECK("estimate is named as such",
+        strcmp(bgpstream_get_mem_subsystem_name(
+                 BGPSTREAM_MEM_WANDIO_ESTIMATE),
+               "wandio_estimate") == 0);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("memory accounting", test_account() == 0);
+  CHECK_SECTION("memory limits", test_limits() == 0);
+  CHECK_SECTION("concurrent accounting", test_threads() == 0);
+  CHECK_SECTION("record accounting", test_records() == 0);
+  CHECK_SECTION("stream limits", test_stream_limits() == 0);
+  CHECK_SECTION("subsystem names", test_names() == 0);
+
+  return 0;
+}
@@ -0,0 +1,370 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_metrics.h"
+#include "bgpstream_test.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_FILE "bgpstream-test-metrics.prom"
+#define METRICS_TMP_FILE METRICS_FILE ".tmp"
+
+#define PREFIX "test"
+
+/* longest to wait for a report to be written */
+#define REPORT_WAIT_SECS 5
+
+/* longer than any test runs for, so that only the final report is sent */
+#define LONG_INTERVAL 3600
+
+/* largest statsd packet that the emitter sends */
+#define STATSD_PACKET_MAX 1400
+
+#define REPORT_LEN 65536
+
+/* application metrics written by the callback */
+#define APP_METRICS                                                            \
+  "# TYPE " PREFIX "_app_records_total counter\n" PREFIX                       \
+  "_app_records_total{plugin=\"a\"} 1\n" PREFIX                                \
+  "_app_records_total{plugin=\"b\"} 2\n"                                       \
+  "# TYPE " PREFIX "_app_queue_len gauge\n" PREFIX "_app_queue_len 3\n"
+
+/* a counter of the stream, before any records have been read */
+#define RECORDS_PARSED                                                         \
+  "# TYPE " PREFIX "_records_parsed_total counter\n" PREFIX                    \
+  "_records_parsed_total 0\n"
+
+#define STATSD_APP_METRICS                                                     \
+  PREFIX ".app_records_total.a:1|g\n" PREFIX ".app_records_total.b:2|g\n"      \
+  PREFIX ".app_queue_len:3|g\n"
+
+typedef struct cb_state {
+  /* number of times the callback has run */
+  int calls;
+
+  /* number of filler metrics to add to each report */
+  int filler_cnt;
+} cb_state_t;
+
+static void app_metrics(bgpstream_metrics_t *metrics, void *user)
+{
+  cb_state_t *state = user;
+  char name[64];
+  int i;
+
+  state->calls++;
+  bgpstream_metrics_write(metrics, "app_records_total", "plugin", "a",
+                          BGPSTREAM_METRICS_TYPE_COUNTER, 1);
+  bgpstream_metrics_write(metrics, "app_records_total", "plugin", "b",
+                          BGPSTREAM_METRICS_TYPE_COUNTER, 2);
+  bgpstream_metrics_write(metrics, "app_queue_len", NULL, NULL,
+                          BGPSTREAM_METRICS_TYPE_GAUGE, 3);
+  for (i = 0; i < state->filler_cnt; i++) {
+    snprintf(name, sizeof(name), "app_filler_%d", i);
+    bgpstream_metrics_write(metrics, name, NULL, NULL,
+                            BGPSTREAM_METRICS_TYPE_GAUGE, i);
+  }
+}
+
+static double now_secs(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* wait until the metrics file exists and is not the given inode */
+static int wait_for_report(ino_t old_ino)
+{
+  struct stat st;
+  double deadline = now_secs() + REPORT_WAIT_SECS;
+
+  while (now_secs() < deadline) {
+    if (stat(METRICS_FILE, &st) == 0 && st.st_ino != old_ino) {
+      return 0;
+    }
+    usleep(50000);
+  }
+  return -1;
+}
+
+static int read_report(FILE *fh, char *buf)
+{
+  size_t len;
+
+  rewind(fh);
+  len = fread(buf, 1, REPORT_LEN - 1, fh);
+  buf[len] = '\0';
+  return len > 0 && len < REPORT_LEN - 1 ? 0 : -1;
+}
+
+static int count(const char *haystack, const char *needle)
+{
+  int cnt = 0;
+
+  while ((haystack = strstr(haystack, needle)) != NULL) {
+    cnt++;
+    haystack++;
+  }
+  return cnt;
+}
+
+/* check that every line is either a type comment or a sample of one of our
+   metrics, and that the file is complete */
+static int is_exposition(const char *report)
+{
+  const char *line = report;
+  const char *end;
+
+  while (*line != '\0') {
+    if ((end = strchr(line, '\n')) == NULL) {
+      return 0;
+    }
+    if (strncmp(line, "# TYPE " PREFIX "_", strlen("# TYPE " PREFIX "_")) !=
+          0 &&
+        strncmp(line, PREFIX "_", strlen(PREFIX "_")) != 0) {
+      return 0;
+    }
+    line = end + 1;
+  }
+  return 1;
+}
+
+static int test_file()
+{
+  bgpstream_t *bs;
+  bgpstream_metrics_t *metrics;
+  cb_state_t state = {0, 0};
+  static char report[REPORT_LEN];
+  static char again[REPORT_LEN];
+  struct stat st;
+  FILE *fh;
+
+  unlink(METRICS_FILE);
+  CHECK("create stream", (bs = bgpstream_create()) != NULL);
+  bgpstream_enable_lag_tracking(bs);
+  CHECK("create emitter",
+        (metrics = bgpstream_metrics_create(bs, METRICS_FILE, PREFIX, 1)) !=
+          NULL);
+  bgpstream_metrics_set_callback(metrics, app_metrics, &state);
+  CHECK("start emitter", bgpstream_metrics_start(metrics) == 0);
+
+  CHECK("report written", wait_for_report(0) == 0);
+  CHECK("open report", (fh = fopen(METRICS_FILE, "r")) != NULL &&
+                         fstat(fileno(fh), &st) == 0 &&
+                         read_report(fh, report) == 0);
+  CHECK("temporary file renamed", access(METRICS_TMP_FILE, F_OK) != 0);
+  CHECK("exposition format", is_exposition(report));
+  CHECK("stream metrics",
+        strstr(report, "# TYPE " PREFIX "_uptime_seconds gauge\n") != NULL &&
+          strstr(report, RECORDS_PARSED) != NULL);
+  CHECK("labelled metrics have one type line",
+        count(report, "# TYPE " PREFIX "_mem_bytes ") == 1 &&
+          count(report, PREFIX "_mem_bytes{subsystem=\"") ==
+            BGPSTREAM_MEM_CNT &&
+          count(report, "# TYPE " PREFIX "_stage_seconds_total ") == 1 &&
+          count(report, PREFIX "_stage_seconds_total{stage=\"") ==
+            BGPSTREAM_STAGE_CNT);
+  CHECK("lag metrics", count(report, PREFIX "_lag_p99_seconds{lag=\"") ==
+                         BGPSTREAM_LAG_CNT);
+  CHECK("application metrics", strstr(report, APP_METRICS) != NULL);
+
+  /* the next report replaces the file rather than rewriting it, so a reader
+     that still has the old file open sees the whole of the old report */
+  CHECK("report replaced", wait_for_report(st.st_ino) == 0);
+  CHECK("old report unchanged",
+        read_report(fh, again) == 0 && strcmp(report, again) == 0);
+  fclose(fh);
+
+  bgpstream_metrics_destroy(metrics);
+  CHECK("callback run for each report", state.calls >= 2);
+  bgpstream_destroy(bs);
+  unlink(METRICS_FILE);
+  return 0;
+}
+
+static int test_shutdown()
+{
+  bgpstream_t *bs;
+  bgpstream_metrics_t *metrics;
+  cb_state_t state = {0, 0};
+  double start;
+  FILE *fh;
+  static char report[REPORT_LEN];
+
+  unlink(METRICS_FILE);
+  CHECK("create stream", (bs = bgpstream_create()) != NULL);
+  CHECK("create emitter",
+        (metrics = bgpstream_metrics_create(bs, METRICS_FILE, PREFIX,
+                                            LONG_INTERVAL)) != NULL);
+  bgpstream_metrics_set_callback(metrics, app_metrics, &state);
+  CHECK("start emitter", bgpstream_metrics_start(metrics) == 0 &&
+                           bgpstream_metrics_start(metrics) == 0);
+
+  /* destroying the emitter wakes it up, rather than waiting for the interval
+     to end, and writes a final report */
+  start = now_secs();
+  bgpstream_metrics_destroy(metrics);
+  CHECK("stop without waiting for the interval",
+        now_secs() - start < REPORT_WAIT_SECS);
+  CHECK("final report written",
+        state.calls == 1 && (fh = fopen(METRICS_FILE, "r")) != NULL &&
+          read_report(fh, report) == 0 &&
+          strstr(report, APP_METRICS) != NULL);
+  fclose(fh);
+
+  /* an emitter that was never started is destroyed without a report */
+  unlink(METRICS_FILE);
+  CHECK("create emitter",
+        (metrics = bgpstream_metrics_create(bs, METRICS_FILE, PREFIX, 1)) !=
+          NULL);
+  bgpstream_metrics_destroy(metrics);
+  CHECK("no report if not started", access(METRICS_FILE, F_OK) != 0);
+
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+/* bind a UDP socket to a random loopback port, returning the port */
+static int statsd_listen(int family, int *sock)
+{
+  struct sockaddr_storage addr;
+  struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+  struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+  socklen_t addr_len = sizeof(addr);
+  struct timeval timeout = {REPORT_WAIT_SECS, 0};
+
+  memset(&addr, 0, sizeof(addr));
+  addr.ss_family = family;
+  if (family == AF_INET) {
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  } else {
+    sin6->sin6_addr = in6addr_loopback;
+  }
+  if ((*sock = socket(family, SOCK_DGRAM, 0)) < 0) {
+    return -1;
+  }
+  if (bind(*sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      getsockname(*sock, (struct sockaddr *)&addr, &addr_len) != 0 ||
+      setsockopt(*sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) !=
+        0) {
+    close(*sock);
+    return -1;
+  }
+  return ntohs(family == AF_INET ? sin->sin_port : sin6->sin6_port);
+}
+
+/* run an emitter until its final report is sent, and check the packets */
+static int statsd_report(bgpstream_t *bs, const char *dest, int sock)
+{
+  bgpstream_metrics_t *metrics;
+  cb_state_t state = {0, 100};
+  static char report[REPORT_LEN];
+  size_t report_len = 0;
+  ssize_t len;
+  int packets = 0;
+  int flags = 0;
+
+  if ((metrics = bgpstream_metrics_create(bs, dest, PREFIX, LONG_INTERVAL)) ==
+      NULL) {
+    return -1;
+  }
+  bgpstream_metrics_set_callback(metrics, app_metrics, &state);
+  if (bgpstream_metrics_start(metrics) != 0) {
+    bgpstream_metrics_destroy(metrics);
+    return -1;
+  }
+  bgpstream_metrics_destroy(metrics);
+
+  /* the report is split into packets on line boundaries */
+  while (report_len < REPORT_LEN - 1 &&
+         (len = recv(sock, report + report_len, REPORT_LEN - 1 - report_len,
+                     flags)) > 0) {
+    if (len > STATSD_PACKET_MAX || report[report_len + len - 1] != '\n') {
+      return -1;
+    }
+    report_len += len;
+    packets++;
+    /* the whole report was sent before the emitter was destroyed */
+    flags = MSG_DONTWAIT;
+  }
+  report[report_len] = '\0';
+
+  return packets > 1 && strchr(report, '#') == NULL &&
+             strstr(report, PREFIX ".uptime_seconds:") != NULL &&
+             strstr(report, PREFIX ".mem_bytes.") != NULL &&
+             strstr(report, STATSD_APP_METRICS) != NULL &&
+             strstr(report, PREFIX ".app_filler_99:99|g\n") != NULL
+           ? 0
+           : -1;
+}
+
+static int test_statsd()
+{
+  bgpstream_t *bs;
+  char dest[64];
+  int sock;
+  int port;
+
+  CHECK("create stream", (bs = bgpstream_create()) != NULL);
+
+  CHECK("listen on IPv4", (port = statsd_listen(AF_INET, &sock)) > 0);
+  snprintf(dest, sizeof(dest), "udp://127.0.0.1:%d", port);
+  CHECK("IPv4 report", statsd_report(bs, dest, sock) == 0);
+  close(sock);
+
+  if ((port = statsd_listen(AF_INET6, &sock)) > 0) {
+    snprintf(dest, sizeof(dest), "udp://[::1]:%d", port);
+    CHECK("bracketed IPv6 report", statsd_report(bs, dest, sock) == 0);
+    close(sock);
+  } else {
+    SKIPPED("bracketed IPv6 report");
+  }
+
+  CHECK("reject missing port",
+        bgpstream_metrics_create(bs, "udp://127.0.0.1", PREFIX, 1) == NULL &&
+          bgpstream_metrics_create(bs, "udp://[::1]", PREFIX, 1) == NULL);
+  CHECK("reject bad interval",
+        bgpstream_metrics_create(bs, METRICS_FILE, PREFIX, 0) == NULL);
+
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("file output", test_file() == 0);
+  CHECK_SECTION("shutdown", test_shutdown() == 0);
+  CHECK_SECTION("statsd output", test_statsd() == 0);
+  return 0;
+}
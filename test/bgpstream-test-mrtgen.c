@@ -0,0 +1,392 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "mrtgen.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define RIB_FILE "bgpstream-test-mrtgen.rib"
+#define UPDATES_FILE "bgpstream-test-mrtgen.upd"
+#define OTHER_FILE "bgpstream-test-mrtgen.other"
+
+#define DUMP_TIME 1427846400
+#define DUMP_DURATION 300
+
+#define BUFFER_LEN 4096
+
+/* what was read back from a generated dump */
+typedef struct dump_cnts {
+  int records;
+  int elems;
+  int elem_types[BGPSTREAM_ELEM_TYPE_PEERSTATE + 1];
+  int v6_peer_elems;
+  int max_record_elems;
+  int path_len_min;
+  int path_len_max;
+  int max_communities;
+  int unknown_pfxs;
+  uint32_t time_min;
+  uint32_t time_max;
+} dump_cnts_t;
+
+/* a small table, so that every check is quick */
+static void config_init(mrtgen_config_t *cfg)
+{
+  mrtgen_config_init(cfg);
+  cfg->seed = 7;
+  cfg->peer_cnt = 4;
+  cfg->v4_pfx_cnt = 90;
+  cfg->v6_pfx_cnt = 10;
+  cfg->update_cnt = 200;
+}
+
+static int is_table_pfx(mrtgen_t *gen, bgpstream_pfx_storage_t *pfx)
+{
+  bgpstream_pfx_storage_t *pfxs;
+  int cnt = mrtgen_get_pfxs(gen, &pfxs);
+  int i;
+
+  for (i = 0; i < cnt; i++) {
+    if (bgpstream_pfx_equal((bgpstream_pfx_t *)&pfxs[i],
+                            (bgpstream_pfx_t *)pfx)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* read a generated dump back using the singlefile data interface */
+static int read_dump(mrtgen_t *gen, const char *option_name, const char *file,
+                     dump_cnts_t *cnts)
+{
+  bgpstream_t *bs;
+  bgpstream_record_t *record;
+  bgpstream_data_interface_id_t di;
+  bgpstream_data_interface_option_t *option;
+  bgpstream_elem_t *elem;
+  int record_elems, len, rc = -1;
+
+  memset(cnts, 0, sizeof(*cnts));
+  cnts->path_len_min = -1;
+  if ((bs = bgpstream_create()) == NULL ||
+      (record = bgpstream_record_create()) == NULL) {
+    return -1;
+  }
+  di = bgpstream_get_data_interface_id_by_name(bs, "singlefile");
+  bgpstream_set_data_interface(bs, di);
+  if ((option = bgpstream_get_data_interface_option_by_name(
+         bs, di, option_name)) == NULL) {
+    goto done;
+  }
+  bgpstream_set_data_interface_option(bs, option, file);
+  if (bgpstream_start(bs) != 0) {
+    goto done;
+  }
+
+  while ((rc = bgpstream_get_next_record(bs, record)) > 0) {
+    if (record->status != BGPSTREAM_RECORD_STATUS_VALID_RECORD) {
+      rc = -1;
+      goto done;
+    }
+    if (cnts->records == 0 || record->attributes.record_time < cnts->time_min) {
+      cnts->time_min = record->attributes.record_time;
+    }
+    if (record->attributes.record_time > cnts->time_max) {
+      cnts->time_max = record->attributes.record_time;
+    }
+    cnts->records++;
+
+    record_elems = 0;
+    while ((elem = bgpstream_record_get_next_elem(record)) != NULL) {
+      cnts->elems++;
+      record_elems++;
+      cnts->elem_types[elem->type]++;
+      cnts->v6_peer_elems +=
+        elem->peer_address.version == BGPSTREAM_ADDR_VERSION_IPV6;
+      cnts->unknown_pfxs += !is_table_pfx(gen, &elem->prefix);
+      if (elem->type != BGPSTREAM_ELEM_TYPE_RIB &&
+          elem->type != BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT) {
+        continue;
+      }
+      len = bgpstream_as_path_get_len(elem->aspath);
+      if (cnts->path_len_min < 0 || len < cnts->path_len_min) {
+        cnts->path_len_min = len;
+      }
+      if (len > cnts->path_len_max) {
+        cnts->path_len_max = len;
+      }
+      len = bgpstream_community_set_size(elem->communities);
+      if (len > cnts->max_communities) {
+        cnts->max_communities = len;
+      }
+    }
+    if (record_elems > cnts->max_record_elems) {
+      cnts->max_record_elems = record_elems;
+    }
+  }
+
+done:
+  bgpstream_record_destroy(record);
+  bgpstream_destroy(bs);
+  return rc;
+}
+
+/* compare the contents of two files, returning 1 if they are identical */
+static int same_contents(const char *path1, const char *path2)
+{
+  FILE *f1 = fopen(path1, "r");
+  FILE *f2 = fopen(path2, "r");
+  char buf1[BUFFER_LEN], buf2[BUFFER_LEN];
+  size_t len1, len2;
+  int same = f1 != NULL && f2 != NULL;
+
+  while (same) {
+    len1 = fread(buf1, 1, BUFFER_LEN, f1);
+    len2 = fread(buf2, 1, BUFFER_LEN, f2);
+    same = len1 == len2 && memcmp(buf1, buf2, len1) == 0;
+    if (len1 == 0) {
+      break;
+    }
+  }
+  if (f1 != NULL) {
+    fclose(f1);
+  }
+  if (f2 != NULL) {
+    fclose(f2);
+  }
+  return same;
+}
+
+static int test_rib()
+{
+  mrtgen_config_t cfg;
+  mrtgen_t *gen;
+  bgpstream_pfx_storage_t *pfxs;
+  dump_cnts_t cnts;
+
+  config_init(&cfg);
+  CHECK("create generator", (gen = mrtgen_create(&cfg)) != NULL);
+  CHECK("table prefixes",
+        mrtgen_get_pfxs(gen, &pfxs) == 100 &&
+          pfxs[89].address.version == BGPSTREAM_ADDR_VERSION_IPV4 &&
+          pfxs[90].address.version == BGPSTREAM_ADDR_VERSION_IPV6);
+  CHECK("write RIB dump", mrtgen_write_rib(gen, RIB_FILE, DUMP_TIME) == 0);
+  CHECK("read RIB dump", read_dump(gen, "rib-file", RIB_FILE, &cnts) == 0);
+
+  /* one record per prefix, with an entry for every peer */
+  CHECK("RIB records", cnts.records == 100 && cnts.time_min == DUMP_TIME &&
+                         cnts.time_max == DUMP_TIME);
+  CHECK("RIB elems", cnts.elems == 100 * 4 &&
+                       cnts.elem_types[BGPSTREAM_ELEM_TYPE_RIB] == 100 * 4 &&
+                       cnts.max_record_elems == 4 && cnts.unknown_pfxs == 0);
+  CHECK("IPv6 peer", cnts.v6_peer_elems == 100);
+  CHECK("RIB attributes", cnts.path_len_min >= cfg.path_len_min &&
+                            cnts.path_len_max <= cfg.path_len_max &&
+                            cnts.path_len_min < cnts.path_len_max &&
+                            cnts.max_communities <= cfg.community_max &&
+                            cnts.max_communities > 0);
+
+  mrtgen_destroy(gen);
+  remove(RIB_FILE);
+  return 0;
+}
+
+static int test_updates()
+{
+  mrtgen_config_t cfg;
+  mrtgen_t *gen;
+  dump_cnts_t cnts;
+
+  config_init(&cfg);
+  CHECK("create generator", (gen = mrtgen_create(&cfg)) != NULL);
+  CHECK("write updates dump", mrtgen_write_updates(gen, UPDATES_FILE,
+                                                   DUMP_TIME,
+                                                   DUMP_DURATION) == 0);
+  CHECK("read updates dump",
+        read_dump(gen, "upd-file", UPDATES_FILE, &cnts) == 0);
+
+  CHECK("update records", cnts.records == 200 &&
+                            cnts.time_min == DUMP_TIME &&
+                            cnts.time_max < DUMP_TIME + DUMP_DURATION &&
+                            cnts.time_max > DUMP_TIME + DUMP_DURATION / 2);
+  CHECK("update elems",
+        cnts.elem_types[BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT] > 0 &&
+          cnts.elem_types[BGPSTREAM_ELEM_TYPE_WITHDRAWAL] > 0 &&
+          cnts.elem_types[BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT] >
+            cnts.elem_types[BGPSTREAM_ELEM_TYPE_WITHDRAWAL] &&
+          cnts.max_record_elems <= cfg.update_pfx_max &&
+          cnts.elems > cnts.records && cnts.unknown_pfxs == 0);
+  mrtgen_destroy(gen);
+
+  /* messages are either all announcements or all withdrawals */
+  cfg.withdraw_pct = 0;
+  CHECK("announcements only",
+        (gen = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_updates(gen, UPDATES_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          read_dump(gen, "upd-file", UPDATES_FILE, &cnts) == 0 &&
+          cnts.elem_types[BGPSTREAM_ELEM_TYPE_ANNOUNCEMENT] == cnts.elems);
+  mrtgen_destroy(gen);
+
+  cfg.withdraw_pct = 100;
+  CHECK("withdrawals only",
+        (gen = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_updates(gen, UPDATES_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          read_dump(gen, "upd-file", UPDATES_FILE, &cnts) == 0 &&
+          cnts.elem_types[BGPSTREAM_ELEM_TYPE_WITHDRAWAL] == cnts.elems);
+  mrtgen_destroy(gen);
+
+  /* 5 messages per second, so about 1500 (with a standard deviation of about
+     40) in the dump */
+  config_init(&cfg);
+  cfg.update_rate = 5;
+  CHECK("Poisson arrivals",
+        (gen = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_updates(gen, UPDATES_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          read_dump(gen, "upd-file", UPDATES_FILE, &cnts) == 0 &&
+          cnts.records > 1300 && cnts.records < 1700 &&
+          cnts.time_min >= DUMP_TIME &&
+          cnts.time_max < DUMP_TIME + DUMP_DURATION);
+  mrtgen_destroy(gen);
+
+  remove(UPDATES_FILE);
+  return 0;
+}
+
+static int test_path_lens()
+{
+  mrtgen_config_t cfg;
+  mrtgen_t *gen;
+  dump_cnts_t cnts;
+
+  config_init(&cfg);
+  cfg.path_len_min = 3;
+  cfg.path_len_max = 3;
+  CHECK("fixed path length",
+        (gen = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_rib(gen, RIB_FILE, DUMP_TIME) == 0 &&
+          read_dump(gen, "rib-file", RIB_FILE, &cnts) == 0 &&
+          cnts.path_len_min == 3 && cnts.path_len_max == 3);
+  mrtgen_destroy(gen);
+
+  /* the internet distribution has no paths this long */
+  cfg.path_dist = MRTGEN_PATH_DIST_INTERNET;
+  cfg.path_len_min = 20;
+  cfg.path_len_max = 30;
+  CHECK("empty distribution", mrtgen_create(&cfg) == NULL);
+
+  cfg.path_len_min = 1;
+  cfg.path_len_max = 20;
+  CHECK("internet distribution",
+        (gen = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_rib(gen, RIB_FILE, DUMP_TIME) == 0 &&
+          read_dump(gen, "rib-file", RIB_FILE, &cnts) == 0 &&
+          cnts.path_len_min >= 1 && cnts.path_len_max <= 14);
+  mrtgen_destroy(gen);
+
+  remove(RIB_FILE);
+  return 0;
+}
+
+static int test_seeds()
+{
+  mrtgen_config_t cfg;
+  mrtgen_t *gen;
+  mrtgen_t *gen2;
+
+  config_init(&cfg);
+  CHECK("create generators", (gen = mrtgen_create(&cfg)) != NULL &&
+                               (gen2 = mrtgen_create(&cfg)) != NULL);
+  CHECK("same RIB dump",
+        mrtgen_write_rib(gen, RIB_FILE, DUMP_TIME) == 0 &&
+          mrtgen_write_rib(gen2, OTHER_FILE, DUMP_TIME) == 0 &&
+          same_contents(RIB_FILE, OTHER_FILE));
+  CHECK("same updates dump",
+        mrtgen_write_updates(gen, UPDATES_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          mrtgen_write_updates(gen2, OTHER_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          same_contents(UPDATES_FILE, OTHER_FILE));
+
+  /* consecutive dumps continue the random sequence */
+  CHECK("next updates dump",
+        mrtgen_write_updates(gen2, OTHER_FILE, DUMP_TIME, DUMP_DURATION) ==
+            0 &&
+          !same_contents(UPDATES_FILE, OTHER_FILE));
+  mrtgen_destroy(gen2);
+
+  cfg.seed++;
+  CHECK("other seed",
+        (gen2 = mrtgen_create(&cfg)) != NULL &&
+          mrtgen_write_rib(gen2, OTHER_FILE, DUMP_TIME) == 0 &&
+          !same_contents(RIB_FILE, OTHER_FILE));
+
+  mrtgen_destroy(gen);
+  mrtgen_destroy(gen2);
+  remove(RIB_FILE);
+  remove(UPDATES_FILE);
+  remove(OTHER_FILE);
+  return 0;
+}
+
+static int test_config()
+{
+  mrtgen_config_t cfg;
+
+  config_init(&cfg);
+  cfg.peer_cnt = 0;
+  CHECK("no peers", mrtgen_create(&cfg) == NULL);
+
+  config_init(&cfg);
+  cfg.v4_pfx_cnt = 0;
+  cfg.v6_pfx_cnt = 0;
+  CHECK("no prefixes", mrtgen_create(&cfg) == NULL);
+
+  config_init(&cfg);
+  cfg.path_len_max = cfg.path_len_min - 1;
+  CHECK("inverted path lengths", mrtgen_create(&cfg) == NULL);
+
+  config_init(&cfg);
+  cfg.withdraw_pct = 101;
+  CHECK("withdrawal share", mrtgen_create(&cfg) == NULL);
+
+  config_init(&cfg);
+  cfg.update_pfx_max = 0;
+  CHECK("empty messages", mrtgen_create(&cfg) == NULL);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("RIB dumps", test_rib() == 0);
+  CHECK_SECTION("updates dumps", test_updates() == 0);
+  CHECK_SECTION("path lengths", test_path_lens() == 0);
+  CHECK_SECTION("seeds", test_seeds() == 0);
+  CHECK_SECTION("configuration", test_config() == 0);
+
+  return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpdump_pbzip2.h"
+#include "bgpstream_test.h"
+
+#include <bzlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PBZIP2_FILE "bgpstream-test-pbzip2.bz2"
+
+/* more threads than the sandboxes that run the tests usually have CPUs */
+#define THREADS 4
+
+/* enough data for more blocks than fit in the ring at once (at the smallest
+   block size) */
+#define DATA_LEN (3 * 1000 * 1000)
+
+/* a real dump */
+#define UPDATES_FILE "routeviews.route-views.jinx.updates.1427846400.bz2"
+
+#define DUMP_LEN_MAX (64 * 1024 * 1024)
+
+static char *data;
+static char *out;
+
+/* sizes of the reads that are made, in turn, to check reads that span
+   blocks */
+static const int64_t read_lens[] = {1, 7, 4096, 100003, 1 << 20};
+#define READ_LENS_CNT (sizeof(read_lens) / sizeof(read_lens[0]))
+
+/* fill the data buffer with text that compresses, but not too well */
+static void make_data()
+{
+  uint32_t x = 42;
+  size_t len = 0;
+
+  while (len < DATA_LEN) {
+    x = x * 1103515245 + 12345;
+    len += snprintf(data + len, DATA_LEN + 1 - len, "%u|%08x|%u\n",
+                    (x >> 8) % 1000, x, x % 65536);
+  }
+}
+
+/* compress the given number of bytes of data into a file, as several
+   concatenated streams (like pbzip2 writes) if streams > 1. Returns the size
+   of the file, or -1 on error */
+static int write_bz2(size_t len, int streams, int block_size)
+{
+  FILE *fh;
+  char *buf;
+  unsigned int buf_len;
+  size_t stream_len = len / streams;
+  size_t off = 0;
+  size_t total = 0;
+  int i;
+
+  if ((fh = fopen(PBZIP2_FILE, "w")) == NULL) {
+    return -1;
+  }
+  buf = malloc(len + len / 100 + 600);
+  for (i = 0; i < streams && buf != NULL; i++) {
+    if (i == streams - 1) {
+      stream_len = len - off;
+    }
+    buf_len = len + len / 100 + 600;
+    if (BZ2_bzBuffToBuffCompress(buf, &buf_len, data + off, stream_len,
+                                 block_size, 0, 0) != BZ_OK ||
+        fwrite(buf, 1, buf_len, fh) != buf_len) {
+      break;
+    }
+    off += stream_len;
+    total += buf_len;
+  }
+  free(buf);
+  fclose(fh);
+  return i == streams ? (int)total : -1;
+}
+
+/* cut the file to the given length, or flip a byte at the given offset */
+static int damage_file(long truncate_len, long flip_off)
+{
+  FILE *fh;
+  char *buf;
+  long len;
+  int rc = -1;
+
+  if ((fh = fopen(PBZIP2_FILE, "r")) == NULL) {
+    return -1;
+  }
+  fseek(fh, 0, SEEK_END);
+  len = ftell(fh);
+  rewind(fh);
+  if ((buf = malloc(len)) != NULL && fread(buf, 1, len, fh) == len) {
+    rc = 0;
+  }
+  fclose(fh);
+  if (rc != 0) {
+    free(buf);
+    return -1;
+  }
+  if (flip_off >= 0 && flip_off < len) {
+    buf[flip_off] ^= 0x55;
+  }
+  if (truncate_len >= 0 && truncate_len < len) {
+    len = truncate_len;
+  }
+  rc = -1;
+  if ((fh = fopen(PBZIP2_FILE, "w")) != NULL) {
+    rc = fwrite(buf, 1, len, fh) == len ? 0 : -1;
+    fclose(fh);
+  }
+  free(buf);
+  return rc;
+}
+
+/* read a whole file, returning its length, or -1 if a read fails */
+static int64_t read_all(const char *path, int low_mem, size_t out_len)
+{
+  pbzip2_t *pbz;
+  int64_t len = 0;
+  int64_t want;
+  int64_t rc;
+  int i = 0;
+
+  if ((pbz = pbzip2_open_threads(path, THREADS)) == NULL) {
+    return -1;
+  }
+  pbzip2_set_low_mem(pbz, low_mem);
+  while (len < out_len) {
+    if ((want = read_lens[i++ % READ_LENS_CNT]) > out_len - len) {
+      want = out_len - len;
+    }
+    if ((rc = pbzip2_read(pbz, out + len, want)) <= 0) {
+      len = rc < 0 ? -1 : len;
+      break;
+    }
+    len += rc;
+  }
+  pbzip2_close(pbz);
+  return len;
+}
+
+/* check that the file decompresses to the first len bytes of data */
+static int check_file(size_t len, int low_mem)
+{
+  return read_all(PBZIP2_FILE, low_mem, DATA_LEN + 1) == len &&
+             memcmp(out, data, len) == 0
+           ? 0
+           : -1;
+}
+
+static int test_decompress()
+{
+  CHECK("single stream of small blocks",
+        write_bz2(DATA_LEN, 1, 1) > 0 && check_file(DATA_LEN, 0) == 0);
+  CHECK("single stream of large blocks",
+        write_bz2(DATA_LEN, 1, 9) > 0 && check_file(DATA_LEN, 0) == 0);
+  CHECK("concatenated streams",
+        write_bz2(DATA_LEN, 7, 1) > 0 && check_file(DATA_LEN, 0) == 0);
+  CHECK("low memory mode",
+        write_bz2(DATA_LEN, 3, 1) > 0 && check_file(DATA_LEN, 1) == 0);
+  CHECK("tiny file", write_bz2(10, 1, 9) > 0 && check_file(10, 0) == 0);
+  CHECK("empty file", write_bz2(0, 1, 9) > 0 && check_file(0, 0) == 0);
+  return 0;
+}
+
+static int test_errors()
+{
+  pbzip2_t *pbz;
+  FILE *fh;
+  int len;
+  char c;
+
+  CHECK("truncated file",
+        (len = write_bz2(DATA_LEN, 1, 1)) > 0 &&
+          damage_file(len / 2, -1) == 0 &&
+          read_all(PBZIP2_FILE, 0, DATA_LEN + 1) == -1);
+  CHECK("corrupt block",
+        (len = write_bz2(DATA_LEN, 1, 1)) > 0 &&
+          damage_file(-1, len / 2) == 0 &&
+          read_all(PBZIP2_FILE, 0, DATA_LEN + 1) == -1);
+
+  /* closing a file part of the way through stops its threads */
+  CHECK("close before the end",
+        write_bz2(DATA_LEN, 1, 1) > 0 &&
+          (pbz = pbzip2_open_threads(PBZIP2_FILE, THREADS)) != NULL &&
+          pbzip2_read(pbz, &c, 1) == 1 && c == data[0] &&
+          pbzip2_get_mem_size(pbz) > 0);
+  pbzip2_close(pbz);
+
+  CHECK("write plain file", (fh = fopen(PBZIP2_FILE, "w")) != NULL &&
+                              fwrite(data, 1, 100, fh) == 100 &&
+                              fclose(fh) == 0);
+  CHECK("not a bzip2 file",
+        pbzip2_open_threads(PBZIP2_FILE, THREADS) == NULL);
+  return 0;
+}
+
+static int test_dump()
+{
+  FILE *fh;
+  BZFILE *bz;
+  int bzerr;
+  char *ref;
+  int64_t len;
+  int ref_len = 0;
+  int rc;
+
+  /* decompress the dump using libbz2 directly */
+  CHECK("open dump", (fh = fopen(UPDATES_FILE, "r")) != NULL &&
+                       (bz = BZ2_bzReadOpen(&bzerr, fh, 0, 0, NULL, 0)) !=
+                         NULL);
+  CHECK("allocate buffers", (ref = malloc(DUMP_LEN_MAX)) != NULL &&
+                              (out = realloc(out, DUMP_LEN_MAX)) != NULL);
+  while (bzerr == BZ_OK && ref_len < DUMP_LEN_MAX) {
+    if ((rc = BZ2_bzRead(&bzerr, bz, ref + ref_len, DUMP_LEN_MAX - ref_len)) >
+        0) {
+      ref_len += rc;
+    }
+  }
+  CHECK("read dump", bzerr == BZ_STREAM_END && ref_len > 0);
+  BZ2_bzReadClose(&bzerr, bz);
+  fclose(fh);
+
+  CHECK("decompress dump",
+        (len = read_all(UPDATES_FILE, 0, DUMP_LEN_MAX)) == ref_len &&
+          memcmp(out, ref, len) == 0);
+  free(ref);
+  return 0;
+}
+
+int main()
+{
+  if ((data = malloc(DATA_LEN + 1)) == NULL ||
+      (out = malloc(DATA_LEN + 1)) == NULL) {
+    return -1;
+  }
+  make_data();
+
+  CHECK_SECTION("decompression", test_decompress() == 0);
+  CHECK_SECTION("errors", test_errors() == 0);
+  CHECK_SECTION("real dump", test_dump() == 0);
+
+  free(data);
+  free(out);
+  remove(PBZIP2_FILE);
+  return 0;
+}
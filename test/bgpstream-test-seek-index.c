@@ -0,0 +1,142 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_seek_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DUMP_FILE "bgpstream-test-seek-index.dump"
+#define INDEX_FILE DUMP_FILE ".bsidx"
+
+static int write_dump(size_t len)
+{
+  FILE *fh;
+  size_t i;
+
+  if ((fh = fopen(DUMP_FILE, "w")) == NULL) {
+    return -1;
+  }
+  for (i = 0; i < len; i++) {
+    fputc('x', fh);
+  }
+  fclose(fh);
+  return 0;
+}
+
+static int test_lookup()
+{
+  bgpstream_seek_index_t *idx;
+
+  CHECK("create index", (idx = bgpstream_seek_index_create()) != NULL);
+
+  CHECK("empty index starts at 0", bgpstream_seek_index_lookup(idx, 100) == 0);
+
+  CHECK("add checkpoints", bgpstream_seek_index_add(idx, 100, 1000) == 0 &&
+                             bgpstream_seek_index_add(idx, 200, 2000) == 0 &&
+                             bgpstream_seek_index_add(idx, 200, 3000) == 0 &&
+                             bgpstream_seek_index_add(idx, 300, 4000) == 0);
+
+  CHECK("out of order checkpoints are rejected",
+        bgpstream_seek_index_add(idx, 400, 4000) != 0 &&
+          bgpstream_seek_index_add(idx, 250, 5000) != 0);
+
+  /* a checkpoint is only usable if all records before it are earlier than
+     the time we are looking for */
+  CHECK("lookup before first checkpoint",
+        bgpstream_seek_index_lookup(idx, 50) == 0 &&
+          bgpstream_seek_index_lookup(idx, 100) == 0);
+  CHECK("lookup between checkpoints",
+        bgpstream_seek_index_lookup(idx, 101) == 1000 &&
+          bgpstream_seek_index_lookup(idx, 200) == 1000 &&
+          bgpstream_seek_index_lookup(idx, 201) == 3000);
+  CHECK("lookup after last checkpoint",
+        bgpstream_seek_index_lookup(idx, 1000) == 4000);
+
+  bgpstream_seek_index_destroy(idx);
+  return 0;
+}
+
+static int test_file()
+{
+  bgpstream_seek_index_t *idx;
+  FILE *fh;
+  long len;
+  int i;
+
+  CHECK("create dump", write_dump(8192) == 0);
+
+  idx = bgpstream_seek_index_create();
+  for (i = 1; i <= 4; i++) {
+    bgpstream_seek_index_add(idx, i * 100, i * 1000);
+  }
+  CHECK("write index", bgpstream_seek_index_write(idx, DUMP_FILE) == 0 &&
+                         access(INDEX_FILE, R_OK) == 0);
+  bgpstream_seek_index_destroy(idx);
+
+  CHECK("load index", (idx = bgpstream_seek_index_load(DUMP_FILE)) != NULL);
+  CHECK("loaded index matches",
+        bgpstream_seek_index_lookup(idx, 50) == 0 &&
+          bgpstream_seek_index_lookup(idx, 250) == 2000 &&
+          bgpstream_seek_index_lookup(idx, 1000) == 4000);
+  bgpstream_seek_index_destroy(idx);
+
+  CHECK("remote dumps have no index",
+        bgpstream_seek_index_load("http://example.com/" DUMP_FILE) == NULL);
+
+  /* an index with too few checkpoints for its header */
+  fh = fopen(INDEX_FILE, "r+");
+  fseek(fh, 0, SEEK_END);
+  len = ftell(fh);
+  fclose(fh);
+  CHECK("truncate index", truncate(INDEX_FILE, len - 4) == 0);
+  CHECK("truncated index is ignored",
+        bgpstream_seek_index_load(DUMP_FILE) == NULL);
+
+  /* an index for an older version of the dump */
+  idx = bgpstream_seek_index_create();
+  bgpstream_seek_index_add(idx, 100, 1000);
+  bgpstream_seek_index_write(idx, DUMP_FILE);
+  bgpstream_seek_index_destroy(idx);
+  CHECK("replace dump", write_dump(4096) == 0);
+  CHECK("stale index is ignored",
+        bgpstream_seek_index_load(DUMP_FILE) == NULL);
+
+  bgpstream_seek_index_remove(DUMP_FILE);
+  CHECK("remove index", access(INDEX_FILE, F_OK) != 0);
+
+  unlink(DUMP_FILE);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("seek index lookup", test_lookup() == 0);
+  CHECK_SECTION("seek index file", test_file() == 0);
+
+  return 0;
+}
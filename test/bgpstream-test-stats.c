@@ -0,0 +1,242 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UPDATES_FILE "ris.rrc06.updates.1427846400.gz"
+#define CORRUPTED_FILE "bgpstream-test-stats.corrupted"
+
+/* the first minute of the updates file */
+#define INTERVAL_START 1427846400
+#define INTERVAL_END 1427846459
+
+/* what was read from the stream, for comparison with the statistics */
+typedef struct read_cnts {
+  uint64_t records;
+  uint64_t elems;
+  long last_time;
+} read_cnts_t;
+
+/* set up a stream over the given file, optionally collecting statistics */
+static bgpstream_t *create_stream(const char *file, int stats)
+{
+  bgpstream_t *bs;
+  bgpstream_data_interface_id_t di;
+  bgpstream_data_interface_option_t *option;
+
+  if ((bs = bgpstream_create()) == NULL) {
+    return NULL;
+  }
+  di = bgpstream_get_data_interface_id_by_name(bs, "singlefile");
+  bgpstream_set_data_interface(bs, di);
+  if ((option = bgpstream_get_data_interface_option_by_name(
+         bs, di, "upd-file")) == NULL) {
+    bgpstream_destroy(bs);
+    return NULL;
+  }
+  bgpstream_set_data_interface_option(bs, option, file);
+  if (stats) {
+    bgpstream_enable_stats(bs);
+  }
+  return bs;
+}
+
+/* read every valid record and elem of a started stream */
+static int read_stream(bgpstream_t *bs, read_cnts_t *cnts)
+{
+  bgpstream_record_t *record;
+  int rc;
+
+  memset(cnts, 0, sizeof(*cnts));
+  if ((record = bgpstream_record_create()) == NULL) {
+    return -1;
+  }
+  while ((rc = bgpstream_get_next_record(bs, record)) > 0) {
+    if (record->status != BGPSTREAM_RECORD_STATUS_VALID_RECORD) {
+      continue;
+    }
+    cnts->records++;
+    cnts->last_time = record->attributes.record_time;
+    while (bgpstream_record_get_next_elem(record) != NULL) {
+      cnts->elems++;
+    }
+  }
+  bgpstream_record_destroy(record);
+  return rc;
+}
+
+static int test_disabled()
+{
+  bgpstream_t *bs;
+  bgpstream_stats_t stats;
+  read_cnts_t cnts;
+
+  CHECK("create stream", (bs = create_stream(UPDATES_FILE, 0)) != NULL);
+  CHECK("no stats before start", bgpstream_get_stats(bs, &stats) == -1);
+  CHECK("read stream",
+        bgpstream_start(bs) == 0 && read_stream(bs, &cnts) == 0 &&
+          cnts.records > 0);
+  CHECK("no stats after reading", bgpstream_get_stats(bs, &stats) == -1);
+
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+static int test_counts()
+{
+  bgpstream_t *bs;
+  bgpstream_stats_t stats;
+  read_cnts_t cnts;
+
+  CHECK("create stream", (bs = create_stream(UPDATES_FILE, 1)) != NULL);
+  CHECK("stats before start", bgpstream_get_stats(bs, &stats) == 0 &&
+                                stats.records_parsed == 0 &&
+                                stats.last_record_time == 0);
+  CHECK("read stream",
+        bgpstream_start(bs) == 0 && read_stream(bs, &cnts) == 0 &&
+          cnts.records > 0 && cnts.elems > 0);
+  CHECK("get stats", bgpstream_get_stats(bs, &stats) == 0);
+
+  CHECK("dumps", stats.datasource_queries > 0 && stats.dumps_opened == 1 &&
+                   stats.dumps_failed == 0 && stats.readers_open == 0 &&
+                   stats.inputs_queued == 0);
+  CHECK("records", stats.bytes_read > 0 &&
+                     stats.records_parsed == cnts.records &&
+                     stats.records_filtered == 0 &&
+                     stats.records_corrupted == 0);
+  CHECK("elems",
+        stats.elems_generated == cnts.elems && stats.elems_filtered == 0);
+  CHECK("last record time", stats.last_record_time == (uint64_t)cnts.last_time);
+
+  /* (the other stages may legitimately take no measurable time) */
+  CHECK("stage times", stats.stage_ns[BGPSTREAM_STAGE_READ] > 0 &&
+                         stats.stage_ns[BGPSTREAM_STAGE_PARSE] > 0 &&
+                         stats.stage_ns[BGPSTREAM_STAGE_ELEM] > 0 &&
+                         stats.stage_ns[BGPSTREAM_STAGE_FILTER] > 0);
+
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+static int test_filtered()
+{
+  bgpstream_t *bs;
+  bgpstream_stats_t stats;
+  read_cnts_t all;
+  read_cnts_t cnts;
+
+  CHECK("create stream", (bs = create_stream(UPDATES_FILE, 1)) != NULL);
+  CHECK("read everything", bgpstream_start(bs) == 0 &&
+                             read_stream(bs, &all) == 0 && all.records > 0);
+  bgpstream_destroy(bs);
+
+  CHECK("create stream", (bs = create_stream(UPDATES_FILE, 1)) != NULL);
+  bgpstream_add_interval_filter(bs, INTERVAL_START, INTERVAL_END);
+  bgpstream_add_filter(bs, BGPSTREAM_FILTER_TYPE_ELEM_TYPE, "withdrawals");
+  CHECK("read filtered stream",
+        bgpstream_start(bs) == 0 && read_stream(bs, &cnts) == 0 &&
+          cnts.records > 0 && cnts.records < all.records);
+  CHECK("get stats", bgpstream_get_stats(bs, &stats) == 0);
+
+  /* time-filtered records are parsed, but not returned */
+  CHECK("filtered records",
+        stats.records_filtered > 0 &&
+          stats.records_parsed == cnts.records + stats.records_filtered);
+
+  /* the elems of every returned record are generated, only the withdrawals
+     are returned */
+  CHECK("filtered elems",
+        stats.elems_filtered > 0 &&
+          stats.elems_generated == cnts.elems + stats.elems_filtered);
+
+  bgpstream_destroy(bs);
+  return 0;
+}
+
+static int test_corrupted()
+{
+  bgpstream_t *bs;
+  bgpstream_stats_t stats;
+  read_cnts_t cnts;
+  FILE *f;
+
+  CHECK("write corrupted dump", (f = fopen(CORRUPTED_FILE, "w")) != NULL &&
+                                  fputs("this is not an MRT dump", f) >= 0 &&
+                                  fclose(f) == 0);
+  CHECK("create stream", (bs = create_stream(CORRUPTED_FILE, 1)) != NULL);
+  CHECK("read corrupted dump", bgpstream_start(bs) == 0 &&
+                                 read_stream(bs, &cnts) == 0 &&
+                                 cnts.records == 0);
+  CHECK("corrupted record", bgpstream_get_stats(bs, &stats) == 0 &&
+                              stats.dumps_opened == 1 &&
+                              stats.dumps_failed == 0 &&
+                              stats.records_parsed == 0 &&
+                              stats.records_corrupted == 1 &&
+                              stats.elems_generated == 0);
+
+  bgpstream_destroy(bs);
+  remove(CORRUPTED_FILE);
+  return 0;
+}
+
+static int test_unread_record()
+{
+  bgpstream_record_t *record;
+
+  /* a record that no stream has filled has no elems (and no statistics) */
+  CHECK("create record", (record = bgpstream_record_create()) != NULL);
+  CHECK("no elems", bgpstream_record_get_next_elem(record) == NULL);
+
+  bgpstream_record_destroy(record);
+  return 0;
+}
+
+static int test_names()
+{
+  int stage;
+  int ok = 1;
+
+  for (stage = 0; stage < BGPSTREAM_STAGE_CNT; stage++) {
+    ok &= bgpstream_get_stage_name(stage) != NULL;
+  }
+  CHECK("every stage is named", ok);
+  CHECK("invalid stage", bgpstream_get_stage_name(BGPSTREAM_STAGE_CNT) == NULL);
+  CHECK("read stage name",
+        strcmp(bgpstream_get_stage_name(BGPSTREAM_STAGE_READ), "read") == 0);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("disabled stats", test_disabled() == 0);
+  CHECK_SECTION("stream counters", test_counts() == 0);
+  CHECK_SECTION("filter counters", test_filtered() == 0);
+  CHECK_SECTION("corrupted dumps", test_corrupted() == 0);
+  CHECK_SECTION("unread records", test_unread_record() == 0);
+  CHECK_SECTION("stage names", test_names() == 0);
+
+  return 0;
+}
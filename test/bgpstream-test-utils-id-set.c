@@ -0,0 +1,201 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_utils_id_set.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* IDs are drawn from [0, IDS_MAX), with a few very large ones */
+#define IDS_MAX 512
+#define IDS_CNT 300
+
+/* reference model of a set */
+typedef struct model {
+  uint8_t in[IDS_MAX + 1];
+  int size;
+} model_t;
+
+static uint32_t seed = 1;
+
+static uint32_t rand_id()
+{
+  seed = seed * 1103515245 + 12345;
+  /* map the last slot to a large ID */
+  return ((seed >> 8) % (IDS_MAX + 1)) == IDS_MAX ? UINT32_MAX - 1
+                                                  : (seed >> 8) % IDS_MAX;
+}
+
+static int model_idx(uint32_t id)
+{
+  return id == UINT32_MAX - 1 ? IDS_MAX : (int)id;
+}
+
+/* fill a set (and its model) with random IDs, half of them in bulk */
+static int fill(bgpstream_id_set_t *set, model_t *m, int freeze)
+{
+  uint32_t ids[IDS_CNT / 2];
+  int added = 0;
+  int i, rc;
+
+  memset(m, 0, sizeof(model_t));
+  for (i = 0; i < IDS_CNT / 2; i++) {
+    ids[i] = rand_id();
+    if (m->in[model_idx(ids[i])]++ == 0) {
+      m->size++;
+      added++;
+    }
+  }
+  /* the bulk array includes duplicates */
+  if (bgpstream_id_set_insert_bulk(set, ids, IDS_CNT / 2) != added) {
+    return -1;
+  }
+  for (i = 0; i < IDS_CNT / 2; i++) {
+    ids[i] = rand_id();
+    rc = bgpstream_id_set_insert(set, ids[i]);
+    if (rc != (m->in[model_idx(ids[i])]++ == 0)) {
+      return -1;
+    }
+    m->size += rc;
+  }
+  if (freeze != 0 && bgpstream_id_set_freeze(set) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/* does the set contain exactly the IDs of the model? */
+static int matches(bgpstream_id_set_t *set, model_t *m)
+{
+  uint8_t seen[IDS_MAX + 1];
+  uint32_t *id;
+  int i;
+
+  if (bgpstream_id_set_size(set) != m->size) {
+    return 0;
+  }
+  for (i = 0; i < IDS_MAX; i++) {
+    if (bgpstream_id_set_exists(set, i) != (m->in[i] != 0)) {
+      return 0;
+    }
+  }
+  if (bgpstream_id_set_exists(set, UINT32_MAX - 1) != (m->in[IDS_MAX] != 0)) {
+    return 0;
+  }
+
+  memset(seen, 0, sizeof(seen));
+  bgpstream_id_set_rewind(set);
+  while ((id = bgpstream_id_set_next(set)) != NULL) {
+    if (m->in[model_idx(*id)] == 0 || seen[model_idx(*id)]++ != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int test_insert(int freeze)
+{
+  bgpstream_id_set_t *set;
+  model_t m;
+
+  CHECK("create set", (set = bgpstream_id_set_create()) != NULL);
+  CHECK("insert IDs", fill(set, &m, freeze) == 0);
+  CHECK("set matches inserted IDs", matches(set, &m));
+
+  /* an insert thaws a frozen set */
+  CHECK("insert new ID", bgpstream_id_set_insert(set, IDS_MAX + 1) == 1 &&
+                           bgpstream_id_set_exists(set, IDS_MAX + 1) == 1 &&
+                           bgpstream_id_set_size(set) == m.size + 1);
+
+  bgpstream_id_set_clear(set);
+  memset(&m, 0, sizeof(m));
+  CHECK("clear set", matches(set, &m));
+
+  bgpstream_id_set_destroy(set);
+  return 0;
+}
+
+/* set operations, with each of the sets frozen or not */
+static int test_ops(int freeze1, int freeze2)
+{
+  bgpstream_id_set_t *a, *b, *c;
+  model_t ma, mb, mc, mr;
+  int inter = 0, uni = 0;
+  int i;
+
+  CHECK("create sets", (a = bgpstream_id_set_create()) != NULL &&
+                         (b = bgpstream_id_set_create()) != NULL &&
+                         (c = bgpstream_id_set_create()) != NULL);
+  CHECK("insert IDs", fill(a, &ma, freeze1) == 0 &&
+                        fill(b, &mb, freeze2) == 0 &&
+                        fill(c, &mc, freeze2) == 0);
+
+  for (i = 0; i <= IDS_MAX; i++) {
+    inter += ma.in[i] != 0 && mb.in[i] != 0;
+    uni += ma.in[i] != 0 || mb.in[i] != 0;
+  }
+  CHECK("intersection size",
+        bgpstream_id_set_intersection_size(a, b) == inter &&
+          bgpstream_id_set_intersection_size(b, a) == inter);
+  CHECK("union size", bgpstream_id_set_union_size(a, b) == uni &&
+                        bgpstream_id_set_union_size(b, a) == uni);
+  CHECK("sizes leave sets unchanged", matches(a, &ma) && matches(b, &mb));
+
+  CHECK("intersect", bgpstream_id_set_intersect(a, b) == 0);
+  memset(&mr, 0, sizeof(mr));
+  for (i = 0; i <= IDS_MAX; i++) {
+    mr.in[i] = ma.in[i] != 0 && mb.in[i] != 0;
+    mr.size += mr.in[i];
+  }
+  CHECK("intersection matches", matches(a, &mr) && matches(b, &mb));
+
+  if (freeze1 != 0) {
+    bgpstream_id_set_freeze(a);
+  }
+  CHECK("merge", bgpstream_id_set_merge(a, c) == 0);
+  for (i = 0; i <= IDS_MAX; i++) {
+    if (mr.in[i] == 0 && mc.in[i] != 0) {
+      mr.in[i] = 1;
+      mr.size++;
+    }
+  }
+  CHECK("union matches", matches(a, &mr) && matches(c, &mc));
+
+  bgpstream_id_set_destroy(a);
+  bgpstream_id_set_destroy(b);
+  bgpstream_id_set_destroy(c);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("ID set insert", test_insert(0) == 0);
+  CHECK_SECTION("frozen ID set insert", test_insert(1) == 0);
+  CHECK_SECTION("ID set operations", test_ops(0, 0) == 0);
+  CHECK_SECTION("ID set operations (one frozen)",
+                test_ops(1, 0) == 0 && test_ops(0, 1) == 0);
+  CHECK_SECTION("ID set operations (both frozen)", test_ops(1, 1) == 0);
+
+  return 0;
+}
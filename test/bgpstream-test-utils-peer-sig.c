@@ -0,0 +1,176 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_utils_peer_sig_map.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+/* enough peers to make the concurrent map grow a few times */
+#define PEERS_CNT 5000
+#define THREADS_CNT 8
+
+static const char *collectors[] = {"rrc00", "route-views2"};
+
+/* peer n: 2001:db8::<n> (with only the low 64 bits varying), or 192.0.<n>.1,
+   seen by one of the collectors */
+static void peer_addr(int n, bgpstream_addr_storage_t *addr)
+{
+  memset(addr, 0, sizeof(bgpstream_addr_storage_t));
+  if (n % 2 != 0) {
+    addr->version = BGPSTREAM_ADDR_VERSION_IPV6;
+    addr->ipv6.s6_addr[0] = 0x20;
+    addr->ipv6.s6_addr[1] = 0x01;
+    addr->ipv6.s6_addr[2] = 0x0d;
+    addr->ipv6.s6_addr[3] = 0xb8;
+    addr->ipv6.s6_addr[14] = (n >> 8) & 0xff;
+    addr->ipv6.s6_addr[15] = n & 0xff;
+  } else {
+    addr->version = BGPSTREAM_ADDR_VERSION_IPV4;
+    addr->ipv4.s_addr = htonl(0xc0000001 | ((n & 0xffff) << 8));
+  }
+}
+
+static int test_peer_sig_map()
+{
+  bgpstream_peer_sig_map_t *map;
+  bgpstream_addr_storage_t addr;
+  bgpstream_peer_id_t a, b, c;
+  bgpstream_peer_sig_t *sig;
+
+  CHECK("create map", (map = bgpstream_peer_sig_map_create()) != NULL);
+
+  peer_addr(1, &addr);
+  a = bgpstream_peer_sig_map_get_id(map, "rrc00",
+                                    (bgpstream_ip_addr_t *)&addr, 65000);
+  b = bgpstream_peer_sig_map_get_id(map, "route-views2",
+                                    (bgpstream_ip_addr_t *)&addr, 65000);
+  peer_addr(3, &addr);
+  c = bgpstream_peer_sig_map_get_id(map, "rrc00",
+                                    (bgpstream_ip_addr_t *)&addr, 65000);
+  CHECK("peers get distinct IDs", a != 0 && b != 0 && c != 0 && a != b &&
+                                    a != c && b != c &&
+                                    bgpstream_peer_sig_map_get_size(map) == 3);
+
+  peer_addr(1, &addr);
+  CHECK("same peer gets the same ID",
+        bgpstream_peer_sig_map_get_id(map, "rrc00",
+                                      (bgpstream_ip_addr_t *)&addr,
+                                      65000) == a &&
+          bgpstream_peer_sig_map_get_size(map) == 3);
+
+  sig = bgpstream_peer_sig_map_get_sig(map, b);
+  CHECK("get signature", sig != NULL &&
+                           strcmp(sig->collector_str, "route-views2") == 0 &&
+                           sig->peer_asnumber == 65000 &&
+                           bgpstream_addr_storage_equal(&sig->peer_ip_addr,
+                                                        &addr) != 0);
+
+  bgpstream_peer_sig_map_destroy(map);
+  return 0;
+}
+
+typedef struct worker {
+  bgpstream_peer_sig_cmap_t *map;
+  int offset;
+  bgpstream_peer_id_t ids[PEERS_CNT];
+} worker_t;
+
+/* look up every peer, starting at a different one in each thread */
+static void *worker_run(void *user)
+{
+  worker_t *w = (worker_t *)user;
+  bgpstream_addr_storage_t addr;
+  int i, n;
+
+  for (i = 0; i < PEERS_CNT; i++) {
+    n = (i + w->offset) % PEERS_CNT;
+    peer_addr(n, &addr);
+    w->ids[n] = bgpstream_peer_sig_cmap_get_id(
+      w->map, collectors[n % 4 / 2], (bgpstream_ip_addr_t *)&addr, 65000 + n);
+  }
+  return NULL;
+}
+
+static int test_peer_sig_cmap()
+{
+  bgpstream_peer_sig_cmap_t *map;
+  bgpstream_addr_storage_t addr;
+  bgpstream_peer_sig_t *sig;
+  pthread_t threads[THREADS_CNT];
+  static worker_t workers[THREADS_CNT];
+  int i, n;
+  int ok;
+
+  CHECK("create concurrent map",
+        (map = bgpstream_peer_sig_cmap_create()) != NULL);
+
+  for (i = 0; i < THREADS_CNT; i++) {
+    workers[i].map = map;
+    workers[i].offset = i * PEERS_CNT / THREADS_CNT;
+    pthread_create(&threads[i], NULL, worker_run, &workers[i]);
+  }
+  for (i = 0; i < THREADS_CNT; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  CHECK("every peer is added once",
+        bgpstream_peer_sig_cmap_get_size(map) == PEERS_CNT);
+
+  ok = 1;
+  for (n = 0; n < PEERS_CNT; n++) {
+    ok &= workers[0].ids[n] >= 1 && workers[0].ids[n] <= PEERS_CNT;
+    for (i = 1; i < THREADS_CNT; i++) {
+      ok &= workers[i].ids[n] == workers[0].ids[n];
+    }
+  }
+  CHECK("all threads get the same IDs", ok);
+
+  ok = 1;
+  for (n = 0; n < PEERS_CNT; n++) {
+    peer_addr(n, &addr);
+    sig = bgpstream_peer_sig_cmap_get_sig(map, workers[0].ids[n]);
+    ok &= sig != NULL &&
+          strcmp(sig->collector_str, collectors[n % 4 / 2]) == 0 &&
+          sig->peer_asnumber == 65000 + n &&
+          bgpstream_addr_storage_equal(&sig->peer_ip_addr, &addr) != 0;
+  }
+  CHECK("signatures match their IDs", ok);
+
+  CHECK("unknown IDs have no signature",
+        bgpstream_peer_sig_cmap_get_sig(map, 0) == NULL &&
+          bgpstream_peer_sig_cmap_get_sig(map, PEERS_CNT + 1) == NULL);
+
+  bgpstream_peer_sig_cmap_destroy(map);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("peer signature map", test_peer_sig_map() == 0);
+  CHECK_SECTION("concurrent peer signature map", test_peer_sig_cmap() == 0);
+
+  return 0;
+}
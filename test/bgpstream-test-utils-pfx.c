@@ -181,10 +181,88 @@ int test_prefixes_ipv6()
   return 0;
 }
 
+/* prefixes that differ only in their mask length, or (for IPv6) only in the
+   low 64 bits of their address */
+static const char *set_test_pfxs[] = {
+  "192.0.43.0/24", "192.0.43.0/25", "130.217.0.0/16", "2001:db8::/32",
+  "2001:db8::/48", "2001:db8::1/128", "2001:db8::2/128",
+};
+#define SET_TEST_PFXS_CNT (sizeof(set_test_pfxs) / sizeof(set_test_pfxs[0]))
+#define SET_TEST_PFXS_V4_CNT 3
+
+int test_prefix_sets()
+{
+  bgpstream_pfx_storage_set_t *set;
+  bgpstream_pfx_storage_set_t *set2;
+  bgpstream_pfx_storage_t pfx;
+  int i;
+  int ok;
+
+  CHECK("prefix set create",
+        (set = bgpstream_pfx_storage_set_create()) != NULL);
+
+  ok = 1;
+  for (i = 0; i < SET_TEST_PFXS_CNT; i++) {
+    bgpstream_str2pfx(set_test_pfxs[i], &pfx);
+    ok &= bgpstream_pfx_storage_set_insert(set, &pfx) == 1;
+  }
+  CHECK("prefix set insert", ok);
+
+  ok = 1;
+  for (i = 0; i < SET_TEST_PFXS_CNT; i++) {
+    bgpstream_str2pfx(set_test_pfxs[i], &pfx);
+    ok &= bgpstream_pfx_storage_set_insert(set, &pfx) == 0 &&
+          bgpstream_pfx_storage_set_exists(set, &pfx) == 1;
+  }
+  CHECK("prefix set insert existing", ok);
+
+  CHECK("prefix set size",
+        bgpstream_pfx_storage_set_size(set) == SET_TEST_PFXS_CNT &&
+          bgpstream_pfx_storage_set_version_size(
+            set, BGPSTREAM_ADDR_VERSION_IPV4) == SET_TEST_PFXS_V4_CNT &&
+          bgpstream_pfx_storage_set_version_size(
+            set, BGPSTREAM_ADDR_VERSION_IPV6) ==
+            SET_TEST_PFXS_CNT - SET_TEST_PFXS_V4_CNT);
+
+  bgpstream_str2pfx("192.0.43.0/23", &pfx);
+  ok = bgpstream_pfx_storage_set_exists(set, &pfx) == 0;
+  bgpstream_str2pfx("2001:db8::3/128", &pfx);
+  ok &= bgpstream_pfx_storage_set_exists(set, &pfx) == 0;
+  bgpstream_str2pfx("2001:db9::1/128", &pfx);
+  ok &= bgpstream_pfx_storage_set_exists(set, &pfx) == 0;
+  CHECK("prefix set missing prefixes", ok);
+
+  memset(&pfx, 0, sizeof(pfx));
+  CHECK("prefix set rejects unknown address versions",
+        bgpstream_pfx_storage_set_insert(set, &pfx) == -1 &&
+          bgpstream_pfx_storage_set_size(set) == SET_TEST_PFXS_CNT);
+
+  CHECK("prefix set create second set",
+        (set2 = bgpstream_pfx_storage_set_create()) != NULL);
+  bgpstream_str2pfx("192.0.43.0/24", &pfx);
+  bgpstream_pfx_storage_set_insert(set2, &pfx);
+  bgpstream_str2pfx("2001:db8::3/128", &pfx);
+  bgpstream_pfx_storage_set_insert(set2, &pfx);
+  CHECK("prefix set merge",
+        bgpstream_pfx_storage_set_merge(set, set2) == 0 &&
+          bgpstream_pfx_storage_set_size(set) == SET_TEST_PFXS_CNT + 1 &&
+          bgpstream_pfx_storage_set_exists(set, &pfx) == 1 &&
+          bgpstream_pfx_storage_set_size(set2) == 2);
+
+  bgpstream_pfx_storage_set_clear(set);
+  CHECK("prefix set clear", bgpstream_pfx_storage_set_size(set) == 0 &&
+                              bgpstream_pfx_storage_set_exists(set, &pfx) == 0);
+
+  bgpstream_pfx_storage_set_destroy(set);
+  bgpstream_pfx_storage_set_destroy(set2);
+  return 0;
+}
+
 int main()
 {
   CHECK_SECTION("IPv4 prefixes", test_prefixes_ipv4() == 0);
   CHECK_SECTION("IPv6 prefixes", test_prefixes_ipv6() == 0);
+  CHECK_SECTION("Prefix sets", test_prefix_sets() == 0);
 
   return 0;
 }
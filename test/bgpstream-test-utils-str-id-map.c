@@ -0,0 +1,102 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bgpstream_test.h"
+#include "bgpstream_utils_str_id_map.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BUFFER_LEN 64
+
+static int test_str_id_map()
+{
+  bgpstream_str_id_map_t *map;
+  char buf[BUFFER_LEN];
+  bgpstream_str_id_t a, b;
+
+  CHECK("create map", (map = bgpstream_str_id_map_create()) != NULL);
+  CHECK("empty map", bgpstream_str_id_map_size(map) == 0 &&
+                       bgpstream_str_id_map_get_str(map, 0) == NULL &&
+                       bgpstream_str_id_map_get_str(map, 1) == NULL);
+
+  /* the map must keep its own copy of the string */
+  strcpy(buf, "route-views2");
+  a = bgpstream_str_id_map_get_id(map, buf);
+  strcpy(buf, "rrc00");
+  b = bgpstream_str_id_map_get_id(map, buf);
+  CHECK("IDs are allocated from 1", a == 1 && b == 2 &&
+                                      bgpstream_str_id_map_size(map) == 2);
+
+  CHECK("same string gets the same ID",
+        bgpstream_str_id_map_get_id(map, "route-views2") == a &&
+          bgpstream_str_id_map_get_id(map, "rrc00") == b &&
+          bgpstream_str_id_map_size(map) == 2);
+
+  CHECK("get string",
+        strcmp(bgpstream_str_id_map_get_str(map, a), "route-views2") == 0 &&
+          strcmp(bgpstream_str_id_map_get_str(map, b), "rrc00") == 0 &&
+          bgpstream_str_id_map_get_str(map, 0) == NULL &&
+          bgpstream_str_id_map_get_str(map, 3) == NULL);
+
+  bgpstream_str_id_map_destroy(map);
+  return 0;
+}
+
+static int test_str_id_map_full()
+{
+  bgpstream_str_id_map_t *map;
+  char buf[BUFFER_LEN];
+  int i;
+  int ok = 1;
+
+  CHECK("create map", (map = bgpstream_str_id_map_create()) != NULL);
+
+  for (i = 1; i <= UINT16_MAX; i++) {
+    snprintf(buf, BUFFER_LEN, "collector-%d", i);
+    ok &= bgpstream_str_id_map_get_id(map, buf) == i;
+  }
+  CHECK("allocate every ID",
+        ok && bgpstream_str_id_map_size(map) == UINT16_MAX);
+
+  CHECK("no ID is left for a new string",
+        bgpstream_str_id_map_get_id(map, "one-too-many") == 0 &&
+          bgpstream_str_id_map_size(map) == UINT16_MAX);
+
+  snprintf(buf, BUFFER_LEN, "collector-%d", UINT16_MAX);
+  CHECK("existing strings keep their IDs",
+        bgpstream_str_id_map_get_id(map, "collector-1") == 1 &&
+          bgpstream_str_id_map_get_id(map, buf) == UINT16_MAX &&
+          strcmp(bgpstream_str_id_map_get_str(map, UINT16_MAX), buf) == 0);
+
+  bgpstream_str_id_map_destroy(map);
+  return 0;
+}
+
+int main()
+{
+  CHECK_SECTION("string ID map", test_str_id_map() == 0);
+  CHECK_SECTION("full string ID map", test_str_id_map_full() == 0);
+
+  return 0;
+}
@@ -34,6 +34,7 @@
 #include <unistd.h>
 
 #include "bgpstream.h"
+#include "bgpstream_metrics.h"
 
 #define PROJECT_CMD_CNT 10
 #define TYPE_CMD_CNT 10
@@ -43,6 +44,9 @@
 #define PEERASN_CMD_CNT 1000
 #define WINDOW_CMD_CNT 1024
 #define OPTION_CMD_CNT 1024
+
+/* default number of seconds between metrics reports */
+#define METRICS_INTERVAL_DEFAULT 10
 #define BGPSTREAM_RECORD_OUTPUT_FORMAT                                         \
   "# Record format:\n"                                                         \
   "# <dump-type>|<dump-pos>|<project>|<collector>|<status>|<dump-time>\n"      \
@@ -74,6 +78,7 @@ struct window {
 };
 
 static bgpstream_t *bs;
+static bgpstream_metrics_t *metrics = NULL;
 static bgpstream_data_interface_id_t datasource_id_default = 0;
 static bgpstream_data_interface_id_t datasource_id = 0;
 static bgpstream_data_interface_info_t *datasource_info = NULL;
@@ -165,6 +170,28 @@ static void usage()
     "records)\n"
     "                  allows bgpstream to be used to process data in "
     "real-time\n"
+    "   -C <dir>[,<max-MB>[,<prefetch>]]\n"
+    "                  keep a local copy of downloaded dump files in <dir>,\n"
+    "                  using at most <max-MB> MB (default: unlimited) and\n"
+    "                  downloading up to <prefetch> upcoming files in the\n"
+    "                  background (default: 0)\n"
+    "   -x             use (and create) sidecar indexes to seek into update\n"
+    "                  dumps when an interval starts part-way through them\n"
+    "   -s             print processing statistics to stderr when done\n"
+    "   -M <dest>[,<interval>]\n"
+    "                  report metrics every <interval> seconds (default: %d)\n"
+    "                  to <dest>, which is either a file to write in the\n"
+    "                  Prometheus text format, or udp://<host>:<port> to\n"
+    "                  send them to a statsd server\n"
+    "   -L <interval>  print a summary of how far behind real time the stream\n"
+    "                  is to stderr every <interval> seconds (0 to only print\n"
+    "                  it when done)\n"
+    "   -Q <subsystem>,<max-MB>\n"
+    "                  limit <subsystem> (one of readers, peer_index, elems,\n"
+    "                  filters, wandio_estimate) to <max-MB> MB of memory.\n"
+    "                  readers, peer_index and wandio_estimate slow down to\n"
+    "                  stay under their limit, the others stop with an\n"
+    "                  error*\n"
     "\n"
     "   -e             print info for each element of a valid BGP record "
     "(default)\n"
@@ -175,7 +202,8 @@ static void usage()
     "   -i             print format information before output\n"
     "\n"
     "   -h             print this help menu\n"
-    "* denotes an option that can be given multiple times\n");
+    "* denotes an option that can be given multiple times\n",
+    METRICS_INTERVAL_DEFAULT);
 }
 
 // print / utility functions
@@ -183,6 +211,8 @@ static void usage()
 static void print_bs_record(bgpstream_record_t *bs_record);
 static int print_elem(bgpstream_record_t *bs_record, bgpstream_elem_t *elem);
 static void print_rib_control_message(bgpstream_record_t *bs_record);
+static void print_stats();
+static void print_lag_summary();
 
 int main(int argc, char *argv[])
 {
@@ -221,6 +251,18 @@ int main(int argc, char *argv[])
   char *filterstring = NULL;
   char *intervalstring = NULL;
 
+  char *cache_dir = NULL;
+  uint64_t cache_size = 0;
+  int cache_prefetch = 0;
+  int seek_index = 0;
+  int stats = 0;
+  char *metrics_dest = NULL;
+  int metrics_interval = METRICS_INTERVAL_DEFAULT;
+  int lag_interval = -1;
+  time_t lag_next = 0;
+  uint64_t mem_limits[BGPSTREAM_MEM_CNT] = {0};
+  int mem_sub;
+
   int rib_period = 0;
   int live = 0;
   int output_info = 0;
@@ -251,7 +293,7 @@ int main(int argc, char *argv[])
   }
 
   while (prevoptind = optind,
-         (opt = getopt(argc, argv, "f:I:d:o:p:c:t:w:j:k:y:P:lrmeivh?")) >= 0) {
+         (opt = getopt(argc, argv, "f:I:d:o:p:c:t:w:j:k:y:P:C:M:L:Q:xslrmeivh?")) >= 0) {
     if (optind == prevoptind + 2 && (optarg == NULL || *optarg == '-')) {
       opt = ':';
       --optind;
@@ -360,6 +402,52 @@ int main(int argc, char *argv[])
       interface_options[interface_options_cnt++] = strdup(optarg);
       break;
 
+    case 'C':
+      /* split into dir, size and prefetch count */
+      cache_dir = optarg;
+      if ((endp = strchr(optarg, ',')) != NULL) {
+        *endp = '\0';
+        endp++;
+        cache_size = strtoull(endp, NULL, 10) * 1024 * 1024;
+        if ((endp = strchr(endp, ',')) != NULL) {
+          cache_prefetch = atoi(endp + 1);
+        }
+      }
+      break;
+    case 'x':
+      seek_index = 1;
+      break;
+    case 's':
+      stats = 1;
+      break;
+    case 'M':
+      metrics_dest = optarg;
+      if ((endp = strchr(optarg, ',')) != NULL) {
+        *endp = '\0';
+        metrics_interval = atoi(endp + 1);
+      }
+      break;
+    case 'L':
+      if ((lag_interval = atoi(optarg)) < 0) {
+        fprintf(stderr, "ERROR: Invalid lag summary interval (%s)\n", optarg);
+        usage();
+        exit(-1);
+      }
+      break;
+    case 'Q':
+      if ((endp = strchr(optarg, ',')) == NULL) {
+        fprintf(stderr, "ERROR: Invalid memory limit (%s)\n", optarg);
+        usage();
+        exit(-1);
+      }
+      *endp = '\0';
+      if ((mem_sub = bgpstream_get_mem_subsystem_by_name(optarg)) < 0) {
+        fprintf(stderr, "ERROR: Invalid memory subsystem (%s)\n", optarg);
+        usage();
+        exit(-1);
+      }
+      mem_limits[mem_sub] = strtoull(endp + 1, NULL, 10) * 1024 * 1024;
+      break;
     case 'l':
       live = 1;
       break;
@@ -517,12 +605,52 @@ int main(int argc, char *argv[])
     bgpstream_set_live_mode(bs);
   }
 
+  /* download cache */
+  if (cache_dir != NULL &&
+      bgpstream_set_download_cache(bs, cache_dir, cache_size,
+                                   cache_prefetch) != 0) {
+    fprintf(stderr, "ERROR: Could not enable download cache in %s\n",
+            cache_dir);
+    goto err;
+  }
+
+  if (seek_index != 0) {
+    bgpstream_enable_seek_index(bs);
+  }
+
+  if (stats != 0) {
+    bgpstream_enable_stats(bs);
+  }
+
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    if (mem_limits[i] != 0) {
+      bgpstream_set_mem_limit(bs, i, mem_limits[i]);
+    }
+  }
+
+  if (lag_interval >= 0) {
+    bgpstream_enable_lag_tracking(bs);
+    lag_next = time(NULL) + lag_interval;
+  }
+
+  if (metrics_dest != NULL &&
+      (metrics = bgpstream_metrics_create(bs, metrics_dest, "bgpreader",
+                                          metrics_interval)) == NULL) {
+    fprintf(stderr, "ERROR: Could not enable metrics reporting to %s\n",
+            metrics_dest);
+    goto err;
+  }
+
   /* turn on interface */
   if (bgpstream_start(bs) < 0) {
     fprintf(stderr, "ERROR: Could not init BGPStream\n");
     return -1;
   }
 
+  if (metrics != NULL && bgpstream_metrics_start(metrics) != 0) {
+    goto err;
+  }
+
   if (output_info) {
     if (record_output_on) {
       printf(BGPSTREAM_RECORD_OUTPUT_FORMAT);
@@ -537,6 +665,10 @@ int main(int argc, char *argv[])
   bgpstream_elem_t *bs_elem;
   do {
     get_next_ret = bgpstream_get_next_record(bs, bs_record);
+    if (lag_interval > 0 && time(NULL) >= lag_next) {
+      print_lag_summary();
+      lag_next = time(NULL) + lag_interval;
+    }
     if (get_next_ret && record_output_on) {
       print_bs_record(bs_record);
     }
@@ -569,9 +701,20 @@ int main(int argc, char *argv[])
     }
   } while (get_next_ret > 0);
 
+  if (stats != 0) {
+    print_stats();
+  }
+
+  if (lag_interval >= 0) {
+    print_lag_summary();
+  }
+
   /* de-allocate memory for bs_record */
   bgpstream_record_destroy(bs_record);
 
+  /* write a final report */
+  bgpstream_metrics_destroy(metrics);
+
   /* turn off interface */
   bgpstream_stop(bs);
 
@@ -581,6 +724,7 @@ int main(int argc, char *argv[])
   return 0;
 
 err:
+  bgpstream_metrics_destroy(metrics);
   bgpstream_record_destroy(bs_record);
   bgpstream_stop(bs);
   bgpstream_destroy(bs);
@@ -589,6 +733,70 @@ err:
 
 /* print utility functions */
 
+static void print_stats()
+{
+  bgpstream_stats_t st;
+  bgpstream_mem_usage_t mem;
+  int i;
+
+  if (bgpstream_get_stats(bs, &st) != 0) {
+    return;
+  }
+
+  fprintf(stderr, "# stage times (seconds)\n");
+  for (i = 0; i < BGPSTREAM_STAGE_CNT; i++) {
+    fprintf(stderr, "%-20s%.6f\n", bgpstream_get_stage_name(i),
+            st.stage_ns[i] / 1e9);
+  }
+  fprintf(stderr, "# counters\n");
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "datasource_queries",
+          st.datasource_queries);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "dumps_opened", st.dumps_opened);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "dumps_failed", st.dumps_failed);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "dump_open_retries",
+          st.dump_open_retries);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "bytes_read", st.bytes_read);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "records_parsed", st.records_parsed);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "records_filtered",
+          st.records_filtered);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "records_corrupted",
+          st.records_corrupted);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "elems_generated",
+          st.elems_generated);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "elems_filtered", st.elems_filtered);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "readers_open", st.readers_open);
+  fprintf(stderr, "%-20s%" PRIu64 "\n", "inputs_queued", st.inputs_queued);
+
+  if (bgpstream_get_mem_usage(bs, &mem) != 0) {
+    return;
+  }
+  fprintf(stderr, "# memory (bytes)\n");
+  fprintf(stderr, "%-20s%16s%16s\n", "subsystem", "current", "peak");
+  for (i = 0; i < BGPSTREAM_MEM_CNT; i++) {
+    fprintf(stderr, "%-20s%16" PRIu64 "%16" PRIu64 "\n",
+            bgpstream_get_mem_subsystem_name(i), mem.bytes[i],
+            mem.peak_bytes[i]);
+  }
+}
+
+static void print_lag_summary()
+{
+  bgpstream_lag_summary_t sum;
+  int i;
+
+  fprintf(stderr, "# lag (seconds) at %ld\n", (long)time(NULL));
+  fprintf(stderr, "%-12s%12s%12s%12s%12s%12s%12s\n", "lag", "count", "min",
+          "p50", "p90", "p99", "max");
+  for (i = 0; i < BGPSTREAM_LAG_CNT; i++) {
+    if (bgpstream_get_lag_summary(bs, i, &sum) != 0) {
+      return;
+    }
+    fprintf(stderr, "%-12s%12" PRIu64 "%12.3f%12.3f%12.3f%12.3f%12.3f\n",
+            bgpstream_get_lag_name(i), sum.count, sum.min / 1e3,
+            sum.p50 / 1e3, sum.p90 / 1e3, sum.p99 / 1e3, sum.max / 1e3);
+  }
+}
+
 static char record_buf[65536];
 
 static void print_bs_record(bgpstream_record_t *bs_record)
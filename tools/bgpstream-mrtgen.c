@@ -0,0 +1,294 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mrtgen.h"
+
+#define NAME "bgpstream-mrtgen"
+
+#define BUFFER_LEN 4096
+
+#define DEFAULT_PROJECT "synthetic"
+#define DEFAULT_COLLECTOR "mrtgen"
+#define DEFAULT_START 1427846400
+#define DEFAULT_LENGTH 3600
+#define DEFAULT_RIB_PERIOD 7200
+#define DEFAULT_UPDATE_PERIOD 900
+#define DEFAULT_COMPRESSION "gz"
+
+/* time span recorded in the csv index for each RIB dump */
+#define RIB_TIMESPAN 120
+
+static void usage()
+{
+  mrtgen_config_t cfg;
+  mrtgen_config_init(&cfg);
+
+  fprintf(
+    stderr,
+    "usage: " NAME " -o <dir> [<options>]\n"
+    "Writes synthetic TABLE_DUMP_V2 RIB and BGP4MP update dumps to <dir>,\n"
+    "along with a <project>.<collector>.csv index for the csvfile data "
+    "interface\n"
+    "Available options are:\n"
+    "   -o <dir>       directory to write the dumps to (required)\n"
+    "   -w <start>[,<end>]\n"
+    "                  time window to generate dumps for (default: %d,%d)\n"
+    "   -p <project>   project name used in the file names (default: %s)\n"
+    "   -c <collector> collector name used in the file names (default: %s)\n"
+    "   -R <period>    write a RIB dump every <period> seconds, 0 to disable\n"
+    "                  (default: %d)\n"
+    "   -U <period>    write an updates dump every <period> seconds, 0 to\n"
+    "                  disable (default: %d)\n"
+    "   -z <type>      compression to use (none, gz, bz2) (default: %s)\n"
+    "\n"
+    "   -P <peers>     number of peers (default: %d)\n"
+    "   -4 <count>     number of IPv4 prefixes (default: %d)\n"
+    "   -6 <count>     number of IPv6 prefixes (default: %d)\n"
+    "   -l <min>[,<max>]\n"
+    "                  range of AS path lengths (default: %d,%d)\n"
+    "   -L <dist>      distribution of AS path lengths (uniform, internet)\n"
+    "                  (default: internet)\n"
+    "   -C <count>     maximum number of communities per route (default: %d)\n"
+    "   -r <rate>      mean number of update messages per second, with\n"
+    "                  Poisson arrivals (default: use -n)\n"
+    "   -n <count>     number of messages in each updates dump, spread\n"
+    "                  evenly (default: %d)\n"
+    "   -x <count>     maximum number of prefixes per update message\n"
+    "                  (default: %d)\n"
+    "   -W <percent>   percentage of update messages that are withdrawals\n"
+    "                  (default: %d)\n"
+    "   -S <seed>      seed for the random number generator (default: %d)\n"
+    "   -h             print this help menu\n",
+    DEFAULT_START, DEFAULT_START + DEFAULT_LENGTH, DEFAULT_PROJECT,
+    DEFAULT_COLLECTOR, DEFAULT_RIB_PERIOD, DEFAULT_UPDATE_PERIOD,
+    DEFAULT_COMPRESSION, cfg.peer_cnt, cfg.v4_pfx_cnt, cfg.v6_pfx_cnt,
+    cfg.path_len_min, cfg.path_len_max, cfg.community_max, cfg.update_cnt,
+    cfg.update_pfx_max, cfg.withdraw_pct, (int)cfg.seed);
+}
+
+/* build the name of a dump file, and add it to the csv index */
+static int dump_path(char *buf, const char *dir, const char *project,
+                     const char *collector, const char *type, uint32_t time,
+                     uint32_t timespan, const char *compression, FILE *index)
+{
+  int len;
+
+  if (strcmp(compression, "none") == 0) {
+    len = snprintf(buf, BUFFER_LEN, "%s/%s.%s.%s.%" PRIu32, dir, project,
+                   collector, type, time);
+  } else {
+    len = snprintf(buf, BUFFER_LEN, "%s/%s.%s.%s.%" PRIu32 ".%s", dir,
+                   project, collector, type, time, compression);
+  }
+  if (len >= BUFFER_LEN) {
+    fprintf(stderr, "ERROR: Output path is too long\n");
+    return -1;
+  }
+
+  /* path,project,type,collector,filetime,timespan,timestamp */
+  fprintf(index, "%s,%s,%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", buf,
+          project, type, collector, time, timespan, time + timespan);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  char *endp;
+  const char *dir = NULL;
+  const char *project = DEFAULT_PROJECT;
+  const char *collector = DEFAULT_COLLECTOR;
+  const char *compression = DEFAULT_COMPRESSION;
+  uint32_t start = DEFAULT_START;
+  uint32_t end = DEFAULT_START + DEFAULT_LENGTH;
+  uint32_t rib_period = DEFAULT_RIB_PERIOD;
+  uint32_t update_period = DEFAULT_UPDATE_PERIOD;
+  mrtgen_config_t cfg;
+  mrtgen_t *gen = NULL;
+  FILE *index = NULL;
+  char path[BUFFER_LEN];
+  uint32_t time;
+  int rib_cnt = 0, update_cnt = 0;
+  int rc = -1;
+
+  mrtgen_config_init(&cfg);
+  cfg.path_dist = MRTGEN_PATH_DIST_INTERNET;
+
+  while ((opt = getopt(argc, argv, "o:w:p:c:R:U:z:P:4:6:l:L:C:r:n:x:W:S:h?")) >=
+         0) {
+    switch (opt) {
+    case 'o':
+      dir = optarg;
+      break;
+    case 'w':
+      if ((endp = strchr(optarg, ',')) != NULL) {
+        *endp = '\0';
+        end = strtoul(endp + 1, NULL, 10);
+      }
+      start = strtoul(optarg, NULL, 10);
+      if (endp == NULL) {
+        end = start + DEFAULT_LENGTH;
+      }
+      break;
+    case 'p':
+      project = optarg;
+      break;
+    case 'c':
+      collector = optarg;
+      break;
+    case 'R':
+      rib_period = strtoul(optarg, NULL, 10);
+      break;
+    case 'U':
+      update_period = strtoul(optarg, NULL, 10);
+      break;
+    case 'z':
+      compression = optarg;
+      break;
+    case 'P':
+      cfg.peer_cnt = atoi(optarg);
+      break;
+    case '4':
+      cfg.v4_pfx_cnt = atoi(optarg);
+      break;
+    case '6':
+      cfg.v6_pfx_cnt = atoi(optarg);
+      break;
+    case 'l':
+      if ((endp = strchr(optarg, ',')) != NULL) {
+        *endp = '\0';
+        cfg.path_len_max = atoi(endp + 1);
+      }
+      cfg.path_len_min = atoi(optarg);
+      break;
+    case 'L':
+      if (strcmp(optarg, "uniform") == 0) {
+        cfg.path_dist = MRTGEN_PATH_DIST_UNIFORM;
+      } else if (strcmp(optarg, "internet") == 0) {
+        cfg.path_dist = MRTGEN_PATH_DIST_INTERNET;
+      } else {
+        fprintf(stderr, "ERROR: Unknown path length distribution '%s'\n",
+                optarg);
+        usage();
+        return -1;
+      }
+      break;
+    case 'C':
+      cfg.community_max = atoi(optarg);
+      break;
+    case 'r':
+      cfg.update_rate = strtod(optarg, NULL);
+      break;
+    case 'n':
+      cfg.update_cnt = atoi(optarg);
+      break;
+    case 'x':
+      cfg.update_pfx_max = atoi(optarg);
+      break;
+    case 'W':
+      cfg.withdraw_pct = atoi(optarg);
+      break;
+    case 'S':
+      cfg.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'h':
+    case '?':
+    default:
+      usage();
+      return -1;
+    }
+  }
+
+  if (dir == NULL) {
+    fprintf(stderr, "ERROR: An output directory must be given using -o\n");
+    usage();
+    return -1;
+  }
+  if (end <= start) {
+    fprintf(stderr, "ERROR: Invalid time window %" PRIu32 ",%" PRIu32 "\n",
+            start, end);
+    return -1;
+  }
+  if (strcmp(compression, "none") != 0 && strcmp(compression, "gz") != 0 &&
+      strcmp(compression, "bz2") != 0) {
+    fprintf(stderr, "ERROR: Unknown compression type '%s'\n", compression);
+    usage();
+    return -1;
+  }
+
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "ERROR: Could not create directory %s\n", dir);
+    return -1;
+  }
+
+  if ((gen = mrtgen_create(&cfg)) == NULL) {
+    goto done;
+  }
+
+  snprintf(path, BUFFER_LEN, "%s/%s.%s.csv", dir, project, collector);
+  if ((index = fopen(path, "w")) == NULL) {
+    fprintf(stderr, "ERROR: Could not open %s for writing\n", path);
+    goto done;
+  }
+
+  for (time = start; time < end; time++) {
+    if (rib_period != 0 && (time - start) % rib_period == 0) {
+      if (dump_path(path, dir, project, collector, "ribs", time, RIB_TIMESPAN,
+                    compression, index) != 0 ||
+          mrtgen_write_rib(gen, path, time) != 0) {
+        goto done;
+      }
+      rib_cnt++;
+    }
+    if (update_period != 0 && (time - start) % update_period == 0) {
+      if (dump_path(path, dir, project, collector, "updates", time,
+                    update_period, compression, index) != 0 ||
+          mrtgen_write_updates(gen, path, time, update_period) != 0) {
+        goto done;
+      }
+      update_cnt++;
+    }
+  }
+
+  fprintf(stderr, "INFO: Wrote %d RIB and %d updates dumps to %s\n", rib_cnt,
+          update_cnt, dir);
+  rc = 0;
+
+done:
+  if (index != NULL) {
+    fclose(index);
+  }
+  mrtgen_destroy(gen);
+  return rc;
+}
@@ -0,0 +1,874 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wandio.h>
+
+#include "bgpdump_formats.h"
+#include "utils.h"
+
+#include "mrtgen.h"
+
+/* number of ASNs that may appear in the middle of a path */
+#define TRANSIT_CNT 256
+
+/* AS number and addresses of the (fictional) collector */
+#define COLLECTOR_ASN 65000
+#define COLLECTOR_BGP_ID 0xC0000201 /* 192.0.2.1 */
+
+/* compression level used for compressed dumps */
+#define WANDIO_LEVEL 6
+
+/* the BGP UPDATE message type */
+#define BGP_MSG_UPDATE 2
+
+/* BGP path attribute flags and types */
+#define ATTR_FLAG_OPTIONAL 0x80
+#define ATTR_FLAG_TRANSITIVE 0x40
+#define ATTR_FLAG_EXT_LEN 0x10
+
+#define ATTR_ORIGIN 1
+#define ATTR_AS_PATH 2
+#define ATTR_NEXT_HOP 3
+#define ATTR_COMMUNITIES 8
+#define ATTR_MP_REACH 14
+#define ATTR_MP_UNREACH 15
+
+#define AS_SEQUENCE 2
+
+/* TABLE_DUMP_V2 peer types */
+#define PEER_TYPE_IPV6 0x01
+#define PEER_TYPE_AS4 0x02
+
+#define AFI_IPV4 1
+#define AFI_IPV6 2
+#define SAFI_UNICAST 1
+
+/* length of the common MRT header */
+#define MRT_HDR_LEN 12
+
+/* the BGP message header is a 16 byte marker, a length and a type */
+#define BGP_MARKER_LEN 16
+#define BGP_HDR_LEN 19
+
+/* keep update messages well inside the 4096 byte BGP limit */
+#define UPDATE_PFX_MAX 128
+
+/* keep the COMMUNITIES attribute well inside the 16 bit length limit */
+#define COMMUNITY_MAX 1024
+
+/* number of alternative paths that updates choose between */
+#define ALT_PATH_CNT 4
+
+/* longest path that fits in a single AS_SEQUENCE segment */
+#define PATH_LEN_MAX 255
+
+/* relative frequency (per mille) of AS path lengths 1, 2, ... in the global
+   routing table; longer paths are not generated by this distribution */
+static const int internet_path_lens[] = {
+  20, 120, 260, 270, 170, 80, 40, 20, 10, 5, 2, 1, 1, 1,
+};
+
+#define INTERNET_PATH_LEN_CNT                                                  \
+  (sizeof(internet_path_lens) / sizeof(internet_path_lens[0]))
+
+typedef struct peer {
+  uint32_t asn;
+  uint32_t bgp_id;
+  bgpstream_addr_storage_t ip;
+} peer_t;
+
+struct mrtgen {
+
+  /* copy of the user's configuration */
+  mrtgen_config_t cfg;
+
+  /* state of the (xorshift64*) random number generator */
+  uint64_t rng;
+
+  /* peers that contribute to the table */
+  peer_t *peers;
+
+  /* prefixes in the table (v4 then v6), and the ASN that originates each */
+  bgpstream_pfx_storage_t *pfxs;
+  uint32_t *origins;
+  int pfx_cnt;
+
+  /* ASNs that appear in the middle of paths */
+  uint32_t transits[TRANSIT_CNT];
+
+  /* cumulative weights of path lengths, indexed by length */
+  uint32_t path_len_cum[PATH_LEN_MAX + 1];
+
+  /* buffer that each MRT record is built in before being written */
+  uint8_t *buf;
+  size_t buf_len;
+  size_t buf_alloc;
+};
+
+/* ========== RANDOM NUMBERS ========== */
+
+static uint64_t rng_next(uint64_t *state)
+{
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t rng_seed(uint64_t seed)
+{
+  /* xorshift must not be seeded with zero */
+  seed = (seed ^ (seed >> 33)) * 0xff51afd7ed558ccdULL;
+  seed ^= seed >> 33;
+  return seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+/* random number in [0, n) */
+static uint32_t rng_below(uint64_t *state, uint32_t n)
+{
+  return (uint32_t)((rng_next(state) >> 32) % n);
+}
+
+/* random number in (0, 1] */
+static double rng_unit(uint64_t *state)
+{
+  return ((rng_next(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/* ========== OUTPUT BUFFER ========== */
+
+static int buf_reserve(mrtgen_t *gen, size_t len)
+{
+  uint8_t *tmp;
+  size_t alloc = gen->buf_alloc == 0 ? 4096 : gen->buf_alloc;
+
+  if (gen->buf_len + len <= gen->buf_alloc) {
+    return 0;
+  }
+  while (alloc < gen->buf_len + len) {
+    alloc *= 2;
+  }
+  if ((tmp = realloc(gen->buf, alloc)) == NULL) {
+    return -1;
+  }
+  gen->buf = tmp;
+  gen->buf_alloc = alloc;
+  return 0;
+}
+
+static int put_bytes(mrtgen_t *gen, const void *data, size_t len)
+{
+  if (buf_reserve(gen, len) != 0) {
+    return -1;
+  }
+  memcpy(gen->buf + gen->buf_len, data, len);
+  gen->buf_len += len;
+  return 0;
+}
+
+static int put_u8(mrtgen_t *gen, uint8_t val)
+{
+  return put_bytes(gen, &val, 1);
+}
+
+static int put_u16(mrtgen_t *gen, uint16_t val)
+{
+  val = htons(val);
+  return put_bytes(gen, &val, 2);
+}
+
+static int put_u32(mrtgen_t *gen, uint32_t val)
+{
+  val = htonl(val);
+  return put_bytes(gen, &val, 4);
+}
+
+static void patch_u16(mrtgen_t *gen, size_t offset, uint16_t val)
+{
+  val = htons(val);
+  memcpy(gen->buf + offset, &val, 2);
+}
+
+static void patch_u32(mrtgen_t *gen, size_t offset, uint32_t val)
+{
+  val = htonl(val);
+  memcpy(gen->buf + offset, &val, 4);
+}
+
+static int put_addr(mrtgen_t *gen, const bgpstream_addr_storage_t *addr)
+{
+  if (addr->version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    return put_bytes(gen, &addr->ipv4, 4);
+  }
+  return put_bytes(gen, &addr->ipv6, 16);
+}
+
+/* prefixes are encoded as a length followed by only the significant bytes */
+static int put_pfx(mrtgen_t *gen, const bgpstream_pfx_storage_t *pfx)
+{
+  if (put_u8(gen, pfx->mask_len) != 0) {
+    return -1;
+  }
+  return put_bytes(gen, &pfx->address.ipv4, (pfx->mask_len + 7) / 8);
+}
+
+/* start a path attribute, returning the offset of its header */
+static int attr_begin(mrtgen_t *gen, uint8_t flags, uint8_t type,
+                      size_t *offset)
+{
+  *offset = gen->buf_len;
+  if (put_u8(gen, flags) != 0 || put_u8(gen, type) != 0 ||
+      put_u8(gen, 0) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/* fill in the length of an attribute, switching to the extended length
+   encoding if the value does not fit in a single byte */
+static int attr_end(mrtgen_t *gen, size_t offset)
+{
+  size_t len = gen->buf_len - offset - 3;
+
+  if (len <= 0xFF) {
+    gen->buf[offset + 2] = (uint8_t)len;
+    return 0;
+  }
+  if (buf_reserve(gen, 1) != 0) {
+    return -1;
+  }
+  memmove(gen->buf + offset + 4, gen->buf + offset + 3, len);
+  gen->buf[offset] |= ATTR_FLAG_EXT_LEN;
+  gen->buf_len++;
+  patch_u16(gen, offset + 2, (uint16_t)len);
+  return 0;
+}
+
+/* start an MRT record, leaving space for the common header */
+static int record_begin(mrtgen_t *gen)
+{
+  gen->buf_len = 0;
+  if (buf_reserve(gen, MRT_HDR_LEN) != 0) {
+    return -1;
+  }
+  gen->buf_len = MRT_HDR_LEN;
+  return 0;
+}
+
+/* fill in the common header and write the record to the file */
+static int record_end(mrtgen_t *gen, iow_t *out, uint32_t time, uint16_t type,
+                      uint16_t subtype)
+{
+  patch_u32(gen, 0, time);
+  patch_u16(gen, 4, type);
+  patch_u16(gen, 6, subtype);
+  patch_u32(gen, 8, (uint32_t)(gen->buf_len - MRT_HDR_LEN));
+
+  if (wandio_wwrite(out, gen->buf, gen->buf_len) != (off_t)gen->buf_len) {
+    fprintf(stderr, "ERROR: Could not write MRT record\n");
+    return -1;
+  }
+  return 0;
+}
+
+/* ========== TABLE GENERATION ========== */
+
+static void make_v4_pfx(mrtgen_t *gen, bgpstream_pfx_storage_t *pfx)
+{
+  uint32_t r = rng_below(&gen->rng, 100);
+  uint32_t addr;
+
+  /* roughly the mask length distribution of a full IPv4 table */
+  if (r < 55) {
+    pfx->mask_len = 24;
+  } else if (r < 65) {
+    pfx->mask_len = 23;
+  } else if (r < 75) {
+    pfx->mask_len = 22;
+  } else if (r < 82) {
+    pfx->mask_len = 21;
+  } else if (r < 88) {
+    pfx->mask_len = 20;
+  } else if (r < 93) {
+    pfx->mask_len = 19;
+  } else {
+    pfx->mask_len = 8 + rng_below(&gen->rng, 11);
+  }
+
+  /* unicast space only */
+  addr = ((1 + rng_below(&gen->rng, 223)) << 24) |
+         (rng_below(&gen->rng, 1 << 24));
+  addr &= 0xFFFFFFFF << (32 - pfx->mask_len);
+
+  pfx->address.version = BGPSTREAM_ADDR_VERSION_IPV4;
+  pfx->address.ipv4.s_addr = htonl(addr);
+}
+
+static void make_v6_pfx(mrtgen_t *gen, bgpstream_pfx_storage_t *pfx)
+{
+  uint32_t r = rng_below(&gen->rng, 100);
+  uint8_t *bytes = pfx->address.ipv6.s6_addr;
+  int i;
+
+  if (r < 50) {
+    pfx->mask_len = 48;
+  } else if (r < 65) {
+    pfx->mask_len = 32;
+  } else if (r < 75) {
+    pfx->mask_len = 44;
+  } else if (r < 85) {
+    pfx->mask_len = 40;
+  } else if (r < 92) {
+    pfx->mask_len = 36;
+  } else {
+    pfx->mask_len = 29 + rng_below(&gen->rng, 19);
+  }
+
+  pfx->address.version = BGPSTREAM_ADDR_VERSION_IPV6;
+  for (i = 0; i < 16; i++) {
+    bytes[i] = (uint8_t)rng_below(&gen->rng, 256);
+  }
+  /* global unicast (2000::/3) */
+  bytes[0] = 0x20 | (bytes[0] & 0x1F);
+
+  /* clear the host bits */
+  for (i = 0; i < 16; i++) {
+    if (i * 8 >= pfx->mask_len) {
+      bytes[i] = 0;
+    } else if ((i + 1) * 8 > pfx->mask_len) {
+      bytes[i] &= 0xFF << ((i + 1) * 8 - pfx->mask_len);
+    }
+  }
+}
+
+static void make_peer(mrtgen_t *gen, int idx, peer_t *peer)
+{
+  peer->asn = 1 + rng_below(&gen->rng, 399999);
+  peer->bgp_id = 0x0A000001 | ((uint32_t)idx << 8);
+
+  if (idx % 4 == 3) {
+    peer->ip.version = BGPSTREAM_ADDR_VERSION_IPV6;
+    inet_pton(AF_INET6, "2001:db8::", &peer->ip.ipv6);
+    peer->ip.ipv6.s6_addr[14] = (uint8_t)(idx >> 8);
+    peer->ip.ipv6.s6_addr[15] = (uint8_t)(idx + 1);
+  } else {
+    peer->ip.version = BGPSTREAM_ADDR_VERSION_IPV4;
+    peer->ip.ipv4.s_addr = htonl(peer->bgp_id);
+  }
+}
+
+/* ========== ROUTES ========== */
+
+static int init_path_lens(mrtgen_t *gen)
+{
+  mrtgen_config_t *cfg = &gen->cfg;
+  uint32_t total = 0;
+  int len;
+
+  for (len = cfg->path_len_min; len <= cfg->path_len_max; len++) {
+    if (cfg->path_dist == MRTGEN_PATH_DIST_UNIFORM) {
+      total++;
+    } else if ((size_t)len <= INTERNET_PATH_LEN_CNT) {
+      total += internet_path_lens[len - 1];
+    }
+    gen->path_len_cum[len] = total;
+  }
+
+  if (total == 0) {
+    fprintf(stderr, "ERROR: No paths of length %d to %d in the distribution\n",
+            cfg->path_len_min, cfg->path_len_max);
+    return -1;
+  }
+  return 0;
+}
+
+static int path_len_sample(mrtgen_t *gen, uint64_t *rng)
+{
+  uint32_t r = rng_below(rng, gen->path_len_cum[gen->cfg.path_len_max]);
+  int len = gen->cfg.path_len_min;
+
+  while (gen->path_len_cum[len] <= r) {
+    len++;
+  }
+  return len;
+}
+
+/* Write the attributes of the route for the given prefixes, as seen by the
+   given peer. The path only depends on the peer, the origin of the first
+   prefix and the salt, so routes for prefixes originated by the same AS share
+   paths, as they do in real tables. IPv6 routes carry a full MP_REACH
+   attribute (with the prefixes as NLRI) if mp_nlri is set, or the abbreviated
+   form used by TABLE_DUMP_V2 otherwise. */
+static int put_route_attrs(mrtgen_t *gen, int peer_idx, int *pfx_idxs,
+                           int pfx_cnt, uint64_t salt, int mp_nlri)
+{
+  mrtgen_config_t *cfg = &gen->cfg;
+  peer_t *peer = &gen->peers[peer_idx];
+  bgpstream_pfx_storage_t *pfx = &gen->pfxs[pfx_idxs[0]];
+  uint32_t origin = gen->origins[pfx_idxs[0]];
+  uint64_t rng;
+  bgpstream_addr_storage_t nh;
+  size_t offset;
+  int path_len, comm_cnt;
+  int i;
+
+  rng = rng_seed(cfg->seed ^ ((uint64_t)peer_idx << 40) ^
+                 ((uint64_t)origin << 8) ^ salt);
+
+  path_len = path_len_sample(gen, &rng);
+  comm_cnt = rng_below(&rng, cfg->community_max + 1);
+
+  /* ORIGIN: IGP */
+  if (attr_begin(gen, ATTR_FLAG_TRANSITIVE, ATTR_ORIGIN, &offset) != 0 ||
+      put_u8(gen, 0) != 0 || attr_end(gen, offset) != 0) {
+    return -1;
+  }
+
+  /* AS_PATH: peer, transit ASes..., origin */
+  if (attr_begin(gen, ATTR_FLAG_TRANSITIVE, ATTR_AS_PATH, &offset) != 0 ||
+      put_u8(gen, AS_SEQUENCE) != 0 || put_u8(gen, path_len) != 0 ||
+      put_u32(gen, peer->asn) != 0) {
+    return -1;
+  }
+  for (i = 1; i < path_len - 1; i++) {
+    if (put_u32(gen, gen->transits[rng_below(&rng, TRANSIT_CNT)]) != 0) {
+      return -1;
+    }
+  }
+  if ((path_len > 1 && put_u32(gen, origin) != 0) ||
+      attr_end(gen, offset) != 0) {
+    return -1;
+  }
+
+  /* the next hop is the peer itself, or a made up address of the right
+     family if the peer does not have one */
+  nh.version = pfx->address.version;
+  if (peer->ip.version == nh.version) {
+    nh = peer->ip;
+  } else if (nh.version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    nh.ipv4.s_addr = htonl(peer->bgp_id);
+  } else {
+    inet_pton(AF_INET6, "2001:db8:ffff::", &nh.ipv6);
+    nh.ipv6.s6_addr[14] = (uint8_t)(peer_idx >> 8);
+    nh.ipv6.s6_addr[15] = (uint8_t)peer_idx;
+  }
+
+  if (nh.version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    if (attr_begin(gen, ATTR_FLAG_TRANSITIVE, ATTR_NEXT_HOP, &offset) != 0 ||
+        put_addr(gen, &nh) != 0 || attr_end(gen, offset) != 0) {
+      return -1;
+    }
+  } else {
+    if (attr_begin(gen, ATTR_FLAG_OPTIONAL, ATTR_MP_REACH, &offset) != 0) {
+      return -1;
+    }
+    if (mp_nlri != 0 && (put_u16(gen, AFI_IPV6) != 0 ||
+                         put_u8(gen, SAFI_UNICAST) != 0)) {
+      return -1;
+    }
+    if (put_u8(gen, 16) != 0 || put_addr(gen, &nh) != 0) {
+      return -1;
+    }
+    if (mp_nlri != 0) {
+      /* no SNPAs */
+      if (put_u8(gen, 0) != 0) {
+        return -1;
+      }
+      for (i = 0; i < pfx_cnt; i++) {
+        if (put_pfx(gen, &gen->pfxs[pfx_idxs[i]]) != 0) {
+          return -1;
+        }
+      }
+    }
+    if (attr_end(gen, offset) != 0) {
+      return -1;
+    }
+  }
+
+  if (comm_cnt > 0) {
+    if (attr_begin(gen, ATTR_FLAG_OPTIONAL | ATTR_FLAG_TRANSITIVE,
+                   ATTR_COMMUNITIES, &offset) != 0) {
+      return -1;
+    }
+    for (i = 0; i < comm_cnt; i++) {
+      uint32_t asn = i == 0 ? peer->asn : gen->transits[rng_below(&rng, 16)];
+      if (put_u32(gen, ((asn & 0xFFFF) << 16) | rng_below(&rng, 1000)) != 0) {
+        return -1;
+      }
+    }
+    if (attr_end(gen, offset) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/* ========== DUMPS ========== */
+
+static iow_t *open_out(const char *path)
+{
+  iow_t *out;
+
+  if ((out = wandio_wcreate(path, wandio_detect_compression_type(path),
+                            WANDIO_LEVEL, O_CREAT)) == NULL) {
+    fprintf(stderr, "ERROR: Could not open %s for writing\n", path);
+  }
+  return out;
+}
+
+static int write_peer_index(mrtgen_t *gen, iow_t *out, uint32_t time)
+{
+  peer_t *peer;
+  int i;
+
+  if (record_begin(gen) != 0 || put_u32(gen, COLLECTOR_BGP_ID) != 0 ||
+      put_u16(gen, 0) != 0 || put_u16(gen, gen->cfg.peer_cnt) != 0) {
+    return -1;
+  }
+  for (i = 0; i < gen->cfg.peer_cnt; i++) {
+    peer = &gen->peers[i];
+    if (put_u8(gen, PEER_TYPE_AS4 |
+                      (peer->ip.version == BGPSTREAM_ADDR_VERSION_IPV6
+                         ? PEER_TYPE_IPV6
+                         : 0)) != 0 ||
+        put_u32(gen, peer->bgp_id) != 0 || put_addr(gen, &peer->ip) != 0 ||
+        put_u32(gen, peer->asn) != 0) {
+      return -1;
+    }
+  }
+  return record_end(gen, out, time, BGPDUMP_TYPE_TABLE_DUMP_V2,
+                    BGPDUMP_SUBTYPE_TABLE_DUMP_V2_PEER_INDEX_TABLE);
+}
+
+static int write_rib_entry(mrtgen_t *gen, iow_t *out, uint32_t time,
+                           int pfx_idx)
+{
+  bgpstream_pfx_storage_t *pfx = &gen->pfxs[pfx_idx];
+  size_t offset;
+  int i;
+
+  if (record_begin(gen) != 0 || put_u32(gen, pfx_idx) != 0 ||
+      put_pfx(gen, pfx) != 0 || put_u16(gen, gen->cfg.peer_cnt) != 0) {
+    return -1;
+  }
+  for (i = 0; i < gen->cfg.peer_cnt; i++) {
+    if (put_u16(gen, i) != 0 ||
+        put_u32(gen, time - rng_below(&gen->rng, 86400)) != 0) {
+      return -1;
+    }
+    offset = gen->buf_len;
+    if (put_u16(gen, 0) != 0 ||
+        put_route_attrs(gen, i, &pfx_idx, 1, 0, 0) != 0) {
+      return -1;
+    }
+    patch_u16(gen, offset, (uint16_t)(gen->buf_len - offset - 2));
+  }
+  return record_end(gen, out, time, BGPDUMP_TYPE_TABLE_DUMP_V2,
+                    pfx->address.version == BGPSTREAM_ADDR_VERSION_IPV4
+                      ? BGPDUMP_SUBTYPE_TABLE_DUMP_V2_RIB_IPV4_UNICAST
+                      : BGPDUMP_SUBTYPE_TABLE_DUMP_V2_RIB_IPV6_UNICAST);
+}
+
+static int write_update(mrtgen_t *gen, iow_t *out, uint32_t time)
+{
+  mrtgen_config_t *cfg = &gen->cfg;
+  int peer_idx = rng_below(&gen->rng, cfg->peer_cnt);
+  peer_t *peer = &gen->peers[peer_idx];
+  bgpstream_addr_storage_t local;
+  int pfx_idxs[UPDATE_PFX_MAX];
+  int pfx_cnt = 1 + rng_below(&gen->rng, cfg->update_pfx_max);
+  int v6, withdraw;
+  int first, family_cnt, start;
+  size_t bgp_offset, offset;
+  int i;
+
+  /* all prefixes in a message are of the same family, and distinct */
+  v6 = rng_below(&gen->rng, gen->pfx_cnt) >= (uint32_t)cfg->v4_pfx_cnt;
+  first = v6 ? cfg->v4_pfx_cnt : 0;
+  family_cnt = v6 ? cfg->v6_pfx_cnt : cfg->v4_pfx_cnt;
+  if (pfx_cnt > family_cnt) {
+    pfx_cnt = family_cnt;
+  }
+  start = rng_below(&gen->rng, family_cnt);
+  for (i = 0; i < pfx_cnt; i++) {
+    pfx_idxs[i] = first + (start + i) % family_cnt;
+  }
+  withdraw = rng_below(&gen->rng, 100) < (uint32_t)cfg->withdraw_pct;
+
+  local.version = peer->ip.version;
+  if (local.version == BGPSTREAM_ADDR_VERSION_IPV4) {
+    local.ipv4.s_addr = htonl(COLLECTOR_BGP_ID);
+  } else {
+    inet_pton(AF_INET6, "2001:db8::1:1", &local.ipv6);
+  }
+
+  /* BGP4MP_MESSAGE_AS4 header */
+  if (record_begin(gen) != 0 || put_u32(gen, peer->asn) != 0 ||
+      put_u32(gen, COLLECTOR_ASN) != 0 || put_u16(gen, 0) != 0 ||
+      put_u16(gen, local.version == BGPSTREAM_ADDR_VERSION_IPV4 ? AFI_IPV4
+                                                               : AFI_IPV6) !=
+        0 ||
+      put_addr(gen, &peer->ip) != 0 || put_addr(gen, &local) != 0) {
+    return -1;
+  }
+
+  /* BGP message header (the length is filled in later) */
+  bgp_offset = gen->buf_len;
+  if (buf_reserve(gen, BGP_HDR_LEN) != 0) {
+    return -1;
+  }
+  memset(gen->buf + gen->buf_len, 0xFF, BGP_MARKER_LEN);
+  gen->buf_len += BGP_MARKER_LEN;
+  if (put_u16(gen, 0) != 0 || put_u8(gen, BGP_MSG_UPDATE) != 0) {
+    return -1;
+  }
+
+  /* withdrawn routes */
+  offset = gen->buf_len;
+  if (put_u16(gen, 0) != 0) {
+    return -1;
+  }
+  if (withdraw != 0 && v6 == 0) {
+    for (i = 0; i < pfx_cnt; i++) {
+      if (put_pfx(gen, &gen->pfxs[pfx_idxs[i]]) != 0) {
+        return -1;
+      }
+    }
+  }
+  patch_u16(gen, offset, (uint16_t)(gen->buf_len - offset - 2));
+
+  /* path attributes */
+  offset = gen->buf_len;
+  if (put_u16(gen, 0) != 0) {
+    return -1;
+  }
+  if (withdraw == 0) {
+    /* each peer flaps between a few alternative paths to each origin */
+    if (put_route_attrs(gen, peer_idx, pfx_idxs, pfx_cnt,
+                        1 + rng_below(&gen->rng, ALT_PATH_CNT), 1) != 0) {
+      return -1;
+    }
+  } else if (v6 != 0) {
+    size_t attr_offset;
+    if (attr_begin(gen, ATTR_FLAG_OPTIONAL, ATTR_MP_UNREACH, &attr_offset) !=
+          0 ||
+        put_u16(gen, AFI_IPV6) != 0 || put_u8(gen, SAFI_UNICAST) != 0) {
+      return -1;
+    }
+    for (i = 0; i < pfx_cnt; i++) {
+      if (put_pfx(gen, &gen->pfxs[pfx_idxs[i]]) != 0) {
+        return -1;
+      }
+    }
+    if (attr_end(gen, attr_offset) != 0) {
+      return -1;
+    }
+  }
+  patch_u16(gen, offset, (uint16_t)(gen->buf_len - offset - 2));
+
+  /* IPv4 NLRI */
+  if (withdraw == 0 && v6 == 0) {
+    for (i = 0; i < pfx_cnt; i++) {
+      if (put_pfx(gen, &gen->pfxs[pfx_idxs[i]]) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  patch_u16(gen, bgp_offset + BGP_MARKER_LEN,
+            (uint16_t)(gen->buf_len - bgp_offset));
+
+  return record_end(gen, out, time, BGPDUMP_TYPE_ZEBRA_BGP,
+                    BGPDUMP_SUBTYPE_ZEBRA_BGP_MESSAGE_AS4);
+}
+
+/* ========== PUBLIC FUNCTIONS ========== */
+
+void mrtgen_config_init(mrtgen_config_t *cfg)
+{
+  memset(cfg, 0, sizeof(mrtgen_config_t));
+  cfg->seed = 1;
+  cfg->peer_cnt = 8;
+  cfg->v4_pfx_cnt = 900;
+  cfg->v6_pfx_cnt = 100;
+  cfg->path_len_min = 2;
+  cfg->path_len_max = 8;
+  cfg->community_max = 4;
+  cfg->update_cnt = 1000;
+  cfg->update_pfx_max = 8;
+  cfg->withdraw_pct = 10;
+}
+
+mrtgen_t *mrtgen_create(const mrtgen_config_t *cfg)
+{
+  mrtgen_t *gen;
+  int i;
+
+  if (cfg->peer_cnt < 1 || cfg->peer_cnt > 0xFFFF || cfg->v4_pfx_cnt < 0 ||
+      cfg->v6_pfx_cnt < 0 || cfg->v4_pfx_cnt + cfg->v6_pfx_cnt < 1 ||
+      cfg->path_len_min < 1 || cfg->path_len_max < cfg->path_len_min ||
+      cfg->path_len_max > PATH_LEN_MAX ||
+      (cfg->path_dist != MRTGEN_PATH_DIST_UNIFORM &&
+       cfg->path_dist != MRTGEN_PATH_DIST_INTERNET) ||
+      cfg->community_max < 0 || cfg->community_max > COMMUNITY_MAX ||
+      cfg->update_cnt < 0 || cfg->update_rate < 0 || cfg->update_pfx_max < 1 ||
+      cfg->update_pfx_max > UPDATE_PFX_MAX || cfg->withdraw_pct < 0 ||
+      cfg->withdraw_pct > 100) {
+    fprintf(stderr, "ERROR: Invalid MRT generator configuration\n");
+    return NULL;
+  }
+
+  if ((gen = malloc_zero(sizeof(mrtgen_t))) == NULL) {
+    return NULL;
+  }
+  gen->cfg = *cfg;
+  gen->rng = rng_seed(cfg->seed);
+  gen->pfx_cnt = cfg->v4_pfx_cnt + cfg->v6_pfx_cnt;
+
+  if (init_path_lens(gen) != 0) {
+    goto err;
+  }
+
+  if ((gen->peers = malloc_zero(sizeof(peer_t) * cfg->peer_cnt)) == NULL ||
+      (gen->pfxs = malloc_zero(sizeof(bgpstream_pfx_storage_t) *
+                               gen->pfx_cnt)) == NULL ||
+      (gen->origins = malloc(sizeof(uint32_t) * gen->pfx_cnt)) == NULL) {
+    goto err;
+  }
+
+  for (i = 0; i < TRANSIT_CNT; i++) {
+    gen->transits[i] = 1 + rng_below(&gen->rng, 65534);
+  }
+  for (i = 0; i < cfg->peer_cnt; i++) {
+    make_peer(gen, i, &gen->peers[i]);
+  }
+  for (i = 0; i < gen->pfx_cnt; i++) {
+    if (i < cfg->v4_pfx_cnt) {
+      make_v4_pfx(gen, &gen->pfxs[i]);
+    } else {
+      make_v6_pfx(gen, &gen->pfxs[i]);
+    }
+    gen->pfxs[i].allowed_matches = BGPSTREAM_PREFIX_MATCH_ANY;
+    /* ASes originate several prefixes each */
+    gen->origins[i] = 1 + rng_below(&gen->rng, 399999);
+    if (i > 0 && rng_below(&gen->rng, 2) == 0) {
+      gen->origins[i] = gen->origins[i - 1];
+    }
+  }
+
+  return gen;
+
+err:
+  mrtgen_destroy(gen);
+  return NULL;
+}
+
+void mrtgen_destroy(mrtgen_t *gen)
+{
+  if (gen == NULL) {
+    return;
+  }
+  free(gen->peers);
+  free(gen->pfxs);
+  free(gen->origins);
+  free(gen->buf);
+  free(gen);
+}
+
+int mrtgen_write_rib(mrtgen_t *gen, const char *path, uint32_t time)
+{
+  iow_t *out;
+  int i;
+
+  if ((out = open_out(path)) == NULL) {
+    return -1;
+  }
+  if (write_peer_index(gen, out, time) != 0) {
+    goto err;
+  }
+  for (i = 0; i < gen->pfx_cnt; i++) {
+    if (write_rib_entry(gen, out, time, i) != 0) {
+      goto err;
+    }
+  }
+  wandio_wdestroy(out);
+  return 0;
+
+err:
+  wandio_wdestroy(out);
+  return -1;
+}
+
+int mrtgen_write_updates(mrtgen_t *gen, const char *path, uint32_t start,
+                         uint32_t duration)
+{
+  iow_t *out;
+  double t;
+  int i;
+
+  if ((out = open_out(path)) == NULL) {
+    return -1;
+  }
+
+  if (gen->cfg.update_rate > 0) {
+    /* exponentially distributed gaps between messages */
+    for (t = -log(rng_unit(&gen->rng)) / gen->cfg.update_rate; t < duration;
+         t += -log(rng_unit(&gen->rng)) / gen->cfg.update_rate) {
+      if (write_update(gen, out, start + (uint32_t)t) != 0) {
+        goto err;
+      }
+    }
+  } else {
+    for (i = 0; i < gen->cfg.update_cnt; i++) {
+      if (write_update(gen, out,
+                       start + (uint32_t)((uint64_t)i * duration /
+                                          gen->cfg.update_cnt)) != 0) {
+        goto err;
+      }
+    }
+  }
+  wandio_wdestroy(out);
+  return 0;
+
+err:
+  wandio_wdestroy(out);
+  return -1;
+}
+
+int mrtgen_get_pfxs(mrtgen_t *gen, bgpstream_pfx_storage_t **pfxs)
+{
+  *pfxs = gen->pfxs;
+  return gen->pfx_cnt;
+}
@@ -0,0 +1,193 @@
+/*
+ * This file is part of bgpstream
+ *
+ * CAIDA, UC San Diego
+ * bgpstream-info@caida.org
+ *
+ * Copyright (C) 2012 The Regents of the University of California.
+ * Authors: Alistair King, Chiara Orsini
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MRTGEN_H
+#define __MRTGEN_H
+
+#include <stdint.h>
+
+#include "bgpstream_utils_pfx.h"
+
+/** @file
+ *
+ * @brief Header file that exposes the synthetic MRT generator used by
+ * bgpstream-mrtgen and the benchmarks.
+ *
+ * The generator builds a random (but reproducible, given the seed) routing
+ * table of prefixes seen by a set of peers, and writes it out as either a
+ * TABLE_DUMP_V2 RIB dump or a stream of BGP4MP_MESSAGE_AS4 updates, in the
+ * format parsed by bgpdump_lib.c. Output is written using wandio, so the
+ * compression is chosen based on the file name extension.
+ *
+ * @author Alistair King
+ *
+ */
+
+/**
+ * @name Public Opaque Data Structures
+ *
+ * @{ */
+
+typedef struct mrtgen mrtgen_t;
+
+/** @} */
+
+/**
+ * @name Public Enums
+ *
+ * @{ */
+
+/** Distributions that AS path lengths can be drawn from */
+typedef enum {
+
+  /** Every length between the minimum and maximum is equally likely */
+  MRTGEN_PATH_DIST_UNIFORM = 0,
+
+  /** Lengths follow the distribution seen in the global routing table, with
+      most paths 3 to 5 hops long (limited to the minimum and maximum) */
+  MRTGEN_PATH_DIST_INTERNET = 1,
+
+} mrtgen_path_dist_t;
+
+/** @} */
+
+/**
+ * @name Public Data Structures
+ *
+ * @{ */
+
+/** Configuration of a synthetic MRT generator */
+typedef struct mrtgen_config {
+
+  /** Seed for the random number generator */
+  uint64_t seed;
+
+  /** Number of peers (every fourth peer has an IPv6 address) */
+  int peer_cnt;
+
+  /** Number of IPv4 prefixes in the table */
+  int v4_pfx_cnt;
+
+  /** Number of IPv6 prefixes in the table */
+  int v6_pfx_cnt;
+
+  /** Minimum length of the generated AS paths */
+  int path_len_min;
+
+  /** Maximum length of the generated AS paths */
+  int path_len_max;
+
+  /** Distribution of the lengths of the generated AS paths */
+  mrtgen_path_dist_t path_dist;
+
+  /** Maximum number of communities attached to each route */
+  int community_max;
+
+  /** Number of BGP4MP messages to write to an updates dump (used only if
+      update_rate is 0) */
+  int update_cnt;
+
+  /** Mean number of BGP4MP messages per second. If non-zero, messages arrive
+      as a Poisson process at this rate, rather than update_cnt messages being
+      spread evenly over the dump. */
+  double update_rate;
+
+  /** Maximum number of prefixes in each update message */
+  int update_pfx_max;
+
+  /** Percentage of update messages that are withdrawals */
+  int withdraw_pct;
+
+} mrtgen_config_t;
+
+/** @} */
+
+/**
+ * @name Public API Functions
+ *
+ * @{ */
+
+/** Fill the given configuration with the default values
+ *
+ * @param cfg           pointer to the configuration to initialize
+ *
+ * The defaults describe a small table (1000 prefixes seen by 8 peers) that can
+ * be scaled up by changing the individual fields.
+ */
+void mrtgen_config_init(mrtgen_config_t *cfg);
+
+/** Create a new generator and build its routing table
+ *
+ * @param cfg           pointer to the configuration to use (copied)
+ * @return pointer to the new generator if successful, NULL otherwise
+ */
+mrtgen_t *mrtgen_create(const mrtgen_config_t *cfg);
+
+/** Destroy the given generator
+ *
+ * @param gen           pointer to the generator to destroy
+ */
+void mrtgen_destroy(mrtgen_t *gen);
+
+/** Write a TABLE_DUMP_V2 RIB dump of the routing table
+ *
+ * @param gen           pointer to the generator
+ * @param path          path of the file to write
+ * @param time          time of the records in the dump
+ * @return 0 if the dump was written successfully, -1 otherwise
+ *
+ * The dump contains a PEER_INDEX_TABLE record followed by one RIB record for
+ * each prefix, with an entry for every peer.
+ */
+int mrtgen_write_rib(mrtgen_t *gen, const char *path, uint32_t time);
+
+/** Write a BGP4MP updates dump
+ *
+ * @param gen           pointer to the generator
+ * @param path          path of the file to write
+ * @param start         time of the start of the dump
+ * @param duration      number of seconds spanned by the dump
+ * @return 0 if the dump was written successfully, -1 otherwise
+ *
+ * Each message is sent by a random peer, and either announces new paths for,
+ * or withdraws, a random set of prefixes from the routing table. Successive
+ * calls continue the same random sequence, so a series of dumps can be
+ * written by calling this function for consecutive intervals.
+ */
+int mrtgen_write_updates(mrtgen_t *gen, const char *path, uint32_t start,
+                         uint32_t duration);
+
+/** Get the prefixes in the routing table
+ *
+ * @param gen           pointer to the generator
+ * @param pfxs          set to point to the array of prefixes (owned by the
+ *                      generator)
+ * @return the number of prefixes in the array
+ *
+ * IPv4 prefixes come first, followed by the IPv6 prefixes.
+ */
+int mrtgen_get_pfxs(mrtgen_t *gen, bgpstream_pfx_storage_t **pfxs);
+
+/** @} */
+
+#endif /* __MRTGEN_H */